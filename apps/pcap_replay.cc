@@ -0,0 +1,246 @@
+#include "arp_message.hh"
+#include "exception.hh"
+#include "pcap.hh"
+#include "router.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+const EthernetAddress INGRESS_ETH { 0x02, 0, 0, 0, 0, 1 };
+const EthernetAddress EGRESS_ETH { 0x02, 0, 0, 0, 0, 2 };
+const EthernetAddress NEXT_HOP_ETH { 0x02, 0, 0, 0, 0, 3 };
+const Address INGRESS_IP { "10.0.0.1" };
+const Address EGRESS_IP { "10.255.0.1" };
+const Address NEXT_HOP_IP { "10.255.0.2" };
+
+struct Options
+{
+  bool router {};     // forward through a Router instead of stopping at one NetworkInterface
+  bool timed {};      // keep the recorded gaps between frames
+  double speed { 1 }; // ...divided by this
+  size_t loops { 1 };
+  size_t batch { 32 };
+  string capture {}; // where to capture what the stack receives and sends
+};
+
+// The frames of a capture that arrived at the captured host, parsed ahead of the replay so that
+// only the stack is timed. Their payloads still point into the mapped file.
+struct Trace
+{
+  vector<EthernetFrame> frames {};
+  vector<uint64_t> timestamps_ns {};
+  size_t skipped {}; // sent by the captured host, truncated by the snaplen, or not Ethernet
+  uint64_t bytes {};
+};
+
+Trace load( const string& path )
+{
+  Trace trace;
+  PcapReader reader = PcapReader::open( path );
+  while ( auto record = reader.next() ) {
+    auto frame = record->frame();
+    if ( record->direction == CaptureDirection::Outbound or record->original_length > record->bytes.size()
+         or not frame.has_value() ) {
+      ++trace.skipped;
+      continue;
+    }
+    // 单播帧都改成发给重放的接口（头部已经解析出来了，不用碰 payload）
+    if ( frame->header.dst != ETHERNET_BROADCAST ) {
+      frame->header.dst = INGRESS_ETH;
+    }
+    trace.bytes += record->bytes.size();
+    trace.frames.push_back( std::move( *frame ) );
+    trace.timestamps_ns.push_back( record->timestamp_ns );
+  }
+  return trace;
+}
+
+// The stack under test: one interface, or a router sending everything out a second one toward a
+// next hop it already knows
+class Stack
+{
+public:
+  explicit Stack( const Options& options ) : options_( options )
+  {
+    if ( not options_.router ) {
+      interface_.emplace( INGRESS_ETH, INGRESS_IP );
+    } else {
+      router_.add_interface( { INGRESS_ETH, INGRESS_IP } );
+      router_.add_interface( { EGRESS_ETH, EGRESS_IP } );
+      router_.add_route( 0, 0, NEXT_HOP_IP, 1 );
+      ARPMessage reply;
+      reply.opcode = ARPMessage::OPCODE_REPLY;
+      reply.sender_ethernet_address = NEXT_HOP_ETH;
+      reply.sender_ip_address = NEXT_HOP_IP.ipv4_numeric();
+      reply.target_ethernet_address = EGRESS_ETH;
+      reply.target_ip_address = EGRESS_IP.ipv4_numeric();
+      router_.interface( 1 ).recv_frame(
+        { { EGRESS_ETH, NEXT_HOP_ETH, EthernetHeader::TYPE_ARP }, serialize( reply ) } );
+    }
+    if ( not options_.capture.empty() ) {
+      auto writer = make_shared<PcapWriter>( options_.capture );
+      ingress().capture( writer );
+      if ( options_.router ) {
+        router_.interface( 1 ).capture( writer );
+      }
+    }
+  }
+
+  NetworkInterface& ingress() { return options_.router ? router_.interface( 0 ) : *interface_; }
+
+  // Hand over a batch of frames; returns how many datagrams came out (delivered, or forwarded)
+  size_t receive( span<const EthernetFrame> frames )
+  {
+    size_t out = 0;
+    if ( options_.router ) {
+      router_.interface( 0 ).recv_frames( frames );
+      router_.route();
+      router_.interface( 1 ).maybe_send_all( sent_ );
+      out = sent_.size();
+    } else {
+      datagrams_.clear();
+      out = interface_->recv_frames( frames, datagrams_ );
+    }
+    ingress().maybe_send_all( sent_ ); // ARP 回复之类
+    sent_.clear();
+    return out;
+  }
+
+  void tick( uint64_t ms )
+  {
+    if ( options_.router ) {
+      router_.tick( ms );
+    } else {
+      interface_->tick( ms );
+    }
+  }
+
+  InterfaceStats stats() { return options_.router ? router_.stats( 0 ) : interface_->stats(); }
+
+private:
+  Options options_;
+  optional<NetworkInterface> interface_ {};
+  Router router_ {};
+  vector<InternetDatagram> datagrams_ {};
+  vector<EthernetFrame> sent_ {};
+};
+
+void replay( const Trace& trace, const Options& options )
+{
+  Stack stack { options };
+  const size_t n = trace.frames.size();
+  const uint64_t first_ns = trace.timestamps_ns.front();
+  const uint64_t span_ns = trace.timestamps_ns.back() - first_ns;
+  size_t out = 0;
+  uint64_t recorded_ns = 0; // 已经 tick 给协议栈的录制时间
+  uint64_t ticked_ms = 0;
+
+  const auto start = steady_clock::now();
+  for ( size_t loop = 0; loop < options.loops; ++loop ) {
+    const uint64_t loop_ns = loop * span_ns;
+    for ( size_t i = 0; i < n; i += options.batch ) {
+      const size_t count = min( options.batch, n - i );
+      // 录制时间（时间戳不一定单调，倒退的按不动算）
+      recorded_ns = max( recorded_ns, loop_ns + trace.timestamps_ns[i] - first_ns );
+      if ( options.timed ) {
+        this_thread::sleep_until( start + nanoseconds( static_cast<uint64_t>( recorded_ns / options.speed ) ) );
+      }
+      if ( recorded_ns / 1'000'000 > ticked_ms ) {
+        stack.tick( recorded_ns / 1'000'000 - ticked_ms );
+        ticked_ms = recorded_ns / 1'000'000;
+      }
+      out += stack.receive( span( trace.frames ).subspan( i, count ) );
+    }
+  }
+  const duration<double> elapsed = steady_clock::now() - start;
+
+  const double frames = static_cast<double>( n * options.loops );
+  const double bytes = static_cast<double>( trace.bytes * options.loops );
+  const auto stats = stack.stats();
+  cout << fixed << setprecision( 2 );
+  cout << "replayed " << n * options.loops << " frames (" << n << " x " << options.loops << ") in "
+       << elapsed.count() << " s: " << frames / elapsed.count() / 1e6 << " Mpkt/s, "
+       << bytes * 8 / elapsed.count() / 1e9 << " Gbit/s\n";
+  cout << "datagrams " << ( options.router ? "forwarded" : "delivered" ) << ": " << out
+       << "   frames accepted: " << stats.frames_in << "   checksum failures: " << stats.checksum_failures
+       << "   malformed: " << stats.malformed;
+  if ( options.router ) {
+    cout << "   TTL expired: " << stats.ttl_expired;
+  }
+  cout << "\n";
+}
+} // namespace
+
+int main( int argc, char* argv[] )
+{
+  try {
+    if ( argc <= 0 ) {
+      abort(); // For sticklers: don't try to access argv[0] if argc <= 0.
+    }
+
+    auto args = span( argv, argc );
+    Options options;
+    string path;
+    for ( size_t i = 1; i < args.size(); ++i ) {
+      const string_view arg { args[i] };
+      const auto value = [&] {
+        if ( i + 1 >= args.size() ) {
+          throw runtime_error( string { arg } + " needs a value" );
+        }
+        return string { args[++i] };
+      };
+      if ( arg == "-r" ) {
+        options.router = true;
+      } else if ( arg == "-t" ) {
+        options.timed = true;
+      } else if ( arg == "-s" ) {
+        options.speed = stod( value() );
+        if ( options.speed <= 0 ) {
+          throw runtime_error( "-s needs a positive speed" );
+        }
+      } else if ( arg == "-n" ) {
+        options.loops = max<size_t>( stoul( value() ), 1 );
+      } else if ( arg == "-b" ) {
+        options.batch = max<size_t>( stoul( value() ), 1 );
+      } else if ( arg == "-w" ) {
+        options.capture = value();
+      } else {
+        path = arg;
+      }
+    }
+
+    if ( path.empty() ) {
+      cerr << "Usage: " << args.front() << " [-r] [-t [-s SPEED]] [-n LOOPS] [-b BATCH] [-w CAPTURE] FILE\n";
+      cerr << "\tFeeds the frames received in FILE (pcap or pcapng) to a NetworkInterface, as fast as it takes them\n";
+      cerr << "\t-r: forward them through a Router instead     -t: at the recorded timing (-s times faster)\n";
+      cerr << "\t-n: replay the file this many times (1)        -b: frames per recv_frames() call (32)\n";
+      cerr << "\t-w: capture what the stack receives and sends to CAPTURE (pcapng)\n";
+      return EXIT_FAILURE;
+    }
+
+    const Trace trace = load( path );
+    cout << "loaded " << trace.frames.size() << " frames (" << trace.skipped << " skipped) from " << path << "\n";
+    if ( trace.frames.empty() ) {
+      return EXIT_FAILURE;
+    }
+    replay( trace, options );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
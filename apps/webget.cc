@@ -1,12 +1,667 @@
+#include "event_loop.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+#include "link_device.hh"
+#include "link_tcp_connection.hh"
+#include "random.hh"
+#include "resolver.hh"
 #include "socket.hh"
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <cstdlib>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
 #include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <unistd.h>
+#include <vector>
 
 using namespace std;
 
+namespace {
+struct Url
+{
+  string host;
+  string service; // 端口号，或者 "http"
+  string path;
+};
+
+// http://HOST[:PORT][/PATH]
+Url parse_url( string_view url )
+{
+  constexpr string_view scheme = "http://";
+  if ( not url.starts_with( scheme ) ) {
+    throw runtime_error( "not an http:// URL: " + string { url } );
+  }
+  url.remove_prefix( scheme.size() );
+  const size_t slash = url.find( '/' );
+  const string_view authority = url.substr( 0, slash );
+  const string path { slash == string_view::npos ? "/" : url.substr( slash ) };
+  const size_t colon = authority.find( ':' );
+  if ( colon == string_view::npos ) {
+    return { string { authority }, "http", path };
+  }
+  return { string { authority.substr( 0, colon ) }, string { authority.substr( colon + 1 ) }, path };
+}
+
+bool iequals( string_view a, string_view b )
+{
+  return a.size() == b.size() and equal( a.begin(), a.end(), b.begin(), []( char x, char y ) {
+           return tolower( static_cast<unsigned char>( x ) ) == tolower( static_cast<unsigned char>( y ) );
+         } );
+}
+
+// Finds where each HTTP/1.1 response on a connection ends: after Content-Length bytes, after the
+// last chunk, or (with neither) when the server closes the connection
+class ResponseParser
+{
+public:
+  // How many bytes at the front of `data` belong to the current response; done() says whether it ended
+  size_t parse( string_view data )
+  {
+    size_t used = 0;
+    while ( used < data.size() and state_ != State::Done ) {
+      const string_view rest = data.substr( used );
+      if ( state_ == State::Body or state_ == State::ChunkData ) {
+        const size_t n = min<uint64_t>( remaining_, rest.size() );
+        remaining_ -= n;
+        used += n;
+        if ( remaining_ == 0 ) {
+          state_ = state_ == State::Body ? State::Done : State::ChunkEnd;
+        }
+      } else if ( state_ == State::UntilClose ) {
+        used = data.size();
+      } else {
+        // 其余的状态都一行一行地处理
+        const size_t newline = rest.find( '\n' );
+        line_.append( rest.substr( 0, newline ) );
+        if ( newline == string_view::npos ) {
+          return data.size();
+        }
+        used += newline + 1;
+        if ( not line_.empty() and line_.back() == '\r' ) {
+          line_.pop_back();
+        }
+        take_line_( line_ );
+        line_.clear();
+      }
+    }
+    return used;
+  }
+
+  // The server closed the connection: that ends a response that runs until close
+  void finish()
+  {
+    if ( state_ == State::UntilClose ) {
+      state_ = State::Done;
+    }
+  }
+
+  bool done() const { return state_ == State::Done; }
+  bool keep_alive() const { return keep_alive_; } // 服务器没说要关连接
+
+  // Get ready for the next response on the same connection
+  void reset()
+  {
+    const bool keep_alive = keep_alive_;
+    *this = {};
+    keep_alive_ = keep_alive;
+  }
+
+private:
+  enum class State : uint8_t
+  {
+    StatusLine,
+    Headers,
+    Body,
+    UntilClose,
+    ChunkSize,
+    ChunkData,
+    ChunkEnd,
+    Trailers,
+    Done,
+  };
+
+  void take_line_( string_view line )
+  {
+    switch ( state_ ) {
+      case State::StatusLine: {
+        const size_t space = line.find( ' ' );
+        if ( space == string_view::npos ) {
+          throw runtime_error( "bad HTTP status line: " + string { line } );
+        }
+        status_ = atoi( string { line.substr( space + 1, 3 ) }.c_str() );
+        state_ = State::Headers;
+        break;
+      }
+      case State::Headers:
+        if ( line.empty() ) {
+          end_headers_();
+        } else {
+          header_( line );
+        }
+        break;
+      case State::ChunkSize:
+        remaining_ = strtoull( string { line.substr( 0, line.find( ';' ) ) }.c_str(), nullptr, 16 );
+        state_ = remaining_ == 0 ? State::Trailers : State::ChunkData;
+        break;
+      case State::ChunkEnd:
+        state_ = State::ChunkSize;
+        break;
+      case State::Trailers:
+        if ( line.empty() ) {
+          state_ = State::Done;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  void header_( string_view line )
+  {
+    const size_t colon = line.find( ':' );
+    if ( colon == string_view::npos ) {
+      return;
+    }
+    const string_view name = line.substr( 0, colon );
+    string_view value = line.substr( colon + 1 );
+    value.remove_prefix( min( value.find_first_not_of( ' ' ), value.size() ) );
+    if ( iequals( name, "Content-Length" ) ) {
+      content_length_ = strtoull( string { value }.c_str(), nullptr, 10 );
+    } else if ( iequals( name, "Transfer-Encoding" ) ) {
+      chunked_ = value.find( "chunked" ) != string_view::npos;
+    } else if ( iequals( name, "Connection" ) and iequals( value, "close" ) ) {
+      keep_alive_ = false;
+    }
+  }
+
+  void end_headers_()
+  {
+    if ( status_ >= 100 and status_ < 200 ) { // 100 Continue 之类：后面还有真正的响应
+      state_ = State::StatusLine;
+      content_length_.reset();
+      chunked_ = false;
+    } else if ( status_ == 204 or status_ == 304 ) {
+      state_ = State::Done;
+    } else if ( chunked_ ) {
+      state_ = State::ChunkSize;
+    } else if ( content_length_ ) {
+      remaining_ = *content_length_;
+      state_ = remaining_ == 0 ? State::Done : State::Body;
+    } else {
+      state_ = State::UntilClose;
+    }
+  }
+
+  State state_ { State::StatusLine };
+  string line_ {};
+  int status_ {};
+  optional<uint64_t> content_length_ {};
+  bool chunked_ {};
+  bool keep_alive_ { true };
+  uint64_t remaining_ {};
+};
+
+// Collects output and writes it to stdout in large writes
+class Output
+{
+public:
+  static constexpr size_t FLUSH_SIZE = 256 * 1024;
+
+  void append( string_view data )
+  {
+    buffer_.append( data );
+    if ( buffer_.size() >= FLUSH_SIZE ) {
+      flush();
+    }
+  }
+
+  void flush()
+  {
+    for ( string_view rest { buffer_ }; not rest.empty(); ) {
+      rest.remove_prefix( stdout_.write( rest ) );
+    }
+    buffer_.clear();
+  }
+
+private:
+  FileDescriptor stdout_ { CheckSystemCall( "dup", ::dup( STDOUT_FILENO ) ) };
+  string buffer_ {};
+};
+
+struct Options
+{
+  static constexpr size_t MAX_DEPTH = 512; // 一次 writev 的 iovec 数有上限
+
+  size_t connections = 1; // 每个主机几个连接
+  size_t depth = 16;      // 每个连接最多有几个请求在路上（流水线）
+  size_t repeat = 1;      // 每个 URL 取几次
+  bool quiet = false;     // 不打印响应，只打印汇总
+  string tap {};          // 非空：用项目自己的 TCP 栈，经这个 TAP 设备收发
+};
+
+// Fetches every URL over persistent connections, several per host, each pipelining requests,
+// all on one EventLoop. A connection the server closes early hands its unanswered requests to
+// a new one.
+class Fetcher
+{
+public:
+  Fetcher( const vector<Url>& urls, const Options& options ) : options_( options )
+  {
+    for ( size_t r = 0; r < options_.repeat; ++r ) {
+      for ( const auto& url : urls ) {
+        auto& host = hosts_[{ url.host, url.service }];
+        host.name = url.host;
+        host.queue.push_back( url.path );
+        ++remaining_;
+      }
+    }
+  }
+
+  void run()
+  {
+    const auto start = chrono::steady_clock::now();
+    for ( auto& [key, host] : hosts_ ) {
+      resolver_.resolve(
+        key.first, key.second, [this, &host]( const optional<Address>& address, string_view error ) {
+          if ( not address ) {
+            throw runtime_error( string { error } );
+          }
+          host.address = *address;
+          const size_t wanted = min( options_.connections, host.queue.size() );
+          for ( size_t i = 0; i < wanted; ++i ) {
+            open_( host );
+          }
+        } );
+    }
+    if ( remaining_ > 0 ) {
+      loop_.run();
+    }
+    output_.flush();
+
+    if ( options_.quiet ) {
+      const double seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+      cerr << completed_ << " responses, " << bytes_ << " bytes in " << seconds << " s ("
+           << static_cast<double>( completed_ ) / seconds << " responses/s, "
+           << static_cast<double>( bytes_ ) * 8 / seconds / 1e6 << " Mbit/s) over " << connections_opened_
+           << " connections\n";
+    }
+  }
+
+private:
+  struct Host
+  {
+    string name {};
+    optional<Address> address {};
+    deque<string> queue {}; // 还没发出去的路径
+  };
+
+  struct Connection
+  {
+    explicit Connection( Host& h ) : host( h ) {}
+
+    Host& host;
+    TCPSocket socket {};
+    EventLoop::Id id {};
+    bool connected {};
+    deque<string> in_flight {}; // 发出去了、还没收到响应的路径
+    string unwritten {};        // 请求里还没写进套接字的部分
+    ResponseParser parser {};
+    string response {};
+    size_t responses {};
+  };
+
+  // 从主机的队列里再拿请求，凑够流水线深度；连同上次没写完的，一次 writev 写出去
+  void fill_( Connection& c )
+  {
+    vector<string> requests;
+    while ( c.in_flight.size() < options_.depth and not c.host.queue.empty() and c.parser.keep_alive() ) {
+      string path = std::move( c.host.queue.front() );
+      c.host.queue.pop_front();
+      // 这个主机的最后一个请求让服务器发完就关；别的连接收完最后一个响应由我们自己关
+      const bool last = c.host.queue.empty();
+      requests.push_back( "GET " + path + " HTTP/1.1\r\nHost: " + c.host.name + "\r\n"
+                          + ( last ? "Connection: close\r\n" : "" ) + "\r\n" );
+      c.in_flight.push_back( std::move( path ) );
+    }
+
+    vector<string_view> pieces;
+    if ( not c.unwritten.empty() ) {
+      pieces.emplace_back( c.unwritten );
+    }
+    pieces.insert( pieces.end(), requests.begin(), requests.end() );
+    if ( pieces.empty() ) {
+      return;
+    }
+
+    size_t written = c.socket.write( pieces );
+    string unwritten;
+    for ( const auto piece : pieces ) {
+      const size_t n = min( written, piece.size() );
+      written -= n;
+      unwritten.append( piece.substr( n ) );
+    }
+    c.unwritten = std::move( unwritten );
+    loop_.set_interest( c.id, true, not c.unwritten.empty() ); // 没写完的等可写了再写
+  }
+
+  void open_( Host& host )
+  {
+    auto& c = *connections_.emplace_back( make_unique<Connection>( host ) );
+    ++connections_opened_;
+    c.socket.set_blocking( false );
+    c.socket.connect( *host.address ); // 非阻塞：连上了会变得可写
+    c.id = loop_.add( c.socket, [this, &c] { readable_( c ); }, [this, &c] { writable_( c ); } );
+  }
+
+  void writable_( Connection& c )
+  {
+    if ( not c.connected ) {
+      c.socket.throw_if_error();
+      c.connected = true;
+    }
+    fill_( c );
+  }
+
+  void readable_( Connection& c )
+  {
+    while ( true ) {
+      c.socket.read( buffers_ );
+      for ( const auto& buffer : buffers_ ) {
+        consume_( c, buffer );
+      }
+      if ( c.socket.eof() ) {
+        c.parser.finish();
+        if ( c.parser.done() ) {
+          complete_( c );
+        }
+        close_( c );
+        return;
+      }
+      if ( buffers_.empty() ) {
+        break;
+      }
+    }
+    if ( c.in_flight.empty() and ( c.host.queue.empty() or not c.parser.keep_alive() ) ) {
+      close_( c );
+      return;
+    }
+    fill_( c );
+  }
+
+  void consume_( Connection& c, string_view data )
+  {
+    while ( not data.empty() ) {
+      const size_t used = c.parser.parse( data );
+      if ( not options_.quiet ) {
+        c.response.append( data.substr( 0, used ) );
+      }
+      bytes_ += used;
+      data.remove_prefix( used );
+      if ( c.parser.done() ) {
+        complete_( c );
+      }
+    }
+  }
+
+  void complete_( Connection& c )
+  {
+    if ( c.in_flight.empty() ) {
+      throw runtime_error( "response from " + c.host.name + " to no request" );
+    }
+    c.in_flight.pop_front();
+    output_.append( c.response );
+    c.response.clear();
+    c.parser.reset();
+    ++c.responses;
+    ++completed_;
+    --remaining_;
+  }
+
+  // 连接关了：没收到响应的请求放回队列，换一个新连接再发
+  void close_( Connection& c )
+  {
+    loop_.remove( c.id );
+    Host& host = c.host;
+    if ( not c.in_flight.empty() and c.responses == 0 ) {
+      throw runtime_error( "connection to " + host.name + " closed before a response" );
+    }
+    for ( auto it = c.in_flight.rbegin(); it != c.in_flight.rend(); ++it ) {
+      host.queue.push_front( std::move( *it ) );
+    }
+    erase_if( connections_, [&]( const auto& other ) { return other.get() == &c; } );
+    if ( not host.queue.empty() ) {
+      open_( host );
+    }
+    if ( remaining_ == 0 ) {
+      loop_.stop(); // 解析器也登记在循环里，run() 不会自己结束
+    }
+  }
+
+  Options options_;
+  EventLoop loop_ {};
+  Resolver resolver_ { loop_ };
+  map<pair<string, string>, Host> hosts_ {};
+  vector<unique_ptr<Connection>> connections_ {};
+  vector<Buffer> buffers_ {}; // 每次读都重用：池热了以后读不分配内存
+  Output output_ {};
+  size_t remaining_ {}; // 还没收到响应的请求
+  size_t completed_ {};
+  uint64_t bytes_ {};
+  size_t connections_opened_ {};
+};
+
+// Fetches the URLs with this project's own TCP stack (LinkTCPConnection) on a TAP device, one host
+// at a time over one connection that pipelines the requests, and reports how long the handshake,
+// the first byte and the whole transfer took.
+class StackFetcher
+{
+public:
+  StackFetcher( const vector<Url>& urls, const Options& options ) : options_( options )
+  {
+    for ( size_t r = 0; r < options_.repeat; ++r ) {
+      for ( const auto& url : urls ) {
+        auto& host = hosts_[{ url.host, url.service }];
+        host.name = url.host;
+        host.queue.push_back( url.path );
+      }
+    }
+  }
+
+  void run()
+  {
+    for ( auto& [key, host] : hosts_ ) {
+      const Address address { key.first, key.second };
+      Report report;
+      const auto start = Clock::now();
+      while ( not host.queue.empty() ) {
+        fetch_( address, host, report );
+      }
+      report_( host, report, Clock::now() - start );
+    }
+    output_.flush();
+  }
+
+private:
+  using Clock = chrono::steady_clock;
+
+  struct Host
+  {
+    string name {};
+    deque<string> queue {};
+  };
+
+  struct Report
+  {
+    size_t connections {};
+    optional<Clock::duration> connected {};  // 第一个连接握手用的时间
+    optional<Clock::duration> first_byte {}; // 第一个连接收到第一个字节的时间
+    size_t responses {};
+    uint64_t bytes {};
+    LinkTCPConnection::Stats stats {};
+  };
+
+  // One connection: pipeline requests from the host's queue until the queue is empty or the
+  // server closes the connection; requests left unanswered go back on the queue
+  void fetch_( const Address& address, Host& host, Report& report )
+  {
+    // 端口随机挑：上一次运行的连接可能还在内核的 TIME-WAIT 里
+    LinkTCPConnection::Config config;
+    config.local_port = uniform_int_distribution<uint16_t> { 49152, 65535 }( rng_ );
+    LinkTCPConnection conn { LinkDevice::tap( options_.tap ), config, address };
+
+    const bool first = report.connections++ == 0;
+    const auto start = Clock::now();
+    deque<string> in_flight;
+    ResponseParser parser;
+    string response;
+    size_t responses = 0;
+    bool closed = false;
+
+    const auto complete = [&] {
+      in_flight.pop_front();
+      output_.append( response );
+      response.clear();
+      parser.reset();
+      ++responses;
+    };
+
+    // 设备可读或者时间过去了以后：写请求、读响应，都收完了就关
+    const auto step = [&] {
+      if ( conn.reset() ) {
+        throw runtime_error( "connection to " + host.name + " reset" );
+      }
+      if ( conn.reader().has_error() ) {
+        throw runtime_error( "connection to " + host.name + " timed out" );
+      }
+      if ( not conn.established() ) {
+        return;
+      }
+      if ( first and not report.connected ) {
+        report.connected = Clock::now() - start;
+      }
+
+      bool wrote = false;
+      while ( in_flight.size() < options_.depth and not host.queue.empty() and parser.keep_alive() and not closed ) {
+        const bool last = host.queue.size() == 1;
+        string request = "GET " + host.queue.front() + " HTTP/1.1\r\nHost: " + host.name + "\r\n"
+                         + ( last ? "Connection: close\r\n" : "" ) + "\r\n";
+        if ( request.size() > conn.writer().available_capacity() ) {
+          break;
+        }
+        conn.writer().push( std::move( request ) );
+        in_flight.push_back( std::move( host.queue.front() ) );
+        host.queue.pop_front();
+        wrote = true;
+      }
+
+      Reader& reader = conn.reader();
+      while ( reader.bytes_buffered() > 0 ) {
+        if ( first and not report.first_byte ) {
+          report.first_byte = Clock::now() - start;
+        }
+        string_view data = reader.peek();
+        const size_t size = data.size();
+        report.bytes += size;
+        while ( not data.empty() ) {
+          const size_t used = parser.parse( data );
+          if ( not options_.quiet ) {
+            response.append( data.substr( 0, used ) );
+          }
+          data.remove_prefix( used );
+          if ( parser.done() ) {
+            if ( in_flight.empty() ) {
+              throw runtime_error( "response from " + host.name + " to no request" );
+            }
+            complete();
+          }
+        }
+        reader.pop( size );
+      }
+      if ( reader.is_finished() ) {
+        parser.finish();
+        if ( parser.done() and not in_flight.empty() ) {
+          complete();
+        }
+      }
+
+      // 没有要等的响应了（或者服务器已经关了），我们也关
+      if ( not closed and ( reader.is_finished() or ( in_flight.empty() and host.queue.empty() ) ) ) {
+        conn.writer().close();
+        closed = wrote = true;
+      }
+      if ( wrote ) {
+        conn.push();
+      }
+    };
+
+    EventLoop loop;
+    loop.add(
+      conn.fd(),
+      [&] {
+        conn.poll();
+        step();
+      },
+      {},
+      false );
+    loop.add_timer( 1, [&]( uint64_t ms ) {
+      conn.tick( ms );
+      step();
+    } );
+    conn.connect();
+
+    // 两个方向都结束、FIN 也被确认了就走，不等 TIME-WAIT
+    while ( conn.active()
+            and not( conn.reader().is_finished() and closed
+                     and conn.peer().sender().sequence_numbers_in_flight() == 0 ) ) {
+      loop.wait_next_event( -1 );
+    }
+
+    for ( auto it = in_flight.rbegin(); it != in_flight.rend(); ++it ) {
+      host.queue.push_front( std::move( *it ) );
+    }
+    if ( not host.queue.empty() and responses == 0 ) {
+      throw runtime_error( "connection to " + host.name + " closed before a response" );
+    }
+
+    const auto stats = conn.stats();
+    report.responses += responses;
+    report.stats.segments_sent += stats.segments_sent;
+    report.stats.segments_received += stats.segments_received;
+    report.stats.bytes_sent += stats.bytes_sent;
+    report.stats.bytes_received += stats.bytes_received;
+    report.stats.dropped += stats.dropped;
+  }
+
+  void report_( const Host& host, const Report& report, Clock::duration elapsed )
+  {
+    const auto ms = []( optional<Clock::duration> d ) {
+      return chrono::duration<double, milli>( d.value_or( Clock::duration::zero() ) ).count();
+    };
+    const double seconds = chrono::duration<double>( elapsed ).count();
+    cerr << host.name << " over " << options_.tap << ": connected in " << ms( report.connected )
+         << " ms, first byte at " << ms( report.first_byte ) << " ms; " << report.responses << " responses, "
+         << report.bytes << " bytes in " << seconds << " s ("
+         << static_cast<double>( report.bytes ) * 8 / seconds / 1e6 << " Mbit/s) over " << report.connections
+         << " connections; " << report.stats.segments_sent << " segments sent, " << report.stats.segments_received
+         << " received, " << report.stats.dropped << " datagrams dropped\n";
+  }
+
+  Options options_;
+  map<pair<string, string>, Host> hosts_ {};
+  Output output_ {};
+  default_random_engine rng_ { get_random_engine() };
+};
+} // namespace
+
 void get_URL( const string& host, const string& path )
 {
   // Your code here.
@@ -19,21 +674,7 @@ void get_URL( const string& host, const string& path )
   // (not just one call to read() -- everything) until you reach
   // the "eof" (end of file).
 
-  Address addr( host, "http" );
-  TCPSocket http_tcp;
-  http_tcp.connect( addr );
-  http_tcp.write( "GET " + path + " HTTP/1.1\r\n" );
-  http_tcp.write( "HOST: " + host + "\r\n" );
-  http_tcp.write( "Connection: close\r\n" );
-  http_tcp.write( "\r\n" );
-
-  while ( !http_tcp.eof() ) {
-    std::string buffer;
-    http_tcp.read( buffer );
-    std::cout << buffer;
-  }
-
-  http_tcp.close();
+  Fetcher { { Url { host, "http", path } }, Options {} }.run();
 }
 
 int main( int argc, char* argv[] )
@@ -45,21 +686,57 @@ int main( int argc, char* argv[] )
 
     auto args = span( argv, argc );
 
-    // The program takes two command-line arguments: the hostname and "path" part of the URL.
-    // Print the usage message unless there are these two arguments (plus the program name
-    // itself, so arg count = 3 in total).
-    if ( argc != 3 ) {
+    // The original form takes two command-line arguments: the hostname and "path" part of the URL.
+    if ( argc == 3 and string_view { args[1] }.find( "://" ) == string_view::npos and args[1][0] != '-' ) {
+      get_URL( args[1], args[2] );
+      return EXIT_SUCCESS;
+    }
+
+    // Otherwise: options, then any number of URLs
+    Options options;
+    vector<Url> urls;
+    for ( size_t i = 1; i < args.size(); ++i ) {
+      const string_view arg { args[i] };
+      const auto number = [&] {
+        if ( i + 1 >= args.size() ) {
+          throw runtime_error( string { arg } + " needs a number" );
+        }
+        return max<size_t>( stoul( args[++i] ), 1 );
+      };
+      if ( arg == "-c" ) {
+        options.connections = number();
+      } else if ( arg == "-p" ) {
+        options.depth = min( number(), Options::MAX_DEPTH );
+      } else if ( arg == "-n" ) {
+        options.repeat = number();
+      } else if ( arg == "-q" ) {
+        options.quiet = true;
+      } else if ( arg == "-t" ) {
+        if ( i + 1 >= args.size() ) {
+          throw runtime_error( "-t needs a TAP device" );
+        }
+        options.tap = args[++i];
+      } else {
+        urls.push_back( parse_url( arg ) );
+      }
+    }
+
+    if ( urls.empty() ) {
       cerr << "Usage: " << args.front() << " HOST PATH\n";
+      cerr << "       " << args.front() << " [-c CONNECTIONS] [-p DEPTH] [-n REPEAT] [-q] [-t TAP] URL...\n";
       cerr << "\tExample: " << args.front() << " stanford.edu /class/cs144\n";
+      cerr << "\t-c: persistent connections per host (1)   -p: requests pipelined on each (16)\n";
+      cerr << "\t-n: fetch every URL this many times (1)   -q: a summary instead of the responses\n";
+      cerr << "\t-t: use this project's TCP stack on TAP device TAP (see scripts/tap.sh), and report timings\n";
+      cerr << "\tURL: http://HOST[:PORT][/PATH]\n";
       return EXIT_FAILURE;
     }
 
-    // Get the command-line arguments.
-    const string host { args[1] };
-    const string path { args[2] };
-
-    // Call the student-written function.
-    get_URL( host, path );
+    if ( options.tap.empty() ) {
+      Fetcher { urls, options }.run();
+    } else {
+      StackFetcher { urls, options }.run();
+    }
   } catch ( const exception& e ) {
     cerr << e.what() << "\n";
     return EXIT_FAILURE;
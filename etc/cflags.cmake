@@ -6,3 +6,13 @@ set(SANITIZING_FLAGS -fno-sanitize-recover=all -fsanitize=undefined -fsanitize=a
 # ask for more warnings from the compiler
 set (CMAKE_BASE_CXX_FLAGS "${CMAKE_CXX_FLAGS}")
 set (CMAKE_CXX_FLAGS "${CMAKE_CXX_FLAGS} -Wall -Wpedantic -Wextra -Weffc++ -Werror -Wshadow -Wpointer-arith -Wcast-qual -Wformat=2 -Wno-unqualified-std-cast-call")
+
+# log messages below this level (0 debug, 1 info, 2 warning, 3 error, 4 none) are compiled out; see util/log.hh
+set (MINNOW_LOG_MIN_LEVEL 0 CACHE STRING "Lowest log level compiled in")
+add_compile_definitions (MINNOW_LOG_MIN_LEVEL=${MINNOW_LOG_MIN_LEVEL})
+
+# latency histograms around the hot paths; see util/profile.hh
+option (MINNOW_PROFILE "Compile in the hot-path latency histograms" OFF)
+if (MINNOW_PROFILE)
+  add_compile_definitions (MINNOW_PROFILE=1)
+endif ()
@@ -0,0 +1,44 @@
+# The release libraries, minnow_release and util_release: -O3 and link-time optimization, and
+# optionally tuned for this machine and optimized from a profile of the benchmark suite
+# (scripts/pgo.sh runs the whole profile-guided build).
+include (CheckIPOSupported)
+
+option (MINNOW_NATIVE_ARCH "Build the release libraries for this machine (-march=native)" OFF)
+set (MINNOW_PGO "off" CACHE STRING "Profile-guided optimization of the release libraries: off, generate or use")
+set_property (CACHE MINNOW_PGO PROPERTY STRINGS off generate use)
+set (MINNOW_PGO_DIR "${CMAKE_BINARY_DIR}/pgo")
+
+check_ipo_supported (RESULT MINNOW_LTO OUTPUT lto_error LANGUAGES CXX)
+if (NOT MINNOW_LTO)
+  message (STATUS "Release libraries built without LTO: ${lto_error}")
+endif ()
+
+set (RELEASE_FLAGS -O3)
+if (MINNOW_NATIVE_ARCH)
+  list (APPEND RELEASE_FLAGS -march=native)
+endif ()
+
+if (MINNOW_PGO STREQUAL "generate")
+  list (APPEND RELEASE_FLAGS -fprofile-generate=${MINNOW_PGO_DIR} -fprofile-update=prefer-atomic)
+elseif (MINNOW_PGO STREQUAL "use")
+  if (CMAKE_CXX_COMPILER_ID STREQUAL "Clang")
+    # clang reads the .profraw files only once llvm-profdata has merged them
+    list (APPEND RELEASE_FLAGS -fprofile-use=${MINNOW_PGO_DIR}/default.profdata
+      -Wno-profile-instr-unprofiled -Wno-profile-instr-out-of-date)
+  else ()
+    list (APPEND RELEASE_FLAGS -fprofile-use=${MINNOW_PGO_DIR} -fprofile-partial-training -Wno-missing-profile)
+  endif ()
+elseif (NOT MINNOW_PGO STREQUAL "off")
+  message (FATAL_ERROR "MINNOW_PGO must be off, generate or use (not `${MINNOW_PGO}')")
+endif ()
+
+# Every consumer is compiled and linked with the same flags, so LTO and the profile reach across
+# the library boundary
+macro (release_library target)
+  target_compile_options (${target} PUBLIC ${RELEASE_FLAGS})
+  target_link_options (${target} INTERFACE ${RELEASE_FLAGS})
+  if (MINNOW_LTO)
+    set_property (TARGET ${target} PROPERTY INTERPROCEDURAL_OPTIMIZATION ON)
+    target_link_options (${target} INTERFACE ${CMAKE_CXX_COMPILE_OPTIONS_IPO})
+  endif ()
+endmacro (release_library)
@@ -23,6 +23,13 @@ ttest(byte_stream_one_write)
 ttest(byte_stream_two_writes)
 ttest(byte_stream_many_writes)
 ttest(byte_stream_stress_test)
+ttest(byte_stream_ring)
+ttest(byte_stream_scatter)
+ttest(byte_stream_spsc)
+ttest(byte_stream_bulk)
+ttest(byte_stream_hooks)
+ttest(file_stream)
+ttest(steady_state_allocations)
 
 ttest(reassembler_single)
 ttest(reassembler_cap)
@@ -31,6 +38,9 @@ ttest(reassembler_dup)
 ttest(reassembler_holes)
 ttest(reassembler_overlapping)
 ttest(reassembler_win)
+ttest(reassembler_bitmap)
+ttest(reassembler_buffer)
+ttest(reassembler_stats)
 
 ttest(wrapping_integers_cmp)
 ttest(wrapping_integers_wrap)
@@ -45,6 +55,12 @@ ttest(recv_reorder)
 ttest(recv_reorder_more)
 ttest(recv_close)
 ttest(recv_special)
+ttest(recv_sack)
+ttest(recv_window_scale)
+ttest(recv_delayed_ack)
+ttest(recv_autotune)
+ttest(recv_long_flow)
+ttest(recv_batch)
 
 ttest(send_connect)
 ttest(send_transmit)
@@ -53,10 +69,60 @@ ttest(send_window)
 ttest(send_ack)
 ttest(send_close)
 ttest(send_extra)
+ttest(send_batch)
+ttest(send_rtt)
+ttest(send_fast_retx)
+ttest(send_congestion)
+ttest(send_sack)
+ttest(send_window_scale)
+ttest(send_mss)
+ttest(send_nagle)
+ttest(send_pacing)
+ttest(timer_wheel)
+ttest(tcp_peer)
+ttest(tcp_segment)
+ttest(checksum)
+ttest(parser)
+ttest(header_codec)
+ttest(buffer_pool)
+ttest(event_loop)
+ttest(coroutine)
+ttest(socket_zerocopy)
+ttest(socket_options)
+ttest(tcp_listener)
+ttest(udp_batch)
+ttest(resolver)
+ttest(log)
+ttest(profile)
+ttest(lpm_table)
 
 ttest(net_interface)
+ttest(net_interface_expiry)
+ttest(net_interface_queue)
+ttest(net_interface_framing)
+ttest(net_interface_refresh)
+ttest(net_interface_config)
+ttest(net_interface_fragment)
+ttest(net_interface_batch)
+ttest(net_interface_egress)
+ttest(link_device)
+ttest(packet_arena)
+ttest(pcap)
+ttest(checkpoint)
+ttest(link_tcp_connection)
+ttest(network_simulation)
+ttest(ipv4_flat_map)
+ttest(connection_table)
 
 ttest(router)
+ttest(router_cache)
+ttest(router_batch)
+ttest(router_ecmp)
+ttest(router_stats)
+ttest(router_nat)
+ttest(route_table)
+ttest(packet_filter)
+ttest(parallel_router)
 
 add_custom_target (check0 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 20 -R 'webget|^byte_stream_')
 
@@ -76,6 +142,13 @@ add_custom_target (check5 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --s
 
 add_custom_target (speed COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --timeout 20 -R '_speed_test')
 
+# The benchmark suite on its own, saving every result as JSON in the build directory
+add_custom_target (benchmark COMMAND benchmark_speed_test "${CMAKE_BINARY_DIR}/benchmark.json"
+  DEPENDS benchmark_speed_test)
+add_custom_target (benchmark_release
+  COMMAND benchmark_release_speed_test "${CMAKE_BINARY_DIR}/benchmark_release.json"
+  DEPENDS benchmark_release_speed_test)
+
 set(compile_name_opt "compile with optimization")
 add_test(NAME ${compile_name_opt}
   COMMAND "${CMAKE_COMMAND}" --build "${CMAKE_BINARY_DIR}" -t speed_testing)
@@ -90,3 +163,17 @@ set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
 stest(reassembler_speed_test)
+stest(reassembler_reorder_speed_test)
+stest(reassembler_workload_speed_test)
+stest(wrapping_integers_speed_test)
+stest(timer_wheel_speed_test)
+stest(tcp_peer_memory_speed_test)
+stest(net_interface_speed_test)
+stest(checksum_speed_test)
+stest(parser_speed_test)
+stest(router_speed_test)
+stest(lpm_speed_test)
+stest(route_table_speed_test)
+stest(connection_table_speed_test)
+stest(parallel_router_speed_test)
+stest(benchmark_speed_test)
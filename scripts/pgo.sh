@@ -0,0 +1,22 @@
+#!/bin/sh
+# Build the release libraries (see etc/release.cmake) optimized from a profile of the benchmark
+# suite: build them instrumented, run benchmark_release_speed_test to record the profile, then
+# rebuild them from it. Afterwards `cmake --build BUILD -t benchmark_release` measures the result.
+#
+#   scripts/pgo.sh [BUILD]   # BUILD defaults to build
+
+set -e
+
+build="${1:-build}"
+
+cmake -S "$(dirname "$0")/.." -B "$build" -DMINNOW_PGO=generate
+rm -rf "$build/pgo"
+cmake --build "$build" -t benchmark_release_speed_test
+"$build/tests/benchmark_release_speed_test" > /dev/null
+
+if ls "$build"/pgo/*.profraw > /dev/null 2>&1; then
+  llvm-profdata merge -o "$build/pgo/default.profdata" "$build"/pgo/*.profraw
+fi
+
+cmake -B "$build" -DMINNOW_PGO=use
+cmake --build "$build" -t benchmark_release_speed_test
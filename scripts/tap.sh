@@ -0,0 +1,31 @@
+#!/bin/sh
+# Set up (or tear down) a TAP device for `webget -t`: the kernel's side of the link gets
+# 169.254.144.1/24, and this project's stack uses 169.254.144.9 (LinkTCPConnection's defaults).
+# With "start", traffic from the stack is also NATed out to the rest of the network.
+#
+#   sudo scripts/tap.sh start [DEVICE]   # DEVICE defaults to tap144
+#   sudo scripts/tap.sh stop [DEVICE]
+
+set -e
+
+device="${2:-tap144}"
+subnet="169.254.144.0/24"
+
+case "$1" in
+  start)
+    ip tuntap add dev "$device" mode tap user "${SUDO_USER:-$(id -un)}"
+    ip addr add 169.254.144.1/24 dev "$device"
+    ip link set dev "$device" up
+    sysctl -q -w net.ipv4.ip_forward=1
+    iptables -t nat -A POSTROUTING -s "$subnet" ! -o "$device" -j MASQUERADE 2>/dev/null \
+      || echo "iptables not available: the stack can only reach this host" >&2
+    ;;
+  stop)
+    iptables -t nat -D POSTROUTING -s "$subnet" ! -o "$device" -j MASQUERADE 2>/dev/null || true
+    ip tuntap del dev "$device" mode tap
+    ;;
+  *)
+    echo "Usage: $0 start|stop [DEVICE]" >&2
+    exit 1
+    ;;
+esac
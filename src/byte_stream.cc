@@ -1,41 +1,235 @@
+#include <cstring>
 #include <stdexcept>
 
 #include "byte_stream.hh"
+#include "parser.hh"
 
 using namespace std;
 
-ByteStream::ByteStream( uint64_t capacity ) : capacity_( capacity ) {}
+ByteStream::ByteStream( uint64_t capacity, Backend backend ) : capacity_( capacity ), backend_( backend ) {}
+
+// 只在没有缓存字节时释放；Queue 的槽位和 Ring 的字节都在下次 push 时重新分配
+void ByteStream::release_memory()
+{
+  if ( bytes_buffed_size_ != 0 ) {
+    return;
+  }
+  buffer_.clear();
+  buffer_.shrink_to_fit(); // `= {}` 会选 initializer_list 版本的赋值，不释放容量
+  buffer_head_ = 0;
+  buffer_view_ = {};
+  ring_.clear();
+  ring_.shrink_to_fit();
+  ring_head_ = 0;
+}
+
+// 容量、三个计数、关闭 / 出错标志，然后是缓存的字节；Queue 的 Buffer 直接交给 Serializer，不拷贝
+void ByteStream::checkpoint( Serializer& out ) const
+{
+  out.integer( capacity_ );
+  out.integer( bytes_push_size_ );
+  out.integer( bytes_pop_size_ );
+  out.integer( bytes_buffed_size_ );
+  out.integer( static_cast<uint8_t>( is_closed_ | ( has_error_ << 1 ) ) );
+  if ( bytes_buffed_size_ == 0 ) {
+    return;
+  }
+  if ( backend_ == Backend::Ring ) {
+    auto const first_part = min( bytes_buffed_size_, capacity_ - ring_head_ );
+    char* bytes = out.extend( bytes_buffed_size_ );
+    memcpy( bytes, ring_.data() + ring_head_, first_part );
+    memcpy( bytes + first_part, ring_.data(), bytes_buffed_size_ - first_part );
+    return;
+  }
+  const Buffer& front = buffer_[buffer_head_];
+  out.buffer( front.substr( front.size() - buffer_view_.size() ) );
+  for ( auto i = buffer_head_ + 1; i < buffer_.size(); ++i ) {
+    out.buffer( buffer_[i] );
+  }
+}
+
+void ByteStream::restore( Parser& in )
+{
+  uint64_t capacity {};
+  uint64_t pushed {};
+  uint64_t popped {};
+  uint64_t buffered {};
+  uint8_t flags {};
+  in.integer( capacity );
+  in.integer( pushed );
+  in.integer( popped );
+  in.integer( buffered );
+  in.integer( flags );
+  // 容量只是个数字，这里不按它分配；缓存的字节必须真的在输入里，才按它分配
+  if ( in.has_error() or buffered > capacity or pushed != popped + buffered or buffered > in.input().size() ) {
+    in.set_error();
+    return;
+  }
+
+  buffer_.clear();
+  buffer_head_ = 0;
+  buffer_view_ = {};
+  ring_.clear();
+  ring_head_ = 0;
+  capacity_ = capacity;
+  bytes_push_size_ = pushed;
+  bytes_pop_size_ = popped;
+  bytes_buffed_size_ = buffered;
+  is_closed_ = flags & 1;
+  has_error_ = flags & 2;
+  if ( buffered == 0 ) {
+    return;
+  }
+  if ( backend_ == Backend::Ring ) {
+    // ring_ 先只放这些字节（从头开始，不绕回），下一次 push 时 ring_write() 再扩到 capacity_
+    ring_.resize( buffered );
+    in.string( ring_ );
+    return;
+  }
+  Buffer bytes;
+  in.buffer( buffered, bytes );
+  buffer_.push_back( std::move( bytes ) );
+  buffer_view_ = buffer_.front();
+}
+
+ByteStream::Wait::~Wait()
+{
+  // 协程在等待中被销毁：别让流以后去唤醒一个不存在的协程
+  auto& slot = writer_ ? stream_.writer_waiting_ : stream_.reader_waiting_;
+  if ( waiting_ and slot == waiting_ ) {
+    slot = {};
+  }
+}
+
+bool ByteStream::Wait::await_ready() const noexcept
+{
+  if ( stream_.has_error_ or stream_.is_closed_ ) {
+    return true;
+  }
+  if ( writer_ ) {
+    return stream_.capacity_ - stream_.bytes_buffed_size_ >= min( wants_, stream_.capacity_ );
+  }
+  return stream_.bytes_buffed_size_ > 0;
+}
+
+void ByteStream::Wait::await_suspend( coroutine_handle<> coroutine ) noexcept
+{
+  waiting_ = coroutine;
+  if ( writer_ ) {
+    stream_.writer_wants_ = min( wants_, stream_.capacity_ );
+    stream_.writer_waiting_ = coroutine;
+  } else {
+    stream_.reader_waiting_ = coroutine;
+  }
+}
+
+bool ByteStream::Wait::await_resume() const noexcept
+{
+  if ( writer_ ) {
+    return not stream_.has_error_ and not stream_.is_closed_;
+  }
+  return stream_.bytes_buffed_size_ > 0;
+}
 
 // 这里是值传递，data可以move操作
 void Writer::push( string data ) noexcept
 {
-  if ( 0 == available_capacity() || data.empty()) {
+  if ( 0 == available_capacity() || data.empty() ) {
+    return;
+  }
+  if ( backend_ == Backend::Ring ) {
+    ring_write( data );
+    return;
+  }
+  if ( data.size() > available_capacity() ) {
+    data.resize( available_capacity() );
+  }
+  push( Buffer { std::move( data ) } );
+}
+
+// 共享 Buffer 的存储，不拷贝字节（超出容量时只保留前缀切片）
+void Writer::push( Buffer data ) noexcept
+{
+  if ( 0 == available_capacity() || data.empty() ) {
+    return;
+  }
+  if ( backend_ == Backend::Ring ) {
+    ring_write( data );
     return;
   }
-  auto size = min( available_capacity(), data.size() );
 
+  auto size = min( available_capacity(), data.size() );
   if ( size < data.size() ) {
-    data.resize( size );
+    data = data.substr( 0, size );
   }
 
-  buffer_.push( std::move( data ) );
-  if ( 1 == buffer_.size() ) {
-    buffer_view_ = buffer_.front();
+  buffer_.push_back( std::move( data ) );
+  if ( 1 == buffer_.size() - buffer_head_ ) {
+    buffer_view_ = buffer_[buffer_head_];
   }
   bytes_push_size_ += size;
   bytes_buffed_size_ += size;
+  wake_reader();
+  if ( bytes_buffed_size_ == size ) {
+    readable_hook_(); // 从空变成有数据
+  }
+}
 
-  return;
+// 只拷贝放得下的前缀：Queue 用池里的 string 装这部分，Ring 直接拷进 ring_
+void Writer::push( string_view data ) noexcept
+{
+  auto const size = min( available_capacity(), data.size() );
+  if ( size == 0 ) {
+    return;
+  }
+  if ( backend_ == Backend::Ring ) {
+    ring_write( data );
+    return;
+  }
+  string copy = Buffer::pooled_string( size );
+  copy.assign( data.substr( 0, size ) );
+  push( Buffer { std::move( copy ) } );
+}
+
+// 尾部可能绕回 ring_ 开头，最多两次 memcpy
+void ByteStream::ring_write( string_view data ) noexcept
+{
+  if ( ring_.size() != capacity_ ) {
+    ring_.resize( capacity_ ); // 第一次写入（或 release_memory() 之后）才分配
+  }
+  auto const size = min( capacity_ - bytes_buffed_size_, data.size() );
+  auto const tail = ( ring_head_ + bytes_buffed_size_ ) % capacity_;
+  auto const first_part = min( size, capacity_ - tail );
+  memcpy( ring_.data() + tail, data.data(), first_part );
+  memcpy( ring_.data(), data.data() + first_part, size - first_part );
+  bytes_push_size_ += size;
+  bytes_buffed_size_ += size;
+  wake_reader();
+  if ( bytes_buffed_size_ == size ) {
+    readable_hook_(); // 从空变成有数据
+  }
 }
 
 void Writer::close() noexcept
 {
+  if ( is_closed_ ) {
+    return;
+  }
   is_closed_ = true;
+  wake_reader();
+  readable_hook_();
 }
 
 void Writer::set_error() noexcept
 {
+  if ( has_error_ ) {
+    return;
+  }
   has_error_ = true;
+  wake_reader();
+  wake_writer();
+  readable_hook_();
+  writable_hook_();
 }
 
 bool Writer::is_closed() const noexcept
@@ -53,16 +247,114 @@ uint64_t Writer::bytes_pushed() const noexcept
   return bytes_push_size_;
 }
 
+uint64_t Writer::capacity() const noexcept
+{
+  return capacity_;
+}
+
+// Ring：换一块新的 ring，把已缓存的字节按顺序拷到开头
+void Writer::set_capacity( uint64_t capacity )
+{
+  capacity = max( capacity, bytes_buffed_size_ );
+  if ( capacity == capacity_ ) {
+    return;
+  }
+  auto const was_full = bytes_buffed_size_ == capacity_;
+  if ( backend_ == Backend::Ring && !ring_.empty() ) {
+    string ring( capacity, 0 );
+    auto const first_part = min( bytes_buffed_size_, capacity_ - ring_head_ );
+    memcpy( ring.data(), ring_.data() + ring_head_, first_part );
+    memcpy( ring.data() + first_part, ring_.data(), bytes_buffed_size_ - first_part );
+    ring_ = std::move( ring );
+    ring_head_ = 0;
+  }
+  capacity_ = capacity;
+  wake_writer();
+  if ( was_full and capacity_ > bytes_buffed_size_ ) {
+    writable_hook_();
+  }
+}
+
 string_view Reader::peek() const noexcept
 {
+  if ( backend_ == Backend::Ring ) {
+    // 返回从 ring_head_ 开始最长的连续可读区间
+    return { ring_.data() + ring_head_, min( bytes_buffed_size_, capacity_ - ring_head_ ) };
+  }
   return buffer_view_;
 }
 
+// 分散读：用一组 string_view 覆盖所有已缓存的字节，可以直接交给 writev()
+void Reader::peek_all( vector<string_view>& out ) const
+{
+  out.clear();
+  if ( bytes_buffed_size_ == 0 ) {
+    return;
+  }
+
+  if ( backend_ == Backend::Ring ) {
+    out.push_back( peek() );
+    if ( out.back().size() < bytes_buffed_size_ ) {
+      out.emplace_back( ring_.data(), bytes_buffed_size_ - out.back().size() );
+    }
+    return;
+  }
+
+  out.reserve( buffer_.size() - buffer_head_ );
+  out.push_back( buffer_view_ );
+  for ( auto i = buffer_head_ + 1; i < buffer_.size(); ++i ) {
+    out.emplace_back( buffer_[i] );
+  }
+}
+
+// Ring 最多两段，Queue 每个 Buffer 一段；拷完一次 pop
+uint64_t Reader::read_into( span<char> out ) noexcept
+{
+  auto const size = min<uint64_t>( out.size(), bytes_buffed_size_ );
+  if ( size == 0 ) {
+    return 0;
+  }
+
+  if ( backend_ == Backend::Ring ) {
+    auto const first_part = min( size, capacity_ - ring_head_ );
+    memcpy( out.data(), ring_.data() + ring_head_, first_part );
+    memcpy( out.data() + first_part, ring_.data(), size - first_part );
+  } else {
+    string_view chunk = buffer_view_;
+    uint64_t copied = 0;
+    for ( auto i = buffer_head_;; chunk = buffer_[++i] ) {
+      auto const len = min<uint64_t>( chunk.size(), size - copied );
+      memcpy( out.data() + copied, chunk.data(), len );
+      copied += len;
+      if ( copied == size ) {
+        break;
+      }
+    }
+  }
+
+  pop( size );
+  return size;
+}
+
+Buffer Reader::peek_buffer() const
+{
+  if ( backend_ == Backend::Queue && buffer_head_ < buffer_.size() ) {
+    const Buffer& front = buffer_[buffer_head_];
+    return front.substr( front.size() - buffer_view_.size() );
+  }
+  return Buffer { string { peek() } };
+}
+
 bool Reader::is_finished() const noexcept
 {
   return is_closed_ && bytes_buffed_size_ == 0;
 }
 
+bool Reader::is_closed() const noexcept
+{
+  return is_closed_;
+}
+
 bool Reader::has_error() const noexcept
 {
   return has_error_ ;
@@ -70,23 +362,45 @@ bool Reader::has_error() const noexcept
 
 void Reader::pop( uint64_t len ) noexcept
 {
-  if ( len > bytes_buffed_size_ ) {
+  if ( len > bytes_buffed_size_ || len == 0 ) {
     return;
   }
+  auto const was_full = bytes_buffed_size_ == capacity_;
   bytes_buffed_size_ -= len;
   bytes_pop_size_ += len;
+  wake_writer();
 
+  if ( backend_ == Backend::Ring ) {
+    ring_head_ = ( ring_head_ + len ) % capacity_;
+  } else {
+    pop_buffers( len );
+  }
+  if ( was_full ) {
+    writable_hook_(); // 从满变成有空间
+  }
+}
+
+void ByteStream::pop_buffers( uint64_t len ) noexcept
+{
   while ( 0 < len ) {
     if ( buffer_view_.size() <= len ) {
       len -= buffer_view_.size();
-      buffer_.pop();
-      buffer_view_ = buffer_.front();
+      buffer_[buffer_head_++] = Buffer {};
+      buffer_view_ = buffer_head_ == buffer_.size() ? string_view {} : buffer_[buffer_head_];
     } else {
       buffer_view_.remove_prefix( len );
       len = 0;
     }
   }
-  return;
+
+  // 读空就从头复用；已弹出的前缀占到一半以上时整体前移，摊还 O(1)
+  if ( buffer_head_ == buffer_.size() ) {
+    buffer_.clear();
+    buffer_head_ = 0;
+  } else if ( buffer_head_ * 2 >= buffer_.size() ) {
+    buffer_.erase( buffer_.begin(), buffer_.begin() + static_cast<ptrdiff_t>( buffer_head_ ) );
+    buffer_head_ = 0;
+  }
 }
 
 uint64_t Reader::bytes_buffered() const noexcept
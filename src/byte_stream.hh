@@ -1,17 +1,32 @@
 #pragma once
 
-#include <queue>
+#include "buffer.hh"
+#include "task.hh"
+
+#include <coroutine>
+#include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 class Reader;
 class Writer;
+class Parser;
+class Serializer;
 
 class ByteStream
 {
 public:
-  explicit ByteStream( uint64_t capacity );
+  // How the buffered bytes are stored
+  enum class Backend
+  {
+    Queue, // one string per push, moved in as-is
+    Ring,  // a single contiguous ring of `capacity` bytes, allocated on the first push
+  };
+
+  explicit ByteStream( uint64_t capacity, Backend backend = Backend::Queue );
 
   // Helper functions (provided) to access the ByteStream's Reader and Writer interfaces
   Reader& reader();
@@ -19,8 +34,61 @@ public:
   Writer& writer();
   const Writer& writer() const;
 
+  // Give back the storage an empty stream still holds (the Queue's slots, the Ring's bytes). It is
+  // allocated again on the next push, so an idle stream costs only the ByteStream object itself.
+  void release_memory();
+
+  // Save the stream's state (capacity, counters, whether it is closed or has had an error, and the
+  // buffered bytes) so that restore() can bring it back, e.g. in a new process after a restart.
+  // restore() replaces everything but the backend and the hooks, and runs no hooks. The bytes it
+  // restores into a Queue stream share the Parser's input (a mapped checkpoint file, say).
+  void checkpoint( Serializer& out ) const;
+  void restore( Parser& in );
+
+  // Edge-triggered readiness hooks, for an owner that wants to act when the stream changes state
+  // instead of polling it. The readable hook runs when a push puts bytes into an empty stream, and
+  // on close() and set_error(); the writable hook when a pop (or a larger capacity) makes room in a
+  // full stream, and on set_error(). A hook is a function pointer and its context, so setting one
+  // allocates nothing and a stream without hooks pays one branch. It runs once the stream's state
+  // has changed, and may push, pop or close. Hooks belong to whoever set them: a copied or moved
+  // stream does not take them along. nullptr clears a hook.
+  using Hook = void ( * )( void* context );
+  void set_readable_hook( Hook hook, void* context ) noexcept
+  {
+    readable_hook_.hook = hook;
+    readable_hook_.context = context;
+  }
+  void set_writable_hook( Hook hook, void* context ) noexcept
+  {
+    writable_hook_.hook = hook;
+    writable_hook_.context = context;
+  }
+
+  // What Reader::readable() and Writer::writable() return: co_await it in a Task to wait until the
+  // stream is ready. The waiting coroutine is woken (Task::wake()) by the push, pop, close or
+  // set_error() that makes it ready. One coroutine at a time may wait on each side.
+  class Wait
+  {
+  public:
+    Wait( ByteStream& stream, bool writer, uint64_t wants ) : stream_( stream ), writer_( writer ), wants_( wants ) {}
+    ~Wait();
+    Wait( const Wait& other ) = delete;
+    Wait& operator=( const Wait& other ) = delete;
+
+    bool await_ready() const noexcept;
+    void await_suspend( std::coroutine_handle<> coroutine ) noexcept;
+    bool await_resume() const noexcept;
+
+  private:
+    ByteStream& stream_;
+    bool writer_;
+    uint64_t wants_;
+    std::coroutine_handle<> waiting_ {};
+  };
+
 protected:
-  std::queue<std::string> buffer_ {};
+  std::vector<Buffer> buffer_ {}; // Queue backend: the pushed Buffers from buffer_head_ on
+  size_t buffer_head_ {};
   uint64_t capacity_;
   uint64_t bytes_push_size_ {};
   uint64_t bytes_buffed_size_ {};
@@ -28,6 +96,47 @@ protected:
   bool is_closed_ { false };
   bool has_error_ { false };
   std::string_view buffer_view_ {};
+  Backend backend_;
+  std::string ring_ {};   // storage for the Ring backend (capacity_ bytes, or fewer right after restore())
+  uint64_t ring_head_ {}; // offset in ring_ of the next byte to be popped
+
+  void ring_write( std::string_view data ) noexcept; // copy as much of `data` as fits into the ring
+  void pop_buffers( uint64_t len ) noexcept;         // Queue backend: drop `len` bytes from the front Buffers
+
+  // 就绪回调：复制或移动流的时候不带过去，赋值也不覆盖（回调属于设置它的那个对象）
+  struct HookSlot
+  {
+    Hook hook {};
+    void* context {};
+    HookSlot() = default;
+    HookSlot( const HookSlot& /* other */ ) noexcept {}
+    HookSlot& operator=( const HookSlot& /* other */ ) noexcept { return *this; }
+    void operator()() const
+    {
+      if ( hook != nullptr ) {
+        hook( context );
+      }
+    }
+  };
+  HookSlot readable_hook_ {};
+  HookSlot writable_hook_ {};
+
+  std::coroutine_handle<> reader_waiting_ {}; // 等着有字节可读（或者结束、出错）的协程
+  std::coroutine_handle<> writer_waiting_ {}; // 等着空出 writer_wants_ 字节的协程
+  uint64_t writer_wants_ {};
+
+  void wake_reader() noexcept
+  {
+    if ( reader_waiting_ ) {
+      Task::wake( std::exchange( reader_waiting_, {} ) );
+    }
+  }
+  void wake_writer() noexcept
+  {
+    if ( writer_waiting_ and ( capacity_ - bytes_buffed_size_ >= writer_wants_ or has_error_ ) ) {
+      Task::wake( std::exchange( writer_waiting_, {} ) );
+    }
+  }
   // Please add any additional state to the ByteStream here, and not to the Writer and Reader interfaces.
 };
 
@@ -35,6 +144,12 @@ class Writer : public ByteStream
 {
 public:
   void push( std::string data ) noexcept; // Push data to stream, but only as much as available capacity allows.
+  void push( Buffer data ) noexcept;      // Same, but shares the Buffer's storage instead of moving bytes
+
+  // Same, but copies just the bytes that fit, and nothing is allocated for the rest (the Ring backend copies
+  // straight into the ring). The const char* overload keeps push( "literal" ) unambiguous.
+  void push( std::string_view data ) noexcept;
+  void push( const char* data ) noexcept { push( std::string_view { data } ); }
 
   void close() noexcept;     // Signal that the stream has reached its ending. Nothing more will be written.
   void set_error() noexcept; // Signal that the stream suffered an error.
@@ -42,6 +157,14 @@ public:
   bool is_closed() const noexcept;              // Has the stream been closed?
   uint64_t available_capacity() const noexcept; // How many bytes can be pushed to the stream right now?
   uint64_t bytes_pushed() const noexcept;       // Total number of bytes cumulatively pushed to the stream
+
+  uint64_t capacity() const noexcept; // Most bytes the stream buffers at once
+  // Change the capacity (never below the bytes already buffered; the Ring backend reallocates)
+  void set_capacity( uint64_t capacity );
+
+  // co_await in a Task: wait until `n` bytes (at most the capacity) can be pushed. The result is
+  // false if the stream has had an error (or the writer has closed it) instead.
+  Wait writable( uint64_t n = 1 ) noexcept { return { *this, true, n }; }
 };
 
 class Reader : public ByteStream
@@ -50,11 +173,26 @@ public:
   std::string_view peek() const noexcept; // Peek at the next bytes in the buffer
   void pop( uint64_t len ) noexcept;      // Remove `len` bytes from the buffer
 
+  // Fill `out` with views that together cover every buffered byte, in order (e.g. for one writev() call)
+  void peek_all( std::vector<std::string_view>& out ) const;
+
+  // Copy up to out.size() bytes into `out` and pop them, with one memcpy per contiguous region of the
+  // stream. Returns how many bytes were copied.
+  uint64_t read_into( std::span<char> out ) noexcept;
+
+  // The bytes peek() would return, as a Buffer. Shares storage with the pushed Buffer (Queue backend).
+  Buffer peek_buffer() const;
+
   bool is_finished() const noexcept; // Is the stream finished (closed and fully popped)?
+  bool is_closed() const noexcept;   // Has the writer closed the stream? (Bytes may still be buffered.)
   bool has_error() const noexcept;   // Has the stream had an error?
 
   uint64_t bytes_buffered() const noexcept; // Number of bytes currently buffered (pushed and not popped)
   uint64_t bytes_popped() const noexcept;   // Total number of bytes cumulatively popped from stream
+
+  // co_await in a Task: wait until there are bytes to read, or the stream is finished or has had an
+  // error. The result is whether there are bytes to read.
+  Wait readable() noexcept { return { *this, false, 1 }; }
 };
 
 /*
@@ -62,3 +200,15 @@ public:
  * from a ByteStream Reader into a string;
  */
 void read( Reader& reader, uint64_t len, std::string& out );
+
+/*
+ * read: Same as above, but hands out slices of the stream's own Buffers
+ * instead of concatenating into one string.
+ */
+void read( Reader& reader, uint64_t len, std::vector<Buffer>& out );
+
+/*
+ * read: Same as above, but into one Buffer. Shares the stream's storage when
+ * the bytes come from a single pushed chunk; otherwise they are concatenated.
+ */
+void read( Reader& reader, uint64_t len, Buffer& out );
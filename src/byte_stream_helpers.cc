@@ -1,5 +1,6 @@
 #include "byte_stream.hh"
 
+#include <algorithm>
 #include <cstdint>
 #include <stdexcept>
 
@@ -8,22 +9,54 @@
  * from a ByteStream Reader into a string;
  */
 void read( Reader& reader, uint64_t len, std::string& out )
+{
+  out.resize( std::min( len, reader.bytes_buffered() ) ); // sized once, not grown chunk by chunk
+  out.resize( reader.read_into( out ) );
+}
+
+/*
+ * read: A helper function thats peeks and pops up to `len` bytes
+ * from a ByteStream Reader, as slices of the stream's own Buffers where possible;
+ */
+void read( Reader& reader, uint64_t len, std::vector<Buffer>& out )
 {
   out.clear();
 
-  while ( reader.bytes_buffered() and out.size() < len ) {
-    auto view = reader.peek();
+  uint64_t total = 0;
+  while ( reader.bytes_buffered() and total < len ) {
+    auto buffer = reader.peek_buffer();
 
-    if ( view.empty() ) {
-      throw std::runtime_error( "Reader::peek() returned empty string_view" );
+    if ( buffer.empty() ) {
+      throw std::runtime_error( "Reader::peek_buffer() returned empty Buffer" );
     }
 
-    view = view.substr( 0, len - out.size() ); // Don't return more bytes than desired.
-    out += view;
-    reader.pop( view.size() );
+    if ( buffer.size() > len - total ) {
+      buffer = buffer.substr( 0, len - total );
+    }
+    total += buffer.size();
+    reader.pop( buffer.size() );
+    out.push_back( std::move( buffer ) );
   }
 }
 
+/*
+ * read: A helper function thats peeks and pops up to `len` bytes
+ * from a ByteStream Reader into one Buffer, sharing storage when it can;
+ */
+void read( Reader& reader, uint64_t len, Buffer& out )
+{
+  auto buffer = reader.peek_buffer();
+  if ( buffer.size() < len && buffer.size() < reader.bytes_buffered() ) {
+    std::string data;
+    read( reader, len, data );
+    out = Buffer { std::move( data ) };
+    return;
+  }
+
+  out = buffer.substr( 0, len );
+  reader.pop( out.size() );
+}
+
 Reader& ByteStream::reader()
 {
   static_assert( sizeof( Reader ) == sizeof( ByteStream ),
@@ -0,0 +1,218 @@
+#include "congestion_control.hh"
+#include "parser.hh"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+// RFC 5681 3.1：初始窗口 IW = min( 4 * SMSS, max( 2 * SMSS, 4380 bytes ) )
+uint64_t initial_window( uint64_t mss )
+{
+  return min( 4 * mss, max<uint64_t>( 2 * mss, 4380 ) );
+}
+
+// RFC 3465：慢启动时每个 ACK 最多按 L = 2 * SMSS 增长
+constexpr uint64_t ABC_LIMIT = 2;
+
+// checkpoint 的格式：字数，然后是各个字
+template<size_t N>
+void write_words( Serializer& out, const array<uint64_t, N>& words )
+{
+  out.integer( static_cast<uint8_t>( N ) );
+  for ( auto const word : words ) {
+    out.integer( word );
+  }
+}
+
+// 字数对不上（不是这个算法存下来的）就让 Parser 出错
+template<size_t N>
+bool read_words( Parser& in, array<uint64_t, N>& words )
+{
+  uint8_t count {};
+  in.integer( count );
+  if ( count != N ) {
+    in.set_error();
+  }
+  for ( auto& word : words ) {
+    in.integer( word );
+  }
+  return not in.has_error();
+}
+
+// 丢包 epoch 的起点存成距今多久（加一，0 表示没有），恢复时按新的时钟换算回来
+uint64_t epoch_age( optional<uint64_t> epoch_start_ms, uint64_t now_ms )
+{
+  return epoch_start_ms.has_value() ? now_ms - min( *epoch_start_ms, now_ms ) + 1 : 0;
+}
+
+optional<uint64_t> epoch_start( uint64_t age, uint64_t now_ms )
+{
+  if ( age == 0 ) {
+    return {};
+  }
+  return now_ms - min( age - 1, now_ms );
+}
+} // namespace
+
+void CongestionControl::skip( Parser& in )
+{
+  uint8_t count {};
+  in.integer( count );
+  if ( not in.has_error() ) {
+    in.remove_prefix( count * sizeof( uint64_t ) );
+  }
+}
+
+unique_ptr<CongestionControl> CongestionControl::make( const TCPConfig& config )
+{
+  switch ( config.congestion_control ) {
+    case TCPConfig::CongestionAlgorithm::Reno:
+      return make_unique<RenoCongestionControl>( config.mss );
+    case TCPConfig::CongestionAlgorithm::Cubic:
+      return make_unique<CubicCongestionControl>( config.mss );
+    case TCPConfig::CongestionAlgorithm::None:
+      break;
+  }
+  return nullptr;
+}
+
+RenoCongestionControl::RenoCongestionControl( uint64_t mss ) : mss_( mss ), cwnd_( initial_window( mss ) ) {}
+
+void RenoCongestionControl::on_ack( uint64_t acked, uint64_t /* now_ms */, optional<uint64_t> /* rtt_ms */ )
+{
+  if ( cwnd_ < ssthresh_ ) {
+    cwnd_ += min( acked, ABC_LIMIT * mss_ );
+    return;
+  }
+  // 拥塞避免：每确认一个 cwnd 的数据增长一个 MSS
+  bytes_acked_ += acked;
+  if ( bytes_acked_ >= cwnd_ ) {
+    bytes_acked_ -= cwnd_;
+    cwnd_ += mss_;
+  }
+}
+
+void RenoCongestionControl::on_fast_retransmit( uint64_t in_flight, uint64_t /* now_ms */ )
+{
+  ssthresh_ = max( in_flight / 2, 2 * mss_ );
+  cwnd_ = ssthresh_;
+  bytes_acked_ = 0;
+}
+
+void RenoCongestionControl::on_timeout( uint64_t in_flight, uint64_t /* now_ms */ )
+{
+  ssthresh_ = max( in_flight / 2, 2 * mss_ );
+  cwnd_ = mss_;
+  bytes_acked_ = 0;
+}
+
+void RenoCongestionControl::checkpoint( Serializer& out, uint64_t /* now_ms */ ) const
+{
+  write_words( out, array { cwnd_, ssthresh_, bytes_acked_ } );
+}
+
+void RenoCongestionControl::restore( Parser& in, uint64_t /* now_ms */ )
+{
+  array<uint64_t, 3> words {};
+  if ( read_words( in, words ) ) {
+    cwnd_ = words[0];
+    ssthresh_ = words[1];
+    bytes_acked_ = words[2];
+  }
+}
+
+CubicCongestionControl::CubicCongestionControl( uint64_t mss )
+  : mss_( static_cast<double>( mss ) )
+  , cwnd_( static_cast<double>( initial_window( mss ) ) / mss_ )
+  , ssthresh_( HUGE_VAL )
+{}
+
+uint64_t CubicCongestionControl::cwnd() const
+{
+  return static_cast<uint64_t>( cwnd_ * mss_ );
+}
+
+/**
+ * RFC 9438 4.2 - 4.4：
+ * W_cubic( t ) = C * ( t - K )^3 + W_max，K = cbrt( W_max * ( 1 - BETA ) / C )
+ * W_est 按 Reno 的 AIMD（alpha = 3 * ( 1 - BETA ) / ( 1 + BETA )）增长，cwnd 取两者中较大的目标
+ */
+void CubicCongestionControl::on_ack( uint64_t acked, uint64_t now_ms, optional<uint64_t> rtt_ms )
+{
+  auto const segments = static_cast<double>( acked ) / mss_;
+  if ( cwnd_ < ssthresh_ ) {
+    cwnd_ += min( segments, static_cast<double>( ABC_LIMIT ) );
+    return;
+  }
+
+  if ( !epoch_start_ms_.has_value() ) {
+    epoch_start_ms_ = now_ms;
+    if ( cwnd_ < w_max_ ) {
+      k_s_ = cbrt( ( w_max_ - cwnd_ ) / C );
+    } else {
+      k_s_ = 0;
+      w_max_ = cwnd_;
+    }
+    w_est_ = cwnd_;
+  }
+
+  auto const t_s = static_cast<double>( now_ms - *epoch_start_ms_ + rtt_ms.value_or( 0 ) ) / 1000;
+  auto const w_cubic = clamp( C * pow( t_s - k_s_, 3 ) + w_max_, cwnd_, 1.5 * cwnd_ );
+
+  constexpr double alpha = 3 * ( 1 - BETA ) / ( 1 + BETA );
+  w_est_ += alpha * segments / cwnd_;
+
+  auto const target = max( w_cubic, w_est_ );
+  if ( target > cwnd_ ) {
+    cwnd_ += ( target - cwnd_ ) / cwnd_ * segments;
+  }
+}
+
+void CubicCongestionControl::reduce()
+{
+  epoch_start_ms_.reset();
+  // 快速收敛：比上次丢包时的窗口还小，说明有新的流加入，让出更多带宽
+  w_max_ = cwnd_ < w_max_ ? cwnd_ * ( 1 + BETA ) / 2 : cwnd_;
+  ssthresh_ = max( cwnd_ * BETA, 2.0 );
+}
+
+void CubicCongestionControl::on_fast_retransmit( uint64_t /* in_flight */, uint64_t /* now_ms */ )
+{
+  reduce();
+  cwnd_ = ssthresh_;
+}
+
+void CubicCongestionControl::on_timeout( uint64_t /* in_flight */, uint64_t /* now_ms */ )
+{
+  reduce();
+  cwnd_ = 1;
+}
+
+// 浮点数按位存
+void CubicCongestionControl::checkpoint( Serializer& out, uint64_t now_ms ) const
+{
+  write_words( out,
+               array { bit_cast<uint64_t>( cwnd_ ),
+                       bit_cast<uint64_t>( ssthresh_ ),
+                       bit_cast<uint64_t>( w_max_ ),
+                       bit_cast<uint64_t>( w_est_ ),
+                       bit_cast<uint64_t>( k_s_ ),
+                       epoch_age( epoch_start_ms_, now_ms ) } );
+}
+
+void CubicCongestionControl::restore( Parser& in, uint64_t now_ms )
+{
+  array<uint64_t, 6> words {};
+  if ( read_words( in, words ) ) {
+    cwnd_ = bit_cast<double>( words[0] );
+    ssthresh_ = bit_cast<double>( words[1] );
+    w_max_ = bit_cast<double>( words[2] );
+    w_est_ = bit_cast<double>( words[3] );
+    k_s_ = bit_cast<double>( words[4] );
+    epoch_start_ms_ = epoch_start( words[5], now_ms );
+  }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "tcp_config.hh"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+class Parser;
+class Serializer;
+
+// A congestion-control algorithm for TCPSender. The sender never has more than cwnd()
+// sequence numbers in flight (nor more than the peer's window), and tells the algorithm
+// about every ACK that advances and every loss it detects.
+class CongestionControl
+{
+public:
+  virtual ~CongestionControl() = default;
+
+  // Congestion window, in sequence numbers
+  virtual uint64_t cwnd() const = 0;
+
+  // `acked` sequence numbers were newly acknowledged; `rtt_ms` is the smoothed RTT, if known
+  virtual void on_ack( uint64_t acked, uint64_t now_ms, std::optional<uint64_t> rtt_ms ) = 0;
+
+  // A segment was retransmitted after duplicate ACKs; `in_flight` sequence numbers were outstanding
+  virtual void on_fast_retransmit( uint64_t in_flight, uint64_t now_ms ) = 0;
+
+  // The retransmission timer expired; `in_flight` sequence numbers were outstanding
+  virtual void on_timeout( uint64_t in_flight, uint64_t now_ms ) = 0;
+
+  // Which algorithm this is
+  virtual TCPConfig::CongestionAlgorithm algorithm() const = 0;
+
+  // Save the algorithm's state (as a count and that many 64-bit words, with times relative to
+  // `now_ms`) and bring it back, e.g. in a new process. restore() fails the Parser if the words are
+  // not this algorithm's; skip() passes over a saved state without restoring it.
+  virtual void checkpoint( Serializer& out, uint64_t now_ms ) const = 0;
+  virtual void restore( Parser& in, uint64_t now_ms ) = 0;
+  static void skip( Parser& in );
+
+  // Make the algorithm chosen by `config.congestion_control` (nullptr for None)
+  static std::unique_ptr<CongestionControl> make( const TCPConfig& config );
+};
+
+// RFC 5681: slow start, then one MSS per window of ACKed data. Halve on fast retransmit,
+// collapse to one MSS on timeout.
+class RenoCongestionControl : public CongestionControl
+{
+public:
+  explicit RenoCongestionControl( uint64_t mss );
+
+  uint64_t cwnd() const override { return cwnd_; }
+  void on_ack( uint64_t acked, uint64_t now_ms, std::optional<uint64_t> rtt_ms ) override;
+  void on_fast_retransmit( uint64_t in_flight, uint64_t now_ms ) override;
+  void on_timeout( uint64_t in_flight, uint64_t now_ms ) override;
+
+  TCPConfig::CongestionAlgorithm algorithm() const override { return TCPConfig::CongestionAlgorithm::Reno; }
+  void checkpoint( Serializer& out, uint64_t now_ms ) const override;
+  void restore( Parser& in, uint64_t now_ms ) override;
+
+  uint64_t ssthresh() const { return ssthresh_; }
+
+private:
+  uint64_t mss_;
+  uint64_t cwnd_;
+  uint64_t ssthresh_ { UINT64_MAX };
+  uint64_t bytes_acked_ {}; // ACKed during congestion avoidance since cwnd last grew
+};
+
+// RFC 9438 CUBIC: after a loss the window grows along a cubic curve that flattens near the
+// window where the loss happened (W_max), then probes beyond it. Never grows slower than Reno.
+class CubicCongestionControl : public CongestionControl
+{
+public:
+  explicit CubicCongestionControl( uint64_t mss );
+
+  uint64_t cwnd() const override;
+  void on_ack( uint64_t acked, uint64_t now_ms, std::optional<uint64_t> rtt_ms ) override;
+  void on_fast_retransmit( uint64_t in_flight, uint64_t now_ms ) override;
+  void on_timeout( uint64_t in_flight, uint64_t now_ms ) override;
+
+  TCPConfig::CongestionAlgorithm algorithm() const override { return TCPConfig::CongestionAlgorithm::Cubic; }
+  void checkpoint( Serializer& out, uint64_t now_ms ) const override;
+  void restore( Parser& in, uint64_t now_ms ) override;
+
+  static constexpr double C = 0.4;
+  static constexpr double BETA = 0.7;
+
+private:
+  void reduce(); // 丢包后：记录 W_max，乘以 BETA
+
+  double mss_;
+  double cwnd_;                      // 单位都是 MSS
+  double ssthresh_;
+  double w_max_ {};                  // 上次丢包时的窗口
+  double w_est_ {};                  // 同样条件下 Reno 会有的窗口
+  double k_s_ {};                    // 从 epoch 开始回到 W_max 需要的秒数
+  std::optional<uint64_t> epoch_start_ms_ {};
+};
@@ -0,0 +1,43 @@
+#include "connection_table.hh"
+
+#include <array>
+
+using namespace std;
+
+namespace {
+// The key from Microsoft's RSS specification, the default of most NIC drivers
+constexpr array<uint8_t, 40> RSS_KEY {
+  0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2, 0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3,
+  0x8f, 0xb0, 0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3,
+  0x80, 0x30, 0xf2, 0x0c, 0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+} // namespace
+
+// 输入按网络字节序排成 源地址、目的地址、源端口、目的端口；
+// 每个置位的输入位异或上密钥从该位开始的 32 位窗口
+uint32_t FourTuple::rss_hash() const
+{
+  const array<uint8_t, 12> input {
+    static_cast<uint8_t>( remote_ip >> 24 ), static_cast<uint8_t>( remote_ip >> 16 ),
+    static_cast<uint8_t>( remote_ip >> 8 ),  static_cast<uint8_t>( remote_ip ),
+    static_cast<uint8_t>( local_ip >> 24 ),  static_cast<uint8_t>( local_ip >> 16 ),
+    static_cast<uint8_t>( local_ip >> 8 ),   static_cast<uint8_t>( local_ip ),
+    static_cast<uint8_t>( remote_port >> 8 ), static_cast<uint8_t>( remote_port ),
+    static_cast<uint8_t>( local_port >> 8 ),  static_cast<uint8_t>( local_port ),
+  };
+
+  uint32_t result = 0;
+  uint64_t window = static_cast<uint64_t>( RSS_KEY[0] ) << 56 | static_cast<uint64_t>( RSS_KEY[1] ) << 48
+                    | static_cast<uint64_t>( RSS_KEY[2] ) << 40 | static_cast<uint64_t>( RSS_KEY[3] ) << 32
+                    | static_cast<uint64_t>( RSS_KEY[4] ) << 24;
+  for ( size_t i = 0; i < input.size(); ++i ) {
+    for ( int bit = 7; bit >= 0; --bit ) {
+      if ( input[i] >> bit & 1 ) {
+        result ^= static_cast<uint32_t>( window >> 32 );
+      }
+      window <<= 1;
+    }
+    window |= static_cast<uint64_t>( RSS_KEY[i + 5] ) << 24;
+  }
+  return result;
+}
@@ -0,0 +1,298 @@
+#pragma once
+
+#include "ipv4_header.hh"
+#include "tcp_segment.hh"
+#include "tcp_sender_message.hh"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <utility>
+#include <vector>
+
+// A TCP connection's addresses and ports, from this host's point of view
+struct FourTuple
+{
+  uint32_t local_ip {};
+  uint32_t remote_ip {};
+  uint16_t local_port {};
+  uint16_t remote_port {};
+
+  bool operator==( const FourTuple& other ) const = default;
+
+  // The connection an incoming segment belongs to (the datagram's destination is the local end)
+  static FourTuple incoming( const IPv4Header& header, const TCPSegment& segment )
+  {
+    return { header.dst, header.src, segment.dst_port, segment.src_port };
+  }
+
+  // A cheap, well-mixed hash for the table itself
+  uint64_t hash() const
+  {
+    uint64_t h = ( static_cast<uint64_t>( local_ip ) << 32 | remote_ip ) * 0x9e3779b97f4a7c15ULL;
+    h ^= static_cast<uint64_t>( local_port ) << 16 | remote_port;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  // The Toeplitz hash a NIC's receive-side scaling computes for this connection's incoming
+  // segments (source = remote, destination = local), with the usual default key. Sharding by it
+  // puts each connection on the core whose receive queue the NIC steers it to.
+  uint32_t rss_hash() const;
+};
+
+// Connection state (Value, e.g. a TCPPeer) for many connections, found by 4-tuple.
+//
+// Open addressing over 64-byte buckets, one cache line each. A bucket holds up to SLOTS entries as
+// an 8-bit tag (a slice of the hash) and an index into a dense array of entries; a lookup compares
+// the tags of one bucket and touches an entry only when a tag matches. Buckets are probed linearly;
+// each counts the entries that overflowed past it, so a lookup stops at the first bucket with no
+// overflow, and erasing never leaves tombstones. The table doubles once it is 7/8 full.
+//
+// Entries are kept dense (erase() moves the last entry into the hole), so memory is proportional
+// to the connections actually open. Inserting or erasing may move entries: pointers and
+// references returned earlier are invalidated by any later insert or erase.
+//
+// Alongside, a bounded SYN backlog holds SYNs for connections that do not exist yet, for the
+// application to accept (or ignore) in arrival order.
+template<typename Value>
+class ConnectionTable
+{
+public:
+  static constexpr size_t DEFAULT_BACKLOG = 128;
+
+  explicit ConnectionTable( size_t backlog_limit = DEFAULT_BACKLOG ) : backlog_limit_( backlog_limit ) {}
+
+  // The value for `key`, or nullptr
+  Value* find( const FourTuple& key )
+  {
+    auto const index = locate( key, key.hash() );
+    return index.has_value() ? &entries_[*index].value : nullptr;
+  }
+  const Value* find( const FourTuple& key ) const { return const_cast<ConnectionTable*>( this )->find( key ); }
+
+  // The value for `key`, default-constructed if it was not there
+  Value& find_or_insert( const FourTuple& key )
+  {
+    auto const h = key.hash();
+    if ( auto const index = locate( key, h ) ) {
+      return entries_[*index].value;
+    }
+    if ( ( entries_.size() + 1 ) * 8 > buckets_.size() * Bucket::SLOTS * 7 ) {
+      rehash( buckets_.size() * 2 );
+    }
+    entries_.push_back( { key, Value {} } );
+    place( h, static_cast<uint32_t>( entries_.size() - 1 ) );
+    return entries_.back().value;
+  }
+
+  // Remove `key` (if present)
+  void erase( const FourTuple& key )
+  {
+    auto const h = key.hash();
+    auto const index = locate( key, h );
+    if ( !index.has_value() ) {
+      return;
+    }
+    unplace( h, *index );
+    auto const last = static_cast<uint32_t>( entries_.size() - 1 );
+    if ( *index != last ) {
+      // 最后一个表项挪进空位，并改掉指向它的那个槽
+      retarget( entries_[last].key.hash(), last, *index );
+      entries_[*index] = std::move( entries_[last] );
+    }
+    entries_.pop_back();
+  }
+
+  size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+
+  // Call f( key, value ) for every connection
+  template<typename F>
+  void for_each( F&& f )
+  {
+    for ( auto& entry : entries_ ) {
+      f( std::as_const( entry.key ), entry.value );
+    }
+  }
+
+  // Queue a SYN for a connection not in the table. False (and the SYN is dropped) if the backlog is full.
+  bool push_syn( const FourTuple& key, TCPSenderMessage syn )
+  {
+    if ( backlog_.size() >= backlog_limit_ ) {
+      ++syns_dropped_;
+      return false;
+    }
+    backlog_.push_back( { key, std::move( syn ) } );
+    return true;
+  }
+
+  // The oldest queued SYN, if any
+  std::optional<std::pair<FourTuple, TCPSenderMessage>> pop_syn()
+  {
+    if ( backlog_.empty() ) {
+      return {};
+    }
+    auto syn = std::move( backlog_.front() );
+    backlog_.pop_front();
+    return syn;
+  }
+
+  size_t backlog() const { return backlog_.size(); }
+  uint64_t syns_dropped() const { return syns_dropped_; }
+
+private:
+  struct Entry
+  {
+    FourTuple key;
+    Value value;
+  };
+
+  struct alignas( 64 ) Bucket
+  {
+    static constexpr size_t SLOTS = 12;
+
+    std::array<uint32_t, SLOTS> index {};
+    std::array<uint8_t, SLOTS> tag {}; // 0：空槽
+    uint8_t overflow {};               // 探测时越过这个桶的表项数（饱和在 255，之后只是多探测几个桶）
+
+    // 标签等于 `wanted` 的槽，一位一个槽：12 个标签当两个整数一起比较（SWAR）
+    uint32_t match( uint8_t wanted ) const
+    {
+      uint64_t low {};
+      uint32_t high {};
+      std::memcpy( &low, tag.data(), sizeof( low ) );
+      std::memcpy( &high, tag.data() + sizeof( low ), sizeof( high ) );
+      return match_bytes( low ^ ( wanted * 0x0101010101010101ULL ) )
+             | ( match_bytes( high ^ ( wanted * 0x01010101ULL ) ) & 0xfU ) << 8;
+    }
+
+    // 为 0 的字节各取一位（标签最高位总是 1，不会误报）
+    static uint32_t match_bytes( uint64_t x )
+    {
+      uint64_t const zero = ~( ( ( x & 0x7f7f7f7f7f7f7f7fULL ) + 0x7f7f7f7f7f7f7f7fULL ) | x | 0x7f7f7f7f7f7f7f7fULL );
+      // 每个字节的最高位收拢到低 8 位
+      return static_cast<uint32_t>( ( ( zero >> 7 ) * 0x0102040810204080ULL ) >> 56 );
+    }
+  };
+  static_assert( sizeof( Bucket ) == 64 );
+
+  static constexpr size_t INITIAL_BUCKETS = 4;
+
+  // 低位选桶，最高 7 位做标签（最高位置 1，所以非零）
+  size_t home( uint64_t h ) const { return h & ( buckets_.size() - 1 ); }
+  static uint8_t tag_of( uint64_t h ) { return static_cast<uint8_t>( h >> 57 ) | 0x80; }
+  size_t next( size_t bucket ) const { return ( bucket + 1 ) & ( buckets_.size() - 1 ); }
+
+  std::optional<uint32_t> locate( const FourTuple& key, uint64_t h ) const
+  {
+    auto const tag = tag_of( h );
+    for ( size_t b = home( h );; b = next( b ) ) {
+      const Bucket& bucket = buckets_[b];
+      for ( auto matches = bucket.match( tag ); matches != 0; matches &= matches - 1 ) {
+        auto const s = static_cast<size_t>( std::countr_zero( matches ) );
+        if ( entries_[bucket.index[s]].key == key ) {
+          return bucket.index[s];
+        }
+      }
+      if ( bucket.overflow == 0 ) {
+        return {};
+      }
+    }
+  }
+
+  void place( uint64_t h, uint32_t index )
+  {
+    for ( size_t b = home( h );; b = next( b ) ) {
+      Bucket& bucket = buckets_[b];
+      for ( size_t s = 0; s < Bucket::SLOTS; ++s ) {
+        if ( bucket.tag[s] == 0 ) {
+          bucket.tag[s] = tag_of( h );
+          bucket.index[s] = index;
+          return;
+        }
+      }
+      if ( bucket.overflow < UINT8_MAX ) {
+        ++bucket.overflow;
+      }
+    }
+  }
+
+  void unplace( uint64_t h, uint32_t index )
+  {
+    for ( size_t b = home( h );; b = next( b ) ) {
+      Bucket& bucket = buckets_[b];
+      for ( size_t s = 0; s < Bucket::SLOTS; ++s ) {
+        if ( bucket.tag[s] != 0 && bucket.index[s] == index ) {
+          bucket.tag[s] = 0;
+          return;
+        }
+      }
+      if ( bucket.overflow > 0 && bucket.overflow < UINT8_MAX ) {
+        --bucket.overflow;
+      }
+    }
+  }
+
+  void retarget( uint64_t h, uint32_t from, uint32_t to )
+  {
+    for ( size_t b = home( h );; b = next( b ) ) {
+      Bucket& bucket = buckets_[b];
+      for ( size_t s = 0; s < Bucket::SLOTS; ++s ) {
+        if ( bucket.tag[s] != 0 && bucket.index[s] == from ) {
+          bucket.index[s] = to;
+          return;
+        }
+      }
+    }
+  }
+
+  void rehash( size_t num_buckets )
+  {
+    buckets_.assign( num_buckets, Bucket {} );
+    for ( uint32_t i = 0; i < entries_.size(); ++i ) {
+      place( entries_[i].key.hash(), i );
+    }
+  }
+
+  std::vector<Bucket> buckets_ = std::vector<Bucket>( INITIAL_BUCKETS );
+  std::vector<Entry> entries_ {};
+
+  size_t backlog_limit_;
+  std::deque<std::pair<FourTuple, TCPSenderMessage>> backlog_ {};
+  uint64_t syns_dropped_ {};
+};
+
+// One ConnectionTable per core, chosen by the RSS hash: the thread that polls receive queue i
+// owns shard i alone, so no shard needs a lock.
+template<typename Value>
+class ShardedConnectionTable
+{
+public:
+  explicit ShardedConnectionTable( size_t num_shards,
+                                   size_t backlog_limit = ConnectionTable<Value>::DEFAULT_BACKLOG )
+    : shards_( num_shards, ConnectionTable<Value> { backlog_limit } )
+  {}
+
+  // The shard that owns `key` (the same for every segment of the connection)
+  size_t shard_of( const FourTuple& key ) const { return shard_of_hash( key.rss_hash() ); }
+
+  // Same, from the hash the NIC reported with the packet
+  size_t shard_of_hash( uint32_t rss_hash ) const
+  {
+    return static_cast<size_t>( ( static_cast<uint64_t>( rss_hash ) * shards_.size() ) >> 32 );
+  }
+
+  ConnectionTable<Value>& shard( size_t i ) { return shards_.at( i ); }
+  ConnectionTable<Value>& shard_for( const FourTuple& key ) { return shards_[shard_of( key )]; }
+  size_t num_shards() const { return shards_.size(); }
+
+private:
+  std::vector<ConnectionTable<Value>> shards_;
+};
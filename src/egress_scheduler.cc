@@ -0,0 +1,183 @@
+#include "egress_scheduler.hh"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+size_t frame_bytes( const EthernetFrame& frame )
+{
+  size_t size = EthernetHeader::LENGTH;
+  for ( const auto& buffer : frame.payload ) {
+    size += buffer.size();
+  }
+  return size;
+}
+} // namespace
+
+EgressQueue::EgressQueue( size_t limit_bytes, uint64_t codel_target_ms, uint64_t codel_interval_ms )
+  : limit_bytes_( limit_bytes ), target_ms_( codel_target_ms ), interval_ms_( max<uint64_t>( codel_interval_ms, 1 ) )
+{}
+
+bool EgressQueue::push( EthernetFrame&& frame, size_t bytes, uint64_t now_ms )
+{
+  if ( bytes > limit_bytes_ || bytes_ > limit_bytes_ - bytes ) {
+    return false;
+  }
+  bytes_ += bytes;
+  max_frame_bytes_ = max( max_frame_bytes_, bytes );
+  frames_.push_back( { std::move( frame ), bytes, now_ms } );
+  return true;
+}
+
+EgressQueue::Entry EgressQueue::take( uint64_t now_ms, bool& ok_to_drop )
+{
+  Entry entry = std::move( frames_.front() );
+  frames_.pop_front();
+  bytes_ -= entry.bytes;
+
+  // 没开 CoDel，排队时间低于 target，或者队列里剩下的不到一个帧：没有积压
+  ok_to_drop = false;
+  if ( target_ms_ == 0 || now_ms - entry.enqueued_ms < target_ms_ || bytes_ <= max_frame_bytes_ ) {
+    first_above_ms_ = 0;
+  } else if ( first_above_ms_ == 0 ) {
+    first_above_ms_ = now_ms + interval_ms_;
+  } else if ( now_ms >= first_above_ms_ ) {
+    ok_to_drop = true;
+  }
+  return entry;
+}
+
+uint64_t EgressQueue::control_law( uint64_t t ) const
+{
+  auto const gap = static_cast<double>( interval_ms_ ) / sqrt( static_cast<double>( max<uint64_t>( count_, 1 ) ) );
+  return t + max<uint64_t>( static_cast<uint64_t>( gap ), 1 );
+}
+
+/**
+ * RFC 8289 的 dequeue：排队时间超过 target 持续了一个 interval 就进入丢包状态，
+ * 每次丢包后下一次丢包的间隔是 interval / sqrt(count)；排队时间回到 target 以下就退出。
+ * 刚退出又很快重新进入时，count 从上次的值接着算，不从 1 开始
+ */
+optional<EthernetFrame> EgressQueue::pop( uint64_t now_ms, uint64_t& dropped )
+{
+  if ( frames_.empty() ) {
+    dropping_ = false;
+    return {};
+  }
+  bool ok_to_drop = false;
+  Entry entry = take( now_ms, ok_to_drop );
+  if ( dropping_ ) {
+    if ( !ok_to_drop ) {
+      dropping_ = false;
+    }
+    while ( dropping_ && now_ms >= drop_next_ms_ ) {
+      ++dropped;
+      ++count_;
+      if ( frames_.empty() ) {
+        dropping_ = false;
+        return {};
+      }
+      entry = take( now_ms, ok_to_drop );
+      if ( ok_to_drop ) {
+        drop_next_ms_ = control_law( drop_next_ms_ );
+      } else {
+        dropping_ = false;
+      }
+    }
+  } else if ( ok_to_drop ) {
+    ++dropped;
+    dropping_ = true;
+    auto const delta = count_ - last_count_;
+    count_ = delta > 1 && now_ms - drop_next_ms_ < 16 * interval_ms_ ? delta : 1;
+    drop_next_ms_ = control_law( now_ms );
+    last_count_ = count_;
+    if ( frames_.empty() ) {
+      return {};
+    }
+    entry = take( now_ms, ok_to_drop );
+  }
+  return std::move( entry.frame );
+}
+
+EgressScheduler::EgressScheduler( const NetworkInterfaceConfig& config )
+  : discipline_( config.egress )
+  , queues_( discipline_ == Discipline::Fifo ? 1 : max<size_t>( config.egress_queues, 1 ),
+             EgressQueue { config.egress_queue_bytes, config.codel_target_ms, config.codel_interval_ms } )
+  , quantum_( max<size_t>( config.egress_quantum, 1 ) )
+  , deficit_( queues_.size() )
+{}
+
+bool EgressScheduler::enqueue( EthernetFrame&& frame, uint8_t tos, uint64_t now_ms )
+{
+  // 优先级 7（最高）进 0 号队列，0 进最后一个
+  auto const precedence = static_cast<size_t>( tos >> 5 );
+  auto& queue = queues_[( 7 - precedence ) * queues_.size() / 8];
+  auto const bytes = frame_bytes( frame );
+  if ( !queue.push( std::move( frame ), bytes, now_ms ) ) {
+    ++dropped_;
+    return false;
+  }
+  ++size_;
+  return true;
+}
+
+optional<EthernetFrame> EgressScheduler::dequeue( uint64_t now_ms )
+{
+  switch ( discipline_ ) {
+    case Discipline::Priority:
+      return dequeue_priority( now_ms );
+    case Discipline::DeficitRoundRobin:
+      return dequeue_drr( now_ms );
+    case Discipline::Fifo:
+      break;
+  }
+  return pop( 0, now_ms );
+}
+
+optional<EthernetFrame> EgressScheduler::pop( size_t i, uint64_t now_ms )
+{
+  auto& queue = queues_[i];
+  auto const before = queue.size();
+  auto frame = queue.pop( now_ms, dropped_ );
+  size_ -= before - queue.size();
+  return frame;
+}
+
+optional<EthernetFrame> EgressScheduler::dequeue_priority( uint64_t now_ms )
+{
+  for ( size_t i = 0; i < queues_.size(); ++i ) {
+    // CoDel 可能把一个队列丢空，那就轮到下一个
+    if ( auto frame = pop( i, now_ms ) ) {
+      return frame;
+    }
+  }
+  return {};
+}
+
+optional<EthernetFrame> EgressScheduler::dequeue_drr( uint64_t now_ms )
+{
+  while ( !empty() ) {
+    auto& queue = queues_[current_];
+    if ( !queue.empty() ) {
+      if ( fresh_turn_ ) {
+        deficit_[current_] += quantum_;
+        fresh_turn_ = false;
+      }
+      if ( queue.front_bytes() <= deficit_[current_] ) {
+        if ( auto frame = pop( current_, now_ms ) ) {
+          deficit_[current_] -= min( deficit_[current_], frame_bytes( *frame ) );
+          return frame;
+        }
+      }
+    }
+    // 这一轮用完了（或者队列空了：空队列不攒额度）
+    if ( queue.empty() ) {
+      deficit_[current_] = 0;
+    }
+    current_ = ( current_ + 1 ) % queues_.size();
+    fresh_turn_ = true;
+  }
+  return {};
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "ethernet_frame.hh"
+#include "network_interface_config.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+// One FIFO of frames waiting to go out, with a byte limit (a frame that would take it past the limit
+// is dropped at the tail) and, if enabled, CoDel active queue management (RFC 8289): once every
+// frame for an interval has waited longer than the target, frames are dropped at the head, more
+// often the longer that lasts, until the standing queue is gone.
+class EgressQueue
+{
+public:
+  EgressQueue( size_t limit_bytes, uint64_t codel_target_ms, uint64_t codel_interval_ms );
+
+  // Queue `frame` (its size is `bytes`); false (and the frame is dropped) if over the limit
+  bool push( EthernetFrame&& frame, size_t bytes, uint64_t now_ms );
+
+  // The next frame to send, or empty. Frames CoDel drops on the way are added to `dropped`.
+  std::optional<EthernetFrame> pop( uint64_t now_ms, uint64_t& dropped );
+
+  bool empty() const { return frames_.empty(); }
+  size_t size() const { return frames_.size(); }
+  size_t bytes() const { return bytes_; }
+
+  // Size of the frame at the head (the queue must not be empty)
+  size_t front_bytes() const { return frames_.front().bytes; }
+
+private:
+  struct Entry
+  {
+    EthernetFrame frame;
+    size_t bytes;
+    uint64_t enqueued_ms;
+  };
+
+  // 取出队头，并判断它是不是可以丢（RFC 8289 的 dodequeue）
+  Entry take( uint64_t now_ms, bool& ok_to_drop );
+
+  // 下一次丢包的时间：间隔随丢包次数的平方根缩短
+  uint64_t control_law( uint64_t t ) const;
+
+  std::deque<Entry> frames_ {};
+  size_t bytes_ {};
+  size_t limit_bytes_;
+  size_t max_frame_bytes_ {}; // 见过的最大帧：队列里不到一个帧就不算积压
+
+  uint64_t target_ms_; // 0：不做 AQM
+  uint64_t interval_ms_;
+  uint64_t first_above_ms_ {}; // 排队时间一直超过 target，到这个时刻就开始丢（0：没有超过）
+  uint64_t drop_next_ms_ {};
+  uint64_t count_ {};
+  uint64_t last_count_ {};
+  bool dropping_ {};
+};
+
+// How a NetworkInterface orders the frames it has to send (see NetworkInterfaceConfig::egress).
+//
+// IPv4 frames are sorted into classes by the precedence bits of the TOS byte (tos >> 5), from class
+// 0 for the highest precedence to class egress_queues - 1 for the lowest; ARP frames go in class 0
+// with network control traffic. Each class has its own EgressQueue, and the discipline picks the
+// queue the next frame comes from:
+//
+// - Fifo: a single queue for everything (TOS is ignored).
+// - Priority: strict priority; a class is served only when every higher class is empty.
+// - DeficitRoundRobin (Shreedhar & Varghese): the classes take turns, each sending up to
+//   egress_quantum bytes per turn (carried over when a frame does not fit), so every busy class
+//   gets an equal share of the link however large its frames are.
+class EgressScheduler
+{
+public:
+  using Discipline = NetworkInterfaceConfig::EgressDiscipline;
+
+  // TOS that ARP frames are queued with (precedence 7, network control)
+  static constexpr uint8_t NETWORK_CONTROL = 0xe0;
+
+  explicit EgressScheduler( const NetworkInterfaceConfig& config );
+
+  // Queue a frame in the class for `tos`; false if it was dropped
+  bool enqueue( EthernetFrame&& frame, uint8_t tos, uint64_t now_ms );
+
+  // The next frame to send, or empty once every queue is
+  std::optional<EthernetFrame> dequeue( uint64_t now_ms );
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Frames dropped: over a queue's limit, or by CoDel
+  uint64_t dropped() const { return dropped_; }
+
+  // Number of classes, and the frames waiting in class `i`
+  size_t classes() const { return queues_.size(); }
+  size_t queued( size_t i ) const { return queues_.at( i ).size(); }
+
+private:
+  // 从第 i 个队列取一个，顺便更新 size_ 和 dropped_
+  std::optional<EthernetFrame> pop( size_t i, uint64_t now_ms );
+
+  std::optional<EthernetFrame> dequeue_priority( uint64_t now_ms );
+  std::optional<EthernetFrame> dequeue_drr( uint64_t now_ms );
+
+  Discipline discipline_;
+  std::vector<EgressQueue> queues_;
+  size_t size_ {};
+  uint64_t dropped_ {};
+
+  // DRR：每个队列的额度，当前轮到的队列，以及它这一轮是否还没拿到 quantum
+  size_t quantum_;
+  std::vector<size_t> deficit_;
+  size_t current_ {};
+  bool fresh_turn_ { true };
+};
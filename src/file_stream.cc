@@ -0,0 +1,46 @@
+#include "file_stream.hh"
+
+#include <algorithm>
+#include <climits>
+#include <sys/uio.h>
+
+using namespace std;
+
+uint64_t FileSource::pump( Writer& writer )
+{
+  if ( writer.is_closed() ) {
+    return 0;
+  }
+  auto const size = min( remaining(), writer.available_capacity() );
+  if ( size > 0 ) {
+    writer.push( file_.substr( offset_, size ) );
+    offset_ += size;
+  }
+  if ( finished() ) {
+    writer.close();
+  }
+  return size;
+}
+
+uint64_t FileSink::drain( Reader& reader )
+{
+  uint64_t written = 0;
+  while ( reader.bytes_buffered() > 0 ) {
+    reader.peek_all( views_ );
+    // writev() 一次最多 IOV_MAX 段，剩下的下一轮再写
+    if ( views_.size() > IOV_MAX ) {
+      views_.resize( IOV_MAX );
+    }
+    uint64_t offered = 0;
+    for ( auto const view : views_ ) {
+      offered += view.size();
+    }
+    auto const n = fd_.write( views_ );
+    reader.pop( n );
+    written += n;
+    if ( n < offered ) {
+      break;
+    }
+  }
+  return written;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "byte_stream.hh"
+#include "file_descriptor.hh"
+#include "mapped_file.hh"
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Feeds a ByteStream from a MappedFile, for serving files: each pump() pushes as much of the rest
+// of the file as the stream has room for, as one slice of the mapping, and closes the stream after
+// the last byte. With the Queue backend nothing is copied on the way into the stream or from it into
+// a TCPSender's segments; the Ring backend copies into its ring as usual.
+//
+// pump() fits the stream's writable hook: call it once to start, and again whenever room opens up.
+class FileSource
+{
+public:
+  explicit FileSource( MappedFile file ) : file_( std::move( file ) ) {}
+
+  // Push what fits; returns how many bytes were pushed
+  uint64_t pump( Writer& writer );
+
+  uint64_t remaining() const { return file_.size() - offset_; }
+  bool finished() const { return remaining() == 0; }
+
+private:
+  MappedFile file_;
+  uint64_t offset_ {};
+};
+
+// Drains a ByteStream into a file descriptor (a file, pipe or socket): each drain() writes every
+// buffered byte it can with writev() over views of the stream's own storage, then pops what was
+// written. Nothing is copied in user space.
+class FileSink
+{
+public:
+  explicit FileSink( FileDescriptor fd ) : fd_( std::move( fd ) ) {}
+
+  // Write until the stream is empty or the descriptor would block (or takes less than offered);
+  // returns how many bytes were written
+  uint64_t drain( Reader& reader );
+
+  FileDescriptor& fd() { return fd_; }
+  const FileDescriptor& fd() const { return fd_; }
+
+private:
+  FileDescriptor fd_;
+  std::vector<std::string_view> views_ {}; // 复用，稳定以后不再分配
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// A snapshot of one interface's counters
+struct InterfaceStats
+{
+  uint64_t frames_in {};         // Ethernet frames received for this interface (or broadcast)
+  uint64_t bytes_in {};          // ...and their size, headers included
+  uint64_t frames_out {};        // Ethernet frames handed out by maybe_send()
+  uint64_t bytes_out {};         // ...and their size, headers included
+  uint64_t checksum_failures {}; // IPv4 datagrams dropped because the header checksum did not verify
+  uint64_t malformed {};         // IPv4 datagrams dropped because the header was truncated or did not parse
+  uint64_t ttl_expired {};       // datagrams that arrived here and were dropped by a router for TTL
+  uint64_t no_route {};          // datagrams that arrived here and matched no route
+  uint64_t arp_pending {};       // datagrams queued right now, waiting for an ARP reply
+  uint64_t arp_pending_bytes {}; // ...and their size
+  uint64_t arp_dropped {};       // queued datagrams dropped: over the queue limits, or the ARP request timed out
+  uint64_t fragments_out {};     // fragments sent for datagrams larger than the MTU
+  uint64_t frag_needed {};       // datagrams larger than the MTU dropped because they had DF set
+  uint64_t reassembled {};       // datagrams put back together from received fragments
+  uint64_t fragments_dropped {}; // received fragments dropped: malformed, over the limits, or timed out
+  uint64_t egress_dropped {};    // frames dropped by the egress queues: over a queue's limit, or by CoDel
+  uint64_t filtered {};          // datagrams that arrived here and were denied by a router's packet filter
+  uint64_t nat_dropped {};       // datagrams that arrived here and a router's NAT could not translate
+};
+
+// Counters kept by a NetworkInterface (and by the Router forwarding from it).
+//
+// Each counter has a single writer (the thread that owns the interface), so an update is a relaxed
+// load and store with no read-modify-write; any thread may take a snapshot() at any time. Nothing
+// is printed or locked on the hot path.
+class InterfaceCounters
+{
+public:
+  enum Counter : uint8_t
+  {
+    FRAMES_IN,
+    BYTES_IN,
+    FRAMES_OUT,
+    BYTES_OUT,
+    CHECKSUM_FAILURES,
+    MALFORMED,
+    TTL_EXPIRED,
+    NO_ROUTE,
+    ARP_PENDING,
+    ARP_PENDING_BYTES,
+    ARP_DROPPED,
+    FRAGMENTS_OUT,
+    FRAG_NEEDED,
+    REASSEMBLED,
+    FRAGMENTS_DROPPED,
+    EGRESS_DROPPED,
+    FILTERED,
+    NAT_DROPPED,
+    NUM_COUNTERS
+  };
+
+  InterfaceCounters() = default;
+  InterfaceCounters( const InterfaceCounters& other ) noexcept { *this = other; }
+  InterfaceCounters& operator=( const InterfaceCounters& other ) noexcept
+  {
+    for ( size_t i = 0; i < NUM_COUNTERS; ++i ) {
+      values_[i].store( other.values_[i].load( std::memory_order_relaxed ), std::memory_order_relaxed );
+    }
+    return *this;
+  }
+  ~InterfaceCounters() = default;
+
+  // Only the owning thread may call add() and sub()
+  void add( Counter counter, uint64_t n = 1 ) noexcept
+  {
+    auto& value = values_[counter];
+    value.store( value.load( std::memory_order_relaxed ) + n, std::memory_order_relaxed );
+  }
+  void sub( Counter counter, uint64_t n = 1 ) noexcept { add( counter, -n ); }
+
+  InterfaceStats snapshot() const noexcept
+  {
+    const auto get = [this]( Counter counter ) { return values_[counter].load( std::memory_order_relaxed ); };
+    return { get( FRAMES_IN ),
+             get( BYTES_IN ),
+             get( FRAMES_OUT ),
+             get( BYTES_OUT ),
+             get( CHECKSUM_FAILURES ),
+             get( MALFORMED ),
+             get( TTL_EXPIRED ),
+             get( NO_ROUTE ),
+             get( ARP_PENDING ),
+             get( ARP_PENDING_BYTES ),
+             get( ARP_DROPPED ),
+             get( FRAGMENTS_OUT ),
+             get( FRAG_NEEDED ),
+             get( REASSEMBLED ),
+             get( FRAGMENTS_DROPPED ),
+             get( EGRESS_DROPPED ),
+             get( FILTERED ),
+             get( NAT_DROPPED ) };
+  }
+
+private:
+  std::array<std::atomic<uint64_t>, NUM_COUNTERS> values_ {};
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// A hash map from IPv4 addresses (as uint32_t) to Values, stored in one flat array.
+//
+// Open addressing with linear probing: a key lives in the first free slot at or after its home
+// slot, so find(), find_or_insert() and erase() each walk one short run of adjacent slots. erase()
+// shifts the rest of the run back instead of leaving tombstones, so lookups never slow down as
+// entries come and go. The table doubles once it is 3/4 full.
+//
+// Inserting or erasing may move other entries: pointers and references returned earlier are
+// invalidated by any later insert or erase.
+template<typename Value>
+class IPv4FlatMap
+{
+public:
+  IPv4FlatMap() = default;
+
+  // The value for `key`, or nullptr
+  Value* find( uint32_t key )
+  {
+    for ( size_t i = home( key );; i = ( i + 1 ) & mask() ) {
+      if ( !slots_[i].used ) {
+        return nullptr;
+      }
+      if ( slots_[i].key == key ) {
+        return &slots_[i].value;
+      }
+    }
+  }
+  const Value* find( uint32_t key ) const { return const_cast<IPv4FlatMap*>( this )->find( key ); }
+
+  // The value for `key`, default-constructed if it was not there
+  Value& find_or_insert( uint32_t key )
+  {
+    if ( ( size_ + 1 ) * 4 > slots_.size() * 3 ) {
+      rehash( slots_.size() * 2 );
+    }
+    size_t i = home( key );
+    for ( ; slots_[i].used; i = ( i + 1 ) & mask() ) {
+      if ( slots_[i].key == key ) {
+        return slots_[i].value;
+      }
+    }
+    slots_[i].used = true;
+    slots_[i].key = key;
+    ++size_;
+    return slots_[i].value;
+  }
+
+  // Remove `key` (if present)
+  void erase( uint32_t key )
+  {
+    size_t hole = home( key );
+    for ( ;; hole = ( hole + 1 ) & mask() ) {
+      if ( !slots_[hole].used ) {
+        return;
+      }
+      if ( slots_[hole].key == key ) {
+        break;
+      }
+    }
+
+    // 把后面还在同一段里、可以往前挪的表项挪进空位，直到遇到空槽
+    for ( size_t next = ( hole + 1 ) & mask(); slots_[next].used; next = ( next + 1 ) & mask() ) {
+      auto const distance_to_hole = ( hole - home( slots_[next].key ) ) & mask();
+      auto const distance_to_next = ( next - home( slots_[next].key ) ) & mask();
+      if ( distance_to_hole < distance_to_next ) {
+        slots_[hole] = std::move( slots_[next] );
+        hole = next;
+      }
+    }
+    slots_[hole] = Slot {};
+    --size_;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+private:
+  struct Slot
+  {
+    uint32_t key {};
+    bool used {};
+    Value value {};
+  };
+
+  static constexpr size_t INITIAL_CAPACITY = 16;
+
+  size_t mask() const { return slots_.size() - 1; }
+
+  // Fibonacci hashing: the top bits of key * 2^32/phi, so nearby addresses land far apart
+  size_t home( uint32_t key ) const { return ( key * 0x9e3779b9U ) >> shift_; }
+
+  void rehash( size_t capacity )
+  {
+    std::vector<Slot> old = std::exchange( slots_, std::vector<Slot>( capacity ) );
+    shift_ = 32 - std::countr_zero( capacity );
+    for ( auto& slot : old ) {
+      if ( slot.used ) {
+        size_t i = home( slot.key );
+        while ( slots_[i].used ) {
+          i = ( i + 1 ) & mask();
+        }
+        slots_[i] = std::move( slot );
+      }
+    }
+  }
+
+  std::vector<Slot> slots_ = std::vector<Slot>( INITIAL_CAPACITY );
+  unsigned shift_ = 32 - std::countr_zero( INITIAL_CAPACITY );
+  size_t size_ {};
+};
@@ -0,0 +1,112 @@
+#include "ipv4_reassembler.hh"
+
+#include <vector>
+
+using namespace std;
+
+IPv4Reassembler::Flow::Flow( uint64_t expiry_ms ) : payload( UINT16_MAX ), expiry( expiry_ms ) {}
+
+IPv4Reassembler::IPv4Reassembler( uint64_t timeout_ms, size_t bytes_per_datagram, size_t bytes_total )
+  : timeout_ms_( timeout_ms ), bytes_per_datagram_( bytes_per_datagram ), bytes_total_( bytes_total )
+{}
+
+optional<InternetDatagram> IPv4Reassembler::add( InternetDatagram&& fragment, InterfaceCounters& counters )
+{
+  const auto& header = fragment.header;
+  const uint64_t length = header.payload_length();
+  const uint64_t first_index = static_cast<uint64_t>( header.offset ) * 8;
+
+  uint64_t received = 0;
+  for ( const auto& buffer : fragment.payload ) {
+    received += buffer.size();
+  }
+
+  // 除了最后一片，每片的长度都必须是 8 的倍数；负载不能比头部说的短；总长度不能超过 IP 的上限
+  if ( header.len < header.hlen * 4U or ( header.mf and length % 8 != 0 ) or received < length
+       or header.hlen * 4U + first_index + length > UINT16_MAX ) {
+    counters.add( InterfaceCounters::FRAGMENTS_DROPPED );
+    return {};
+  }
+
+  const Key key { header.src, header.dst, header.proto, header.id };
+  auto flow = flows_.find( key );
+  if ( flow == flows_.end() ) {
+    flow = flows_.try_emplace( key, now_ms_ + timeout_ms_ ).first;
+    expiry_.emplace_back( flow->second.expiry, key );
+  }
+  auto& state = flow->second;
+
+  if ( state.bytes + length > bytes_per_datagram_ or bytes_ + length > bytes_total_ ) {
+    counters.add( InterfaceCounters::FRAGMENTS_DROPPED );
+    if ( state.fragments == 0 ) {
+      flows_.erase( flow );
+    }
+    return {};
+  }
+
+  if ( header.offset == 0 ) {
+    state.first_header = header;
+  }
+  ++state.fragments;
+
+  // payload 里可能还有链路层的填充，只取 IP 头部说的长度
+  auto& writer = state.payload.writer();
+  const bool is_last = not header.mf;
+  uint64_t index = first_index;
+  uint64_t remaining = length;
+  for ( auto& buffer : fragment.payload ) {
+    if ( remaining == 0 ) {
+      break;
+    }
+    Buffer piece = buffer.size() > remaining ? buffer.substr( 0, remaining ) : std::move( buffer );
+    remaining -= piece.size();
+    const uint64_t size = piece.size();
+    state.reassembler.insert( index, std::move( piece ), is_last and remaining == 0, writer );
+    index += size;
+  }
+  if ( length == 0 ) {
+    state.reassembler.insert( index, Buffer {}, is_last, writer );
+  }
+
+  const uint64_t held = state.payload.reader().bytes_buffered() + state.reassembler.bytes_pending();
+  bytes_ += held - state.bytes;
+  state.bytes = held;
+
+  if ( not state.payload.reader().is_closed() or not state.first_header.has_value() ) {
+    return {};
+  }
+
+  // 所有字节都到了：用第一片的头部，改成一个完整的数据报
+  InternetDatagram whole;
+  whole.header = *state.first_header;
+  whole.header.mf = false;
+  whole.header.offset = 0;
+  auto& reader = state.payload.reader();
+  whole.header.len = static_cast<uint16_t>( whole.header.hlen * 4 + reader.bytes_buffered() );
+  whole.header.compute_checksum();
+  read( reader, reader.bytes_buffered(), whole.payload );
+
+  bytes_ -= state.bytes;
+  flows_.erase( flow );
+  counters.add( InterfaceCounters::REASSEMBLED );
+  return whole;
+}
+
+void IPv4Reassembler::tick( uint64_t ms_since_last_tick, InterfaceCounters& counters )
+{
+  now_ms_ += ms_since_last_tick;
+  while ( not expiry_.empty() and expiry_.front().first <= now_ms_ ) {
+    const auto [at, key] = expiry_.front();
+    expiry_.pop_front();
+    if ( auto flow = flows_.find( key ); flow != flows_.end() and flow->second.expiry == at ) {
+      drop_( flow, counters );
+    }
+  }
+}
+
+void IPv4Reassembler::drop_( map<Key, Flow>::iterator flow, InterfaceCounters& counters )
+{
+  counters.add( InterfaceCounters::FRAGMENTS_DROPPED, flow->second.fragments );
+  bytes_ -= flow->second.bytes;
+  flows_.erase( flow );
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "byte_stream.hh"
+#include "interface_counters.hh"
+#include "ipv4_datagram.hh"
+#include "reassembler.hh"
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <optional>
+#include <tuple>
+
+// Puts IPv4 fragments (RFC 791 section 3.2) back together into datagrams.
+//
+// Each datagram being reassembled (identified by source, destination, protocol and ID) gets a
+// Reassembler writing into a ByteStream the size of the largest possible payload, so overlapping
+// and duplicate fragments are handled the same way as TCP segments. The payload is complete when
+// the stream is closed (the last fragment and every byte before it have arrived); it then comes
+// out as slices of the fragments' own Buffers where it could be written in order.
+class IPv4Reassembler
+{
+public:
+  // timeout_ms: how long a datagram's fragments are kept, from the first one to arrive
+  // bytes_per_datagram, bytes_total: most fragment bytes held for one datagram, and for all of them
+  IPv4Reassembler( uint64_t timeout_ms, size_t bytes_per_datagram, size_t bytes_total );
+
+  // Is `dgram` a fragment (MF set, or a non-zero offset)?
+  static bool is_fragment( const IPv4Datagram& dgram ) { return dgram.header.mf or dgram.header.offset != 0; }
+
+  // Take a fragment. Returns the whole datagram if this fragment completed it. Fragments that are
+  // malformed or over the byte limits are dropped and counted in `counters`.
+  std::optional<InternetDatagram> add( InternetDatagram&& fragment, InterfaceCounters& counters );
+
+  // Drop the fragments of datagrams whose time is up
+  void tick( uint64_t ms_since_last_tick, InterfaceCounters& counters );
+
+  // Datagrams partly received, and the fragment bytes held for them
+  size_t datagrams() const { return flows_.size(); }
+  size_t bytes() const { return bytes_; }
+
+private:
+  using Key = std::tuple<uint32_t, uint32_t, uint8_t, uint16_t>; // src, dst, proto, id
+
+  struct Flow
+  {
+    explicit Flow( uint64_t expiry_ms );
+
+    ByteStream payload;
+    Reassembler reassembler {};
+    std::optional<IPv4Header> first_header {}; // from the fragment at offset 0, once it has arrived
+    uint64_t expiry;
+    uint64_t bytes {};     // bytes held (written to the stream, or stored out of order)
+    uint64_t fragments {}; // fragments taken
+  };
+
+  uint64_t timeout_ms_;
+  size_t bytes_per_datagram_;
+  size_t bytes_total_;
+
+  uint64_t now_ms_ {};
+  size_t bytes_ {};
+  std::map<Key, Flow> flows_ {};
+
+  // Datagrams in the order their first fragment arrived, which is also the order they expire in.
+  // An entry whose flow has since completed (and maybe started over) no longer matches its expiry.
+  std::deque<std::pair<uint64_t, Key>> expiry_ {};
+
+  void drop_( std::map<Key, Flow>::iterator flow, InterfaceCounters& counters );
+};
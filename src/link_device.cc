@@ -0,0 +1,361 @@
+#include "link_device.hh"
+
+#include "checksum.hh"
+#include "exception.hh"
+#include "socket.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/if_packet.h>
+#include <linux/if_tun.h>
+#include <net/if.h>
+#include <netinet/if_ether.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+// 把帧从环里拷出来；网卡没验过校验和的，拷的同时把以太网头后面的字节加起来，TCP 就不用再读一遍
+optional<uint16_t> copy_frame( char* dest, string_view wire, bool verified )
+{
+  if ( verified or wire.size() < EthernetHeader::LENGTH ) {
+    memcpy( dest, wire.data(), wire.size() );
+    return {};
+  }
+  memcpy( dest, wire.data(), EthernetHeader::LENGTH );
+  InternetChecksum sum;
+  sum.copy_and_add( dest + EthernetHeader::LENGTH, wire.substr( EthernetHeader::LENGTH ) );
+  return static_cast<uint16_t>( ~sum.value() );
+}
+
+// 非阻塞 I/O：没有数据（或发不出去）不算错误
+bool would_block()
+{
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS;
+}
+} // namespace
+
+void LinkDevice::Unmap::operator()( char* base ) const
+{
+  ::munmap( base, length );
+}
+
+LinkDevice::LinkDevice( FileDescriptor&& fd, size_t batch )
+  : fd_( std::move( fd ) ), batch_( max<size_t>( batch, 1 ) ), is_socket_( false )
+{
+  struct stat st {};
+  CheckSystemCall( "fstat", ::fstat( fd_.fd_num(), &st ) );
+  is_socket_ = S_ISSOCK( st.st_mode );
+  fd_.set_blocking( false );
+}
+
+LinkDevice LinkDevice::packet_socket( const string& ifname, size_t batch )
+{
+  PacketSocket socket { SOCK_RAW, htons( ETH_P_ALL ) };
+
+  sockaddr_ll address {};
+  address.sll_family = AF_PACKET;
+  address.sll_protocol = htons( ETH_P_ALL );
+  address.sll_ifindex = static_cast<int>( ::if_nametoindex( ifname.c_str() ) );
+  if ( address.sll_ifindex == 0 ) {
+    throw unix_error( "if_nametoindex(" + ifname + ")" );
+  }
+  CheckSystemCall( "bind",
+                   ::bind( socket.fd_num(),
+                           reinterpret_cast<const sockaddr*>( &address ), // NOLINT(*-reinterpret-cast)
+                           sizeof( address ) ) );
+  return LinkDevice { std::move( socket ), batch };
+}
+
+LinkDevice LinkDevice::tap( const string& name, size_t batch )
+{
+  FileDescriptor fd { CheckSystemCall( "open /dev/net/tun",
+                                       ::open( "/dev/net/tun", O_RDWR | O_CLOEXEC ) ) }; // NOLINT(*-vararg)
+
+  ifreq request {};
+  request.ifr_flags = IFF_TAP | IFF_NO_PI; // NOLINT(*-union-access)
+  name.copy( request.ifr_name, IFNAMSIZ - 1 );
+  CheckSystemCall( "ioctl TUNSETIFF", ::ioctl( fd.fd_num(), TUNSETIFF, &request ) ); // NOLINT(*-vararg)
+  return LinkDevice { std::move( fd ), batch };
+}
+
+void LinkDevice::enable_rx_ring( size_t block_size, size_t block_count, unsigned block_timeout_ms )
+{
+  if ( not is_socket_ ) {
+    throw runtime_error( "LinkDevice: a receive ring needs a packet socket" );
+  }
+  static constexpr size_t RING_FRAME_SIZE = 2048; // TPACKET_V3 按块收包，这个值只用于内核的参数检查
+
+  const int version = TPACKET_V3;
+  CheckSystemCall( "setsockopt PACKET_VERSION",
+                   ::setsockopt( fd_.fd_num(), SOL_PACKET, PACKET_VERSION, &version, sizeof( version ) ) );
+
+  tpacket_req3 request {};
+  request.tp_block_size = block_size;
+  request.tp_block_nr = block_count;
+  request.tp_frame_size = RING_FRAME_SIZE;
+  request.tp_frame_nr = block_size / RING_FRAME_SIZE * block_count;
+  request.tp_retire_blk_tov = block_timeout_ms;
+  CheckSystemCall( "setsockopt PACKET_RX_RING",
+                   ::setsockopt( fd_.fd_num(), SOL_PACKET, PACKET_RX_RING, &request, sizeof( request ) ) );
+
+  const size_t length = block_size * block_count;
+  void* base = ::mmap( nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_.fd_num(), 0 );
+  if ( base == MAP_FAILED ) { // NOLINT(*-cstyle-cast)
+    throw unix_error( "mmap PACKET_RX_RING" );
+  }
+  ring_ = { static_cast<char*>( base ), Unmap { length } };
+  block_size_ = block_size;
+  block_count_ = block_count;
+  next_block_ = 0;
+}
+
+void LinkDevice::use_arena( PacketArena& arena, optional<unsigned> node )
+{
+  rx_slabs_.clear(); // 旧 arena 的槽还回去
+  arena_ = &arena;
+  arena_node_ = node;
+}
+
+PacketArena::Slab LinkDevice::take_slab()
+{
+  if ( not arena_ ) {
+    return {};
+  }
+  return arena_node_ ? arena_->take( *arena_node_ ) : arena_->take();
+}
+
+void LinkDevice::accept_frame( Buffer&& bytes,
+                               vector<EthernetFrame>& out,
+                               bool checksum_verified,
+                               optional<uint16_t> payload_sum )
+{
+  EthernetFrame frame;
+  if ( parse( frame, vector<Buffer> { std::move( bytes ) } ) ) {
+    frame.checksum_verified = checksum_verified;
+    frame.payload_sum = payload_sum;
+    out.push_back( std::move( frame ) );
+  } else {
+    ++dropped_;
+  }
+}
+
+size_t LinkDevice::receive( vector<EthernetFrame>& out )
+{
+  if ( ring_ ) {
+    return receive_ring( out );
+  }
+
+  if ( not is_socket_ ) {
+    size_t received = 0;
+    for ( ; received < batch_; ++received ) {
+      if ( auto slab = take_slab() ) {
+        const ssize_t len = ::read( fd_.fd_num(), slab.get(), arena_->slab_size() );
+        if ( len < 0 ) {
+          if ( would_block() ) {
+            break;
+          }
+          throw unix_error( "read" );
+        }
+        if ( static_cast<size_t>( len ) == arena_->slab_size() ) {
+          ++dropped_; // read() 截断不报错：装满了就当被截断
+          continue;
+        }
+        accept_frame( arena_->wrap( std::move( slab ), len ), out );
+        continue;
+      }
+      string bytes = Buffer::pooled_string( MAX_FRAME_SIZE );
+      bytes.resize( MAX_FRAME_SIZE );
+      const ssize_t len = ::read( fd_.fd_num(), bytes.data(), bytes.size() );
+      if ( len < 0 ) {
+        if ( would_block() ) {
+          break;
+        }
+        throw unix_error( "read" );
+      }
+      bytes.resize( len );
+      accept_frame( std::move( bytes ), out );
+    }
+    return received;
+  }
+
+  // 交出去的缓冲在下一批之前重新分配
+  rx_buffers_.resize( batch_ );
+  rx_slabs_.resize( batch_ );
+  rx_iov_.resize( batch_ );
+  rx_msgs_.resize( batch_ );
+  for ( size_t i = 0; i < batch_; ++i ) {
+    if ( not rx_slabs_[i] ) {
+      rx_slabs_[i] = take_slab();
+    }
+    if ( rx_slabs_[i] ) {
+      rx_iov_[i] = { rx_slabs_[i].get(), arena_->slab_size() };
+    } else {
+      if ( rx_buffers_[i].capacity() < MAX_FRAME_SIZE ) {
+        rx_buffers_[i] = Buffer::pooled_string( MAX_FRAME_SIZE );
+      }
+      rx_buffers_[i].resize( MAX_FRAME_SIZE );
+      rx_iov_[i] = { rx_buffers_[i].data(), rx_buffers_[i].size() };
+    }
+    rx_msgs_[i] = {};
+    rx_msgs_[i].msg_hdr.msg_iov = &rx_iov_[i];
+    rx_msgs_[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  const int received = ::recvmmsg( fd_.fd_num(), rx_msgs_.data(), batch_, MSG_DONTWAIT, nullptr );
+  if ( received < 0 ) {
+    if ( would_block() ) {
+      return 0;
+    }
+    throw unix_error( "recvmmsg" );
+  }
+
+  for ( int i = 0; i < received; ++i ) {
+    if ( rx_msgs_[i].msg_hdr.msg_flags & MSG_TRUNC ) {
+      ++dropped_;
+      continue;
+    }
+    if ( rx_slabs_[i] ) {
+      accept_frame( arena_->wrap( std::move( rx_slabs_[i] ), rx_msgs_[i].msg_len ), out );
+      continue;
+    }
+    rx_buffers_[i].resize( rx_msgs_[i].msg_len );
+    accept_frame( std::move( rx_buffers_[i] ), out );
+    rx_buffers_[i] = string {};
+  }
+  return received;
+}
+
+size_t LinkDevice::receive_ring( vector<EthernetFrame>& out )
+{
+  size_t received = 0;
+  while ( received < batch_ ) {
+    auto* block
+      = reinterpret_cast<tpacket_block_desc*>( ring_.get() + next_block_ * block_size_ ); // NOLINT(*-reinterpret-cast)
+    atomic_ref<uint32_t> status { block->hdr.bh1.block_status };
+    if ( not( status.load( memory_order_acquire ) & TP_STATUS_USER ) ) {
+      break;
+    }
+
+    // 块要还给内核，所以帧要拷出来；每块只有这一次拷贝，没有系统调用
+    char* packet = reinterpret_cast<char*>( block ) + block->hdr.bh1.offset_to_first_pkt; // NOLINT(*-reinterpret-cast)
+    for ( uint32_t i = 0; i < block->hdr.bh1.num_pkts; ++i ) {
+      const auto* header = reinterpret_cast<const tpacket3_hdr*>( packet ); // NOLINT(*-reinterpret-cast)
+      if ( header->tp_snaplen < header->tp_len ) {
+        ++dropped_;
+      } else {
+        // 网卡验过校验和的帧（TP_STATUS_CSUM_VALID）不用再验一遍
+        const bool verified = ( header->tp_status & TP_STATUS_CSUM_VALID ) != 0;
+        const string_view wire { packet + header->tp_mac, header->tp_snaplen };
+        auto slab = wire.size() <= ( arena_ ? arena_->slab_size() : 0 ) ? take_slab() : PacketArena::Slab {};
+        if ( slab ) {
+          const auto sum = copy_frame( slab.get(), wire, verified );
+          accept_frame( arena_->wrap( std::move( slab ), wire.size() ), out, verified, sum );
+        } else {
+          string bytes = Buffer::pooled_string( wire.size() );
+          bytes.resize( wire.size() );
+          const auto sum = copy_frame( bytes.data(), wire, verified );
+          accept_frame( std::move( bytes ), out, verified, sum );
+        }
+      }
+      packet += header->tp_next_offset;
+    }
+    received += block->hdr.bh1.num_pkts;
+
+    status.store( TP_STATUS_KERNEL, memory_order_release );
+    next_block_ = ( next_block_ + 1 ) % block_count_;
+  }
+  return received;
+}
+
+size_t LinkDevice::transmit( vector<EthernetFrame>& frames )
+{
+  size_t sent = 0;
+
+  if ( not is_socket_ ) {
+    for ( ; sent < frames.size(); ++sent ) {
+      const auto buffers = serialize( frames[sent] );
+      tx_iov_.clear();
+      for ( const auto& buffer : buffers ) {
+        const string_view bytes { buffer };
+        tx_iov_.push_back( { const_cast<char*>( bytes.data() ), bytes.size() } ); // NOLINT(*-const-cast)
+      }
+      if ( ::writev( fd_.fd_num(), tx_iov_.data(), static_cast<int>( tx_iov_.size() ) ) < 0 ) {
+        if ( would_block() ) {
+          break;
+        }
+        throw unix_error( "writev" );
+      }
+    }
+    frames.erase( frames.begin(), frames.begin() + static_cast<ptrdiff_t>( sent ) );
+    return sent;
+  }
+
+  while ( sent < frames.size() ) {
+    const size_t count = min( batch_, frames.size() - sent );
+
+    // 先把这一批全部序列化，iovec 数组一次分配好，指针才不会失效
+    tx_buffers_.resize( count );
+    size_t iov_count = 0;
+    for ( size_t i = 0; i < count; ++i ) {
+      tx_buffers_[i] = serialize( frames[sent + i] );
+      iov_count += tx_buffers_[i].size();
+    }
+    tx_iov_.resize( iov_count );
+    tx_msgs_.resize( count );
+    size_t next_iov = 0;
+    for ( size_t i = 0; i < count; ++i ) {
+      tx_msgs_[i] = {};
+      tx_msgs_[i].msg_hdr.msg_iov = &tx_iov_[next_iov];
+      tx_msgs_[i].msg_hdr.msg_iovlen = tx_buffers_[i].size();
+      for ( const auto& buffer : tx_buffers_[i] ) {
+        const string_view bytes { buffer };
+        tx_iov_[next_iov++] = { const_cast<char*>( bytes.data() ), bytes.size() }; // NOLINT(*-const-cast)
+      }
+    }
+
+    const int result = ::sendmmsg( fd_.fd_num(), tx_msgs_.data(), count, MSG_DONTWAIT );
+    if ( result < 0 ) {
+      if ( would_block() ) {
+        break;
+      }
+      throw unix_error( "sendmmsg" );
+    }
+    sent += result;
+    if ( static_cast<size_t>( result ) < count ) {
+      break;
+    }
+  }
+  tx_buffers_.clear();
+
+  frames.erase( frames.begin(), frames.begin() + static_cast<ptrdiff_t>( sent ) );
+  return sent;
+}
+
+void LinkDevice::pump( NetworkInterface& interface, vector<InternetDatagram>& datagrams )
+{
+  rx_frames_.clear();
+  receive( rx_frames_ );
+  interface.recv_frames( rx_frames_, datagrams );
+  flush( interface );
+}
+
+void LinkDevice::pump( AsyncNetworkInterface& interface )
+{
+  rx_frames_.clear();
+  receive( rx_frames_ );
+  interface.recv_frames( rx_frames_ );
+  flush( interface );
+}
+
+void LinkDevice::flush( NetworkInterface& interface )
+{
+  interface.maybe_send_all( tx_frames_ );
+  transmit( tx_frames_ );
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "ethernet_frame.hh"
+#include "file_descriptor.hh"
+#include "packet_arena.hh"
+#include "router.hh"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+
+// Moves Ethernet frames in batches between a NetworkInterface and a device that carries one frame
+// per read or datagram: an AF_PACKET socket bound to a network interface, a TAP device, or (for
+// tests) one end of a SOCK_DGRAM socketpair.
+//
+// On sockets, receive() takes up to a batch of frames with one recvmmsg() and transmit() sends
+// them with one sendmmsg() per batch, gathering each frame straight from its Buffers. A TAP device
+// is not a socket, so there it falls back to one read() or writev() per frame. An AF_PACKET socket
+// can instead receive through a PACKET_MMAP ring (TPACKET_V3, see enable_rx_ring()), where the
+// kernel fills whole blocks of frames with no system call per frame at all.
+//
+// Received frames normally land in strings from the Buffer pool; with use_arena() they land in slabs
+// of a PacketArena instead (huge pages, on the interface's NUMA node).
+//
+// The device is non-blocking; the owner polls it (or waits for it to become readable).
+class LinkDevice
+{
+public:
+  static constexpr size_t DEFAULT_BATCH = 64;
+  static constexpr size_t MAX_FRAME_SIZE = 9216; // room for a jumbo frame
+
+  // Use `fd`, which must deliver one whole frame per read (it is made non-blocking)
+  explicit LinkDevice( FileDescriptor&& fd, size_t batch = DEFAULT_BATCH );
+
+  // An AF_PACKET socket that sends and receives every frame on network interface `ifname`
+  static LinkDevice packet_socket( const std::string& ifname, size_t batch = DEFAULT_BATCH );
+
+  // The TAP device `name` (created if it does not exist, which needs CAP_NET_ADMIN)
+  static LinkDevice tap( const std::string& name, size_t batch = DEFAULT_BATCH );
+
+  LinkDevice( const LinkDevice& ) = delete;
+  LinkDevice& operator=( const LinkDevice& ) = delete;
+  LinkDevice( LinkDevice&& ) = default;
+  LinkDevice& operator=( LinkDevice&& ) = default;
+  ~LinkDevice() = default;
+
+  // Receive through a TPACKET_V3 ring of `block_count` blocks of `block_size` bytes (packet sockets only).
+  // A block is handed over once it is full or `block_timeout_ms` after its first frame arrived.
+  // Frames the kernel marks TP_STATUS_CSUM_VALID come out with checksum_verified set; the others
+  // are summed while they are copied out of the ring and come out with payload_sum set.
+  void enable_rx_ring( size_t block_size = 1 << 20, size_t block_count = 16, unsigned block_timeout_ms = 1 );
+
+  // Receive into slabs of `arena` from `node` (default: the node of the thread calling receive()),
+  // e.g. PacketArena::node_of_interface() of the interface a packet socket is bound to. Frames
+  // longer than the arena's slabs are dropped. While the arena has no free slab, frames go into
+  // pooled strings as before. The arena must outlive the device and the frames it received.
+  void use_arena( PacketArena& arena, std::optional<unsigned> node = {} );
+
+  // Append up to a batch of waiting frames to `out` (in ring mode: every frame in the ready blocks).
+  // Returns the number received; frames that do not parse are dropped and counted in dropped().
+  size_t receive( std::vector<EthernetFrame>& out );
+
+  // Send frames from the front of `frames`, erasing the ones sent. Stops early (leaving the rest)
+  // if the device cannot take more right now. Returns the number sent.
+  size_t transmit( std::vector<EthernetFrame>& frames );
+
+  // Hand one batch of received frames to `interface`, append the datagrams it returns to
+  // `datagrams`, then transmit everything it has to send.
+  void pump( NetworkInterface& interface, std::vector<InternetDatagram>& datagrams );
+
+  // Same, for a Router's interface: received datagrams wait in `interface` for Router::route()
+  void pump( AsyncNetworkInterface& interface );
+
+  // Transmit everything `interface` has to send (plus whatever an earlier call could not send)
+  void flush( NetworkInterface& interface );
+
+  size_t dropped() const { return dropped_; }
+  bool rx_ring_enabled() const { return ring_ != nullptr; }
+  const FileDescriptor& fd() const { return fd_; }
+
+private:
+  struct Unmap
+  {
+    size_t length;
+    void operator()( char* base ) const;
+  };
+
+  size_t receive_ring( std::vector<EthernetFrame>& out );
+  void accept_frame( Buffer&& bytes,
+                     std::vector<EthernetFrame>& out,
+                     bool checksum_verified = false,
+                     std::optional<uint16_t> payload_sum = {} );
+  PacketArena::Slab take_slab();
+
+  FileDescriptor fd_;
+  size_t batch_;
+  bool is_socket_;
+  size_t dropped_ {};
+
+  // recvmmsg() 的接收缓冲，每批之前补齐（有 arena 时优先用 rx_slabs_）
+  std::vector<std::string> rx_buffers_ {};
+  std::vector<PacketArena::Slab> rx_slabs_ {};
+  std::vector<iovec> rx_iov_ {};
+  std::vector<mmsghdr> rx_msgs_ {};
+
+  // sendmmsg() 发送时引用的 Buffer 和 iovec
+  std::vector<std::vector<Buffer>> tx_buffers_ {};
+  std::vector<iovec> tx_iov_ {};
+  std::vector<mmsghdr> tx_msgs_ {};
+
+  PacketArena* arena_ {};
+  std::optional<unsigned> arena_node_ {};
+
+  std::vector<EthernetFrame> rx_frames_ {}; // pump() 复用
+  std::vector<EthernetFrame> tx_frames_ {}; // flush() 没发完的帧留到下次
+
+  // TPACKET_V3 接收环
+  std::unique_ptr<char, Unmap> ring_ { nullptr, Unmap { 0 } };
+  size_t block_size_ {};
+  size_t block_count_ {};
+  size_t next_block_ {};
+};
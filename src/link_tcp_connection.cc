@@ -0,0 +1,109 @@
+#include "link_tcp_connection.hh"
+
+#include <utility>
+
+using namespace std;
+
+LinkTCPConnection::LinkTCPConnection( LinkDevice&& device, const Config& config, const Address& remote )
+  : device_( std::move( device ) )
+  , interface_( config.ethernet_address, config.local_ip, config.interface )
+  , peer_( config.tcp )
+  , tcp_( Address { config.local_ip.ip(), config.local_port }, remote )
+  , gateway_( config.gateway )
+{
+  peer_.outbound_writer().set_readable_hook( outbound_readable_, this );
+  peer_.inbound_reader().set_writable_hook( inbound_writable_, this );
+}
+
+void LinkTCPConnection::outbound_readable_( void* self )
+{
+  auto& connection = *static_cast<LinkTCPConnection*>( self );
+  if ( connection.writer().reader().has_error() ) {
+    return;
+  }
+  connection.push_due_ = true;
+  if ( not connection.busy_ ) {
+    connection.send_();
+  }
+}
+
+void LinkTCPConnection::inbound_writable_( void* self )
+{
+  auto& connection = *static_cast<LinkTCPConnection*>( self );
+  if ( connection.reader().has_error() ) {
+    return;
+  }
+  connection.peer_.window_opened();
+  if ( not connection.busy_ ) {
+    connection.send_();
+  }
+}
+
+void LinkTCPConnection::connect()
+{
+  peer_.connect();
+  send_();
+}
+
+void LinkTCPConnection::push()
+{
+  peer_.push();
+  send_();
+}
+
+void LinkTCPConnection::poll()
+{
+  busy_ = true;
+  datagrams_.clear();
+  device_.pump( interface_, datagrams_ );
+  for ( auto& dgram : datagrams_ ) {
+    receive_( std::move( dgram ) );
+  }
+  send_();
+}
+
+void LinkTCPConnection::tick( uint64_t ms_since_last_tick )
+{
+  busy_ = true;
+  peer_.tick( ms_since_last_tick );
+  interface_.tick( ms_since_last_tick );
+  send_();
+}
+
+void LinkTCPConnection::receive_( InternetDatagram&& dgram )
+{
+  auto seg = tcp_.unwrap( dgram );
+  if ( not seg ) {
+    ++stats_.dropped;
+    return;
+  }
+
+  ++stats_.segments_received;
+  stats_.bytes_received += seg->message.sender.payload.size();
+
+  if ( seg->RST ) {
+    reset_ = true;
+    peer_.set_error();
+    return;
+  }
+
+  established_ = established_ or seg->message.sender.SYN;
+  peer_.receive( std::move( seg->message ) );
+}
+
+void LinkTCPConnection::send_()
+{
+  busy_ = true;
+  if ( exchange( push_due_, false ) ) {
+    peer_.push();
+  }
+  peer_.maybe_send_all( messages_ );
+  for ( auto& msg : messages_ ) {
+    ++stats_.segments_sent;
+    stats_.bytes_sent += msg.sender.payload.size();
+    interface_.send_datagram( tcp_.wrap( std::move( msg ) ), gateway_ );
+  }
+  messages_.clear();
+  device_.flush( interface_ );
+  busy_ = false;
+}
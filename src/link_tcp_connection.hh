@@ -0,0 +1,113 @@
+#pragma once
+
+#include "address.hh"
+#include "ethernet_header.hh"
+#include "ipv4_datagram.hh"
+#include "link_device.hh"
+#include "network_interface.hh"
+#include "network_interface_config.hh"
+#include "tcp_config.hh"
+#include "tcp_message.hh"
+#include "tcp_over_ipv4.hh"
+#include "tcp_peer.hh"
+
+#include <cstdint>
+#include <vector>
+
+// One TCP connection carried end to end by this project's own stack: a TCPPeer for TCP, a
+// TCPOverIPv4 to carry its messages in datagrams, a NetworkInterface for ARP and Ethernet, and a
+// LinkDevice for the frames. On a TAP device the far side of the link is the kernel, so the
+// connection can reach anything the host can (scripts/tap.sh sets one up).
+//
+// The connection is fixed to one pair of addresses and ports. Every datagram leaves through
+// `gateway`; datagrams that arrive for anything else (or fail their checksum) are dropped and
+// counted. A segment with RST ends the connection with an error on both streams.
+//
+// Nothing blocks: the owner calls poll() whenever the device is readable and tick() as time passes.
+// The streams' readiness hooks do the rest: writing to (or closing) the outbound stream sends at
+// once, and reading from a full inbound stream sends a window update. The hooks point at the
+// connection, so it cannot be copied or moved.
+class LinkTCPConnection
+{
+public:
+  struct Config
+  {
+    TCPConfig tcp {};
+    EthernetAddress ethernet_address { 0x02, 0, 0, 0, 0x90, 0x09 };
+    Address local_ip { "169.254.144.9" };
+    Address gateway { "169.254.144.1" }; // the next hop for every datagram (on TAP: the kernel's address)
+    uint16_t local_port { 49152 };
+    NetworkInterfaceConfig interface {};
+  };
+
+  struct Stats
+  {
+    uint64_t segments_sent;
+    uint64_t segments_received;
+    uint64_t bytes_sent;     // payload bytes, counting retransmissions
+    uint64_t bytes_received; // payload bytes, counting duplicates
+    uint64_t dropped;        // datagrams that were not for this connection, or did not parse
+  };
+
+  // Talk to `remote` (its IP address and port) over `device`
+  LinkTCPConnection( LinkDevice&& device, const Config& config, const Address& remote );
+
+  LinkTCPConnection( const LinkTCPConnection& other ) = delete;
+  LinkTCPConnection& operator=( const LinkTCPConnection& other ) = delete;
+  LinkTCPConnection( LinkTCPConnection&& other ) = delete;
+  LinkTCPConnection& operator=( LinkTCPConnection&& other ) = delete;
+  ~LinkTCPConnection() = default;
+
+  // Send the SYN (a connection that never connects answers the other side's SYN instead)
+  void connect();
+
+  // The application's ends of the two streams. Writing to (or closing) the outbound one sends by
+  // itself; push() is still there to send anything that is due.
+  Writer& writer() { return peer_.outbound_writer(); }
+  Reader& reader() { return peer_.inbound_reader(); }
+  void push();
+
+  // Take the frames waiting on the device, hand this connection's segments to the TCPPeer, and
+  // send everything the peer and the interface have to send
+  void poll();
+
+  // Time has passed by the given # of milliseconds since the last time tick() was called
+  void tick( uint64_t ms_since_last_tick );
+
+  // Has the other side's SYN arrived? (For the side that connected: the handshake has completed.)
+  bool established() const { return established_; }
+
+  // Is the connection still alive? False once both streams have ended cleanly, or after an error.
+  bool active() const { return peer_.active(); }
+
+  // Did the other side reset the connection?
+  bool reset() const { return reset_; }
+
+  Stats stats() const { return stats_; }
+  const TCPPeer& peer() const { return peer_; }
+  const NetworkInterface& interface() const { return interface_; }
+  const FileDescriptor& fd() const { return device_.fd(); }
+
+private:
+  void receive_( InternetDatagram&& dgram );
+  void send_();
+
+  // 流的就绪回调：在 poll()、tick() 等里面触发的只记下来，由它们最后的 send_() 一起发
+  static void outbound_readable_( void* self );
+  static void inbound_writable_( void* self );
+
+  LinkDevice device_;
+  NetworkInterface interface_;
+  TCPPeer peer_;
+  TCPOverIPv4 tcp_;
+  Address gateway_;
+
+  bool established_ {};
+  bool reset_ {};
+  bool busy_ {};     // 正在 poll()、tick() 或 send_() 里面
+  bool push_due_ {}; // 应用写了数据，下次 send_() 先 push
+  Stats stats_ {};
+
+  std::vector<InternetDatagram> datagrams_ {}; // poll() 复用
+  std::vector<TCPMessage> messages_ {};        // send_() 复用
+};
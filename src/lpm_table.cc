@@ -0,0 +1,171 @@
+#include "lpm_table.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+// 第一层表项按 address >> 8 取出，写进 entries
+void gather_scalar( const uint32_t* tbl24, const uint32_t* addresses, uint32_t* entries, size_t count )
+{
+  for ( size_t i = 0; i < count; ++i ) {
+    entries[i] = tbl24[addresses[i] >> 8];
+  }
+}
+
+#if defined( __x86_64__ )
+// 一次取 8 个：下标不超过 2^24，当有符号 32 位用没问题
+__attribute__( ( target( "avx2" ) ) ) void gather_avx2( const uint32_t* tbl24,
+                                                        const uint32_t* addresses,
+                                                        uint32_t* entries,
+                                                        size_t count )
+{
+  size_t i = 0;
+  for ( ; i + 8 <= count; i += 8 ) {
+    const __m256i address = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( addresses + i ) );
+    const __m256i index = _mm256_srli_epi32( address, 8 );
+    const __m256i entry = _mm256_i32gather_epi32( reinterpret_cast<const int*>( tbl24 ), index, 4 );
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>( entries + i ), entry );
+  }
+  gather_scalar( tbl24, addresses + i, entries + i, count - i );
+}
+#endif
+
+using GatherFn = void ( * )( const uint32_t*, const uint32_t*, uint32_t*, size_t );
+
+GatherFn best_gather()
+{
+#if defined( __x86_64__ )
+  if ( __builtin_cpu_supports( "avx2" ) ) {
+    return gather_avx2;
+  }
+#endif
+  return gather_scalar;
+}
+} // namespace
+
+void LPMTable::FreeDeleter::operator()( uint32_t* p ) const
+{
+  free( p ); // NOLINT(*-no-malloc, *-owning-memory)
+}
+
+// 第一层有 64 MiB，用 calloc 让没写过的页不占物理内存
+uint32_t* LPMTable::allocate_tbl24()
+{
+  auto* tbl24 = static_cast<uint32_t*>( calloc( TBL24_SIZE, sizeof( uint32_t ) ) ); // NOLINT(*-no-malloc)
+  if ( tbl24 == nullptr ) {
+    throw bad_alloc();
+  }
+  return tbl24;
+}
+
+LPMTable::LPMTable() : tbl24_( allocate_tbl24() ) {}
+
+void LPMTable::insert( uint32_t prefix, uint8_t prefix_length, uint32_t value )
+{
+  if ( prefix_length > 32 ) {
+    return;
+  }
+  if ( value > MAX_VALUE ) {
+    throw runtime_error( "LPMTable value out of range" );
+  }
+
+  // 只看前 prefix_length 位
+  prefix &= prefix_length == 0 ? 0 : UINT32_MAX << ( 32 - prefix_length );
+  const uint32_t entry = static_cast<uint32_t>( prefix_length ) << LENGTH_SHIFT | ( value + 1 );
+
+  if ( prefix_length <= 24 ) {
+    const size_t first = prefix >> 8;
+    const size_t count = size_t { 1 } << ( 24 - prefix_length );
+    for ( size_t i = first; i < first + count; ++i ) {
+      auto& slot = tbl24_[i];
+      if ( slot & GROUP ) {
+        // 这个 /24 下面有更长的前缀，展开到整个组里
+        const size_t group = slot & VALUE_MASK;
+        for ( size_t j = group << 8; j < ( group + 1 ) << 8; ++j ) {
+          fill( tbl8_[j], entry, prefix_length );
+        }
+      } else {
+        fill( slot, entry, prefix_length );
+      }
+    }
+    return;
+  }
+
+  auto& slot = tbl24_[prefix >> 8];
+  if ( not( slot & GROUP ) ) {
+    // 新建一个组，先继承这个 /24 原来的表项
+    const uint32_t group = tbl8_.size() >> 8;
+    if ( group > VALUE_MASK ) {
+      throw runtime_error( "LPMTable out of second-level groups" );
+    }
+    tbl8_.resize( tbl8_.size() + 256, slot );
+    slot = GROUP | group;
+  }
+  const size_t first = ( slot & VALUE_MASK ) << 8 | ( prefix & 0xff );
+  const size_t count = size_t { 1 } << ( 32 - prefix_length );
+  for ( size_t j = first; j < first + count; ++j ) {
+    fill( tbl8_[j], entry, prefix_length );
+  }
+}
+
+void LPMTable::lookup_burst( span<const uint32_t> addresses, span<uint32_t> values ) const
+{
+  auto const count = addresses.size();
+  for ( size_t i = 0; i < min( BURST, count ); ++i ) {
+    __builtin_prefetch( &tbl24_[addresses[i] >> 8] );
+  }
+  for ( size_t i = 0; i < count; i += BURST ) {
+    // 查这一组之前先预取下一组的第一层表项，访存和这一组的计算重叠
+    auto const next = min( i + BURST, count );
+    for ( size_t j = next; j < min( next + BURST, count ); ++j ) {
+      __builtin_prefetch( &tbl24_[addresses[j] >> 8] );
+    }
+    lookup_group( addresses.data() + i, values.data() + i, next - i );
+  }
+}
+
+/**
+ * 一组最多 BURST 个地址：第一层表项一起取出来（AVX2 一次 8 个），
+ * 指向第二层的先全部预取，再一起换成 value。每一步都不等前一个地址的访存结果
+ */
+void LPMTable::lookup_group( const uint32_t* addresses, uint32_t* values, size_t count ) const
+{
+  static const GatherFn gather = best_gather();
+  gather( tbl24_.get(), addresses, values, count );
+
+  array<uint32_t, BURST> second; // NOLINT(*-member-init) 第二层下标，只用到 GROUP 表项的
+  for ( size_t i = 0; i < count; ++i ) {
+    if ( values[i] & GROUP ) {
+      second[i] = ( values[i] & VALUE_MASK ) << 8 | ( addresses[i] & 0xff );
+      __builtin_prefetch( &tbl8_[second[i]] );
+    }
+  }
+  for ( size_t i = 0; i < count; ++i ) {
+    const uint32_t entry = values[i] & GROUP ? tbl8_[second[i]] : values[i];
+    values[i] = ( entry & VALUE_MASK ) - 1;
+  }
+}
+
+void LPMTable::fill( uint32_t& slot, uint32_t entry, uint8_t prefix_length )
+{
+  // 同样长的前缀先到先得（和逐条比较时的行为一致）
+  if ( slot == 0 || ( slot >> LENGTH_SHIFT ) < prefix_length ) {
+    slot = entry;
+  }
+}
+
+void LPMTable::clear()
+{
+  // 换一块新的全零内存，比逐项清零快，也把物理页还给系统
+  tbl24_.reset( allocate_tbl24() );
+  tbl8_.clear();
+}
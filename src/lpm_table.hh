@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+// A longest-prefix-match table from IPv4 prefixes to small integers (e.g. indices into a route list),
+// laid out as DIR-24-8 (Gupta, Lin & McKeown, "Routing Lookups in Hardware at Memory Access Speeds").
+//
+// The first level has one entry for every /24; a lookup indexes it with the top 24 bits of the
+// address. Prefixes no longer than /24 are expanded into every first-level entry they cover. A /24
+// that holds a longer prefix instead points to a group of 256 second-level entries, indexed by the
+// last 8 bits. So a lookup is one memory access, or two for addresses under a prefix longer than /24,
+// however many routes there are.
+//
+// Every entry remembers the length of the prefix that filled it, and an insert only overwrites
+// entries filled by a shorter prefix, so routes may be inserted in any order. Of two routes for the
+// same prefix, the first one inserted wins.
+class LPMTable
+{
+public:
+  static constexpr uint32_t NONE = UINT32_MAX;
+  static constexpr uint32_t MAX_VALUE = ( 1U << 24 ) - 2;
+
+  LPMTable();
+
+  // Map `prefix_length` high-order bits of `prefix` to `value` (at most MAX_VALUE). A prefix_length
+  // over 32 never matches anything, so such routes are ignored.
+  void insert( uint32_t prefix, uint8_t prefix_length, uint32_t value );
+
+  // Forget every prefix
+  void clear();
+
+  // The value of the longest prefix that matches `address`, or NONE
+  uint32_t lookup( uint32_t address ) const
+  {
+    uint32_t entry = tbl24_[address >> 8];
+    if ( entry & GROUP ) {
+      entry = tbl8_[( entry & VALUE_MASK ) << 8 | ( address & 0xff )];
+    }
+    // 空表项的 value 是 0，减一正好是 NONE
+    return ( entry & VALUE_MASK ) - 1;
+  }
+
+  // Look up a burst of addresses at once: values[i] = lookup( addresses[i] ) (`values` must be at
+  // least as long). Every first-level entry of a group of BURST addresses is prefetched before any
+  // is read, then gathered (eight at a time with AVX2), and the same again for the second level, so
+  // the cache misses of a whole group overlap instead of being paid one after another.
+  static constexpr size_t BURST = 32;
+  void lookup_burst( std::span<const uint32_t> addresses, std::span<uint32_t> values ) const;
+
+  // Bytes allocated for the two levels (the OS only backs first-level pages that have been written)
+  size_t memory_usage() const { return ( TBL24_SIZE + tbl8_.size() ) * sizeof( uint32_t ); }
+
+private:
+  // 表项：最高位表示指向第二层的组；24-29 位是前缀长度；低 24 位是 value + 1（或组号）
+  static constexpr uint32_t GROUP = 1U << 31;
+  static constexpr unsigned LENGTH_SHIFT = 24;
+  static constexpr uint32_t VALUE_MASK = ( 1U << 24 ) - 1;
+  static constexpr size_t TBL24_SIZE = size_t { 1 } << 24;
+
+  static void fill( uint32_t& slot, uint32_t entry, uint8_t prefix_length );
+  void lookup_group( const uint32_t* addresses, uint32_t* values, size_t count ) const;
+  static uint32_t* allocate_tbl24();
+
+  struct FreeDeleter
+  {
+    void operator()( uint32_t* p ) const;
+  };
+
+  std::unique_ptr<uint32_t[], FreeDeleter> tbl24_;
+  std::vector<uint32_t> tbl8_ {};
+};
@@ -0,0 +1,182 @@
+#include "nat_table.hh"
+
+#include "checksum.hh"
+
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+// TCP 校验和在头部第 16 字节，UDP 在第 6 字节；端口都在最前面
+constexpr size_t TCP_CHECKSUM_AT = 16;
+constexpr size_t UDP_CHECKSUM_AT = 6;
+
+uint16_t read16( string_view bytes, size_t at )
+{
+  return static_cast<uint16_t>( static_cast<uint8_t>( bytes[at] ) << 8 | static_cast<uint8_t>( bytes[at + 1] ) );
+}
+
+void write16( string& bytes, size_t at, uint16_t value )
+{
+  bytes[at] = static_cast<char>( value >> 8 );
+  bytes[at + 1] = static_cast<char>( value & 0xff );
+}
+} // namespace
+
+NatTable::NatTable( const Config& config ) : config_( config )
+{
+  for ( auto& side : sides_ ) {
+    for ( uint32_t port = config_.first_port; port <= config_.last_port; ++port ) {
+      side.free_ports.push_back( static_cast<uint16_t>( port ) );
+    }
+  }
+}
+
+// 只翻译完整的 TCP/UDP 数据报，而且第一个 Buffer 要装得下头部到校验和为止
+optional<uint8_t> NatTable::protocol_of( const InternetDatagram& dgram )
+{
+  const auto& header = dgram.header;
+  if ( ( header.proto != IPv4Header::PROTO_TCP && header.proto != PROTO_UDP ) || header.mf || header.offset != 0
+       || dgram.payload.empty() ) {
+    return {};
+  }
+  auto const udp = header.proto == PROTO_UDP;
+  auto const needed = ( udp ? UDP_CHECKSUM_AT : TCP_CHECKSUM_AT ) + 2;
+  if ( dgram.payload.front().size() < needed ) {
+    return {};
+  }
+  return static_cast<uint8_t>( udp );
+}
+
+uint64_t NatTable::timeout( uint8_t protocol ) const
+{
+  return protocol == 0 ? config_.tcp_timeout_ms : config_.udp_timeout_ms;
+}
+
+// 回来的数据报看到的四元组：local 是外部地址和端口
+FourTuple NatTable::external_key( const Mapping& mapping ) const
+{
+  return { config_.external_ip, mapping.internal.remote_ip, mapping.external_port, mapping.internal.remote_port };
+}
+
+bool NatTable::translate_outbound( InternetDatagram& dgram )
+{
+  auto const protocol = protocol_of( dgram );
+  if ( !protocol.has_value() ) {
+    return false;
+  }
+  auto& side = sides_[*protocol];
+  const string_view first = dgram.payload.front();
+  const FourTuple key { dgram.header.src, dgram.header.dst, read16( first, 0 ), read16( first, 2 ) };
+
+  uint32_t index {};
+  if ( const auto* found = side.outbound.find( key ) ) {
+    index = *found;
+  } else {
+    if ( side.free_ports.empty() ) {
+      return false;
+    }
+    if ( free_mappings_.empty() ) {
+      index = static_cast<uint32_t>( mappings_.size() );
+      mappings_.emplace_back();
+    } else {
+      index = free_mappings_.back();
+      free_mappings_.pop_back();
+    }
+    auto& mapping = mappings_[index];
+    mapping = { key, side.free_ports.front(), *protocol, timers_.now(), {} };
+    side.free_ports.pop_front();
+    side.outbound.find_or_insert( key ) = index;
+    side.inbound.find_or_insert( external_key( mapping ) ) = index;
+    mapping.timer = timers_.schedule( timers_.now() + timeout( *protocol ), index );
+    ++size_;
+  }
+
+  auto& mapping = mappings_[index];
+  mapping.last_used_ms = timers_.now();
+  rewrite( dgram, true, config_.external_ip, mapping.external_port );
+  return true;
+}
+
+bool NatTable::translate_inbound( InternetDatagram& dgram )
+{
+  auto const protocol = protocol_of( dgram );
+  if ( !protocol.has_value() || dgram.header.dst != config_.external_ip ) {
+    return false;
+  }
+  const string_view first = dgram.payload.front();
+  const FourTuple key { dgram.header.dst, dgram.header.src, read16( first, 2 ), read16( first, 0 ) };
+  const auto* found = sides_[*protocol].inbound.find( key );
+  if ( found == nullptr ) {
+    return false;
+  }
+  auto& mapping = mappings_[*found];
+  mapping.last_used_ms = timers_.now();
+  rewrite( dgram, false, mapping.internal.local_ip, mapping.internal.local_port );
+  return true;
+}
+
+void NatTable::rewrite( InternetDatagram& dgram, bool source, uint32_t address, uint16_t port )
+{
+  auto& header = dgram.header;
+  auto const old_address = source ? header.src : header.dst;
+  if ( source ) {
+    header.set_src( address );
+  } else {
+    header.set_dst( address );
+  }
+
+  // 头部到校验和为止复制一份来改，后面的部分仍然共享
+  auto const udp = header.proto == PROTO_UDP;
+  auto const checksum_at = udp ? UDP_CHECKSUM_AT : TCP_CHECKSUM_AT;
+  auto const port_at = source ? 0 : 2;
+  const string_view first = dgram.payload.front();
+  string head = Buffer::pooled_string( checksum_at + 2 );
+  head.assign( first.substr( 0, checksum_at + 2 ) );
+
+  auto const old_port = read16( head, port_at );
+  write16( head, port_at, port );
+  auto checksum = read16( head, checksum_at );
+  // UDP 的校验和为 0 表示没有算校验和，保持不变；算出来是 0 要写成 0xffff
+  if ( !udp || checksum != 0 ) {
+    checksum = InternetChecksum::update32( checksum, old_address, address );
+    checksum = InternetChecksum::update( checksum, old_port, port );
+    write16( head, checksum_at, udp && checksum == 0 ? 0xffff : checksum );
+  }
+
+  Buffer rest = dgram.payload.front().substr( head.size() );
+  dgram.payload.front() = Buffer { std::move( head ) };
+  if ( !rest.empty() ) {
+    dgram.payload.insert( dgram.payload.begin() + 1, std::move( rest ) );
+  }
+}
+
+// 定时器到期时才看映射是不是真的空闲了；期间用过就按最后一次使用重新定时
+void NatTable::tick( uint64_t ms_since_last_tick )
+{
+  fired_.clear();
+  timers_.advance( ms_since_last_tick, fired_ );
+  for ( auto const token : fired_ ) {
+    auto const index = static_cast<uint32_t>( token );
+    auto& mapping = mappings_[index];
+    auto const deadline = mapping.last_used_ms + timeout( mapping.protocol );
+    if ( timers_.now() >= deadline ) {
+      expire( index );
+    } else {
+      mapping.timer = timers_.schedule( deadline, token );
+    }
+  }
+}
+
+void NatTable::expire( uint32_t index )
+{
+  auto& mapping = mappings_[index];
+  auto& side = sides_[mapping.protocol];
+  side.outbound.erase( mapping.internal );
+  side.inbound.erase( external_key( mapping ) );
+  side.free_ports.push_back( mapping.external_port );
+  free_mappings_.push_back( index );
+  --size_;
+  ++expired_;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "connection_table.hh"
+#include "ipv4_datagram.hh"
+#include "timer_wheel.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+// Source NAT (NAPT) for TCP and UDP: the flows of many internal hosts share one external address,
+// each flow getting its own external port.
+//
+// A datagram going out from a new flow (internal address and port, remote address and port) is
+// given a free port from the configured range; the mapping is kept in two ConnectionTables, one
+// keyed by the internal side for outgoing datagrams and one by the external side for the replies.
+// Addresses and ports are rewritten in place, and the IPv4 and TCP/UDP checksums patched for the
+// changed words (RFC 1624) instead of being summed again over the payload. The bytes of the
+// TCP/UDP header up to the checksum are copied into a small Buffer of their own; the rest of the
+// payload is shared, not copied.
+//
+// A mapping expires once its flow has been idle for the protocol's timeout. The timeouts run on a
+// TimerWheel; a mapping that was used since its timer was set is simply rescheduled when the timer
+// fires, so refreshing one on every datagram costs nothing but a store.
+//
+// Fragments are not translated (only the first carries the ports): a NetworkInterface with
+// reassemble_fragments hands the router whole datagrams.
+class NatTable
+{
+public:
+  static constexpr uint16_t FIRST_PORT_DFLT = 1024;
+  static constexpr uint64_t TCP_TIMEOUT_DFLT = ( 2 * 60 + 4 ) * 60 * 1000; // RFC 5382 REQ-5: 2 h 4 min
+  static constexpr uint64_t UDP_TIMEOUT_DFLT = 5 * 60 * 1000;              // RFC 4787 REQ-5: 5 min
+  static constexpr uint8_t PROTO_UDP = 17;
+
+  struct Config
+  {
+    uint32_t external_ip {};
+    uint16_t first_port = FIRST_PORT_DFLT; // external ports handed out, per protocol
+    uint16_t last_port = UINT16_MAX;
+    uint64_t tcp_timeout_ms = TCP_TIMEOUT_DFLT;
+    uint64_t udp_timeout_ms = UDP_TIMEOUT_DFLT;
+  };
+
+  explicit NatTable( const Config& config );
+
+  // Rewrite the source of an outgoing datagram to the external address and the flow's port,
+  // mapping the flow first if it is new. False (and `dgram` untouched) if it cannot be translated:
+  // not TCP or UDP, a fragment, too short, or no free port.
+  bool translate_outbound( InternetDatagram& dgram );
+
+  // Rewrite the destination of a reply (a datagram to the external address) back to the internal
+  // host. False (and `dgram` untouched) if no flow is mapped to it.
+  bool translate_inbound( InternetDatagram& dgram );
+
+  // Move time forward, expiring idle mappings
+  void tick( uint64_t ms_since_last_tick );
+
+  uint32_t external_ip() const { return config_.external_ip; }
+  size_t size() const { return size_; }       // Flows mapped now
+  uint64_t expired() const { return expired_; } // Mappings removed for being idle
+
+private:
+  struct Mapping
+  {
+    FourTuple internal {}; // 内部主机看到的：local 是内部地址和端口，remote 是对端
+    uint16_t external_port {};
+    uint8_t protocol {}; // 0：TCP，1：UDP
+    uint64_t last_used_ms {};
+    TimerWheel::Handle timer {};
+  };
+
+  // 每个协议一套：内部 -> 映射，外部 -> 映射，可用的外部端口
+  struct Side
+  {
+    ConnectionTable<uint32_t> outbound { 0 };
+    ConnectionTable<uint32_t> inbound { 0 };
+    std::deque<uint16_t> free_ports {};
+  };
+
+  static std::optional<uint8_t> protocol_of( const InternetDatagram& dgram );
+  uint64_t timeout( uint8_t protocol ) const;
+  FourTuple external_key( const Mapping& mapping ) const;
+  void expire( uint32_t index );
+
+  // Rewrite the source (or destination) address and port of `dgram`, patching both checksums
+  static void rewrite( InternetDatagram& dgram, bool source, uint32_t address, uint16_t port );
+
+  Config config_;
+  std::array<Side, 2> sides_ {};
+  std::vector<Mapping> mappings_ {};
+  std::vector<uint32_t> free_mappings_ {};
+  size_t size_ {};
+  uint64_t expired_ {};
+  TimerWheel timers_ {};
+  std::vector<TimerWheel::Token> fired_ {};
+};
@@ -1,17 +1,57 @@
 #include "network_interface.hh"
 
 #include "arp_message.hh"
+#include "checksum.hh"
 #include "ethernet_frame.hh"
+#include "log.hh"
+#include "pcap.hh"
+#include "profile.hh"
 
 using namespace std;
 
+namespace {
+uint64_t frame_size( const EthernetFrame& frame )
+{
+  uint64_t size = EthernetHeader::LENGTH;
+  for ( const auto& buffer : frame.payload ) {
+    size += buffer.size();
+  }
+  return size;
+}
+
+// 下一帧的 IPv4 / ARP 头部（payload 的第一个 Buffer 开头）先拉进缓存
+void prefetch_payload( const EthernetFrame& frame )
+{
+  if ( !frame.payload.empty() ) {
+    __builtin_prefetch( string_view { frame.payload.front() }.data() );
+  }
+}
+
+uint64_t datagram_size( const InternetDatagram& dgram )
+{
+  uint64_t size = static_cast<uint64_t>( dgram.header.hlen ) * 4;
+  for ( const auto& buffer : dgram.payload ) {
+    size += buffer.size();
+  }
+  return size;
+}
+} // namespace
+
 // ethernet_address: Ethernet (what ARP calls "hardware") address of the interface
 // ip_address: IP (what ARP calls "protocol") address of the interface
-NetworkInterface::NetworkInterface( const EthernetAddress& ethernet_address, const Address& ip_address )
-  : ethernet_address_( ethernet_address ), ip_address_( ip_address )
+NetworkInterface::NetworkInterface( const EthernetAddress& ethernet_address,
+                                    const Address& ip_address,
+                                    const NetworkInterfaceConfig& config )
+  : ethernet_address_( ethernet_address )
+  , ip_address_( ip_address )
+  , config_( config )
+  , reassembler_( config.reassembly_timeout_ms, config.reassembly_bytes_per_datagram, config.reassembly_bytes_total )
+  , out_frames_( config )
 {
-  cerr << "DEBUG: Network interface has Ethernet address " << to_string( ethernet_address_ ) << " and IP address "
-       << ip_address.ip() << "\n";
+  log<LogLevel::Debug>( [&]( ostream& out ) {
+    out << "Network interface has Ethernet address " << to_string( ethernet_address_ ) << " and IP address "
+        << ip_address.ip();
+  } );
 }
 
 // dgram: the IPv4 datagram to be sent
@@ -30,101 +70,407 @@ NetworkInterface::NetworkInterface( const EthernetAddress& ethernet_address, con
 */
 void NetworkInterface::send_datagram( const InternetDatagram& dgram, const Address& next_hop )
 {
-  auto const& target_ip = next_hop.ipv4_numeric();
-  if ( ip2ether_.contains( target_ip ) ) {
-    EthernetFrame frame { { ip2ether_[target_ip].first, ethernet_address_, EthernetHeader::TYPE_IPv4 },
-                          serialize( dgram ) };
-    out_frames_.push( std::move( frame ) );
-  } else {
-    if ( !arp_timer_.contains( target_ip ) ) {
-      ARPMessage request_msg;
-      request_msg.opcode = ARPMessage::OPCODE_REQUEST;
-      request_msg.sender_ethernet_address = ethernet_address_;
-      request_msg.sender_ip_address = ip_address_.ipv4_numeric();
-      request_msg.target_ip_address = target_ip;
-      EthernetFrame frame { { ETHERNET_BROADCAST, ethernet_address_, EthernetHeader::TYPE_ARP },
-                            serialize( request_msg ) };
-      out_frames_.push( std::move( frame ) );
-      arp_timer_.emplace( next_hop.ipv4_numeric(), 0 );
-      waited_dgrams_.insert( { target_ip, { dgram } } );
-    } else {
-      waited_dgrams_[target_ip].push_back( dgram );
+  send_datagram( InternetDatagram { dgram }, next_hop );
+}
+
+void NetworkInterface::send_datagram( InternetDatagram&& dgram, const Address& next_hop )
+{
+  if ( datagram_size( dgram ) > config_.mtu ) {
+    send_fragments_( std::move( dgram ), next_hop );
+    return;
+  }
+
+  auto const target_ip = next_hop.ipv4_numeric();
+  // 邻居表满了：新的下一跳不再收，发给它的数据报丢掉
+  if ( neighbours_.size() >= config_.neighbour_capacity && !neighbours_.find( target_ip ) ) {
+    counters_.add( InterfaceCounters::ARP_DROPPED );
+    return;
+  }
+  auto& neighbour = neighbours_.find_or_insert( target_ip );
+  if ( neighbour.ethernet_address.has_value() ) {
+    neighbour.used = true;
+    push_ipv4_frame_( neighbour, std::move( dgram ) );
+    return;
+  }
+
+  if ( !neighbour.request_expiry.has_value() ) {
+    send_arp_request_( target_ip, ETHERNET_BROADCAST );
+    neighbour.retries = 0;
+    schedule_request_expiry_( target_ip, neighbour );
+  }
+
+  // 超过单个邻居或全部队列的上限时丢掉新来的数据报
+  auto const size = datagram_size( dgram );
+  if ( neighbour.pending_bytes + size > config_.pending_bytes_per_neighbour
+       || pending_bytes_ + size > config_.pending_bytes_total ) {
+    counters_.add( InterfaceCounters::ARP_DROPPED );
+    return;
+  }
+  neighbour.pending.push_back( std::move( dgram ) );
+  neighbour.pending_bytes += size;
+  ++pending_datagrams_;
+  pending_bytes_ += size;
+  counters_.add( InterfaceCounters::ARP_PENDING );
+  counters_.add( InterfaceCounters::ARP_PENDING_BYTES, size );
+}
+
+void NetworkInterface::send_fragments_( InternetDatagram&& dgram, const Address& next_hop )
+{
+  // 每片（除了最后一片）的负载是 8 字节的整数倍，放得进 MTU 的最大值
+  auto const header_length = static_cast<uint64_t>( dgram.header.hlen ) * 4;
+  auto const chunk = config_.mtu > header_length ? ( config_.mtu - header_length ) / 8 * 8 : 0;
+  if ( dgram.header.df || chunk == 0 ) {
+    counters_.add( InterfaceCounters::FRAG_NEEDED );
+    return;
+  }
+
+  // 负载按 chunk 切开，每片是原来 Buffer 的切片，不拷贝
+  auto const original = dgram.header;
+  uint64_t remaining = min<uint64_t>( original.payload_length(), datagram_size( dgram ) - header_length );
+  uint64_t offset = 0;
+  size_t next = 0;
+  Buffer rest = next < dgram.payload.size() ? std::move( dgram.payload[next++] ) : Buffer {};
+  while ( remaining > 0 ) {
+    InternetDatagram fragment;
+    fragment.header = original;
+    fragment.header.offset = original.offset + offset / 8;
+    auto size = min( chunk, remaining );
+    fragment.header.mf = original.mf || size < remaining;
+    fragment.header.len = static_cast<uint16_t>( header_length + size );
+    fragment.header.compute_checksum();
+    remaining -= size;
+    offset += size;
+
+    while ( size > 0 ) {
+      while ( rest.empty() ) {
+        rest = std::move( dgram.payload[next++] );
+      }
+      auto const take = min<uint64_t>( size, rest.size() );
+      fragment.payload.push_back( rest.substr( 0, take ) );
+      rest = rest.substr( take );
+      size -= take;
+    }
+    counters_.add( InterfaceCounters::FRAGMENTS_OUT );
+    send_datagram( std::move( fragment ), next_hop );
+  }
+}
+
+size_t NetworkInterface::pending_bytes( const Address& next_hop ) const
+{
+  auto const* neighbour = neighbours_.find( next_hop.ipv4_numeric() );
+  return neighbour ? neighbour->pending_bytes : 0;
+}
+
+void NetworkInterface::send_arp_request_( uint32_t target_ip, const EthernetAddress& destination )
+{
+  ARPMessage request_msg;
+  request_msg.opcode = ARPMessage::OPCODE_REQUEST;
+  request_msg.sender_ethernet_address = ethernet_address_;
+  request_msg.sender_ip_address = ip_address_.ipv4_numeric();
+  if ( destination != ETHERNET_BROADCAST ) {
+    request_msg.target_ethernet_address = destination;
+  }
+  request_msg.target_ip_address = target_ip;
+  queue_frame_( { { destination, ethernet_address_, EthernetHeader::TYPE_ARP }, serialize( request_msg ) },
+                EgressScheduler::NETWORK_CONTROL );
+}
+
+void NetworkInterface::schedule_request_expiry_( uint32_t ip, Neighbour& neighbour )
+{
+  // 第 n 次重发要等 request_retry_ms * backoff^n
+  uint64_t wait = max<uint64_t>( config_.request_retry_ms, 1 );
+  for ( unsigned i = 0; i < neighbour.retries; ++i ) {
+    wait *= max( config_.request_backoff, 1U );
+  }
+  neighbour.request_expiry = now_ms_ + wait;
+  request_expiry_.push( { now_ms_ + wait, ip } );
+}
+
+void NetworkInterface::send_gratuitous_arp()
+{
+  // RFC 5227 的 ARP Announcement：发送方和目标都是自己的 IP
+  send_arp_request_( ip_address_.ipv4_numeric(), ETHERNET_BROADCAST );
+}
+
+void NetworkInterface::learn_( uint32_t ip, const EthernetAddress& ethernet_address )
+{
+  // 别人声称是我们的地址（地址冲突），不记下来
+  if ( ip == ip_address_.ipv4_numeric() ) {
+    return;
+  }
+
+  // 邻居表满了就只更新已有的邻居
+  if ( neighbours_.size() >= config_.neighbour_capacity && !neighbours_.find( ip ) ) {
+    return;
+  }
+
+  auto& neighbour = neighbours_.find_or_insert( ip );
+  auto const was_known = neighbour.ethernet_address.has_value();
+  if ( !was_known || *neighbour.ethernet_address != ethernet_address ) {
+    neighbour.ethernet_address = ethernet_address;
+    neighbour.ipv4_header
+      = serialize( EthernetHeader { ethernet_address, ethernet_address_, EthernetHeader::TYPE_IPv4 } ).front();
+  }
+
+  // 已知的映射也续期；旧的到期记录会因为时间对不上而被跳过
+  auto const expiry = now_ms_ + config_.mapping_ttl_ms;
+  if ( !was_known || neighbour.mapping_expiry != expiry ) {
+    neighbour.mapping_expiry = expiry;
+    mapping_expiry_.push_back( { expiry, ip } );
+    if ( config_.proactive_refresh ) {
+      refresh_due_.push_back( { expiry - refresh_lead_(), ip } );
     }
   }
+  if ( was_known ) {
+    return;
+  }
+
+  // 一次性把排队的数据报都封装成帧，不再逐个走 send_datagram 重新查表
+  for ( auto& dgram : neighbour.pending ) {
+    push_ipv4_frame_( neighbour, std::move( dgram ) );
+  }
+  clear_pending_( neighbour );
+}
+
+void NetworkInterface::push_ipv4_frame_( const Neighbour& neighbour, InternetDatagram&& dgram )
+{
+  // 以太网头在学到映射时已经序列化好，每个帧只多一个共享引用
+  auto const tos = dgram.header.tos;
+  queue_frame_( { { *neighbour.ethernet_address, ethernet_address_, EthernetHeader::TYPE_IPv4 },
+                  serialize( std::move( dgram ) ),
+                  neighbour.ipv4_header },
+                tos );
+}
+
+void NetworkInterface::clear_pending_( Neighbour& neighbour )
+{
+  pending_datagrams_ -= neighbour.pending.size();
+  pending_bytes_ -= neighbour.pending_bytes;
+  counters_.sub( InterfaceCounters::ARP_PENDING, neighbour.pending.size() );
+  counters_.sub( InterfaceCounters::ARP_PENDING_BYTES, neighbour.pending_bytes );
+  neighbour.pending = {};
+  neighbour.pending_bytes = 0;
+}
+
+void NetworkInterface::forget_if_idle_( uint32_t ip, const Neighbour& neighbour )
+{
+  if ( !neighbour.ethernet_address.has_value() && !neighbour.request_expiry.has_value()
+       && neighbour.pending.empty() ) {
+    neighbours_.erase( ip );
+  }
 }
 
 // frame: the incoming Ethernet frame
 optional<InternetDatagram> NetworkInterface::recv_frame( const EthernetFrame& frame )
 {
-  if ( frame.header.dst != ethernet_address_ && frame.header.dst != ETHERNET_BROADCAST ) {
+  const ProfileScope<Profile::INTERFACE_RECV_FRAME> profile;
+  if ( !accept_frame_( frame ) ) {
     return {};
   }
-
   if ( frame.header.type == EthernetHeader::TYPE_IPv4 ) {
-    InternetDatagram dgram;
-    if ( parse( dgram, frame.payload ) ) {
-      return dgram;
+    return recv_ipv4_( frame );
+  }
+  if ( frame.header.type == EthernetHeader::TYPE_ARP ) {
+    recv_arp_( frame );
+  }
+  return {};
+}
+
+/**
+ * 先按类型把帧分成 IPv4 和 ARP 两组（顺带滤掉不是发给自己的），再各自成批处理：
+ * 同一段代码连着跑，分支好预测；处理当前帧时预取下一帧的头部。
+ * IPv4 组先处理：收到的数据报不依赖邻居表，ARP 学到的映射也只影响发送
+ */
+size_t NetworkInterface::recv_frames( span<const EthernetFrame> frames, vector<InternetDatagram>& datagrams )
+{
+  const ProfileScope<Profile::INTERFACE_RECV_FRAME> profile;
+  rx_ipv4_.clear();
+  rx_arp_.clear();
+  for ( size_t i = 0; i < frames.size(); ++i ) {
+    const auto& frame = frames[i];
+    if ( !accept_frame_( frame ) ) {
+      continue;
     }
-  } else if ( frame.header.type == EthernetHeader::TYPE_ARP ) {
-    ARPMessage msg;
-    if ( parse( msg, frame.payload ) ) {
-      ip2ether_.insert( { msg.sender_ip_address, { msg.sender_ethernet_address, 0 } } );
-      if ( msg.opcode == ARPMessage::OPCODE_REQUEST ) {
-        if ( msg.target_ip_address == ip_address_.ipv4_numeric() ) {
-          ARPMessage reply_msg;
-          reply_msg.opcode = ARPMessage::OPCODE_REPLY;
-          reply_msg.sender_ethernet_address = ethernet_address_;
-          reply_msg.sender_ip_address = ip_address_.ipv4_numeric();
-          reply_msg.target_ethernet_address = msg.sender_ethernet_address;
-          reply_msg.target_ip_address = msg.sender_ip_address;
-          EthernetFrame reply_frame { { msg.sender_ethernet_address, ethernet_address_, EthernetHeader::TYPE_ARP },
-                                      serialize( reply_msg ) };
-          out_frames_.push( std::move( reply_frame ) );
-        }
-      } else if ( msg.opcode == ARPMessage::OPCODE_REPLY ) {
-        ip2ether_.insert( { msg.sender_ip_address, { msg.sender_ethernet_address, 0 } } );
-        auto const& dgrams = waited_dgrams_[msg.sender_ip_address];
-        for ( auto const& dgram : dgrams ) {
-          send_datagram( dgram, Address::from_ipv4_numeric( msg.sender_ip_address ) );
-        }
-        waited_dgrams_.erase( msg.sender_ip_address );
-      }
+    if ( frame.header.type == EthernetHeader::TYPE_IPv4 ) {
+      rx_ipv4_.push_back( i );
+    } else if ( frame.header.type == EthernetHeader::TYPE_ARP ) {
+      rx_arp_.push_back( i );
     }
   }
-  return {};
+
+  auto const before = datagrams.size();
+  for ( size_t n = 0; n < rx_ipv4_.size(); ++n ) {
+    if ( n + 1 < rx_ipv4_.size() ) {
+      prefetch_payload( frames[rx_ipv4_[n + 1]] );
+    }
+    if ( auto dgram = recv_ipv4_( frames[rx_ipv4_[n]] ) ) {
+      datagrams.push_back( std::move( *dgram ) );
+    }
+  }
+  for ( size_t n = 0; n < rx_arp_.size(); ++n ) {
+    if ( n + 1 < rx_arp_.size() ) {
+      prefetch_payload( frames[rx_arp_[n + 1]] );
+    }
+    recv_arp_( frames[rx_arp_[n]] );
+  }
+  return datagrams.size() - before;
+}
+
+bool NetworkInterface::accept_frame_( const EthernetFrame& frame )
+{
+  if ( capture_ ) {
+    capture_->write( frame, CaptureDirection::Inbound );
+  }
+  if ( frame.header.dst != ethernet_address_ && frame.header.dst != ETHERNET_BROADCAST ) {
+    return false;
+  }
+  counters_.add( InterfaceCounters::FRAMES_IN );
+  counters_.add( InterfaceCounters::BYTES_IN, frame_size( frame ) );
+  return true;
+}
+
+optional<InternetDatagram> NetworkInterface::recv_ipv4_( const EthernetFrame& frame )
+{
+  InternetDatagram dgram;
+  Parser parser { frame.payload };
+  parser.set_checksum_verified( frame.checksum_verified );
+  dgram.parse( parser );
+  if ( parser.has_error() ) {
+    // 网卡验过校验和的帧不会再有校验和错误，出错只能是头本身坏了
+    counters_.add( parser.checksum_error() ? InterfaceCounters::CHECKSUM_FAILURES : InterfaceCounters::MALFORMED );
+    return {};
+  }
+  if ( config_.reassemble_fragments && IPv4Reassembler::is_fragment( dgram ) ) {
+    return reassembler_.add( std::move( dgram ), counters_ );
+  }
+  // 网卡验过的，或者驱动拷贝时顺便求了和：合法的 IPv4 头加起来是 0xffff（反码的 0），
+  // 所以帧的和加上伪首部就是 TCP 校验和要验的和
+  if ( frame.checksum_verified ) {
+    dgram.payload_checksum_verified = true;
+  } else if ( frame.payload_sum.has_value() && dgram.header.proto == IPv4Header::PROTO_TCP
+              && !IPv4Reassembler::is_fragment( dgram )
+              && frame_size( frame ) == EthernetHeader::LENGTH + dgram.header.len ) {
+    dgram.payload_checksum_verified
+      = InternetChecksum { dgram.header.pseudo_checksum() + *frame.payload_sum }.value() == 0;
+  }
+  return dgram;
+}
+
+void NetworkInterface::recv_arp_( const EthernetFrame& frame )
+{
+  ARPMessage msg;
+  if ( !parse( msg, frame.payload ) ) {
+    return;
+  }
+  // 请求和回复都能学到发送方的映射
+  learn_( msg.sender_ip_address, msg.sender_ethernet_address );
+  if ( msg.opcode == ARPMessage::OPCODE_REQUEST && msg.target_ip_address == ip_address_.ipv4_numeric() ) {
+    ARPMessage reply_msg;
+    reply_msg.opcode = ARPMessage::OPCODE_REPLY;
+    reply_msg.sender_ethernet_address = ethernet_address_;
+    reply_msg.sender_ip_address = ip_address_.ipv4_numeric();
+    reply_msg.target_ethernet_address = msg.sender_ethernet_address;
+    reply_msg.target_ip_address = msg.sender_ip_address;
+    EthernetFrame reply_frame { { msg.sender_ethernet_address, ethernet_address_, EthernetHeader::TYPE_ARP },
+                                serialize( reply_msg ) };
+    queue_frame_( std::move( reply_frame ), EgressScheduler::NETWORK_CONTROL );
+  }
 }
 
 // ms_since_last_tick: the number of milliseconds since the last call to this method
 void NetworkInterface::tick( const size_t ms_since_last_tick )
 {
-  static constexpr size_t IP_MAP_TTL = 30000;     // 30s
-  static constexpr size_t ARP_REQUEST_TTL = 5000; // 5s
+  now_ms_ += ms_since_last_tick;
+  reassembler_.tick( ms_since_last_tick, counters_ );
+
+  // 队列按到期时间排序，只看队头；邻居已经变了（或不在了）的记录直接丢掉
+  while ( !mapping_expiry_.empty() && mapping_expiry_.front().at <= now_ms_ ) {
+    auto const [at, ip] = mapping_expiry_.front();
+    mapping_expiry_.pop_front();
+    if ( auto* neighbour = neighbours_.find( ip );
+         neighbour && neighbour->ethernet_address.has_value() && neighbour->mapping_expiry == at ) {
+      neighbour->ethernet_address.reset();
+      neighbour->ipv4_header.reset();
+      neighbour->used = false;
+      forget_if_idle_( ip, *neighbour );
+    }
+  }
 
-  for ( auto it = ip2ether_.begin(); it != ip2ether_.end(); ) {
-    it->second.second += ms_since_last_tick;
-    if ( it->second.second >= IP_MAP_TTL ) {
-      it = ip2ether_.erase( it );
-    } else {
-      ++it;
+  // 快过期且最近用过的映射，单播一个 ARP 请求去确认；映射在回复到来之前照常使用
+  while ( !refresh_due_.empty() && refresh_due_.front().at <= now_ms_ ) {
+    auto const [at, ip] = refresh_due_.front();
+    refresh_due_.pop_front();
+    if ( auto* neighbour = neighbours_.find( ip ); neighbour && neighbour->ethernet_address.has_value()
+                                                   && neighbour->mapping_expiry == at + refresh_lead_()
+                                                   && neighbour->used ) {
+      neighbour->used = false;
+      send_arp_request_( ip, *neighbour->ethernet_address );
     }
   }
 
-  for ( auto it = arp_timer_.begin(); it != arp_timer_.end(); ) {
-    it->second += ms_since_last_tick;
-    if ( it->second >= ARP_REQUEST_TTL ) {
-      it = arp_timer_.erase( it );
-    } else {
-      ++it;
+  while ( !request_expiry_.empty() && request_expiry_.top().at <= now_ms_ ) {
+    auto const [at, ip] = request_expiry_.top();
+    request_expiry_.pop();
+    if ( auto* neighbour = neighbours_.find( ip ); neighbour && neighbour->request_expiry == at ) {
+      // 还在等映射、还有重试次数：退避后再广播一次
+      if ( !neighbour->ethernet_address.has_value() && !neighbour->pending.empty()
+           && neighbour->retries < config_.request_retries ) {
+        ++neighbour->retries;
+        send_arp_request_( ip, ETHERNET_BROADCAST );
+        schedule_request_expiry_( ip, *neighbour );
+        continue;
+      }
+      neighbour->request_expiry.reset();
+      // 请求没有得到回应，排队的数据报也不再等了
+      counters_.add( InterfaceCounters::ARP_DROPPED, neighbour->pending.size() );
+      clear_pending_( *neighbour );
+      forget_if_idle_( ip, *neighbour );
     }
   }
 }
 
 optional<EthernetFrame> NetworkInterface::maybe_send()
 {
-  if ( out_frames_.empty() ) {
+  auto frame = out_frames_.dequeue( now_ms_ );
+  count_egress_drops_();
+  if ( !frame.has_value() ) {
     return {};
   }
-  auto frame = out_frames_.front();
-  out_frames_.pop();
+  counters_.add( InterfaceCounters::FRAMES_OUT );
+  counters_.add( InterfaceCounters::BYTES_OUT, frame_size( *frame ) );
+  if ( capture_ ) {
+    capture_->write( *frame, CaptureDirection::Outbound );
+  }
   return frame;
-}
\ No newline at end of file
+}
+
+void NetworkInterface::maybe_send_all( vector<EthernetFrame>& out )
+{
+  uint64_t frames = 0;
+  uint64_t bytes = 0;
+  out.reserve( out.size() + out_frames_.size() );
+  while ( auto frame = out_frames_.dequeue( now_ms_ ) ) {
+    ++frames;
+    bytes += frame_size( *frame );
+    if ( capture_ ) {
+      capture_->write( *frame, CaptureDirection::Outbound );
+    }
+    out.push_back( std::move( *frame ) );
+  }
+  count_egress_drops_();
+  counters_.add( InterfaceCounters::FRAMES_OUT, frames );
+  counters_.add( InterfaceCounters::BYTES_OUT, bytes );
+}
+
+void NetworkInterface::queue_frame_( EthernetFrame&& frame, uint8_t tos )
+{
+  out_frames_.enqueue( std::move( frame ), tos, now_ms_ );
+  count_egress_drops_();
+}
+
+void NetworkInterface::count_egress_drops_()
+{
+  auto const dropped = out_frames_.dropped();
+  counters_.add( InterfaceCounters::EGRESS_DROPPED, dropped - egress_dropped_ );
+  egress_dropped_ = dropped;
+}
@@ -1,15 +1,26 @@
 #pragma once
 
 #include "address.hh"
+#include "egress_scheduler.hh"
 #include "ethernet_frame.hh"
+#include "interface_counters.hh"
 #include "ipv4_datagram.hh"
+#include "ipv4_flat_map.hh"
+#include "ipv4_reassembler.hh"
+#include "network_interface_config.hh"
 
+#include <algorithm>
+#include <deque>
+#include <functional>
 #include <iostream>
-#include <list>
+#include <memory>
 #include <optional>
 #include <queue>
-#include <unordered_map>
+#include <span>
 #include <utility>
+#include <vector>
+
+class PcapWriter;
 
 // A "network interface" that connects IP (the internet layer, or network layer)
 // with Ethernet (the network access layer, or link layer).
@@ -37,11 +48,17 @@ class NetworkInterface
 public:
   // Construct a network interface with given Ethernet (network-access-layer) and IP (internet-layer)
   // addresses
-  NetworkInterface( const EthernetAddress& ethernet_address, const Address& ip_address );
+  NetworkInterface( const EthernetAddress& ethernet_address,
+                    const Address& ip_address,
+                    const NetworkInterfaceConfig& config = {} );
 
   // Access queue of Ethernet frames awaiting transmission
   std::optional<EthernetFrame> maybe_send();
 
+  // Append every frame awaiting transmission to `out` (same as calling maybe_send() until it's empty),
+  // e.g. to hand a whole batch to one sendmmsg()
+  void maybe_send_all( std::vector<EthernetFrame>& out );
+
   // Sends an IPv4 datagram, encapsulated in an Ethernet frame (if it knows the Ethernet destination
   // address). Will need to use [ARP](\ref rfc::rfc826) to look up the Ethernet destination address
   // for the next hop.
@@ -49,15 +66,62 @@ public:
   // but please consider the frame sent as soon as it is generated.)
   void send_datagram( const InternetDatagram& dgram, const Address& next_hop );
 
+  // Same, for a datagram the caller is done with: its payload Buffers move into the frame
+  void send_datagram( InternetDatagram&& dgram, const Address& next_hop );
+
+  // A datagram larger than config.mtu is sent as fragments that share its payload Buffers (or
+  // dropped, if it has DF set).
+
   // Receives an Ethernet frame and responds appropriately.
-  // If type is IPv4, returns the datagram.
+  // If type is IPv4, returns the datagram (with config.reassemble_fragments, a fragment is held
+  // until the datagram is complete, and then the whole datagram is returned).
   // If type is ARP request, learn a mapping from the "sender" fields, and send an ARP reply.
   // If type is ARP reply, learn a mapping from the "sender" fields.
   std::optional<InternetDatagram> recv_frame( const EthernetFrame& frame );
 
+  // Receives a batch of frames, with the same effect as recv_frame() on each, appending the
+  // datagrams to `datagrams` and returning how many were appended. The frames are sorted by type
+  // first, and then all the IPv4 frames are handled followed by all the ARP frames. While one frame
+  // is being handled, the next one's headers are prefetched.
+  size_t recv_frames( std::span<const EthernetFrame> frames, std::vector<InternetDatagram>& datagrams );
+
   // Called periodically when time elapses
   void tick( size_t ms_since_last_tick );
 
+  // Broadcast a gratuitous ARP request announcing this interface's own mapping (e.g. after its
+  // Ethernet address changes, or when it comes up), so neighbours learn or update it without asking.
+  // Gratuitous ARP from neighbours is accepted like any other ARP message: it updates their mapping.
+  void send_gratuitous_arp();
+
+  // With config.proactive_refresh, a mapping that has been used since it was learned is re-checked
+  // with a unicast ARP request (config.request_retry_ms before it expires). It stays usable
+  // meanwhile, and the reply renews it, so a busy flow never waits for a fresh ARP round trip.
+
+  // Datagrams partly reassembled from fragments, and the bytes held for them
+  const IPv4Reassembler& reassembler() const { return reassembler_; }
+
+  // Number of next hops in the neighbour cache (learned, being resolved, or both)
+  size_t neighbours() const { return neighbours_.size(); }
+
+  // A snapshot of the interface's counters (safe to call from any thread)
+  InterfaceStats stats() const { return counters_.snapshot(); }
+
+  // Datagrams (and their bytes) queued waiting for ARP, for all next hops or for one
+  size_t pending_datagrams() const { return pending_datagrams_; }
+  size_t pending_bytes() const { return pending_bytes_; }
+  size_t pending_bytes( const Address& next_hop ) const;
+
+  // The egress queues (see NetworkInterfaceConfig::egress)
+  const EgressScheduler& egress() const { return out_frames_; }
+
+  // The counters themselves, for the owner of the interface to record its own drops (e.g. a Router)
+  InterfaceCounters& counters() { return counters_; }
+
+  // Record every frame received (by recv_frame() or recv_frames(), including those addressed to
+  // someone else) and sent (by maybe_send() or maybe_send_all()) in `writer`, which may be shared
+  // with other interfaces. A null writer stops capturing.
+  void capture( std::shared_ptr<PcapWriter> writer ) { capture_ = std::move( writer ); }
+
 private:
   // Ethernet (known as hardware, network-access, or link-layer) address of the interface
   EthernetAddress ethernet_address_;
@@ -65,11 +129,91 @@ private:
   // IP (known as Internet-layer or network-layer) address of the interface
   Address ip_address_;
 
-  std::unordered_map<uint32_t, std::pair<EthernetAddress, size_t>> ip2ether_ {};
+  NetworkInterfaceConfig config_;
+
+  // Milliseconds ticked since construction; every expiry below is an absolute time on this clock
+  uint64_t now_ms_ {};
+
+  // Everything known about one next hop, in a single table so each operation is one lookup
+  struct Neighbour
+  {
+    std::optional<EthernetAddress> ethernet_address {}; // learned mapping, if any
+    uint64_t mapping_expiry {};                          // ...and when it expires
+    std::optional<Buffer> ipv4_header {};                // serialized Ethernet header for IPv4 frames to it
+    bool used {};                                        // a datagram was sent with the mapping since it was learned
+    std::optional<uint64_t> request_expiry {};           // when a new ARP request may be sent, if one is outstanding
+    unsigned retries {};                                 // ...and how many times it has been re-sent
+    std::vector<InternetDatagram> pending {};            // datagrams waiting for the mapping
+    size_t pending_bytes {};
+  };
+  IPv4FlatMap<Neighbour> neighbours_ {};
+
+  // Mapping expiries and refreshes are a fixed time after the mapping was learned, so they are
+  // added in expiry order and each deque stays sorted. Request timeouts back off, so they go in a
+  // min-heap instead. Either way tick() only looks at the entries that are due, however many
+  // neighbours there are. An entry whose neighbour has since changed (or gone) is stale and just
+  // dropped.
+  struct Expiry
+  {
+    uint64_t at;
+    uint32_t ip;
+    bool operator>( const Expiry& other ) const { return at > other.at; }
+  };
+  std::deque<Expiry> mapping_expiry_ {};
+  std::deque<Expiry> refresh_due_ {}; // at = mapping_expiry - request_retry_ms
+  std::priority_queue<Expiry, std::vector<Expiry>, std::greater<>> request_expiry_ {};
+
+  size_t pending_datagrams_ {};
+  size_t pending_bytes_ {};
+
+  IPv4Reassembler reassembler_;
+
+  // Count a frame addressed to this interface (or broadcast); false if it is for someone else
+  bool accept_frame_( const EthernetFrame& frame );
+
+  // Handle an accepted frame of each type
+  std::optional<InternetDatagram> recv_ipv4_( const EthernetFrame& frame );
+  void recv_arp_( const EthernetFrame& frame );
+
+  // recv_frames() scratch: indexes of the IPv4 and ARP frames in the batch
+  std::vector<size_t> rx_ipv4_ {};
+  std::vector<size_t> rx_arp_ {};
+
+  // Queue an ARP request for `target_ip`, sent to `destination` (broadcast, or the known neighbour)
+  void send_arp_request_( uint32_t target_ip, const EthernetAddress& destination );
+
+  // Give the outstanding ARP request for `ip` its (backed-off) time to be answered
+  void schedule_request_expiry_( uint32_t ip, Neighbour& neighbour );
+
+  // How long before a mapping expires a proactive refresh is sent
+  uint64_t refresh_lead_() const { return std::min( config_.request_retry_ms, config_.mapping_ttl_ms ); }
+
+  // Learn (or renew) the Ethernet address of `ip` and send everything queued for it
+  void learn_( uint32_t ip, const EthernetAddress& ethernet_address );
+
+  // Send `dgram` (larger than the MTU) as fragments
+  void send_fragments_( InternetDatagram&& dgram, const Address& next_hop );
+
+  // Frame `dgram` for a neighbour whose mapping is known, sharing its serialized header
+  void push_ipv4_frame_( const Neighbour& neighbour, InternetDatagram&& dgram );
+
+  // Take `neighbour`'s queued datagrams out of the pending totals and free them
+  void clear_pending_( Neighbour& neighbour );
+
+  // Drop `ip` from the table once nothing about it is left to remember
+  void forget_if_idle_( uint32_t ip, const Neighbour& neighbour );
+
+  // Frames waiting for maybe_send(), in the order the configured scheduler picks
+  EgressScheduler out_frames_;
+
+  // Queue a frame for sending (in the class for `tos`), counting it if the scheduler drops it
+  void queue_frame_( EthernetFrame&& frame, uint8_t tos );
+
+  // Count the frames the scheduler dropped (CoDel) since the last call
+  void count_egress_drops_();
+  uint64_t egress_dropped_ {};
 
-  std::unordered_map<uint32_t, size_t> arp_timer_ {};
-  
-  std::unordered_map<size_t, std::vector<InternetDatagram>> waited_dgrams_ {};
+  InterfaceCounters counters_ {};
 
-  std::queue<EthernetFrame> out_frames_ {};
+  std::shared_ptr<PcapWriter> capture_ {};
 };
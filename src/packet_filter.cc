@@ -0,0 +1,150 @@
+#include "packet_filter.hh"
+
+#include <algorithm>
+#include <bit>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+uint32_t prefix_mask( uint8_t length )
+{
+  return length == 0 ? 0 : ~uint32_t {} << ( 32 - min<uint8_t>( length, 32 ) );
+}
+} // namespace
+
+PacketFilter::PacketFilter( span<const Rule> rules, Action default_action )
+  : rules_( rules.begin(), rules.end() ), default_action_( default_action ), hits_( rules.size() )
+{
+  // 先按 tuple 分组，知道每个 tuple 有多少条规则再建表
+  vector<vector<pair<Key, uint32_t>>> members;
+  for ( uint32_t i = 0; i < rules_.size(); ++i ) {
+    const auto& rule = rules_[i];
+    Tuple shape { prefix_mask( rule.src_length ),
+                  prefix_mask( rule.dst_length ),
+                  rule.protocol.has_value(),
+                  rule.src_port.has_value(),
+                  rule.dst_port.has_value() };
+    auto it = find_if( tuples_.begin(), tuples_.end(), [&]( const Tuple& t ) {
+      return t.src_mask == shape.src_mask && t.dst_mask == shape.dst_mask && t.protocol == shape.protocol
+             && t.src_port == shape.src_port && t.dst_port == shape.dst_port;
+    } );
+    if ( it == tuples_.end() ) {
+      shape.first_rule = i;
+      tuples_.push_back( std::move( shape ) );
+      members.emplace_back();
+      it = tuples_.end() - 1;
+    }
+    const Fields fields { rule.src_prefix,
+                          rule.dst_prefix,
+                          rule.protocol.value_or( 0 ),
+                          true,
+                          rule.src_port.value_or( 0 ),
+                          rule.dst_port.value_or( 0 ) };
+    members[it - tuples_.begin()].emplace_back( key_of( *it, fields ), i );
+  }
+
+  for ( size_t t = 0; t < tuples_.size(); ++t ) {
+    tuples_[t].slots.resize( bit_ceil( members[t].size() * 2 ) );
+    for ( const auto& [key, rule] : members[t] ) {
+      insert( tuples_[t], key, rule );
+    }
+  }
+  // tuples_ 本来就按各自第一条规则的顺序加入，不用再排序
+}
+
+PacketFilter::Fields PacketFilter::fields( const InternetDatagram& dgram )
+{
+  const auto& header = dgram.header;
+  Fields fields { header.src, header.dst, header.proto, false, 0, 0 };
+  if ( ( header.proto == IPv4Header::PROTO_TCP || header.proto == PROTO_UDP ) && header.offset == 0
+       && not dgram.payload.empty() ) {
+    // 源端口和目的端口是 TCP/UDP 头部的前 4 个字节
+    const string_view first = dgram.payload.front();
+    if ( first.size() >= 4 ) {
+      fields.has_ports = true;
+      auto const byte = [&]( size_t i ) { return static_cast<uint8_t>( first[i] ); };
+      fields.src_port = static_cast<uint16_t>( byte( 0 ) << 8 | byte( 1 ) );
+      fields.dst_port = static_cast<uint16_t>( byte( 2 ) << 8 | byte( 3 ) );
+    }
+  }
+  return fields;
+}
+
+PacketFilter::Key PacketFilter::key_of( const Tuple& tuple, const Fields& fields )
+{
+  uint64_t rest = 0;
+  if ( tuple.protocol ) {
+    rest |= static_cast<uint64_t>( fields.protocol ) << 32;
+  }
+  if ( tuple.src_port ) {
+    rest |= static_cast<uint64_t>( fields.src_port ) << 16;
+  }
+  if ( tuple.dst_port ) {
+    rest |= fields.dst_port;
+  }
+  return { static_cast<uint64_t>( fields.src & tuple.src_mask ) << 32 | ( fields.dst & tuple.dst_mask ), rest };
+}
+
+// 和 RouteTable::flow_hash 一样：乘法混合再用 murmur3 的 finalizer 打散
+size_t PacketFilter::home( const Key& key, size_t mask )
+{
+  uint64_t h = key.addresses * 0x9e3779b97f4a7c15ULL ^ key.rest;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h & mask;
+}
+
+uint32_t PacketFilter::find( const Tuple& tuple, const Key& key )
+{
+  auto const mask = tuple.slots.size() - 1;
+  for ( size_t i = home( key, mask );; i = ( i + 1 ) & mask ) {
+    const auto& slot = tuple.slots[i];
+    if ( slot.rule == NONE || slot.key == key ) {
+      return slot.rule;
+    }
+  }
+}
+
+void PacketFilter::insert( Tuple& tuple, const Key& key, uint32_t rule )
+{
+  auto const mask = tuple.slots.size() - 1;
+  size_t i = home( key, mask );
+  for ( ; tuple.slots[i].rule != NONE; i = ( i + 1 ) & mask ) {
+    if ( tuple.slots[i].key == key ) {
+      return; // 同样的字段，前面的规则先匹配，后面的永远用不上
+    }
+  }
+  tuple.slots[i] = { key, rule };
+}
+
+optional<size_t> PacketFilter::match( const Fields& fields ) const
+{
+  uint32_t best = NONE;
+  for ( const auto& tuple : tuples_ ) {
+    // 这个 tuple 里最靠前的规则都不比已经找到的靠前，后面的 tuple 更不会
+    if ( tuple.first_rule >= best ) {
+      break;
+    }
+    if ( ( tuple.src_port || tuple.dst_port ) && not fields.has_ports ) {
+      continue;
+    }
+    best = min( best, find( tuple, key_of( tuple, fields ) ) );
+  }
+  if ( best == NONE ) {
+    return {};
+  }
+  return best;
+}
+
+PacketFilter::Action PacketFilter::classify( const InternetDatagram& dgram )
+{
+  auto const rule = match( fields( dgram ) );
+  if ( not rule.has_value() ) {
+    ++default_hits_;
+    return default_action_;
+  }
+  ++hits_[*rule];
+  return rules_[*rule].action;
+}
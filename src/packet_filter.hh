@@ -0,0 +1,125 @@
+#pragma once
+
+#include "ipv4_datagram.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+// An access control list: an ordered list of rules that allow or deny datagrams by source and
+// destination prefix, protocol and TCP/UDP port. The first rule that matches decides; a datagram
+// no rule matches gets the default action.
+//
+// The rules are compiled into a tuple space (Srinivasan, Suri & Varghese, "Packet Classification
+// using Tuple Space Search"): rules that look at the same fields with the same prefix lengths share
+// a tuple, a hash table keyed by those fields. Classifying a datagram masks its fields once per
+// tuple and probes that tuple's table, so the cost grows with the number of distinct tuples, not
+// with the number of rules. Tuples are searched in order of their first rule, and the search stops
+// at the first tuple that cannot hold an earlier rule than the best match so far.
+class PacketFilter
+{
+public:
+  enum class Action : uint8_t
+  {
+    Allow,
+    Deny,
+  };
+
+  // A rule. A prefix length of 0 matches any address; an empty protocol or port matches any. A rule
+  // with a port only matches TCP and UDP datagrams that carry the port, so never a fragment after
+  // the first one (it has no ports).
+  struct Rule
+  {
+    uint32_t src_prefix {};
+    uint8_t src_length {};
+    uint32_t dst_prefix {};
+    uint8_t dst_length {};
+    std::optional<uint8_t> protocol {};
+    std::optional<uint16_t> src_port {};
+    std::optional<uint16_t> dst_port {};
+    Action action { Action::Deny };
+  };
+
+  // The fields of a datagram that rules look at
+  struct Fields
+  {
+    uint32_t src {};
+    uint32_t dst {};
+    uint8_t protocol {};
+    bool has_ports {};
+    uint16_t src_port {};
+    uint16_t dst_port {};
+  };
+
+  static constexpr uint8_t PROTO_UDP = 17;
+
+  // No rules: everything gets the default action
+  PacketFilter() = default;
+
+  // Compile `rules` (a prefix length over 32 is treated as 32)
+  explicit PacketFilter( std::span<const Rule> rules, Action default_action = Action::Allow );
+
+  // The fields of `dgram`: the ports are read only from an unfragmented TCP or UDP datagram, or the
+  // first fragment of one
+  static Fields fields( const InternetDatagram& dgram );
+
+  // Index of the first rule that matches, or empty
+  std::optional<size_t> match( const Fields& fields ) const;
+
+  // The action for `dgram`, counting a hit on the rule that decided it
+  Action classify( const InternetDatagram& dgram );
+
+  bool empty() const { return rules_.empty(); }
+  const std::vector<Rule>& rules() const { return rules_; }
+  Action default_action() const { return default_action_; }
+
+  // Datagrams decided by rule `i`, and by the default action
+  uint64_t hits( size_t i ) const { return hits_.at( i ); }
+  uint64_t default_hits() const { return default_hits_; }
+
+  // Number of tuples the rules were compiled into
+  size_t tuples() const { return tuples_.size(); }
+
+private:
+  // 一个 tuple：规则看的字段和前缀长度都一样；表里存掩码后的字段到最靠前的规则
+  struct Key
+  {
+    uint64_t addresses {}; // src << 32 | dst，已按前缀长度掩码
+    uint64_t rest {};      // protocol << 32 | src_port << 16 | dst_port，不看的字段为 0
+    bool operator==( const Key& other ) const = default;
+  };
+
+  struct Slot
+  {
+    Key key {};
+    uint32_t rule { NONE };
+  };
+
+  struct Tuple
+  {
+    uint32_t src_mask {};
+    uint32_t dst_mask {};
+    bool protocol {};
+    bool src_port {};
+    bool dst_port {};
+    uint32_t first_rule { NONE };
+    std::vector<Slot> slots {}; // 开放寻址，大小是 2 的幂，至少一半空着
+  };
+
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  static Key key_of( const Tuple& tuple, const Fields& fields );
+  static size_t home( const Key& key, size_t mask );
+
+  // The rule that `key` maps to in `tuple`, or NONE
+  static uint32_t find( const Tuple& tuple, const Key& key );
+  static void insert( Tuple& tuple, const Key& key, uint32_t rule );
+
+  std::vector<Rule> rules_ {};
+  Action default_action_ { Action::Allow };
+  std::vector<Tuple> tuples_ {};
+  std::vector<uint64_t> hits_ {};
+  uint64_t default_hits_ {};
+};
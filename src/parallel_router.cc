@@ -0,0 +1,178 @@
+#include "parallel_router.hh"
+
+#include <stdexcept>
+
+using namespace std;
+
+ParallelRouter::Worker::Worker( NetworkInterface&& iface, size_t ring_size )
+  : interface( std::move( iface ) ), rx( ring_size ), tx( ring_size )
+{}
+
+ParallelRouter::ParallelRouter( size_t ring_size )
+  : ring_size_( ring_size ), routes_( make_shared<const RouteTable>() )
+{}
+
+ParallelRouter::~ParallelRouter()
+{
+  stop();
+}
+
+size_t ParallelRouter::add_interface( NetworkInterface&& interface )
+{
+  if ( running_ ) {
+    throw runtime_error( "ParallelRouter: add_interface() after start()" );
+  }
+  workers_.push_back( make_unique<Worker>( std::move( interface ), ring_size_ ) );
+  return workers_.size() - 1;
+}
+
+void ParallelRouter::add_route( const uint32_t route_prefix,
+                                const uint8_t prefix_length,
+                                const optional<Address> next_hop,
+                                const size_t interface_num )
+{
+  add_route( route_prefix, prefix_length, { { next_hop, interface_num } } );
+}
+
+void ParallelRouter::add_route( const uint32_t route_prefix,
+                                const uint8_t prefix_length,
+                                vector<RouteTable::Path> paths )
+{
+  staged_routes_.push_back( { route_prefix, prefix_length, std::move( paths ) } );
+}
+
+void ParallelRouter::publish_routes()
+{
+  routes_.store( make_shared<const RouteTable>( staged_routes_ ), memory_order_release );
+}
+
+void ParallelRouter::load_routes( span<const RouteTable::Route> routes )
+{
+  staged_routes_.assign( routes.begin(), routes.end() );
+  publish_routes();
+}
+
+void ParallelRouter::start()
+{
+  if ( running_.exchange( true ) ) {
+    return;
+  }
+  publish_routes();
+
+  // 每对 worker 之间一个 ring：inbox[src] 只有 src 写、本 worker 读
+  for ( auto& worker : workers_ ) {
+    while ( worker->inbox.size() < workers_.size() ) {
+      worker->inbox.push_back( make_unique<SPSCQueue<Handoff>>( ring_size_ ) );
+    }
+  }
+  for ( size_t i = 0; i < workers_.size(); ++i ) {
+    workers_[i]->thread = thread( [this, i] { run( i ); } );
+  }
+}
+
+void ParallelRouter::stop()
+{
+  running_.store( false );
+  for ( auto& worker : workers_ ) {
+    if ( worker->thread.joinable() ) {
+      worker->thread.join();
+    }
+  }
+}
+
+bool ParallelRouter::recv_frame( size_t interface_num, EthernetFrame&& frame )
+{
+  return workers_.at( interface_num )->rx.push( std::move( frame ) );
+}
+
+optional<EthernetFrame> ParallelRouter::maybe_send( size_t interface_num )
+{
+  return workers_.at( interface_num )->tx.pop();
+}
+
+void ParallelRouter::tick( size_t ms_since_last_tick )
+{
+  for ( auto& worker : workers_ ) {
+    worker->pending_tick_ms.fetch_add( ms_since_last_tick, memory_order_relaxed );
+  }
+}
+
+void ParallelRouter::run( size_t self )
+{
+  while ( running_.load( memory_order_relaxed ) ) {
+    if ( not poll( self ) ) {
+      this_thread::yield();
+    }
+  }
+}
+
+bool ParallelRouter::poll( size_t self )
+{
+  auto& worker = *workers_[self];
+  bool busy = false;
+
+  if ( auto const ms = worker.pending_tick_ms.exchange( 0, memory_order_relaxed ); ms > 0 ) {
+    worker.interface.tick( ms );
+  }
+
+  // 每批只读一次路由表指针；旧表在所有 worker 放手后才释放
+  auto const table = routes_.load( memory_order_acquire );
+
+  // 收：解析帧，查路由，交给出口 worker
+  for ( size_t n = 0; n < BATCH; ++n ) {
+    auto frame = worker.rx.pop();
+    if ( not frame ) {
+      break;
+    }
+    busy = true;
+    auto dgram = worker.interface.recv_frame( *frame );
+    if ( not dgram ) {
+      continue;
+    }
+    if ( dgram->header.ttl <= 1 ) {
+      worker.interface.counters().add( InterfaceCounters::TTL_EXPIRED );
+      continue;
+    }
+    dgram->header.decrement_ttl();
+    auto const index = table->lookup( dgram->header.dst );
+    if ( index == LPMTable::NONE ) {
+      worker.interface.counters().add( InterfaceCounters::NO_ROUTE );
+      continue;
+    }
+    auto const hash = table->route( index ).paths.size() > 1 ? RouteTable::flow_hash( *dgram ) : 0;
+    const auto& path = table->path( index, hash );
+    auto const next_hop = path.next_hop.has_value() ? path.next_hop->ipv4_numeric() : dgram->header.dst;
+    if ( path.interface_num == self ) {
+      worker.interface.send_datagram( std::move( *dgram ), Address::from_ipv4_numeric( next_hop ) );
+    } else if ( path.interface_num < workers_.size() ) {
+      auto& ring = *workers_[path.interface_num]->inbox[self];
+      if ( not ring.push( { std::move( *dgram ), next_hop } ) ) {
+        dropped_.fetch_add( 1, memory_order_relaxed );
+      }
+    }
+  }
+
+  // 发：别的 worker 交过来的数据报从本接口发出
+  for ( auto& ring : worker.inbox ) {
+    for ( size_t n = 0; n < BATCH; ++n ) {
+      auto handoff = ring->pop();
+      if ( not handoff ) {
+        break;
+      }
+      busy = true;
+      worker.interface.send_datagram( std::move( handoff->dgram ), Address::from_ipv4_numeric( handoff->next_hop ) );
+    }
+  }
+
+  // TX ring 满了就先留在接口的队列里，下一批再送
+  while ( not worker.tx.full() ) {
+    auto frame = worker.interface.maybe_send();
+    if ( not frame ) {
+      break;
+    }
+    busy = true;
+    worker.tx.push( std::move( *frame ) );
+  }
+
+  return busy;
+}
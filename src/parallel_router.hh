@@ -0,0 +1,102 @@
+#pragma once
+
+#include "network_interface.hh"
+#include "route_table.hh"
+#include "spsc_queue.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+// A Router whose interfaces each run on their own worker thread.
+//
+// Frames reach an interface through an RX ring and leave through a TX ring; each ring has one
+// outside thread on the far end (e.g. the thread that owns the link). A worker parses what arrives
+// on its interface, looks up the route, and hands the datagram to the outbound interface's worker
+// over a ring dedicated to that pair of workers, so every ring stays single-producer/single-consumer
+// and the NetworkInterfaces are only ever touched by their own worker.
+//
+// The route table is read-mostly and shared RCU-style: add_route() only stages a route,
+// publish_routes() builds a new RouteTable and swaps it in atomically, and workers pick up the
+// new table at their next batch. The old table is freed when the last worker lets go of it.
+// A datagram that finds a full ring is dropped (and counted), as a real router would.
+class ParallelRouter
+{
+public:
+  static constexpr size_t DEFAULT_RING_SIZE = 1024;
+
+  explicit ParallelRouter( size_t ring_size = DEFAULT_RING_SIZE );
+  ~ParallelRouter();
+
+  ParallelRouter( const ParallelRouter& ) = delete;
+  ParallelRouter& operator=( const ParallelRouter& ) = delete;
+
+  // Add an interface (only before start()); returns its index
+  size_t add_interface( NetworkInterface&& interface );
+
+  // Stage a route (see Router::add_route); it takes effect at the next publish_routes()
+  void add_route( uint32_t route_prefix,
+                  uint8_t prefix_length,
+                  std::optional<Address> next_hop,
+                  size_t interface_num );
+  void add_route( uint32_t route_prefix, uint8_t prefix_length, std::vector<RouteTable::Path> paths );
+
+  // Swap in a table of every route staged so far (start() does this too)
+  void publish_routes();
+
+  // Replace the staged routes with `routes` and publish them
+  void load_routes( std::span<const RouteTable::Route> routes );
+
+  // Start and stop the worker threads. stop() leaves in-flight frames in the rings.
+  void start();
+  void stop();
+
+  // One outside thread per interface may use these two, concurrently with the workers
+  bool recv_frame( size_t interface_num, EthernetFrame&& frame ); // false (frame untouched) if the RX ring is full
+  std::optional<EthernetFrame> maybe_send( size_t interface_num );
+
+  // Called periodically when time elapses; each worker ticks its interface at its next batch
+  void tick( size_t ms_since_last_tick );
+
+  // A snapshot of an interface's counters (safe to call while the workers run)
+  InterfaceStats stats( size_t interface_num ) const { return workers_.at( interface_num )->interface.stats(); }
+
+  // Datagrams dropped because a ring between two workers was full
+  uint64_t dropped() const { return dropped_.load( std::memory_order_relaxed ); }
+
+private:
+  struct Handoff
+  {
+    InternetDatagram dgram {};
+    uint32_t next_hop {};
+  };
+
+  struct Worker
+  {
+    Worker( NetworkInterface&& iface, size_t ring_size );
+
+    NetworkInterface interface;
+    SPSCQueue<EthernetFrame> rx;
+    SPSCQueue<EthernetFrame> tx;
+    std::vector<std::unique_ptr<SPSCQueue<Handoff>>> inbox {}; // inbox[i]: datagrams from worker i
+    std::atomic<uint64_t> pending_tick_ms {};
+    std::thread thread {};
+  };
+
+  static constexpr size_t BATCH = 32;
+
+  void run( size_t self );
+  bool poll( size_t self ); // one batch; returns false if there was nothing to do
+
+  size_t ring_size_;
+  std::vector<std::unique_ptr<Worker>> workers_ {};
+  std::vector<RouteTable::Route> staged_routes_ {};
+  std::atomic<std::shared_ptr<const RouteTable>> routes_;
+  std::atomic<bool> running_ { false };
+  std::atomic<uint64_t> dropped_ {};
+};
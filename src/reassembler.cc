@@ -1,6 +1,10 @@
 #include "reassembler.hh"
+#include "parser.hh"
+#include "profile.hh"
 
 #include <algorithm>
+#include <bit>
+#include <cstring>
 #include <ranges>
 #include <iostream>
 
@@ -14,6 +18,17 @@ using namespace std;
  * 5. 是否最后的数据，1） 可以全部缓存或写入  2）只能缓存或插入部分
  */
 void Reassembler::insert( uint64_t first_index, string data, bool is_last_substring, Writer& output )
+{
+  const ProfileScope<Profile::REASSEMBLER_INSERT> profile;
+  count_arrival( first_index, data.size(), output );
+  if ( engine_ == Engine::Bitmap ) {
+    insert_bitmap( first_index, Buffer { std::move( data ) }, is_last_substring, output );
+  } else {
+    insert_intervals( first_index, std::move( data ), is_last_substring, output );
+  }
+}
+
+void Reassembler::insert_intervals( uint64_t first_index, string data, bool is_last_substring, Writer& output )
 {
   if ( data.empty() ) {
     if ( is_last_substring ) {
@@ -45,7 +60,9 @@ void Reassembler::insert( uint64_t first_index, string data, bool is_last_substr
   if ( data_left == next_stream_index_
        && ( store_buffer_.empty() || data_right < get<1>( store_buffer_.front() ) ) ) {
     if ( !store_buffer_.empty() ) {
-      data.resize( min( data_right, get<0>( store_buffer_.front() ) ) - data_left );
+      auto const size = min( data_right, get<0>( store_buffer_.front() ) ) - data_left;
+      stats_.bytes_duplicate += data.size() - size;
+      data.resize( size );
     }
     push_data_to_stream( std::move( data ), output );
   } else {
@@ -56,6 +73,54 @@ void Reassembler::insert( uint64_t first_index, string data, bool is_last_substr
   return;
 }
 
+/**
+ * 按序到达的部分（直到窗口尾或第一段暂存数据）直接把 data 的切片写入 stream，不拷贝；
+ * 剩下的部分只拷贝窗口内的字节（拷进池里的 string，或者 Bitmap 的 ring_）去暂存
+ */
+void Reassembler::insert( uint64_t first_index, Buffer data, bool is_last_substring, Writer& output )
+{
+  const ProfileScope<Profile::REASSEMBLER_INSERT> profile;
+  count_arrival( first_index, data.size(), output );
+  auto const data_end = first_index + data.size();
+  auto const window_end = next_stream_index_ + output.available_capacity();
+  auto const rest_is_last = is_last_substring && data_end <= window_end;
+
+  if ( first_index <= next_stream_index_ && next_stream_index_ < min( data_end, window_end ) ) {
+    auto end = min( data_end, window_end );
+    if ( engine_ == Engine::Intervals && !store_buffer_.empty() ) {
+      end = min( end, get<0>( store_buffer_.front() ) );
+    }
+    if ( engine_ == Engine::Bitmap && !ring_.empty() ) {
+      auto const replaced = mark_range( next_stream_index_, end, false );
+      store_data_size_ -= replaced;
+      stats_.bytes_duplicate += replaced;
+    }
+    auto const begin = next_stream_index_;
+    push_data_to_stream( data.substr( begin - first_index, end - begin ), output );
+    data = data.substr( end - first_index );
+    first_index = end;
+  }
+
+  auto const left = max( first_index, next_stream_index_ );
+  auto const right = min( data_end, window_end );
+  if ( left < right ) {
+    if ( engine_ == Engine::Bitmap ) {
+      // ring_ 自己会拷贝，这里不用
+      insert_bitmap( left, data.substr( left - first_index, right - left ), rest_is_last, output );
+    } else {
+      auto rest = Buffer::pooled_string( right - left );
+      rest.assign( string_view { data }.substr( left - first_index, right - left ) );
+      insert_intervals( left, std::move( rest ), rest_is_last, output );
+    }
+  } else if ( engine_ == Engine::Bitmap ) {
+    insert_bitmap( data_end, Buffer {}, rest_is_last, output );
+  } else {
+    // 没有可暂存的字节，但仍然要记录结束标记、推入紧接着的暂存数据
+    had_last_ |= rest_is_last;
+    push_store_data_to_stream( output );
+  }
+}
+
 // 将数据推入字节流
 void Reassembler::push_data_to_stream( std::string data, Writer& output ) noexcept
 {
@@ -63,6 +128,12 @@ void Reassembler::push_data_to_stream( std::string data, Writer& output ) noexce
   output.push( std::move( data ) );
 }
 
+void Reassembler::push_data_to_stream( Buffer data, Writer& output ) noexcept
+{
+  next_stream_index_ += data.size();
+  output.push( std::move( data ) );
+}
+
 // 暂存数据
 void Reassembler::store_data( std::string data, uint64_t begin, uint64_t end ) noexcept
 {
@@ -74,15 +145,19 @@ void Reassembler::store_data( std::string data, uint64_t begin, uint64_t end ) n
   if ( right != left ) {data_right = max( data_right, get<1>( *prev(right) ) );}
 
   store_data_size_ += data_right - data_left + 1;
+  stats_.merges += right - left;
   if ( data.size() == data_right - data_left + 1 && left == right ) {
     store_buffer_.emplace( left, data_left, data_right, std::move( data ) );
     return;
   }
-  std::string temp_s( data_right - data_left + 1, 0 );
+  std::string temp_s = Buffer::pooled_string( data_right - data_left + 1 );
+  temp_s.resize( data_right - data_left + 1 );
 
   for ( auto&& node : std::views::iota( left, right ) ) {
     auto& [l, r, s] = *node;
     store_data_size_ -= s.size();
+    // 合并后的区间长度 = 新数据 + 旧区间 - 重叠部分
+    stats_.bytes_duplicate += data.size() + s.size() - ( max( end, r ) - min( begin, l ) + 1 );
     std::ranges::copy( s, temp_s.begin() + l - data_left );
   }
   std::ranges::copy( data, temp_s.begin() + begin - data_left );
@@ -92,17 +167,259 @@ void Reassembler::store_data( std::string data, uint64_t begin, uint64_t end ) n
 // 将暂存的数据推入字节流
 void Reassembler::push_store_data_to_stream( Writer& output ) noexcept
 {
-  while ( !store_buffer_.empty() && get<0>( store_buffer_.front() ) == next_stream_index_ ) {
-    store_data_size_ -= get<2>( store_buffer_.front() ).size();
-    push_data_to_stream( std::move( get<2>( store_buffer_.front() ) ), output );
-    store_buffer_.pop_front();
+  auto it = store_buffer_.begin();
+  while ( it != store_buffer_.end() && get<0>( *it ) == next_stream_index_ ) {
+    store_data_size_ -= get<2>( *it ).size();
+    push_data_to_stream( std::move( get<2>( *it ) ), output );
+    ++it;
   }
+  // 一次性删除已经写入的前缀，避免逐个从 vector 头部删除
+  store_buffer_.erase( store_buffer_.begin(), it );
+  stats_.intervals = store_buffer_.size();
+  stats_.intervals_peak = max( stats_.intervals_peak, stats_.intervals );
   if ( had_last_ && store_buffer_.empty() ) {
     output.close();
   }
 }
 
+/**
+ * Bitmap engine：ring_ 在第一次插入时按字节流容量分配；容量变大（接收缓冲自动调整）后，等没有暂存字节时再重新分配。
+ * 窗口 [next_stream_index_, next_stream_index_ + available_capacity) 的长度限制在 ring_ 大小以内，
+ * 所以窗口内的流下标对 ring_ 取模后不会互相覆盖。
+ * 按序到达的数据直接写入 stream，乱序数据拷贝进 ring_ 并置位，store_data_size_ 就是置位的个数。
+ */
+void Reassembler::insert_bitmap( uint64_t first_index, Buffer data, bool is_last_substring, Writer& output )
+{
+  auto const capacity = output.available_capacity() + output.reader().bytes_buffered();
+  if ( ring_.empty() || ( ring_.size() < capacity && store_data_size_ == 0 ) ) {
+    ring_.assign( capacity, 0 );
+    present_.assign( ( ring_.size() + 63 ) / 64, 0 );
+  }
+
+  auto const window_end = next_stream_index_ + min<uint64_t>( output.available_capacity(), ring_.size() );
+  auto data_left = max( first_index, next_stream_index_ );
+  auto data_right = min( first_index + data.size(), window_end );
+  if ( first_index + data.size() > window_end ) {
+    is_last_substring = false;
+  }
+  had_last_ |= is_last_substring;
+
+  if ( data_left < data_right ) {
+    auto const bytes = string_view { data }.substr( data_left - first_index, data_right - data_left );
+    if ( data_left == next_stream_index_ ) {
+      // 按序到达：直接写入 stream，之前暂存在这段区间里的字节作废
+      auto const replaced = mark_range( data_left, data_right, false );
+      store_data_size_ -= replaced;
+      stats_.bytes_duplicate += replaced;
+      if ( bytes.size() != data.size() ) {
+        data = data.substr( data_left - first_index, bytes.size() );
+      }
+      push_data_to_stream( std::move( data ), output );
+    } else {
+      auto const begin = data_left % ring_.size();
+      auto const first_part = min<uint64_t>( bytes.size(), ring_.size() - begin );
+      memcpy( ring_.data() + begin, bytes.data(), first_part );
+      memcpy( ring_.data(), bytes.data() + first_part, bytes.size() - first_part );
+      auto const added = mark_range( data_left, data_right, true );
+      store_data_size_ += added;
+      stats_.bytes_duplicate += bytes.size() - added;
+    }
+  }
+
+  // 把紧接着 next_stream_index_ 的已到达字节推入 stream（最多分两段，因为 ring_ 可能绕回）
+  auto run = present_run( next_stream_index_, store_data_size_ );
+  while ( run > 0 ) {
+    auto const begin = next_stream_index_ % ring_.size();
+    auto const len = min<uint64_t>( run, ring_.size() - begin );
+    store_data_size_ -= mark_range( next_stream_index_, next_stream_index_ + len, false );
+    auto bytes = Buffer::pooled_string( len );
+    bytes.assign( ring_, begin, len );
+    push_data_to_stream( std::move( bytes ), output );
+    run -= len;
+  }
+
+  if ( had_last_ && store_data_size_ == 0 ) {
+    output.close();
+  }
+}
+
+uint64_t Reassembler::mark_range( uint64_t begin, uint64_t end, bool present ) noexcept
+{
+  uint64_t changed = 0;
+  while ( begin < end ) {
+    auto const pos = begin % ring_.size();
+    auto const bit = pos % 64;
+    auto const len = min( { 64 - bit, end - begin, ring_.size() - pos } );
+    auto const mask = ( len == 64 ? ~uint64_t {} : ( ( uint64_t { 1 } << len ) - 1 ) ) << bit;
+    auto& word = present_[pos / 64];
+    changed += popcount( present ? ( mask & ~word ) : ( mask & word ) );
+    word = present ? ( word | mask ) : ( word & ~mask );
+    begin += len;
+  }
+  return changed;
+}
+
+uint64_t Reassembler::present_run( uint64_t begin, uint64_t max_len, bool present ) const noexcept
+{
+  uint64_t len = 0;
+  while ( len < max_len ) {
+    auto const pos = ( begin + len ) % ring_.size();
+    auto const bit = pos % 64;
+    auto const word = present ? present_[pos / 64] : ~present_[pos / 64];
+    auto const ones = min<uint64_t>( countr_one( word >> bit ), ring_.size() - pos );
+    len += ones;
+    // 在字更前面遇到了相反的位，说明连续区间结束
+    if ( bit + ones < 64 && pos + ones < ring_.size() ) {
+      break;
+    }
+  }
+  return min( len, max_len );
+}
+
+void Reassembler::stored_ranges( vector<pair<uint64_t, uint64_t>>& out, size_t max_ranges ) const
+{
+  auto const first = out.size();
+  auto add = [&]( uint64_t begin, uint64_t end ) {
+    // 首尾相接的区间合并成一个
+    if ( out.size() > first && out.back().second == begin ) {
+      out.back().second = end;
+      return true;
+    }
+    if ( out.size() - first == max_ranges ) {
+      return false;
+    }
+    out.emplace_back( begin, end );
+    return true;
+  };
+
+  if ( engine_ == Engine::Intervals ) {
+    for ( auto const& [begin, last, data] : store_buffer_ ) {
+      if ( !add( begin, last + 1 ) ) {
+        break;
+      }
+    }
+    return;
+  }
+
+  // Bitmap engine：交替跳过未到达、收集已到达的字节，直到找完所有暂存的字节
+  auto pos = next_stream_index_;
+  auto remaining = store_data_size_;
+  while ( remaining > 0 ) {
+    pos += present_run( pos, ring_.size(), false );
+    auto const len = present_run( pos, remaining );
+    if ( !add( pos, pos + len ) ) {
+      break;
+    }
+    pos += len;
+    remaining -= len;
+  }
+}
+
+// 下一个需要的下标、结束标记，然后是暂存的各段（起点、长度、字节）；Bitmap 的段从 ring_ 里拷出来，可能绕回开头
+void Reassembler::checkpoint( Serializer& out ) const
+{
+  out.integer( next_stream_index_ );
+  out.integer( static_cast<uint8_t>( had_last_ ) );
+  if ( engine_ == Engine::Intervals ) {
+    out.integer( static_cast<uint64_t>( store_buffer_.size() ) );
+    for ( auto const& [begin, last, data] : store_buffer_ ) {
+      out.integer( begin );
+      out.integer( static_cast<uint64_t>( data.size() ) );
+      memcpy( out.extend( data.size() ), data.data(), data.size() );
+    }
+    return;
+  }
+
+  vector<pair<uint64_t, uint64_t>> ranges;
+  if ( store_data_size_ > 0 ) {
+    stored_ranges( ranges, SIZE_MAX );
+  }
+  out.integer( static_cast<uint64_t>( ranges.size() ) );
+  for ( auto const& [begin, end] : ranges ) {
+    out.integer( begin );
+    out.integer( end - begin );
+    auto const pos = begin % ring_.size();
+    auto const first_part = min<uint64_t>( end - begin, ring_.size() - pos );
+    char* bytes = out.extend( end - begin );
+    memcpy( bytes, ring_.data() + pos, first_part );
+    memcpy( bytes + first_part, ring_.data(), end - begin - first_part );
+  }
+}
+
+// 各段重新 insert：哪种引擎都按自己的方式存下来（这时它们都在 next_stream_index_ 之后，不会写入 stream）
+void Reassembler::restore( Parser& in, Writer& output )
+{
+  uint64_t next_index {};
+  uint8_t had_last {};
+  uint64_t pieces {};
+  in.integer( next_index );
+  in.integer( had_last );
+  in.integer( pieces );
+  if ( in.has_error() or next_index != output.bytes_pushed() ) {
+    in.set_error();
+    return;
+  }
+
+  store_data_size_ = 0;
+  store_buffer_.clear();
+  ring_.clear();
+  present_.clear();
+  next_stream_index_ = next_index;
+  had_last_ = false;
+  for ( uint64_t i = 0; i < pieces and not in.has_error(); ++i ) {
+    uint64_t first {};
+    uint64_t size {};
+    Buffer bytes;
+    in.integer( first );
+    in.integer( size );
+    in.buffer( size, bytes );
+    if ( in.has_error() or first <= next_stream_index_ ) {
+      in.set_error();
+      return;
+    }
+    insert( first, std::move( bytes ), false, output );
+  }
+  had_last_ = had_last;
+  stats_ = {};
+  stats_.intervals = store_buffer_.size();
+  stats_.intervals_peak = stats_.intervals;
+}
+
+// 统计：超出容量被丢弃的字节、已经写入 stream 的重复字节、乱序距离
+void Reassembler::count_arrival( uint64_t first_index, uint64_t size, const Writer& output ) noexcept
+{
+  auto const data_end = first_index + size;
+  auto const window_end = next_stream_index_ + output.available_capacity();
+  if ( data_end > window_end ) {
+    stats_.bytes_dropped += data_end - max( first_index, window_end );
+  }
+  if ( first_index < next_stream_index_ ) {
+    stats_.bytes_duplicate += min( data_end, next_stream_index_ ) - first_index;
+  } else if ( first_index > next_stream_index_ && size > 0 ) {
+    auto const bucket = bit_width( first_index - next_stream_index_ ) - 1;
+    ++stats_.out_of_order_distance[min<size_t>( bucket, stats_.out_of_order_distance.size() - 1 )];
+  }
+}
+
+const Reassembler::Stats& Reassembler::stats() const noexcept
+{
+  return stats_;
+}
+
 uint64_t Reassembler::bytes_pending() const noexcept
 {
   return store_data_size_;
 }
+
+void Reassembler::release_memory()
+{
+  if ( store_data_size_ != 0 ) {
+    return;
+  }
+  store_buffer_.clear();
+  store_buffer_.shrink_to_fit();
+  ring_.clear();
+  ring_.shrink_to_fit();
+  present_.clear();
+  present_.shrink_to_fit();
+}
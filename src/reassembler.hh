@@ -2,13 +2,24 @@
 
 #include "byte_stream.hh"
 
-#include <list>
+#include <array>
 #include <string>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 class Reassembler
 {
 public:
+  // How out-of-order bytes are kept until the gaps before them are filled
+  enum class Engine
+  {
+    Intervals, // a sorted vector of (first, last, bytes) intervals, merged on overlap
+    Bitmap,    // one ring sized to the stream's capacity, plus a bitmap of which bytes are present
+  };
+
+  explicit Reassembler( Engine engine = Engine::Intervals ) : engine_( engine ) {}
+
   /*
    * Insert a new substring to be reassembled into a ByteStream.
    *   `first_index`: the index of the first byte of the substring
@@ -31,20 +42,75 @@ public:
    */
   void insert( uint64_t first_index, std::string data, bool is_last_substring, Writer& output );
 
+  // Same as above, but `data` may be a slice of a shared Buffer (e.g. a segment's payload).
+  // Bytes that can be written right away go to the stream as slices of `data` without being
+  // copied; only bytes that have to be stored out of order are copied.
+  void insert( uint64_t first_index, Buffer data, bool is_last_substring, Writer& output );
+
   // How many bytes are stored in the Reassembler itself?
   uint64_t bytes_pending() const noexcept;
 
+  // Give back the storage kept for out-of-order bytes while none are pending (the Bitmap engine
+  // allocates its ring again on the next insert)
+  void release_memory();
+
+  // Save the bytes stored out of order (as (index, bytes) pieces, whatever the engine), the next
+  // index needed and whether the last substring has been seen. restore() brings them back into a
+  // Reassembler of either engine, writing to `output`, which must already be restored to the point
+  // the checkpoint was taken (see ByteStream::restore()). The stats start again from zero.
+  void checkpoint( Serializer& out ) const;
+  void restore( Parser& in, Writer& output );
+
+  // Counters for monitoring why the Reassembler holds (or throws away) memory. Always kept; each
+  // insert updates a handful of integers.
+  struct Stats
+  {
+    uint64_t bytes_dropped {};   // bytes beyond the stream's available capacity
+    uint64_t bytes_duplicate {}; // bytes that had already been written or were already stored
+    uint64_t intervals {};       // separate stored intervals right now (Intervals engine)
+    uint64_t intervals_peak {};  // most separate stored intervals at once (Intervals engine)
+    uint64_t merges {};          // stored intervals merged with a newly stored substring (Intervals engine)
+
+    // Substrings that arrived ahead of the next needed byte, by distance d: bucket k counts
+    // 2^k <= d < 2^(k+1) (the last bucket also counts everything farther away)
+    std::array<uint64_t, 32> out_of_order_distance {};
+  };
+  const Stats& stats() const noexcept;
+
+  // Append the stream-index ranges [first, last) that are stored (waiting for earlier bytes),
+  // lowest first, up to `max_ranges` of them (e.g. to report as SACK blocks)
+  void stored_ranges( std::vector<std::pair<uint64_t, uint64_t>>& out, size_t max_ranges ) const;
+
 private:
   // 将数据推入字节流
   void push_data_to_stream( std::string data, Writer& output ) noexcept;
+  void push_data_to_stream( Buffer data, Writer& output ) noexcept;
   // 暂存数据
   void store_data( std::string data, uint64_t begin, uint64_t end ) noexcept;
   // 将暂存的数据推入字节流
   void push_store_data_to_stream( Writer& output ) noexcept;
 
+  // Intervals engine
+  void insert_intervals( uint64_t first_index, std::string data, bool is_last_substring, Writer& output );
+  // Bitmap engine: insert 是一次 memcpy 加置位
+  void insert_bitmap( uint64_t first_index, Buffer data, bool is_last_substring, Writer& output );
+  // 把 ring_ 中 [begin, end) 对应的位置为 present，返回状态发生变化的位数（下标是流下标）
+  uint64_t mark_range( uint64_t begin, uint64_t end, bool present ) noexcept;
+  // 从流下标 begin 开始连续已到达（present = false 时为连续未到达）的字节数，最多 max_len
+  uint64_t present_run( uint64_t begin, uint64_t max_len, bool present = true ) const noexcept;
+
+  // 统计新到达的子串（丢弃、重复、乱序距离）
+  void count_arrival( uint64_t first_index, uint64_t size, const Writer& output ) noexcept;
+
+  Engine engine_;
+  Stats stats_ {};
+
   uint64_t store_data_size_ {};   // 暂存的数据大小
   uint64_t next_stream_index_ {}; // 下一个需要的字节下标
   using DataNode = std::tuple<uint64_t, uint64_t, std::string>;
-  std::list<DataNode> store_buffer_ {};
+  std::vector<DataNode> store_buffer_ {}; // 按区间起点有序、互不重叠，可以二分查找
   bool had_last_ {};
+
+  std::string ring_ {};             // Bitmap engine: 容量等于字节流容量，流下标 i 存在 ring_[i % size]
+  std::vector<uint64_t> present_ {}; // Bitmap engine: ring_ 中每个字节是否已到达
 };
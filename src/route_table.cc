@@ -0,0 +1,151 @@
+#include "route_table.hh"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+uint32_t parse_ipv4( const string& text, size_t line_number )
+{
+  in_addr addr {};
+  if ( inet_pton( AF_INET, text.c_str(), &addr ) != 1 ) {
+    throw runtime_error( "routes line " + to_string( line_number ) + ": bad address \"" + text + "\"" );
+  }
+  return be32toh( addr.s_addr );
+}
+} // namespace
+
+RouteTable::RouteTable( span<const Route> routes ) : routes_( routes.begin(), routes.end() )
+{
+  // 按（去掉主机位的）地址顺序插入，第一层表顺序写入而不是随机跳；
+  // 低 32 位放下标，排序保持稳定，同一前缀先出现的仍然优先
+  vector<uint64_t> order;
+  order.reserve( routes_.size() );
+  for ( uint32_t i = 0; i < routes_.size(); ++i ) {
+    if ( routes_[i].paths.empty() ) {
+      throw runtime_error( "RouteTable: a route needs at least one path" );
+    }
+    auto const length = routes_[i].prefix_length;
+    auto const mask = length == 0 ? 0 : length >= 32 ? UINT32_MAX : UINT32_MAX << ( 32 - length );
+    order.push_back( static_cast<uint64_t>( routes_[i].route_prefix & mask ) << 32 | i );
+  }
+  sort( order.begin(), order.end() );
+
+  for ( auto const key : order ) {
+    auto const index = static_cast<uint32_t>( key );
+    lpm_table_.insert( routes_[index].route_prefix, routes_[index].prefix_length, index );
+  }
+}
+
+vector<RouteTable::Route> RouteTable::parse( istream& input )
+{
+  vector<Route> routes;
+  string line;
+  for ( size_t line_number = 1; getline( input, line ); ++line_number ) {
+    // 手工按空白切分，比每行一个 istringstream 快得多
+    vector<string_view> fields;
+    for ( string_view rest = line; not rest.empty(); ) {
+      auto const start = rest.find_first_not_of( " \t\r" );
+      if ( start == string_view::npos ) {
+        break;
+      }
+      rest.remove_prefix( start );
+      auto const end = min( rest.find_first_of( " \t\r" ), rest.size() );
+      fields.push_back( rest.substr( 0, end ) );
+      rest.remove_prefix( end );
+    }
+    if ( fields.empty() || fields.front().front() == '#' ) {
+      continue;
+    }
+
+    const auto fail = [&]( const string& what ) {
+      throw runtime_error( "routes line " + to_string( line_number ) + ": " + what );
+    };
+
+    const auto prefix = fields.front();
+    auto const slash = prefix.find( '/' );
+    unsigned length {};
+    if ( slash == string_view::npos || slash + 1 == prefix.size()
+         || from_chars( prefix.data() + slash + 1, prefix.data() + prefix.size(), length ).ptr
+              != prefix.data() + prefix.size()
+         || length > 32 ) {
+      fail( "bad prefix \"" + string { prefix } + "\"" );
+    }
+
+    Route route;
+    route.route_prefix = parse_ipv4( string { prefix.substr( 0, slash ) }, line_number );
+    route.prefix_length = static_cast<uint8_t>( length );
+
+    if ( fields.size() < 3 ) {
+      fail( "no next hop" );
+    }
+    if ( fields.size() % 2 == 0 ) {
+      fail( "next hop without an interface" );
+    }
+    for ( size_t f = 1; f < fields.size(); f += 2 ) {
+      size_t interface_num {};
+      const auto iface = fields[f + 1];
+      if ( from_chars( iface.data(), iface.data() + iface.size(), interface_num ).ptr != iface.data() + iface.size() ) {
+        fail( "bad interface \"" + string { iface } + "\"" );
+      }
+      optional<Address> next_hop;
+      if ( fields[f] != "-" ) {
+        next_hop = Address::from_ipv4_numeric( parse_ipv4( string { fields[f] }, line_number ) );
+      }
+      route.paths.push_back( { next_hop, interface_num } );
+    }
+    routes.push_back( std::move( route ) );
+  }
+  return routes;
+}
+
+void RouteTable::add( const uint32_t route_prefix,
+                      const uint8_t prefix_length,
+                      const optional<Address> next_hop,
+                      const size_t interface_num )
+{
+  add( route_prefix, prefix_length, vector<Path> { { next_hop, interface_num } } );
+}
+
+void RouteTable::add( const uint32_t route_prefix, const uint8_t prefix_length, vector<Path> paths )
+{
+  if ( paths.empty() ) {
+    throw runtime_error( "RouteTable: a route needs at least one path" );
+  }
+  lpm_table_.insert( route_prefix, prefix_length, routes_.size() );
+  routes_.push_back( { route_prefix, prefix_length, std::move( paths ) } );
+}
+
+uint32_t RouteTable::flow_hash( const InternetDatagram& dgram )
+{
+  static constexpr uint8_t PROTO_UDP = 17;
+
+  const auto& header = dgram.header;
+  uint32_t ports = 0;
+  if ( ( header.proto == IPv4Header::PROTO_TCP || header.proto == PROTO_UDP ) && not header.mf
+       && header.offset == 0 && not dgram.payload.empty() ) {
+    // 源端口和目的端口是 TCP/UDP 头部的前 4 个字节
+    const string_view first = dgram.payload.front();
+    if ( first.size() >= 4 ) {
+      for ( size_t i = 0; i < 4; ++i ) {
+        ports = ports << 8 | static_cast<uint8_t>( first[i] );
+      }
+    }
+  }
+
+  // 64 位乘法混合，再用 murmur3 的 finalizer 打散
+  uint64_t h = ( static_cast<uint64_t>( header.src ) << 32 | header.dst ) * 0x9e3779b97f4a7c15ULL;
+  h ^= static_cast<uint64_t>( ports ) << 8 | header.proto;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return static_cast<uint32_t>( h );
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "address.hh"
+#include "ipv4_datagram.hh"
+#include "lpm_table.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <span>
+#include <vector>
+
+// A router's forwarding rules, with the LPMTable that finds the longest match for a destination
+class RouteTable
+{
+public:
+  // One way out: the next hop (empty if the network is directly attached) and the interface to use
+  struct Path
+  {
+    std::optional<Address> next_hop {};
+    size_t interface_num {};
+  };
+
+  struct Route
+  {
+    uint32_t route_prefix {};
+    uint8_t prefix_length {};
+    std::vector<Path> paths {}; // equal-cost paths; each flow sticks to one of them
+  };
+
+  RouteTable() = default;
+
+  // Build the table from many routes in one pass (shortest prefixes first, so no second-level group
+  // is ever rewritten). Same precedence as adding them one at a time in this order.
+  explicit RouteTable( std::span<const Route> routes );
+
+  // Read routes from text, one per line: `prefix/length next_hop interface`, with `-` as the next hop
+  // of a directly attached network and further `next_hop interface` pairs for equal-cost paths.
+  // Blank lines and lines starting with `#` are skipped. Throws runtime_error on a malformed line.
+  static std::vector<Route> parse( std::istream& input );
+
+  // Add a route; an earlier route for the same prefix takes precedence
+  void add( uint32_t route_prefix, uint8_t prefix_length, std::optional<Address> next_hop, size_t interface_num );
+  void add( uint32_t route_prefix, uint8_t prefix_length, std::vector<Path> paths );
+
+  // Index of the longest route matching `dst_ip`, or LPMTable::NONE
+  uint32_t lookup( uint32_t dst_ip ) const { return lpm_table_.lookup( dst_ip ); }
+
+  // Same for a burst of destinations (see LPMTable::lookup_burst())
+  void lookup_burst( std::span<const uint32_t> dst_ips, std::span<uint32_t> indices ) const
+  {
+    lpm_table_.lookup_burst( dst_ips, indices );
+  }
+
+  const Route& route( uint32_t index ) const { return routes_[index]; }
+  const std::vector<Route>& routes() const { return routes_; }
+
+  // The path of route `index` that carries the flow with this hash (see flow_hash())
+  const Path& path( uint32_t index, uint32_t hash ) const
+  {
+    const auto& paths = routes_[index].paths;
+    // 乘法代替取模，把 32 位散列均匀映射到 [0, paths.size())
+    return paths[( static_cast<uint64_t>( hash ) * paths.size() ) >> 32];
+  }
+
+  // Hash of the datagram's flow: addresses and protocol, plus the TCP or UDP ports if this is not
+  // a fragment (fragments carry no ports, and all fragments of a datagram must take the same path)
+  static uint32_t flow_hash( const InternetDatagram& dgram );
+
+private:
+  std::vector<Route> routes_ {};
+  LPMTable lpm_table_ {};
+};
@@ -1,10 +1,18 @@
 #include "router.hh"
 
-#include <iostream>
+#include "log.hh"
+#include "profile.hh"
+
+#include <algorithm>
+#include <bit>
 #include <limits>
 
 using namespace std;
 
+Router::Router( const size_t route_cache_size )
+  : route_cache_( route_cache_size == 0 ? 0 : bit_ceil( route_cache_size ) )
+{}
+
 // route_prefix: The "up-to-32-bit" IPv4 address prefix to match the datagram's destination address against
 // prefix_length: For this route to be applicable, how many high-order (most-significant) bits of
 //    the route_prefix will need to match the corresponding bits of the datagram's destination address?
@@ -16,61 +24,196 @@ void Router::add_route( const uint32_t route_prefix,
                         const optional<Address> next_hop,
                         const size_t interface_num )
 {
-  cerr << "DEBUG: adding route " << Address::from_ipv4_numeric( route_prefix ).ip() << "/"
-       << static_cast<int>( prefix_length ) << " => " << ( next_hop.has_value() ? next_hop->ip() : "(direct)" )
-       << " on interface " << interface_num << "\n";
+  log<LogLevel::Debug>( [&]( ostream& out ) {
+    out << "adding route " << Address::from_ipv4_numeric( route_prefix ).ip() << "/"
+        << static_cast<int>( prefix_length ) << " => " << ( next_hop.has_value() ? next_hop->ip() : "(direct)" )
+        << " on interface " << interface_num;
+  } );
+
+  add_route( route_prefix, prefix_length, { { next_hop, interface_num } } );
+}
+
+void Router::add_route( const uint32_t route_prefix,
+                        const uint8_t prefix_length,
+                        vector<RouteTable::Path> paths )
+{
+  routing_table_.add( route_prefix, prefix_length, std::move( paths ) );
+  invalidate_route_cache_();
+}
+
+void Router::load_routes( span<const RouteTable::Route> routes )
+{
+  log<LogLevel::Info>( [&]( ostream& out ) { out << "loading " << routes.size() << " routes"; } );
+  routing_table_ = RouteTable { routes };
+  invalidate_route_cache_();
+}
+
+void Router::enable_nat( size_t outside, const NatTable::Config& config )
+{
+  log<LogLevel::Info>( [&]( ostream& out ) {
+    out << "NAT to " << Address::from_ipv4_numeric( config.external_ip ).ip() << " on interface " << outside;
+  } );
+  nat_.emplace( config );
+  nat_outside_ = outside;
+}
+
+void Router::tick( uint64_t ms_since_last_tick )
+{
+  if ( nat_.has_value() ) {
+    nat_->tick( ms_since_last_tick );
+  }
+}
+
+const RouteTable::Route* Router::lookup( uint32_t dst_ip )
+{
+  auto const index = longest_prefix_match_( dst_ip );
+  return index == LPMTable::NONE ? nullptr : &routing_table_.route( index );
+}
 
-  routing_table_.emplace_back( route_prefix, prefix_length, next_hop, interface_num );
+void Router::invalidate_route_cache_()
+{
+  // generation 回绕时真的清空一次
+  if ( ++cache_generation_ == 0 ) {
+    fill( route_cache_.begin(), route_cache_.end(), CacheEntry {} );
+    cache_generation_ = 1;
+  }
 }
 
 void Router::route()
 {
-  for ( auto& current_interface : interfaces_ ) {
-    auto received_dgram = current_interface.maybe_receive();
-    if ( received_dgram.has_value() ) {
-      auto& dgram = received_dgram.value();
-      if ( dgram.header.ttl > 1 ) {
-        dgram.header.ttl--;
-        // NOTE: important!!!
-        dgram.header.compute_checksum();
-        auto dst_ip = dgram.header.dst;
-        auto it = longest_prefix_match_( dst_ip );
-        if ( it != routing_table_.end() ) {
-          auto& target_interface = interface( it->interface_num );
-          target_interface.send_datagram( dgram, it->next_hop.value_or( Address::from_ipv4_numeric( dst_ip ) ) );
-        }
+  while ( route_batch() > 0 ) {}
+}
+
+size_t Router::route_batch( const size_t budget )
+{
+  const ProfileScope<Profile::ROUTER_ROUTE> profile;
+  auto const n = interfaces_.size();
+  burst_.clear();
+  burst_ingress_.clear();
+  burst_dst_.clear();
+  size_t taken = 0;
+  for ( size_t round = 0; round < budget; ++round ) {
+    // 每一轮从每个接口各取一个，忙的接口不会饿死闲的接口
+    size_t taken_this_round = 0;
+    for ( size_t k = 0; k < n; ++k ) {
+      auto const ingress = ( next_interface_ + k ) % n;
+      auto received_dgram = interfaces_[ingress].maybe_receive();
+      if ( !received_dgram.has_value() ) {
+        continue;
+      }
+      ++taken_this_round;
+      // ACL 在一切之前：拒绝的不减 TTL，也不查路由
+      if ( !filter_.empty() && filter_.classify( *received_dgram ) == PacketFilter::Action::Deny ) {
+        interfaces_[ingress].counters().add( InterfaceCounters::FILTERED );
+        continue;
+      }
+      // TTL 到期的直接丢掉，不查路由
+      auto& header = received_dgram->header;
+      if ( header.ttl <= 1 ) {
+        interfaces_[ingress].counters().add( InterfaceCounters::TTL_EXPIRED );
+        continue;
+      }
+      // 只改了 TTL，增量更新校验和，不用重新序列化整个头部
+      header.decrement_ttl();
+      // 发给外部地址的回复先换回内部地址，再按内部地址查路由
+      if ( nat_.has_value() && ingress == nat_outside_ && header.dst == nat_->external_ip()
+           && !nat_->translate_inbound( *received_dgram ) ) {
+        interfaces_[ingress].counters().add( InterfaceCounters::NAT_DROPPED );
+        continue;
       }
+      burst_dst_.push_back( header.dst );
+      burst_.push_back( std::move( received_dgram.value() ) );
+      burst_ingress_.push_back( ingress );
     }
+    if ( taken_this_round == 0 ) {
+      break;
+    }
+    taken += taken_this_round;
+  }
+  if ( n > 0 ) {
+    next_interface_ = ( next_interface_ + 1 ) % n;
+  }
+
+  // 目的地址一起查，再按取到的顺序发出
+  longest_prefix_match_burst_();
+  for ( size_t i = 0; i < burst_.size(); ++i ) {
+    forward_( burst_[i], burst_ingress_[i], burst_index_[i] );
   }
+  return taken;
 }
 
-std::vector<Router::Item>::iterator Router::longest_prefix_match_( uint32_t dst_ip )
+void Router::forward_( InternetDatagram& dgram, size_t ingress, uint32_t index )
 {
-  auto res = routing_table_.end();
-  auto max_length = -1;
-  for ( auto it = routing_table_.begin(); it != routing_table_.end(); ++it ) {
-    auto len = match_length_( dst_ip, it->route_prefix, it->prefix_length );
-    if ( len > max_length ) {
-      max_length = len;
-      res = it;
-    }
+  if ( index == LPMTable::NONE ) {
+    interfaces_[ingress].counters().add( InterfaceCounters::NO_ROUTE );
+    return;
+  }
+
+  // 只有一条路径时不用算散列
+  auto const dst_ip = dgram.header.dst;
+  auto const hash = routing_table_.route( index ).paths.size() > 1 ? RouteTable::flow_hash( dgram ) : 0;
+  const auto& path = routing_table_.path( index, hash );
+  if ( nat_.has_value() && path.interface_num == nat_outside_ && ingress != nat_outside_
+       && !nat_->translate_outbound( dgram ) ) {
+    interfaces_[ingress].counters().add( InterfaceCounters::NAT_DROPPED );
+    return;
   }
-  return res;
+  interface( path.interface_num )
+    .send_datagram( std::move( dgram ), path.next_hop.value_or( Address::from_ipv4_numeric( dst_ip ) ) );
 }
 
-int Router::match_length_( uint32_t src_ip, uint32_t tgt_ip, uint8_t tgt_len )
+// 乘法散列再折叠高位，避免同一网段的地址挤在一起
+size_t Router::route_cache_slot_( uint32_t dst_ip ) const
 {
-  if ( tgt_len == 0 ) {
-    return 0;
-  }
+  uint32_t hash = dst_ip * 0x9e3779b9U;
+  hash ^= hash >> 16;
+  return hash & ( route_cache_.size() - 1 );
+}
 
-  if ( tgt_len > 32 ) {
-    return -1;
+uint32_t Router::longest_prefix_match_( uint32_t dst_ip )
+{
+  uint32_t index {};
+  if ( route_cache_.empty() ) {
+    index = routing_table_.lookup( dst_ip );
+  } else {
+    auto& entry = route_cache_[route_cache_slot_( dst_ip )];
+    if ( entry.generation == cache_generation_ && entry.dst_ip == dst_ip ) {
+      ++cache_hits_;
+    } else {
+      ++cache_misses_;
+      entry = { dst_ip, routing_table_.lookup( dst_ip ), cache_generation_ };
+    }
+    index = entry.index;
   }
+  return index;
+}
 
-  // tgt_len < 32
-  uint8_t const len = 32U - tgt_len;
-  src_ip = src_ip >> len;
-  tgt_ip = tgt_ip >> len;
-  return src_ip == tgt_ip ? tgt_len : -1;
-}
\ No newline at end of file
+// 缓存命中的直接填上；没命中的攒起来一起查 LPM 表，查完再写回缓存。
+// 同一批里没命中的同一个地址各算一次 miss
+void Router::longest_prefix_match_burst_()
+{
+  burst_index_.resize( burst_dst_.size() );
+  if ( route_cache_.empty() ) {
+    routing_table_.lookup_burst( burst_dst_, burst_index_ );
+    return;
+  }
+  miss_dst_.clear();
+  miss_position_.clear();
+  for ( size_t i = 0; i < burst_dst_.size(); ++i ) {
+    auto const& entry = route_cache_[route_cache_slot_( burst_dst_[i] )];
+    if ( entry.generation == cache_generation_ && entry.dst_ip == burst_dst_[i] ) {
+      ++cache_hits_;
+      burst_index_[i] = entry.index;
+    } else {
+      ++cache_misses_;
+      miss_dst_.push_back( burst_dst_[i] );
+      miss_position_.push_back( i );
+    }
+  }
+  miss_index_.resize( miss_dst_.size() );
+  routing_table_.lookup_burst( miss_dst_, miss_index_ );
+  for ( size_t j = 0; j < miss_dst_.size(); ++j ) {
+    burst_index_[miss_position_[j]] = miss_index_[j];
+    route_cache_[route_cache_slot_( miss_dst_[j] )] = { miss_dst_[j], miss_index_[j], cache_generation_ };
+  }
+}
@@ -1,9 +1,13 @@
 #pragma once
 
+#include "nat_table.hh"
 #include "network_interface.hh"
+#include "packet_filter.hh"
+#include "route_table.hh"
 
 #include <optional>
 #include <queue>
+#include <span>
 
 // A wrapper for NetworkInterface that makes the host-side
 // interface asynchronous: instead of returning received datagrams
@@ -13,12 +17,13 @@
 class AsyncNetworkInterface : public NetworkInterface
 {
   std::queue<InternetDatagram> datagrams_in_ {};
+  std::vector<InternetDatagram> batch_in_ {}; // recv_frames() 复用的缓冲
 
 public:
   using NetworkInterface::NetworkInterface;
 
   // Construct from a NetworkInterface
-  explicit AsyncNetworkInterface( NetworkInterface&& interface ) : NetworkInterface( interface ) {}
+  explicit AsyncNetworkInterface( NetworkInterface&& interface ) : NetworkInterface( std::move( interface ) ) {}
 
   // \brief Receives and Ethernet frame and responds appropriately.
 
@@ -35,6 +40,16 @@ public:
     }
   };
 
+  // Same, for a batch of frames (see NetworkInterface::recv_frames)
+  void recv_frames( std::span<const EthernetFrame> frames )
+  {
+    batch_in_.clear();
+    NetworkInterface::recv_frames( frames, batch_in_ );
+    for ( auto& dgram : batch_in_ ) {
+      datagrams_in_.push( std::move( dgram ) );
+    }
+  }
+
   // Access queue of Internet datagrams that have been received
   std::optional<InternetDatagram> maybe_receive()
   {
@@ -52,24 +67,69 @@ public:
 // performs longest-prefix-match routing between them.
 class Router
 {
-  struct Item
+  // The router's collection of network interfaces
+  std::vector<AsyncNetworkInterface> interfaces_ {};
+
+  RouteTable routing_table_ {};
+
+  // Checked before the route lookup; denied datagrams are dropped
+  PacketFilter filter_ {};
+
+  // Source NAT for datagrams leaving (and replies arriving) on interface nat_outside_
+  std::optional<NatTable> nat_ {};
+  size_t nat_outside_ {};
+
+  // Direct-mapped cache of recent lookups. An entry is valid only if its generation is the current
+  // one, so add_route() invalidates the whole cache by bumping cache_generation_.
+  struct CacheEntry
   {
-    uint32_t route_prefix {};
-    uint8_t prefix_length {};
-    std::optional<Address> next_hop;
-    size_t interface_num {};
+    uint32_t dst_ip {};
+    uint32_t index { LPMTable::NONE };
+    uint32_t generation {};
   };
+  std::vector<CacheEntry> route_cache_ {};
+  uint32_t cache_generation_ { 1 };
+  uint64_t cache_hits_ {};
+  uint64_t cache_misses_ {};
 
-  // The router's collection of network interfaces
-  std::vector<AsyncNetworkInterface> interfaces_ {};
+  // Mark every cached lookup stale after the table changes
+  void invalidate_route_cache_();
+
+  // Where `dst_ip` goes in the cache
+  size_t route_cache_slot_( uint32_t dst_ip ) const;
+
+  // Interface that goes first in the next route_batch(), so no interface is always served first
+  size_t next_interface_ {};
+
+  // Index in routing_table_ of the longest route matching `dst_ip`, or LPMTable::NONE
+  uint32_t longest_prefix_match_( uint32_t dst_ip );
 
-  std::vector<Item> routing_table_ {};
+  // The same for every destination in burst_dst_, into burst_index_: cache hits are answered
+  // directly and the misses go to the LPM table together
+  void longest_prefix_match_burst_();
 
-  std::vector<Item>::iterator longest_prefix_match_( uint32_t dst_ip );
+  // Send the datagram (which arrived on interface `ingress`, TTL already decremented) toward the
+  // next hop of route `index`, or drop it if there is no route
+  void forward_( InternetDatagram& dgram, size_t ingress, uint32_t index );
 
-  static int match_length_( uint32_t src_ip, uint32_t tgt_ip, uint8_t tgt_len );
+  // route_batch() scratch: the datagrams taken, where each came from, and their destinations and routes
+  std::vector<InternetDatagram> burst_ {};
+  std::vector<size_t> burst_ingress_ {};
+  std::vector<uint32_t> burst_dst_ {};
+  std::vector<uint32_t> burst_index_ {};
+  std::vector<uint32_t> miss_dst_ {};
+  std::vector<uint32_t> miss_index_ {};
+  std::vector<size_t> miss_position_ {};
 
 public:
+  static constexpr size_t DEFAULT_ROUTE_CACHE_SIZE = 4096;
+  static constexpr size_t DEFAULT_ROUTE_BUDGET = 64;
+
+  Router() : Router( DEFAULT_ROUTE_CACHE_SIZE ) {}
+
+  // route_cache_size: entries in the route lookup cache (rounded up to a power of two; 0 disables it)
+  explicit Router( size_t route_cache_size );
+
   // Add an interface to the router
   // interface: an already-constructed network interface
   // returns the index of the interface after it has been added to the router
@@ -82,17 +142,60 @@ public:
   // Access an interface by index
   AsyncNetworkInterface& interface( size_t N ) { return interfaces_.at( N ); }
 
+  // A snapshot of an interface's counters, including the datagrams the router dropped from it
+  InterfaceStats stats( size_t N ) const { return interfaces_.at( N ).stats(); }
+
   // Add a route (a forwarding rule)
   void add_route( uint32_t route_prefix,
                   uint8_t prefix_length,
                   std::optional<Address> next_hop,
                   size_t interface_num );
 
+  // Add a route with several equal-cost paths. A datagram's path is picked by a hash of its flow
+  // (addresses, protocol and ports), so each flow stays on one path.
+  void add_route( uint32_t route_prefix, uint8_t prefix_length, std::vector<RouteTable::Path> paths );
+
+  // Replace every route at once with `routes` (see RouteTable::parse() to read them from a file).
+  // The new table is built in one pass, then swapped in.
+  void load_routes( std::span<const RouteTable::Route> routes );
+
+  // Replace the access control list checked for every datagram before its route is looked up. A
+  // denied datagram is dropped and counted in its ingress interface's `filtered` stat.
+  void set_filter( PacketFilter filter ) { filter_ = std::move( filter ); }
+
+  // The access control list, with its hit counters
+  const PacketFilter& filter() const { return filter_; }
+
+  // Translate the source of every TCP and UDP datagram routed out of interface `outside` (from any
+  // other interface) to config.external_ip (see NatTable), and the replies arriving on `outside`
+  // back, before their route is looked up. A datagram that cannot be translated is dropped and
+  // counted in its ingress interface's `nat_dropped` stat.
+  void enable_nat( size_t outside, const NatTable::Config& config );
+
+  // The NAT flow table, or nullptr if NAT is off
+  const NatTable* nat() const { return nat_.has_value() ? &*nat_ : nullptr; }
+
+  // Move the router's own timers (NAT mapping expiry) forward. The interfaces are ticked by their owner.
+  void tick( uint64_t ms_since_last_tick );
+
+  // The route a datagram to `dst_ip` would take, or nullptr
+  const RouteTable::Route* lookup( uint32_t dst_ip );
+
   // Route packets between the interfaces. For each interface, use the
   // maybe_receive() method to consume every incoming datagram and
   // send it on one of interfaces to the correct next hop. The router
   // chooses the outbound interface and next-hop as specified by the
   // route with the longest prefix_length that matches the datagram's
   // destination address.
+  // Routes until every interface's incoming queue is empty.
   void route();
+
+  // Route at most `budget` datagrams from each interface, taking one from each interface in turn.
+  // Returns the number of datagrams taken (0 once every interface is idle). The routes of everything
+  // taken are looked up together, LPMTable::BURST destinations at a time, before any is sent.
+  size_t route_batch( size_t budget = DEFAULT_ROUTE_BUDGET );
+
+  // Route lookups answered by the cache, and lookups that went to the LPM table
+  uint64_t route_cache_hits() const { return cache_hits_; }
+  uint64_t route_cache_misses() const { return cache_misses_; }
 };
@@ -0,0 +1,134 @@
+#include "spsc_byte_stream.hh"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+SPSCByteStream::SPSCByteStream( uint64_t capacity )
+  : capacity_( capacity ), ring_( make_unique<char[]>( max<uint64_t>( capacity, 1 ) ) )
+{}
+
+// 只有写线程修改 bytes_push_size_，先拷贝数据再 release 发布新的计数。
+// 先用缓存的 pop 计数判断空间，不够时才去读另一条 cache line
+void SPSCWriter::push( string_view data ) noexcept
+{
+  auto const pushed = bytes_push_size_.load( memory_order_relaxed );
+  if ( capacity_ - ( pushed - cached_pop_size_ ) < data.size() ) {
+    cached_pop_size_ = bytes_pop_size_.load( memory_order_acquire );
+  }
+  auto const size = min<uint64_t>( capacity_ - ( pushed - cached_pop_size_ ), data.size() );
+  if ( size == 0 ) {
+    return;
+  }
+
+  auto const tail = pushed % capacity_;
+  auto const first_part = min( size, capacity_ - tail );
+  memcpy( ring_.get() + tail, data.data(), first_part );
+  memcpy( ring_.get(), data.data() + first_part, size - first_part );
+
+  bytes_push_size_.store( pushed + size, memory_order_release );
+}
+
+void SPSCWriter::close() noexcept
+{
+  is_closed_.store( true, memory_order_release );
+}
+
+void SPSCWriter::set_error() noexcept
+{
+  has_error_.store( true, memory_order_release );
+}
+
+bool SPSCWriter::is_closed() const noexcept
+{
+  return is_closed_.load( memory_order_acquire );
+}
+
+uint64_t SPSCWriter::available_capacity() const noexcept
+{
+  cached_pop_size_ = bytes_pop_size_.load( memory_order_acquire );
+  return capacity_ - ( bytes_push_size_.load( memory_order_relaxed ) - cached_pop_size_ );
+}
+
+uint64_t SPSCWriter::bytes_pushed() const noexcept
+{
+  return bytes_push_size_.load( memory_order_relaxed );
+}
+
+string_view SPSCReader::peek() const noexcept
+{
+  auto const buffered = bytes_buffered();
+  auto const head = bytes_pop_size_.load( memory_order_relaxed ) % max<uint64_t>( capacity_, 1 );
+  return { ring_.get() + head, min( buffered, capacity_ - head ) };
+}
+
+// 只有读线程修改 bytes_pop_size_，release 之后写线程才能复用这段空间
+void SPSCReader::pop( uint64_t len ) noexcept
+{
+  auto const popped = bytes_pop_size_.load( memory_order_relaxed );
+  if ( cached_push_size_ - popped < len ) {
+    cached_push_size_ = bytes_push_size_.load( memory_order_acquire );
+  }
+  if ( len == 0 || len > cached_push_size_ - popped ) {
+    return;
+  }
+  bytes_pop_size_.store( popped + len, memory_order_release );
+}
+
+// 先 acquire 关闭标志，再看计数：写线程在 close() 之前推入的字节一定可见
+bool SPSCReader::is_finished() const noexcept
+{
+  if ( not is_closed_.load( memory_order_acquire ) ) {
+    return false;
+  }
+  return bytes_push_size_.load( memory_order_acquire ) == bytes_pop_size_.load( memory_order_relaxed );
+}
+
+bool SPSCReader::has_error() const noexcept
+{
+  return has_error_.load( memory_order_acquire );
+}
+
+uint64_t SPSCReader::bytes_buffered() const noexcept
+{
+  cached_push_size_ = bytes_push_size_.load( memory_order_acquire );
+  return cached_push_size_ - bytes_pop_size_.load( memory_order_relaxed );
+}
+
+uint64_t SPSCReader::bytes_popped() const noexcept
+{
+  return bytes_pop_size_.load( memory_order_relaxed );
+}
+
+SPSCReader& SPSCByteStream::reader()
+{
+  static_assert( sizeof( SPSCReader ) == sizeof( SPSCByteStream ),
+                 "Please add member variables to the SPSCByteStream base, not the SPSCByteStream Reader." );
+
+  return static_cast<SPSCReader&>( *this ); // NOLINT(*-downcast)
+}
+
+const SPSCReader& SPSCByteStream::reader() const
+{
+  static_assert( sizeof( SPSCReader ) == sizeof( SPSCByteStream ),
+                 "Please add member variables to the SPSCByteStream base, not the SPSCByteStream Reader." );
+
+  return static_cast<const SPSCReader&>( *this ); // NOLINT(*-downcast)
+}
+
+SPSCWriter& SPSCByteStream::writer()
+{
+  static_assert( sizeof( SPSCWriter ) == sizeof( SPSCByteStream ),
+                 "Please add member variables to the SPSCByteStream base, not the SPSCByteStream Writer." );
+
+  return static_cast<SPSCWriter&>( *this ); // NOLINT(*-downcast)
+}
+
+const SPSCWriter& SPSCByteStream::writer() const
+{
+  static_assert( sizeof( SPSCWriter ) == sizeof( SPSCByteStream ),
+                 "Please add member variables to the SPSCByteStream base, not the SPSCByteStream Writer." );
+
+  return static_cast<const SPSCWriter&>( *this ); // NOLINT(*-downcast)
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+class SPSCReader;
+class SPSCWriter;
+
+// A ByteStream that may be written by one thread while it is read by another.
+//
+// The bytes live in a fixed ring of `capacity` bytes. There are no locks: the writer
+// owns `bytes_push_size_`, the reader owns `bytes_pop_size_`, and each side only reads
+// the other's counter (with acquire/release ordering) to learn how far it may go.
+// The two counters sit on separate cache lines so the threads don't false-share.
+//
+// Exactly one thread may use the writer() and exactly one thread may use the reader().
+class SPSCByteStream
+{
+public:
+  explicit SPSCByteStream( uint64_t capacity );
+
+  // Helper functions (provided) to access the SPSCByteStream's Reader and Writer interfaces
+  SPSCReader& reader();
+  const SPSCReader& reader() const;
+  SPSCWriter& writer();
+  const SPSCWriter& writer() const;
+
+protected:
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+
+  // shared, read-only after construction
+  uint64_t capacity_;
+  std::unique_ptr<char[]> ring_;
+
+  // writer side
+  alignas( CACHE_LINE_SIZE ) std::atomic<uint64_t> bytes_push_size_ {};
+  mutable uint64_t cached_pop_size_ {}; // writer's last look at bytes_pop_size_
+
+  // reader side
+  alignas( CACHE_LINE_SIZE ) std::atomic<uint64_t> bytes_pop_size_ {};
+  mutable uint64_t cached_push_size_ {}; // reader's last look at bytes_push_size_
+
+  // rarely-changing flags
+  alignas( CACHE_LINE_SIZE ) std::atomic<bool> is_closed_ { false };
+  std::atomic<bool> has_error_ { false };
+};
+
+class SPSCWriter : public SPSCByteStream
+{
+public:
+  void push( std::string_view data ) noexcept; // Push data to stream, but only as much as available capacity allows.
+
+  void close() noexcept;     // Signal that the stream has reached its ending. Nothing more will be written.
+  void set_error() noexcept; // Signal that the stream suffered an error.
+
+  bool is_closed() const noexcept;              // Has the stream been closed?
+  uint64_t available_capacity() const noexcept; // How many bytes can be pushed to the stream right now?
+  uint64_t bytes_pushed() const noexcept;       // Total number of bytes cumulatively pushed to the stream
+};
+
+class SPSCReader : public SPSCByteStream
+{
+public:
+  std::string_view peek() const noexcept; // Peek at the next bytes in the buffer (the longest contiguous span)
+  void pop( uint64_t len ) noexcept;      // Remove `len` bytes from the buffer
+
+  bool is_finished() const noexcept; // Is the stream finished (closed and fully popped)?
+  bool has_error() const noexcept;   // Has the stream had an error?
+
+  uint64_t bytes_buffered() const noexcept; // Number of bytes currently buffered (pushed and not popped)
+  uint64_t bytes_popped() const noexcept;   // Total number of bytes cumulatively popped from stream
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+// A bounded queue of objects that one thread pushes to while another pops from, without locks.
+// Same scheme as SPSCByteStream: the producer owns tail_, the consumer owns head_, each side
+// caches its last look at the other's counter, and the counters sit on separate cache lines.
+//
+// Exactly one thread may push() and exactly one thread may pop().
+template<typename T>
+class SPSCQueue
+{
+public:
+  // capacity is rounded up to a power of two
+  explicit SPSCQueue( size_t capacity )
+    : mask_( std::bit_ceil( capacity < 2 ? 2 : capacity ) - 1 ), slots_( std::make_unique<T[]>( mask_ + 1 ) )
+  {}
+
+  // Producer: move `value` into the queue. Returns false (and leaves `value` alone) if the queue is full.
+  bool push( T&& value )
+  {
+    auto const tail = tail_.load( std::memory_order_relaxed );
+    if ( tail - cached_head_ > mask_ ) {
+      cached_head_ = head_.load( std::memory_order_acquire );
+      if ( tail - cached_head_ > mask_ ) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move( value );
+    tail_.store( tail + 1, std::memory_order_release );
+    return true;
+  }
+
+  // Producer: would push() fail right now?
+  bool full() const
+  {
+    cached_head_ = head_.load( std::memory_order_acquire );
+    return tail_.load( std::memory_order_relaxed ) - cached_head_ > mask_;
+  }
+
+  // Consumer: take the oldest element, if any
+  std::optional<T> pop()
+  {
+    auto const head = head_.load( std::memory_order_relaxed );
+    if ( head == cached_tail_ ) {
+      cached_tail_ = tail_.load( std::memory_order_acquire );
+      if ( head == cached_tail_ ) {
+        return {};
+      }
+    }
+    std::optional<T> value { std::move( slots_[head & mask_] ) };
+    slots_[head & mask_] = T {}; // 释放元素持有的资源（比如 Buffer），不要留到下次覆盖
+    head_.store( head + 1, std::memory_order_release );
+    return value;
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+private:
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+
+  // shared, read-only after construction
+  size_t mask_;
+  std::unique_ptr<T[]> slots_;
+
+  // producer side
+  alignas( CACHE_LINE_SIZE ) std::atomic<uint64_t> tail_ {};
+  mutable uint64_t cached_head_ {}; // producer's last look at head_
+
+  // consumer side
+  alignas( CACHE_LINE_SIZE ) std::atomic<uint64_t> head_ {};
+  uint64_t cached_tail_ {}; // consumer's last look at tail_
+};
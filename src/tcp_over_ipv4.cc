@@ -0,0 +1,44 @@
+#include "tcp_over_ipv4.hh"
+
+#include "parser.hh"
+
+using namespace std;
+
+TCPOverIPv4::TCPOverIPv4( const Address& local, const Address& remote )
+  : local_ip_( local.ipv4_numeric() )
+  , remote_ip_( remote.ipv4_numeric() )
+  , local_port_( local.port() )
+  , remote_port_( remote.port() )
+{}
+
+InternetDatagram TCPOverIPv4::wrap( TCPMessage&& msg, bool RST )
+{
+  TCPSegment seg { .src_port = local_port_, .dst_port = remote_port_, .message = std::move( msg ), .RST = RST };
+
+  InternetDatagram dgram;
+  dgram.header.src = local_ip_;
+  dgram.header.dst = remote_ip_;
+  dgram.header.id = next_id_++;
+  dgram.header.len = IPv4Header::LENGTH + seg.header_length() + seg.message.sender.payload.size();
+  seg.compute_checksum( dgram.header.pseudo_checksum() );
+  dgram.header.compute_checksum();
+  dgram.payload = serialize( seg );
+  return dgram;
+}
+
+optional<TCPSegment> TCPOverIPv4::unwrap( const InternetDatagram& dgram ) const
+{
+  if ( dgram.header.proto != IPv4Header::PROTO_TCP or dgram.header.src != remote_ip_
+       or dgram.header.dst != local_ip_ ) {
+    return {};
+  }
+
+  TCPSegment seg;
+  Parser parser { dgram.payload };
+  parser.set_checksum_verified( dgram.payload_checksum_verified );
+  seg.parse( parser, dgram.header.pseudo_checksum() );
+  if ( parser.has_error() or seg.src_port != remote_port_ or seg.dst_port != local_port_ ) {
+    return {};
+  }
+  return seg;
+}
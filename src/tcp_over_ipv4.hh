@@ -0,0 +1,31 @@
+#pragma once
+
+#include "address.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_message.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <optional>
+
+// Carries one connection's TCPMessages in IPv4 datagrams: wrap() puts a message in a TCP segment
+// (checksummed) inside a datagram from `local` to `remote`, and unwrap() takes the segment back
+// out of a datagram, if the datagram belongs to the connection.
+class TCPOverIPv4
+{
+public:
+  // The two ends' IP addresses and ports
+  TCPOverIPv4( const Address& local, const Address& remote );
+
+  InternetDatagram wrap( TCPMessage&& msg, bool RST = false );
+
+  // The segment in `dgram`, if it is TCP from `remote` to `local` and its checksum is right
+  std::optional<TCPSegment> unwrap( const InternetDatagram& dgram ) const;
+
+private:
+  uint32_t local_ip_;
+  uint32_t remote_ip_;
+  uint16_t local_port_;
+  uint16_t remote_port_;
+  uint16_t next_id_ {}; // IPv4 标识字段，每个数据报加一
+};
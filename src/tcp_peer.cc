@@ -0,0 +1,171 @@
+#include "tcp_peer.hh"
+#include "parser.hh"
+
+using namespace std;
+
+TCPPeer::TCPPeer( const TCPConfig& config )
+  : outbound_( config.send_capacity )
+  , inbound_( config.recv_capacity )
+  , sender_( config )
+  , receiver_( config )
+  , linger_ms_( uint64_t { 10 } * config.rt_timeout )
+  , release_when_idle_( config.release_when_idle )
+  , idle_release_ms_( config.idle_release_ms )
+{}
+
+void TCPPeer::push()
+{
+  ms_idle_ = 0;
+  released_ = false;
+  sender_.push( outbound_.reader() );
+}
+
+void TCPPeer::receive( TCPMessage msg )
+{
+  ms_since_last_segment_received_ = 0;
+  ms_idle_ = 0;
+  released_ = false;
+  if ( msg.sender.SYN && msg.sender.window_scale.has_value() ) {
+    sender_.set_peer_window_scale( *msg.sender.window_scale );
+  }
+
+  sender_.receive( msg.receiver );
+  receiver_.receive( std::move( msg.sender ), reassembler_, inbound_.writer() );
+
+  // 对端在我们发出 FIN 之前就结束了：被动关闭，不需要 linger
+  if ( inbound_.writer().is_closed() && !fin_sent_ ) {
+    linger_after_streams_finish_ = false;
+  }
+
+  // ACK 可能打开了窗口；被动打开的一方也在这里回 SYN
+  push();
+}
+
+void TCPPeer::receive_batch( span<TCPMessage> msgs )
+{
+  if ( msgs.empty() ) {
+    return;
+  }
+  ms_since_last_segment_received_ = 0;
+  ms_idle_ = 0;
+  released_ = false;
+
+  // 先处理所有的 ACK，再把数据一次交给 receiver
+  for ( auto& msg : msgs ) {
+    if ( msg.sender.SYN && msg.sender.window_scale.has_value() ) {
+      sender_.set_peer_window_scale( *msg.sender.window_scale );
+    }
+    sender_.receive( msg.receiver );
+    segments_.push_back( std::move( msg.sender ) );
+  }
+  receiver_.receive_batch( segments_, reassembler_, inbound_.writer() );
+  segments_.clear();
+
+  if ( inbound_.writer().is_closed() && !fin_sent_ ) {
+    linger_after_streams_finish_ = false;
+  }
+  push();
+}
+
+void TCPPeer::tick( uint64_t ms_since_last_tick )
+{
+  sender_.tick( ms_since_last_tick );
+  receiver_.tick( ms_since_last_tick, inbound_.writer() );
+  ms_since_last_segment_received_ += ms_since_last_tick;
+  ms_idle_ += ms_since_last_tick;
+  if ( release_when_idle_ && !released_ && ms_idle_ >= idle_release_ms_ ) {
+    release_memory();
+    released_ = true;
+  }
+
+  if ( sender_.consecutive_retransmissions() > TCPConfig::MAX_RETX_ATTEMPTS ) {
+    outbound_.writer().set_error();
+    inbound_.writer().set_error();
+  }
+}
+
+optional<TCPMessage> TCPPeer::maybe_send()
+{
+  auto seg = sender_.maybe_send();
+  if ( !seg.has_value() ) {
+    if ( !receiver_.ack_due() ) {
+      return {};
+    }
+    seg = sender_.send_empty_message();
+  }
+  fin_sent_ = fin_sent_ || seg->FIN;
+  receiver_.ack_sent();
+  return TCPMessage { std::move( *seg ), receiver_.send( reassembler_, inbound_.writer() ) };
+}
+
+void TCPPeer::maybe_send_all( vector<TCPMessage>& out )
+{
+  sender_.maybe_send_all( segments_ );
+  if ( segments_.empty() ) {
+    if ( !receiver_.ack_due() ) {
+      return;
+    }
+    segments_.push_back( sender_.send_empty_message() );
+  }
+
+  // 这一批段带同一个 ACK
+  receiver_.ack_sent();
+  auto const ack = receiver_.send( reassembler_, inbound_.writer() );
+  out.reserve( out.size() + segments_.size() );
+  for ( auto& seg : segments_ ) {
+    fin_sent_ = fin_sent_ || seg.FIN;
+    out.push_back( { std::move( seg ), ack } );
+  }
+  segments_.clear();
+}
+
+void TCPPeer::release_memory()
+{
+  outbound_.release_memory();
+  inbound_.release_memory();
+  reassembler_.release_memory();
+  sender_.release_memory();
+  segments_.shrink_to_fit(); // maybe_send_all() 用完总会 clear()
+}
+
+bool TCPPeer::active() const
+{
+  if ( outbound_.reader().has_error() || inbound_.reader().has_error() ) {
+    return false;
+  }
+  // 还没收齐对端的数据和 FIN，或者自己的数据和 FIN 还没全部被确认
+  if ( !inbound_.writer().is_closed() || !outbound_.reader().is_finished() || !fin_sent_
+       || sender_.sequence_numbers_in_flight() > 0 ) {
+    return true;
+  }
+  return linger_after_streams_finish_ && ms_since_last_segment_received_ < linger_ms_;
+}
+
+// 先恢复两个流，Reassembler 要往已经恢复好的入站流里写
+void TCPPeer::checkpoint( Serializer& out ) const
+{
+  outbound_.checkpoint( out );
+  inbound_.checkpoint( out );
+  reassembler_.checkpoint( out );
+  sender_.checkpoint( out );
+  receiver_.checkpoint( out );
+  out.integer( static_cast<uint8_t>( fin_sent_ | ( linger_after_streams_finish_ << 1 ) | ( released_ << 2 ) ) );
+  out.integer( ms_since_last_segment_received_ );
+  out.integer( ms_idle_ );
+}
+
+void TCPPeer::restore( Parser& in )
+{
+  outbound_.restore( in );
+  inbound_.restore( in );
+  reassembler_.restore( in, inbound_.writer() );
+  sender_.restore( in );
+  receiver_.restore( in );
+  uint8_t flags {};
+  in.integer( flags );
+  in.integer( ms_since_last_segment_received_ );
+  in.integer( ms_idle_ );
+  fin_sent_ = flags & 1;
+  linger_after_streams_finish_ = flags & 2;
+  released_ = flags & 4;
+}
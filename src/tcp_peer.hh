@@ -0,0 +1,114 @@
+#pragma once
+
+#include "byte_stream.hh"
+#include "reassembler.hh"
+#include "tcp_config.hh"
+#include "tcp_message.hh"
+#include "tcp_receiver.hh"
+#include "tcp_sender.hh"
+#include "timer_wheel.hh"
+
+#include <optional>
+#include <span>
+#include <vector>
+
+// One end of a TCP connection: a TCPSender and its outbound ByteStream, plus a TCPReceiver,
+// Reassembler and inbound ByteStream. Every segment it sends carries the receiver's latest
+// ackno and window, so ACKs ride along with data instead of needing segments of their own.
+//
+// The owner moves TCPMessages between two TCPPeers (over whatever lower layer it likes) and
+// calls tick() as time passes. A single event loop can drive many peers: each call is O(1)
+// when there is nothing to do, and maybe_send_all() hands over everything pending at once.
+class TCPPeer
+{
+public:
+  explicit TCPPeer( const TCPConfig& config );
+
+  // The application's ends of the two streams
+  Writer& outbound_writer() { return outbound_.writer(); }
+  Reader& inbound_reader() { return inbound_.reader(); }
+  const Writer& outbound_writer() const { return outbound_.writer(); }
+  const Reader& inbound_reader() const { return inbound_.reader(); }
+
+  // Start the connection by sending a SYN (a peer that never connects answers the other's SYN)
+  void connect() { push(); }
+
+  // Tell the TCPSender about new bytes in the outbound stream (call after writing to it)
+  void push();
+
+  // The application made room in a full inbound stream (e.g. from the stream's writable hook): the
+  // next maybe_send() or maybe_send_all() advertises the window that opened
+  void window_opened() { receiver_.window_opened(); }
+
+  // A segment arrived from the other peer
+  void receive( TCPMessage msg );
+
+  // Several segments arrived at once: same as receive() on each, except that runs of in-order data
+  // reach the Reassembler as one insert (see TCPReceiver::receive_batch) and push() runs once, so
+  // the next maybe_send_all() answers the whole batch with one ACK. The messages are moved from.
+  void receive_batch( std::span<TCPMessage> msgs );
+
+  // Time has passed by the given # of milliseconds since the last time tick() was called
+  void tick( uint64_t ms_since_last_tick );
+
+  // The next segment to send, if any (data, or an ACK the receiver owes)
+  std::optional<TCPMessage> maybe_send();
+
+  // Append every segment that needs sending to `out`
+  void maybe_send_all( std::vector<TCPMessage>& out );
+
+  // Keep the retransmission timer on a shared TimerWheel (see TCPSender::attach_timer_wheel)
+  void attach_timer_wheel( TimerWheel& wheel, TimerWheel::Token token )
+  {
+    sender_.attach_timer_wheel( wheel, token );
+  }
+
+  // The connection was reset (e.g. the other side sent RST): both streams end with an error
+  void set_error()
+  {
+    outbound_.writer().set_error();
+    inbound_.writer().set_error();
+  }
+
+  // Give back the storage the streams, Reassembler and TCPSender hold while they are empty; each
+  // allocates again on its next use. With TCPConfig::release_when_idle, tick() calls this once the
+  // connection has been idle for idle_release_ms.
+  void release_memory();
+
+  // Is the connection still alive? False once both streams have ended cleanly, or after an error.
+  bool active() const;
+
+  // Save the whole connection (both streams and their buffered bytes, the Reassembler's stored
+  // bytes, the TCPSender's outstanding segments, the TCPReceiver, and the peer's own timers), so a
+  // new process can restore() it into a TCPPeer made from its own TCPConfig and carry on where this
+  // one left off: no reconnect, and the congestion window it had already grown. Settings from the
+  // TCPConfig (capacities aside) are those of the restoring peer. Attach a timer wheel before
+  // restoring (see TCPSender::restore()). Check the Parser's has_error() afterwards.
+  void checkpoint( Serializer& out ) const;
+  void restore( Parser& in );
+
+  // Accessors for use in testing
+  const TCPSender& sender() const { return sender_; }
+  const TCPReceiver& receiver() const { return receiver_; }
+
+private:
+  ByteStream outbound_;
+  ByteStream inbound_;
+  Reassembler reassembler_ {};
+  TCPSender sender_;
+  TCPReceiver receiver_;
+
+  bool fin_sent_ { false };
+  // 对端先结束时不需要等待；自己先结束时要等 10 倍 RTO，确保最后的 ACK 已经送到（RFC 793 TIME-WAIT）
+  bool linger_after_streams_finish_ { true };
+  uint64_t linger_ms_;
+  uint64_t ms_since_last_segment_received_ {};
+
+  // 空闲（没有 push() 也没有收到段）超过 idle_release_ms_ 就释放空缓冲，有动静后重新计时
+  bool release_when_idle_;
+  uint64_t idle_release_ms_;
+  uint64_t ms_idle_ {};
+  bool released_ { false };
+
+  std::vector<TCPSenderMessage> segments_ {}; // maybe_send_all() 和 receive_batch() 复用的缓冲
+};
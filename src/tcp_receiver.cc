@@ -1,24 +1,295 @@
 #include "tcp_receiver.hh"
+#include "parser.hh"
 #include <iostream>
 
 using namespace std;
 
+namespace {
+// 标志位：SYN、ack_now_、window_update_，以及三个 optional 是否有值
+enum : uint8_t
+{
+  RECV_SYN = 1,
+  RECV_ACK_NOW = 2,
+  RECV_WINDOW_UPDATE = 4,
+  RECV_SCALE_OFFER = 8,
+  RECV_PEER_SCALE = 16,
+  RECV_RTT_EDGE = 32,
+};
+} // namespace
+
+TCPReceiver::TCPReceiver( const TCPConfig& config )
+{
+  if ( config.window_scaling ) {
+    window_scale_offer_ = config.window_scale();
+  }
+  delayed_ack_ = config.delayed_ack;
+  delayed_ack_ms_ = config.delayed_ack_ms;
+  autotune_ = config.recv_autotune;
+  capacity_min_ = config.recv_capacity;
+  capacity_max_ = std::max( config.recv_capacity, config.recv_capacity_max );
+  autotune_idle_ms_ = config.recv_autotune_idle_ms;
+}
+
 /**
  * 保存初始 seqno 
  * 数据的第一个字节将具有 ISN + 1（ mod 2 >> 32）的序列号，初始化时需要＋1 
  * 逻辑开始和结束各占用一个序列号：除了确保接收所有数据字节外，TCP还确保流的开始和结束可靠接收
  * 绝对序列号和流索引之间进行转换相对容易——只需加或减一 
 */
-void TCPReceiver::receive( TCPSenderMessage message, Reassembler& reassembler, Writer& inbound_stream )
+void TCPReceiver::receive( TCPSenderMessage&& message, Reassembler& reassembler, Writer& inbound_stream )
 {
-  if(message.SYN){SYN = true; ISN = message.seqno;}
+  receive( message, std::move( message.payload ), reassembler, inbound_stream );
+}
+
+void TCPReceiver::receive( const TCPSenderMessage& message, Reassembler& reassembler, Writer& inbound_stream )
+{
+  receive( message, message.payload, reassembler, inbound_stream );
+}
+
+// `message` 只用到头部字段；payload 单独传进来，右值版本可以直接 move 给 Reassembler
+void TCPReceiver::receive( const TCPSenderMessage& message,
+                           Buffer payload,
+                           Reassembler& reassembler,
+                           Writer& inbound_stream,
+                           uint64_t segments )
+{
+  if(message.SYN){
+    SYN = true; ISN = message.seqno;
+    peer_window_scale_ = message.window_scale;
+    window_shift_ = window_scale_offer_.has_value() && peer_window_scale_.has_value() ? *window_scale_offer_ : 0;
+  }
   if(!SYN) {return ;}
-  reassembler.insert((message.seqno).unwrap(ISN, reassembler.bytes_pending()) + message.SYN - 1, message.payload,message.FIN, inbound_stream);
+  // checkpoint 取下一个期望的绝对序列号（ackno 去掉 FIN），离新到的段最近，流再长也不会解错
+  auto const seqno = message.seqno.unwrap( ISN, inbound_stream.bytes_pushed() + 1 );
+  if ( seqno == 0 && !message.SYN ) {
+    return; // ISN 的位置只属于 SYN
+  }
+  auto const first_index = seqno + message.SYN - 1;
+  auto const has_data = message.SYN || !payload.empty() || message.FIN;
+  if ( has_data ) {
+    // RFC 5681 4.2：乱序的段和填补空洞的段要立即 ACK
+    unacked_segments_ += segments;
+    ack_now_ = ack_now_ || message.SYN || message.FIN || first_index != inbound_stream.bytes_pushed()
+               || reassembler.bytes_pending() > 0;
+  }
+  reassembler.insert( first_index, std::move( payload ), message.FIN, inbound_stream );
+  if ( autotune_ && has_data ) {
+    autotune( inbound_stream );
+  }
+}
+
+/**
+ * 一段连续的段：后一个的 seqno 正好接在前一个的末尾，中间没有 SYN / FIN，也不是空段。
+ * 整段只 unwrap 一次、insert 一次；payload 能直接拼成同一个 Buffer 的切片就不拷贝
+ */
+void TCPReceiver::receive_batch( span<TCPSenderMessage> messages, Reassembler& reassembler, Writer& inbound_stream )
+{
+  size_t i = 0;
+  while ( i < messages.size() ) {
+    auto& first = messages[i];
+    if ( !SYN || first.SYN || first.payload.empty() ) {
+      receive( std::move( first ), reassembler, inbound_stream );
+      ++i;
+      continue;
+    }
+
+    // 先找出这一段连续的段 [i, end)，知道总长度再拼
+    auto end = i + 1;
+    uint64_t run_size = first.payload.size();
+    while ( !messages[end - 1].FIN && end < messages.size() && !messages[end].SYN && !messages[end].payload.empty()
+            && messages[end].seqno == first.seqno + static_cast<uint32_t>( run_size ) ) {
+      run_size += messages[end++].payload.size();
+    }
+
+    Buffer payload = std::move( first.payload );
+    auto joined = i + 1;
+    while ( joined < end && payload.extend( messages[joined].payload ) ) {
+      ++joined;
+    }
+    if ( joined < end ) {
+      string data = Buffer::pooled_string( run_size );
+      data.append( string_view { payload } );
+      for ( ; joined < end; ++joined ) {
+        data.append( string_view { messages[joined].payload } );
+      }
+      payload = Buffer { std::move( data ) };
+    }
+
+    receive( { first.seqno, false, {}, messages[end - 1].FIN, {} },
+             std::move( payload ),
+             reassembler,
+             inbound_stream,
+             end - i );
+    i = end;
+  }
+}
+
+/**
+ * 类似 Linux 的 DRS（dynamic right-sizing）：
+ * RTT：从某一刻通告的窗口右沿开始计时，数据填到右沿所用的时间；发送方受窗口限制时正好是一个 RTT，否则更长，所以取最小值
+ * 每个 RTT 看一次应用读走了多少字节，缓冲不到它的两倍就扩到两倍，留出一个 RTT 的余量
+ */
+void TCPReceiver::autotune( Writer& inbound_stream )
+{
+  idle_ms_ = 0;
+  if ( inbound_stream.is_closed() ) {
+    return;
+  }
+  auto const pushed = inbound_stream.bytes_pushed();
+  auto const popped = inbound_stream.reader().bytes_popped();
+
+  if ( rtt_edge_.has_value() && pushed >= *rtt_edge_ ) {
+    rtt_ms_ = std::min( rtt_ms_, std::max<uint64_t>( clock_ms_ - rtt_start_ms_, 1 ) );
+    rtt_edge_.reset();
+  }
+  if ( !rtt_edge_.has_value() ) {
+    rtt_edge_ = pushed + inbound_stream.available_capacity();
+    rtt_start_ms_ = clock_ms_;
+  }
+
+  if ( rtt_ms_ == UINT64_MAX || clock_ms_ - drain_start_ms_ < rtt_ms_ ) {
+    return;
+  }
+  auto const drained = popped - drain_start_popped_;
+  if ( drained * 2 > inbound_stream.capacity() ) {
+    inbound_stream.set_capacity( std::min( drained * 2, capacity_max_ ) );
+  }
+  drain_start_ms_ = clock_ms_;
+  drain_start_popped_ = popped;
+}
+
+bool TCPReceiver::ack_due() const
+{
+  if ( window_update_ ) {
+    return true;
+  }
+  if ( unacked_segments_ == 0 ) {
+    return false;
+  }
+  return !delayed_ack_ || ack_now_ || unacked_segments_ >= TCPConfig::DELAYED_ACK_SEGMENTS
+         || unacked_ms_ >= delayed_ack_ms_;
+}
+
+void TCPReceiver::ack_sent()
+{
+  unacked_segments_ = 0;
+  unacked_ms_ = 0;
+  ack_now_ = false;
+  window_update_ = false;
+}
+
+// 还没收到 SYN 就没有 ackno，通告不了窗口
+void TCPReceiver::window_opened()
+{
+  window_update_ = SYN;
+}
+
+void TCPReceiver::tick( uint64_t ms_since_last_tick )
+{
+  if ( unacked_segments_ > 0 ) {
+    unacked_ms_ += ms_since_last_tick;
+  }
+}
+
+// 空闲太久就缩回初始大小（还缓存着的字节不会丢），重新开始测 RTT
+void TCPReceiver::tick( uint64_t ms_since_last_tick, Writer& inbound_stream )
+{
+  tick( ms_since_last_tick );
+  if ( !autotune_ ) {
+    return;
+  }
+  clock_ms_ += ms_since_last_tick;
+  idle_ms_ += ms_since_last_tick;
+  if ( idle_ms_ >= autotune_idle_ms_ && inbound_stream.capacity() > capacity_min_ ) {
+    inbound_stream.set_capacity( capacity_min_ );
+    rtt_edge_.reset();
+    rtt_ms_ = UINT64_MAX;
+    drain_start_ms_ = clock_ms_;
+    drain_start_popped_ = inbound_stream.reader().bytes_popped();
+  }
+}
+
+optional<TCPReceiverMessage> TCPReceiver::maybe_send( const Writer& inbound_stream )
+{
+  if ( !ack_due() ) {
+    return {};
+  }
+  ack_sent();
+  return send( inbound_stream );
 }
 
 TCPReceiverMessage TCPReceiver::send( const Writer& inbound_stream ) const
 {
   std::optional<Wrap32> ackno {};
   if(SYN){ ackno = Wrap32::wrap(SYN + inbound_stream.is_closed() + inbound_stream.bytes_pushed(), ISN); }
-  return { ackno, (uint16_t)std::min(inbound_stream.available_capacity(), (uint64_t)UINT16_MAX) };
+  return { ackno, (uint16_t)std::min(inbound_stream.available_capacity() >> window_shift_, (uint64_t)UINT16_MAX) };
+}
+
+TCPReceiverMessage TCPReceiver::send( const Reassembler& reassembler, const Writer& inbound_stream ) const
+{
+  auto msg = send( inbound_stream );
+  if ( SYN ) {
+    // 流下标 i 对应的绝对序列号是 i + 1（SYN 占一个）
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    reassembler.stored_ranges( ranges, TCPReceiverMessage::MAX_SACK_BLOCKS );
+    for ( auto [first, last] : ranges ) {
+      msg.sack.emplace_back( Wrap32::wrap( first + 1, ISN ), Wrap32::wrap( last + 1, ISN ) );
+    }
+  }
+  return msg;
+}
+
+void TCPReceiver::checkpoint( Serializer& out ) const
+{
+  out.integer( static_cast<uint8_t>( ( SYN ? RECV_SYN : 0 ) | ( ack_now_ ? RECV_ACK_NOW : 0 )
+                                     | ( window_update_ ? RECV_WINDOW_UPDATE : 0 )
+                                     | ( window_scale_offer_.has_value() ? RECV_SCALE_OFFER : 0 )
+                                     | ( peer_window_scale_.has_value() ? RECV_PEER_SCALE : 0 )
+                                     | ( rtt_edge_.has_value() ? RECV_RTT_EDGE : 0 ) ) );
+  out.integer( static_cast<uint32_t>( ISN.unwrap( Wrap32 { 0 }, 0 ) ) ); // Wrap32 的原始值
+  out.integer( window_scale_offer_.value_or( 0 ) );
+  out.integer( peer_window_scale_.value_or( 0 ) );
+  out.integer( window_shift_ );
+  out.integer( unacked_segments_ );
+  out.integer( unacked_ms_ );
+  out.integer( clock_ms_ );
+  out.integer( idle_ms_ );
+  out.integer( rtt_edge_.value_or( 0 ) );
+  out.integer( rtt_start_ms_ );
+  out.integer( rtt_ms_ );
+  out.integer( drain_start_ms_ );
+  out.integer( drain_start_popped_ );
+}
+
+void TCPReceiver::restore( Parser& in )
+{
+  uint8_t flags {};
+  uint32_t isn {};
+  uint8_t offer {};
+  uint8_t peer_scale {};
+  uint64_t rtt_edge {};
+  in.integer( flags );
+  in.integer( isn );
+  in.integer( offer );
+  in.integer( peer_scale );
+  in.integer( window_shift_ );
+  in.integer( unacked_segments_ );
+  in.integer( unacked_ms_ );
+  in.integer( clock_ms_ );
+  in.integer( idle_ms_ );
+  in.integer( rtt_edge );
+  in.integer( rtt_start_ms_ );
+  in.integer( rtt_ms_ );
+  in.integer( drain_start_ms_ );
+  in.integer( drain_start_popped_ );
+  if ( in.has_error() ) {
+    return;
+  }
+  SYN = flags & RECV_SYN;
+  ISN = Wrap32 { isn };
+  ack_now_ = flags & RECV_ACK_NOW;
+  window_update_ = flags & RECV_WINDOW_UPDATE;
+  window_scale_offer_ = flags & RECV_SCALE_OFFER ? optional<uint8_t> { offer } : nullopt;
+  peer_window_scale_ = flags & RECV_PEER_SCALE ? optional<uint8_t> { peer_scale } : nullopt;
+  rtt_edge_ = flags & RECV_RTT_EDGE ? optional<uint64_t> { rtt_edge } : nullopt;
 }
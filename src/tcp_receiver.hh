@@ -1,21 +1,119 @@
 #pragma once
 
 #include "reassembler.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 
+#include <span>
+
 class TCPReceiver
 {
 public:
+  TCPReceiver() = default;
+
+  /* Construct a TCPReceiver that offers window scaling if `config.window_scaling` is set */
+  explicit TCPReceiver( const TCPConfig& config );
+
   /*
    * The TCPReceiver receives TCPSenderMessages, inserting their payload into the Reassembler
    * at the correct stream index.
    */
-  void receive( TCPSenderMessage message, Reassembler& reassembler, Writer& inbound_stream );
+  void receive( TCPSenderMessage&& message, Reassembler& reassembler, Writer& inbound_stream );
+
+  /* Same, sharing the payload's storage instead of taking it over */
+  void receive( const TCPSenderMessage& message, Reassembler& reassembler, Writer& inbound_stream );
+
+  /*
+   * Receive a batch of segments (e.g. all that one poll of the network returned), as if one at a time,
+   * but merge each run of back-to-back in-order segments into a single Reassembler insert (like GRO).
+   * A run's payloads are joined without copying when they are adjacent slices of one Buffer, and
+   * copied into one string otherwise. The messages' payloads are moved from.
+   */
+  void receive_batch( std::span<TCPSenderMessage> messages, Reassembler& reassembler, Writer& inbound_stream );
 
   /* The TCPReceiver sends TCPReceiverMessages back to the TCPSender. */
   TCPReceiverMessage send( const Writer& inbound_stream ) const;
+
+  /* Same, plus SACK blocks for the bytes the Reassembler is holding beyond the ackno. */
+  TCPReceiverMessage send( const Reassembler& reassembler, const Writer& inbound_stream ) const;
+
+  /*
+   * Delayed ACKs (TCPConfig::delayed_ack). ack_due() says whether an ACK is owed right now: without
+   * delayed ACKs, whenever a segment has arrived since the last ACK. With them, only after
+   * DELAYED_ACK_SEGMENTS segments, delayed_ack_ms milliseconds, or a segment that must be ACKed at
+   * once (SYN, FIN, out of order, or filling a hole). Call ack_sent() whenever an ACK goes out,
+   * including one piggybacked on data.
+   */
+  bool ack_due() const;
+  void ack_sent();
+
+  /*
+   * The reader made room in a full inbound stream: make an ACK due at once, so the window that opened
+   * is advertised (a window update) instead of waiting for the sender's next zero-window probe.
+   */
+  void window_opened();
+  void tick( uint64_t ms_since_last_tick );
+
+  /*
+   * Receive-buffer auto-tuning (TCPConfig::recv_autotune). Once per round trip, if the reader drained
+   * more than half the buffer, receive() grows the inbound stream's capacity to twice what was drained
+   * (up to recv_capacity_max), so the window keeps up with a fast reader on a long path. The round trip
+   * is estimated as the shortest time it took data to fill the window up to the edge advertised when
+   * timing began. This tick() also shrinks the buffer back to recv_capacity after recv_autotune_idle_ms
+   * without data.
+   */
+  void tick( uint64_t ms_since_last_tick, Writer& inbound_stream );
+
+  /* send( inbound_stream ) if an ACK is due (and mark it sent), or empty optional otherwise */
+  std::optional<TCPReceiverMessage> maybe_send( const Writer& inbound_stream );
+
+  /* The window scale offered in the peer's SYN, if any (for the peer's TCPSender to learn) */
+  std::optional<uint8_t> peer_window_scale() const { return peer_window_scale_; }
+
+  /*
+   * Save the connection's state (ISN, window scaling, owed ACKs, auto-tuning measurements) so that
+   * restore() can bring it back, e.g. in a new process. Settings that come from the TCPConfig are
+   * not saved: the restored receiver keeps those it was constructed with.
+   */
+  void checkpoint( Serializer& out ) const;
+  void restore( Parser& in );
+
 private:
   bool SYN{false};
   Wrap32 ISN{0}; // 初始化序列号
+
+  // RFC 7323：双方的 SYN 都带了 window scale 时，通告的窗口右移 window_shift_ 位
+  std::optional<uint8_t> window_scale_offer_ {};
+  std::optional<uint8_t> peer_window_scale_ {};
+  uint8_t window_shift_ {};
+
+  // 延迟 ACK：自上次 ACK 以来收到的段数、经过的时间，以及是否需要立即 ACK
+  bool delayed_ack_ { false };
+  uint64_t delayed_ack_ms_ { TCPConfig::DELAYED_ACK_DFLT };
+  uint64_t unacked_segments_ {};
+  uint64_t unacked_ms_ {};
+  bool ack_now_ { false };
+  bool window_update_ { false };
+
+  // 接收缓冲自动调整，见 tick( ms, inbound_stream ) 的说明
+  bool autotune_ { false };
+  uint64_t capacity_min_ { TCPConfig::DEFAULT_CAPACITY };
+  uint64_t capacity_max_ { TCPConfig::RECV_CAPACITY_MAX_DFLT };
+  uint64_t autotune_idle_ms_ { TCPConfig::RECV_AUTOTUNE_IDLE_DFLT };
+  uint64_t clock_ms_ {};
+  uint64_t idle_ms_ {};
+  std::optional<uint64_t> rtt_edge_ {}; // 正在计时：数据到达这个流下标时算一个 RTT 样本
+  uint64_t rtt_start_ms_ {};
+  uint64_t rtt_ms_ { UINT64_MAX };      // 取所有样本的最小值
+  uint64_t drain_start_ms_ {};
+  uint64_t drain_start_popped_ {};
+  void autotune( Writer& inbound_stream );
+
+  // `segments`：合并后的段代表几个原始段（延迟 ACK 按原始段计数）
+  void receive( const TCPSenderMessage& message,
+                Buffer payload,
+                Reassembler& reassembler,
+                Writer& inbound_stream,
+                uint64_t segments = 1 );
 };
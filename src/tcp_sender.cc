@@ -1,15 +1,84 @@
 #include "tcp_sender.hh"
+#include "parser.hh"
+#include "profile.hh"
 #include "tcp_config.hh"
 
+#include <algorithm>
+#include <iterator>
 #include <random>
 
 using namespace std;
 
+namespace {
+// TCPSender checkpoint 的标志位，以及在途段的 SYN / FIN / sacked
+enum : uint8_t
+{
+  SENDER_SYN = 1,
+  SENDER_FIN = 2,
+  SENDER_CORKED = 4,
+  SENDER_SCALE_OFFER = 8,
+  SENDER_SRTT = 16,
+  SEGMENT_SYN = 1,
+  SEGMENT_FIN = 2,
+  SEGMENT_SACKED = 4,
+};
+} // namespace
+
+void Timer::checkpoint( Serializer& out ) const
+{
+  out.integer( initial_RTO_ms_ );
+  out.integer( curr_RTO_ms );
+  out.integer( static_cast<uint8_t>( running_ ) );
+  out.integer( static_cast<uint64_t>( running_ ? elapsed_ms() : 0 ) );
+  out.integer( clock_ms_ );
+}
+
+void Timer::restore( Parser& in )
+{
+  uint8_t running {};
+  uint64_t elapsed {};
+  in.integer( initial_RTO_ms_ );
+  in.integer( curr_RTO_ms );
+  in.integer( running );
+  in.integer( elapsed );
+  in.integer( clock_ms_ );
+  stop();
+  if ( in.has_error() or not running ) {
+    return;
+  }
+  // 接着跑完剩下的 RTO
+  running_ = true;
+  time_ms_ = elapsed;
+  if ( wheel_ ) {
+    start_ms_ = wheel_->now() - std::min<uint64_t>( elapsed, wheel_->now() );
+    handle_ = wheel_->schedule( start_ms_ + curr_RTO_ms, token_ );
+  }
+}
+
 /* TCPSender constructor (uses a random ISN if none given) */
 TCPSender::TCPSender( uint64_t initial_RTO_ms, optional<Wrap32> fixed_isn )
   : isn_( fixed_isn.value_or( Wrap32 { random_device()() } ) ), initial_RTO_ms_( initial_RTO_ms )
 {}
 
+TCPSender::TCPSender( const TCPConfig& config ) : TCPSender( config.rt_timeout, config.fixed_isn )
+{
+  adaptive_rto_ = config.adaptive_rto;
+  rto_min_ms_ = config.rto_min;
+  rto_max_ms_ = config.rto_max;
+  fast_retransmit_ = config.fast_retransmit;
+  max_payload_size_ = max<uint64_t>( config.mss * config.tso_segments, 1 );
+  nagle_ = config.nagle;
+  corked_ = config.cork;
+  congestion_control_ = CongestionControl::make( config );
+  if ( config.window_scaling ) {
+    window_scale_offer_ = config.window_scale();
+  }
+  pacing_ = config.pacing;
+  pacing_rate_ = config.pacing_rate;
+  pacing_burst_ = static_cast<int64_t>( config.pacing_burst ? config.pacing_burst : 2 * config.mss ) * 1000;
+  pacing_tokens_ = pacing_burst_;
+}
+
 uint64_t TCPSender::sequence_numbers_in_flight() const
 {
   return outstanding_cnt_;
@@ -20,31 +89,136 @@ uint64_t TCPSender::consecutive_retransmissions() const
   return retransmit_cnt_;
 }
 
-optional<TCPSenderMessage> TCPSender::maybe_send()
+optional<uint64_t> TCPSender::smoothed_rtt_ms() const
 {
-  if ( queued_segments_.empty() ) {
+  if ( !srtt_x8_.has_value() ) {
     return {};
   }
+  return *srtt_x8_ / 8;
+}
+
+uint64_t TCPSender::current_RTO_ms() const
+{
+  return timer_.RTO();
+}
+
+uint64_t TCPSender::duplicate_acks() const
+{
+  return dup_ack_cnt_;
+}
+
+uint64_t TCPSender::congestion_window() const
+{
+  return congestion_control_ ? congestion_control_->cwnd() : UINT64_MAX;
+}
+
+uint64_t TCPSender::window_size() const
+{
+  return window_size_;
+}
+
+uint64_t TCPSender::max_payload_size() const
+{
+  return max_payload_size_;
+}
+
+/* 固定速率，或者（在测出 SRTT 之后）每个 SRTT 发完一个窗口、再乘上 PACING_GAIN_PERCENT 留些余量 */
+uint64_t TCPSender::pacing_rate() const
+{
+  if ( !pacing_ ) {
+    return UINT64_MAX;
+  }
+  if ( pacing_rate_ != 0 ) {
+    return pacing_rate_;
+  }
+  auto const srtt = smoothed_rtt_ms();
+  if ( !srtt.has_value() ) {
+    return UINT64_MAX;
+  }
+  auto const window = min( max<uint64_t>( window_size_, 1 ), congestion_window() );
+  return max<uint64_t>( window * 1000 * TCPConfig::PACING_GAIN_PERCENT / 100 / max<uint64_t>( *srtt, 1 ), 1 );
+}
+
+void TCPSender::set_peer_window_scale( uint8_t shift )
+{
+  if ( window_scale_offer_.has_value() ) {
+    peer_window_shift_ = min( shift, TCPConfig::MAX_WINDOW_SCALE );
+  }
+}
+
+/**
+ * RFC 6298 2.2 / 2.3：
+ * 第一个样本 R：SRTT = R，RTTVAR = R / 2
+ * 之后：RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|，SRTT = 7/8 SRTT + 1/8 R
+ * RTO = SRTT + max( G, 4 * RTTVAR )，时钟粒度 G 为 1 ms，再限制在 [rto_min, rto_max]
+ */
+void TCPSender::sample_rtt( uint64_t rtt_ms )
+{
+  if ( !srtt_x8_.has_value() ) {
+    srtt_x8_ = rtt_ms * 8;
+    rttvar_x4_ = rtt_ms * 2;
+  } else {
+    auto const srtt_ms = *srtt_x8_ / 8;
+    auto const err = srtt_ms > rtt_ms ? srtt_ms - rtt_ms : rtt_ms - srtt_ms;
+    rttvar_x4_ = rttvar_x4_ - rttvar_x4_ / 4 + err;
+    *srtt_x8_ = *srtt_x8_ - *srtt_x8_ / 8 + rtt_ms;
+  }
+  auto const rto = *srtt_x8_ / 8 + max<uint64_t>( 1, rttvar_x4_ );
+  timer_.set_initial_RTO( clamp( rto, rto_min_ms_, rto_max_ms_ ) );
+}
+
+void TCPSender::release( const TCPSenderMessage& msg )
+{
   if ( !timer_.is_running() ) {
     timer_.start();
   }
-  auto msg = queued_segments_.front();
-  queued_segments_.pop();
+  if ( pacing_ ) {
+    pacing_tokens_ -= static_cast<int64_t>( msg.sequence_length() ) * 1000;
+  }
+}
+
+optional<TCPSenderMessage> TCPSender::maybe_send()
+{
+  if ( queued_empty() || paced_out() ) {
+    return {};
+  }
+  auto msg = pop_queued();
+  release( msg );
   return msg;
 }
 
+void TCPSender::maybe_send_all( vector<TCPSenderMessage>& out )
+{
+  if ( !pacing_ ) {
+    out.reserve( out.size() + queued_segments_.size() - queued_head_ );
+  }
+  while ( !queued_empty() && !paced_out() ) {
+    out.push_back( pop_queued() );
+    release( out.back() );
+  }
+}
+
 void TCPSender::push( Reader& outbound_stream )
 {
-  size_t curr_window_size = window_size_ != 0 ? window_size_ : 1;
+  const ProfileScope<Profile::TCP_SENDER_PUSH> profile;
+  uint64_t curr_window_size = window_size_ != 0 ? window_size_ : 1;
+  if ( congestion_control_ ) {
+    curr_window_size = min<uint64_t>( curr_window_size, congestion_control_->cwnd() );
+  }
   while ( outstanding_cnt_ < curr_window_size ) {
     TCPSenderMessage msg;
     if ( !syn_ ) {
       syn_ = msg.SYN = true;
+      msg.window_scale = window_scale_offer_;
       outstanding_cnt_ += 1;
     }
     msg.seqno = Wrap32::wrap( next_seqno_, isn_ );
 
-    auto const payload_size = min( TCPConfig::MAX_PAYLOAD_SIZE, curr_window_size - outstanding_cnt_ );
+    auto const payload_size = min( max_payload_size_, curr_window_size - outstanding_cnt_ );
+    // 零窗口探测不受 Nagle / cork 限制
+    if ( !msg.SYN && window_size_ != 0 && hold_partial_segment( outbound_stream, payload_size ) ) {
+      break;
+    }
     read( outbound_stream, payload_size, msg.payload );
     outstanding_cnt_ += msg.payload.size();
 
@@ -57,11 +231,17 @@ void TCPSender::push( Reader& outbound_stream )
       break;
     }
 
-    queued_segments_.push( msg );
+    // 两个队列里的 payload 共享同一个 Buffer，不拷贝字节
     next_seqno_ += msg.sequence_length();
-    outstanding_segments_.push( msg );
+    if ( adaptive_rto_ && !rtt_timing_ ) {
+      rtt_timing_ = true;
+      rtt_seqno_end_ = next_seqno_;
+      rtt_start_ms_ = timer_.now();
+    }
+    outstanding_segments_.push_back( { next_seqno_ - msg.sequence_length(), msg.payload, msg.SYN, msg.FIN } );
+    queued_segments_.push_back( std::move( msg ) );
 
-    if ( msg.FIN || outbound_stream.bytes_buffered() == 0 ) {
+    if ( fin_ || outbound_stream.bytes_buffered() == 0 ) {
       break;
     }
   }
@@ -75,43 +255,357 @@ TCPSenderMessage TCPSender::send_empty_message() const
 
 void TCPSender::receive( const TCPReceiverMessage& msg )
 {
-  window_size_ = msg.window_size;
+  auto const window = static_cast<uint64_t>( msg.window_size ) << peer_window_shift_;
+  auto const window_changed = window_size_ != window;
+  window_size_ = window;
   if ( msg.ackno.has_value() ) {
     auto ackno = msg.ackno.value().unwrap( isn_, next_seqno_ );
-    if ( ackno > next_seqno_ ) {
+    // 乱序到达的旧 ACK 只更新窗口：确认点不能往回退，否则下一个 ACK 会把同一段数据再算一遍
+    if ( ackno > next_seqno_ || ackno < acked_seqno_ ) {
       return;
     }
+    mark_sacked( msg );
+    // RFC 5681：ackno 没有前进、窗口没变、还有数据在途，算一次重复 ACK
+    if ( ackno == acked_seqno_ && !window_changed && !outstanding_empty() ) {
+      if ( ++dup_ack_cnt_ == TCPConfig::DUP_ACK_THRESHOLD && fast_retransmit_ ) {
+        // 重传最早的段，以及 SACK 显示出来的其他空洞（最高 SACK 之前、没被 SACK 的段）
+        for ( auto i = outstanding_head_; i < outstanding_segments_.size(); ++i ) {
+          auto const& seg = outstanding_segments_[i];
+          if ( i != outstanding_head_ && seg.end() > highest_sacked_ ) {
+            break;
+          }
+          if ( !seg.sacked ) {
+            queued_segments_.push_back( make_message( seg ) );
+          }
+        }
+        rtt_timing_ = false;
+        if ( congestion_control_ ) {
+          congestion_control_->on_fast_retransmit( outstanding_cnt_, timer_.now() );
+        }
+      }
+    } else if ( ackno > acked_seqno_ ) {
+      dup_ack_cnt_ = 0;
+    }
+    auto const newly_acked = ackno > acked_seqno_ ? ackno - acked_seqno_ : 0;
     acked_seqno_ = ackno;
+    if ( rtt_timing_ && ackno >= rtt_seqno_end_ ) {
+      rtt_timing_ = false;
+      sample_rtt( timer_.now() - rtt_start_ms_ );
+    }
+    if ( congestion_control_ && newly_acked > 0 ) {
+      congestion_control_->on_ack( newly_acked, timer_.now(), smoothed_rtt_ms() );
+    }
 
-    while ( !outstanding_segments_.empty() ) {
-      auto& front_msg = outstanding_segments_.front();
-      if ( front_msg.seqno.unwrap( isn_, next_seqno_ ) + front_msg.sequence_length() <= acked_seqno_ ) {
-        outstanding_cnt_ -= front_msg.sequence_length();
-        outstanding_segments_.pop();
-        timer_.reset_RTO();
-        if ( !outstanding_segments_.empty() ) {
-          timer_.start();
-        }
-        retransmit_cnt_ = 0;
-      } else {
+    retire_acked();
+  }
+}
+
+/**
+ * 一个累计 ACK 可能确认几百个段：在途段按序列号排好且首尾相接，二分找到第一个没被完全确认的段，
+ * 之前的整批出队，计时器也只重置一次
+ */
+void TCPSender::retire_acked()
+{
+  auto const first = outstanding_segments_.begin() + static_cast<ptrdiff_t>( outstanding_head_ );
+  auto const boundary = partition_point(
+    first, outstanding_segments_.end(), [&]( const Outstanding& seg ) { return seg.end() <= acked_seqno_; } );
+  if ( boundary != first ) {
+    outstanding_cnt_ -= prev( boundary )->end() - first->seqno;
+    pop_outstanding( static_cast<size_t>( boundary - first ) );
+    timer_.reset_RTO();
+    if ( !outstanding_empty() ) {
+      timer_.start();
+    }
+    retransmit_cnt_ = 0;
+  }
+  if ( outstanding_empty() ) {
+    timer_.stop();
+  }
+}
+
+// 把完全落在某个 SACK 块里的在途段标记为已收到
+void TCPSender::mark_sacked( const TCPReceiverMessage& msg )
+{
+  for ( auto const& [left, right] : msg.sack ) {
+    auto const begin = left.unwrap( isn_, next_seqno_ );
+    auto const end = right.unwrap( isn_, next_seqno_ );
+    if ( end > next_seqno_ || begin >= end ) {
+      continue;
+    }
+    highest_sacked_ = max( highest_sacked_, end );
+    for ( auto i = outstanding_head_; i < outstanding_segments_.size(); ++i ) {
+      auto& seg = outstanding_segments_[i];
+      if ( seg.seqno >= end ) {
         break;
       }
+      if ( seg.seqno >= begin && seg.end() <= end ) {
+        seg.sacked = true;
+      }
     }
-    if ( outstanding_segments_.empty() ) {
-      timer_.stop();
+  }
+}
+
+void TCPSender::pop_outstanding( size_t count )
+{
+  for ( auto i = outstanding_head_; i < outstanding_head_ + count; ++i ) {
+    outstanding_segments_[i].payload = {};
+  }
+  outstanding_head_ += count;
+  if ( outstanding_empty() ) {
+    outstanding_segments_.clear();
+    outstanding_head_ = 0;
+  } else if ( outstanding_head_ * 2 >= outstanding_segments_.size() ) {
+    // 剩下的不比已出队的多，挪一次的代价摊到出队的段上
+    outstanding_segments_.erase( outstanding_segments_.begin(),
+                                 outstanding_segments_.begin() + static_cast<ptrdiff_t>( outstanding_head_ ) );
+    outstanding_head_ = 0;
+  }
+}
+
+TCPSenderMessage TCPSender::pop_queued()
+{
+  auto msg = std::move( queued_segments_[queued_head_++] );
+  if ( queued_empty() ) {
+    queued_segments_.clear();
+    queued_head_ = 0;
+  } else if ( queued_head_ * 2 >= queued_segments_.size() ) {
+    queued_segments_.erase( queued_segments_.begin(),
+                            queued_segments_.begin() + static_cast<ptrdiff_t>( queued_head_ ) );
+    queued_head_ = 0;
+  }
+  return msg;
+}
+
+void TCPSender::release_memory()
+{
+  if ( outstanding_empty() ) {
+    outstanding_segments_.clear();
+    outstanding_segments_.shrink_to_fit();
+    outstanding_head_ = 0;
+  }
+  if ( queued_empty() ) {
+    queued_segments_.clear();
+    queued_segments_.shrink_to_fit();
+    queued_head_ = 0;
+  }
+}
+
+TCPSenderMessage TCPSender::make_message( const Outstanding& seg ) const
+{
+  TCPSenderMessage msg { Wrap32::wrap( seg.seqno, isn_ ), seg.SYN, seg.payload, seg.FIN };
+  if ( seg.SYN ) {
+    msg.window_scale = window_scale_offer_;
+  }
+  return msg;
+}
+
+void TCPSender::set_cork( bool corked )
+{
+  corked_ = corked;
+}
+
+/**
+ * RFC 896 Nagle：有未确认的数据时，不满一个 MSS 的段等到 ACK 回来再发
+ * cork：不论有没有未确认的数据，都只发满 MSS 的段
+ * 写端已关闭且剩下的字节都能放进这一段时照常发（FIN 要带出去）
+ */
+bool TCPSender::hold_partial_segment( const Reader& outbound_stream, uint64_t payload_size ) const
+{
+  if ( !corked_ && !( nagle_ && outstanding_cnt_ > 0 ) ) {
+    return false;
+  }
+  auto const len = min( payload_size, outbound_stream.bytes_buffered() );
+  if ( len >= max_payload_size_ ) {
+    return false;
+  }
+  return !( outbound_stream.is_closed() && len == outbound_stream.bytes_buffered() );
+}
+
+void TCPSender::split_segment( const TCPSenderMessage& msg, size_t mss, vector<TCPSenderMessage>& out )
+{
+  mss = max<size_t>( mss, 1 );
+  auto seqno = msg.seqno;
+  size_t offset = 0;
+  // 至少产生一段（纯 SYN / FIN 的段没有 payload）
+  do {
+    auto const len = min( mss, msg.payload.size() - offset );
+    TCPSenderMessage piece;
+    piece.seqno = seqno;
+    piece.SYN = msg.SYN && offset == 0;
+    if ( piece.SYN ) {
+      piece.window_scale = msg.window_scale;
     }
+    piece.payload = msg.payload.substr( offset, len );
+    offset += len;
+    piece.FIN = msg.FIN && offset == msg.payload.size();
+    seqno = seqno + piece.sequence_length();
+    out.push_back( std::move( piece ) );
+  } while ( offset < msg.payload.size() );
+}
+
+void TCPSender::attach_timer_wheel( TimerWheel& wheel, TimerWheel::Token token )
+{
+  auto const running = timer_.is_running();
+  timer_.attach( wheel, token );
+  if ( running ) {
+    timer_.start();
   }
 }
 
 void TCPSender::tick( const size_t ms_since_last_tick )
 {
   timer_.tick( ms_since_last_tick );
+  if ( pacing_ && ms_since_last_tick > 0 ) {
+    // 令牌最多攒到一个 burst：补充量（rate * ms）不会小于 burst 时直接填满，也避免了乘法溢出
+    auto const rate = pacing_rate();
+    auto const burst = static_cast<uint64_t>( pacing_burst_ );
+    if ( rate >= burst || ms_since_last_tick >= burst ) {
+      pacing_tokens_ = pacing_burst_;
+    } else {
+      pacing_tokens_ = min( pacing_tokens_ + static_cast<int64_t>( rate * ms_since_last_tick ), pacing_burst_ );
+    }
+  }
   if ( timer_.is_expired() ) {
-    queued_segments_.push( outstanding_segments_.front() );
+    queued_segments_.push_back( make_message( outstanding_front() ) );
+    // Karn：重传过的段测不出可信的 RTT
+    rtt_timing_ = false;
     if ( window_size_ != 0 ) {
       ++retransmit_cnt_;
-      timer_.double_RTO();
+      timer_.double_RTO( adaptive_rto_ ? rto_max_ms_ : UINT64_MAX );
+      if ( congestion_control_ ) {
+        congestion_control_->on_timeout( outstanding_cnt_, timer_.now() );
+      }
     }
     timer_.start();
   }
-}
\ No newline at end of file
+}
+/**
+ * 在途段连同 payload 一起存（payload 的 Buffer 直接交给 Serializer）；待发送的段都是某个在途段的拷贝，
+ * 只存它的序列号，恢复时重新拼出来（对应的段已经被确认了就不用再发）
+ */
+void TCPSender::checkpoint( Serializer& out ) const
+{
+  out.integer( static_cast<uint8_t>( ( syn_ ? SENDER_SYN : 0 ) | ( fin_ ? SENDER_FIN : 0 )
+                                     | ( corked_ ? SENDER_CORKED : 0 )
+                                     | ( window_scale_offer_.has_value() ? SENDER_SCALE_OFFER : 0 )
+                                     | ( srtt_x8_.has_value() ? SENDER_SRTT : 0 ) ) );
+  out.integer( static_cast<uint32_t>( isn_.unwrap( Wrap32 { 0 }, 0 ) ) ); // Wrap32 的原始值
+  out.integer( static_cast<uint32_t>( retransmit_cnt_ ) );
+  out.integer( acked_seqno_ );
+  out.integer( next_seqno_ );
+  out.integer( window_size_ );
+  out.integer( window_scale_offer_.value_or( 0 ) );
+  out.integer( peer_window_shift_ );
+  out.integer( outstanding_cnt_ );
+  out.integer( srtt_x8_.value_or( 0 ) );
+  out.integer( rttvar_x4_ );
+  out.integer( static_cast<uint32_t>( dup_ack_cnt_ ) );
+  out.integer( static_cast<uint64_t>( pacing_tokens_ ) );
+  out.integer( highest_sacked_ );
+  timer_.checkpoint( out );
+
+  if ( congestion_control_ ) {
+    out.integer( static_cast<uint8_t>( congestion_control_->algorithm() ) );
+    congestion_control_->checkpoint( out, timer_.now() );
+  } else {
+    out.integer( static_cast<uint8_t>( TCPConfig::CongestionAlgorithm::None ) );
+  }
+
+  out.integer( static_cast<uint64_t>( outstanding_segments_.size() - outstanding_head_ ) );
+  for ( auto i = outstanding_head_; i < outstanding_segments_.size(); ++i ) {
+    auto const& seg = outstanding_segments_[i];
+    out.integer( seg.seqno );
+    out.integer(
+      static_cast<uint8_t>( ( seg.SYN ? SEGMENT_SYN : 0 ) | ( seg.FIN ? SEGMENT_FIN : 0 )
+                            | ( seg.sacked ? SEGMENT_SACKED : 0 ) ) );
+    out.integer( static_cast<uint64_t>( seg.payload.size() ) );
+    if ( !seg.payload.empty() ) {
+      out.buffer( seg.payload );
+    }
+  }
+
+  out.integer( static_cast<uint64_t>( queued_segments_.size() - queued_head_ ) );
+  for ( auto i = queued_head_; i < queued_segments_.size(); ++i ) {
+    out.integer( queued_segments_[i].seqno.unwrap( isn_, next_seqno_ ) );
+  }
+}
+
+void TCPSender::restore( Parser& in )
+{
+  uint8_t flags {};
+  uint32_t isn {};
+  uint32_t retransmit_cnt {};
+  uint8_t offer {};
+  uint64_t srtt_x8 {};
+  uint32_t dup_ack_cnt {};
+  uint64_t pacing_tokens {};
+  uint8_t algorithm {};
+  in.integer( flags );
+  in.integer( isn );
+  in.integer( retransmit_cnt );
+  in.integer( acked_seqno_ );
+  in.integer( next_seqno_ );
+  in.integer( window_size_ );
+  in.integer( offer );
+  in.integer( peer_window_shift_ );
+  in.integer( outstanding_cnt_ );
+  in.integer( srtt_x8 );
+  in.integer( rttvar_x4_ );
+  in.integer( dup_ack_cnt );
+  in.integer( pacing_tokens );
+  in.integer( highest_sacked_ );
+  timer_.restore( in );
+  in.integer( algorithm );
+  if ( in.has_error() ) {
+    return;
+  }
+  syn_ = flags & SENDER_SYN;
+  fin_ = flags & SENDER_FIN;
+  corked_ = flags & SENDER_CORKED;
+  isn_ = Wrap32 { isn };
+  retransmit_cnt_ = retransmit_cnt;
+  window_scale_offer_ = flags & SENDER_SCALE_OFFER ? optional<uint8_t> { offer } : nullopt;
+  srtt_x8_ = flags & SENDER_SRTT ? optional<uint64_t> { srtt_x8 } : nullopt;
+  dup_ack_cnt_ = dup_ack_cnt;
+  pacing_tokens_ = static_cast<int64_t>( pacing_tokens );
+  rtt_timing_ = false;
+
+  // 换了拥塞控制算法（或者不用了）就从新算法的初始状态开始
+  if ( congestion_control_ && algorithm == static_cast<uint8_t>( congestion_control_->algorithm() ) ) {
+    congestion_control_->restore( in, timer_.now() );
+  } else if ( algorithm != static_cast<uint8_t>( TCPConfig::CongestionAlgorithm::None ) ) {
+    CongestionControl::skip( in );
+  }
+
+  outstanding_segments_.clear();
+  outstanding_head_ = 0;
+  uint64_t count {};
+  in.integer( count );
+  for ( uint64_t i = 0; i < count and not in.has_error(); ++i ) {
+    Outstanding seg { 0, {} };
+    uint8_t seg_flags {};
+    uint64_t size {};
+    in.integer( seg.seqno );
+    in.integer( seg_flags );
+    in.integer( size );
+    in.buffer( size, seg.payload );
+    seg.SYN = seg_flags & SEGMENT_SYN;
+    seg.FIN = seg_flags & SEGMENT_FIN;
+    seg.sacked = seg_flags & SEGMENT_SACKED;
+    outstanding_segments_.push_back( std::move( seg ) );
+  }
+
+  queued_segments_.clear();
+  queued_head_ = 0;
+  in.integer( count );
+  for ( uint64_t i = 0; i < count and not in.has_error(); ++i ) {
+    uint64_t seqno {};
+    in.integer( seqno );
+    auto const seg = partition_point( outstanding_segments_.begin(),
+                                      outstanding_segments_.end(),
+                                      [&]( const Outstanding& s ) { return s.seqno < seqno; } );
+    if ( seg != outstanding_segments_.end() && seg->seqno == seqno ) {
+      queued_segments_.push_back( make_message( *seg ) );
+    }
+  }
+}
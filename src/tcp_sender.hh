@@ -1,11 +1,15 @@
 #pragma once
 
 #include "byte_stream.hh"
+#include "congestion_control.hh"
+#include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
+#include "timer_wheel.hh"
 
-#include <queue>
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 class Timer
 {
@@ -14,32 +18,74 @@ private:
   uint64_t curr_RTO_ms;
   size_t time_ms_ { 0 };
   bool running_ { false };
+  uint64_t clock_ms_ { 0 }; // 所有 tick 的总和（不论是否在运行）
+
+  // 挂在共享的 TimerWheel 上时，时间由 wheel 提供，tick() 不再累加
+  TimerWheel* wheel_ { nullptr };
+  TimerWheel::Token token_ {};
+  TimerWheel::Handle handle_ {};
+  uint64_t start_ms_ {};
+
+  size_t elapsed_ms() const { return wheel_ ? wheel_->now() - start_ms_ : time_ms_; }
 
 public:
   explicit Timer( uint64_t init_RTO ) : initial_RTO_ms_( init_RTO ), curr_RTO_ms( init_RTO ) {}
 
+  // Let `wheel` keep time for this Timer; it fires `token` when the Timer expires
+  void attach( TimerWheel& wheel, TimerWheel::Token token )
+  {
+    stop();
+    wheel_ = &wheel;
+    token_ = token;
+  }
+
   void start()
   {
     running_ = true;
     time_ms_ = 0;
+    if ( wheel_ ) {
+      wheel_->cancel( handle_ );
+      start_ms_ = wheel_->now();
+      handle_ = wheel_->schedule( start_ms_ + curr_RTO_ms, token_ );
+    }
   }
 
-  void stop() { running_ = false; }
+  void stop()
+  {
+    running_ = false;
+    if ( wheel_ ) {
+      wheel_->cancel( handle_ );
+    }
+  }
 
   bool is_running() const { return running_; }
 
-  bool is_expired() const { return running_ && ( time_ms_ >= curr_RTO_ms ); }
+  bool is_expired() const { return running_ && ( elapsed_ms() >= curr_RTO_ms ); }
+
+  // Milliseconds since the Timer was created (or the wheel's clock, when attached)
+  uint64_t now() const { return wheel_ ? wheel_->now() : clock_ms_; }
 
   void tick( size_t const ms_since_last_tick )
   {
-    if ( running_ ) {
+    clock_ms_ += ms_since_last_tick;
+    if ( running_ && !wheel_ ) {
       time_ms_ += ms_since_last_tick;
     }
   }
 
-  void double_RTO() { curr_RTO_ms *= 2; }
+  void double_RTO( uint64_t limit = UINT64_MAX ) { curr_RTO_ms = std::min( curr_RTO_ms * 2, limit ); }
 
   void reset_RTO() { curr_RTO_ms = initial_RTO_ms_; }
+
+  // Change the RTO that reset_RTO() goes back to
+  void set_initial_RTO( uint64_t RTO ) { initial_RTO_ms_ = RTO; }
+
+  uint64_t RTO() const { return curr_RTO_ms; }
+
+  // Save the RTOs, the clock and how long the Timer has been running; a restored running Timer
+  // expires when the rest of its RTO has passed (on the wheel, if one is attached already)
+  void checkpoint( Serializer& out ) const;
+  void restore( Parser& in );
 };
 
 class TCPSender
@@ -48,12 +94,19 @@ public:
   /* Construct TCP sender with given default Retransmission Timeout and possible ISN */
   TCPSender( uint64_t initial_rto_ms, std::optional<Wrap32> fixed_isn );
 
+  /* Construct TCP sender with the RTO, ISN and options from `config` */
+  explicit TCPSender( const TCPConfig& config );
+
   /* Push bytes from the outbound stream */
   void push( Reader& outbound_stream );
 
-  /* Send a TCPSenderMessage if needed (or empty optional otherwise) */
+  /* Send a TCPSenderMessage if needed (or empty optional otherwise). With pacing on, a segment
+     that is ready may have to wait for a later tick() before it is released. */
   std::optional<TCPSenderMessage> maybe_send();
 
+  /* Append every TCPSenderMessage that needs sending to `out` (same as calling maybe_send() until it's empty) */
+  void maybe_send_all( std::vector<TCPSenderMessage>& out );
+
   /* Generate an empty TCPSenderMessage */
   TCPSenderMessage send_empty_message() const;
 
@@ -63,12 +116,49 @@ public:
   /* Time has passed by the given # of milliseconds since the last time the tick() method was called. */
   void tick( uint64_t ms_since_last_tick );
 
+  /* Cork or uncork the sender. While corked, push() sends only full-sized segments (and the
+     final one with FIN); call push() again after uncorking to flush what was held back. */
+  void set_cork( bool corked );
+
+  /* Cut a (super-)segment into segments of at most `mss` payload bytes, appending them to `out`.
+     The pieces share the payload's storage; SYN goes on the first piece and FIN on the last. */
+  static void split_segment( const TCPSenderMessage& msg, size_t mss, std::vector<TCPSenderMessage>& out );
+
+  /* Keep the retransmission timer on a shared TimerWheel instead of counting tick()s. The owner
+     advances the wheel and calls tick( 0 ) on the sender whenever `token` fires. */
+  void attach_timer_wheel( TimerWheel& wheel, TimerWheel::Token token );
+
+  /* The peer's SYN offered window scaling with `shift` (see TCPReceiver::peer_window_scale()).
+     Takes effect only if this sender offered window scaling in its own SYN. */
+  void set_peer_window_scale( uint8_t shift );
+
+  /* Give back the storage of the (empty) outstanding and send queues of an idle sender. They are
+     allocated again when push() next has something to send. */
+  void release_memory();
+
+  /* Save the connection's state (sequence numbers, outstanding segments and their payloads, segments
+     waiting to be sent, the timer, the RTT estimate and the congestion window) so that restore() can
+     bring it back, e.g. in a new process. Settings that come from the TCPConfig are not saved. A
+     round trip being timed is abandoned, since the restart would count toward it. Attach a timer
+     wheel (if any) before restoring, so the timer keeps the time it had left. Payloads restored from
+     a checkpoint share the Parser's input. */
+  void checkpoint( Serializer& out ) const;
+  void restore( Parser& in );
+
   /* Accessors for use in testing */
   uint64_t sequence_numbers_in_flight() const;  // How many sequence numbers are outstanding?
   uint64_t consecutive_retransmissions() const; // How many consecutive *re*transmissions have happened?
+  std::optional<uint64_t> smoothed_rtt_ms() const; // SRTT, once a round-trip time has been measured
+  uint64_t current_RTO_ms() const;                 // The retransmission timeout in use right now
+  uint64_t duplicate_acks() const;                 // Duplicate ACKs received since the ackno last advanced
+  uint64_t congestion_window() const;              // cwnd in sequence numbers (UINT64_MAX without congestion control)
+  uint64_t window_size() const;                    // The peer's window in sequence numbers, after scaling
+  uint64_t max_payload_size() const;               // Largest payload push() puts in one message
+  uint64_t pacing_rate() const;                    // Bytes per second released when pacing (UINT64_MAX: not paced)
 private:
   Wrap32 isn_;
   uint64_t initial_RTO_ms_;
+  uint64_t max_payload_size_ { TCPConfig::MAX_PAYLOAD_SIZE }; // mss * tso_segments
 
   bool syn_ { false };
   bool fin_ { false };
@@ -76,11 +166,77 @@ private:
 
   uint64_t acked_seqno_ { 0 };
   uint64_t next_seqno_ { 0 };
-  uint16_t window_size_ { 1 };
+  uint64_t window_size_ { 1 };
+
+  // RFC 7323：SYN 里带上自己的 window scale；对端也提供时，收到的窗口左移 peer_window_shift_ 位
+  std::optional<uint8_t> window_scale_offer_ {};
+  uint8_t peer_window_shift_ {};
 
   uint64_t outstanding_cnt_ { 0 }; // sequence_numbers_in_flight
-  std::queue<TCPSenderMessage> outstanding_segments_ {};
-  std::queue<TCPSenderMessage> queued_segments_ {};
+  // 在途段只记绝对序列号和长度，处理 ACK / SACK 时不用再 unwrap；重传时才拼回 TCPSenderMessage
+  struct Outstanding
+  {
+    uint64_t seqno;        // 绝对序列号
+    Buffer payload;        // 和发出去的段共享同一个 Buffer
+    bool SYN { false };
+    bool FIN { false };
+    bool sacked { false }; // 对端通过 SACK 报告已经收到，不需要重传
+
+    uint64_t end() const { return seqno + SYN + payload.size() + FIN; }
+  };
+  // 连续存放；[outstanding_head_, size) 是还在途的段，出队只移动下标，前面空出一半时再整体挪回开头
+  std::vector<Outstanding> outstanding_segments_ {};
+  size_t outstanding_head_ { 0 };
+
+  bool outstanding_empty() const { return outstanding_head_ == outstanding_segments_.size(); }
+  Outstanding& outstanding_front() { return outstanding_segments_[outstanding_head_]; }
+  void pop_outstanding( size_t count );
+  void retire_acked();
+  TCPSenderMessage make_message( const Outstanding& seg ) const;
+
+  // 待发送的段，和在途段一样用下标出队
+  std::vector<TCPSenderMessage> queued_segments_ {};
+  size_t queued_head_ { 0 };
+
+  bool queued_empty() const { return queued_head_ == queued_segments_.size(); }
+  TCPSenderMessage pop_queued();
 
   Timer timer_ { initial_RTO_ms_ };
+
+  // RFC 6298 RTT 估计（adaptive_rto_ 打开时），定点数：srtt_x8_ = 8 * SRTT，rttvar_x4_ = 4 * RTTVAR
+  bool adaptive_rto_ { false };
+  uint64_t rto_min_ms_ { TCPConfig::RTO_MIN_DFLT };
+  uint64_t rto_max_ms_ { TCPConfig::RTO_MAX_DFLT };
+  std::optional<uint64_t> srtt_x8_ {};
+  uint64_t rttvar_x4_ { 0 };
+  // 同一时间只对一个段计时；该段被重传后样本作废（Karn 算法）
+  bool rtt_timing_ { false };
+  uint64_t rtt_seqno_end_ { 0 };
+  uint64_t rtt_start_ms_ { 0 };
+
+  void sample_rtt( uint64_t rtt_ms );
+
+  // 快速重传：连续收到 DUP_ACK_THRESHOLD 个重复 ACK 时重传最早的未确认段
+  bool fast_retransmit_ { false };
+  unsigned dup_ack_cnt_ { 0 };
+
+  std::unique_ptr<CongestionControl> congestion_control_ {};
+
+  // Nagle / cork：满足条件时先不发不满一个 MSS 的段
+  bool nagle_ { false };
+  bool corked_ { false };
+  bool hold_partial_segment( const Reader& outbound_stream, uint64_t payload_size ) const;
+
+  // 发送节奏：令牌桶由 tick() 按 pacing_rate() 补充，单位是千分之一个序列号（速率按字节/秒，时间按毫秒）。
+  // 令牌为正就放出下一个段并扣掉它的长度，可以扣成负数，这样比桶还大的段（TSO）也能发出去
+  bool pacing_ { false };
+  uint64_t pacing_rate_ { 0 }; // 0：由窗口和 SRTT 推出来
+  int64_t pacing_burst_ { 0 };
+  int64_t pacing_tokens_ { 0 };
+  bool paced_out() const { return pacing_ && pacing_tokens_ <= 0 && pacing_rate() != UINT64_MAX; }
+  void release( const TCPSenderMessage& msg );
+
+  // SACK：最高的已被 SACK 的绝对序列号（不含），低于它且没被 SACK 的段视为丢失
+  uint64_t highest_sacked_ { 0 };
+  void mark_sacked( const TCPReceiverMessage& msg );
 };
@@ -0,0 +1,109 @@
+#include "timer_wheel.hh"
+
+using namespace std;
+
+TimerWheel::Handle TimerWheel::schedule( uint64_t deadline_ms, Token token )
+{
+  uint32_t index {};
+  if ( free_.empty() ) {
+    index = entries_.size();
+    entries_.emplace_back();
+  } else {
+    index = free_.back();
+    free_.pop_back();
+  }
+
+  auto& entry = entries_[index];
+  // 当前这一毫秒的槽已经处理过了，最早只能在下一次 advance 触发
+  entry.deadline = max( deadline_ms, now_ms_ + 1 );
+  entry.token = token;
+  link( index );
+  ++size_;
+  return { index, entry.generation };
+}
+
+void TimerWheel::cancel( Handle& handle ) noexcept
+{
+  if ( handle.index < entries_.size() && entries_[handle.index].generation == handle.generation
+       && entries_[handle.index].slot != NONE ) {
+    unlink( handle.index );
+    ++entries_[handle.index].generation;
+    free_.push_back( handle.index );
+    --size_;
+  }
+  handle = {};
+}
+
+void TimerWheel::advance( uint64_t ms, vector<Token>& fired )
+{
+  for ( ; ms > 0 && size_ > 0; --ms ) {
+    ++now_ms_;
+    // 从高层往低层降级，高层降下来的定时器可能还要继续降到第 0 层
+    for ( unsigned level = LEVELS - 1; level > 0; --level ) {
+      if ( ( now_ms_ & ( ( uint64_t { 1 } << ( SLOT_BITS * level ) ) - 1 ) ) == 0 ) {
+        cascade( level );
+      }
+    }
+
+    // 第 0 层当前槽里的定时器都在这一毫秒到期
+    auto& head = slots_[now_ms_ % SLOTS];
+    while ( head != NONE ) {
+      auto const index = head;
+      unlink( index );
+      fired.push_back( entries_[index].token );
+      ++entries_[index].generation;
+      free_.push_back( index );
+      --size_;
+    }
+  }
+  // 没有定时器时直接跳过剩下的时间
+  now_ms_ += ms;
+}
+
+void TimerWheel::link( uint32_t index ) noexcept
+{
+  auto& entry = entries_[index];
+  auto const delta = entry.deadline - now_ms_;
+
+  unsigned level = 0;
+  while ( level < LEVELS - 1 && delta >= ( uint64_t { 1 } << ( SLOT_BITS * ( level + 1 ) ) ) ) {
+    ++level;
+  }
+  auto const shift = SLOT_BITS * level;
+  // 超出最高层范围的定时器放在最高层最晚降级的槽里，降级时会重新计算
+  auto const bucket = delta >> ( SLOT_BITS * LEVELS ) ? now_ms_ >> shift : entry.deadline >> shift;
+
+  entry.slot = level * SLOTS + bucket % SLOTS;
+  entry.prev = NONE;
+  entry.next = slots_[entry.slot];
+  if ( entry.next != NONE ) {
+    entries_[entry.next].prev = index;
+  }
+  slots_[entry.slot] = index;
+}
+
+void TimerWheel::unlink( uint32_t index ) noexcept
+{
+  auto& entry = entries_[index];
+  if ( entry.prev != NONE ) {
+    entries_[entry.prev].next = entry.next;
+  } else {
+    slots_[entry.slot] = entry.next;
+  }
+  if ( entry.next != NONE ) {
+    entries_[entry.next].prev = entry.prev;
+  }
+  entry.slot = NONE;
+}
+
+void TimerWheel::cascade( unsigned level )
+{
+  auto& head = slots_[level * SLOTS + ( now_ms_ >> ( SLOT_BITS * level ) ) % SLOTS];
+  auto index = head;
+  head = NONE;
+  while ( index != NONE ) {
+    auto const next = entries_[index].next;
+    link( index );
+    index = next;
+  }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// A hierarchical timer wheel shared by many timers (e.g. one per TCPSender).
+//
+// Four levels of 256 slots each; a slot on level L covers 256^L milliseconds. A timer lives in
+// the slot for its deadline on the lowest level that reaches that far, and drops down a level
+// each time the wheel turns past it. advance() touches only the slots it passes and the timers
+// that are due, so idle timers cost nothing no matter how many there are. schedule() and
+// cancel() are O(1).
+//
+// A timer is identified to its owner by a Token. When it fires, advance() hands the Token back;
+// the owner decides what that means (for TCPSender: call tick( 0 )).
+class TimerWheel
+{
+public:
+  using Token = uint64_t;
+
+  // Refers to one scheduled timer. Cancelling a Handle whose timer already fired (or was
+  // cancelled) does nothing.
+  struct Handle
+  {
+    uint32_t index { UINT32_MAX };
+    uint32_t generation {};
+  };
+
+  // Fire `token` once now() >= deadline_ms (at the earliest on the next advance())
+  Handle schedule( uint64_t deadline_ms, Token token );
+  void cancel( Handle& handle ) noexcept;
+
+  // Move time forward by `ms` milliseconds and append the Tokens of every timer that came due to `fired`
+  void advance( uint64_t ms, std::vector<Token>& fired );
+
+  uint64_t now() const noexcept { return now_ms_; } // Milliseconds advanced since construction
+  uint64_t size() const noexcept { return size_; }  // Number of timers scheduled
+
+private:
+  static constexpr unsigned SLOT_BITS = 8;
+  static constexpr uint32_t SLOTS = 1 << SLOT_BITS;
+  static constexpr unsigned LEVELS = 4;
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  struct Entry
+  {
+    uint64_t deadline {};
+    Token token {};
+    uint32_t prev { NONE };
+    uint32_t next { NONE };
+    uint32_t slot { NONE }; // index into slots_, or NONE if unused
+    uint32_t generation {};
+  };
+
+  void link( uint32_t index ) noexcept;   // put entries_[index] in the slot for its deadline
+  void unlink( uint32_t index ) noexcept; // take entries_[index] out of its slot
+  void cascade( unsigned level );         // move the current slot of `level` down to lower levels
+
+  uint64_t now_ms_ {};
+  uint64_t size_ {};
+  std::vector<Entry> entries_ {};
+  std::vector<uint32_t> free_ {};
+  std::array<uint32_t, LEVELS * SLOTS> slots_ = [] {
+    std::array<uint32_t, LEVELS * SLOTS> heads {};
+    heads.fill( NONE );
+    return heads;
+  }();
+};
@@ -11,10 +11,14 @@
 class Wrap32
 {
 public:
-  explicit Wrap32( uint32_t raw_value ) : raw_value_( raw_value ) {}
+  constexpr explicit Wrap32( uint32_t raw_value ) : raw_value_( raw_value ) {}
 
   /* Construct a Wrap32 given an absolute sequence number n and the zero point. */
-  static Wrap32 wrap( uint64_t n, Wrap32 zero_point ) noexcept ;
+  static constexpr Wrap32 wrap( uint64_t n, Wrap32 zero_point ) noexcept
+  {
+    // 截断成 uint32_t 就是对 2^32 取模，加法本身也按 2^32 回绕
+    return zero_point + static_cast<uint32_t>( n );
+  }
 
   /*
    * The unwrap method returns an absolute sequence number that wraps to this Wrap32, given the zero point
@@ -23,10 +27,18 @@ public:
    * There are many possible absolute sequence numbers that all wrap to the same Wrap32.
    * The unwrap method should return the one that is closest to the checkpoint.
    */
-  uint64_t unwrap( Wrap32 zero_point, uint64_t checkpoint ) const noexcept;
+  constexpr uint64_t unwrap( Wrap32 zero_point, uint64_t checkpoint ) const noexcept
+  {
+    // right：checkpoint 往前走多少到 raw；left：往回退多少到 raw。两者都在 32 位上回绕，和为 2^32（或都为 0）
+    // 往回退要保证 checkpoint >= left，否则会越过 0
+    const uint32_t right = raw_value_ - wrap( checkpoint, zero_point ).raw_value_;
+    const uint32_t left = 0U - right;
+    return ( left < right && checkpoint >= left ) ? checkpoint - left : checkpoint + right;
+  }
+
+  constexpr Wrap32 operator+( uint32_t n ) const { return Wrap32 { raw_value_ + n }; }
+  constexpr bool operator==( const Wrap32& other ) const { return raw_value_ == other.raw_value_; }
 
-  Wrap32 operator+( uint32_t n ) const { return Wrap32 { raw_value_ + n }; }
-  bool operator==( const Wrap32& other ) const { return raw_value_ == other.raw_value_; }
 protected:
   uint32_t raw_value_ {};
 };
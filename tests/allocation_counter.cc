@@ -0,0 +1,128 @@
+#include "allocation_counter.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+namespace {
+thread_local uint64_t allocations = 0;
+
+void* counted( size_t size )
+{
+  ++allocations;
+  if ( void* p = malloc( max<size_t>( size, 1 ) ) ) { // NOLINT(*-no-malloc, *-owning-memory)
+    return p;
+  }
+  throw bad_alloc {};
+}
+
+void* counted( size_t size, align_val_t alignment )
+{
+  ++allocations;
+  void* p = nullptr;
+  const size_t align = max( static_cast<size_t>( alignment ), sizeof( void* ) );
+  if ( posix_memalign( &p, align, max<size_t>( size, 1 ) ) != 0 ) {
+    throw bad_alloc {};
+  }
+  return p;
+}
+} // namespace
+
+uint64_t AllocationCounter::total()
+{
+  return allocations;
+}
+
+// NOLINTBEGIN(*-no-malloc, *-owning-memory)
+
+void* operator new( size_t size )
+{
+  return counted( size );
+}
+
+void* operator new[]( size_t size )
+{
+  return counted( size );
+}
+
+void* operator new( size_t size, align_val_t alignment )
+{
+  return counted( size, alignment );
+}
+
+void* operator new[]( size_t size, align_val_t alignment )
+{
+  return counted( size, alignment );
+}
+
+void* operator new( size_t size, const nothrow_t& /*unused*/ ) noexcept
+{
+  try {
+    return counted( size );
+  } catch ( const bad_alloc& ) {
+    return nullptr;
+  }
+}
+
+void* operator new[]( size_t size, const nothrow_t& /*unused*/ ) noexcept
+{
+  try {
+    return counted( size );
+  } catch ( const bad_alloc& ) {
+    return nullptr;
+  }
+}
+
+void operator delete( void* p ) noexcept
+{
+  free( p );
+}
+
+void operator delete[]( void* p ) noexcept
+{
+  free( p );
+}
+
+void operator delete( void* p, size_t /*unused*/ ) noexcept
+{
+  free( p );
+}
+
+void operator delete[]( void* p, size_t /*unused*/ ) noexcept
+{
+  free( p );
+}
+
+void operator delete( void* p, align_val_t /*unused*/ ) noexcept
+{
+  free( p );
+}
+
+void operator delete[]( void* p, align_val_t /*unused*/ ) noexcept
+{
+  free( p );
+}
+
+void operator delete( void* p, size_t /*unused*/, align_val_t /*unused*/ ) noexcept
+{
+  free( p );
+}
+
+void operator delete[]( void* p, size_t /*unused*/, align_val_t /*unused*/ ) noexcept
+{
+  free( p );
+}
+
+void operator delete( void* p, const nothrow_t& /*unused*/ ) noexcept
+{
+  free( p );
+}
+
+void operator delete[]( void* p, const nothrow_t& /*unused*/ ) noexcept
+{
+  free( p );
+}
+
+// NOLINTEND(*-no-malloc, *-owning-memory)
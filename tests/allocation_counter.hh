@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+// Counts calls to the global operator new (every form) made by the calling thread, so a test can
+// check that a hot path allocates nothing once it is warm:
+//
+//   const AllocationCounter allocations;
+//   for ( ... ) { forward one packet }
+//   check( allocations.count() == 0, "forwarding allocates nothing" );
+//
+// The counting operator new lives in allocation_counter.cc, which replaces the global one in every
+// program that links the testing library (minnow_testing_*). It just counts and calls malloc().
+// Only the calling thread's allocations are counted, so work on other threads doesn't disturb it.
+class AllocationCounter
+{
+public:
+  AllocationCounter() : start_( total() ) {}
+
+  // Allocations by this thread since construction (or restart())
+  uint64_t count() const { return total() - start_; }
+  double per( uint64_t operations ) const
+  {
+    return operations ? static_cast<double>( count() ) / static_cast<double>( operations ) : 0;
+  }
+  void restart() { start_ = total(); }
+
+  // Allocations by this thread since it started
+  static uint64_t total();
+
+private:
+  uint64_t start_;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// Collects benchmark results as JSON, so runs can be compared from one release to the next.
+//
+// Each measurement is printed to stdout as soon as it is taken, one JSON object per line:
+//   {"benchmark":"byte_stream","params":{"backend":"ring","capacity":32768},"unit":"bytes",
+//    "count":4000000,"seconds":0.0031,"per_second":1.29e+09}
+// with "allocations" and "allocations_per_unit" added where the benchmark counted them,
+// and write() saves them all as one document, {"suite":"minnow","compiler":...,"results":[...]}.
+class BenchmarkResults
+{
+public:
+  using Value = std::variant<std::string, uint64_t>;
+  using Params = std::vector<std::pair<std::string, Value>>;
+
+  // `benchmark` with `params` got through `count` `unit`s (e.g. bytes, lookups) in `seconds`, making
+  // `allocations` calls to operator new if they were counted (see allocation_counter.hh)
+  void add( std::string_view benchmark,
+            const Params& params,
+            std::string_view unit,
+            uint64_t count,
+            double seconds,
+            std::optional<uint64_t> allocations = {} )
+  {
+    std::ostringstream out;
+    out << R"({"benchmark":)" << quoted_( benchmark ) << R"(,"params":{)";
+    for ( size_t i = 0; i < params.size(); ++i ) {
+      out << ( i ? "," : "" ) << quoted_( params[i].first ) << ":";
+      if ( const auto* s = std::get_if<std::string>( &params[i].second ) ) {
+        out << quoted_( *s );
+      } else {
+        out << std::get<uint64_t>( params[i].second );
+      }
+    }
+    out << R"(},"unit":)" << quoted_( unit ) << R"(,"count":)" << count << R"(,"seconds":)" << std::setprecision( 6 )
+        << seconds << R"(,"per_second":)" << static_cast<double>( count ) / seconds;
+    if ( allocations ) {
+      out << R"(,"allocations":)" << *allocations << R"(,"allocations_per_unit":)"
+          << static_cast<double>( *allocations ) / static_cast<double>( std::max<uint64_t>( count, 1 ) );
+    }
+    out << "}";
+    results_.push_back( out.str() );
+    std::cout << results_.back() << "\n";
+  }
+
+  void write( const std::string& path ) const
+  {
+    std::ofstream file { path };
+    file << R"({"suite":"minnow","compiler":)" << quoted_( __VERSION__ ) << R"(,"results":[)" << "\n";
+    for ( size_t i = 0; i < results_.size(); ++i ) {
+      file << "  " << results_[i] << ( i + 1 < results_.size() ? ",\n" : "\n" );
+    }
+    file << "]}\n";
+    if ( not file ) {
+      throw std::runtime_error( "could not write " + path );
+    }
+  }
+
+private:
+  // 参数名和值都是我们自己起的，只需要转义引号和反斜杠
+  static std::string quoted_( std::string_view s )
+  {
+    std::string out = "\"";
+    for ( const char c : s ) {
+      if ( c == '"' or c == '\\' ) {
+        out += '\\';
+      }
+      out += c;
+    }
+    return out + "\"";
+  }
+
+  std::vector<std::string> results_ {};
+};
+
+// Seconds taken by `body`
+template<typename F>
+double time_seconds( F&& body )
+{
+  const auto start = std::chrono::steady_clock::now();
+  body();
+  return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
@@ -0,0 +1,882 @@
+#include "allocation_counter.hh"
+#include "arp_message.hh"
+#include "benchmark.hh"
+#include "byte_stream.hh"
+#include "checkpoint.hh"
+#include "checksum.hh"
+#include "ipv4_datagram.hh"
+#include "lpm_table.hh"
+#include "nat_table.hh"
+#include "network_interface.hh"
+#include "packet_filter.hh"
+#include "parser.hh"
+#include "reassembler.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+#include "tcp_receiver.hh"
+#include "tcp_segment.hh"
+#include "tcp_sender.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// The benchmark suite: parameter sweeps over the ByteStream (and its bulk API), and the TCPSender
+// (sending and ACK processing), TCPReceiver (including batched receive and a flow that wraps the
+// seqnos), NetworkInterface, LPMTable, PacketFilter, NatTable, checksum and Parser hot paths, and
+// checkpointing connections to a snapshot file and restoring them. Every
+// result is printed as a line of JSON (see benchmark.hh); `benchmark_speed_test FILE` also saves
+// them all to FILE.
+
+namespace {
+BenchmarkResults results;
+
+string random_string( size_t len, unsigned seed )
+{
+  default_random_engine rd { seed };
+  uniform_int_distribution<char> ud;
+  string ret( len, 0 );
+  for ( auto& c : ret ) {
+    c = ud( rd );
+  }
+  return ret;
+}
+
+string backend_name( ByteStream::Backend backend )
+{
+  return backend == ByteStream::Backend::Ring ? "ring" : "queue";
+}
+
+// Push `data` through a ByteStream in `write_size` pieces, reading at most `read_size` at a time
+void byte_stream_benchmark( const string& data,
+                            size_t capacity,   // NOLINT(bugprone-easily-swappable-parameters)
+                            size_t write_size, // NOLINT(bugprone-easily-swappable-parameters)
+                            size_t read_size,  // NOLINT(bugprone-easily-swappable-parameters)
+                            ByteStream::Backend backend )
+{
+  ByteStream bs { capacity, backend };
+  string output;
+  output.reserve( data.size() );
+  const string_view input { data };
+  size_t written = 0;
+
+  const AllocationCounter allocations;
+  const double seconds = time_seconds( [&] {
+    while ( not bs.reader().is_finished() ) {
+      if ( written == input.size() ) {
+        bs.writer().close();
+      } else {
+        const size_t n = min( { write_size, input.size() - written, bs.writer().available_capacity() } );
+        bs.writer().push( string { input.substr( written, n ) } );
+        written += n;
+      }
+      if ( bs.reader().bytes_buffered() > 0 ) {
+        const auto peeked = bs.reader().peek().substr( 0, read_size );
+        output += peeked;
+        bs.reader().pop( peeked.size() );
+      }
+    }
+  } );
+
+  if ( output != data ) {
+    throw runtime_error( "ByteStream benchmark: data read differs from data written" );
+  }
+  results.add( "byte_stream",
+               { { "backend", backend_name( backend ) },
+                 { "capacity", capacity },
+                 { "write_size", write_size },
+                 { "read_size", read_size } },
+               "bytes",
+               data.size(),
+               seconds,
+               allocations.count() );
+}
+
+// Same, but through the bulk API: push( string_view ) from the input and read_into() a fixed buffer
+void byte_stream_bulk_benchmark( const string& data,
+                                 size_t capacity,   // NOLINT(bugprone-easily-swappable-parameters)
+                                 size_t write_size, // NOLINT(bugprone-easily-swappable-parameters)
+                                 size_t read_size,  // NOLINT(bugprone-easily-swappable-parameters)
+                                 ByteStream::Backend backend )
+{
+  ByteStream bs { capacity, backend };
+  string output( data.size(), 0 );
+  const string_view input { data };
+  size_t received = 0;
+
+  const AllocationCounter allocations;
+  const double seconds = time_seconds( [&] {
+    while ( received < output.size() ) {
+      const auto written = bs.writer().bytes_pushed();
+      bs.writer().push( input.substr( written, min( write_size, input.size() - written ) ) );
+      const auto chunk = span { output }.subspan( received, min( read_size, output.size() - received ) );
+      received += bs.reader().read_into( chunk );
+    }
+  } );
+
+  if ( output != data ) {
+    throw runtime_error( "ByteStream bulk benchmark: data read differs from data written" );
+  }
+  results.add( "byte_stream_bulk",
+               { { "backend", backend_name( backend ) },
+                 { "capacity", capacity },
+                 { "write_size", write_size },
+                 { "read_size", read_size } },
+               "bytes",
+               data.size(),
+               seconds,
+               allocations.count() );
+}
+
+// A TCPSender sending `total` bytes to a receiver that acknowledges everything as soon as it is sent
+void tcp_sender_benchmark( size_t total, size_t mss, size_t tso_segments ) // NOLINT(*-swappable-parameters)
+{
+  TCPConfig config;
+  config.mss = mss;
+  config.tso_segments = tso_segments;
+  config.fixed_isn = Wrap32 { 1 };
+  TCPSender sender { config };
+  ByteStream outbound { config.send_capacity };
+  const string chunk = random_string( 16384, 1 );
+  vector<TCPSenderMessage> segments;
+  TCPReceiverMessage ack { {}, UINT16_MAX, {} };
+  size_t written = 0;
+  uint64_t sent = 0;
+
+  const double seconds = time_seconds( [&] {
+    while ( sent < total ) {
+      while ( written < total and outbound.writer().available_capacity() >= chunk.size() ) {
+        outbound.writer().push( chunk );
+        written += chunk.size();
+      }
+      sender.push( outbound.reader() );
+      sender.maybe_send_all( segments );
+      for ( const auto& seg : segments ) {
+        sent += seg.payload.size();
+        ack.ackno = seg.seqno + static_cast<uint32_t>( seg.sequence_length() );
+      }
+      segments.clear();
+      sender.receive( ack );
+      sender.tick( 1 );
+    }
+  } );
+
+  results.add( "tcp_sender",
+               { { "mss", mss }, { "tso_segments", tso_segments } },
+               "bytes",
+               sent,
+               seconds );
+}
+
+// ACK processing with `in_flight` segments outstanding: each round fills the window, then
+// acknowledges it with one cumulative ACK every `segments_per_ack` segments. Only receive() is timed.
+void tcp_sender_ack_benchmark( size_t rounds, size_t in_flight, size_t segments_per_ack ) // NOLINT(*-swappable-parameters)
+{
+  constexpr size_t mss = 1460;
+  TCPConfig config;
+  config.mss = mss;
+  config.fixed_isn = Wrap32 { 1 };
+  config.window_scaling = true;
+  config.recv_capacity = in_flight * mss;
+  config.send_capacity = in_flight * mss;
+  TCPSender sender { config };
+  sender.set_peer_window_scale( config.window_scale() );
+  ByteStream outbound { config.send_capacity };
+  const string chunk = random_string( in_flight * mss, 2 );
+  vector<TCPSenderMessage> segments;
+  TCPReceiverMessage ack { {}, static_cast<uint16_t>( config.recv_capacity >> config.window_scale() ), {} };
+  uint64_t acked = 0;
+  double seconds = 0;
+
+  // SYN 先单独确认掉，之后每一轮正好是 in_flight 个满段
+  sender.push( outbound.reader() );
+  sender.maybe_send_all( segments );
+  ack.ackno = segments.front().seqno + 1;
+  sender.receive( ack );
+  segments.clear();
+
+  for ( size_t round = 0; round < rounds; ++round ) {
+    outbound.writer().push( chunk );
+    sender.push( outbound.reader() );
+    sender.maybe_send_all( segments );
+    if ( segments.size() != in_flight ) {
+      throw runtime_error( "tcp_sender_ack: window held " + to_string( segments.size() ) + " segments" );
+    }
+    seconds += time_seconds( [&] {
+      for ( size_t i = segments_per_ack - 1; i < segments.size(); i += segments_per_ack ) {
+        ack.ackno = segments[i].seqno + static_cast<uint32_t>( segments[i].sequence_length() );
+        sender.receive( ack );
+      }
+    } );
+    acked += segments.size();
+    segments.clear();
+    if ( sender.sequence_numbers_in_flight() != 0 ) {
+      throw runtime_error( "tcp_sender_ack: segments left in flight" );
+    }
+  }
+
+  results.add( "tcp_sender_ack",
+               { { "in_flight", in_flight }, { "segments_per_ack", segments_per_ack } },
+               "segments",
+               acked,
+               seconds );
+}
+
+// A TCPReceiver taking `total` bytes in segments of `payload_size`, each pair swapped if `reorder`
+void tcp_receiver_benchmark( size_t total, size_t payload_size, bool reorder ) // NOLINT(*-swappable-parameters)
+{
+  const Wrap32 isn { 1000 };
+  const string data = random_string( total, 2 );
+  vector<TCPSenderMessage> segments;
+  for ( size_t i = 0; i < total; i += payload_size ) {
+    const string_view piece = string_view { data }.substr( i, payload_size );
+    segments.push_back(
+      { isn + static_cast<uint32_t>( i + 1 ), false, Buffer { string { piece } }, i + piece.size() == total, {} } );
+  }
+  if ( reorder ) {
+    for ( size_t i = 0; i + 1 < segments.size(); i += 2 ) {
+      swap( segments[i], segments[i + 1] );
+    }
+  }
+
+  TCPConfig config;
+  config.recv_capacity = 1 << 20;
+  TCPReceiver receiver { config };
+  Reassembler reassembler;
+  ByteStream inbound { config.recv_capacity };
+  uint64_t received = 0;
+  uint64_t window = 0;
+
+  const AllocationCounter allocations;
+  const double seconds = time_seconds( [&] {
+    receiver.receive( { isn, true, {}, false, {} }, reassembler, inbound.writer() );
+    for ( auto& seg : segments ) {
+      receiver.receive( std::move( seg ), reassembler, inbound.writer() );
+      window += receiver.send( reassembler, inbound.writer() ).window_size;
+      const size_t buffered = inbound.reader().bytes_buffered();
+      inbound.reader().pop( buffered );
+      received += buffered;
+    }
+  } );
+
+  if ( received != total or not inbound.writer().is_closed() or window == 0 ) {
+    throw runtime_error( "TCPReceiver benchmark: not every byte arrived" );
+  }
+  results.add( "tcp_receiver",
+               { { "payload_size", payload_size }, { "order", string { reorder ? "pairs_swapped" : "in_order" } } },
+               "bytes",
+               total,
+               seconds,
+               allocations.count() );
+}
+
+// A TCPReceiver taking `total` bytes in order, `batch` segments per receive_batch() call (1: one
+// receive() each). With `split`, each batch is the pieces of one super-segment (joined without
+// copying); otherwise every segment has its own Buffer.
+// NOLINTNEXTLINE(*-swappable-parameters)
+void tcp_receiver_batch_benchmark( size_t total, size_t payload_size, size_t batch, bool split )
+{
+  const Wrap32 isn { 1000 };
+  const string data = random_string( total, 3 );
+  vector<TCPSenderMessage> segments;
+  for ( size_t i = 0; i < total; i += payload_size * batch ) {
+    const Buffer super_segment { string { string_view { data }.substr( i, payload_size * batch ) } };
+    for ( size_t j = 0; j < super_segment.size(); j += payload_size ) {
+      const auto piece = super_segment.substr( j, payload_size );
+      segments.push_back( { isn + static_cast<uint32_t>( i + j + 1 ),
+                            false,
+                            split ? piece : Buffer { string { string_view { piece } } },
+                            i + j + piece.size() == total,
+                            {} } );
+    }
+  }
+
+  TCPConfig config;
+  config.recv_capacity = 1 << 20;
+  TCPReceiver receiver { config };
+  Reassembler reassembler;
+  ByteStream inbound { config.recv_capacity };
+  uint64_t received = 0;
+  uint64_t window = 0;
+
+  const double seconds = time_seconds( [&] {
+    receiver.receive( { isn, true, {}, false, {} }, reassembler, inbound.writer() );
+    for ( size_t i = 0; i < segments.size(); i += batch ) {
+      const auto messages = span { segments }.subspan( i, min( batch, segments.size() - i ) );
+      if ( batch == 1 ) {
+        receiver.receive( std::move( messages.front() ), reassembler, inbound.writer() );
+      } else {
+        receiver.receive_batch( messages, reassembler, inbound.writer() );
+      }
+      window += receiver.send( reassembler, inbound.writer() ).window_size;
+      const size_t buffered = inbound.reader().bytes_buffered();
+      inbound.reader().pop( buffered );
+      received += buffered;
+    }
+  } );
+
+  if ( received != total or not inbound.writer().is_closed() or window == 0 ) {
+    throw runtime_error( "TCPReceiver batch benchmark: not every byte arrived" );
+  }
+  results.add( "tcp_receiver_batch",
+               { { "payload_size", payload_size },
+                 { "batch", batch },
+                 { "payloads", string { split ? "split" : "separate" } } },
+               "bytes",
+               total,
+               seconds );
+}
+
+// A TCPReceiver on a flow of `total` bytes, long enough for the seqnos to wrap several times. Every
+// segment shares one Buffer, so this measures the per-segment work rather than copying.
+void tcp_receiver_long_flow_benchmark( uint64_t total, size_t payload_size ) // NOLINT(*-swappable-parameters)
+{
+  const Wrap32 isn { UINT32_MAX - 1000 };
+  const Buffer payload { random_string( payload_size, 3 ) };
+  TCPReceiver receiver;
+  Reassembler reassembler;
+  ByteStream inbound { 1 << 20 };
+  uint64_t sent = 0;
+
+  const double seconds = time_seconds( [&] {
+    receiver.receive( { isn, true, {}, false, {} }, reassembler, inbound.writer() );
+    for ( ; sent + payload_size <= total; sent += payload_size ) {
+      receiver.receive( { Wrap32::wrap( sent + 1, isn ), false, payload, false, {} }, reassembler, inbound.writer() );
+      inbound.reader().pop( inbound.reader().bytes_buffered() );
+    }
+  } );
+
+  if ( inbound.writer().bytes_pushed() != sent
+       or receiver.send( inbound.writer() ).ackno != Wrap32::wrap( sent + 1, isn ) ) {
+    throw runtime_error( "TCPReceiver long-flow benchmark: the stream did not survive the wraparounds" );
+  }
+  results.add( "tcp_receiver_long_flow",
+               { { "payload_size", payload_size }, { "wraps", total >> 32 } },
+               "segments",
+               sent / payload_size,
+               seconds );
+}
+
+const EthernetAddress LOCAL_ETH { 0x02, 0, 0, 0, 0, 1 };
+const EthernetAddress NEIGHBOUR_ETH { 0x02, 0, 0, 0, 0, 2 };
+
+InternetDatagram datagram( size_t payload_size )
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address { "10.0.0.1" }.ipv4_numeric();
+  dgram.header.dst = Address { "10.0.0.2" }.ipv4_numeric();
+  dgram.header.len = IPv4Header::LENGTH + payload_size;
+  dgram.header.compute_checksum();
+  dgram.payload.emplace_back( random_string( payload_size, 3 ) );
+  return dgram;
+}
+
+// Datagrams to a neighbour whose Ethernet address is known, out through the interface and back in
+void network_interface_benchmark( size_t count, size_t payload_size ) // NOLINT(*-swappable-parameters)
+{
+  NetworkInterface iface { LOCAL_ETH, Address { "10.0.0.1" } };
+  ARPMessage arp;
+  arp.opcode = ARPMessage::OPCODE_REPLY;
+  arp.sender_ethernet_address = NEIGHBOUR_ETH;
+  arp.sender_ip_address = Address { "10.0.0.2" }.ipv4_numeric();
+  arp.target_ethernet_address = LOCAL_ETH;
+  arp.target_ip_address = Address { "10.0.0.1" }.ipv4_numeric();
+  iface.recv_frame( { { LOCAL_ETH, NEIGHBOUR_ETH, EthernetHeader::TYPE_ARP }, serialize( arp ) } );
+
+  const InternetDatagram dgram = datagram( payload_size );
+  const Address next_hop { "10.0.0.2" };
+  vector<EthernetFrame> frames;
+  const double send_seconds = time_seconds( [&] {
+    for ( size_t i = 0; i < count; ++i ) {
+      iface.send_datagram( dgram, next_hop );
+      if ( frames.size() >= 64 ) {
+        frames.clear();
+      }
+      iface.maybe_send_all( frames );
+    }
+  } );
+
+  const EthernetFrame frame { { LOCAL_ETH, NEIGHBOUR_ETH, EthernetHeader::TYPE_IPv4 }, serialize( dgram ) };
+  size_t delivered = 0;
+  const double recv_seconds = time_seconds( [&] {
+    for ( size_t i = 0; i < count; ++i ) {
+      delivered += iface.recv_frame( frame ).has_value();
+    }
+  } );
+
+  // 同样的帧，每批 64 个交给 recv_frames()；每帧有自己的 Buffer，和网卡收上来的一样分散
+  constexpr size_t BATCH = 64;
+  string wire;
+  for ( const auto& buffer : frame.payload ) {
+    wire.append( string_view { buffer } );
+  }
+  vector<EthernetFrame> distinct;
+  for ( size_t i = 0; i < 4096; ++i ) {
+    distinct.push_back( { frame.header, { Buffer { string { wire } } } } );
+  }
+  vector<InternetDatagram> datagrams;
+  size_t batch_delivered = 0;
+  const double batch_seconds = time_seconds( [&] {
+    for ( size_t i = 0; i < count; i += BATCH ) {
+      const auto first = i % distinct.size();
+      datagrams.clear();
+      batch_delivered += iface.recv_frames( span { distinct }.subspan( first, min( BATCH, count - i ) ), datagrams );
+    }
+  } );
+
+  if ( delivered != count or batch_delivered != count ) {
+    throw runtime_error( "NetworkInterface benchmark: a datagram was not delivered" );
+  }
+  results.add( "network_interface", { { "direction", string { "send" } }, { "payload_size", payload_size } },
+               "datagrams", count, send_seconds );
+  results.add( "network_interface", { { "direction", string { "receive" } }, { "payload_size", payload_size } },
+               "datagrams", count, recv_seconds );
+  results.add( "network_interface",
+               { { "direction", string { "receive_batch" } }, { "payload_size", payload_size } },
+               "datagrams", count, batch_seconds );
+}
+
+// Random lookups in a routing table shaped roughly like a full BGP table, cycling through
+// `distinct` addresses (few: the entries they need stay in cache; many: most lookups miss)
+void lpm_benchmark( size_t routes, size_t lookups, size_t distinct ) // NOLINT(*-swappable-parameters)
+{
+  default_random_engine rd { 4 };
+  uniform_int_distribution<uint32_t> u32;
+  uniform_int_distribution<int> length { 16, 24 };
+  LPMTable table;
+  table.insert( 0, 0, 0 );
+  for ( uint32_t i = 1; i <= routes; ++i ) {
+    table.insert( u32( rd ), static_cast<uint8_t>( length( rd ) ), i );
+  }
+  vector<uint32_t> addresses( distinct );
+  for ( auto& a : addresses ) {
+    a = u32( rd );
+  }
+
+  uint64_t sum = 0;
+  const double seconds = time_seconds( [&] {
+    for ( size_t i = 0; i < lookups; ++i ) {
+      sum += table.lookup( addresses[i % addresses.size()] );
+    }
+  } );
+
+  // 同样的地址，每次 BURST 个一起查
+  vector<uint32_t> values( LPMTable::BURST );
+  uint64_t burst_sum = 0;
+  const double burst_seconds = time_seconds( [&] {
+    for ( size_t i = 0; i < lookups; i += LPMTable::BURST ) {
+      const auto first = i % addresses.size();
+      const auto count = min( LPMTable::BURST, lookups - i );
+      table.lookup_burst( span { addresses }.subspan( first, count ), values );
+      for ( size_t j = 0; j < count; ++j ) {
+        burst_sum += values[j];
+      }
+    }
+  } );
+
+  if ( sum == 0 and routes > 0 ) {
+    throw runtime_error( "LPMTable benchmark: every lookup hit the default route" );
+  }
+  if ( burst_sum != sum ) {
+    throw runtime_error( "LPMTable benchmark: burst lookups disagree with lookup()" );
+  }
+  results.add( "lpm_lookup", { { "routes", routes }, { "addresses", distinct } }, "lookups", lookups, seconds );
+  results.add(
+    "lpm_lookup_burst", { { "routes", routes }, { "addresses", distinct } }, "lookups", lookups, burst_seconds );
+}
+
+// ACL 规则像真实的防火墙：大多是 /16-/32 的目的前缀加 TCP/UDP 端口，少数也看源前缀
+void packet_filter_benchmark( size_t rules, size_t count ) // NOLINT(*-swappable-parameters)
+{
+  default_random_engine rd { 5 };
+  uniform_int_distribution<uint32_t> u32;
+  const vector<uint8_t> lengths { 16, 24, 32 };
+  vector<PacketFilter::Rule> list;
+  for ( size_t i = 0; i < rules; ++i ) {
+    PacketFilter::Rule rule;
+    rule.dst_prefix = u32( rd );
+    rule.dst_length = lengths[u32( rd ) % lengths.size()];
+    if ( u32( rd ) % 4 == 0 ) {
+      rule.src_prefix = u32( rd );
+      rule.src_length = 24;
+    }
+    rule.protocol = u32( rd ) % 2 == 0 ? IPv4Header::PROTO_TCP : PacketFilter::PROTO_UDP;
+    rule.dst_port = static_cast<uint16_t>( u32( rd ) % 1024 );
+    list.push_back( rule );
+  }
+  PacketFilter filter { list };
+
+  // 一半的数据报命中某条规则
+  vector<PacketFilter::Fields> packets( 4096 );
+  for ( auto& f : packets ) {
+    f = { u32( rd ), u32( rd ), IPv4Header::PROTO_TCP, true, static_cast<uint16_t>( u32( rd ) ), 80 };
+    if ( u32( rd ) % 2 == 0 and not list.empty() ) {
+      const auto& rule = list[u32( rd ) % list.size()];
+      f.src = rule.src_prefix;
+      f.dst = rule.dst_prefix;
+      f.protocol = *rule.protocol;
+      f.dst_port = *rule.dst_port;
+    }
+  }
+
+  uint64_t matched = 0;
+  const double seconds = time_seconds( [&] {
+    for ( size_t i = 0; i < count; ++i ) {
+      matched += filter.match( packets[i % packets.size()] ).has_value();
+    }
+  } );
+  if ( matched == 0 and rules > 0 ) {
+    throw runtime_error( "PacketFilter benchmark: nothing matched" );
+  }
+  results.add( "packet_filter", { { "rules", rules }, { "tuples", filter.tuples() } }, "packets", count, seconds );
+}
+
+// 每个流一个 TCP 数据报，出去时翻译（大多命中已有映射），再把回复翻译回来
+void nat_benchmark( size_t flows, size_t count ) // NOLINT(*-swappable-parameters)
+{
+  NatTable::Config config;
+  config.external_ip = 0xcb007101;
+  NatTable nat { config };
+  const string payload = random_string( 1460, 6 );
+  vector<InternetDatagram> outbound( flows );
+  for ( size_t i = 0; i < flows; ++i ) {
+    auto& dgram = outbound[i];
+    dgram.header.src = 0xc0a80000 | static_cast<uint32_t>( i >> 8 );
+    dgram.header.dst = 0xc6336407;
+    dgram.header.len = IPv4Header::LENGTH + TCPSegment::LENGTH + payload.size();
+    dgram.header.compute_checksum();
+    TCPSegment seg;
+    seg.src_port = static_cast<uint16_t>( 1024 + ( i & 0xff ) );
+    seg.dst_port = 443;
+    seg.message.sender.payload = payload;
+    seg.compute_checksum( dgram.header.pseudo_checksum() );
+    dgram.payload = serialize( seg );
+  }
+
+  uint64_t translated = 0;
+  const double seconds = time_seconds( [&] {
+    for ( size_t i = 0; i < count; ++i ) {
+      auto dgram = outbound[i % flows];
+      translated += nat.translate_outbound( dgram );
+      // 对端的回复：地址和端口对调
+      swap( dgram.header.src, dgram.header.dst );
+      string& head = dgram.payload.front();
+      swap_ranges( head.begin(), head.begin() + 2, head.begin() + 2 );
+      translated += nat.translate_inbound( dgram );
+    }
+  } );
+  if ( translated != 2 * count ) {
+    throw runtime_error( "NatTable benchmark: a datagram was not translated" );
+  }
+  results.add( "nat", { { "flows", flows } }, "datagrams", 2 * count, seconds );
+}
+
+string kernel_name( InternetChecksum::Kernel kernel )
+{
+  switch ( kernel ) {
+    case InternetChecksum::Kernel::Bytes:
+      return "bytes";
+    case InternetChecksum::Kernel::Words:
+      return "words";
+    case InternetChecksum::Kernel::SSE2:
+      return "sse2";
+    case InternetChecksum::Kernel::AVX2:
+      return "avx2";
+    case InternetChecksum::Kernel::NEON:
+      return "neon";
+  }
+  return "unknown";
+}
+
+// Checksum `total` bytes in packets of `packet_size`
+void checksum_benchmark( size_t total, size_t packet_size, InternetChecksum::Kernel kernel )
+{
+  const string data = random_string( packet_size, 5 );
+  const size_t packets = total / packet_size;
+  uint64_t sum = 0;
+  const double seconds = time_seconds( [&] {
+    for ( size_t i = 0; i < packets; ++i ) {
+      InternetChecksum check;
+      check.add( data, kernel );
+      sum += check.value();
+    }
+  } );
+
+  if ( sum == 0 ) {
+    throw runtime_error( "checksum benchmark: every checksum was 0" );
+  }
+  results.add( "checksum",
+               { { "kernel", kernel_name( kernel ) }, { "packet_size", packet_size } },
+               "bytes",
+               packets * packet_size,
+               seconds );
+}
+
+// Copy a packet and checksum it: memcpy() then add() (two passes over the bytes), or copy_and_add() (one)
+void copy_checksum_benchmark( size_t total, size_t packet_size, bool fused )
+{
+  const string data = random_string( packet_size, 5 );
+  string dest( packet_size, 0 );
+  const size_t packets = total / packet_size;
+  uint64_t sum = 0;
+  const double seconds = time_seconds( [&] {
+    for ( size_t i = 0; i < packets; ++i ) {
+      InternetChecksum check;
+      if ( fused ) {
+        check.copy_and_add( dest.data(), data );
+      } else {
+        memcpy( dest.data(), data.data(), packet_size );
+        check.add( dest );
+      }
+      sum += check.value() + static_cast<uint8_t>( dest[i % packet_size] );
+    }
+  } );
+
+  if ( sum == 0 or dest != data ) {
+    throw runtime_error( "copy checksum benchmark: wrong copy" );
+  }
+  results.add( "copy_checksum",
+               { { "method", string { fused ? "copy_and_add" : "memcpy+add" } }, { "packet_size", packet_size } },
+               "bytes",
+               packets * packet_size,
+               seconds );
+}
+
+// Parse IPv4 datagrams, and the TCP segments inside them
+void parser_benchmark( size_t count, size_t payload_size ) // NOLINT(bugprone-easily-swappable-parameters)
+{
+  TCPSegment seg;
+  seg.src_port = 1234;
+  seg.dst_port = 80;
+  seg.message.sender.seqno = Wrap32 { 5000 };
+  seg.message.sender.payload = random_string( payload_size, 6 );
+  seg.message.receiver.ackno = Wrap32 { 7000 };
+  seg.message.receiver.window_size = 1000;
+
+  InternetDatagram dgram;
+  dgram.header.src = Address { "10.0.0.1" }.ipv4_numeric();
+  dgram.header.dst = Address { "10.0.0.2" }.ipv4_numeric();
+  dgram.header.len = IPv4Header::LENGTH + seg.header_length() + payload_size;
+  seg.compute_checksum( dgram.header.pseudo_checksum() );
+  dgram.header.compute_checksum();
+  dgram.payload = serialize( seg );
+  const vector<Buffer> wire = serialize( dgram );
+
+  size_t parsed = 0;
+  InternetDatagram ip;
+  const double ip_seconds = time_seconds( [&] {
+    for ( size_t i = 0; i < count; ++i ) {
+      parsed += parse( ip, wire );
+    }
+  } );
+
+  TCPSegment tcp;
+  const uint32_t pseudo = ip.header.pseudo_checksum();
+  const double tcp_seconds = time_seconds( [&] {
+    for ( size_t i = 0; i < count; ++i ) {
+      Parser parser { ip.payload };
+      tcp.parse( parser, pseudo );
+      parsed += not parser.has_error();
+    }
+  } );
+
+  if ( parsed != 2 * count ) {
+    throw runtime_error( "Parser benchmark: a datagram or segment failed to parse" );
+  }
+  results.add( "parser", { { "layer", string { "ipv4" } }, { "payload_size", payload_size } },
+               "datagrams", count, ip_seconds );
+  results.add( "parser", { { "layer", string { "tcp" } }, { "payload_size", payload_size } },
+               "segments", count, tcp_seconds );
+}
+
+// Checkpoint `connections` connections, each with `in_flight` bytes sent and not yet acknowledged, to
+// a snapshot file, then restore them all from it into new TCPPeers
+void checkpoint_benchmark( size_t connections, size_t in_flight ) // NOLINT(*-swappable-parameters)
+{
+  const TCPConfig config;
+  const string data = random_string( in_flight, 7 );
+  vector<TCPPeer> peers;
+  peers.reserve( connections );
+  vector<TCPMessage> msgs;
+  for ( size_t i = 0; i < connections; ++i ) {
+    TCPPeer client { config };
+    TCPPeer server { config };
+    client.connect();
+    for ( auto* const from : { &client, &server } ) {
+      from->maybe_send_all( msgs );
+      for ( auto& msg : msgs ) {
+        ( from == &client ? server : client ).receive( std::move( msg ) );
+      }
+      msgs.clear();
+    }
+    client.outbound_writer().push( data );
+    client.push();
+    client.maybe_send_all( msgs );
+    msgs.clear();
+    peers.push_back( std::move( client ) );
+  }
+
+  const string path = "/tmp/minnow_checkpoint_benchmark_" + to_string( ::getpid() );
+  size_t size = 0;
+  const double checkpoint_seconds = time_seconds( [&] {
+    CheckpointWriter writer { path };
+    for ( const auto& peer : peers ) {
+      Serializer record;
+      peer.checkpoint( record );
+      writer.add( record );
+    }
+    size = writer.commit();
+  } );
+
+  vector<TCPPeer> restored;
+  restored.reserve( connections );
+  const double restore_seconds = time_seconds( [&] {
+    CheckpointReader reader = CheckpointReader::open( path );
+    while ( auto record = reader.next() ) {
+      Parser in { { *record } };
+      restored.emplace_back( config ).restore( in );
+      if ( in.has_error() ) {
+        throw runtime_error( "checkpoint benchmark: a connection failed to restore" );
+      }
+    }
+  } );
+  ::unlink( path.c_str() );
+
+  if ( restored.size() != connections
+       or restored.back().sender().sequence_numbers_in_flight() != peers.back().sender().sequence_numbers_in_flight()
+       or size < connections * in_flight ) {
+    throw runtime_error( "checkpoint benchmark: wrong snapshot" );
+  }
+  results.add( "checkpoint",
+               { { "op", string { "checkpoint" } }, { "connections", connections }, { "in_flight", in_flight } },
+               "connections",
+               connections,
+               checkpoint_seconds );
+  results.add( "checkpoint",
+               { { "op", string { "restore" } }, { "connections", connections }, { "in_flight", in_flight } },
+               "connections",
+               connections,
+               restore_seconds );
+}
+
+void program_body()
+{
+  const string data = random_string( 16'000'000, 789 );
+  for ( const auto backend : { ByteStream::Backend::Queue, ByteStream::Backend::Ring } ) {
+    for ( const size_t capacity : { 4096, 65536, 1 << 20 } ) {
+      for ( const size_t write_size : { 64, 1500, 65536 } ) {
+        for ( const size_t read_size : { 128, 16384 } ) {
+          byte_stream_benchmark( data, capacity, write_size, read_size, backend );
+        }
+      }
+    }
+  }
+
+  for ( const auto backend : { ByteStream::Backend::Queue, ByteStream::Backend::Ring } ) {
+    for ( const size_t capacity : { 4096, 65536 } ) {
+      for ( const size_t write_size : { 1500, 65536 } ) {
+        byte_stream_bulk_benchmark( data, capacity, write_size, 16384, backend );
+      }
+    }
+  }
+
+  for ( const size_t mss : { 536, 1460 } ) {
+    for ( const size_t tso_segments : { 1, 16 } ) {
+      tcp_sender_benchmark( 200'000'000, mss, tso_segments );
+    }
+  }
+
+  for ( const size_t in_flight : { 64, 1024, 8192 } ) {
+    for ( const size_t segments_per_ack : { size_t { 2 }, in_flight } ) {
+      tcp_sender_ack_benchmark( 262'144 / in_flight, in_flight, segments_per_ack );
+    }
+  }
+
+  for ( const size_t payload_size : { 536, 1460, 8960 } ) {
+    tcp_receiver_benchmark( 32'000'000, payload_size, false );
+    tcp_receiver_benchmark( 32'000'000, payload_size, true );
+  }
+
+  for ( const size_t payload_size : { 536, 1460 } ) {
+    for ( const size_t batch : { 1, 16 } ) {
+      tcp_receiver_batch_benchmark( 32'000'000, payload_size, batch, false );
+      tcp_receiver_batch_benchmark( 32'000'000, payload_size, batch, true );
+    }
+  }
+
+  for ( const size_t payload_size : { 1460, 65536 } ) {
+    tcp_receiver_long_flow_benchmark( uint64_t { 3 } << 32, payload_size );
+  }
+
+  for ( const size_t payload_size : { 64, 1480 } ) {
+    network_interface_benchmark( 200'000, payload_size );
+  }
+
+  for ( const size_t routes : { 1000, 100'000 } ) {
+    for ( const size_t distinct : { 4096, 1 << 22 } ) {
+      lpm_benchmark( routes, 10'000'000, distinct );
+    }
+  }
+
+  for ( const size_t rules : { 10, 1000, 100'000 } ) {
+    packet_filter_benchmark( rules, 10'000'000 );
+  }
+
+  for ( const size_t flows : { 1000, 50'000 } ) {
+    nat_benchmark( flows, 2'000'000 );
+  }
+
+  for ( const auto kernel : { InternetChecksum::Kernel::Bytes,
+                              InternetChecksum::Kernel::Words,
+                              InternetChecksum::Kernel::SSE2,
+                              InternetChecksum::Kernel::AVX2,
+                              InternetChecksum::Kernel::NEON } ) {
+    if ( InternetChecksum::supported( kernel ) ) {
+      for ( const size_t packet_size : { 20, 64, 1500, 9000 } ) {
+        checksum_benchmark( 200'000'000, packet_size, kernel );
+      }
+    }
+  }
+  for ( const size_t packet_size : { 64, 1500, 9000 } ) {
+    for ( const bool fused : { false, true } ) {
+      copy_checksum_benchmark( 200'000'000, packet_size, fused );
+    }
+  }
+
+  for ( const size_t payload_size : { 0, 1460 } ) {
+    parser_benchmark( 500'000, payload_size );
+  }
+
+  for ( const size_t in_flight : { 0, 16384 } ) {
+    checkpoint_benchmark( 20'000, in_flight );
+  }
+}
+} // namespace
+
+int main( int argc, char* argv[] )
+{
+  try {
+    program_body();
+    const auto args = span( argv, argc );
+    if ( args.size() > 1 ) {
+      results.write( args[1] );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
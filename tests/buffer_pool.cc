@@ -0,0 +1,120 @@
+#include "buffer.hh"
+#include "byte_stream.hh"
+#include "common.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+
+#include <array>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+int main()
+{
+  try {
+    // 最后一个 Buffer 释放以后，字符串连同容量回到池里，下次同一档直接拿到它
+    {
+      string bytes = Buffer::pooled_string( 1500 );
+      check( bytes.empty() and bytes.capacity() >= 1500, "pooled string is empty with room for a frame" );
+      bytes.assign( 1500, 'x' );
+      const char* storage = bytes.data();
+      {
+        Buffer first { std::move( bytes ) };
+        Buffer copy = first; // NOLINT(*-unnecessary-copy-initialization)
+        const Buffer slice = copy.substr( 10, 5 );
+        first = Buffer {};
+        check( string_view { slice } == "xxxxx" and string_view { copy }.data() == storage,
+               "copies and slices share storage and keep it alive" );
+      }
+      const string reused = Buffer::pooled_string( 200 );
+      check( reused.empty() and reused.data() == storage, "frame-sized string reused from the pool" );
+      const string jumbo = Buffer::pooled_string( 9000 );
+      check( jumbo.capacity() >= 9000 and jumbo.data() != storage, "larger request gets a larger slab" );
+    }
+
+    // 头部大小的一档
+    {
+      string header = Buffer::pooled_string( 20 );
+      header.assign( "twenty bytes of head" );
+      const char* storage = header.data();
+      { const Buffer buffer { std::move( header ) }; }
+      check( Buffer::pooled_string( 40 ).data() == storage, "header-sized string reused" );
+    }
+
+    // 空 Buffer 不占存储，但仍然可以写
+    {
+      Buffer empty;
+      check( empty.empty() and string_view { empty }.empty(), "default Buffer is empty" );
+      static_cast<string&>( empty ) = "now full";
+      check( string_view { empty } == "now full", "default Buffer can be written" );
+
+      Buffer moved { std::move( empty ) };
+      check( string_view { moved } == "now full", "move keeps the bytes" );
+    }
+
+    // 跨线程：在一个线程建，在另一个线程释放
+    {
+      vector<Buffer> made;
+      thread maker { [&] {
+        for ( int i = 0; i < 1000; ++i ) {
+          string bytes = Buffer::pooled_string( 100 );
+          bytes.append( "buffer " ).append( to_string( i ) );
+          made.emplace_back( std::move( bytes ) );
+        }
+      } };
+      maker.join();
+      check( made.size() == 1000 and string_view { made[999] } == "buffer 999", "buffers survive their thread" );
+      made.clear();
+    }
+
+    // 从文件描述符读进池里的 Buffer，再原样交给 ByteStream
+    {
+      array<int, 2> fds {};
+      CheckSystemCall( "pipe", ::pipe( fds.data() ) );
+      FileDescriptor reader { fds[0] };
+      FileDescriptor writer { fds[1] };
+      reader.set_blocking( false );
+
+      vector<Buffer> buffers;
+      reader.read( buffers );
+      check( buffers.empty() and not reader.eof(), "nothing to read yet" );
+
+      const string sent( 12000, 'r' );
+      writer.write( sent );
+      reader.read( buffers );
+      check( buffers.size() == 2 and buffers[0].size() == Buffer::JUMBO_SLAB
+               and buffers[0].size() + buffers[1].size() == sent.size(),
+             "read split into slab-sized Buffers, sized to what was read" );
+
+      ByteStream stream { 65536 };
+      const char* first = string_view { buffers[0] }.data();
+      const char* second = string_view { buffers[1] }.data();
+      for ( auto& buffer : buffers ) {
+        stream.writer().push( std::move( buffer ) );
+      }
+      check( stream.reader().bytes_buffered() == sent.size()
+               and string_view { stream.reader().peek_buffer() }.data() == first,
+             "pushed without copying" );
+      stream.reader().pop( sent.size() );
+
+      // 池热了以后，同样大小的读拿到的是刚还回去的存储
+      writer.write( string( Buffer::JUMBO_SLAB, 'a' ) );
+      reader.read( buffers );
+      const char* reused = buffers.size() == 1 ? string_view { buffers[0] }.data() : nullptr;
+      check( reused == first or reused == second, "storage reused from the pool" );
+      writer.close();
+      reader.read( buffers );
+      check( buffers.empty() and reader.eof(), "EOF" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    for ( const auto backend : { ByteStream::Backend::Queue, ByteStream::Backend::Ring } ) {
+      {
+        ByteStreamTestHarness test { "push string_view copies only what fits", 6, backend };
+        test.execute( PushView { "abcd" } );
+        test.execute( PushView { "efghij" } );
+        test.execute( BytesPushed { 6 } );
+        test.execute( AvailableCapacity { 0 } );
+        test.execute( PushView { "klm" } );
+        test.execute( BytesPushed { 6 } );
+        test.execute( Peek { "abcdef" } );
+      }
+
+      {
+        ByteStreamTestHarness test { "read_into smaller, equal and larger spans", 10, backend };
+        test.execute( Push { "abc" } );
+        test.execute( PushView { "defg" } );
+        test.execute( Push { "hij" } );
+        test.execute( ReadInto { 0, "" } );
+        test.execute( ReadInto { 2, "ab" } );
+        test.execute( BytesPopped { 2 } );
+        test.execute( ReadInto { 6, "cdefgh" } ); // 跨过 Buffer 边界
+        test.execute( ReadInto { 5, "ij" } );
+        test.execute( BufferEmpty { true } );
+        test.execute( ReadInto { 5, "" } );
+        test.execute( BytesPopped { 10 } );
+      }
+
+      {
+        ByteStreamTestHarness test { "read_into across the ring's wrap", 5, backend };
+        test.execute( PushView { "abcde" } );
+        test.execute( ReadInto { 3, "abc" } );
+        test.execute( PushView { "fgh" } );
+        test.execute( ReadInto { 5, "defgh" } );
+        test.execute( Close {} );
+        test.execute( IsFinished { true } );
+      }
+
+      {
+        ByteStreamTestHarness test { "read() helper drains many chunks at once", 20, backend };
+        test.execute( Push { "one " } );
+        test.execute( Push { "two " } );
+        test.execute( PushView { "three " } );
+        test.execute( Push { "four" } );
+        test.execute( ReadAll { "one two three four" } );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+#include "byte_stream_test_harness.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+void count( void* calls )
+{
+  ++*static_cast<int*>( calls );
+}
+
+// 可读回调里直接把数据读走，像一个被唤醒的消费者
+struct Drain
+{
+  ByteStream* stream;
+  string out {};
+};
+
+void drain( void* context )
+{
+  auto& d = *static_cast<Drain*>( context );
+  auto& reader = d.stream->reader();
+  while ( reader.bytes_buffered() > 0 ) {
+    d.out += reader.peek();
+    reader.pop( reader.peek().size() );
+  }
+}
+
+struct DrainOnReadable : public Action<ByteStream>
+{
+  Drain& drain_;
+
+  explicit DrainOnReadable( Drain& d ) : drain_( d ) {}
+  string description() const override { return "set a readable hook that reads everything"; }
+  void execute( ByteStream& bs ) const override
+  {
+    drain_.stream = &bs;
+    bs.set_readable_hook( drain, &drain_ );
+  }
+};
+
+struct Drained : public Expectation<ByteStream>
+{
+  const Drain& drain_;
+  string output_;
+
+  Drained( const Drain& d, string output ) : drain_( d ), output_( move( output ) ) {}
+  string description() const override { return "the hook has read \"" + Printer::prettify( output_ ) + "\""; }
+  void execute( ByteStream& ) const override
+  {
+    if ( drain_.out != output_ ) {
+      throw ExpectationViolation { "Expected the hook to have read \"" + Printer::prettify( output_ )
+                                   + "\", but it read \"" + Printer::prettify( drain_.out ) + "\"" };
+    }
+  }
+};
+
+// 复制的流不带回调：往副本里写，数据留在副本里
+struct CopyHasNoHooks : public Expectation<ByteStream>
+{
+  string description() const override { return "a push into a copy of the stream runs no hook"; }
+  void execute( ByteStream& bs ) const override
+  {
+    ByteStream copy = bs;
+    copy.writer().push( "not drained" );
+    BytesBuffered { bs.reader().bytes_buffered() + 11 }.execute( copy );
+  }
+};
+
+void exchange( TCPPeer& from, TCPPeer& to, vector<TCPMessage>& msgs )
+{
+  from.maybe_send_all( msgs );
+  for ( auto& msg : msgs ) {
+    to.receive( std::move( msg ) );
+  }
+  msgs.clear();
+}
+} // namespace
+
+int main()
+{
+  try {
+    for ( const auto backend : { ByteStream::Backend::Queue, ByteStream::Backend::Ring } ) {
+      // 可读：空变成有数据、关闭、出错时各一次；之后的 push 不算
+      {
+        ByteStreamTestHarness test { "readable hook", 6, backend };
+        test.execute( ExpectHooks { Push { "ab" }, 1, 0 } );
+        test.execute( ExpectHooks { Push { "cd" }, 0, 0 } );
+        test.execute( ExpectHooks { PushView { "ef" }, 0, 0 } );
+        test.execute( Pop { 6 } );
+        test.execute( ExpectHooks { Push { "" }, 0, 0 } );
+        test.execute( ExpectHooks { PushBuffer { Buffer { string { "gh" } } }, 1, 0 } );
+        test.execute( ExpectHooks { Close {}, 1, 0 } );
+        test.execute( ExpectHooks { Close {}, 0, 0 } );
+      }
+
+      // 可写：满变成有空间时一次；扩容也算；出错时两边各一次
+      {
+        ByteStreamTestHarness test { "writable hook", 4, backend };
+        test.execute( Push { "abc" } );
+        test.execute( ExpectHooks { Pop { 1 }, 0, 0 } );
+        test.execute( Push { "defg" } );
+        test.execute( AvailableCapacity { 0 } );
+        test.execute( ExpectHooks { Pop { 1 }, 0, 1 } );
+        test.execute( ExpectHooks { Pop { 1 }, 0, 0 } );
+        test.execute( Push { "xy" } );
+        test.execute( ExpectHooks { SetCapacity { 8 }, 0, 1 } );
+        test.execute( ExpectHooks { SetCapacity { 4 }, 0, 0 } );
+        test.execute( ExpectHooks { SetError {}, 1, 1 } );
+        test.execute( ExpectHooks { SetError {}, 0, 0 } );
+      }
+
+      // 回调里可以读写流；清掉以后不再调用；复制的流不带回调
+      {
+        Drain d { nullptr };
+        ByteStreamTestHarness test { "hook reads the stream", 100, backend };
+        test.execute( DrainOnReadable { d } );
+        test.execute( Push { "hello " } );
+        test.execute( Push { "world" } );
+        test.execute( Drained { d, "hello world" } );
+        test.execute( BytesBuffered { 0 } );
+
+        test.execute( CopyHasNoHooks {} );
+        test.execute( Drained { d, "hello world" } );
+
+        test.execute( ClearReadableHook {} );
+        test.execute( Push { "left" } );
+        test.execute( BytesBuffered { 4 } );
+        test.execute( Drained { d, "hello world" } );
+      }
+    }
+
+    // TCPPeer：接收缓冲满了，应用读走以后马上通告窗口，不用等对端探测
+    {
+      TCPConfig config;
+      config.recv_capacity = 1000;
+      TCPPeer client { config };
+      TCPPeer server { config };
+      vector<TCPMessage> msgs;
+      client.connect();
+      exchange( client, server, msgs );
+      exchange( server, client, msgs );
+      exchange( client, server, msgs );
+
+      int opened = 0;
+      server.inbound_reader().set_writable_hook( count, &opened );
+      client.outbound_writer().push( string( 3000, 'x' ) );
+      client.push();
+      exchange( client, server, msgs );
+      exchange( server, client, msgs );
+      check( server.inbound_reader().bytes_buffered() == 1000, "server's window filled" );
+      check( not server.maybe_send().has_value(), "nothing to send while full" );
+
+      server.inbound_reader().pop( 500 );
+      check( opened == 1, "the hook saw the window open" );
+      server.window_opened();
+      auto const update = server.maybe_send();
+      check( update.has_value() and update->receiver.window_size == 500, "window update sent" );
+      check( not server.maybe_send().has_value(), "only one" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto const ring = ByteStream::Backend::Ring;
+
+    {
+      ByteStreamTestHarness test { "ring: overwrite", 2, ring };
+
+      test.execute( Push { "cat" } );
+      test.execute( BytesPushed { 2 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( BytesBuffered { 2 } );
+      test.execute( PeekOnce { "ca" } );
+
+      test.execute( Push { "t" } );
+      test.execute( BytesPushed { 2 } );
+      test.execute( Peek { "ca" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "ring: small pushes coalesce", 15, ring };
+
+      test.execute( Push { "a" } );
+      test.execute( Push { "bc" } );
+      test.execute( Push { "def" } );
+      test.execute( PeekOnce { "abcdef" } );
+      test.execute( Pop { 2 } );
+      test.execute( PeekOnce { "cdef" } );
+      test.execute( BytesBuffered { 4 } );
+      test.execute( AvailableCapacity { 11 } );
+    }
+
+    {
+      ByteStreamTestHarness test { "ring: wrap around", 8, ring };
+
+      test.execute( Push { "abcdef" } );
+      test.execute( Pop { 5 } );
+      test.execute( Push { "ghijklm" } );
+      test.execute( BytesBuffered { 8 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( PeekOnce { "fgh" } );
+      test.execute( Peek { "fghijklm" } );
+      test.execute( Pop { 3 } );
+      test.execute( PeekOnce { "ijklm" } );
+      test.execute( Push { "nopqr" } );
+      test.execute( BytesPushed { 16 } );
+      test.execute( Peek { "ijklmnop" } );
+      test.execute( ReadAll { "ijklmnop" } );
+      test.execute( BytesPopped { 16 } );
+    }
+
+    {
+      ByteStreamTestHarness test { "ring: close and finish", 4, ring };
+
+      test.execute( Push { "wxyz" } );
+      test.execute( Close {} );
+      test.execute( IsClosed { true } );
+      test.execute( IsFinished { false } );
+      test.execute( Pop { 3 } );
+      test.execute( PeekOnce { "z" } );
+      test.execute( Pop { 1 } );
+      test.execute( IsFinished { true } );
+      test.execute( BytesPopped { 4 } );
+    }
+
+    {
+      ByteStreamTestHarness test { "ring: resize keeps wrapped bytes in order", 6, ring };
+
+      test.execute( Push { "abcdef" } );
+      test.execute( Pop { 4 } );
+      test.execute( Push { "ghi" } );
+      test.execute( PeekOnce { "ef" } );
+      test.execute( SetCapacity { 10 } );
+      test.execute( AvailableCapacity { 5 } );
+      test.execute( PeekOnce { "efghi" } );
+      test.execute( Push { "jklmnop" } );
+      test.execute( Peek { "efghijklmn" } );
+
+      // 不会缩到已缓存的字节以下
+      test.execute( SetCapacity { 3 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( ReadAll { "efghijklmn" } );
+      test.execute( SetCapacity { 3 } );
+      test.execute( Push { "qrst" } );
+      test.execute( ReadAll { "qrs" } );
+    }
+
+    {
+      ByteStreamTestHarness test { "ring: released while idle", 4, ring };
+
+      test.execute( Push { "abc" } );
+      test.execute( ReleaseMemory {} ); // 还有缓存的字节，不释放
+      test.execute( Pop { 2 } );
+      test.execute( PeekOnce { "c" } );
+      test.execute( Pop { 1 } );
+      test.execute( ReleaseMemory {} );
+      test.execute( BufferEmpty { true } );
+      test.execute( AvailableCapacity { 4 } );
+      test.execute( Push { "defgh" } );
+      test.execute( Pop { 3 } );
+      test.execute( Push { "ij" } );
+      test.execute( ReadAll { "gij" } );
+      test.execute( ReleaseMemory {} );
+      test.execute( SetCapacity { 8 } );
+      test.execute( Push { "klmnopqrs" } );
+      test.execute( ReadAll { "klmnopqr" } );
+      test.execute( BytesPushed { 17 } );
+    }
+
+    {
+      ByteStreamTestHarness test { "ring: zero capacity", 0, ring };
+
+      test.execute( Push { "abc" } );
+      test.execute( BytesPushed { 0 } );
+      test.execute( BufferEmpty { true } );
+      test.execute( Pop { 0 } );
+      test.execute( Close {} );
+      test.execute( IsFinished { true } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
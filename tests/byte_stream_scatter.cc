@@ -0,0 +1,84 @@
+#include "byte_stream.hh"
+#include "byte_stream_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    {
+      ByteStreamTestHarness test { "peek_all on empty stream", 15 };
+      test.execute( PeekAll { {} } );
+    }
+
+    {
+      ByteStreamTestHarness test { "peek_all covers every chunk", 15 };
+      test.execute( Push { "abc" } );
+      test.execute( Push { "de" } );
+      test.execute( Push { "fghi" } );
+      test.execute( PeekAll { { "abc", "de", "fghi" } } );
+      test.execute( Pop { 2 } );
+      test.execute( PeekAll { { "c", "de", "fghi" } } );
+      test.execute( Pop { 3 } );
+      test.execute( PeekAll { { "fghi" } } );
+      test.execute( Pop { 4 } );
+      test.execute( PeekAll { {} } );
+    }
+
+    {
+      ByteStreamTestHarness test { "peek_all after truncated push", 4 };
+      test.execute( Push { "ab" } );
+      test.execute( Push { "cdef" } );
+      test.execute( PeekAll { { "ab", "cd" } } );
+    }
+
+    {
+      ByteStreamTestHarness test { "peek_all on a wrapped ring", 6, ByteStream::Backend::Ring };
+      test.execute( Push { "abcd" } );
+      test.execute( PeekAll { { "abcd" } } );
+      test.execute( Pop { 3 } );
+      test.execute( Push { "efgh" } );
+      test.execute( PeekAll { { "def", "gh" } } );
+      test.execute( Pop { 3 } );
+      test.execute( PeekAll { { "gh" } } );
+    }
+
+    {
+      const Buffer payload { "hello" };
+      ByteStreamTestHarness test { "push Buffer shares storage", 15 };
+      test.execute( PushBuffer { payload } );
+      test.execute( PushBuffer { Buffer { "world" } } );
+      test.execute( BytesBuffered { 10 } );
+      test.execute( PeekOnce { "hello" } );
+      test.execute( ReadBuffers { 7, { "hello", "wo" } }.sharing( payload ) );
+      test.execute( BytesBuffered { 3 } );
+      test.execute( ReadBuffers { 10, { "rld" } } );
+      test.execute( BufferEmpty { true } );
+    }
+
+    {
+      ByteStreamTestHarness test { "push Buffer beyond capacity", 4 };
+      test.execute( PushBuffer { Buffer { "abcdef" } } );
+      test.execute( BytesPushed { 4 } );
+      test.execute( Peek { "abcd" } );
+      test.execute( ReadBuffers { 4, { "abcd" } } );
+    }
+
+    {
+      ByteStreamTestHarness test { "push Buffer into a ring", 4, ByteStream::Backend::Ring };
+      test.execute( PushBuffer { Buffer { "abc" } } );
+      test.execute( Pop { 2 } );
+      test.execute( PushBuffer { Buffer { "defg" } } );
+      test.execute( Peek { "cdef" } );
+      test.execute( ReadBuffers { 4, { "cd", "ef" } } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
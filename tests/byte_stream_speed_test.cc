@@ -1,4 +1,5 @@
 #include "byte_stream.hh"
+#include "spsc_byte_stream.hh"
 
 #include <chrono>
 #include <cstddef>
@@ -7,6 +8,7 @@
 #include <iostream>
 #include <queue>
 #include <random>
+#include <thread>
 
 using namespace std;
 using namespace std::chrono;
@@ -15,7 +17,8 @@ void speed_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-p
                  const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
                  const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
                  const size_t write_size,  // NOLINT(bugprone-easily-swappable-parameters)
-                 const size_t read_size )  // NOLINT(bugprone-easily-swappable-parameters)
+                 const size_t read_size,   // NOLINT(bugprone-easily-swappable-parameters)
+                 const ByteStream::Backend backend )
 {
   // Generate the data to be written
   const string data = [&random_seed, &input_len] {
@@ -34,7 +37,7 @@ void speed_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-p
     split_data.emplace( data.substr( i, write_size ) );
   }
 
-  ByteStream bs { capacity };
+  ByteStream bs { capacity, backend };
   string output_data;
   output_data.reserve( data.size() );
 
@@ -75,20 +78,98 @@ void speed_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-p
   fstream debug_output;
   debug_output.open( "/dev/tty" );
 
-  cout << "ByteStream with capacity=" << capacity << ", write_size=" << write_size << ", read_size=" << read_size
-       << " reached " << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s.\n";
+  const string backend_name = backend == ByteStream::Backend::Ring ? "ring" : "queue";
 
-  debug_output << "             ByteStream throughput: " << fixed << setprecision( 2 ) << gigabits_per_second
-               << " Gbit/s\n";
+  cout << "ByteStream (" << backend_name << ") with capacity=" << capacity << ", write_size=" << write_size
+       << ", read_size=" << read_size << " reached " << fixed << setprecision( 2 ) << gigabits_per_second
+       << " Gbit/s.\n";
+
+  debug_output << "     ByteStream (" << backend_name << ") throughput: " << fixed << setprecision( 2 )
+               << gigabits_per_second << " Gbit/s\n";
 
   if ( gigabits_per_second < 0.1 ) {
     throw runtime_error( "ByteStream did not meet minimum speed of 0.1 Gbit/s." );
   }
 }
 
+// The writer runs on its own thread, so this measures cross-core throughput of the SPSC stream.
+void two_thread_speed_test( const size_t input_len,   // NOLINT(bugprone-easily-swappable-parameters)
+                            const size_t capacity,    // NOLINT(bugprone-easily-swappable-parameters)
+                            const size_t random_seed, // NOLINT(bugprone-easily-swappable-parameters)
+                            const size_t write_size,  // NOLINT(bugprone-easily-swappable-parameters)
+                            const size_t read_size )  // NOLINT(bugprone-easily-swappable-parameters)
+{
+  // Generate the data to be written
+  const string data = [&random_seed, &input_len] {
+    default_random_engine rd { random_seed };
+    uniform_int_distribution<char> ud;
+    string ret;
+    for ( size_t i = 0; i < input_len; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  SPSCByteStream bs { capacity };
+  string output_data;
+  output_data.reserve( data.size() );
+
+  const auto start_time = steady_clock::now();
+  thread writer_thread { [&] {
+    const string_view input = data;
+    size_t pushed = 0;
+    while ( pushed < input.size() ) {
+      bs.writer().push( input.substr( pushed, write_size ) );
+      if ( pushed == bs.writer().bytes_pushed() ) {
+        this_thread::yield(); // full: let the reader run if it shares our core
+      }
+      pushed = bs.writer().bytes_pushed();
+    }
+    bs.writer().close();
+  } };
+
+  while ( not bs.reader().is_finished() ) {
+    auto peeked = bs.reader().peek().substr( 0, read_size );
+    if ( peeked.empty() ) {
+      this_thread::yield(); // empty: let the writer run if it shares our core
+      continue;
+    }
+    output_data += peeked;
+    bs.reader().pop( peeked.size() );
+  }
+  writer_thread.join();
+
+  const auto stop_time = steady_clock::now();
+
+  if ( data != output_data ) {
+    throw runtime_error( "Mismatch between data written and read" );
+  }
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto bytes_per_second = static_cast<double>( input_len ) / test_duration.count();
+  auto bits_per_second = 8 * bytes_per_second;
+  auto gigabits_per_second = bits_per_second / 1e9;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "SPSCByteStream (two threads) with capacity=" << capacity << ", write_size=" << write_size
+       << ", read_size=" << read_size << " reached " << fixed << setprecision( 2 ) << gigabits_per_second
+       << " Gbit/s.\n";
+
+  debug_output << "   SPSCByteStream cross-thread throughput: " << fixed << setprecision( 2 )
+               << gigabits_per_second << " Gbit/s\n";
+
+  if ( gigabits_per_second < 0.1 ) {
+    throw runtime_error( "SPSCByteStream did not meet minimum speed of 0.1 Gbit/s." );
+  }
+}
+
 void program_body()
 {
-  speed_test( 1e7, 32768, 789, 1500, 128 );
+  speed_test( 1e7, 32768, 789, 1500, 128, ByteStream::Backend::Queue );
+  speed_test( 1e7, 32768, 789, 1500, 128, ByteStream::Backend::Ring );
+  two_thread_speed_test( 1e8, 32768, 789, 1500, 128 );
 }
 
 int main()
@@ -0,0 +1,113 @@
+#include "spsc_byte_stream_test_harness.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+
+using namespace std;
+
+void single_thread_test()
+{
+  SPSCByteStreamTestHarness test { "push, peek and pop around the ring", 8 };
+  test.execute( SPSCAvailableCapacity { 8 } );
+  test.execute( SPSCPush { "abcdef" } );
+  test.execute( SPSCPeekOnce { "abcdef" } );
+  test.execute( SPSCPop { 5 } );
+  test.execute( SPSCPush { "ghijklmnop" } ); // 只放得下 7 个字节
+  test.execute( SPSCBytesPushed { 13 } );
+  test.execute( SPSCBytesBuffered { 8 } );
+  test.execute( SPSCPeekOnce { "fgh" } ); // 到 ring 末尾为止
+  test.execute( SPSCPop { 3 } );
+  test.execute( SPSCPeekOnce { "ijklm" } );
+  test.execute( SPSCPop { 6 } ); // 比缓存的多，忽略
+  test.execute( SPSCBytesPopped { 8 } );
+  test.execute( SPSCClose {} );
+  test.execute( SPSCIsFinished { false } );
+  test.execute( SPSCPop { 5 } );
+  test.execute( SPSCIsFinished { true } );
+}
+
+// 另一个线程随机大小地 push，这个线程随机大小地 peek / pop，读到的和写的一样
+struct TransferAcrossThreads : public Expectation<SPSCStream>
+{
+  std::string data_;
+  size_t random_seed_;
+
+  TransferAcrossThreads( std::string data, size_t random_seed ) : data_( move( data ) ), random_seed_( random_seed )
+  {}
+
+  std::string description() const override
+  {
+    return "reading on this thread gives the " + to_string( data_.size() ) + " bytes written on another";
+  }
+
+  void execute( SPSCStream& bs ) const override
+  {
+    const uint64_t capacity = bs.writer().available_capacity(); // 流还是空的，就是容量
+    thread writer_thread { [&] {
+      default_random_engine rd { random_seed_ + 1 };
+      uniform_int_distribution<size_t> write_size { 0, capacity * 2 };
+      while ( bs.writer().bytes_pushed() < data_.size() ) {
+        if ( bs.writer().available_capacity() == 0 ) {
+          this_thread::yield();
+        }
+        bs.writer().push( string_view { data_ }.substr( bs.writer().bytes_pushed(), write_size( rd ) ) );
+      }
+      bs.writer().close();
+    } };
+
+    default_random_engine rd { random_seed_ + 2 };
+    string output;
+    while ( not bs.reader().is_finished() ) {
+      auto peeked = bs.reader().peek();
+      if ( peeked.empty() ) {
+        this_thread::yield();
+      }
+      peeked = peeked.substr( 0, uniform_int_distribution<size_t> { 0, peeked.size() }( rd ) );
+      output += peeked;
+      bs.reader().pop( peeked.size() );
+    }
+    writer_thread.join();
+
+    if ( output != data_ ) {
+      throw ExpectationViolation { "Expected the bytes written on the other thread, but found \""
+                                   + Printer::prettify( output ) + "\"" };
+    }
+  }
+};
+
+void two_thread_test( const size_t input_len, const size_t capacity, const size_t random_seed )
+{
+  const string data = [&] {
+    default_random_engine rd { random_seed };
+    uniform_int_distribution<char> ud;
+    string ret;
+    for ( size_t i = 0; i < input_len; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  SPSCByteStreamTestHarness test { "one writer thread, one reader thread", capacity };
+  test.execute( TransferAcrossThreads { data, random_seed } );
+  test.execute( SPSCBytesPopped { data.size() } );
+  test.execute( SPSCIsFinished { true } );
+}
+
+int main()
+{
+  try {
+    single_thread_test();
+    two_thread_test( 100000, 7, 2468 );
+    two_thread_test( 1000000, 4096, 1357 );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -6,6 +6,7 @@
 #include <concepts>
 #include <optional>
 #include <utility>
+#include <vector>
 
 static_assert( sizeof( Reader ) == sizeof( ByteStream ),
                "Please add member variables to the ByteStream base, not the ByteStream Reader." );
@@ -16,8 +17,13 @@ static_assert( sizeof( Writer ) == sizeof( ByteStream ),
 class ByteStreamTestHarness : public TestHarness<ByteStream>
 {
 public:
-  ByteStreamTestHarness( std::string test_name, uint64_t capacity )
-    : TestHarness( move( test_name ), "capacity=" + std::to_string( capacity ), ByteStream { capacity } )
+  ByteStreamTestHarness( std::string test_name,
+                         uint64_t capacity,
+                         ByteStream::Backend backend = ByteStream::Backend::Queue )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( capacity )
+                     + ( backend == ByteStream::Backend::Ring ? ", backend=ring" : "" ),
+                   ByteStream { capacity, backend } )
   {}
 
   size_t peek_size() { return object().reader().peek().size(); }
@@ -34,6 +40,30 @@ struct Push : public Action<ByteStream>
   void execute( ByteStream& bs ) const override { bs.writer().push( data_ ); }
 };
 
+struct PushBuffer : public Action<ByteStream>
+{
+  Buffer data_;
+
+  explicit PushBuffer( Buffer data ) : data_( std::move( data ) ) {}
+  std::string description() const override
+  {
+    return "push Buffer \"" + Printer::prettify( data_ ) + "\" to the stream";
+  }
+  void execute( ByteStream& bs ) const override { bs.writer().push( data_ ); }
+};
+
+struct PushView : public Action<ByteStream>
+{
+  std::string data_;
+
+  explicit PushView( std::string data ) : data_( move( data ) ) {}
+  std::string description() const override
+  {
+    return "push string_view \"" + Printer::prettify( data_ ) + "\" to the stream";
+  }
+  void execute( ByteStream& bs ) const override { bs.writer().push( std::string_view { data_ } ); }
+};
+
 struct Close : public Action<ByteStream>
 {
   std::string description() const override { return "close"; }
@@ -46,6 +76,27 @@ struct SetError : public Action<ByteStream>
   void execute( ByteStream& bs ) const override { bs.writer().set_error(); }
 };
 
+struct SetCapacity : public Action<ByteStream>
+{
+  uint64_t capacity_;
+
+  explicit SetCapacity( uint64_t capacity ) : capacity_( capacity ) {}
+  std::string description() const override { return "set_capacity( " + std::to_string( capacity_ ) + " )"; }
+  void execute( ByteStream& bs ) const override { bs.writer().set_capacity( capacity_ ); }
+};
+
+struct ReleaseMemory : public Action<ByteStream>
+{
+  std::string description() const override { return "release_memory()"; }
+  void execute( ByteStream& bs ) const override { bs.release_memory(); }
+};
+
+struct ClearReadableHook : public Action<ByteStream>
+{
+  std::string description() const override { return "clear the readable hook"; }
+  void execute( ByteStream& bs ) const override { bs.set_readable_hook( nullptr, nullptr ); }
+};
+
 struct Pop : public Action<ByteStream>
 {
   size_t len_;
@@ -107,6 +158,106 @@ struct PeekOnce : public Peek
   }
 };
 
+struct PeekAll : public Expectation<ByteStream>
+{
+  std::vector<std::string> chunks_;
+
+  explicit PeekAll( std::vector<std::string> chunks ) : chunks_( move( chunks ) ) {}
+
+  std::string description() const override
+  {
+    std::string desc = "peek_all() gives [";
+    for ( size_t i = 0; i < chunks_.size(); ++i ) {
+      desc += ( i ? ", \"" : "\"" ) + Printer::prettify( chunks_[i] ) + "\"";
+    }
+    return desc + "]";
+  }
+
+  void execute( ByteStream& bs ) const override
+  {
+    std::vector<std::string_view> views;
+    bs.reader().peek_all( views );
+    if ( views.size() != chunks_.size() ) {
+      throw ExpectationViolation { "Expected " + std::to_string( chunks_.size() ) + " views from peek_all(), but got "
+                                   + std::to_string( views.size() ) };
+    }
+    for ( size_t i = 0; i < views.size(); ++i ) {
+      if ( views[i] != chunks_[i] ) {
+        throw ExpectationViolation { "Expected view " + std::to_string( i ) + " to be \""
+                                     + Printer::prettify( chunks_[i] ) + "\", but found \""
+                                     + Printer::prettify( views[i] ) + "\"" };
+      }
+    }
+  }
+};
+
+struct ReadInto : public Expectation<ByteStream>
+{
+  size_t size_;
+  std::string output_;
+
+  ReadInto( size_t size, std::string output ) : size_( size ), output_( move( output ) ) {}
+
+  std::string description() const override
+  {
+    return "read_into() a " + std::to_string( size_ ) + "-byte span gives \"" + Printer::prettify( output_ ) + "\"";
+  }
+
+  void execute( ByteStream& bs ) const override
+  {
+    std::string got( size_, '\0' );
+    got.resize( bs.reader().read_into( got ) );
+    if ( got != output_ ) {
+      throw ExpectationViolation { "Expected \"" + Printer::prettify( output_ ) + "\" from read_into(), but got \""
+                                   + Printer::prettify( got ) + "\"" };
+    }
+  }
+};
+
+struct ReadBuffers : public Expectation<ByteStream>
+{
+  uint64_t len_;
+  std::vector<std::string> chunks_;
+  std::optional<Buffer> shared_with_ {};
+
+  ReadBuffers( uint64_t len, std::vector<std::string> chunks ) : len_( len ), chunks_( move( chunks ) ) {}
+
+  // The first Buffer read must share storage with `buffer` (i.e. no bytes were copied)
+  ReadBuffers& sharing( Buffer buffer )
+  {
+    shared_with_ = std::move( buffer );
+    return *this;
+  }
+
+  std::string description() const override
+  {
+    return "read( " + std::to_string( len_ ) + " ) into Buffers gives " + std::to_string( chunks_.size() )
+           + " chunks" + ( shared_with_.has_value() ? " without copying" : "" );
+  }
+
+  void execute( ByteStream& bs ) const override
+  {
+    std::vector<Buffer> got;
+    read( bs.reader(), len_, got );
+    if ( got.size() != chunks_.size() ) {
+      throw ExpectationViolation { "Expected " + std::to_string( chunks_.size() ) + " Buffers, but got "
+                                   + std::to_string( got.size() ) };
+    }
+    for ( size_t i = 0; i < got.size(); ++i ) {
+      if ( std::string_view { got[i] } != chunks_[i] ) {
+        throw ExpectationViolation { "Expected Buffer " + std::to_string( i ) + " to be \""
+                                     + Printer::prettify( chunks_[i] ) + "\", but found \""
+                                     + Printer::prettify( got[i] ) + "\"" };
+      }
+    }
+    if ( shared_with_.has_value()
+         and ( got.empty() or std::string_view { got.front() }.data()
+                                != std::string_view { shared_with_.value() }.data() ) ) {
+      throw ExpectationViolation { "Expected the first Buffer to share storage with the pushed Buffer" };
+    }
+  }
+};
+
 struct IsClosed : public ExpectBool<ByteStream>
 {
   using ExpectBool::ExpectBool;
@@ -189,3 +340,41 @@ struct ReadAll : public Expectation<ByteStream>
     empty_.execute( bs );
   }
 };
+
+// How many times `step` fires each readiness hook, e.g. test.execute( ExpectHooks { Pop { 1 }, 0, 1 } ).
+// Counting hooks are installed for the step and cleared after it, replacing any the test had set.
+template<class S>
+struct ExpectHooks : public Expectation<ByteStream>
+{
+  S step_;
+  unsigned readable_;
+  unsigned writable_;
+
+  ExpectHooks( S step, unsigned readable, unsigned writable )
+    : step_( std::move( step ) ), readable_( readable ), writable_( writable )
+  {}
+
+  std::string description() const override
+  {
+    return "\"" + step_.str() + "\" fires the readable hook " + std::to_string( readable_ )
+           + " times and the writable hook " + std::to_string( writable_ ) + " times";
+  }
+
+  void execute( ByteStream& bs ) const override
+  {
+    unsigned readable = 0;
+    unsigned writable = 0;
+    const ByteStream::Hook count = []( void* calls ) { ++*static_cast<unsigned*>( calls ); };
+    bs.set_readable_hook( count, &readable );
+    bs.set_writable_hook( count, &writable );
+    step_.execute( bs );
+    bs.set_readable_hook( nullptr, nullptr );
+    bs.set_writable_hook( nullptr, nullptr );
+    if ( readable != readable_ ) {
+      throw ExpectationViolation( "readable hook calls", readable_, readable );
+    }
+    if ( writable != writable_ ) {
+      throw ExpectationViolation( "writable hook calls", writable_, writable );
+    }
+  }
+};
@@ -0,0 +1,312 @@
+#include "checkpoint.hh"
+#include "common.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+#include "random.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+
+#include <cstdint>
+#include <exception>
+#include <fcntl.h>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+namespace {
+string random_string( default_random_engine& rd, size_t len )
+{
+  string ret( len, 0 );
+  for ( auto& ch : ret ) {
+    ch = static_cast<char>( rd() );
+  }
+  return ret;
+}
+
+string read_all( Reader& reader )
+{
+  string out;
+  while ( reader.bytes_buffered() ) {
+    out += reader.peek();
+    reader.pop( reader.peek().size() );
+  }
+  return out;
+}
+
+// 一次 checkpoint 加一次 restore，中间经过 Serializer 的输出（Buffer 可能是好几块）
+template<class Save, class Restore>
+bool round_trip( Save&& save, Restore&& restore )
+{
+  Serializer out;
+  save( out );
+  Parser in { out.output() };
+  restore( in );
+  return not in.has_error() and in.input().empty();
+}
+
+// 缓存的字节、计数和关闭标志都回来了；换一种后端也一样
+void byte_stream_test( ByteStream::Backend from, ByteStream::Backend to )
+{
+  ByteStream stream { 10, from };
+  stream.writer().push( "abcdefg" );
+  stream.reader().pop( 4 );
+  stream.writer().push( "hijklmn" ); // Ring 绕回开头，Queue 有两个 Buffer
+  stream.writer().close();
+
+  ByteStream restored { 1, to };
+  check( round_trip( [&]( Serializer& out ) { stream.checkpoint( out ); },
+                     [&]( Parser& in ) { restored.restore( in ); } ),
+         "ByteStream restores" );
+  check( restored.writer().capacity() == 10 and restored.writer().bytes_pushed() == 14
+           and restored.reader().bytes_popped() == 4 and restored.writer().is_closed(),
+         "ByteStream counters" );
+  check( read_all( restored.reader() ) == "efghijklmn" and restored.reader().is_finished(), "ByteStream bytes" );
+
+  ByteStream empty { 5, to };
+  check( round_trip( [&]( Serializer& out ) { ByteStream { 5, from }.checkpoint( out ); },
+                     [&]( Parser& in ) { empty.restore( in ); } )
+           and empty.reader().bytes_buffered() == 0,
+         "empty ByteStream" );
+
+  // 恢复之后 pop 一部分再 push，绕回开头（Ring 这时才分配整个容量）
+  ByteStream open { 10, from };
+  open.writer().push( "abcdefg" );
+  open.reader().pop( 4 );
+  open.writer().push( "hijklmn" );
+  ByteStream reopened { 1, to };
+  check( round_trip( [&]( Serializer& out ) { open.checkpoint( out ); },
+                     [&]( Parser& in ) { reopened.restore( in ); } ),
+         "open ByteStream restores" );
+  reopened.reader().pop( 7 );
+  reopened.writer().push( "opqrstu" );
+  check( read_all( reopened.reader() ) == "lmnopqrstu", "push after restore" );
+}
+
+// 快照里的容量只是个数字：很大也不按它分配；声称缓存的字节比记录里实际有的多，restore 失败
+void byte_stream_bad_input_test( ByteStream::Backend to )
+{
+  ByteStream huge { uint64_t { 1 } << 50, ByteStream::Backend::Queue };
+  huge.writer().push( "abc" );
+  ByteStream restored { 1, to };
+  check( round_trip( [&]( Serializer& out ) { huge.checkpoint( out ); },
+                     [&]( Parser& in ) { restored.restore( in ); } ),
+         "huge capacity restores" );
+  check( restored.writer().capacity() == uint64_t { 1 } << 50 and read_all( restored.reader() ) == "abc",
+         "huge capacity bytes" );
+
+  Serializer out;
+  out.integer( uint64_t { 1000 } );
+  out.integer( uint64_t { 1000 } );
+  out.integer( uint64_t { 0 } );
+  out.integer( uint64_t { 1000 } );
+  out.integer( uint8_t { 0 } );
+  out.buffer( Buffer { "only a few bytes" } );
+  Parser in { out.output() };
+  ByteStream short_record { 1, to };
+  short_record.restore( in );
+  check( in.has_error(), "buffered bytes missing from the record" );
+}
+
+// 暂存的乱序字节换一种引擎也能恢复，之后补上空洞照常输出
+void reassembler_test( Reassembler::Engine from, Reassembler::Engine to )
+{
+  ByteStream stream { 64 };
+  Reassembler reassembler { from };
+  reassembler.insert( 0, "abc", false, stream.writer() );
+  reassembler.insert( 5, "fgh", false, stream.writer() );
+  reassembler.insert( 10, "klm", true, stream.writer() );
+  check( reassembler.bytes_pending() == 6, "bytes pending before checkpoint" );
+
+  ByteStream restored_stream { 1 };
+  Reassembler restored { to };
+  check( round_trip(
+           [&]( Serializer& out ) {
+             stream.checkpoint( out );
+             reassembler.checkpoint( out );
+           },
+           [&]( Parser& in ) {
+             restored_stream.restore( in );
+             restored.restore( in, restored_stream.writer() );
+           } ),
+         "Reassembler restores" );
+  check( restored.bytes_pending() == 6, "bytes pending after restore" );
+  vector<pair<uint64_t, uint64_t>> ranges;
+  restored.stored_ranges( ranges, 8 );
+  check( ranges == vector<pair<uint64_t, uint64_t>> { { 5, 8 }, { 10, 13 } }, "stored ranges" );
+
+  restored.insert( 3, "de", false, restored_stream.writer() );
+  restored.insert( 8, "ij", false, restored_stream.writer() );
+  check( read_all( restored_stream.reader() ) == "abcdefghijklm" and restored_stream.writer().is_closed(),
+         "stream completes after restore" );
+}
+
+// 两端各传一段数据，有丢包；传到一半时两端都存进快照文件，换成新的 TCPPeer 从文件恢复后接着传
+struct Endpoint
+{
+  TCPPeer peer;
+  string to_send;
+  size_t written {};
+  string received {};
+
+  void pump()
+  {
+    auto& writer = peer.outbound_writer();
+    if ( written < to_send.size() ) {
+      const auto len = min<uint64_t>( writer.available_capacity(), to_send.size() - written );
+      writer.push( to_send.substr( written, len ) );
+      written += len;
+    }
+    if ( written == to_send.size() and not writer.is_closed() ) {
+      writer.close();
+    }
+    peer.push();
+    received += read_all( peer.inbound_reader() );
+  }
+};
+
+void deliver( Endpoint& from, Endpoint& to, bernoulli_distribution& lose, default_random_engine& rd )
+{
+  vector<TCPMessage> msgs;
+  from.peer.maybe_send_all( msgs );
+  for ( auto& msg : msgs ) {
+    if ( not lose( rd ) ) {
+      to.peer.receive( std::move( msg ) );
+    }
+  }
+}
+
+void restart_test( const string& name, TCPConfig config, default_random_engine& rd )
+{
+  const string path = "/tmp/minnow_checkpoint_test_" + to_string( ::getpid() );
+  Endpoint a { TCPPeer { config }, random_string( rd, 300000 ) };
+  Endpoint b { TCPPeer { config }, random_string( rd, 40000 ) };
+  bernoulli_distribution lose { 0.05 };
+  a.peer.connect();
+
+  uint64_t ms = 0;
+  bool restarted = false;
+  while ( a.peer.active() or b.peer.active() ) {
+    check( ms < 600000, name + ": connection did not finish" );
+    a.pump();
+    b.pump();
+    deliver( a, b, lose, rd );
+    deliver( b, a, lose, rd );
+    a.pump();
+    b.pump();
+    a.peer.tick( 10 );
+    b.peer.tick( 10 );
+    ms += 10;
+
+    if ( restarted or b.received.size() < 100000 or a.peer.sender().sequence_numbers_in_flight() == 0 ) {
+      continue;
+    }
+    // 重启：存下两端，旧的 TCPPeer 丢掉，新的从文件恢复
+    restarted = true;
+    const auto in_flight = a.peer.sender().sequence_numbers_in_flight();
+    const auto cwnd = a.peer.sender().congestion_window();
+    const auto srtt = a.peer.sender().smoothed_rtt_ms();
+    CheckpointWriter writer { path };
+    for ( auto* endpoint : { &a, &b } ) {
+      Serializer record;
+      endpoint->peer.checkpoint( record );
+      writer.add( record );
+    }
+    check( writer.records() == 2, name + ": two records" );
+    writer.commit();
+
+    a.peer = TCPPeer { config };
+    b.peer = TCPPeer { config };
+    CheckpointReader reader = CheckpointReader::open( path );
+    check( reader.records() == 2, name + ": snapshot holds two records" );
+    for ( auto* endpoint : { &a, &b } ) {
+      const auto record = reader.next();
+      check( record.has_value(), name + ": record" );
+      Parser in { { *record } };
+      endpoint->peer.restore( in );
+      check( not in.has_error() and in.input().empty(), name + ": restore" );
+    }
+    check( not reader.next().has_value(), name + ": no more records" );
+    ::unlink( path.c_str() );
+
+    check( a.peer.sender().sequence_numbers_in_flight() == in_flight, name + ": in flight after restore" );
+    check( a.peer.sender().congestion_window() == cwnd, name + ": cwnd after restore" );
+    check( a.peer.sender().smoothed_rtt_ms() == srtt, name + ": SRTT after restore" );
+  }
+
+  check( restarted, name + ": restarted mid-transfer" );
+  check( not a.peer.inbound_reader().has_error() and not b.peer.inbound_reader().has_error(),
+         name + ": connection failed" );
+  check( b.received == a.to_send and a.received == b.to_send, name + ": data mismatch" );
+}
+
+void bad_file_test()
+{
+  const string path = "/tmp/minnow_checkpoint_bad_" + to_string( ::getpid() );
+  CheckpointWriter writer { path };
+  Serializer record;
+  record.integer( uint64_t { 7 } );
+  writer.add( record );
+  writer.commit();
+
+  // 记录太短：restore 让 Parser 出错，不会越界
+  CheckpointReader reader = CheckpointReader::open( path );
+  Parser in { { *reader.next() } };
+  TCPPeer peer { TCPConfig {} };
+  peer.restore( in );
+  check( in.has_error(), "short record fails to restore" );
+
+  {
+    FileDescriptor fd { CheckSystemCall( "open", ::open( path.c_str(), O_WRONLY | O_TRUNC ) ) }; // NOLINT
+    fd.write( "not a checkpoint file" );
+  }
+  bool threw = false;
+  try {
+    CheckpointReader::open( path );
+  } catch ( const runtime_error& ) {
+    threw = true;
+  }
+  ::unlink( path.c_str() );
+  check( threw, "not a checkpoint file" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    for ( auto from : { ByteStream::Backend::Queue, ByteStream::Backend::Ring } ) {
+      for ( auto to : { ByteStream::Backend::Queue, ByteStream::Backend::Ring } ) {
+        byte_stream_test( from, to );
+      }
+      byte_stream_bad_input_test( from );
+    }
+    for ( auto from : { Reassembler::Engine::Intervals, Reassembler::Engine::Bitmap } ) {
+      for ( auto to : { Reassembler::Engine::Intervals, Reassembler::Engine::Bitmap } ) {
+        reassembler_test( from, to );
+      }
+    }
+
+    TCPConfig config;
+    restart_test( "plain", config, rd );
+    config.adaptive_rto = true;
+    config.fast_retransmit = true;
+    config.congestion_control = TCPConfig::CongestionAlgorithm::Reno;
+    restart_test( "Reno", config, rd );
+    config.congestion_control = TCPConfig::CongestionAlgorithm::Cubic;
+    config.window_scaling = true;
+    config.delayed_ack = true;
+    restart_test( "Cubic", config, rd );
+    bad_file_test();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,206 @@
+#include "checksum.hh"
+#include "common.hh"
+#include "ipv4_header.hh"
+#include "network_interface.hh"
+#include "random.hh"
+#include "tcp_over_ipv4.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+constexpr InternetChecksum::Kernel KERNELS[] = { InternetChecksum::Kernel::Words,
+                                                 InternetChecksum::Kernel::SSE2,
+                                                 InternetChecksum::Kernel::AVX2,
+                                                 InternetChecksum::Kernel::NEON };
+
+// copy_and_add() 拷出来的字节和求的和都要对：`pieces` 接在一起拷到一个缓冲区里
+void check_copy( const vector<string>& pieces, uint32_t seed, uint16_t expected, InternetChecksum::Kernel kernel )
+{
+  string whole;
+  for ( const auto& piece : pieces ) {
+    whole += piece;
+  }
+  string dest( whole.size() + 1, '\x5a' );
+  InternetChecksum check_sum { seed };
+  size_t offset = 0;
+  for ( const auto& piece : pieces ) {
+    check_sum.copy_and_add( dest.data() + offset, piece, kernel );
+    offset += piece.size();
+  }
+  const string name = "copy_and_add() with kernel " + to_string( static_cast<int>( kernel ) );
+  check( check_sum.value() == expected, name + " disagrees with Bytes" );
+  check( dest.substr( 0, whole.size() ) == whole and dest.back() == '\x5a', name + " copied wrong bytes" );
+}
+
+// 驱动拷贝帧时求的和（EthernetFrame::payload_sum）一路传到 TCP：和对就不再求和，不对就丢
+void fused_receive_test()
+{
+  const EthernetAddress local_eth { 0x02, 0, 0, 0, 0, 1 };
+  const Address local { "10.0.0.1", 80 };
+  const Address remote { "10.0.0.2", 5000 };
+  NetworkInterface iface { local_eth, local };
+  TCPOverIPv4 sender { remote, local };
+  const TCPOverIPv4 receiver { local, remote };
+
+  TCPMessage msg;
+  msg.sender.seqno = Wrap32 { 1234 };
+  msg.sender.payload = Buffer { string( 1001, 'p' ) };
+  msg.receiver.window_size = 1000;
+  string wire;
+  for ( const auto& buffer : serialize( sender.wrap( std::move( msg ) ) ) ) {
+    wire += string_view { buffer };
+  }
+
+  const auto receive = [&]( const string& ip_bytes, bool sum_it ) {
+    EthernetFrame frame { { local_eth, { 0x02, 0, 0, 0, 0, 2 }, EthernetHeader::TYPE_IPv4 }, {} };
+    string copy( ip_bytes.size(), 0 );
+    InternetChecksum sum;
+    sum.copy_and_add( copy.data(), ip_bytes );
+    frame.payload.emplace_back( std::move( copy ) );
+    if ( sum_it ) {
+      frame.payload_sum = static_cast<uint16_t>( ~sum.value() );
+    }
+    auto dgram = iface.recv_frame( frame );
+    check( dgram.has_value(), "datagram received" );
+    return std::move( *dgram );
+  };
+
+  auto good = receive( wire, true );
+  check( good.payload_checksum_verified, "a right sum verifies the TCP checksum" );
+  auto const seg = receiver.unwrap( good );
+  check( seg.has_value() and seg->message.sender.payload.size() == 1001, "segment parsed" );
+
+  // payload 里改一个字节：和对不上，交给 TCPSegment::parse() 再验一遍，然后丢掉
+  string corrupt = wire;
+  corrupt.back() ^= 1;
+  auto bad = receive( corrupt, true );
+  check( not bad.payload_checksum_verified and not receiver.unwrap( bad ).has_value(), "a wrong sum is caught" );
+
+  // 没有和的帧照旧在 TCP 里求和
+  auto plain = receive( wire, false );
+  check( not plain.payload_checksum_verified and receiver.unwrap( plain ).has_value(), "no sum, summed by TCP" );
+  auto plain_bad = receive( corrupt, false );
+  check( not receiver.unwrap( plain_bad ).has_value(), "no sum, caught by TCP" );
+
+  // 以太网填充：帧比数据报长，帧的和不只是数据报的和，不用它
+  auto padded = receive( wire + string( 4, '\0' ), true );
+  check( not padded.payload_checksum_verified and receiver.unwrap( padded ).has_value(), "padded frame" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    // RFC 1071 里的例子：00 01 f2 03 f4 f5 f6 f7 的和是 ddf2
+    {
+      const string data { "\x00\x01\xf2\x03\xf4\xf5\xf6\xf7", 8 };
+      for ( auto kernel : KERNELS ) {
+        if ( InternetChecksum::supported( kernel ) ) {
+          InternetChecksum check;
+          check.add( data, kernel );
+          if ( check.value() != static_cast<uint16_t>( ~0xddf2 ) ) {
+            throw runtime_error( "RFC 1071 example" );
+          }
+        }
+      }
+    }
+
+    // 每个 kernel 都要和逐字节的结果一模一样，包括奇数长度、奇数起点和多次 add
+    uniform_int_distribution<size_t> len_dist { 0, 3000 };
+    uniform_int_distribution<int> byte_dist { 0, 255 };
+    for ( int round = 0; round < 2000; ++round ) {
+      vector<string> pieces( 1 + round % 4 );
+      for ( auto& piece : pieces ) {
+        piece.resize( len_dist( rd ) );
+        for ( auto& ch : piece ) {
+          // 偶尔全是 0xff，检查溢出和 0 / 0xffff 的边界
+          ch = static_cast<char>( round % 7 == 0 ? 0xff : byte_dist( rd ) );
+        }
+      }
+      const uint32_t seed = round % 3 == 0 ? 0 : static_cast<uint32_t>( rd() );
+
+      InternetChecksum reference { seed };
+      for ( const auto& piece : pieces ) {
+        reference.add( piece, InternetChecksum::Kernel::Bytes );
+      }
+      for ( auto kernel : KERNELS ) {
+        if ( not InternetChecksum::supported( kernel ) ) {
+          continue;
+        }
+        InternetChecksum check { seed };
+        for ( const auto& piece : pieces ) {
+          check.add( piece, kernel );
+        }
+        if ( check.value() != reference.value() ) {
+          throw runtime_error( "kernel " + to_string( static_cast<int>( kernel ) ) + " disagrees with Bytes" );
+        }
+      }
+      InternetChecksum dispatched { seed };
+      for ( const auto& piece : pieces ) {
+        dispatched.add( piece );
+      }
+      if ( dispatched.value() != reference.value() ) {
+        throw runtime_error( "best_kernel() disagrees with Bytes" );
+      }
+
+      check_copy( pieces, seed, reference.value(), InternetChecksum::Kernel::Bytes );
+      check_copy( pieces, seed, reference.value(), InternetChecksum::best_kernel() );
+      for ( auto kernel : KERNELS ) {
+        if ( InternetChecksum::supported( kernel ) ) {
+          check_copy( pieces, seed, reference.value(), kernel );
+        }
+      }
+    }
+
+    // RFC 1624 增量更新：TTL 减一之后和重新计算的校验和完全一样
+    uniform_int_distribution<uint32_t> u32_dist;
+    for ( int round = 0; round < 100000; ++round ) {
+      IPv4Header header;
+      header.tos = static_cast<uint8_t>( byte_dist( rd ) );
+      header.len = static_cast<uint16_t>( u32_dist( rd ) );
+      header.id = static_cast<uint16_t>( u32_dist( rd ) );
+      header.df = round % 2 == 0;
+      header.offset = static_cast<uint16_t>( u32_dist( rd ) & 0x1fff );
+      header.ttl = static_cast<uint8_t>( 1 + byte_dist( rd ) % 255 );
+      header.proto = static_cast<uint8_t>( byte_dist( rd ) );
+      header.src = u32_dist( rd );
+      header.dst = u32_dist( rd );
+      if ( round % 5 == 0 ) {
+        // 其余字段全是 0xff，检查 0 / 0xffff 的边界
+        header.tos = 0xff;
+        header.len = header.id = 0xffff;
+        header.src = header.dst = 0xffffffff;
+      }
+      header.compute_checksum();
+
+      while ( header.ttl > 0 ) {
+        header.decrement_ttl();
+        const uint16_t incremental = header.cksum;
+        header.compute_checksum();
+        if ( incremental != header.cksum ) {
+          throw runtime_error( "decrement_ttl() disagrees with compute_checksum() for " + header.to_string() );
+        }
+        if ( round % 100 != 0 ) {
+          break;
+        }
+      }
+    }
+
+    fused_receive_test();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+#include "checksum.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+string kernel_name( InternetChecksum::Kernel kernel )
+{
+  switch ( kernel ) {
+    case InternetChecksum::Kernel::Bytes:
+      return "bytes";
+    case InternetChecksum::Kernel::Words:
+      return "words";
+    case InternetChecksum::Kernel::SSE2:
+      return "sse2";
+    case InternetChecksum::Kernel::AVX2:
+      return "avx2";
+    case InternetChecksum::Kernel::NEON:
+      return "neon";
+  }
+  return "unknown";
+}
+} // namespace
+
+// Checksum `total_len` bytes in packets of `packet_len` (e.g. 20-byte IPv4 headers, 1500-byte frames)
+void checksum_speed_test( const size_t total_len,  // NOLINT(bugprone-easily-swappable-parameters)
+                          const size_t packet_len, // NOLINT(bugprone-easily-swappable-parameters)
+                          const InternetChecksum::Kernel kernel )
+{
+  const string data = [&] {
+    default_random_engine rd { 1234 };
+    uniform_int_distribution<char> ud;
+    string ret;
+    for ( size_t i = 0; i < packet_len * 64; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  uint16_t result = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t done = 0, offset = 0; done < total_len; done += packet_len ) {
+    InternetChecksum check;
+    check.add( string_view { data }.substr( offset, packet_len ), kernel );
+    result ^= check.value();
+    offset = ( offset + packet_len ) % data.size();
+  }
+  const auto stop_time = steady_clock::now();
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto gigabits_per_second = 8 * static_cast<double>( total_len ) / test_duration.count() / 1e9;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "InternetChecksum (" << kernel_name( kernel ) << ") with packet_len=" << packet_len << " reached "
+       << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s (result " << result << ").\n";
+
+  debug_output << "   InternetChecksum (" << kernel_name( kernel ) << ", " << packet_len
+               << "-byte packets): " << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s\n";
+
+  if ( gigabits_per_second < 0.1 ) {
+    throw runtime_error( "InternetChecksum did not meet minimum speed of 0.1 Gbit/s." );
+  }
+}
+
+void program_body()
+{
+  for ( auto kernel : { InternetChecksum::Kernel::Bytes,
+                        InternetChecksum::Kernel::Words,
+                        InternetChecksum::Kernel::SSE2,
+                        InternetChecksum::Kernel::AVX2,
+                        InternetChecksum::Kernel::NEON } ) {
+    if ( InternetChecksum::supported( kernel ) ) {
+      checksum_speed_test( 200'000'000, 20, kernel );
+      checksum_speed_test( 200'000'000, 1500, kernel );
+    }
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "allocation_counter.hh"
 #include "conversions.hh"
 #include "exception.hh"
 
@@ -35,9 +36,19 @@ inline ExpectationViolation::ExpectationViolation( const std::string& property_n
                            + ", but instead it was " + boolstr( actual ) + "." }
 {}
 
+// For a test with no harness to hold its state: fails the same way an unmet expectation does
+inline void check( bool condition, const std::string& what )
+{
+  if ( not condition ) {
+    throw ExpectationViolation { what };
+  }
+}
+
 template<class T>
 struct TestStep
 {
+  using Object = T;
+
   virtual std::string str() const = 0;
   virtual void execute( T& ) const = 0;
   virtual uint8_t color() const = 0;
@@ -156,3 +167,27 @@ struct ExpectNumber : public Expectation<T>
     }
   }
 };
+
+// Runs `step` and expects it to allocate (call operator new) at most `max` times, e.g. a push to a
+// warmed-up stream: test.execute( ExpectAllocations { Push { "abc" }, 0 } )
+template<class S>
+struct ExpectAllocations : public Expectation<typename S::Object>
+{
+  S step_;
+  uint64_t max_;
+  ExpectAllocations( S step, uint64_t max ) : step_( std::move( step ) ), max_( max ) {}
+  std::string description() const override
+  {
+    return "\"" + step_.str() + "\" allocates " + ( max_ ? "at most " + to_string( max_ ) + " times" : "nothing" );
+  }
+  void execute( typename S::Object& obj ) const override
+  {
+    const AllocationCounter allocations;
+    step_.execute( obj );
+    const uint64_t count = allocations.count();
+    if ( count > max_ ) {
+      throw ExpectationViolation { "\"" + step_.str() + "\" should have allocated at most " + to_string( max_ )
+                                   + " times, but it allocated " + to_string( count ) + " times." };
+    }
+  }
+};
@@ -0,0 +1,119 @@
+#include "common.hh"
+#include "connection_table.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+uint64_t pack( const FourTuple& key )
+{
+  return static_cast<uint64_t>( key.remote_ip ) << 32 | static_cast<uint64_t>( key.remote_port ) << 16
+         | key.local_port;
+}
+
+// 随机插入、删除、查找，和 unordered_map 对比；本地地址固定，远端地址和端口随机（服务器的情形）
+void compare_with_unordered_map( uint32_t key_range, size_t operations, unsigned seed )
+{
+  ConnectionTable<uint64_t> table;
+  unordered_map<uint64_t, uint64_t> reference;
+  default_random_engine rd { seed };
+  uniform_int_distribution<uint32_t> key_dist { 0, key_range - 1 };
+  uniform_int_distribution<int> op_dist { 0, 2 };
+
+  for ( size_t i = 0; i < operations; ++i ) {
+    auto const k = key_dist( rd );
+    const FourTuple key { 0x0a000001, 0xc0a80000 + ( k >> 4 ), 443, static_cast<uint16_t>( 40000 + ( k & 15 ) ) };
+    switch ( op_dist( rd ) ) {
+      case 0:
+        table.find_or_insert( key ) = i;
+        reference[pack( key )] = i;
+        break;
+      case 1:
+        table.erase( key );
+        reference.erase( pack( key ) );
+        break;
+      default: {
+        auto const* value = table.find( key );
+        auto const it = reference.find( pack( key ) );
+        check( ( value != nullptr ) == ( it != reference.end() ), "presence of key " + to_string( k ) );
+        check( value == nullptr or *value == it->second, "value of key " + to_string( k ) );
+      }
+    }
+    check( table.size() == reference.size(), "size after operation " + to_string( i ) );
+  }
+
+  size_t visited = 0;
+  table.for_each( [&]( const FourTuple& key, uint64_t value ) {
+    auto const it = reference.find( pack( key ) );
+    check( it != reference.end() and it->second == value, "for_each visits only live connections" );
+    ++visited;
+  } );
+  check( visited == reference.size(), "for_each visits every connection" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    {
+      ConnectionTable<int> table;
+      const FourTuple a { 1, 2, 80, 1000 };
+      const FourTuple b { 1, 2, 1000, 80 }; // 端口对调是另一条连接
+      check( table.empty() and table.find( a ) == nullptr, "new table is empty" );
+      table.find_or_insert( a ) = 7;
+      check( table.find_or_insert( a ) == 7 and table.size() == 1, "find_or_insert finds an existing key" );
+      check( table.find( b ) == nullptr, "swapped ports are a different connection" );
+      table.erase( b );
+      check( table.size() == 1, "erasing a missing key does nothing" );
+      table.erase( a );
+      check( table.empty() and table.find( a ) == nullptr, "erase removes the key" );
+    }
+
+    {
+      // Toeplitz 哈希：RSS 规范里的 IPv4/TCP 验证用例
+      const FourTuple verify { 0xa18e6450, 0x420995bb, 1766, 2794 }; // 161.142.100.80:1766 <- 66.9.149.187:2794
+      check( verify.rss_hash() == 0x51ccc178, "RSS hash of the first verification vector" );
+      const FourTuple verify2 { 0x41458c53, 0xc75c6f02, 4739, 14230 }; // 65.69.140.83:4739 <- 199.92.111.2:14230
+      check( verify2.rss_hash() == 0xc626b0ea, "RSS hash of the second verification vector" );
+    }
+
+    {
+      ConnectionTable<int> table { 2 };
+      check( table.push_syn( { 1, 2, 80, 1000 }, {} ) and table.push_syn( { 1, 3, 80, 1000 }, {} ),
+             "SYNs queue up to the backlog limit" );
+      check( not table.push_syn( { 1, 4, 80, 1000 }, {} ) and table.syns_dropped() == 1,
+             "a SYN beyond the limit is dropped" );
+      check( table.backlog() == 2 and table.pop_syn()->first.remote_ip == 2, "the backlog is FIFO" );
+      check( table.pop_syn()->first.remote_ip == 3 and not table.pop_syn().has_value(), "the backlog drains" );
+    }
+
+    {
+      ShardedConnectionTable<int> sharded { 4 };
+      size_t counts[4] {};
+      for ( uint32_t i = 0; i < 4000; ++i ) {
+        const FourTuple key { 0x0a000001, 0xc0a80000 + i, 443, static_cast<uint16_t>( 32768 + i ) };
+        auto const shard = sharded.shard_of( key );
+        check( shard < 4 and shard == sharded.shard_of_hash( key.rss_hash() ), "shard follows the RSS hash" );
+        sharded.shard_for( key ).find_or_insert( key ) = static_cast<int>( i );
+        ++counts[shard];
+      }
+      for ( size_t i = 0; i < 4; ++i ) {
+        check( counts[i] > 500 and sharded.shard( i ).size() == counts[i], "connections spread over shards" );
+      }
+    }
+
+    compare_with_unordered_map( 64, 100000, 1 );     // 小表，反复增删
+    compare_with_unordered_map( 100000, 300000, 2 ); // 大表，多次扩容
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
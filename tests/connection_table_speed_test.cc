@@ -0,0 +1,110 @@
+#include "connection_table.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+struct TupleHash
+{
+  size_t operator()( const FourTuple& key ) const { return key.hash(); }
+};
+
+void connection_table_speed_test( const size_t num_connections, const size_t num_lookups )
+{
+  // 一台服务器：本地 443，远端地址和端口随机
+  default_random_engine rd { 31415 };
+  uniform_int_distribution<uint32_t> u32_dist;
+  vector<FourTuple> keys;
+  keys.reserve( num_connections );
+  for ( size_t i = 0; i < num_connections; ++i ) {
+    keys.push_back( { 0x0a000001, u32_dist( rd ), 443, static_cast<uint16_t>( u32_dist( rd ) ) } );
+  }
+
+  ConnectionTable<uint64_t> table;
+  const auto build_start = steady_clock::now();
+  for ( size_t i = 0; i < keys.size(); ++i ) {
+    table.find_or_insert( keys[i] ) = i;
+  }
+  const auto build_stop = steady_clock::now();
+
+  // 按随机顺序查，模拟许多连接的段交错到达
+  vector<uint32_t> order( num_lookups % keys.size() + ( 1 << 20 ) );
+  for ( auto& index : order ) {
+    index = u32_dist( rd ) % keys.size();
+  }
+
+  uint64_t checksum = 0;
+  const auto lookup_start = steady_clock::now();
+  for ( size_t i = 0; i < num_lookups; ++i ) {
+    checksum += *table.find( keys[order[i % order.size()]] );
+  }
+  const auto lookup_stop = steady_clock::now();
+
+  unordered_map<FourTuple, uint64_t, TupleHash> reference;
+  reference.reserve( keys.size() );
+  for ( size_t i = 0; i < keys.size(); ++i ) {
+    reference[keys[i]] = i;
+  }
+  uint64_t reference_checksum = 0;
+  const auto reference_start = steady_clock::now();
+  for ( size_t i = 0; i < num_lookups; ++i ) {
+    reference_checksum += reference.find( keys[order[i % order.size()]] )->second;
+  }
+  const auto reference_stop = steady_clock::now();
+
+  if ( checksum != reference_checksum || table.size() != reference.size() ) {
+    throw runtime_error( "ConnectionTable disagrees with unordered_map" );
+  }
+
+  const auto build_ms = duration_cast<duration<double, milli>>( build_stop - build_start ).count();
+  const auto mlps = static_cast<double>( num_lookups )
+                    / duration_cast<duration<double>>( lookup_stop - lookup_start ).count() / 1e6;
+  const auto reference_mlps = static_cast<double>( num_lookups )
+                              / duration_cast<duration<double>>( reference_stop - reference_start ).count()
+                              / 1e6;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "ConnectionTable with " << table.size() << " connections: built in " << fixed << setprecision( 1 )
+       << build_ms << " ms, " << setprecision( 2 ) << mlps << " M lookups/s (unordered_map: " << reference_mlps
+       << " M lookups/s).\n";
+
+  debug_output << "   ConnectionTable (" << table.size() << " connections): " << fixed << setprecision( 2 )
+               << mlps << " M lookups/s, unordered_map " << reference_mlps << " M lookups/s\n";
+
+  if ( mlps < 1 ) {
+    throw runtime_error( "ConnectionTable did not meet minimum speed of 1 M lookups/s." );
+  }
+}
+} // namespace
+
+void program_body()
+{
+  connection_table_speed_test( 1000, 20000000 );
+  connection_table_speed_test( 2000000, 20000000 );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
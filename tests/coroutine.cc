@@ -0,0 +1,241 @@
+#include "async_socket.hh"
+#include "byte_stream.hh"
+#include "common.hh"
+#include "event_loop.hh"
+#include "exception.hh"
+#include "task.hh"
+
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <utility>
+
+using namespace std;
+
+namespace {
+// Two connected, non-blocking ends of a Unix stream socket
+pair<FileDescriptor, FileDescriptor> socket_pair()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds.data() ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+// 一个字节一个字节地写，容量小，所以写的一方经常要等
+Task produce( Writer& writer, string data, size_t& waits )
+{
+  for ( char c : data ) {
+    if ( writer.available_capacity() == 0 ) {
+      ++waits;
+    }
+    const bool room = co_await writer.writable();
+    if ( not room ) {
+      co_return;
+    }
+    writer.push( string( 1, c ) );
+  }
+  writer.close();
+}
+
+Task consume( Reader& reader, string& out )
+{
+  while ( true ) {
+    const bool more = co_await reader.readable();
+    if ( not more ) {
+      break;
+    }
+    out += reader.peek();
+    reader.pop( reader.peek().size() );
+  }
+}
+
+Task wait_for_room( Writer& writer, uint64_t n, bool& result )
+{
+  result = co_await writer.writable( n );
+}
+
+Task fail()
+{
+  co_await std::suspend_never {};
+  throw runtime_error( "failed" );
+}
+
+Task call_fail( bool& caught )
+{
+  try {
+    co_await fail();
+  } catch ( const runtime_error& ) {
+    caught = true;
+  }
+}
+
+Task add( int& total, int n )
+{
+  total += n;
+  co_return;
+}
+
+Task echo( AsyncSocket& socket, size_t& bytes )
+{
+  string buffer;
+  while ( true ) {
+    co_await socket.read( buffer );
+    if ( buffer.empty() ) {
+      break;
+    }
+    bytes += co_await socket.write( buffer );
+  }
+  CheckSystemCall( "shutdown", ::shutdown( socket.fd().fd_num(), SHUT_WR ) );
+}
+
+Task send( AsyncSocket& socket, const string& data )
+{
+  co_await socket.write( data );
+  CheckSystemCall( "shutdown", ::shutdown( socket.fd().fd_num(), SHUT_WR ) );
+}
+
+Task receive( AsyncSocket& socket, string& received )
+{
+  string buffer;
+  while ( true ) {
+    co_await socket.read( buffer );
+    if ( buffer.empty() ) {
+      break;
+    }
+    received += buffer;
+  }
+}
+
+void test_sockets( EventLoop::Backend backend )
+{
+  // 一端发一大块再关掉写，另一端原样发回来；同一个套接字一个协程写、一个协程读
+  EventLoop loop { backend };
+  auto [a, b] = socket_pair();
+  AsyncSocket client { loop, std::move( a ) };
+  AsyncSocket server { loop, std::move( b ) };
+
+  string data;
+  for ( size_t i = 0; data.size() < 1'000'000; ++i ) {
+    data += to_string( i ) + ",";
+  }
+  size_t echoed = 0;
+  string received;
+  Task serving = echo( server, echoed );
+  Task sending = send( client, data );
+  Task receiving = receive( client, received );
+  serving.start();
+  sending.start();
+  receiving.start();
+  for ( int i = 0; i < 100'000 and not( serving.done() and sending.done() and receiving.done() ); ++i ) {
+    loop.wait_next_event( 1000 );
+  }
+  serving.result();
+  sending.result();
+  receiving.result();
+  check( serving.done() and sending.done() and receiving.done(), "all finished" );
+  check( echoed == data.size() and received == data, "echoed intact" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    // 容量 3 的流：写的一方等空间、读的一方等数据，交替着把所有字节送过去
+    {
+      ByteStream stream { 3 };
+      const string data = "the quick brown fox jumps over the lazy dog";
+      size_t waits = 0;
+      string out;
+      Task reading = consume( stream.reader(), out );
+      Task writing = produce( stream.writer(), data, waits );
+      reading.start();
+      writing.start();
+      check( not reading.done() and not writing.done(), "both waiting" );
+      while ( Task::run_ready() > 0 ) {}
+      check( reading.done() and writing.done(), "both finished" );
+      check( out == data, "all bytes arrived" );
+      check( waits > 0, "the writer had to wait" );
+    }
+
+    // writable( n )：空出 n 字节才醒；出错时醒来得到 false
+    {
+      ByteStream stream { 4 };
+      stream.writer().push( "abcd" );
+      bool result = false;
+      Task waiting = wait_for_room( stream.writer(), 3, result );
+      waiting.start();
+      stream.reader().pop( 2 );
+      check( not Task::ready(), "two bytes are not enough" );
+      stream.reader().pop( 1 );
+      check( Task::ready(), "three bytes are" );
+      Task::run_ready();
+      check( waiting.done() and result, "woken with room" );
+
+      waiting = wait_for_room( stream.writer(), 100, result );
+      waiting.start();
+      check( not waiting.done(), "more than the capacity waits for an empty stream" );
+      stream.writer().set_error();
+      Task::run_ready();
+      check( waiting.done() and not result, "woken by the error" );
+    }
+
+    // 等待中的协程被销毁：流不会再去唤醒它
+    {
+      ByteStream stream { 4 };
+      string out;
+      {
+        Task reading = consume( stream.reader(), out );
+        reading.start();
+      }
+      stream.writer().push( "data" );
+      check( not Task::ready(), "nobody to wake" );
+    }
+
+    // co_await 一个 Task：跑完再回来，异常传给等它的协程
+    {
+      bool caught = false;
+      Task calling = call_fail( caught );
+      calling.start();
+      check( calling.done() and caught, "exception passed to the awaiting coroutine" );
+      Task failing = fail();
+      failing.start();
+      bool thrown = false;
+      try {
+        failing.result();
+      } catch ( const runtime_error& ) {
+        thrown = true;
+      }
+      check( thrown, "result() rethrows" );
+    }
+
+    // 协程帧从池里来：热了以后再开多少 Task 都不用堆
+    {
+      int total = 0;
+      for ( int i = 0; i < 10; ++i ) {
+        Task t = add( total, i );
+        t.start();
+      }
+      auto const heap = Task::heap_frames();
+      for ( int i = 0; i < 10'000; ++i ) {
+        Task t = add( total, 1 );
+        t.start();
+      }
+      check( total == 45 + 10'000, "all ran" );
+      check( Task::heap_frames() == heap, "no frame from the heap once warm" );
+    }
+
+    test_sockets( EventLoop::Backend::Epoll );
+    if ( EventLoop::supported( EventLoop::Backend::IoUring ) ) {
+      test_sockets( EventLoop::Backend::IoUring );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
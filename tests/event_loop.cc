@@ -0,0 +1,201 @@
+#include "common.hh"
+#include "event_loop.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+// Two connected, non-blocking ends of a Unix stream socket
+pair<FileDescriptor, FileDescriptor> socket_pair()
+{
+  array<int, 2> fds {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds.data() ) );
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+// Read everything `fd` has right now
+string drain( FileDescriptor& fd )
+{
+  string all;
+  string buffer;
+  do {
+    fd.read( buffer );
+    all += buffer;
+  } while ( not buffer.empty() );
+  return all;
+}
+void test( EventLoop::Backend backend )
+{
+  // 边沿触发：每次变得可读只回调一次，回调要读到读不出来
+  {
+    EventLoop loop { backend };
+    check( loop.backend() == backend, "backend" );
+    auto [a, b] = socket_pair();
+    size_t calls = 0;
+    string got;
+    loop.add( b, [&] {
+      ++calls;
+      got += drain( b );
+    } );
+    check( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout, "nothing to read yet" );
+    a.write( "hello" );
+    check( loop.wait_next_event( 100 ) == EventLoop::Result::Success, "readable" );
+    check( calls == 1 and got == "hello", "read once" );
+    check( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout, "no new edge" );
+    a.write( " world" );
+    loop.wait_next_event( 100 );
+    check( calls == 2 and got == "hello world", "new data, new edge" );
+  }
+
+  // 水平触发：没读完就一直回调
+  {
+    EventLoop loop { backend };
+    auto [a, b] = socket_pair();
+    size_t calls = 0;
+    loop.add( b, [&] { ++calls; }, {}, false );
+    a.write( "x" );
+    loop.wait_next_event( 100 );
+    loop.wait_next_event( 100 );
+    check( calls == 2, "level-triggered keeps reporting" );
+  }
+
+  // 可写：只在有东西要写的时候关心
+  {
+    EventLoop loop { backend };
+    auto [a, b] = socket_pair();
+    size_t writable = 0;
+    const auto id = loop.add( a, [] {}, [&] { ++writable; }, false );
+    loop.set_interest( id, true, false );
+    check( loop.wait_next_event( 0 ) == EventLoop::Result::Timeout, "not asking for writable" );
+    loop.set_interest( id, true, true );
+    loop.wait_next_event( 100 );
+    check( writable == 1, "writable" );
+  }
+
+  // 对端关闭：可读回调里看到 EOF，把自己删掉
+  {
+    EventLoop loop { backend };
+    auto [a, b] = socket_pair();
+    EventLoop::Id id {};
+    bool saw_eof = false;
+    id = loop.add( b, [&] {
+      drain( b );
+      if ( b.eof() ) {
+        saw_eof = true;
+        loop.remove( id );
+      }
+    } );
+    a.close();
+    loop.run();
+    check( saw_eof and loop.size() == 0, "EOF seen, and run() returned once nothing was left" );
+  }
+
+  // 定时器：按间隔重复，告诉回调过了多久；可以在回调里取消自己
+  {
+    EventLoop loop { backend };
+    size_t runs = 0;
+    uint64_t elapsed = 0;
+    EventLoop::Id timer {};
+    timer = loop.add_timer( 5, [&]( uint64_t ms ) {
+      ++runs;
+      elapsed += ms;
+      if ( runs == 3 ) {
+        loop.cancel_timer( timer );
+      }
+    } );
+    loop.run();
+    check( runs == 3 and elapsed >= 15 and loop.timers() == 0, "timer ran three times" );
+  }
+
+  // 一个线程管很多连接
+  {
+    EventLoop loop { backend };
+    constexpr size_t PAIRS = 200;
+    vector<pair<FileDescriptor, FileDescriptor>> pairs;
+    pairs.reserve( PAIRS ); // 回调里拿着指针
+    size_t bytes = 0;
+    for ( size_t i = 0; i < PAIRS; ++i ) {
+      pairs.push_back( socket_pair() );
+      auto* reader = &pairs.back().second;
+      loop.add( *reader, [&bytes, reader] { bytes += drain( *reader ).size(); } );
+    }
+    for ( auto& [writer, reader] : pairs ) {
+      writer.write( "0123456789" );
+    }
+    while ( bytes < PAIRS * 10 and loop.wait_next_event( 100 ) == EventLoop::Result::Success ) {}
+    check( bytes == PAIRS * 10, "every connection served" );
+    check( loop.size() == PAIRS, "all still registered" );
+
+    // stop() 让 run() 返回
+    loop.add_timer( 1, [&]( uint64_t ) { loop.stop(); } );
+    loop.run();
+  }
+
+  // 数据直接交给回调：epoll 时循环自己读，io_uring 时内核读进缓冲区组里的一块
+  {
+    EventLoop loop { backend };
+    auto [a, b] = socket_pair();
+    string got;
+    bool eof = false;
+    loop.add_reader( b, [&]( string_view data ) {
+      got += data;
+      eof = data.empty();
+    } );
+    a.write( "first" );
+    loop.wait_next_event( 100 );
+    check( got == "first", "reader got the data" );
+    const string big( 100000, 'z' );
+    size_t written = 0;
+    while ( written < big.size() ) {
+      written += a.write( string_view { big }.substr( written ) );
+      loop.wait_next_event( 0 );
+    }
+    a.close();
+    loop.run();
+    check( got == "first" + big and eof, "reader got everything, then EOF" );
+    check( loop.size() == 0, "reader removed at EOF" );
+  }
+
+  // 删掉一个还在读的 reader
+  {
+    EventLoop loop { backend };
+    auto [a, b] = socket_pair();
+    const auto id = loop.add_reader( b, []( string_view ) { throw runtime_error( "removed reader ran" ); } );
+    loop.wait_next_event( 0 );
+    loop.remove( id );
+    a.write( "late" );
+    loop.add_timer( 20, [&]( uint64_t ) { loop.stop(); } );
+    loop.run();
+    check( loop.size() == 0, "nothing left" );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    test( EventLoop::Backend::Epoll );
+    if ( EventLoop::supported( EventLoop::Backend::IoUring ) ) {
+      test( EventLoop::Backend::IoUring );
+    } else {
+      cerr << "io_uring not supported here, only testing epoll\n";
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
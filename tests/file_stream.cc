@@ -0,0 +1,145 @@
+#include "byte_stream.hh"
+#include "common.hh"
+#include "exception.hh"
+#include "file_stream.hh"
+#include "mapped_file.hh"
+#include "tcp_config.hh"
+#include "tcp_sender.hh"
+
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <fcntl.h>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+namespace {
+string pattern( size_t size )
+{
+  string out;
+  for ( size_t i = 0; out.size() < size; ++i ) {
+    out += to_string( i ) + ",";
+  }
+  out.resize( size );
+  return out;
+}
+
+FileDescriptor file_with( const string& data )
+{
+  FileDescriptor file { CheckSystemCall( "memfd_create", ::memfd_create( "file_stream_test", 0 ) ) };
+  file.write( data );
+  return file;
+}
+
+// `view` 在映射里面吗？
+bool within( string_view view, const MappedFile& file )
+{
+  const string_view whole = file.buffer();
+  return view.empty() or ( view.data() >= whole.data() and view.data() + view.size() <= whole.data() + whole.size() );
+}
+} // namespace
+
+int main()
+{
+  try {
+    const string data = pattern( 300000 );
+
+    // 映射的内容和文件一样；Buffer 修改时复制，不碰映射
+    {
+      const MappedFile file { file_with( data ) };
+      check( file.size() == data.size() and string_view { file.buffer() } == data, "mapped contents" );
+      check( string_view { file.substr( 10, 5 ) } == data.substr( 10, 5 ), "slice" );
+      Buffer copy = file.substr( 0, 3 );
+      static_cast<string&>( copy ) += "!";
+      check( string_view { copy } == data.substr( 0, 3 ) + "!", "modified copy" );
+      check( string_view { file.buffer() }.substr( 0, 4 ) == data.substr( 0, 4 ), "mapping untouched" );
+      check( MappedFile { file_with( "" ) }.empty(), "empty file" );
+    }
+
+    // FileSource：一段段推进流，peek() 直接指向映射；推完关闭
+    {
+      const MappedFile file { file_with( data ) };
+      FileSource source { file };
+      ByteStream stream { 64 * 1024 };
+      string out;
+      bool all_within = true;
+      size_t pumps = 0;
+      while ( not stream.reader().is_finished() ) {
+        source.pump( stream.writer() );
+        ++pumps;
+        while ( stream.reader().bytes_buffered() > 0 ) {
+          auto const view = stream.reader().peek();
+          all_within = all_within and within( view, file );
+          out += view;
+          stream.reader().pop( view.size() );
+        }
+      }
+      check( out == data, "all bytes, in order" );
+      check( all_within, "peek() views the mapping" );
+      check( pumps == ( data.size() + 64 * 1024 - 1 ) / ( 64 * 1024 ), "one pump per stream's worth" );
+      check( source.finished() and source.pump( stream.writer() ) == 0, "nothing left" );
+    }
+
+    // 从流到 TCPSender 的段：payload 还是映射里的字节
+    {
+      const MappedFile file { file_with( data ) };
+      TCPConfig config;
+      TCPSender sender { config };
+      ByteStream stream { config.send_capacity };
+      FileSource source { file };
+      source.pump( stream.writer() );
+      sender.push( stream.reader() );
+      auto const syn = sender.maybe_send();
+      check( syn.has_value() and syn->SYN, "SYN first" );
+      sender.receive( { syn->seqno + 1, 60000, {} } );
+      sender.push( stream.reader() );
+      size_t segments = 0;
+      while ( auto const msg = sender.maybe_send() ) {
+        check( within( msg->payload, file ), "payload shares the mapping" );
+        ++segments;
+      }
+      check( segments > 1, "data was sent" );
+    }
+
+    // FileSink：写到管道，写不进去就停，剩下的留在流里
+    {
+      array<int, 2> fds {};
+      CheckSystemCall( "pipe2", ::pipe2( fds.data(), O_NONBLOCK ) );
+      FileDescriptor read_end { fds[0] };
+      FileDescriptor write_end { fds[1] };
+      read_end.set_blocking( false );
+      write_end.set_blocking( false );
+      FileSink sink { std::move( write_end ) };
+
+      ByteStream stream { data.size() };
+      stream.writer().push( data.substr( 0, 1000 ) );
+      stream.writer().push( Buffer { data.substr( 1000, 1000 ) } );
+      stream.writer().push( data.substr( 2000 ) );
+      string got;
+      string chunk;
+      while ( stream.reader().bytes_buffered() > 0 ) {
+        auto const before = stream.reader().bytes_buffered();
+        auto const written = sink.drain( stream.reader() );
+        check( written == before - stream.reader().bytes_buffered(), "popped what was written" );
+        do {
+          read_end.read( chunk );
+          got += chunk;
+        } while ( not chunk.empty() );
+      }
+      check( got == data, "the pipe got every byte in order" );
+      check( sink.drain( stream.reader() ) == 0, "nothing to write" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,182 @@
+#include "arp_message.hh"
+#include "checksum.hh"
+#include "common.hh"
+#include "ethernet_header.hh"
+#include "header_codec.hh"
+#include "ipv4_header.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+string wire( const vector<Buffer>& buffers )
+{
+  string out;
+  for ( const auto& buffer : buffers ) {
+    out += string_view { buffer };
+  }
+  return out;
+}
+
+// `bytes` with a Buffer boundary after every byte
+vector<Buffer> bytewise( const string& bytes )
+{
+  vector<Buffer> out;
+  for ( const char c : bytes ) {
+    out.emplace_back( string( 1, c ) );
+  }
+  return out;
+}
+
+struct Sample
+{
+  uint8_t flags {};
+  uint16_t port {};
+  array<uint8_t, 3> tag {};
+  uint32_t value {};
+};
+
+uint8_t high_nibble( const Sample& sample )
+{
+  return static_cast<uint8_t>( sample.flags << 4 );
+}
+
+void set_high_nibble( Sample& sample, uint8_t byte )
+{
+  sample.flags = byte >> 4;
+}
+
+using SampleLayout = FixedLayout<Sample,
+                                 Packed<Sample, uint8_t, high_nibble, set_high_nibble>,
+                                 Field<&Sample::port>,
+                                 Field<&Sample::tag>,
+                                 Field<&Sample::value>>;
+static_assert( SampleLayout::LENGTH == 10 );
+} // namespace
+
+int main()
+{
+  try {
+    // 生成的编解码：大端整数、原样的字节数组、拆开的位域
+    {
+      const Sample sample { 0x5, 0x1234, { 'a', 'b', 'c' }, 0xdeadbeef };
+      string bytes( SampleLayout::LENGTH, 0 );
+      SampleLayout::encode( sample, bytes.data() );
+      check( bytes == string { "\x50\x12\x34" "abc" "\xde\xad\xbe\xef", 10 }, "encoded layout" );
+
+      Sample decoded;
+      SampleLayout::decode( decoded, bytes.data() );
+      check( decoded.flags == 0x5 and decoded.port == 0x1234 and decoded.tag == sample.tag
+               and decoded.value == 0xdeadbeef,
+             "decoded layout" );
+
+      Parser short_input { { bytes.substr( 0, 9 ) } };
+      SampleLayout::parse( decoded, short_input );
+      check( short_input.has_error(), "short input is an error" );
+    }
+
+    // IPv4 头部的线上格式（RFC 791 的字段顺序）
+    {
+      IPv4Header ip;
+      ip.tos = 0x10;
+      ip.len = 0x0054;
+      ip.id = 0xbeef;
+      ip.df = false;
+      ip.mf = true;
+      ip.offset = 0x123;
+      ip.ttl = 64;
+      ip.proto = 1;
+      ip.src = 0x0a000001;
+      ip.dst = 0xc0a80102;
+      ip.compute_checksum();
+
+      const string bytes = wire( serialize( ip ) );
+      check( bytes.size() == IPv4Header::LENGTH, "IPv4 header length" );
+      check( bytes.substr( 0, 10 ) == string { "\x45\x10\x00\x54\xbe\xef\x21\x23\x40\x01", 10 }, "IPv4 fields" );
+      check( bytes.substr( 12 ) == string { "\x0a\x00\x00\x01\xc0\xa8\x01\x02", 8 }, "IPv4 addresses" );
+
+      for ( const auto& input : { vector<Buffer> { bytes }, bytewise( bytes ) } ) {
+        IPv4Header parsed;
+        check( parse( parsed, input ), "IPv4 header parses" );
+        check( parsed.to_string() == ip.to_string() and parsed.cksum == ip.cksum, "IPv4 round trip" );
+      }
+
+      string corrupt = bytes;
+      corrupt[8] = 63;
+      for ( const auto& input : { vector<Buffer> { corrupt }, bytewise( corrupt ) } ) {
+        IPv4Header parsed;
+        check( not parse( parsed, input ), "bad checksum rejected" );
+
+        // 网卡已经验过：不再检查
+        Parser parser { input };
+        parser.set_checksum_verified();
+        parsed.parse( parser );
+        check( not parser.has_error() and parsed.ttl == 63, "verified input not checked again" );
+      }
+
+      // 校验和按线上的字节算：保留位和选项都算在内
+      string reserved = bytes;
+      reserved[6] = static_cast<char>( reserved[6] | 0x80 );
+      IPv4Header parsed;
+      check( not parse( parsed, { reserved } ), "reserved flag is covered by the checksum" );
+
+      IPv4Header with_options = ip;
+      with_options.hlen = 6;
+      with_options.len += 4;
+      const string options { "\x01\x01\x01\x00", 4 };
+      const string header = wire( serialize( with_options ) );
+      InternetChecksum sum;
+      sum.add( string_view { header.substr( 0, 10 ) } );
+      sum.add( string_view { header.substr( 12 ) } );
+      sum.add( options );
+      const uint16_t value = sum.value();
+      string good = header + options;
+      good[10] = static_cast<char>( value >> 8 );
+      good[11] = static_cast<char>( value );
+      check( parse( parsed, { good } ) and parsed.hlen == 6, "options are covered by the checksum" );
+      check( parse( parsed, bytewise( good ) ), "options straddling Buffers" );
+      good[21] = 2;
+      check( not parse( parsed, { good } ), "bad option byte rejected" );
+    }
+
+    // 以太网头部和 ARP
+    {
+      const EthernetHeader eth { { 1, 2, 3, 4, 5, 6 }, { 7, 8, 9, 10, 11, 12 }, EthernetHeader::TYPE_ARP };
+      const string bytes = wire( serialize( eth ) );
+      check( bytes == string { "\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x08\x06", 14 }, "Ethernet bytes" );
+      for ( const auto& input : { vector<Buffer> { bytes }, bytewise( bytes ) } ) {
+        EthernetHeader parsed {};
+        check( parse( parsed, input ) and parsed.to_string() == eth.to_string(), "Ethernet round trip" );
+      }
+
+      ARPMessage arp;
+      arp.opcode = ARPMessage::OPCODE_REPLY;
+      arp.sender_ethernet_address = eth.src;
+      arp.sender_ip_address = 0x0a000001;
+      arp.target_ethernet_address = eth.dst;
+      arp.target_ip_address = 0x0a000002;
+      const string arp_bytes = wire( serialize( arp ) );
+      check( arp_bytes.size() == ARPMessage::LENGTH, "ARP length" );
+      check( arp_bytes.substr( 0, 8 ) == string { "\x00\x01\x08\x00\x06\x04\x00\x02", 8 }, "ARP fixed fields" );
+      for ( const auto& input : { vector<Buffer> { arp_bytes }, bytewise( arp_bytes ) } ) {
+        ARPMessage parsed;
+        check( parse( parsed, input ) and parsed.to_string() == arp.to_string(), "ARP round trip" );
+      }
+
+      string unsupported = arp_bytes;
+      unsupported[7] = 9;
+      ARPMessage parsed;
+      check( not parse( parsed, { unsupported } ), "unsupported opcode rejected" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
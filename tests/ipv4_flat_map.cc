@@ -0,0 +1,74 @@
+#include "common.hh"
+#include "ipv4_flat_map.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+// 随机插入、删除、查找，和 unordered_map 对比
+void compare_with_unordered_map( uint32_t key_range, size_t operations, unsigned seed )
+{
+  IPv4FlatMap<uint64_t> map;
+  unordered_map<uint32_t, uint64_t> reference;
+  default_random_engine rd { seed };
+  uniform_int_distribution<uint32_t> key_dist { 0, key_range - 1 };
+  uniform_int_distribution<int> op_dist { 0, 2 };
+
+  for ( size_t i = 0; i < operations; ++i ) {
+    // 让 key 在高位也有变化，同时保留不少冲突
+    auto const key = key_dist( rd ) * 0x01000193U;
+    switch ( op_dist( rd ) ) {
+      case 0:
+        map.find_or_insert( key ) = i;
+        reference[key] = i;
+        break;
+      case 1:
+        map.erase( key );
+        reference.erase( key );
+        break;
+      default: {
+        auto const* value = map.find( key );
+        auto const it = reference.find( key );
+        check( ( value != nullptr ) == ( it != reference.end() ), "presence of key " + to_string( key ) );
+        check( value == nullptr or *value == it->second, "value of key " + to_string( key ) );
+      }
+    }
+    check( map.size() == reference.size(), "size after operation " + to_string( i ) );
+  }
+
+  for ( const auto& [key, value] : reference ) {
+    auto const* found = map.find( key );
+    check( found != nullptr and *found == value, "final value of key " + to_string( key ) );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    {
+      IPv4FlatMap<int> map;
+      check( map.empty() and map.find( 0 ) == nullptr, "new map is empty" );
+      map.find_or_insert( 0 ) = 7;
+      check( map.find_or_insert( 0 ) == 7 and map.size() == 1, "find_or_insert finds an existing key" );
+      map.erase( 1 );
+      check( map.size() == 1, "erasing a missing key does nothing" );
+      map.erase( 0 );
+      check( map.empty() and map.find( 0 ) == nullptr, "erase removes the key" );
+    }
+
+    compare_with_unordered_map( 64, 100000, 1 );     // 小表，反复增删
+    compare_with_unordered_map( 100000, 300000, 2 ); // 大表，多次扩容
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
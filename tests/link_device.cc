@@ -0,0 +1,185 @@
+#include "arp_message.hh"
+#include "common.hh"
+#include "exception.hh"
+#include "link_device.hh"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+namespace {
+const EthernetAddress LOCAL_ETH { 0x02, 0, 0, 0, 0, 1 };
+const Address LOCAL_IP { "10.0.0.1" };
+
+EthernetAddress neighbour_eth( uint8_t i )
+{
+  return { 0x02, 0, 0, 0, 1, i };
+}
+
+string wire( const EthernetFrame& frame )
+{
+  string out;
+  for ( const auto& buffer : serialize( frame ) ) {
+    out += string_view { buffer };
+  }
+  return out;
+}
+
+EthernetFrame arp_request_from( uint8_t i )
+{
+  ARPMessage msg;
+  msg.opcode = ARPMessage::OPCODE_REQUEST;
+  msg.sender_ethernet_address = neighbour_eth( i );
+  msg.sender_ip_address = Address { "10.0.1.0" }.ipv4_numeric() + i;
+  msg.target_ip_address = LOCAL_IP.ipv4_numeric();
+  return { { ETHERNET_BROADCAST, neighbour_eth( i ), EthernetHeader::TYPE_ARP }, serialize( msg ) };
+}
+
+EthernetFrame datagram_frame( uint8_t i )
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address { "10.0.1.0" }.ipv4_numeric() + i;
+  dgram.header.dst = LOCAL_IP.ipv4_numeric();
+  dgram.payload.emplace_back( "datagram " + to_string( i ) );
+  dgram.header.len = IPv4Header::LENGTH + dgram.payload.back().size();
+  dgram.header.compute_checksum();
+  return { { LOCAL_ETH, neighbour_eth( i ), EthernetHeader::TYPE_IPv4 }, serialize( dgram ) };
+}
+
+// One end of a datagram socketpair, standing in for the wire
+class Peer
+{
+public:
+  explicit Peer( int fd ) : fd_( fd ) {}
+
+  void send( const EthernetFrame& frame ) { send( wire( frame ) ); }
+  void send( const string& bytes ) { CheckSystemCall( "send", ::send( fd_.fd_num(), bytes.data(), bytes.size(), 0 ) ); }
+
+  // Every frame waiting, without blocking
+  vector<EthernetFrame> drain()
+  {
+    vector<EthernetFrame> frames;
+    string bytes( LinkDevice::MAX_FRAME_SIZE, 0 );
+    while ( true ) {
+      const ssize_t len = ::recv( fd_.fd_num(), bytes.data(), bytes.size(), MSG_DONTWAIT );
+      if ( len < 0 ) {
+        check( errno == EAGAIN, "peer recv failed" );
+        return frames;
+      }
+      EthernetFrame frame;
+      check( parse( frame, vector<Buffer> { bytes.substr( 0, len ) } ), "peer received a bad frame" );
+      frames.push_back( std::move( frame ) );
+    }
+  }
+
+private:
+  FileDescriptor fd_;
+};
+
+void socketpair_test()
+{
+  int fds[2] {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_DGRAM, 0, fds ) );
+  LinkDevice device { FileDescriptor { fds[0] }, 8 };
+  Peer peer { fds[1] };
+  NetworkInterface iface { LOCAL_ETH, LOCAL_IP };
+  vector<InternetDatagram> datagrams;
+
+  // 20 个 ARP 请求，每批最多 8 个
+  for ( uint8_t i = 0; i < 20; ++i ) {
+    peer.send( arp_request_from( i ) );
+  }
+  for ( int batch = 0; batch < 3; ++batch ) {
+    device.pump( iface, datagrams );
+  }
+  auto replies = peer.drain();
+  check( replies.size() == 20, "expected 20 ARP replies, got " + to_string( replies.size() ) );
+  for ( uint8_t i = 0; i < 20; ++i ) {
+    check( replies[i].header.dst == neighbour_eth( i ) and replies[i].header.type == EthernetHeader::TYPE_ARP,
+           "reply " + to_string( i ) + " in order and addressed to its neighbour" );
+  }
+  check( iface.stats().frames_in == 20 and iface.stats().frames_out == 20, "interface counted every frame" );
+
+  // IPv4 帧交给接口，数据报交回调用者；截断不了的垃圾帧只计数
+  peer.send( datagram_frame( 3 ) );
+  peer.send( string { "short" } );
+  peer.send( datagram_frame( 4 ) );
+  device.pump( iface, datagrams );
+  check( datagrams.size() == 2, "two datagrams received" );
+  check( string_view { datagrams[1].payload.front() } == "datagram 4", "datagram payload intact" );
+  check( device.dropped() == 1, "the short frame was dropped" );
+
+  // 对端不读时 sendmmsg 会发不完：剩下的留在 vector 里，下次再发
+  vector<EthernetFrame> burst( 5000, datagram_frame( 9 ) );
+  const size_t first = device.transmit( burst );
+  check( first > 0 and first < 5000, "device should fill up before 5000 frames, sent " + to_string( first ) );
+  check( burst.size() == 5000 - first, "unsent frames stay in the vector" );
+  size_t total = first;
+  while ( not burst.empty() ) {
+    total -= peer.drain().size();
+    total += device.transmit( burst );
+  }
+  total -= peer.drain().size();
+  check( total == 0, "every frame arrived exactly once" );
+}
+
+// PACKET_MMAP 接收环：在 lo 上用一个以太类型没人用的帧试一下（没有 CAP_NET_RAW 就跳过）
+void rx_ring_test()
+{
+  static constexpr uint16_t TEST_ETHERTYPE = 0x88b5; // IEEE 802 本地实验用
+
+  optional<LinkDevice> receiver;
+  optional<LinkDevice> sender;
+  try {
+    receiver.emplace( LinkDevice::packet_socket( "lo" ) );
+    sender.emplace( LinkDevice::packet_socket( "lo" ) );
+    receiver->enable_rx_ring( 1 << 16, 4, 1 );
+  } catch ( const unix_error& e ) {
+    cerr << "Skipping the receive ring test: " << e.what() << "\n";
+    return;
+  }
+  check( receiver->rx_ring_enabled(), "ring enabled" );
+
+  vector<EthernetFrame> frames;
+  for ( int i = 0; i < 10; ++i ) {
+    frames.push_back(
+      { { LOCAL_ETH, neighbour_eth( i ), TEST_ETHERTYPE }, { Buffer { "ring frame " + to_string( i ) } } } );
+  }
+  check( sender->transmit( frames ) == 10, "sent 10 frames on lo" );
+
+  size_t seen = 0;
+  vector<EthernetFrame> received;
+  const auto deadline = chrono::steady_clock::now() + chrono::seconds( 2 );
+  while ( seen < 10 and chrono::steady_clock::now() < deadline ) {
+    received.clear();
+    receiver->receive( received );
+    for ( const auto& frame : received ) {
+      seen += frame.header.type == TEST_ETHERTYPE and frame.header.dst == LOCAL_ETH;
+    }
+    this_thread::sleep_for( chrono::milliseconds( 1 ) );
+  }
+  check( seen >= 10, "ring delivered the frames sent on lo (saw " + to_string( seen ) + ")" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    socketpair_test();
+    rx_ring_test();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
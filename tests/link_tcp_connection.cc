@@ -0,0 +1,110 @@
+#include "common.hh"
+#include "exception.hh"
+#include "link_tcp_connection.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+
+using namespace std;
+
+namespace {
+string read_all( Reader& reader )
+{
+  string out;
+  while ( reader.bytes_buffered() > 0 ) {
+    out += reader.peek();
+    reader.pop( reader.peek().size() );
+  }
+  return out;
+}
+
+// 两个连接各占 socketpair 的一端，互为网关：ARP、IPv4、TCP 全走项目自己的代码
+void transfer_test()
+{
+  int fds[2] {};
+  CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_DGRAM, 0, fds ) );
+
+  LinkTCPConnection::Config client_config;
+  client_config.ethernet_address = { 0x02, 0, 0, 0, 0, 1 };
+  client_config.local_ip = Address { "10.0.0.1" };
+  client_config.gateway = Address { "10.0.0.2" };
+  client_config.local_port = 40000;
+
+  LinkTCPConnection::Config server_config;
+  server_config.ethernet_address = { 0x02, 0, 0, 0, 0, 2 };
+  server_config.local_ip = Address { "10.0.0.2" };
+  server_config.gateway = Address { "10.0.0.1" };
+  server_config.local_port = 8080;
+
+  LinkTCPConnection client { LinkDevice { FileDescriptor { fds[0] } }, client_config, Address { "10.0.0.2", 8080 } };
+  LinkTCPConnection server { LinkDevice { FileDescriptor { fds[1] } }, server_config, Address { "10.0.0.1", 40000 } };
+
+  string request;
+  for ( size_t i = 0; request.size() < 200000; ++i ) {
+    request += to_string( i ) + ",";
+  }
+
+  client.connect();
+  size_t written = 0;
+  string received;
+  string reply;
+  bool replied = false;
+  for ( int ms = 0; ms < 60000 and ( client.active() or server.active() ); ++ms ) {
+    if ( written < request.size() and client.established() ) {
+      const string_view rest = string_view { request }.substr( written );
+      const size_t n = min( rest.size(), client.writer().available_capacity() );
+      client.writer().push( string { rest.substr( 0, n ) } );
+      written += n;
+      if ( written == request.size() ) {
+        client.writer().close();
+      }
+      client.push();
+    }
+
+    server.poll();
+    received += read_all( server.reader() );
+    if ( server.reader().is_finished() and not replied ) {
+      server.writer().push( "got " + to_string( received.size() ) + " bytes" );
+      server.writer().close();
+      server.push();
+      replied = true;
+    }
+
+    client.poll();
+    reply += read_all( client.reader() );
+
+    client.tick( 1 );
+    server.tick( 1 );
+  }
+
+  check( client.established() and server.established(), "handshake completed" );
+  check( received == request, "server received the whole request in order" );
+  check( reply == "got " + to_string( request.size() ) + " bytes", "client received the reply: " + reply );
+  check( not client.active() and not server.active(), "both ends finished cleanly" );
+  check( not client.reset() and not server.reset(), "nobody sent RST" );
+
+  const auto c = client.stats();
+  const auto s = server.stats();
+  check( c.dropped == 0 and s.dropped == 0, "no datagram was dropped" );
+  check( c.segments_sent == s.segments_received and s.segments_sent == c.segments_received,
+         "every segment arrived (the socketpair loses nothing)" );
+  check( c.bytes_sent == request.size() and s.bytes_received == request.size(), "no data was retransmitted" );
+  check( c.segments_sent >= request.size() / TCPConfig::MAX_PAYLOAD_SIZE, "segments are at most one MSS" );
+  check( client.interface().neighbours() == 1, "client learned the server's Ethernet address with ARP" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    transfer_test();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+#include "common.hh"
+#include "log.hh"
+
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    // 把 stderr 接到字符串上
+    ostringstream captured;
+    auto* const old_buffer = cerr.rdbuf( captured.rdbuf() );
+
+    int formatted = 0;
+    const auto message = [&]( ostream& out ) {
+      ++formatted;
+      out << "answer=" << 42;
+    };
+
+    Log::set_level( LogLevel::Warning );
+    log<LogLevel::Debug>( message );
+    log<LogLevel::Info>( message );
+    const bool silent = captured.str().empty() && formatted == 0;
+
+    log<LogLevel::Warning>( message );
+    log<LogLevel::Error>( message );
+    const string enabled_output = captured.str();
+
+    Log::set_level( LogLevel::Debug );
+    captured.str( "" );
+    log<LogLevel::Debug>( message );
+    const string debug_output = captured.str();
+
+    Log::set_level( LogLevel::None );
+    captured.str( "" );
+    log<LogLevel::Error>( message );
+    const string none_output = captured.str();
+
+    cerr.rdbuf( old_buffer );
+
+    check( silent, "disabled levels were formatted or written" );
+    check( enabled_output == "WARNING: answer=42\nERROR: answer=42\n", "enabled levels: " + enabled_output );
+    check( debug_output == "DEBUG: answer=42\n", "debug level: " + debug_output );
+    check( none_output.empty() && formatted == 3, "LogLevel::None still logged" );
+    check( Log::enabled( LogLevel::Error ) == false, "enabled() at None" );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
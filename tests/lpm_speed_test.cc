@@ -0,0 +1,185 @@
+#include "lpm_table.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+struct Route
+{
+  uint32_t prefix;
+  uint8_t length;
+};
+
+// Roughly the shape of a full BGP table: mostly /24s, then /16-/23, a few short and longer-than-/24
+// prefixes
+vector<Route> synthetic_table( size_t num_routes, default_random_engine& rd )
+{
+  uniform_int_distribution<uint32_t> u32_dist;
+  uniform_int_distribution<int> percentile { 0, 99 };
+  uniform_int_distribution<int> mid_length { 16, 23 };
+  uniform_int_distribution<int> short_length { 8, 15 };
+  uniform_int_distribution<int> long_length { 25, 32 };
+
+  vector<Route> routes;
+  routes.reserve( num_routes + 1 );
+  routes.push_back( { 0, 0 } );
+  while ( routes.size() <= num_routes ) {
+    const int p = percentile( rd );
+    const int length = p < 60 ? 24 : p < 95 ? mid_length( rd ) : p < 97 ? short_length( rd ) : long_length( rd );
+    routes.push_back( { u32_dist( rd ), static_cast<uint8_t>( length ) } );
+  }
+  return routes;
+}
+
+// The lookup Router did before LPMTable: compare against every route
+uint32_t linear_lookup( const vector<Route>& routes, uint32_t address )
+{
+  uint32_t best = LPMTable::NONE;
+  int best_length = -1;
+  for ( uint32_t i = 0; i < routes.size(); ++i ) {
+    const auto length = routes[i].length;
+    if ( length > 32 ) {
+      continue;
+    }
+    const uint32_t mask = length == 0 ? 0 : UINT32_MAX << ( 32 - length );
+    if ( ( address & mask ) == ( routes[i].prefix & mask ) && length > best_length ) {
+      best = i;
+      best_length = length;
+    }
+  }
+  return best;
+}
+
+// Random tables of every prefix length (including 33, which never matches), with the prefixes
+// crowded under a few /16s so that they overlap, checked against a linear scan one lookup at a
+// time and in bursts
+void lpm_random_check( const size_t rounds, // NOLINT(bugprone-easily-swappable-parameters)
+                       const size_t num_routes,
+                       const size_t num_lookups )
+{
+  default_random_engine rd { 1618 };
+  uniform_int_distribution<uint32_t> u32_dist;
+  uniform_int_distribution<int> length_dist { 0, 33 };
+  for ( size_t round = 0; round < rounds; ++round ) {
+    vector<uint32_t> bases;
+    for ( int i = 0; i < 8; ++i ) {
+      bases.push_back( u32_dist( rd ) & 0xffff0000 );
+    }
+    const auto random_address = [&] { return bases[u32_dist( rd ) % bases.size()] | ( u32_dist( rd ) & 0xffff ); };
+
+    vector<Route> routes;
+    LPMTable table;
+    for ( uint32_t i = 0; i < num_routes; ++i ) {
+      const auto length = static_cast<uint8_t>( i < 4 ? 16 + i * 4 : length_dist( rd ) );
+      routes.push_back( { random_address(), length } );
+      table.insert( routes.back().prefix, length, i );
+    }
+    vector<uint32_t> addresses;
+    for ( size_t i = 0; i < num_lookups; ++i ) {
+      const uint32_t address = i % 10 == 0 ? u32_dist( rd ) : random_address();
+      if ( table.lookup( address ) != linear_lookup( routes, address ) ) {
+        throw runtime_error( "LPMTable disagrees with a linear scan on a random table" );
+      }
+      addresses.push_back( address );
+    }
+
+    vector<uint32_t> values( addresses.size(), 0 );
+    table.lookup_burst( addresses, values );
+    for ( size_t i = 0; i < addresses.size(); ++i ) {
+      if ( values[i] != table.lookup( addresses[i] ) ) {
+        throw runtime_error( "LPMTable burst lookup disagrees with lookup() on a random table" );
+      }
+    }
+  }
+  cout << "LPMTable agrees with a linear scan on " << rounds << " random tables of " << num_routes << " routes.\n";
+}
+
+void lpm_speed_test( const size_t num_routes, // NOLINT(bugprone-easily-swappable-parameters)
+                     const size_t num_lookups,
+                     const size_t num_linear_lookups )
+{
+  default_random_engine rd { 2718 };
+  const auto routes = synthetic_table( num_routes, rd );
+
+  // Half the lookups go to addresses under a route's prefix (as real traffic does), half anywhere
+  vector<uint32_t> addresses;
+  uniform_int_distribution<uint32_t> u32_dist;
+  for ( size_t i = 0; i < 1 << 16; ++i ) {
+    const auto& route = routes[u32_dist( rd ) % routes.size()];
+    addresses.push_back( i % 2 ? u32_dist( rd ) : route.prefix ^ ( u32_dist( rd ) >> route.length ) );
+  }
+
+  LPMTable table;
+  const auto build_start = steady_clock::now();
+  for ( uint32_t i = 0; i < routes.size(); ++i ) {
+    table.insert( routes[i].prefix, routes[i].length, i );
+  }
+  const auto build_stop = steady_clock::now();
+
+  uint64_t checksum = 0;
+  const auto lookup_start = steady_clock::now();
+  for ( size_t i = 0; i < num_lookups; ++i ) {
+    checksum += table.lookup( addresses[i % addresses.size()] );
+  }
+  const auto lookup_stop = steady_clock::now();
+
+  const auto linear_start = steady_clock::now();
+  for ( size_t i = 0; i < num_linear_lookups; ++i ) {
+    const auto address = addresses[i % addresses.size()];
+    if ( linear_lookup( routes, address ) != table.lookup( address ) ) {
+      throw runtime_error( "LPMTable disagrees with a linear scan" );
+    }
+  }
+  const auto linear_stop = steady_clock::now();
+
+  const auto build_ms = duration_cast<duration<double, milli>>( build_stop - build_start ).count();
+  const auto mlps = static_cast<double>( num_lookups )
+                    / duration_cast<duration<double>>( lookup_stop - lookup_start ).count() / 1e6;
+  const auto linear_mlps = static_cast<double>( num_linear_lookups )
+                           / duration_cast<duration<double>>( linear_stop - linear_start ).count() / 1e6;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "LPMTable with " << routes.size() << " routes: built in " << fixed << setprecision( 1 ) << build_ms
+       << " ms, " << table.memory_usage() / ( 1 << 20 ) << " MiB, " << setprecision( 2 ) << mlps
+       << " M lookups/s (linear scan: " << setprecision( 6 ) << linear_mlps << " M lookups/s, checksum "
+       << checksum << ").\n";
+
+  debug_output << "   LPMTable (" << routes.size() << " routes): " << fixed << setprecision( 2 ) << mlps
+               << " M lookups/s, linear scan " << setprecision( 6 ) << linear_mlps << " M lookups/s\n";
+
+  if ( mlps < 1 ) {
+    throw runtime_error( "LPMTable did not meet minimum speed of 1 M lookups/s." );
+  }
+}
+} // namespace
+
+void program_body()
+{
+  lpm_random_check( 4, 500, 20000 );
+  lpm_speed_test( 1000, 20000000, 20000 );
+  lpm_speed_test( 1000000, 20000000, 100 );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+#include "common.hh"
+#include "lpm_table.hh"
+#include "random.hh"
+
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+struct Route
+{
+  uint32_t prefix;
+  uint8_t length;
+};
+
+// 逐条比较；同样长的前缀取先加入的那条
+uint32_t reference_lookup( const vector<Route>& routes, uint32_t address )
+{
+  uint32_t best = LPMTable::NONE;
+  int best_length = -1;
+  for ( uint32_t i = 0; i < routes.size(); ++i ) {
+    const auto length = routes[i].length;
+    if ( length > 32 ) {
+      continue;
+    }
+    const uint32_t mask = length == 0 ? 0 : UINT32_MAX << ( 32 - length );
+    if ( ( address & mask ) == ( routes[i].prefix & mask ) && length > best_length ) {
+      best = i;
+      best_length = length;
+    }
+  }
+  return best;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      LPMTable table;
+      check( table.lookup( 0 ) == LPMTable::NONE, "empty table matched" );
+
+      // 先加长的再加短的，短的不能覆盖长的
+      table.insert( 0x0a010280, 25, 0 ); // 10.1.2.128/25
+      table.insert( 0x0a010200, 24, 1 ); // 10.1.2.0/24
+      table.insert( 0x0a000000, 8, 2 );  // 10.0.0.0/8
+      table.insert( 0x0a0102ff, 32, 3 ); // 10.1.2.255/32
+      table.insert( 0xffffffff, 0, 4 );  // default route; host bits are ignored
+      table.insert( 0x0a000000, 8, 5 );  // duplicate: the first one wins
+      table.insert( 0x0b000000, 33, 6 ); // never matches
+
+      check( table.lookup( 0x0a0102ff ) == 3, "/32" );
+      check( table.lookup( 0x0a0102fe ) == 0, "/25" );
+      check( table.lookup( 0x0a01027f ) == 1, "/24 beside a /25" );
+      check( table.lookup( 0x0a010300 ) == 2, "/8" );
+      check( table.lookup( 0x0b000000 ) == 4, "default route" );
+
+      table.clear();
+      check( table.lookup( 0x0a0102ff ) == LPMTable::NONE, "clear" );
+      table.insert( 0x0a010280, 25, 7 );
+      check( table.lookup( 0x0a0102ff ) == 7, "insert after clear" );
+      check( table.lookup( 0x0a010200 ) == LPMTable::NONE, "no route after clear" );
+    }
+
+    // 随机路由表，和逐条比较的结果对比；前缀集中在少数 /16 下面，保证有重叠。短前缀要填满整段 tbl24，
+    // 只放几条手挑的（/0、/8、/12），随机的都在 /16 以上；大表的随机对比在 lpm_speed_test 里
+    uniform_int_distribution<uint32_t> u32_dist;
+    uniform_int_distribution<int> length_dist { 16, 33 };
+    for ( int round = 0; round < 2; ++round ) {
+      vector<uint32_t> bases;
+      for ( int i = 0; i < 8; ++i ) {
+        bases.push_back( u32_dist( rd ) & 0xffff0000 );
+      }
+      const auto random_address = [&] { return bases[u32_dist( rd ) % bases.size()] | ( u32_dist( rd ) & 0xffff ); };
+
+      vector<Route> routes;
+      LPMTable table;
+      constexpr array<uint8_t, 7> fixed_lengths { 0, 8, 12, 16, 20, 24, 28 };
+      for ( int i = 0; i < 200; ++i ) {
+        const auto length = static_cast<uint8_t>( i < 7 ? fixed_lengths[i] : length_dist( rd ) );
+        routes.push_back( { random_address(), length } );
+        table.insert( routes.back().prefix, length, i );
+      }
+      vector<uint32_t> addresses;
+      for ( int i = 0; i < 5000; ++i ) {
+        const uint32_t address = i % 10 == 0 ? u32_dist( rd ) : random_address();
+        check( table.lookup( address ) == reference_lookup( routes, address ),
+               "lookup of " + to_string( address ) + " disagrees with a linear scan" );
+        addresses.push_back( address );
+      }
+
+      // 成批查询和逐个查询一样；长度不是 BURST（也不是 8）的倍数，尾巴也要对
+      for ( const size_t count : { size_t { 0 }, size_t { 5 }, LPMTable::BURST + 3, addresses.size() - 1 } ) {
+        vector<uint32_t> values( count, 0 );
+        table.lookup_burst( span { addresses }.first( count ), values );
+        for ( size_t i = 0; i < count; ++i ) {
+          check( values[i] == table.lookup( addresses[i] ),
+                 "burst lookup of " + to_string( addresses[i] ) + " disagrees with lookup()" );
+        }
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
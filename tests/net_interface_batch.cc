@@ -0,0 +1,234 @@
+#include "arp_message.hh"
+#include "network_interface_test_harness.hh"
+#include "router.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+const EthernetAddress LOCAL_ETH { 0x02, 0, 0, 0, 0, 1 };
+const Address LOCAL_IP { "10.0.0.1" };
+const EthernetAddress PEER_ETH { 0x02, 0, 0, 0, 0, 2 };
+const Address PEER_IP { "10.0.0.2" };
+const EthernetAddress OTHER_ETH { 0x02, 0, 0, 0, 0, 3 };
+const Address OTHER_IP { "10.0.0.3" };
+
+// A datagram from the peer to us, told apart by `id`
+InternetDatagram datagram( uint16_t id, const string& payload = "payload" )
+{
+  InternetDatagram dgram;
+  dgram.header.src = PEER_IP.ipv4_numeric();
+  dgram.header.dst = LOCAL_IP.ipv4_numeric();
+  dgram.header.id = id;
+  dgram.header.ttl = 64;
+  dgram.header.df = false;
+  dgram.payload.emplace_back( payload );
+  dgram.header.len = IPv4Header::LENGTH + payload.size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+EthernetFrame frame_of( InternetDatagram dgram, const EthernetAddress& dst = LOCAL_ETH )
+{
+  return { { dst, PEER_ETH, EthernetHeader::TYPE_IPv4 }, serialize( std::move( dgram ) ) };
+}
+
+EthernetFrame arp( uint16_t opcode, const EthernetAddress& sender_eth, const Address& sender_ip )
+{
+  ARPMessage msg;
+  msg.opcode = opcode;
+  msg.sender_ethernet_address = sender_eth;
+  msg.sender_ip_address = sender_ip.ipv4_numeric();
+  msg.target_ethernet_address = opcode == ARPMessage::OPCODE_REPLY ? LOCAL_ETH : EthernetAddress {};
+  msg.target_ip_address = LOCAL_IP.ipv4_numeric();
+  const auto dst = opcode == ARPMessage::OPCODE_REPLY ? LOCAL_ETH : ETHERNET_BROADCAST;
+  return { { dst, sender_eth, EthernetHeader::TYPE_ARP }, serialize( msg ) };
+}
+
+// The fragments of datagram( 7, payload ) from an interface with a 576-byte MTU (552 bytes each, but the last)
+vector<EthernetFrame> fragments_of( const string& payload )
+{
+  vector<EthernetFrame> frames;
+  for ( size_t offset = 0; offset < payload.size(); offset += 552 ) {
+    const size_t size = min<size_t>( 552, payload.size() - offset );
+    auto fragment = datagram( 7, payload.substr( offset, size ) );
+    fragment.header.offset = offset / 8;
+    fragment.header.mf = offset + size < payload.size();
+    fragment.header.compute_checksum();
+    frames.push_back( frame_of( std::move( fragment ) ) );
+  }
+  return frames;
+}
+
+ExpectStat frames_in( uint64_t n )
+{
+  return { "frames_in", &InterfaceStats::frames_in, n };
+}
+
+ExpectStat checksum_failures( uint64_t n )
+{
+  return { "checksum_failures", &InterfaceStats::checksum_failures, n };
+}
+
+ExpectStat malformed( uint64_t n )
+{
+  return { "malformed", &InterfaceStats::malformed, n };
+}
+
+// AsyncNetworkInterface 的批量接收：数据报排队等 maybe_receive()
+class AsyncInterfaceTestHarness : public TestHarness<AsyncNetworkInterface>
+{
+public:
+  explicit AsyncInterfaceTestHarness( string test_name )
+    : TestHarness( std::move( test_name ),
+                   "eth=" + to_string( LOCAL_ETH ) + ", ip=" + LOCAL_IP.ip(),
+                   AsyncNetworkInterface { LOCAL_ETH, LOCAL_IP } )
+  {}
+};
+
+struct AsyncReceiveFrames : public Action<AsyncNetworkInterface>
+{
+  vector<EthernetFrame> frames;
+
+  explicit AsyncReceiveFrames( vector<EthernetFrame> f ) : frames( std::move( f ) ) {}
+  string description() const override { return "batch of " + to_string( frames.size() ) + " frames arrives"; }
+  void execute( AsyncNetworkInterface& interface ) const override { interface.recv_frames( frames ); }
+};
+
+struct ExpectReceived : public Expectation<AsyncNetworkInterface>
+{
+  optional<InternetDatagram> expected;
+
+  explicit ExpectReceived( optional<InternetDatagram> e ) : expected( std::move( e ) ) {}
+  string description() const override
+  {
+    return expected.has_value() ? "datagram received: " + expected->header.to_string() : "no datagram received";
+  }
+  void execute( AsyncNetworkInterface& interface ) const override
+  {
+    auto result = interface.maybe_receive();
+    if ( result.has_value() != expected.has_value() ) {
+      throw ExpectationViolation( "[datagram received]", expected.has_value(), result.has_value() );
+    }
+    if ( result.has_value() and not equal( *result, *expected ) ) {
+      throw ExpectationViolation( "maybe_receive() returned a different Internet datagram than was expected: actual={"
+                                  + result->header.to_string() + "}" );
+    }
+  }
+};
+} // namespace
+
+int main()
+{
+  try {
+    // 混在一起的一批：结果和逐帧 recv_frame() 一样，数据报保持到达顺序
+    {
+      vector<EthernetFrame> frames;
+      frames.push_back( frame_of( datagram( 1 ) ) );
+      frames.push_back( arp( ARPMessage::OPCODE_REQUEST, OTHER_ETH, OTHER_IP ) );
+      frames.push_back( frame_of( datagram( 2 ), OTHER_ETH ) ); // 不是发给我们的
+      auto corrupt = frame_of( datagram( 3 ) );
+      corrupt.payload.front() = Buffer { string { "not an IPv4 header" } };
+      frames.push_back( corrupt );
+      frames.push_back( frame_of( datagram( 4 ) ) );
+      frames.push_back( arp( ARPMessage::OPCODE_REPLY, PEER_ETH, PEER_IP ) );
+      frames.push_back( { { LOCAL_ETH, PEER_ETH, 0x86dd }, {} } ); // 不认识的类型
+      frames.push_back( frame_of( datagram( 5 ) ) );
+      const vector<optional<InternetDatagram>> expected {
+        datagram( 1 ), nullopt, nullopt, nullopt, datagram( 4 ), nullopt, nullopt, datagram( 5 ) };
+
+      // ARP 请求得到回复；学到的映射马上能用
+      ARPMessage reply;
+      reply.opcode = ARPMessage::OPCODE_REPLY;
+      reply.sender_ethernet_address = LOCAL_ETH;
+      reply.sender_ip_address = LOCAL_IP.ipv4_numeric();
+      reply.target_ethernet_address = OTHER_ETH;
+      reply.target_ip_address = OTHER_IP.ipv4_numeric();
+      const EthernetFrame reply_frame { { OTHER_ETH, LOCAL_ETH, EthernetHeader::TYPE_ARP }, serialize( reply ) };
+
+      NetworkInterfaceTestHarness batched { "mixed batch", LOCAL_ETH, LOCAL_IP };
+      batched.execute( ReceiveFrames { frames, { datagram( 1 ), datagram( 4 ), datagram( 5 ) } } );
+      NetworkInterfaceTestHarness single { "mixed batch, one frame at a time", LOCAL_ETH, LOCAL_IP };
+      for ( size_t i = 0; i < frames.size(); ++i ) {
+        single.execute( ReceiveFrame { frames[i], expected[i] } );
+      }
+
+      for ( auto* test : { &batched, &single } ) {
+        test->execute( frames_in( 7 ) );
+        test->execute( checksum_failures( 0 ) );
+        test->execute( malformed( 1 ) );
+        test->execute( ExpectNeighbours { 2 } );
+        test->execute( ExpectFrame { reply_frame } );
+        test->execute( ExpectNoFrame {} );
+        test->execute( SendDatagram { datagram( 6 ), PEER_IP } );
+        test->execute(
+          ExpectFrame { { { PEER_ETH, LOCAL_ETH, EthernetHeader::TYPE_IPv4 }, serialize( datagram( 6 ) ) } } );
+      }
+    }
+
+    // 截断的头和校验和错误分开算；网卡验过校验和的帧出错只能是头坏了
+    {
+      NetworkInterfaceTestHarness test { "malformed and checksum failures", LOCAL_ETH, LOCAL_IP };
+      auto truncated = frame_of( datagram( 1 ) );
+      truncated.payload = { Buffer { string { string_view { truncated.payload.front() }.substr( 0, 12 ) } } };
+      test.execute( ReceiveFrame { truncated, nullopt } );
+      test.execute( checksum_failures( 0 ) );
+      test.execute( malformed( 1 ) );
+
+      auto corrupt = frame_of( datagram( 2 ) );
+      string bytes { string_view { corrupt.payload.front() } };
+      bytes[8] ^= 1; // 改 TTL 不改校验和
+      corrupt.payload.front() = Buffer { std::move( bytes ) };
+      test.execute( ReceiveFrame { corrupt, nullopt } );
+      test.execute( checksum_failures( 1 ) );
+      test.execute( malformed( 1 ) );
+
+      auto offloaded = frame_of( datagram( 3 ) );
+      offloaded.payload = { Buffer { string { "not an IPv4 header" } } };
+      offloaded.checksum_verified = true;
+      test.execute( ReceiveFrame { offloaded, nullopt } );
+      test.execute( checksum_failures( 1 ) );
+      test.execute( malformed( 2 ) );
+    }
+
+    // 空批次
+    {
+      NetworkInterfaceTestHarness test { "empty batch", LOCAL_ETH, LOCAL_IP };
+      test.execute( ReceiveFrames { {}, {} } );
+      test.execute( frames_in( 0 ) );
+    }
+
+    // 同一批里的片段重组成一个数据报
+    {
+      const string payload( 1400, 'x' );
+      auto frames = fragments_of( payload );
+      frames.push_back( frame_of( datagram( 8 ) ) );
+
+      NetworkInterfaceConfig config;
+      config.reassemble_fragments = true;
+      NetworkInterfaceTestHarness test { "fragments in one batch", LOCAL_ETH, LOCAL_IP, config };
+      test.execute( ReceiveFrames { frames, { datagram( 7, payload ), datagram( 8 ) } } );
+      test.execute( ExpectStat { "reassembled", &InterfaceStats::reassembled, 1 } );
+    }
+
+    {
+      AsyncInterfaceTestHarness test { "AsyncNetworkInterface batch" };
+      test.execute( AsyncReceiveFrames { { frame_of( datagram( 1 ) ), frame_of( datagram( 2 ) ) } } );
+      test.execute( ExpectReceived { datagram( 1 ) } );
+      test.execute( ExpectReceived { datagram( 2 ) } );
+      test.execute( ExpectReceived { nullopt } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
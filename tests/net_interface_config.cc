@@ -0,0 +1,135 @@
+#include "arp_message.hh"
+#include "network_interface_test_harness.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+namespace {
+const EthernetAddress LOCAL_ETH { 0x02, 0, 0, 0, 0, 1 };
+const Address LOCAL_IP { "10.0.0.1" };
+
+Address host( uint8_t i )
+{
+  return Address::from_ipv4_numeric( Address { "10.0.0.0" }.ipv4_numeric() + i );
+}
+
+EthernetAddress host_eth( uint8_t i )
+{
+  return { 0x02, 0, 0, 0, 1, i };
+}
+
+InternetDatagram datagram()
+{
+  InternetDatagram dgram;
+  dgram.header.src = LOCAL_IP.ipv4_numeric();
+  dgram.header.dst = Address { "8.8.8.8" }.ipv4_numeric();
+  dgram.payload.emplace_back( "x" );
+  dgram.header.len = IPv4Header::LENGTH + 1;
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+// An ARP reply (or, with `to_us` false, a broadcast announcement) from host i
+EthernetFrame arp_from( uint8_t i, bool to_us = true )
+{
+  ARPMessage msg;
+  msg.opcode = to_us ? ARPMessage::OPCODE_REPLY : ARPMessage::OPCODE_REQUEST;
+  msg.sender_ethernet_address = host_eth( i );
+  msg.sender_ip_address = host( i ).ipv4_numeric();
+  msg.target_ethernet_address = to_us ? LOCAL_ETH : EthernetAddress {};
+  msg.target_ip_address = to_us ? LOCAL_IP.ipv4_numeric() : host( i ).ipv4_numeric();
+  return { { to_us ? LOCAL_ETH : ETHERNET_BROADCAST, host_eth( i ), EthernetHeader::TYPE_ARP }, serialize( msg ) };
+}
+
+ExpectStat arp_dropped( uint64_t n )
+{
+  return { "arp_dropped", &InterfaceStats::arp_dropped, n };
+}
+} // namespace
+
+int main()
+{
+  try {
+    // 短计时器 + 两次指数退避重试：100 ms、200 ms，再等 400 ms 后放弃
+    {
+      NetworkInterfaceConfig config;
+      config.mapping_ttl_ms = 1000;
+      config.request_retry_ms = 100;
+      config.request_retries = 2;
+      config.request_backoff = 2;
+      NetworkInterfaceTestHarness test { "ARP retries with backoff", LOCAL_ETH, LOCAL_IP, config };
+
+      test.execute( SendDatagram { datagram(), host( 2 ) } );
+      test.execute( ExpectFrameCounts { 1, 0 } );
+      test.execute( Tick { 99 } );
+      test.execute( ExpectFrameCounts { 0, 0 } ); // 100 ms 之前不重试
+      test.execute( Tick { 1 } );
+      test.execute( ExpectFrameCounts { 1, 0 } );
+      test.execute( Tick { 199 } );
+      test.execute( ExpectFrameCounts { 0, 0 } ); // 第二次等两倍
+      test.execute( Tick { 1 } );
+      test.execute( ExpectFrameCounts { 1, 0 } );
+      test.execute( Tick { 399 } );
+      test.execute( ExpectPendingDatagrams { 1 } );
+      test.execute( ExpectFrameCounts { 0, 0 } );
+      test.execute( Tick { 1 } ); // 700 ms：放弃，不再发请求
+      test.execute( ExpectPendingDatagrams { 0 } );
+      test.execute( ExpectFrameCounts { 0, 0 } );
+      test.execute( arp_dropped( 1 ) );
+      test.execute( ExpectNeighbours { 0 } );
+
+      // 重试中途收到回复：排队的数据报发出，不再重试
+      test.execute( SendDatagram { datagram(), host( 3 ) } );
+      test.execute( Tick { 100 } );
+      test.execute( ExpectFrameCounts { 2, 0 } );
+      test.execute( ReceiveFrame { arp_from( 3 ), nullopt } );
+      test.execute( ExpectFrameCounts { 0, 1 } );
+      test.execute( Tick { 1000 } );
+      test.execute( ExpectFrameCounts { 0, 0 } );
+
+      // 映射按 mapping_ttl_ms 过期
+      test.execute( ReceiveFrame { arp_from( 3 ), nullopt } );
+      test.execute( Tick { 999 } );
+      test.execute( SendDatagram { datagram(), host( 3 ) } );
+      test.execute( ExpectFrameCounts { 0, 1 } );
+      test.execute( Tick { 1 } );
+      test.execute( SendDatagram { datagram(), host( 3 ) } );
+      test.execute( ExpectFrameCounts { 1, 0 } );
+    }
+
+    // 邻居表容量：满了以后新的下一跳被拒绝，主动通告也不学
+    {
+      NetworkInterfaceConfig config;
+      config.neighbour_capacity = 2;
+      NetworkInterfaceTestHarness test { "neighbour table capacity", LOCAL_ETH, LOCAL_IP, config };
+
+      test.execute( SendDatagram { datagram(), host( 2 ) } );
+      test.execute( SendDatagram { datagram(), host( 3 ) } );
+      test.execute( SendDatagram { datagram(), host( 4 ) } );
+      test.execute( ExpectFrameCounts { 2, 0 } ); // 第三个下一跳没有 ARP 请求
+      test.execute( ExpectNeighbours { 2 } );
+      test.execute( arp_dropped( 1 ) );
+
+      test.execute( ReceiveFrame { arp_from( 5, false ), nullopt } );
+      test.execute( ExpectNeighbours { 2 } );
+      test.execute( ReceiveFrame { arp_from( 2 ), nullopt } );
+      test.execute( ExpectFrameCounts { 0, 1 } ); // 已有的下一跳照样解析
+
+      // 请求超时让出位置
+      test.execute( Tick { NetworkInterfaceConfig::REQUEST_RETRY_DFLT } );
+      test.execute( ExpectNeighbours { 1 } );
+      test.execute( SendDatagram { datagram(), host( 4 ) } );
+      test.execute( ExpectFrameCounts { 1, 0 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,258 @@
+#include "arp_message.hh"
+#include "network_interface_test_harness.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+const EthernetAddress LOCAL_ETH { 0x02, 0, 0, 0, 0, 1 };
+const Address LOCAL_IP { "10.0.0.1" };
+const EthernetAddress PEER_ETH { 0x02, 0, 0, 0, 0, 2 };
+const Address PEER_IP { "10.0.0.2" };
+const Address OTHER_IP { "10.0.0.3" };
+
+constexpr uint8_t BULK = 0x00;  // precedence 0
+constexpr uint8_t VOICE = 0xb8; // EF：precedence 5
+
+InternetDatagram datagram( uint16_t id, uint8_t tos, size_t payload_size = 100 )
+{
+  InternetDatagram dgram;
+  dgram.header.src = LOCAL_IP.ipv4_numeric();
+  dgram.header.dst = PEER_IP.ipv4_numeric();
+  dgram.header.id = id;
+  dgram.header.tos = tos;
+  dgram.header.ttl = 64;
+  dgram.payload.emplace_back( string( payload_size, 'x' ) );
+  dgram.header.len = IPv4Header::LENGTH + payload_size;
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+// The frame carrying datagram( id, tos ) to the peer
+EthernetFrame sent( uint16_t id, uint8_t tos )
+{
+  return { { PEER_ETH, LOCAL_ETH, EthernetHeader::TYPE_IPv4 }, serialize( datagram( id, tos ) ) };
+}
+
+EthernetFrame request_for_other()
+{
+  ARPMessage msg;
+  msg.opcode = ARPMessage::OPCODE_REQUEST;
+  msg.sender_ethernet_address = LOCAL_ETH;
+  msg.sender_ip_address = LOCAL_IP.ipv4_numeric();
+  msg.target_ip_address = OTHER_IP.ipv4_numeric();
+  return { { ETHERNET_BROADCAST, LOCAL_ETH, EthernetHeader::TYPE_ARP }, serialize( msg ) };
+}
+
+// An interface that already knows the peer's Ethernet address
+NetworkInterfaceTestHarness with_peer( const string& name, const NetworkInterfaceConfig& config = {} )
+{
+  NetworkInterfaceTestHarness test { name, LOCAL_ETH, LOCAL_IP, config };
+  ARPMessage reply;
+  reply.opcode = ARPMessage::OPCODE_REPLY;
+  reply.sender_ethernet_address = PEER_ETH;
+  reply.sender_ip_address = PEER_IP.ipv4_numeric();
+  reply.target_ethernet_address = LOCAL_ETH;
+  reply.target_ip_address = LOCAL_IP.ipv4_numeric();
+  test.execute( ReceiveFrame { { { LOCAL_ETH, PEER_ETH, EthernetHeader::TYPE_ARP }, serialize( reply ) }, nullopt } );
+  test.execute( ExpectNoFrame {} );
+  return test;
+}
+
+// 低优先级先到，高优先级后到，最后是一个 ARP 请求
+void send_mix( NetworkInterfaceTestHarness& test )
+{
+  test.execute( SendDatagram { datagram( 1, BULK ), PEER_IP } );
+  test.execute( SendDatagram { datagram( 2, BULK ), PEER_IP } );
+  test.execute( SendDatagram { datagram( 3, VOICE ), PEER_IP } );
+  test.execute( SendDatagram { datagram( 4, VOICE ), PEER_IP } );
+  test.execute( SendDatagram { datagram( 5, VOICE ), OTHER_IP } );
+}
+
+ExpectStat egress_dropped( uint64_t n )
+{
+  return { "egress_dropped", &InterfaceStats::egress_dropped, n };
+}
+
+// maybe_send_all() hands out exactly `expected`, in order
+struct ExpectAllFrames : public Expectation<NetworkInterface>
+{
+  vector<EthernetFrame> expected;
+
+  explicit ExpectAllFrames( vector<EthernetFrame> e ) : expected( std::move( e ) ) {}
+  string description() const override { return "maybe_send_all() gives " + to_string( expected.size() ) + " frames"; }
+  void execute( NetworkInterface& interface ) const override
+  {
+    vector<EthernetFrame> frames;
+    interface.maybe_send_all( frames );
+    if ( frames.size() != expected.size() ) {
+      throw ExpectationViolation( "number of frames sent", expected.size(), frames.size() );
+    }
+    for ( size_t i = 0; i < frames.size(); ++i ) {
+      if ( not equal( frames[i], expected[i] ) ) {
+        throw ExpectationViolation( "maybe_send_all() sent a different frame than was expected at position "
+                                    + to_string( i ) + ": actual={" + summary( frames[i] ) + "}" );
+      }
+    }
+  }
+};
+
+// Sends frames until `window` bytes have gone out, and expects BULK and VOICE to have sent about as
+// many bytes as each other (within two quanta); then sends the rest
+struct ExpectFairShare : public Expectation<NetworkInterface>
+{
+  size_t window;
+
+  explicit ExpectFairShare( size_t w ) : window( w ) {}
+  string description() const override
+  {
+    return "bulk and voice share the first " + to_string( window ) + " bytes evenly";
+  }
+  void execute( NetworkInterface& interface ) const override
+  {
+    size_t bulk_bytes = 0;
+    size_t voice_bytes = 0;
+    while ( bulk_bytes + voice_bytes < window ) {
+      auto frame = interface.maybe_send();
+      if ( not frame.has_value() ) {
+        throw ExpectationViolation( "NetworkInterface ran out of frames to send" );
+      }
+      InternetDatagram dgram;
+      if ( not parse( dgram, frame->payload ) ) {
+        throw ExpectationViolation( "NetworkInterface sent a frame that is not an IPv4 datagram" );
+      }
+      size_t bytes = EthernetHeader::LENGTH;
+      for ( const auto& buffer : frame->payload ) {
+        bytes += buffer.size();
+      }
+      ( dgram.header.tos == BULK ? bulk_bytes : voice_bytes ) += bytes;
+    }
+    auto const diff = bulk_bytes > voice_bytes ? bulk_bytes - voice_bytes : voice_bytes - bulk_bytes;
+    if ( diff > 2 * NetworkInterfaceConfig::EGRESS_QUANTUM_DFLT ) {
+      throw ExpectationViolation( "bulk sent " + to_string( bulk_bytes ) + " bytes and voice "
+                                  + to_string( voice_bytes ) + ", which is not an even share" );
+    }
+    while ( interface.maybe_send().has_value() ) {}
+  }
+};
+} // namespace
+
+int main()
+{
+  try {
+    // 默认：一个 FIFO，和原来一样按产生的顺序发
+    {
+      auto test = with_peer( "FIFO by default" );
+      send_mix( test );
+      test.execute( ExpectEgressClasses { 1 } );
+      for ( const auto& frame : { sent( 1, BULK ), sent( 2, BULK ), sent( 3, VOICE ), sent( 4, VOICE ) } ) {
+        test.execute( ExpectFrame { frame } );
+      }
+      test.execute( ExpectFrame { request_for_other() } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectStat { "frames_out", &InterfaceStats::frames_out, 5 } );
+      test.execute( egress_dropped( 0 ) );
+    }
+
+    // 严格优先级：ARP，然后高优先级，最后低优先级；同一类里保持顺序
+    {
+      NetworkInterfaceConfig config;
+      config.egress = NetworkInterfaceConfig::EgressDiscipline::Priority;
+      auto test = with_peer( "strict priority", config );
+      send_mix( test );
+      test.execute( ExpectEgressClasses { 4 } );
+      test.execute( ExpectEgressQueued { 0, 1 } );
+      test.execute( ExpectEgressQueued { 1, 2 } );
+      test.execute( ExpectEgressQueued { 2, 0 } );
+      test.execute( ExpectEgressQueued { 3, 2 } );
+      test.execute( ExpectFrame { request_for_other() } );
+      for ( const auto& frame : { sent( 3, VOICE ), sent( 4, VOICE ), sent( 1, BULK ), sent( 2, BULK ) } ) {
+        test.execute( ExpectFrame { frame } );
+      }
+      test.execute( ExpectNoFrame {} );
+      for ( size_t cls = 0; cls < 4; ++cls ) {
+        test.execute( ExpectEgressQueued { cls, 0 } );
+      }
+
+      // maybe_send_all() 也按调度顺序（ARP 请求还没超时，不再发）
+      send_mix( test );
+      test.execute(
+        ExpectAllFrames { { sent( 3, VOICE ), sent( 4, VOICE ), sent( 1, BULK ), sent( 2, BULK ) } } );
+    }
+
+    // DRR：两个忙的类按字节平分，不管帧大小
+    {
+      NetworkInterfaceConfig config;
+      config.egress = NetworkInterfaceConfig::EgressDiscipline::DeficitRoundRobin;
+      auto test = with_peer( "deficit round robin", config );
+      for ( uint16_t i = 0; i < 40; ++i ) {
+        test.execute( SendDatagram { datagram( 100 + i, BULK, 1000 ), PEER_IP } );
+        test.execute( SendDatagram { datagram( 200 + i, VOICE, 200 ), PEER_IP } );
+      }
+      test.execute( ExpectFairShare { 20000 } );
+      test.execute( ExpectStat { "frames_out", &InterfaceStats::frames_out, 80 } );
+      test.execute( egress_dropped( 0 ) );
+    }
+
+    // 每个队列的字节上限：超出的帧在队尾丢掉
+    {
+      NetworkInterfaceConfig config;
+      config.egress_queue_bytes = 2 * ( EthernetHeader::LENGTH + IPv4Header::LENGTH + 100 );
+      auto test = with_peer( "egress queue limit", config );
+      for ( uint16_t i = 1; i <= 3; ++i ) {
+        test.execute( SendDatagram { datagram( i, BULK ), PEER_IP } );
+      }
+      test.execute( egress_dropped( 1 ) );
+      test.execute( ExpectFrame { sent( 1, BULK ) } );
+      test.execute( ExpectFrame { sent( 2, BULK ) } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( SendDatagram { datagram( 4, BULK ), PEER_IP } );
+      test.execute( ExpectFrame { sent( 4, BULK ) } );
+      test.execute( ExpectNoFrame {} );
+    }
+
+    // CoDel：排队时间超过 target 持续一个 interval 之后丢队头，积压消失就停
+    {
+      NetworkInterfaceConfig config;
+      config.codel_target_ms = NetworkInterfaceConfig::CODEL_TARGET_DFLT;
+      config.codel_interval_ms = NetworkInterfaceConfig::CODEL_INTERVAL_DFLT;
+      auto test = with_peer( "CoDel", config );
+      for ( uint16_t i = 1; i <= 20; ++i ) {
+        test.execute( SendDatagram { datagram( i, BULK ), PEER_IP } );
+      }
+
+      test.execute( Tick { 200 } );
+      test.execute( ExpectFrame { sent( 1, BULK ) } ); // interval 还没过
+      test.execute( Tick { 50 } );
+      test.execute( ExpectFrame { sent( 2, BULK ) } );
+      test.execute( egress_dropped( 0 ) );
+      test.execute( Tick { 50 } );
+      test.execute( ExpectFrame { sent( 4, BULK ) } ); // 丢掉队头，发下一个
+      test.execute( egress_dropped( 1 ) );
+
+      // 下一次丢包要再过一个 interval；同一时刻取完剩下的不再丢
+      test.execute( ExpectFrameCounts { 0, 16 } );
+      test.execute( egress_dropped( 1 ) );
+
+      // 队列空了就退出丢包状态：新来的帧不排队就不丢
+      for ( uint16_t i = 21; i <= 25; ++i ) {
+        test.execute( SendDatagram { datagram( i, BULK ), PEER_IP } );
+        test.execute( Tick { 1 } );
+        test.execute( ExpectFrame { sent( i, BULK ) } );
+      }
+      test.execute( egress_dropped( 1 ) );
+      test.execute( ExpectEgressDropped { 1 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
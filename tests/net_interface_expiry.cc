@@ -0,0 +1,121 @@
+#include "arp_message.hh"
+#include "network_interface_test_harness.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+namespace {
+const EthernetAddress LOCAL_ETH { 0x02, 0, 0, 0, 0, 1 };
+const Address LOCAL_IP { "10.0.0.1" };
+
+Address neighbour( uint32_t i )
+{
+  return Address::from_ipv4_numeric( Address { "10.1.0.0" }.ipv4_numeric() + i );
+}
+
+EthernetAddress neighbour_eth( uint32_t i )
+{
+  return { 0x02, 0, 0, static_cast<uint8_t>( i >> 16 ), static_cast<uint8_t>( i >> 8 ), static_cast<uint8_t>( i ) };
+}
+
+// An ARP request from neighbour i for some other host: no reply, but the interface learns i
+EthernetFrame announcement( uint32_t i )
+{
+  ARPMessage msg;
+  msg.opcode = ARPMessage::OPCODE_REQUEST;
+  msg.sender_ethernet_address = neighbour_eth( i );
+  msg.sender_ip_address = neighbour( i ).ipv4_numeric();
+  msg.target_ip_address = Address { "10.1.255.254" }.ipv4_numeric();
+  return { { ETHERNET_BROADCAST, neighbour_eth( i ), EthernetHeader::TYPE_ARP }, serialize( msg ) };
+}
+
+InternetDatagram datagram()
+{
+  InternetDatagram dgram;
+  dgram.header.src = LOCAL_IP.ipv4_numeric();
+  dgram.header.dst = Address { "8.8.8.8" }.ipv4_numeric();
+  dgram.payload.emplace_back( "x" );
+  dgram.header.len = IPv4Header::LENGTH + 1;
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+// What sending to neighbour i should put on the wire: the datagram, or an ARP request for i
+EthernetFrame datagram_to( uint32_t i )
+{
+  return { { neighbour_eth( i ), LOCAL_ETH, EthernetHeader::TYPE_IPv4 }, serialize( datagram() ) };
+}
+
+EthernetFrame request_for( uint32_t i )
+{
+  ARPMessage msg;
+  msg.opcode = ARPMessage::OPCODE_REQUEST;
+  msg.sender_ethernet_address = LOCAL_ETH;
+  msg.sender_ip_address = LOCAL_IP.ipv4_numeric();
+  msg.target_ip_address = neighbour( i ).ipv4_numeric();
+  return { { ETHERNET_BROADCAST, LOCAL_ETH, EthernetHeader::TYPE_ARP }, serialize( msg ) };
+}
+
+// Send to neighbour i and expect exactly `frame` to come out (or nothing)
+void send( NetworkInterfaceTestHarness& test, uint32_t i, const optional<EthernetFrame>& frame )
+{
+  test.execute( SendDatagram { datagram(), neighbour( i ) } );
+  if ( frame.has_value() ) {
+    test.execute( ExpectFrame { *frame } );
+  }
+  test.execute( ExpectNoFrame {} );
+}
+} // namespace
+
+int main()
+{
+  try {
+    // 邻居 i 在第 i*10 ms 学到，应恰好在第 i*10 + 30000 ms 过期
+    {
+      constexpr uint32_t NEIGHBOURS = 2000;
+      NetworkInterfaceTestHarness test { "mappings expire at absolute times", LOCAL_ETH, LOCAL_IP };
+      for ( uint32_t i = 0; i < NEIGHBOURS; ++i ) {
+        test.execute( ReceiveFrame { announcement( i ), nullopt } );
+        test.execute( Tick { 10 } );
+      }
+      test.execute( ExpectNoFrame {} ); // 别人的 ARP 请求不回复
+
+      // 现在是 20000 ms；再走 10000 ms，邻居 0 刚好过期
+      test.execute( Tick { 10000 } );
+      send( test, 0, request_for( 0 ) );
+      send( test, 1, datagram_to( 1 ) );
+
+      // 一次走很远：一大批邻居同时过期
+      test.execute( Tick { 10000 - 1 } );
+      send( test, 999, request_for( 999 ) );
+      send( test, 1000, datagram_to( 1000 ) );
+      test.execute( Tick { 1 } );
+      send( test, 1000, request_for( 1000 ) );
+      send( test, NEIGHBOURS - 1, datagram_to( NEIGHBOURS - 1 ) );
+
+      test.execute( Tick { 100000 } );
+      send( test, NEIGHBOURS - 1, request_for( NEIGHBOURS - 1 ) );
+    }
+
+    // ARP 请求的 5 秒抑制期也按绝对时间到期
+    {
+      NetworkInterfaceTestHarness test { "pending requests expire at absolute times", LOCAL_ETH, LOCAL_IP };
+      test.execute( Tick { 12345 } );
+      send( test, 7, request_for( 7 ) );
+      test.execute( Tick { 4999 } );
+      send( test, 7, nullopt );
+      test.execute( Tick { 1 } );
+      send( test, 7, request_for( 7 ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,237 @@
+#include "arp_message.hh"
+#include "network_interface_test_harness.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+const EthernetAddress LOCAL_ETH { 0x02, 0, 0, 0, 0, 1 };
+const Address LOCAL_IP { "10.0.0.1" };
+const EthernetAddress PEER_ETH { 0x02, 0, 0, 0, 0, 2 };
+const Address PEER_IP { "10.0.0.2" };
+
+constexpr size_t MTU = 576;
+constexpr size_t CHUNK = 552; // 576 - 20，取 8 的倍数
+
+string pattern( size_t n )
+{
+  string out;
+  for ( size_t i = 0; i < n; ++i ) {
+    out.push_back( static_cast<char>( 'a' + i % 26 ) );
+  }
+  return out;
+}
+
+// A datagram from the peer to us with `payload`, split across two Buffers
+InternetDatagram datagram( const string& payload, bool df = false, uint16_t id = 7 )
+{
+  InternetDatagram dgram;
+  dgram.header.src = PEER_IP.ipv4_numeric();
+  dgram.header.dst = LOCAL_IP.ipv4_numeric();
+  dgram.header.id = id;
+  dgram.header.df = df;
+  dgram.payload.emplace_back( payload.substr( 0, payload.size() / 3 ) );
+  dgram.payload.emplace_back( payload.substr( payload.size() / 3 ) );
+  dgram.header.len = IPv4Header::LENGTH + payload.size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+// The fragment of datagram( payload, false, id ) carrying `size` bytes from `offset`
+InternetDatagram piece( const string& payload, uint16_t id, size_t offset, size_t size )
+{
+  InternetDatagram fragment = datagram( payload, false, id );
+  fragment.header.offset = offset / 8;
+  fragment.header.mf = offset + size < payload.size();
+  fragment.header.len = IPv4Header::LENGTH + size;
+  fragment.header.compute_checksum();
+  fragment.payload = { Buffer { payload.substr( offset, size ) } };
+  return fragment;
+}
+
+// The fragments an interface with a 576-byte MTU sends for datagram( payload, false, id )
+vector<InternetDatagram> pieces( const string& payload, uint16_t id = 7 )
+{
+  vector<InternetDatagram> out;
+  for ( size_t offset = 0; offset < payload.size(); offset += CHUNK ) {
+    out.push_back( piece( payload, id, offset, min( CHUNK, payload.size() - offset ) ) );
+  }
+  return out;
+}
+
+EthernetFrame arp_reply_from_peer()
+{
+  ARPMessage msg;
+  msg.opcode = ARPMessage::OPCODE_REPLY;
+  msg.sender_ethernet_address = PEER_ETH;
+  msg.sender_ip_address = PEER_IP.ipv4_numeric();
+  msg.target_ethernet_address = LOCAL_ETH;
+  msg.target_ip_address = LOCAL_IP.ipv4_numeric();
+  return { { LOCAL_ETH, PEER_ETH, EthernetHeader::TYPE_ARP }, serialize( msg ) };
+}
+
+// `dgram` arriving from the peer, and `dgram` sent to it
+EthernetFrame frame_of( const InternetDatagram& dgram )
+{
+  return { { LOCAL_ETH, PEER_ETH, EthernetHeader::TYPE_IPv4 }, serialize( dgram ) };
+}
+
+EthernetFrame frame_to_peer( const InternetDatagram& dgram )
+{
+  return { { PEER_ETH, LOCAL_ETH, EthernetHeader::TYPE_IPv4 }, serialize( dgram ) };
+}
+
+// An interface with a 576-byte MTU that already knows the peer
+NetworkInterfaceTestHarness sender( const string& name )
+{
+  NetworkInterfaceConfig config;
+  config.mtu = MTU;
+  NetworkInterfaceTestHarness test { name, LOCAL_ETH, LOCAL_IP, config };
+  test.execute( ReceiveFrame { arp_reply_from_peer(), nullopt } );
+  return test;
+}
+
+NetworkInterfaceTestHarness receiver( const string& name, const NetworkInterfaceConfig& base = {} )
+{
+  NetworkInterfaceConfig config = base;
+  config.reassemble_fragments = true;
+  return { name, LOCAL_ETH, LOCAL_IP, config };
+}
+
+ExpectStat fragments_dropped( uint64_t n )
+{
+  return { "fragments_dropped", &InterfaceStats::fragments_dropped, n };
+}
+} // namespace
+
+int main()
+{
+  try {
+    const string payload = pattern( 1400 );
+
+    // 576 字节的 MTU：每片 552 字节负载（放得下的 8 的倍数），最后一片带剩下的；
+    // 偏移、MF、ID 和校验和都按片重新算
+    {
+      auto test = sender( "fragments fit the MTU" );
+      test.execute( SendDatagram { datagram( payload ), PEER_IP } );
+      test.execute( ExpectFrame { frame_to_peer( piece( payload, 7, 0, 552 ) ) } );
+      test.execute( ExpectFrame { frame_to_peer( piece( payload, 7, 552, 552 ) ) } );
+      test.execute( ExpectFrame { frame_to_peer( piece( payload, 7, 1104, 296 ) ) } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectStat { "fragments_out", &InterfaceStats::fragments_out, 3 } );
+    }
+
+    // 放得下的数据报不分片
+    {
+      auto test = sender( "small datagram is not fragmented" );
+      test.execute( SendDatagram { datagram( pattern( 100 ) ), PEER_IP } );
+      test.execute( ExpectFrame { frame_to_peer( datagram( pattern( 100 ) ) ) } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectStat { "fragments_out", &InterfaceStats::fragments_out, 0 } );
+    }
+
+    // 带 DF 的大数据报只能丢掉
+    {
+      auto test = sender( "DF datagram is dropped" );
+      test.execute( SendDatagram { datagram( payload, true ), PEER_IP } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectStat { "frag_needed", &InterfaceStats::frag_needed, 1 } );
+    }
+
+    // 乱序、重复的片段拼回原来的数据报（比较的是序列化的结果，校验和也要对）
+    {
+      const auto frags = pieces( payload );
+      auto test = receiver( "out-of-order and duplicate fragments" );
+      test.execute( ReceiveFrame { frame_of( frags[2] ), nullopt } );
+      test.execute( ReceiveFrame { frame_of( frags[0] ), nullopt } );
+      test.execute( ReceiveFrame { frame_of( frags[0] ), nullopt } );
+      test.execute( ExpectReassemblyDatagrams { 1 } );
+      test.execute( ReceiveFrame { frame_of( frags[1] ), datagram( payload ) } );
+      test.execute( ExpectReassemblyDatagrams { 0 } );
+      test.execute( ExpectReassemblyBytes { 0 } );
+      test.execute( ExpectStat { "reassembled", &InterfaceStats::reassembled, 1 } );
+    }
+
+    // 两个 ID 不同的数据报交错到达
+    {
+      const auto first = pieces( payload, 1 );
+      const auto second = pieces( pattern( 700 ), 2 );
+      auto test = receiver( "interleaved datagrams" );
+      test.execute( ReceiveFrame { frame_of( first[0] ), nullopt } );
+      test.execute( ReceiveFrame { frame_of( second[1] ), nullopt } );
+      test.execute( ReceiveFrame { frame_of( first[1] ), nullopt } );
+      test.execute( ReceiveFrame { frame_of( second[0] ), datagram( pattern( 700 ), false, 2 ) } );
+      test.execute( ReceiveFrame { frame_of( first[2] ), datagram( payload, false, 1 ) } );
+    }
+
+    // 不要求重组的接口把片段原样交上去
+    {
+      const auto frags = pieces( payload );
+      NetworkInterfaceTestHarness test { "fragments passed up without reassembly", LOCAL_ETH, LOCAL_IP };
+      test.execute( ReceiveFrame { frame_of( frags[1] ), frags[1] } );
+    }
+
+    // 超时：没到齐的片段被丢掉
+    {
+      NetworkInterfaceConfig config;
+      config.reassembly_timeout_ms = 1000;
+      const auto frags = pieces( payload );
+      auto test = receiver( "reassembly timeout", config );
+      test.execute( ReceiveFrame { frame_of( frags[0] ), nullopt } );
+      test.execute( ReceiveFrame { frame_of( frags[1] ), nullopt } );
+      test.execute( Tick { 999 } );
+      test.execute( ExpectReassemblyDatagrams { 1 } );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectReassemblyDatagrams { 0 } );
+      test.execute( ExpectReassemblyBytes { 0 } );
+      test.execute( fragments_dropped( 2 ) );
+      test.execute( ReceiveFrame { frame_of( frags[2] ), nullopt } ); // 迟到的片段重新开始
+      test.execute( ExpectReassemblyDatagrams { 1 } );
+    }
+
+    // 内存上限：单个数据报和全部的
+    {
+      NetworkInterfaceConfig config;
+      config.reassembly_bytes_per_datagram = 1000;
+      const auto frags = pieces( payload );
+      auto test = receiver( "per-datagram reassembly limit", config );
+      test.execute( ReceiveFrame { frame_of( frags[0] ), nullopt } );
+      test.execute( ReceiveFrame { frame_of( frags[1] ), nullopt } );
+      test.execute( ExpectReassemblyBytes { 552 } );
+      test.execute( fragments_dropped( 1 ) );
+    }
+    {
+      NetworkInterfaceConfig config;
+      config.reassembly_bytes_total = 1200;
+      auto test = receiver( "total reassembly limit", config );
+      for ( uint16_t id = 1; id <= 3; ++id ) {
+        test.execute( ReceiveFrame { frame_of( pieces( payload, id )[0] ), nullopt } );
+      }
+      test.execute( ExpectReassemblyDatagrams { 2 } );
+      test.execute( ExpectReassemblyBytes { 1104 } );
+    }
+
+    // 畸形片段：MF 置位但长度不是 8 的倍数
+    {
+      auto bad = datagram( pattern( 13 ) );
+      bad.header.mf = true;
+      bad.header.compute_checksum();
+      auto test = receiver( "malformed fragment" );
+      test.execute( ReceiveFrame { frame_of( bad ), nullopt } );
+      test.execute( fragments_dropped( 1 ) );
+      test.execute( ExpectReassemblyDatagrams { 0 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
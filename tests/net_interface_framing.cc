@@ -0,0 +1,124 @@
+#include "arp_message.hh"
+#include "network_interface_test_harness.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+const EthernetAddress LOCAL_ETH { 0x02, 0, 0, 0, 0, 1 };
+const Address LOCAL_IP { "10.0.0.1" };
+const Address NEIGHBOUR { "10.0.0.2" };
+
+InternetDatagram datagram( const string& payload )
+{
+  InternetDatagram dgram;
+  dgram.header.src = LOCAL_IP.ipv4_numeric();
+  dgram.header.dst = Address { "8.8.8.8" }.ipv4_numeric();
+  dgram.payload.emplace_back( payload );
+  dgram.header.len = IPv4Header::LENGTH + payload.size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+EthernetFrame reply( const EthernetAddress& sender )
+{
+  ARPMessage msg;
+  msg.opcode = ARPMessage::OPCODE_REPLY;
+  msg.sender_ethernet_address = sender;
+  msg.sender_ip_address = NEIGHBOUR.ipv4_numeric();
+  msg.target_ethernet_address = LOCAL_ETH;
+  msg.target_ip_address = LOCAL_IP.ipv4_numeric();
+  return { { LOCAL_ETH, sender, EthernetHeader::TYPE_ARP }, serialize( msg ) };
+}
+
+EthernetFrame request()
+{
+  ARPMessage msg;
+  msg.opcode = ARPMessage::OPCODE_REQUEST;
+  msg.sender_ethernet_address = LOCAL_ETH;
+  msg.sender_ip_address = LOCAL_IP.ipv4_numeric();
+  msg.target_ip_address = NEIGHBOUR.ipv4_numeric();
+  return { { ETHERNET_BROADCAST, LOCAL_ETH, EthernetHeader::TYPE_ARP }, serialize( msg ) };
+}
+
+// The frame carrying datagram( payload ) to `dst`, built field by field (no pre-serialized header)
+EthernetFrame frame_to( const EthernetAddress& dst, const string& payload )
+{
+  return { { dst, LOCAL_ETH, EthernetHeader::TYPE_IPv4 }, serialize( datagram( payload ) ) };
+}
+
+// The next frames are exactly `expected` (so each cached header serializes like the fields), and all of them
+// carry one shared pre-serialized header as their first Buffer
+struct ExpectSharedHeader : public Expectation<NetworkInterface>
+{
+  vector<EthernetFrame> expected;
+
+  explicit ExpectSharedHeader( vector<EthernetFrame> e ) : expected( std::move( e ) ) {}
+  string description() const override
+  {
+    return to_string( expected.size() ) + " frames transmitted with one shared header";
+  }
+  void execute( NetworkInterface& interface ) const override
+  {
+    optional<const char*> shared;
+    for ( const auto& want : expected ) {
+      auto frame = interface.maybe_send();
+      if ( not frame.has_value() ) {
+        throw ExpectationViolation( "NetworkInterface did not send an expected frame (" + summary( want ) + ")" );
+      }
+      if ( not equal( frame.value(), want ) ) {
+        throw ExpectationViolation( "NetworkInterface sent a different frame than was expected: actual={"
+                                    + summary( frame.value() ) + "}" );
+      }
+      if ( not frame->serialized_header.has_value() ) {
+        throw ExpectationViolation( "IPv4 frame should carry the neighbour's serialized header" );
+      }
+      if ( serialize( frame.value() ).front().size() != EthernetHeader::LENGTH ) {
+        throw ExpectationViolation( "the serialized header should be the frame's first Buffer" );
+      }
+      const char* data = string_view { *frame->serialized_header }.data();
+      if ( shared.has_value() and *shared != data ) {
+        throw ExpectationViolation( "frames to the same neighbour should share one header Buffer" );
+      }
+      shared = data;
+    }
+  }
+};
+} // namespace
+
+int main()
+{
+  try {
+    const EthernetAddress first_eth { 0x02, 0, 0, 0, 0, 2 };
+    const EthernetAddress second_eth { 0x02, 0, 0, 0, 0, 3 };
+    NetworkInterfaceTestHarness test { "frames carry a pre-serialized header", LOCAL_ETH, LOCAL_IP };
+
+    // 排队的数据报在学到映射时发出，之后的直接发出：都带着同一个序列化好的头
+    test.execute( SendDatagram { datagram( "queued" ), NEIGHBOUR } );
+    test.execute( ExpectFrame { request() } );
+    test.execute( ReceiveFrame { reply( first_eth ), nullopt } );
+    test.execute( SendDatagram { datagram( "direct" ), NEIGHBOUR } );
+    test.execute( ExpectSharedHeader { { frame_to( first_eth, "queued" ), frame_to( first_eth, "direct" ) } } );
+    test.execute( ExpectNoFrame {} );
+
+    // 映射过期后从新地址重新学到，头也跟着换
+    test.execute( Tick { 30000 } );
+    test.execute( SendDatagram { datagram( "again" ), NEIGHBOUR } );
+    test.execute( ExpectFrame { request() } );
+    test.execute( ReceiveFrame { reply( second_eth ), nullopt } );
+    test.execute( ExpectSharedHeader { { frame_to( second_eth, "again" ) } } );
+    test.execute( ExpectNoFrame {} );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
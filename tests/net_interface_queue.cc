@@ -0,0 +1,115 @@
+#include "arp_message.hh"
+#include "network_interface_test_harness.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+namespace {
+const EthernetAddress LOCAL_ETH { 0x02, 0, 0, 0, 0, 1 };
+const Address LOCAL_IP { "10.0.0.1" };
+const Address A { "10.0.0.2" }, B { "10.0.0.3" }, C { "10.0.0.4" };
+const EthernetAddress A_ETH { 0x02, 0, 0, 0, 0, 2 };
+constexpr size_t DGRAM_SIZE = IPv4Header::LENGTH + 1;
+
+InternetDatagram datagram()
+{
+  InternetDatagram dgram;
+  dgram.header.src = LOCAL_IP.ipv4_numeric();
+  dgram.header.dst = Address { "8.8.8.8" }.ipv4_numeric();
+  dgram.payload.emplace_back( "x" );
+  dgram.header.len = DGRAM_SIZE;
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+EthernetFrame reply_from_a()
+{
+  ARPMessage msg;
+  msg.opcode = ARPMessage::OPCODE_REPLY;
+  msg.sender_ethernet_address = A_ETH;
+  msg.sender_ip_address = A.ipv4_numeric();
+  msg.target_ethernet_address = LOCAL_ETH;
+  msg.target_ip_address = LOCAL_IP.ipv4_numeric();
+  return { { LOCAL_ETH, A_ETH, EthernetHeader::TYPE_ARP }, serialize( msg ) };
+}
+
+ExpectStat arp_dropped( uint64_t n )
+{
+  return { "arp_dropped", &InterfaceStats::arp_dropped, n };
+}
+} // namespace
+
+int main()
+{
+  try {
+    // 每个邻居最多排两个，全部加起来最多四个
+    NetworkInterfaceConfig config;
+    config.pending_bytes_per_neighbour = 2 * DGRAM_SIZE + 1;
+    config.pending_bytes_total = 4 * DGRAM_SIZE + 1;
+    NetworkInterfaceTestHarness test { "bounded ARP queues", LOCAL_ETH, LOCAL_IP, config };
+
+    for ( int i = 0; i < 3; ++i ) {
+      test.execute( SendDatagram { datagram(), A } );
+      test.execute( SendDatagram { datagram(), B } );
+    }
+    test.execute( SendDatagram { datagram(), C } );
+    test.execute( ExpectFrameCounts { 3, 0 } ); // 每个下一跳一个 ARP 请求
+    test.execute( ExpectStat { "frames_out", &InterfaceStats::frames_out, 3 } );
+
+    test.execute( ExpectPendingDatagrams { 4 } );
+    test.execute( ExpectPendingBytes { 4 * DGRAM_SIZE } );
+    test.execute( ExpectPendingBytes { A, 2 * DGRAM_SIZE } );
+    test.execute( ExpectPendingBytes { C, 0 } ); // 超过了全部的上限
+    test.execute( ExpectStat { "arp_pending", &InterfaceStats::arp_pending, 4 } );
+    test.execute( ExpectStat { "arp_pending_bytes", &InterfaceStats::arp_pending_bytes, 4 * DGRAM_SIZE } );
+    test.execute( arp_dropped( 3 ) );
+
+    // A 回复：它的两个数据报发出，空出的额度 C 可以用
+    test.execute( Tick { 1000 } );
+    test.execute( ReceiveFrame { reply_from_a(), nullopt } );
+    test.execute( ExpectFrameCounts { 0, 2 } );
+    test.execute( ExpectStat { "frames_out", &InterfaceStats::frames_out, 5 } );
+    test.execute( ExpectPendingDatagrams { 2 } );
+    test.execute( ExpectPendingBytes { A, 0 } );
+    test.execute( SendDatagram { datagram(), C } );
+    test.execute( ExpectPendingBytes { C, DGRAM_SIZE } );
+    test.execute( ExpectFrameCounts { 0, 0 } ); // C 的 ARP 请求还没超时
+
+    // B 和 C 的请求在 5 秒时超时，排队的数据报一起释放
+    test.execute( Tick { 3999 } );
+    test.execute( ExpectPendingDatagrams { 3 } );
+    test.execute( Tick { 1 } );
+    test.execute( ExpectPendingDatagrams { 0 } );
+    test.execute( ExpectPendingBytes { 0 } );
+    test.execute( ExpectStat { "arp_pending", &InterfaceStats::arp_pending, 0 } );
+    test.execute( ExpectStat { "arp_pending_bytes", &InterfaceStats::arp_pending_bytes, 0 } );
+    test.execute( arp_dropped( 6 ) );
+
+    // 超时后再发会重新请求，重新排队
+    test.execute( SendDatagram { datagram(), B } );
+    test.execute( ExpectFrameCounts { 1, 0 } );
+    test.execute( ExpectPendingBytes { B, DGRAM_SIZE } );
+
+    // 从 B 自己的 ARP 请求里学到映射，也会把排队的数据报一次发出（还有给 B 的回复）
+    ARPMessage request;
+    request.opcode = ARPMessage::OPCODE_REQUEST;
+    request.sender_ethernet_address = { 0x02, 0, 0, 0, 0, 3 };
+    request.sender_ip_address = B.ipv4_numeric();
+    request.target_ip_address = LOCAL_IP.ipv4_numeric();
+    test.execute( ReceiveFrame {
+      { { ETHERNET_BROADCAST, request.sender_ethernet_address, EthernetHeader::TYPE_ARP }, serialize( request ) },
+      nullopt } );
+    test.execute( ExpectFrameCounts { 1, 1 } );
+    test.execute( ExpectPendingDatagrams { 0 } );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+#include "arp_message.hh"
+#include "network_interface_test_harness.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+namespace {
+const EthernetAddress LOCAL_ETH { 0x02, 0, 0, 0, 0, 1 };
+const Address LOCAL_IP { "10.0.0.1" };
+const Address NEIGHBOUR { "10.0.0.2" };
+const EthernetAddress NEIGHBOUR_ETH { 0x02, 0, 0, 0, 0, 2 };
+const NetworkInterfaceConfig REFRESH = [] {
+  NetworkInterfaceConfig config;
+  config.proactive_refresh = true;
+  return config;
+}();
+
+InternetDatagram datagram()
+{
+  InternetDatagram dgram;
+  dgram.header.src = LOCAL_IP.ipv4_numeric();
+  dgram.header.dst = Address { "8.8.8.8" }.ipv4_numeric();
+  dgram.payload.emplace_back( "x" );
+  dgram.header.len = IPv4Header::LENGTH + 1;
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+EthernetFrame arp( uint16_t opcode,
+                   const EthernetAddress& dst,
+                   const EthernetAddress& sender_eth,
+                   const Address& sender_ip,
+                   const Address& target_ip,
+                   const EthernetAddress& target_eth = {} )
+{
+  ARPMessage msg;
+  msg.opcode = opcode;
+  msg.sender_ethernet_address = sender_eth;
+  msg.sender_ip_address = sender_ip.ipv4_numeric();
+  msg.target_ethernet_address = target_eth;
+  msg.target_ip_address = target_ip.ipv4_numeric();
+  return { { dst, sender_eth, EthernetHeader::TYPE_ARP }, serialize( msg ) };
+}
+
+EthernetFrame reply( const EthernetAddress& sender_eth = NEIGHBOUR_ETH )
+{
+  return arp( ARPMessage::OPCODE_REPLY, LOCAL_ETH, sender_eth, NEIGHBOUR, LOCAL_IP, LOCAL_ETH );
+}
+
+// What we put on the wire: a broadcast request, a unicast refresh probe, or the datagram itself
+EthernetFrame request_for( const Address& target )
+{
+  return arp( ARPMessage::OPCODE_REQUEST, ETHERNET_BROADCAST, LOCAL_ETH, LOCAL_IP, target );
+}
+
+EthernetFrame probe()
+{
+  return arp( ARPMessage::OPCODE_REQUEST, NEIGHBOUR_ETH, LOCAL_ETH, LOCAL_IP, NEIGHBOUR, NEIGHBOUR_ETH );
+}
+
+EthernetFrame datagram_to( const EthernetAddress& dst )
+{
+  return { { dst, LOCAL_ETH, EthernetHeader::TYPE_IPv4 }, serialize( datagram() ) };
+}
+
+// Send one datagram to the neighbour and expect exactly `frame` to come out
+void send( NetworkInterfaceTestHarness& test, const EthernetFrame& frame )
+{
+  test.execute( SendDatagram { datagram(), NEIGHBOUR } );
+  test.execute( ExpectFrame { frame } );
+  test.execute( ExpectNoFrame {} );
+}
+
+// An interface that has resolved NEIGHBOUR at time 0
+NetworkInterfaceTestHarness resolved( const string& name, const NetworkInterfaceConfig& config = REFRESH )
+{
+  NetworkInterfaceTestHarness test { name, LOCAL_ETH, LOCAL_IP, config };
+  send( test, request_for( NEIGHBOUR ) );
+  test.execute( ReceiveFrame { reply(), nullopt } );
+  test.execute( ExpectFrame { datagram_to( NEIGHBOUR_ETH ) } );
+  test.execute( ExpectNoFrame {} );
+  return test;
+}
+} // namespace
+
+int main()
+{
+  try {
+    // 用过的映射在过期前 5 秒单播确认，确认期间和之后都不用等 ARP
+    {
+      auto test = resolved( "used mapping is refreshed" );
+      test.execute( Tick { 1000 } );
+      send( test, datagram_to( NEIGHBOUR_ETH ) );
+
+      test.execute( Tick { 24000 - 1 } );
+      test.execute( ExpectNoFrame {} ); // 25 秒之前不刷新
+      test.execute( Tick { 1 } );
+      test.execute( ExpectFrame { probe() } );
+      send( test, datagram_to( NEIGHBOUR_ETH ) ); // 确认期间照常用
+
+      test.execute( Tick { 1000 } );
+      test.execute( ReceiveFrame { reply(), nullopt } ); // 26 s：续期到 56 s
+      test.execute( Tick { 10000 } );
+      send( test, datagram_to( NEIGHBOUR_ETH ) );
+    }
+
+    // 没用过的映射不刷新，照常在 30 秒过期
+    {
+      auto test = resolved( "idle mapping is not refreshed" );
+      test.execute( Tick { 29999 } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( Tick { 1 } );
+      send( test, request_for( NEIGHBOUR ) );
+    }
+
+    // 刷新没有回应：映射照旧在 30 秒过期
+    {
+      auto test = resolved( "unanswered refresh" );
+      send( test, datagram_to( NEIGHBOUR_ETH ) );
+      test.execute( Tick { 25000 } );
+      test.execute( ExpectFrame { probe() } );
+      test.execute( Tick { 5000 } );
+      send( test, request_for( NEIGHBOUR ) );
+    }
+
+    // 默认不刷新
+    {
+      auto test = resolved( "refresh is off by default", {} );
+      send( test, datagram_to( NEIGHBOUR_ETH ) );
+      test.execute( Tick { 29999 } );
+      test.execute( ExpectNoFrame {} );
+    }
+
+    // 免费 ARP：发出的是广播请求，发送方和目标都是自己；收到的会更新邻居的映射
+    {
+      NetworkInterfaceTestHarness test { "gratuitous ARP", LOCAL_ETH, LOCAL_IP };
+      test.execute( SendGratuitousARP {} );
+      test.execute( ExpectFrame { request_for( LOCAL_IP ) } );
+      test.execute( ExpectNoFrame {} );
+
+      test.execute( ReceiveFrame {
+        arp( ARPMessage::OPCODE_REQUEST, ETHERNET_BROADCAST, NEIGHBOUR_ETH, NEIGHBOUR, NEIGHBOUR ), nullopt } );
+      test.execute( ExpectNoFrame {} ); // 不回复
+      send( test, datagram_to( NEIGHBOUR_ETH ) );
+
+      const EthernetAddress moved { 0x02, 0, 0, 0, 0, 9 };
+      test.execute(
+        ReceiveFrame { arp( ARPMessage::OPCODE_REPLY, ETHERNET_BROADCAST, moved, NEIGHBOUR, NEIGHBOUR ), nullopt } );
+      send( test, datagram_to( moved ) );
+
+      // 别人用我们的 IP 发免费 ARP：不当成邻居
+      test.execute(
+        ReceiveFrame { arp( ARPMessage::OPCODE_REQUEST, ETHERNET_BROADCAST, moved, LOCAL_IP, LOCAL_IP ), nullopt } );
+      test.execute( ExpectFrame { arp( ARPMessage::OPCODE_REPLY, moved, LOCAL_ETH, LOCAL_IP, LOCAL_IP, moved ) } );
+      test.execute( SendDatagram { datagram(), LOCAL_IP } );
+      test.execute( ExpectFrame { request_for( LOCAL_IP ) } );
+      test.execute( ExpectNoFrame {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
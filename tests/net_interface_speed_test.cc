@@ -0,0 +1,71 @@
+#include "arp_message.hh"
+#include "network_interface.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+EthernetFrame announcement( uint32_t ip, const EthernetAddress& eth )
+{
+  ARPMessage msg;
+  msg.opcode = ARPMessage::OPCODE_REQUEST;
+  msg.sender_ethernet_address = eth;
+  msg.sender_ip_address = ip;
+  msg.target_ip_address = Address { "10.255.255.254" }.ipv4_numeric();
+  return { { ETHERNET_BROADCAST, eth, EthernetHeader::TYPE_ARP }, serialize( msg ) };
+}
+
+// An interface that knows `neighbours` hosts, ticked once a millisecond while none of them is due
+void tick_speed_test( const uint32_t neighbours, const size_t ticks )
+{
+  NetworkInterface iface { { 0x02, 0, 0, 0, 0, 1 }, Address { "10.0.0.1" } };
+  for ( uint32_t i = 0; i < neighbours; ++i ) {
+    iface.recv_frame( announcement( Address { "10.1.0.0" }.ipv4_numeric() + i,
+                                    { 0x02, 0, 0, static_cast<uint8_t>( i >> 16 ), static_cast<uint8_t>( i >> 8 ),
+                                      static_cast<uint8_t>( i ) } ) );
+  }
+
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < ticks; ++i ) {
+    iface.tick( 1 );
+  }
+  const auto stop_time = steady_clock::now();
+
+  auto const ns_per_tick = duration_cast<duration<double, nano>>( stop_time - start_time ).count()
+                           / static_cast<double>( ticks );
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "NetworkInterface::tick with " << neighbours << " neighbours took " << fixed << setprecision( 1 )
+       << ns_per_tick << " ns.\n";
+  debug_output << "   NetworkInterface::tick (" << neighbours << " neighbours): " << fixed << setprecision( 1 )
+               << ns_per_tick << " ns\n";
+
+  // 什么都没到期时，tick 的开销不应该随邻居数量增长
+  if ( ns_per_tick > 1000 ) {
+    throw runtime_error( "NetworkInterface::tick took more than 1 us with nothing expiring." );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    tick_speed_test( 100, 20000 );
+    tick_speed_test( 100000, 20000 );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
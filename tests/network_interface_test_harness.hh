@@ -1,8 +1,11 @@
 #pragma once
 
 #include <compare>
+#include <cstdint>
 #include <optional>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "arp_message.hh"
 #include "common.hh"
@@ -13,10 +16,11 @@ class NetworkInterfaceTestHarness : public TestHarness<NetworkInterface>
 public:
   NetworkInterfaceTestHarness( std::string test_name,
                                const EthernetAddress& ethernet_address,
-                               const Address& ip_address )
+                               const Address& ip_address,
+                               const NetworkInterfaceConfig& config = {} )
     : TestHarness( move( test_name ),
                    "eth=" + to_string( ethernet_address ) + ", ip=" + ip_address.ip(),
-                   NetworkInterface { ethernet_address, ip_address } )
+                   NetworkInterface { ethernet_address, ip_address, config } )
   {}
 };
 
@@ -93,6 +97,50 @@ struct ReceiveFrame : public Action<NetworkInterface>
   {}
 };
 
+// recv_frames() on a batch: the datagrams must be appended (after whatever `datagrams` already held), in order
+struct ReceiveFrames : public Action<NetworkInterface>
+{
+  std::vector<EthernetFrame> frames;
+  std::vector<InternetDatagram> expected;
+
+  std::string description() const override
+  {
+    return "batch of " + to_string( frames.size() ) + " frames arrives, " + to_string( expected.size() )
+           + " datagrams expected";
+  }
+  void execute( NetworkInterface& interface ) const override
+  {
+    std::vector<InternetDatagram> result( 1 ); // 已有的内容要留在前面
+    const size_t appended = interface.recv_frames( frames, result );
+
+    if ( appended != expected.size() or result.size() != expected.size() + 1 ) {
+      throw ExpectationViolation( "NetworkInterface::recv_frames() appended " + to_string( result.size() - 1 )
+                                  + " datagrams and returned " + to_string( appended ) + ", but "
+                                  + to_string( expected.size() ) + " were expected" );
+    }
+    if ( not equal( result.front(), InternetDatagram {} ) ) {
+      throw ExpectationViolation( "NetworkInterface::recv_frames() changed what the vector already held" );
+    }
+    for ( size_t i = 0; i < expected.size(); ++i ) {
+      if ( not equal( result[i + 1], expected[i] ) ) {
+        throw ExpectationViolation( "NetworkInterface::recv_frames() produced a different Internet datagram than "
+                                    "was expected at position "
+                                    + to_string( i ) + ": actual={" + result[i + 1].header.to_string() + "}" );
+      }
+    }
+  }
+
+  ReceiveFrames( std::vector<EthernetFrame> f, std::vector<InternetDatagram> e )
+    : frames( std::move( f ) ), expected( std::move( e ) )
+  {}
+};
+
+struct SendGratuitousARP : public Action<NetworkInterface>
+{
+  std::string description() const override { return "send gratuitous ARP"; }
+  void execute( NetworkInterface& interface ) const override { interface.send_gratuitous_arp(); }
+};
+
 struct ExpectFrame : public Expectation<NetworkInterface>
 {
   EthernetFrame expected;
@@ -125,6 +173,123 @@ struct ExpectNoFrame : public Expectation<NetworkInterface>
   }
 };
 
+// Takes every frame waiting (with maybe_send_all()) and counts them by type
+struct ExpectFrameCounts : public Expectation<NetworkInterface>
+{
+  size_t arp;
+  size_t ipv4;
+
+  std::string description() const override
+  {
+    return to_string( arp ) + " ARP and " + to_string( ipv4 ) + " IPv4 frames transmitted";
+  }
+  void execute( NetworkInterface& interface ) const override
+  {
+    std::vector<EthernetFrame> frames;
+    interface.maybe_send_all( frames );
+    if ( interface.maybe_send().has_value() ) {
+      throw ExpectationViolation( "NetworkInterface::maybe_send_all() left a frame behind" );
+    }
+    size_t arp_sent = 0;
+    size_t ipv4_sent = 0;
+    for ( const auto& frame : frames ) {
+      arp_sent += frame.header.type == EthernetHeader::TYPE_ARP;
+      ipv4_sent += frame.header.type == EthernetHeader::TYPE_IPv4;
+    }
+    if ( arp_sent != arp or ipv4_sent != ipv4 or arp_sent + ipv4_sent != frames.size() ) {
+      throw ExpectationViolation( "NetworkInterface sent " + to_string( arp_sent ) + " ARP and "
+                                  + to_string( ipv4_sent ) + " IPv4 frames (of " + to_string( frames.size() )
+                                  + "), but " + to_string( arp ) + " and " + to_string( ipv4 )
+                                  + " were expected" );
+    }
+  }
+
+  ExpectFrameCounts( size_t a, size_t i ) : arp( a ), ipv4( i ) {}
+};
+
+// One of the counters in NetworkInterface::stats(), e.g. ExpectStat { "arp_dropped", &InterfaceStats::arp_dropped, 1 }
+struct ExpectStat : public ExpectNumber<NetworkInterface, uint64_t>
+{
+  std::string name_;
+  uint64_t InterfaceStats::* member_;
+
+  ExpectStat( std::string name, uint64_t InterfaceStats::* member, uint64_t num )
+    : ExpectNumber( num ), name_( std::move( name ) ), member_( member )
+  {}
+  std::string name() const override { return name_; }
+  uint64_t value( NetworkInterface& interface ) const override { return interface.stats().*member_; }
+};
+
+struct ExpectNeighbours : public ExpectNumber<NetworkInterface, size_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "neighbours"; }
+  size_t value( NetworkInterface& interface ) const override { return interface.neighbours(); }
+};
+
+struct ExpectPendingDatagrams : public ExpectNumber<NetworkInterface, size_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "pending_datagrams"; }
+  size_t value( NetworkInterface& interface ) const override { return interface.pending_datagrams(); }
+};
+
+// Bytes queued waiting for ARP, for every next hop or just one
+struct ExpectPendingBytes : public ExpectNumber<NetworkInterface, size_t>
+{
+  std::optional<Address> next_hop {};
+
+  explicit ExpectPendingBytes( size_t num ) : ExpectNumber( num ) {}
+  ExpectPendingBytes( const Address& hop, size_t num ) : ExpectNumber( num ), next_hop( hop ) {}
+  std::string name() const override
+  {
+    return next_hop.has_value() ? "pending_bytes( " + next_hop->ip() + " )" : "pending_bytes";
+  }
+  size_t value( NetworkInterface& interface ) const override
+  {
+    return next_hop.has_value() ? interface.pending_bytes( *next_hop ) : interface.pending_bytes();
+  }
+};
+
+struct ExpectReassemblyDatagrams : public ExpectNumber<NetworkInterface, size_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "reassembler().datagrams"; }
+  size_t value( NetworkInterface& interface ) const override { return interface.reassembler().datagrams(); }
+};
+
+struct ExpectReassemblyBytes : public ExpectNumber<NetworkInterface, size_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "reassembler().bytes"; }
+  size_t value( NetworkInterface& interface ) const override { return interface.reassembler().bytes(); }
+};
+
+struct ExpectEgressClasses : public ExpectNumber<NetworkInterface, size_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "egress().classes"; }
+  size_t value( NetworkInterface& interface ) const override { return interface.egress().classes(); }
+};
+
+// Frames waiting in one egress class
+struct ExpectEgressQueued : public ExpectNumber<NetworkInterface, size_t>
+{
+  size_t cls;
+
+  ExpectEgressQueued( size_t c, size_t num ) : ExpectNumber( num ), cls( c ) {}
+  std::string name() const override { return "egress().queued( " + to_string( cls ) + " )"; }
+  size_t value( NetworkInterface& interface ) const override { return interface.egress().queued( cls ); }
+};
+
+// Frames the egress queues have dropped (by tail drop or CoDel)
+struct ExpectEgressDropped : public ExpectNumber<NetworkInterface, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "egress().dropped"; }
+  uint64_t value( NetworkInterface& interface ) const override { return interface.egress().dropped(); }
+};
+
 struct Tick : public Action<NetworkInterface>
 {
   size_t _ms;
@@ -0,0 +1,169 @@
+#include "common.hh"
+#include "network_simulator.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+uint32_t ip( const string& address )
+{
+  return Address { address }.ipv4_numeric();
+}
+
+using Port = NetworkSimulator::Port;
+
+// 默认的 TCPConfig 一丢包就要等一秒的 RTO；模拟里用快速重传、Reno 和自适应 RTO
+TCPConfig tuned()
+{
+  TCPConfig config;
+  config.fast_retransmit = true;
+  config.congestion_control = TCPConfig::CongestionAlgorithm::Reno;
+  config.adaptive_rto = true;
+  config.rto_min = 200;
+  return config;
+}
+
+// 两台主机隔着一台路由器：10.0.0.2 —— 路由器 —— 10.0.1.2，路由器到接收方那段是瓶颈
+size_t build_path( NetworkSimulator& sim,
+                   const NetworkSimulator::LinkConfig& access,
+                   const NetworkSimulator::LinkConfig& bottleneck )
+{
+  const size_t sender = sim.add_host( "10.0.0.2", "10.0.0.1" );
+  const size_t receiver = sim.add_host( "10.0.1.2", "10.0.1.1" );
+  const size_t r = sim.add_router();
+  sim.add_router_interface( r, "10.0.0.1" );
+  sim.add_router_interface( r, "10.0.1.1" );
+  sim.router( r ).add_route( ip( "10.0.0.0" ), 24, {}, 0 );
+  sim.router( r ).add_route( ip( "10.0.1.0" ), 24, {}, 1 );
+  sim.connect( Port::host( sender ), Port::router( r, 0 ), access );
+  sim.connect( Port::router( r, 1 ), Port::host( receiver ), bottleneck );
+  return sender;
+}
+
+void path_test()
+{
+  NetworkSimulator sim;
+  build_path( sim, { .bandwidth_bps = 100'000'000, .delay_us = 1'000 }, { .bandwidth_bps = 10'000'000 } );
+  const size_t flow = sim.add_flow( 0, 1, 1'000'000, tuned() );
+  sim.run( 60'000'000 );
+
+  const auto report = sim.report( flow );
+  check( report.complete, "transfer through a router did not complete" );
+  check( report.bytes == 1'000'000, "wrong number of bytes delivered" );
+  check( report.goodput_bps <= 10'000'000, "goodput above the bottleneck's bandwidth" );
+  check( report.goodput_bps >= 8'000'000, "goodput far below the bottleneck's bandwidth" );
+  check( report.latency_p50_us >= 12'000, "latency below the path's propagation delay" );
+  check( report.latency_p50_us <= report.latency_p90_us and report.latency_p90_us <= report.latency_p99_us,
+         "latency percentiles out of order" );
+}
+
+NetworkSimulator::FlowReport lossy_run( unsigned seed )
+{
+  NetworkSimulator sim { seed };
+  build_path(
+    sim, { .bandwidth_bps = 100'000'000, .delay_us = 1'000, .loss = 0.01 }, { .bandwidth_bps = 10'000'000 } );
+  const size_t flow = sim.add_flow( 0, 1, 500'000, tuned() );
+  sim.run( 120'000'000 );
+  return sim.report( flow );
+}
+
+void loss_test()
+{
+  const auto report = lossy_run( 1 );
+  check( report.complete, "transfer over a lossy link did not complete" );
+  check( report.bytes == 500'000, "wrong number of bytes delivered over a lossy link" );
+  check( report.retransmissions > 0, "no retransmissions over a lossy link" );
+  check( report.segments_sent > report.retransmissions, "more retransmissions than segments" );
+}
+
+void determinism_test()
+{
+  const auto a = lossy_run( 7 );
+  const auto b = lossy_run( 7 );
+  check( a.duration_us == b.duration_us and a.segments_sent == b.segments_sent
+           and a.retransmissions == b.retransmissions and a.latency_p99_us == b.latency_p99_us,
+         "two runs with the same seed differ" );
+}
+
+void queue_test()
+{
+  // 瓶颈口只能排四个满帧：发送方的窗口一大，就会被尾部丢弃
+  NetworkSimulator sim;
+  build_path( sim,
+              { .bandwidth_bps = 1'000'000'000, .delay_us = 100 },
+              { .bandwidth_bps = 1'000'000, .delay_us = 10'000, .queue_bytes = 6'000 } );
+  const size_t flow = sim.add_flow( 0, 1, 200'000, tuned() );
+  sim.run( 120'000'000 );
+
+  check( sim.report( flow ).complete, "transfer through a small queue did not complete" );
+  check( sim.link_stats( Port::router( 0, 1 ) ).dropped_queue_full > 0, "a small queue dropped nothing" );
+  check( sim.link_stats( Port::router( 0, 1 ) ).peak_queue_bytes <= 6'000, "a queue held more than its size" );
+}
+
+// 哑铃拓扑：三对主机共用两台路由器之间的一条瓶颈
+void dumbbell_test()
+{
+  constexpr size_t PAIRS = 3;
+  const NetworkSimulator::LinkConfig access { .bandwidth_bps = 100'000'000, .delay_us = 500 };
+  const NetworkSimulator::LinkConfig bottleneck { .bandwidth_bps = 20'000'000, .delay_us = 5'000 };
+
+  NetworkSimulator sim;
+  const size_t left = sim.add_router();
+  const size_t right = sim.add_router();
+  sim.add_router_interface( left, "10.9.0.1" );
+  sim.add_router_interface( right, "10.9.0.2" );
+  sim.connect( Port::router( left, 0 ), Port::router( right, 0 ), bottleneck );
+  sim.router( left ).add_route( ip( "10.2.0.0" ), 16, Address { "10.9.0.2" }, 0 );
+  sim.router( right ).add_route( ip( "10.1.0.0" ), 16, Address { "10.9.0.1" }, 0 );
+
+  vector<size_t> flows;
+  for ( size_t i = 0; i < PAIRS; ++i ) {
+    const string n = to_string( i + 1 );
+    const size_t l = sim.add_router_interface( left, "10.1." + n + ".1" );
+    const size_t r = sim.add_router_interface( right, "10.2." + n + ".1" );
+    sim.router( left ).add_route( ip( "10.1." + n + ".0" ), 24, {}, l );
+    sim.router( right ).add_route( ip( "10.2." + n + ".0" ), 24, {}, r );
+    const size_t sender = sim.add_host( "10.1." + n + ".2", "10.1." + n + ".1" );
+    const size_t receiver = sim.add_host( "10.2." + n + ".2", "10.2." + n + ".1" );
+    sim.connect( Port::host( sender ), Port::router( left, l ), access );
+    sim.connect( Port::router( right, r ), Port::host( receiver ), access );
+    flows.push_back( sim.add_flow( sender, receiver, 400'000, tuned(), i * 10'000 ) );
+  }
+
+  const auto wall_start = chrono::steady_clock::now();
+  sim.run( 120'000'000 );
+  const auto wall_us
+    = chrono::duration_cast<chrono::microseconds>( chrono::steady_clock::now() - wall_start ).count();
+
+  double total_bps = 0;
+  for ( const size_t f : flows ) {
+    const auto report = sim.report( f );
+    check( report.complete, "dumbbell flow " + to_string( f ) + " did not complete" );
+    total_bps += static_cast<double>( report.bytes ) * 8e6 / static_cast<double>( sim.now_us() );
+  }
+  check( total_bps <= 20'000'000, "flows shared more than the bottleneck's bandwidth" );
+  check( static_cast<uint64_t>( wall_us ) < sim.now_us(), "simulation ran slower than real time" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    path_test();
+    loss_test();
+    determinism_test();
+    queue_test();
+    dumbbell_test();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,459 @@
+#pragma once
+
+#include "network_interface.hh"
+#include "router.hh"
+#include "tcp_config.hh"
+#include "tcp_over_ipv4.hh"
+#include "tcp_peer.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A deterministic discrete-event simulator for whole-stack runs: hosts (a NetworkInterface and a
+// TCPPeer each) and Routers, joined by links that have a bandwidth, a propagation delay, a loss
+// rate and a drop-tail queue. Time is simulated, in microseconds: a run takes as long as the work
+// the stack does, not as long as the transfer would, and the same seed gives the same run.
+//
+// Each flow sends a number of bytes from one host to another over TCP. The report for a flow
+// gives its goodput, how many segments the sender retransmitted, and percentiles of the latency
+// from the sending application's write to the receiving application's read of each chunk.
+class NetworkSimulator
+{
+public:
+  struct LinkConfig
+  {
+    uint64_t bandwidth_bps = 10'000'000; // bits per second
+    uint64_t delay_us = 5'000;           // propagation delay
+    double loss {};                      // chance that a frame is lost on the wire
+    size_t queue_bytes = 64 * 1024;      // room for frames waiting to go out (and the one going out)
+  };
+
+  struct LinkStats
+  {
+    uint64_t frames_sent;
+    uint64_t bytes_sent;
+    uint64_t dropped_queue_full;
+    uint64_t dropped_loss;
+    size_t peak_queue_bytes;
+  };
+
+  struct FlowReport
+  {
+    bool complete;            // every byte (and the FIN) arrived
+    uint64_t bytes;           // delivered to the receiving application
+    uint64_t duration_us;     // from the flow's start to the last byte read (or to now)
+    double goodput_bps;       // bytes delivered, in bits per second of duration
+    uint64_t segments_sent;   // by the sending TCPPeer, retransmissions included
+    uint64_t retransmissions; // segments whose sequence numbers had been sent before
+    uint64_t latency_p50_us;  // write to read, per chunk written
+    uint64_t latency_p90_us;
+    uint64_t latency_p99_us;
+  };
+
+  // One end of a link: a host's interface, or one of a router's
+  struct Port
+  {
+    bool is_router;
+    size_t node;
+    size_t interface;
+
+    static Port host( size_t h ) { return { false, h, 0 }; }
+    static Port router( size_t r, size_t i ) { return { true, r, i }; }
+  };
+
+  explicit NetworkSimulator( unsigned seed = 0 ) : rng_( seed ) {}
+
+  // A host with one interface at `ip` that sends every datagram to `gateway`
+  size_t add_host( const std::string& ip, const std::string& gateway )
+  {
+    hosts_.push_back( std::make_unique<Host>( next_ethernet_address_(), Address { ip }, Address { gateway } ) );
+    return hosts_.size() - 1;
+  }
+
+  // A router, which gets its interfaces from add_router_interface() and its routes from router()
+  size_t add_router()
+  {
+    routers_.push_back( std::make_unique<SimRouter>() );
+    return routers_.size() - 1;
+  }
+
+  size_t add_router_interface( size_t r, const std::string& ip )
+  {
+    routers_.at( r )->links.emplace_back();
+    return routers_.at( r )->router.add_interface( { next_ethernet_address_(), Address { ip } } );
+  }
+
+  Router& router( size_t r ) { return routers_.at( r )->router; }
+  NetworkInterface& host_interface( size_t h ) { return hosts_.at( h )->interface; }
+
+  // A link each way between `a` and `b`
+  void connect( Port a, Port b, const LinkConfig& config )
+  {
+    out_link_( a ) = links_.size();
+    links_.push_back( { config, b } );
+    out_link_( b ) = links_.size();
+    links_.push_back( { config, a } );
+  }
+
+  // The link that carries frames out of `port`
+  const LinkStats& link_stats( Port port ) { return links_.at( out_link_( port ).value() ).stats; }
+
+  // Send `bytes` from host `from` to host `to` over TCP, starting at `start_us`. A host takes part
+  // in one flow at most. Both peers get a fixed ISN (`config.fixed_isn`, or 0) so runs repeat.
+  size_t add_flow( size_t from, size_t to, uint64_t bytes, TCPConfig config = {}, uint64_t start_us = 0 )
+  {
+    Host& sender = *hosts_.at( from );
+    Host& receiver = *hosts_.at( to );
+    if ( sender.flow or receiver.flow ) {
+      throw std::runtime_error( "a host takes part in one flow at most" );
+    }
+    config.fixed_isn = config.fixed_isn.value_or( Wrap32 { 0 } );
+    const size_t f = flows_.size();
+    const Address client { sender.ip.ip(), static_cast<uint16_t>( 40000 + f ) };
+    const Address server { receiver.ip.ip(), 80 };
+    flows_.push_back( std::make_unique<Flow>( from, to, bytes, start_us, *config.fixed_isn ) );
+    sender.flow = receiver.flow = f;
+    sender.peer = std::make_unique<TCPPeer>( config );
+    sender.tcp.emplace( client, server );
+    receiver.peer = std::make_unique<TCPPeer>( config );
+    receiver.tcp.emplace( server, client );
+    return f;
+  }
+
+  // Run until every flow has finished (or failed), or until `limit_us` of simulated time
+  void run( uint64_t limit_us )
+  {
+    service_();
+    while ( not all_flows_done_() ) {
+      uint64_t next = next_tick_us_;
+      if ( not deliveries_.empty() ) {
+        next = std::min( next, deliveries_.begin()->first.first );
+      }
+      if ( next > limit_us ) {
+        now_us_ = limit_us;
+        return;
+      }
+      now_us_ = next;
+
+      while ( not deliveries_.empty() and deliveries_.begin()->first.first <= now_us_ ) {
+        auto node = deliveries_.extract( deliveries_.begin() );
+        deliver_( node.mapped().first, node.mapped().second );
+      }
+      if ( now_us_ >= next_tick_us_ ) {
+        tick_();
+        next_tick_us_ += TICK_US;
+      }
+      service_();
+    }
+  }
+
+  uint64_t now_us() const { return now_us_; }
+
+  FlowReport report( size_t f ) const
+  {
+    const Flow& flow = *flows_.at( f );
+    const uint64_t end = flow.done_us.value_or( now_us_ );
+    const uint64_t duration = end > flow.start_us ? end - flow.start_us : 0;
+    std::vector<uint64_t> latencies = flow.latencies;
+    std::sort( latencies.begin(), latencies.end() );
+    const auto percentile = [&]( double p ) {
+      return latencies.empty()
+               ? 0
+               : latencies[std::min( latencies.size() - 1, static_cast<size_t>( p * latencies.size() ) )];
+    };
+    return { flow.done_us.has_value(),
+             flow.read,
+             duration,
+             duration ? static_cast<double>( flow.read ) * 8e6 / static_cast<double>( duration ) : 0,
+             flow.segments_sent,
+             flow.retransmissions,
+             percentile( 0.50 ),
+             percentile( 0.90 ),
+             percentile( 0.99 ) };
+  }
+
+private:
+  static constexpr uint64_t TICK_US = 1000;    // TCPPeer 和 NetworkInterface 以毫秒为单位 tick
+  static constexpr uint64_t WRITE_SIZE = 4096; // 应用每次写的块：时延按块统计
+
+  struct Host
+  {
+    Host( const EthernetAddress& ethernet, const Address& address, const Address& next_hop )
+      : interface( ethernet, address ), ip( address ), gateway( next_hop )
+    {}
+
+    NetworkInterface interface;
+    Address ip;
+    Address gateway;
+    std::optional<size_t> link {};
+    std::optional<size_t> flow {};
+    std::unique_ptr<TCPPeer> peer {};
+    std::optional<TCPOverIPv4> tcp {};
+  };
+
+  struct SimRouter
+  {
+    Router router {};
+    std::vector<std::optional<size_t>> links {}; // 每个接口往外的链路
+  };
+
+  struct Link
+  {
+    LinkConfig config;
+    Port to;
+    uint64_t busy_until_us {};
+    std::deque<std::pair<uint64_t, size_t>> queue {}; // 排队（和正在发）的帧：发完的时刻、字节数
+    size_t queued_bytes {};
+    LinkStats stats {};
+  };
+
+  struct Flow
+  {
+    Flow( size_t f, size_t t, uint64_t b, uint64_t start, Wrap32 i )
+      : from( f ), to( t ), bytes( b ), start_us( start ), isn( i )
+    {}
+
+    size_t from;
+    size_t to;
+    uint64_t bytes;
+    uint64_t start_us;
+    Wrap32 isn;
+    bool connected {};
+    uint64_t written {};
+    uint64_t read {};
+    std::deque<std::pair<uint64_t, uint64_t>> chunks {}; // 写进去的每一块：结束位置、写的时刻
+    std::vector<uint64_t> latencies {};
+    std::optional<uint64_t> done_us {};
+    bool failed {};
+    uint64_t segments_sent {};
+    uint64_t retransmissions {};
+    uint64_t highest_sent {}; // 发出过的最大绝对序列号（不含）
+  };
+
+  static uint8_t pattern_( uint64_t i ) { return static_cast<uint8_t>( i * 7 % 251 ); }
+
+  EthernetAddress next_ethernet_address_()
+  {
+    const size_t n = ++ethernet_addresses_;
+    return { 0x02, 0, 0, static_cast<uint8_t>( n >> 16 ), static_cast<uint8_t>( n >> 8 ), static_cast<uint8_t>( n ) };
+  }
+
+  std::optional<size_t>& out_link_( Port port )
+  {
+    return port.is_router ? routers_.at( port.node )->links.at( port.interface ) : hosts_.at( port.node )->link;
+  }
+
+  NetworkInterface& interface_( Port port )
+  {
+    return port.is_router ? routers_.at( port.node )->router.interface( port.interface )
+                          : hosts_.at( port.node )->interface;
+  }
+
+  bool all_flows_done_() const
+  {
+    return std::all_of(
+      flows_.begin(), flows_.end(), []( const auto& flow ) { return flow->done_us.has_value() or flow->failed; } );
+  }
+
+  // 帧进链路的队列：满了就丢；链路空闲时立刻开始发，发完再过一个传播时延到达对端
+  void transmit_( std::optional<size_t> link_index, EthernetFrame&& frame )
+  {
+    if ( not link_index ) {
+      return; // 没接线的接口
+    }
+    Link& link = links_[*link_index];
+    while ( not link.queue.empty() and link.queue.front().first <= now_us_ ) {
+      link.queued_bytes -= link.queue.front().second;
+      link.queue.pop_front();
+    }
+
+    size_t size = EthernetHeader::LENGTH;
+    for ( const auto& buffer : frame.payload ) {
+      size += buffer.size();
+    }
+    if ( link.queued_bytes + size > link.config.queue_bytes ) {
+      ++link.stats.dropped_queue_full;
+      return;
+    }
+
+    const uint64_t start = std::max( now_us_, link.busy_until_us );
+    const uint64_t bandwidth = link.config.bandwidth_bps;
+    const uint64_t finish = start + ( size * 8 * 1'000'000 + bandwidth - 1 ) / bandwidth;
+    link.busy_until_us = finish;
+    link.queue.emplace_back( finish, size );
+    link.queued_bytes += size;
+    link.stats.peak_queue_bytes = std::max( link.stats.peak_queue_bytes, link.queued_bytes );
+    ++link.stats.frames_sent;
+    link.stats.bytes_sent += size;
+
+    if ( loss_( rng_ ) < link.config.loss ) {
+      ++link.stats.dropped_loss;
+      return;
+    }
+    deliveries_.emplace( std::make_pair( finish + link.config.delay_us, delivery_seq_++ ),
+                         std::make_pair( link.to, std::move( frame ) ) );
+  }
+
+  void deliver_( Port port, const EthernetFrame& frame )
+  {
+    if ( port.is_router ) {
+      routers_.at( port.node )->router.interface( port.interface ).recv_frame( frame );
+      return;
+    }
+    Host& host = *hosts_.at( port.node );
+    auto dgram = host.interface.recv_frame( frame );
+    if ( not dgram or not host.tcp ) {
+      return;
+    }
+    auto seg = host.tcp->unwrap( *dgram );
+    if ( seg and not seg->RST ) {
+      host.peer->receive( std::move( seg->message ) );
+    }
+  }
+
+  void tick_()
+  {
+    for ( auto& host : hosts_ ) {
+      host->interface.tick( 1 );
+      if ( host->peer ) {
+        host->peer->tick( 1 );
+      }
+    }
+    for ( auto& r : routers_ ) {
+      for ( size_t i = 0; i < r->links.size(); ++i ) {
+        r->router.interface( i ).tick( 1 );
+      }
+    }
+  }
+
+  // 到当前时刻为止能做的都做掉：应用读写、TCP 发段、路由器转发、帧进链路
+  void service_()
+  {
+    for ( size_t f = 0; f < flows_.size(); ++f ) {
+      run_applications_( *flows_[f] );
+    }
+
+    for ( auto& host : hosts_ ) {
+      if ( host->peer ) {
+        host->peer->maybe_send_all( messages_ );
+        for ( auto& msg : messages_ ) {
+          count_segment_( *flows_[*host->flow], *host, msg.sender );
+          host->interface.send_datagram( host->tcp->wrap( std::move( msg ) ), host->gateway );
+        }
+        messages_.clear();
+      }
+      host->interface.maybe_send_all( frames_ );
+      for ( auto& frame : frames_ ) {
+        transmit_( host->link, std::move( frame ) );
+      }
+      frames_.clear();
+    }
+
+    for ( auto& r : routers_ ) {
+      r->router.route();
+      for ( size_t i = 0; i < r->links.size(); ++i ) {
+        r->router.interface( i ).maybe_send_all( frames_ );
+        for ( auto& frame : frames_ ) {
+          transmit_( r->links[i], std::move( frame ) );
+        }
+        frames_.clear();
+      }
+    }
+  }
+
+  void count_segment_( Flow& flow, const Host& host, const TCPSenderMessage& msg )
+  {
+    if ( host.flow != flow.from or msg.sequence_length() == 0 ) {
+      return;
+    }
+    ++flow.segments_sent;
+    const uint64_t first = msg.seqno.unwrap( flow.isn, flow.highest_sent );
+    if ( first < flow.highest_sent ) {
+      ++flow.retransmissions;
+    }
+    flow.highest_sent = std::max( flow.highest_sent, first + msg.sequence_length() );
+  }
+
+  void run_applications_( Flow& flow )
+  {
+    if ( now_us_ < flow.start_us or flow.done_us or flow.failed ) {
+      return;
+    }
+
+    // 发送方：有空间就写，写完就关
+    TCPPeer& sender = *hosts_[flow.from]->peer;
+    if ( not flow.connected ) {
+      sender.connect();
+      flow.connected = true;
+    }
+    Writer& writer = sender.outbound_writer();
+    const uint64_t written_before = flow.written;
+    while ( flow.written < flow.bytes and writer.available_capacity() > 0 ) {
+      const uint64_t n = std::min( { flow.bytes - flow.written, writer.available_capacity(), WRITE_SIZE } );
+      std::string chunk( n, 0 );
+      for ( uint64_t i = 0; i < n; ++i ) {
+        chunk[i] = static_cast<char>( pattern_( flow.written + i ) );
+      }
+      writer.push( std::move( chunk ) );
+      flow.written += n;
+      flow.chunks.emplace_back( flow.written, now_us_ );
+      if ( flow.written == flow.bytes ) {
+        writer.close();
+      }
+    }
+    if ( flow.written != written_before ) {
+      sender.push();
+    }
+
+    // 接收方：全部读出来，核对内容，记下每一块从写到读的时间
+    Reader& reader = hosts_[flow.to]->peer->inbound_reader();
+    while ( reader.bytes_buffered() > 0 ) {
+      const std::string_view data = reader.peek();
+      for ( size_t i = 0; i < data.size(); ++i ) {
+        if ( static_cast<uint8_t>( data[i] ) != pattern_( flow.read + i ) ) {
+          throw std::runtime_error( "flow " + std::to_string( flow.from ) + ": corrupt byte at "
+                                    + std::to_string( flow.read + i ) );
+        }
+      }
+      flow.read += data.size();
+      reader.pop( data.size() );
+    }
+    while ( not flow.chunks.empty() and flow.chunks.front().first <= flow.read ) {
+      flow.latencies.push_back( now_us_ - flow.chunks.front().second );
+      flow.chunks.pop_front();
+    }
+    if ( reader.is_finished() ) {
+      flow.done_us = now_us_;
+    } else if ( reader.has_error() or not sender.active() ) {
+      flow.failed = true; // 重传次数用完，或者被 RST
+    }
+  }
+
+  std::default_random_engine rng_;
+  std::uniform_real_distribution<double> loss_ { 0, 1 };
+  uint64_t now_us_ {};
+  uint64_t next_tick_us_ { TICK_US };
+  size_t ethernet_addresses_ {};
+
+  std::vector<std::unique_ptr<Host>> hosts_ {};
+  std::vector<std::unique_ptr<SimRouter>> routers_ {};
+  std::vector<Link> links_ {};
+  std::vector<std::unique_ptr<Flow>> flows_ {};
+
+  // 按（到达时刻，序号）排好的在路上的帧；序号让同一时刻到达的按发出的顺序来
+  std::map<std::pair<uint64_t, uint64_t>, std::pair<Port, EthernetFrame>> deliveries_ {};
+  uint64_t delivery_seq_ {};
+
+  std::vector<TCPMessage> messages_ {}; // service_() 复用
+  std::vector<EthernetFrame> frames_ {};
+};
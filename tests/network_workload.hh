@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// What a link does to a stream of segments on its way to the receiver
+struct LinkProfile
+{
+  std::string name;
+  double loss {};             // chance that any one transmission is lost (and retransmitted later)
+  size_t reorder_depth {};    // a segment may arrive up to this many segment times late
+  double duplicate {};        // chance that a delivered segment arrives a second time
+  double overlap {};          // chance that a (re)transmission is cut differently and overlaps its neighbour
+  size_t retransmit_after {}; // segment times from a loss to its retransmission (0: 2 * reorder_depth + 4)
+};
+
+// A few links worth comparing, from a clean LAN to a bad wireless hop
+inline std::vector<LinkProfile> standard_link_profiles()
+{
+  return {
+    { "clean", 0, 0, 0, 0, 0 },
+    { "datacenter", 0.0001, 2, 0, 0, 0 },
+    { "wan_multipath", 0.001, 64, 0, 0, 0 },
+    { "wifi", 0.02, 8, 0.01, 0.05, 0 },
+    { "lossy", 0.10, 4, 0.02, 0.20, 0 },
+    { "duplicating", 0, 4, 0.30, 0.10, 0 },
+  };
+}
+
+// Turns a byte stream into the substrings a receiver would see over a link with `profile`: the
+// sender sends `segment_size`-byte segments one per "segment time"; each transmission is lost
+// with probability `loss` (and sent again `retransmit_after` segment times later), and otherwise
+// arrives up to `reorder_depth` segment times late, perhaps twice. A transmission that
+// `overlap`s runs on into the next segment by up to half a segment, as a repacketized TCP
+// retransmission would.
+class NetworkWorkload
+{
+public:
+  struct Arrival
+  {
+    uint64_t first_index;
+    size_t length;
+    bool last; // the substring ends the stream
+  };
+
+  NetworkWorkload( const LinkProfile& profile, uint64_t stream_length, size_t segment_size, unsigned seed )
+  {
+    std::default_random_engine rd { seed };
+    std::uniform_real_distribution<double> chance { 0, 1 };
+    std::uniform_int_distribution<size_t> delay { 0, profile.reorder_depth };
+    std::uniform_int_distribution<size_t> extra { 1, std::max<size_t>( segment_size / 2, 1 ) };
+    const size_t rto = profile.retransmit_after ? profile.retransmit_after : 2 * profile.reorder_depth + 4;
+
+    struct Event
+    {
+      uint64_t time;
+      uint64_t order; // 同一时刻到达的按产生顺序排
+      Arrival arrival;
+    };
+    std::vector<Event> events;
+    uint64_t order = 0;
+    size_t most_attempts = 1;
+
+    for ( uint64_t first = 0, time = 0; first < stream_length; first += segment_size, ++time ) {
+      for ( size_t attempt = 0;; ++attempt ) {
+        uint64_t length = std::min<uint64_t>( segment_size, stream_length - first );
+        if ( chance( rd ) < profile.overlap ) {
+          length = std::min<uint64_t>( length + extra( rd ), stream_length - first );
+        }
+        const Arrival arrival { first, length, first + length == stream_length };
+        const uint64_t sent = time + attempt * rto;
+        if ( chance( rd ) < profile.loss ) {
+          ++lost_;
+          continue;
+        }
+        events.push_back( { sent + delay( rd ), order++, arrival } );
+        if ( chance( rd ) < profile.duplicate ) {
+          events.push_back( { sent + delay( rd ), order++, arrival } );
+          ++duplicated_;
+        }
+        most_attempts = std::max( most_attempts, attempt + 1 );
+        break;
+      }
+    }
+
+    std::sort( events.begin(), events.end(), []( const Event& a, const Event& b ) {
+      return a.time != b.time ? a.time < b.time : a.order < b.order;
+    } );
+    arrivals_.reserve( events.size() );
+    for ( const auto& e : events ) {
+      arrivals_.push_back( e.arrival );
+    }
+
+    // 最晚的一次重传加上最大的乱序，期间发出的数据都得能放进接收窗口
+    window_ = ( most_attempts * rto + profile.reorder_depth + 2 ) * segment_size * 2;
+  }
+
+  const std::vector<Arrival>& arrivals() const { return arrivals_; }
+
+  // A receive window (stream capacity) big enough that nothing has to be thrown away
+  uint64_t window() const { return window_; }
+  uint64_t lost() const { return lost_; }
+  uint64_t duplicated() const { return duplicated_; }
+
+private:
+  std::vector<Arrival> arrivals_ {};
+  uint64_t window_ {};
+  uint64_t lost_ {};
+  uint64_t duplicated_ {};
+};
@@ -0,0 +1,115 @@
+#include "common.hh"
+#include "exception.hh"
+#include "link_device.hh"
+#include "packet_arena.hh"
+
+#include <exception>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+string wire( const EthernetFrame& frame )
+{
+  string out;
+  for ( const auto& buffer : serialize( frame ) ) {
+    out += string_view { buffer };
+  }
+  return out;
+}
+} // namespace
+
+int main()
+{
+  try {
+    // 沙箱里一般没有预留大页：退到透明大页或普通页，但总能建起来
+    {
+      PacketArena arena { { .slab_size = 2000, .slabs_per_node = 8, .pages = PacketArena::Pages::Huge1G } };
+      check( arena.slab_size() == 2048, "slab size rounded to a cache line" );
+      check( not arena.nodes().empty(), "at least one node" );
+      const unsigned node = arena.nodes().front();
+      const size_t slabs = arena.available( node );
+      check( slabs >= 8, "at least the slabs asked for" );
+
+      vector<PacketArena::Slab> taken;
+      while ( auto slab = arena.take( node ) ) {
+        check( arena.contains( slab.get() ) and arena.node_of( slab.get() ) == node, "slab from its node" );
+        taken.push_back( std::move( slab ) );
+      }
+      check( taken.size() == slabs * arena.nodes().size(), "every slab handed out before running dry" );
+      check( arena.remote_takes() == slabs * ( arena.nodes().size() - 1 ), "other nodes only once one is empty" );
+      taken.clear();
+      check( arena.available( node ) == slabs, "dropped slabs go back to their node" );
+    }
+
+    // wrap()：Buffer 直接用槽里的字节；副本和切片共享它，最后一个释放时槽才回去
+    {
+      PacketArena arena { { .slabs_per_node = 4, .pages = PacketArena::Pages::Normal } };
+      check( arena.pages() == PacketArena::Pages::Normal, "normal pages as asked" );
+      const unsigned node = arena.nodes().front();
+      const size_t slabs = arena.available( node );
+      auto slab = arena.take( node );
+      char* bytes = slab.get();
+      string( "hello, arena" ).copy( bytes, 12 );
+      Buffer buffer = arena.wrap( std::move( slab ), 12 );
+      check( not slab and string_view { buffer } == "hello, arena", "wrapped in place" );
+      check( string_view { buffer }.data() == bytes, "no copy" );
+      Buffer slice = buffer.substr( 7 );
+      buffer = Buffer {};
+      check( arena.available( node ) == slabs - 1, "a slice keeps the slab" );
+      Buffer copy = slice;
+      static_cast<string&>( copy ) += "!";
+      check( string_view { copy } == "arena!" and string_view { slice }.data() == bytes + 7, "modifying copies" );
+      slice = Buffer {};
+      check( arena.available( node ) == slabs, "last Buffer returns the slab" );
+
+      // 别的线程释放，槽也回到原来的节点
+      Buffer far = arena.wrap( arena.take( node ), 5 );
+      thread { [b = std::move( far )]() mutable { b = Buffer {}; } }.join();
+      check( arena.available( node ) == slabs, "released on another thread" );
+    }
+
+    check( not PacketArena::node_of_interface( "lo" ).has_value(), "lo has no NUMA node" );
+    check( not PacketArena::node_of_interface( "no-such-interface" ).has_value(), "nor does a missing interface" );
+
+    // LinkDevice 收到的帧在 arena 的槽里；帧释放以后槽回来
+    {
+      PacketArena arena { { .slabs_per_node = 64 } };
+      const unsigned node = arena.nodes().front();
+      const size_t slabs = arena.available( node );
+      int fds[2] {};
+      CheckSystemCall( "socketpair", ::socketpair( AF_UNIX, SOCK_DGRAM, 0, fds ) );
+      LinkDevice device { FileDescriptor { fds[0] }, 4 };
+      const FileDescriptor peer { fds[1] };
+      device.use_arena( arena, node );
+
+      const EthernetFrame frame { { { 0x02, 0, 0, 0, 0, 1 }, { 0x02, 0, 0, 0, 0, 2 }, 0x88b5 },
+                                  { Buffer { string( 100, 'x' ) } } };
+      const string bytes = wire( frame );
+      for ( int i = 0; i < 6; ++i ) {
+        CheckSystemCall( "send", ::send( peer.fd_num(), bytes.data(), bytes.size(), 0 ) );
+      }
+      const string jumbo( 3000, 'j' );
+      CheckSystemCall( "send", ::send( peer.fd_num(), jumbo.data(), jumbo.size(), 0 ) );
+
+      vector<EthernetFrame> received;
+      while ( device.receive( received ) > 0 ) {}
+      check( received.size() == 6, "six frames received" );
+      for ( const auto& f : received ) {
+        check( arena.contains( string_view { f.payload.front() }.data() ), "payload lives in the arena" );
+      }
+      check( device.dropped() == 1, "frame longer than a slab dropped" );
+      received.clear();
+      check( arena.available( node ) + 4 == slabs, "only the device's batch of slabs is still out" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,202 @@
+#include "common.hh"
+#include "packet_filter.hh"
+#include "router.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+using Verdict = PacketFilter::Action;
+using Rule = PacketFilter::Rule;
+
+uint32_t ip( const string& address )
+{
+  return Address { address }.ipv4_numeric();
+}
+
+InternetDatagram datagram( const string& src,
+                           const string& dst,
+                           uint8_t protocol = IPv4Header::PROTO_TCP,
+                           uint16_t src_port = 40000,
+                           uint16_t dst_port = 80 )
+{
+  InternetDatagram dgram;
+  dgram.header.src = ip( src );
+  dgram.header.dst = ip( dst );
+  dgram.header.proto = protocol;
+  dgram.header.ttl = 64;
+  string payload( 20, 0 );
+  payload[0] = static_cast<char>( src_port >> 8 );
+  payload[1] = static_cast<char>( src_port & 0xff );
+  payload[2] = static_cast<char>( dst_port >> 8 );
+  payload[3] = static_cast<char>( dst_port & 0xff );
+  dgram.payload.emplace_back( payload );
+  dgram.header.len = IPv4Header::LENGTH + payload.size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+// 参考实现：从头到尾一条条比
+bool matches( const Rule& rule, const PacketFilter::Fields& f )
+{
+  auto const within = [&]( uint32_t address, uint32_t prefix, uint8_t length ) {
+    return length == 0 || ( ( address ^ prefix ) >> ( 32 - length ) ) == 0;
+  };
+  if ( ( rule.src_port.has_value() || rule.dst_port.has_value() ) && not f.has_ports ) {
+    return false;
+  }
+  return within( f.src, rule.src_prefix, rule.src_length ) && within( f.dst, rule.dst_prefix, rule.dst_length )
+         && ( not rule.protocol.has_value() || *rule.protocol == f.protocol )
+         && ( not rule.src_port.has_value() || *rule.src_port == f.src_port )
+         && ( not rule.dst_port.has_value() || *rule.dst_port == f.dst_port );
+}
+
+optional<size_t> linear_match( const vector<Rule>& rules, const PacketFilter::Fields& f )
+{
+  for ( size_t i = 0; i < rules.size(); ++i ) {
+    if ( matches( rules[i], f ) ) {
+      return i;
+    }
+  }
+  return {};
+}
+} // namespace
+
+int main()
+{
+  try {
+    // 先匹配的规则说了算
+    {
+      const vector<Rule> rules {
+        { 0, 0, ip( "10.1.0.0" ), 16, IPv4Header::PROTO_TCP, {}, 22, Verdict::Deny },
+        { 0, 0, ip( "10.1.2.0" ), 24, {}, {}, {}, Verdict::Allow },
+        { ip( "192.168.0.0" ), 16, ip( "10.0.0.0" ), 8, {}, {}, {}, Verdict::Deny },
+        { 0, 0, 0, 0, PacketFilter::PROTO_UDP, {}, 53, Verdict::Allow },
+      };
+      PacketFilter filter { rules, Verdict::Deny };
+      check( filter.tuples() == 4, "four tuples" );
+
+      auto const decide = [&]( const InternetDatagram& dgram ) { return filter.classify( dgram ); };
+      check( decide( datagram( "1.2.3.4", "10.1.2.3", IPv4Header::PROTO_TCP, 1000, 22 ) ) == Verdict::Deny,
+             "ssh denied before the /24 allow" );
+      check( decide( datagram( "1.2.3.4", "10.1.2.3" ) ) == Verdict::Allow, "web to the /24 allowed" );
+      check( decide( datagram( "192.168.1.1", "10.1.2.3" ) ) == Verdict::Allow, "earlier allow wins" );
+      check( decide( datagram( "192.168.1.1", "10.9.0.1" ) ) == Verdict::Deny, "source and destination" );
+      check( decide( datagram( "192.168.1.1", "8.8.8.8", PacketFilter::PROTO_UDP, 5000, 53 ) ) == Verdict::Allow,
+             "any-address rule" );
+      check( decide( datagram( "192.168.1.1", "8.8.8.8" ) ) == Verdict::Deny, "default action" );
+
+      check( filter.hits( 0 ) == 1 and filter.hits( 1 ) == 2 and filter.hits( 2 ) == 1 and filter.hits( 3 ) == 1,
+             "rule hits counted" );
+      check( filter.default_hits() == 1, "default hits counted" );
+    }
+
+    // 不是第一个分片的分片没有端口：带端口的规则不匹配
+    {
+      const vector<Rule> rules { { 0, 0, 0, 0, IPv4Header::PROTO_TCP, {}, 22, Verdict::Deny } };
+      PacketFilter filter { rules };
+      auto first = datagram( "1.1.1.1", "2.2.2.2", IPv4Header::PROTO_TCP, 1000, 22 );
+      first.header.mf = true;
+      check( filter.classify( first ) == Verdict::Deny, "first fragment has the ports" );
+      auto later = first;
+      later.header.offset = 100;
+      check( filter.classify( later ) == Verdict::Allow, "later fragment has none" );
+      check( filter.classify( datagram( "1.1.1.1", "2.2.2.2", 1 ) ) == Verdict::Allow, "ICMP has none" );
+      check( filter.classify( datagram( "1.1.1.1", "2.2.2.2", PacketFilter::PROTO_UDP, 1000, 22 ) ) == Verdict::Allow,
+             "protocol checked" );
+    }
+
+    // 没有规则：全部默认动作
+    {
+      PacketFilter filter;
+      check( filter.empty() and filter.tuples() == 0, "empty" );
+      check( filter.classify( datagram( "1.1.1.1", "2.2.2.2" ) ) == Verdict::Allow, "allowed by default" );
+    }
+
+    // 随机规则和数据报：和逐条比较的结果一样
+    {
+      default_random_engine rd { 7 };
+      uniform_int_distribution<uint32_t> u32;
+      uniform_int_distribution<int> coin { 0, 3 };
+      const vector<uint8_t> lengths { 0, 8, 16, 24, 32 };
+      auto const pick_length = [&] { return lengths[u32( rd ) % lengths.size()]; };
+      // 地址和端口只从小集合里取，这样规则之间经常重叠
+      auto const address = [&] { return ip( "10.0.0.0" ) | ( u32( rd ) & 0x0303'0303 ); };
+      auto const port = [&] { return static_cast<uint16_t>( 20 + u32( rd ) % 4 ); };
+
+      vector<Rule> rules;
+      for ( size_t i = 0; i < 500; ++i ) {
+        Rule rule;
+        rule.src_prefix = address();
+        rule.src_length = pick_length();
+        rule.dst_prefix = address();
+        rule.dst_length = pick_length();
+        if ( coin( rd ) != 0 ) {
+          rule.protocol = coin( rd ) < 2 ? IPv4Header::PROTO_TCP : PacketFilter::PROTO_UDP;
+        }
+        if ( coin( rd ) == 0 ) {
+          rule.src_port = port();
+        }
+        if ( coin( rd ) != 0 ) {
+          rule.dst_port = port();
+        }
+        rule.action = coin( rd ) < 2 ? Verdict::Allow : Verdict::Deny;
+        rules.push_back( rule );
+      }
+      PacketFilter filter { rules };
+      check( filter.tuples() < rules.size() / 2, "rules share tuples" );
+
+      for ( size_t i = 0; i < 20000; ++i ) {
+        PacketFilter::Fields f;
+        f.src = address();
+        f.dst = address();
+        f.protocol = coin( rd ) < 2 ? IPv4Header::PROTO_TCP : PacketFilter::PROTO_UDP;
+        f.has_ports = coin( rd ) != 0;
+        f.src_port = f.has_ports ? port() : 0;
+        f.dst_port = f.has_ports ? port() : 0;
+        check( filter.match( f ) == linear_match( rules, f ), "match " + to_string( i ) + " agrees" );
+      }
+    }
+
+    // 在 Router 里：路由之前过滤，拒绝的计入 filtered
+    {
+      constexpr size_t IN = 0, OUT = 1;
+      Router router;
+      router.add_interface( { EthernetAddress { 2, 0, 0, 0, 0, 1 }, Address { "10.0.0.1" } } );
+      router.add_interface( { EthernetAddress { 2, 0, 0, 0, 0, 2 }, Address { "10.1.0.1" } } );
+      router.add_route( ip( "10.1.0.0" ), 16, {}, OUT );
+      const vector<Rule> rules { { 0, 0, ip( "10.1.0.0" ), 16, IPv4Header::PROTO_TCP, {}, 23, Verdict::Deny } };
+      router.set_filter( PacketFilter { rules } );
+
+      auto const frame = [&]( uint16_t dst_port, uint8_t ttl ) {
+        auto dgram = datagram( "10.0.0.2", "10.1.0.2", IPv4Header::PROTO_TCP, 1000, dst_port );
+        dgram.header.ttl = ttl;
+        dgram.header.compute_checksum();
+        return EthernetFrame { { EthernetAddress { 2, 0, 0, 0, 0, 1 }, EthernetAddress { 2, 0, 0, 0, 0, 9 },
+                                 EthernetHeader::TYPE_IPv4 },
+                               serialize( dgram ) };
+      };
+      router.interface( IN ).recv_frame( frame( 23, 64 ) );
+      router.interface( IN ).recv_frame( frame( 80, 64 ) );
+      router.interface( IN ).recv_frame( frame( 23, 1 ) ); // 先过滤，不算 TTL 到期
+      router.route();
+
+      auto const in = router.stats( IN );
+      check( in.filtered == 2 and in.ttl_expired == 0 and in.no_route == 0, "two filtered" );
+      check( router.stats( OUT ).arp_pending == 1, "the allowed one forwarded" );
+      check( router.filter().hits( 0 ) == 2 and router.filter().default_hits() == 1, "hits seen through the router" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
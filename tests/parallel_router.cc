@@ -0,0 +1,131 @@
+#include "arp_message.hh"
+#include "common.hh"
+#include "parallel_router.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+EthernetAddress ethernet_address( uint8_t last )
+{
+  return { 0x02, 0, 0, 0, 0, last };
+}
+
+EthernetFrame datagram_frame( size_t interface, const string& dst, uint16_t id, uint8_t ttl = 64 )
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address { "10.0.0.2" }.ipv4_numeric();
+  dgram.header.dst = Address { dst }.ipv4_numeric();
+  dgram.header.len = IPv4Header::LENGTH;
+  dgram.header.id = id;
+  dgram.header.ttl = ttl;
+  dgram.header.compute_checksum();
+  return { { ethernet_address( interface ), ethernet_address( 9 ), EthernetHeader::TYPE_IPv4 }, serialize( dgram ) };
+}
+
+EthernetFrame arp_reply( size_t interface, const string& interface_ip, const string& neighbor_ip, uint8_t neighbor )
+{
+  ARPMessage reply;
+  reply.opcode = ARPMessage::OPCODE_REPLY;
+  reply.sender_ethernet_address = ethernet_address( neighbor );
+  reply.sender_ip_address = Address { neighbor_ip }.ipv4_numeric();
+  reply.target_ethernet_address = ethernet_address( interface );
+  reply.target_ip_address = Address { interface_ip }.ipv4_numeric();
+  return { { ethernet_address( interface ), ethernet_address( neighbor ), EthernetHeader::TYPE_ARP },
+           serialize( reply ) };
+}
+
+// Wait (up to a few seconds) for `count` IPv4 frames on an interface; returns their datagram ids
+vector<uint16_t> collect( ParallelRouter& router, size_t interface, size_t count )
+{
+  vector<uint16_t> ids;
+  auto const deadline = steady_clock::now() + seconds( 5 );
+  while ( ids.size() < count && steady_clock::now() < deadline ) {
+    auto frame = router.maybe_send( interface );
+    if ( not frame ) {
+      this_thread::yield();
+      continue;
+    }
+    if ( frame->header.type == EthernetHeader::TYPE_IPv4 ) {
+      InternetDatagram dgram;
+      check( parse( dgram, frame->payload ), "unparseable datagram" );
+      check( dgram.header.ttl == 63, "TTL not decremented" );
+      ids.push_back( dgram.header.id );
+    }
+  }
+  return ids;
+}
+
+// Nothing more should show up on the interface within a short while
+bool quiet( ParallelRouter& router, size_t interface )
+{
+  this_thread::sleep_for( milliseconds( 50 ) );
+  return not router.maybe_send( interface ).has_value();
+}
+} // namespace
+
+int main()
+{
+  try {
+    constexpr size_t IN = 0, OUT1 = 1, OUT2 = 2;
+
+    ParallelRouter router { 64 };
+    router.add_interface( { ethernet_address( IN ), Address { "10.0.0.1" } } );
+    router.add_interface( { ethernet_address( OUT1 ), Address { "10.1.0.1" } } );
+    router.add_interface( { ethernet_address( OUT2 ), Address { "10.2.0.1" } } );
+    router.add_route( Address { "10.1.0.0" }.ipv4_numeric(), 16, {}, OUT1 );
+    router.add_route( Address { "172.16.0.0" }.ipv4_numeric(), 12, Address { "10.1.0.2" }, OUT1 );
+    router.start();
+
+    check( router.recv_frame( OUT1, arp_reply( OUT1, "10.1.0.1", "10.1.0.2", 11 ) ), "RX ring full" );
+    check( router.recv_frame( OUT2, arp_reply( OUT2, "10.2.0.1", "10.2.0.2", 12 ) ), "RX ring full" );
+
+    // 直连和经过下一跳的路由，顺序保持不变
+    for ( uint16_t i = 0; i < 10; ++i ) {
+      while ( not router.recv_frame( IN, datagram_frame( IN, i % 2 ? "172.16.3.4" : "10.1.0.2", i ) ) ) {
+        this_thread::yield();
+      }
+    }
+    check( collect( router, OUT1, 10 ) == vector<uint16_t> { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }, "forwarding" );
+
+    // TTL 到期和没有路由的都丢掉
+    router.recv_frame( IN, datagram_frame( IN, "10.1.0.2", 100, 1 ) );
+    router.recv_frame( IN, datagram_frame( IN, "10.2.0.2", 101 ) );
+    check( quiet( router, OUT1 ) && quiet( router, OUT2 ), "forwarded a datagram that should be dropped" );
+
+    // 运行中换路由表
+    router.add_route( Address { "10.2.0.0" }.ipv4_numeric(), 16, {}, OUT2 );
+    router.publish_routes();
+    router.recv_frame( IN, datagram_frame( IN, "10.2.0.2", 102 ) );
+    check( collect( router, OUT2, 1 ) == vector<uint16_t> { 102 }, "published route not used" );
+
+    // 很多数据报（会用满 ring），最终要么发出要么计入 dropped()
+    size_t received = 0;
+    for ( uint16_t i = 0; i < 5000; ++i ) {
+      auto frame = datagram_frame( IN, "10.1.0.2", i );
+      while ( not router.recv_frame( IN, std::move( frame ) ) ) {
+        this_thread::yield();
+      }
+      while ( router.maybe_send( OUT1 ) ) {
+        ++received;
+      }
+    }
+    received += collect( router, OUT1, 5000 - received - router.dropped() ).size();
+    check( received + router.dropped() == 5000, "datagrams lost without being counted" );
+
+    router.stop();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
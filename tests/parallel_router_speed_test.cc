@@ -0,0 +1,135 @@
+#include "arp_message.hh"
+#include "parallel_router.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+EthernetAddress ethernet_address( size_t index )
+{
+  return { 0x02, 0, 0, 0, static_cast<uint8_t>( index >> 8 ), static_cast<uint8_t>( index ) };
+}
+
+// Interface i is 10.i.0.1; its only neighbour is 10.i.0.2
+uint32_t subnet( size_t i )
+{
+  return 10U << 24 | static_cast<uint32_t>( i ) << 16;
+}
+
+// `num_interfaces` workers; a host on each interface sends to the host on the next interface around
+// the ring and receives from the previous one, so every packet crosses between two workers
+void scaling_test( const size_t num_interfaces, const size_t total_packets )
+{
+  ParallelRouter router;
+  for ( size_t i = 0; i < num_interfaces; ++i ) {
+    router.add_interface( { ethernet_address( i ), Address::from_ipv4_numeric( subnet( i ) | 1 ) } );
+    router.add_route( subnet( i ), 16, {}, i );
+  }
+  router.start();
+
+  for ( size_t i = 0; i < num_interfaces; ++i ) {
+    ARPMessage reply;
+    reply.opcode = ARPMessage::OPCODE_REPLY;
+    reply.sender_ethernet_address = ethernet_address( 1000 + i );
+    reply.sender_ip_address = subnet( i ) | 2;
+    reply.target_ethernet_address = ethernet_address( i );
+    reply.target_ip_address = subnet( i ) | 1;
+    router.recv_frame( i,
+                       { { ethernet_address( i ), ethernet_address( 1000 + i ), EthernetHeader::TYPE_ARP },
+                         serialize( reply ) } );
+  }
+
+  const size_t per_interface = total_packets / num_interfaces;
+  atomic<size_t> delivered {};
+  const auto start_time = steady_clock::now();
+  const auto deadline = start_time + seconds( 10 );
+
+  vector<thread> hosts;
+  for ( size_t i = 0; i < num_interfaces; ++i ) {
+    hosts.emplace_back( [&, i] {
+      InternetDatagram dgram;
+      dgram.header.src = subnet( i ) | 2;
+      dgram.header.dst = subnet( ( i + 1 ) % num_interfaces ) | 2;
+      dgram.payload.emplace_back( string( 64, 'x' ) );
+      dgram.header.len = IPv4Header::LENGTH + dgram.payload.back().size();
+      dgram.header.ttl = 64;
+      dgram.header.compute_checksum();
+      const EthernetFrame frame { { ethernet_address( i ), ethernet_address( 1000 + i ), EthernetHeader::TYPE_IPv4 },
+                                  serialize( dgram ) };
+
+      size_t sent = 0;
+      while ( delivered.load( memory_order_relaxed ) + router.dropped() < per_interface * num_interfaces
+              && steady_clock::now() < deadline ) {
+        bool busy = false;
+        for ( size_t n = 0; n < 32 && sent < per_interface; ++n ) {
+          EthernetFrame copy = frame;
+          if ( not router.recv_frame( i, std::move( copy ) ) ) {
+            break;
+          }
+          ++sent;
+          busy = true;
+        }
+        size_t got = 0;
+        while ( auto out = router.maybe_send( i ) ) {
+          got += out->header.type == EthernetHeader::TYPE_IPv4;
+          busy = true;
+        }
+        delivered.fetch_add( got, memory_order_relaxed );
+        if ( not busy ) {
+          this_thread::yield();
+        }
+      }
+    } );
+  }
+  for ( auto& host : hosts ) {
+    host.join();
+  }
+  const auto stop_time = steady_clock::now();
+  router.stop();
+
+  auto const mpps = static_cast<double>( delivered ) / duration<double>( stop_time - start_time ).count() / 1e6;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "ParallelRouter with " << num_interfaces << " workers (" << thread::hardware_concurrency()
+       << " CPUs) forwarded " << delivered << " of " << per_interface * num_interfaces << " datagrams ("
+       << router.dropped() << " dropped) at " << fixed << setprecision( 2 ) << mpps << " Mpkt/s.\n";
+  debug_output << "   ParallelRouter (" << num_interfaces << " workers): " << fixed << setprecision( 2 ) << mpps
+               << " Mpkt/s\n";
+
+  if ( delivered == 0 ) {
+    throw runtime_error( "ParallelRouter forwarded nothing." );
+  }
+}
+} // namespace
+
+void program_body()
+{
+  for ( size_t workers : { 1, 2, 4, 8, 16 } ) {
+    scaling_test( workers, 200000 );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,159 @@
+#include "common.hh"
+#include "parser.hh"
+
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+const string WIRE { "\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f", 15 };
+
+struct Fields
+{
+  uint8_t a {};
+  uint16_t b {};
+  uint32_t c {};
+  uint64_t d {};
+
+  void parse( Parser& parser )
+  {
+    parser.integer( a );
+    parser.integer( b );
+    parser.integer( c );
+    parser.integer( d );
+  }
+
+  bool operator==( const Fields& other ) const = default;
+};
+
+const Fields EXPECTED { 0x01, 0x0203, 0x04050607, 0x08090a0b0c0d0e0f };
+
+// WIRE cut at every position in `cuts`, with an empty Buffer thrown in between
+vector<Buffer> split( const vector<size_t>& cuts )
+{
+  vector<Buffer> out;
+  size_t start = 0;
+  for ( const size_t cut : cuts ) {
+    out.emplace_back( WIRE.substr( start, cut - start ) );
+    out.emplace_back();
+    start = cut;
+  }
+  out.emplace_back( WIRE.substr( start ) );
+  return out;
+}
+} // namespace
+
+int main()
+{
+  try {
+    // 一整块（快速路径）和各种切法（字段跨块）读出来的值都一样
+    {
+      Fields fields;
+      check( parse( fields, { WIRE } ), "contiguous parse" );
+      check( fields == EXPECTED, "contiguous parse reads big-endian integers" );
+    }
+    for ( size_t cut = 1; cut < WIRE.size(); ++cut ) {
+      Fields fields;
+      check( parse( fields, split( { cut } ) ) and fields == EXPECTED, "split at " + to_string( cut ) );
+    }
+    {
+      Fields fields;
+      check( parse( fields, split( { 1, 2, 3, 5, 8, 9, 10, 11, 12, 13, 14 } ) ) and fields == EXPECTED,
+             "one byte per buffer" );
+    }
+
+    // 输入不够：报错，之后的字段也不读
+    {
+      Fields fields;
+      check( not parse( fields, { WIRE.substr( 0, 14 ) } ), "truncated input is an error" );
+      check( fields.c == EXPECTED.c and fields.d == 0, "short field is left untouched" );
+
+      Parser parser { { WIRE } };
+      parser.set_error();
+      uint8_t byte {};
+      parser.integer( byte );
+      check( byte == 0, "nothing is read after an error" );
+    }
+
+    // 读了一部分以后，剩下的字节原样交出
+    {
+      Parser parser { split( { 4, 9 } ) };
+      uint16_t first {};
+      parser.integer( first );
+      array<char, 3> middle {};
+      parser.string( middle );
+      check( first == 0x0102 and string( middle.data(), middle.size() ) == "\x03\x04\x05", "string across buffers" );
+      vector<Buffer> rest;
+      parser.all_remaining( rest );
+      string joined;
+      for ( const auto& buffer : rest ) {
+        joined += string_view { buffer };
+      }
+      check( joined == WIRE.substr( 5 ), "all_remaining returns the unread bytes" );
+      check( not parser.has_error(), "no error" );
+    }
+
+    // 读完头部以后剩下的部分是原 Buffer 的切片，不拷贝
+    {
+      const Buffer wire { WIRE };
+      Parser parser { { wire } };
+      uint32_t header {};
+      parser.integer( header );
+      Buffer payload;
+      parser.all_remaining( payload );
+      check( string_view { payload } == WIRE.substr( 4 ), "payload bytes" );
+      check( string_view { payload }.data() == string_view { wire }.data() + 4, "payload shares the input's storage" );
+    }
+
+    // 跨多个 Buffer 的剩余部分拼成一个 Buffer；之前 out 指向的存储不受影响
+    {
+      Parser parser { split( { 3, 7, 11 } ) };
+      uint16_t header {};
+      parser.integer( header );
+      const Buffer shared { "keep me" };
+      Buffer payload = shared;
+      parser.all_remaining( payload );
+      check( string_view { payload } == WIRE.substr( 2 ), "remaining bytes flattened in order" );
+      check( string_view { shared } == "keep me", "flattening leaves the Buffer it replaced alone" );
+      check( parser.input().empty(), "nothing left after all_remaining" );
+    }
+
+    // Serializer：整数按大端写，和 Parser 读出来的一致
+    {
+      Serializer serializer;
+      serializer.reserve( WIRE.size() );
+      serializer.integer( EXPECTED.a );
+      serializer.integer( EXPECTED.b );
+      serializer.integer( EXPECTED.c );
+      serializer.integer( EXPECTED.d );
+      check( serializer.pending() == WIRE, "integers written big-endian" );
+      const auto out = serializer.output();
+      check( out.size() == 1 and string_view { out.front() } == WIRE, "output is one Buffer" );
+      check( serializer.output().empty(), "output leaves the Serializer empty" );
+    }
+
+    // 调用者提供的缓冲：reclaim() 交回来以后给下一个 Serializer 用，不再分配
+    {
+      string scratch;
+      scratch.reserve( 64 );
+      const char* storage = scratch.data();
+      for ( int round = 0; round < 3; ++round ) {
+        Serializer serializer { std::move( scratch ) };
+        serializer.integer( uint32_t { 0x01020304 } );
+        check( serializer.pending() == "\x01\x02\x03\x04", "reused buffer starts empty" );
+        scratch = serializer.reclaim();
+        check( scratch.empty() and scratch.data() == storage, "reclaim() keeps the caller's storage" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,217 @@
+#include "arp_message.hh"
+#include "ethernet_header.hh"
+#include "ipv4_header.hh"
+#include "parser.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+// The field-by-field codec the headers used before FixedLayout, kept here for comparison
+struct FieldByFieldEthernet
+{
+  EthernetHeader header {};
+
+  void parse( Parser& parser )
+  {
+    for ( auto& b : header.dst ) {
+      parser.integer( b );
+    }
+    for ( auto& b : header.src ) {
+      parser.integer( b );
+    }
+    parser.integer( header.type );
+  }
+};
+
+struct FieldByFieldIPv4
+{
+  IPv4Header header {};
+
+  void parse( Parser& parser )
+  {
+    uint8_t first_byte {};
+    parser.integer( first_byte );
+    header.ver = first_byte >> 4;
+    header.hlen = first_byte & 0x0f;
+    parser.integer( header.tos );
+    parser.integer( header.len );
+    parser.integer( header.id );
+    uint16_t fo_val {};
+    parser.integer( fo_val );
+    header.df = static_cast<bool>( fo_val & 0x4000 );
+    header.mf = static_cast<bool>( fo_val & 0x2000 );
+    header.offset = fo_val & 0x1fff;
+    parser.integer( header.ttl );
+    parser.integer( header.proto );
+    parser.integer( header.cksum );
+    parser.integer( header.src );
+    parser.integer( header.dst );
+
+    if ( header.ver != 4 or header.hlen < 5 ) {
+      parser.set_error();
+    }
+    const uint16_t given_cksum = header.cksum;
+    header.compute_checksum();
+    if ( header.cksum != given_cksum ) {
+      parser.set_error();
+    }
+  }
+};
+
+struct FieldByFieldARP
+{
+  ARPMessage msg {};
+
+  void parse( Parser& parser )
+  {
+    parser.integer( msg.hardware_type );
+    parser.integer( msg.protocol_type );
+    parser.integer( msg.hardware_address_size );
+    parser.integer( msg.protocol_address_size );
+    parser.integer( msg.opcode );
+    if ( not msg.supported() ) {
+      parser.set_error();
+      return;
+    }
+    for ( auto& b : msg.sender_ethernet_address ) {
+      parser.integer( b );
+    }
+    parser.integer( msg.sender_ip_address );
+    for ( auto& b : msg.target_ethernet_address ) {
+      parser.integer( b );
+    }
+    parser.integer( msg.target_ip_address );
+  }
+};
+
+// Parse `count` copies of `wire` as a T and report headers per second
+template<class T>
+void parser_speed_test( const string& name, const vector<Buffer>& wire, const size_t count )
+{
+  size_t parsed = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < count; ++i ) {
+    T header;
+    parsed += parse( header, wire );
+  }
+  const auto stop_time = steady_clock::now();
+
+  if ( parsed != count ) {
+    throw runtime_error( name + " failed to parse" );
+  }
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto megaheaders_per_second = static_cast<double>( count ) / test_duration.count() / 1e6;
+  auto ns_per_header = test_duration.count() * 1e9 / static_cast<double>( count );
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "Parser (" << name << ") reached " << fixed << setprecision( 2 ) << megaheaders_per_second
+       << " M headers/s (" << ns_per_header << " ns each).\n";
+
+  debug_output << "   Parser (" << name << "): " << fixed << setprecision( 2 ) << megaheaders_per_second
+               << " M headers/s\n";
+
+  if ( megaheaders_per_second < 0.1 ) {
+    throw runtime_error( "Parser did not meet minimum speed of 0.1 M headers/s." );
+  }
+}
+
+// Serialize (and checksum) `count` IPv4 headers and report headers per second
+void serializer_speed_test( IPv4Header header, const size_t count )
+{
+  size_t bytes = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < count; ++i ) {
+    header.id = static_cast<uint16_t>( i );
+    header.compute_checksum();
+    bytes += serialize( header ).front().size();
+  }
+  const auto stop_time = steady_clock::now();
+
+  if ( bytes != count * IPv4Header::LENGTH ) {
+    throw runtime_error( "Serializer wrote the wrong number of bytes" );
+  }
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto megaheaders_per_second = static_cast<double>( count ) / test_duration.count() / 1e6;
+  auto ns_per_header = test_duration.count() * 1e9 / static_cast<double>( count );
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "Serializer (IPv4Header with checksum) reached " << fixed << setprecision( 2 ) << megaheaders_per_second
+       << " M headers/s (" << ns_per_header << " ns each).\n";
+
+  debug_output << "   Serializer (IPv4Header with checksum): " << fixed << setprecision( 2 )
+               << megaheaders_per_second << " M headers/s\n";
+
+  if ( megaheaders_per_second < 0.1 ) {
+    throw runtime_error( "Serializer did not meet minimum speed of 0.1 M headers/s." );
+  }
+}
+
+void program_body()
+{
+  IPv4Header ip;
+  ip.len = 1500;
+  ip.src = 0x0a000001;
+  ip.dst = 0x0a000002;
+  ip.compute_checksum();
+
+  EthernetHeader eth;
+  eth.dst = { 0x02, 0, 0, 0, 0, 1 };
+  eth.src = { 0x02, 0, 0, 0, 0, 2 };
+  eth.type = EthernetHeader::TYPE_IPv4;
+
+  ARPMessage arp;
+  arp.opcode = ARPMessage::OPCODE_REQUEST;
+  arp.sender_ethernet_address = eth.src;
+  arp.sender_ip_address = ip.src;
+  arp.target_ip_address = ip.dst;
+
+  // 一块连续的线上字节（快速路径），以及每个字节一块（慢速路径，作为对照）
+  const auto bytewise = []( const vector<Buffer>& wire ) {
+    vector<Buffer> out;
+    for ( const auto& buffer : wire ) {
+      for ( const char c : string_view { buffer } ) {
+        out.emplace_back( string( 1, c ) );
+      }
+    }
+    return out;
+  };
+
+  parser_speed_test<IPv4Header>( "IPv4Header", serialize( ip ), 5'000'000 );
+  parser_speed_test<FieldByFieldIPv4>( "IPv4Header, field by field", serialize( ip ), 5'000'000 );
+  parser_speed_test<EthernetHeader>( "EthernetHeader", serialize( eth ), 5'000'000 );
+  parser_speed_test<FieldByFieldEthernet>( "EthernetHeader, field by field", serialize( eth ), 5'000'000 );
+  parser_speed_test<ARPMessage>( "ARPMessage", serialize( arp ), 5'000'000 );
+  parser_speed_test<FieldByFieldARP>( "ARPMessage, field by field", serialize( arp ), 5'000'000 );
+  parser_speed_test<IPv4Header>( "IPv4Header, one byte per Buffer", bytewise( serialize( ip ) ), 500'000 );
+  serializer_speed_test( ip, 5'000'000 );
+}
+} // namespace
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,255 @@
+#include "common.hh"
+#include "exception.hh"
+#include "network_interface.hh"
+#include "pcap.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <vector>
+
+using namespace std;
+
+namespace {
+const EthernetAddress LOCAL_ETH { 0x02, 0, 0, 0, 0, 1 };
+const EthernetAddress REMOTE_ETH { 0x02, 0, 0, 0, 0, 2 };
+const Address LOCAL_IP { "10.0.0.1" };
+const Address REMOTE_IP { "10.0.0.2" };
+
+string wire( const EthernetFrame& frame )
+{
+  string out;
+  for ( const auto& buffer : serialize( frame ) ) {
+    out += string_view { buffer };
+  }
+  return out;
+}
+
+EthernetFrame datagram_frame( const EthernetAddress& dst, size_t payload_size )
+{
+  InternetDatagram dgram;
+  dgram.header.src = REMOTE_IP.ipv4_numeric();
+  dgram.header.dst = LOCAL_IP.ipv4_numeric();
+  dgram.payload.emplace_back( string( payload_size, 'd' ) );
+  dgram.header.len = IPv4Header::LENGTH + payload_size;
+  dgram.header.compute_checksum();
+  return { { dst, REMOTE_ETH, EthernetHeader::TYPE_IPv4 }, serialize( dgram ) };
+}
+
+FileDescriptor memfd()
+{
+  return FileDescriptor { CheckSystemCall( "memfd_create", ::memfd_create( "pcap_test", 0 ) ) };
+}
+
+vector<PcapReader::Record> read_all( const FileDescriptor& fd )
+{
+  PcapReader reader { MappedFile { fd } };
+  vector<PcapReader::Record> records;
+  while ( auto record = reader.next() ) {
+    records.push_back( std::move( *record ) );
+  }
+  return records;
+}
+
+void round_trip_test( PcapWriter::Format format )
+{
+  const string name = format == PcapWriter::Format::Pcap ? "pcap: " : "pcapng: ";
+  const FileDescriptor file = memfd();
+  const vector<EthernetFrame> frames {
+    datagram_frame( LOCAL_ETH, 0 ), datagram_frame( LOCAL_ETH, 1 ), datagram_frame( LOCAL_ETH, 3000 ) };
+  {
+    PcapWriter writer { file.duplicate(), { .format = format, .snaplen = 1000, .buffer_size = 100 } };
+    writer.write( frames[0], CaptureDirection::Inbound, 1'700'000'000'123'456'789 );
+    writer.write( frames[1], CaptureDirection::Outbound, 1'700'000'001'000'000'001 );
+    writer.write( frames[2], CaptureDirection::Unknown, 1'700'000'002'000'000'000 );
+    check( writer.frames() == 3, name + "three frames written" );
+  }
+
+  PcapReader reader { MappedFile { file } };
+  check( reader.format() == format, name + "format recognised" );
+  const auto records = read_all( file );
+  check( records.size() == 3, name + "three records" );
+  check( records[0].timestamp_ns == 1'700'000'000'123'456'789, name + "nanosecond timestamp" );
+  check( records[1].timestamp_ns == 1'700'000'001'000'000'001, name + "second timestamp" );
+  for ( size_t i = 0; i < 2; ++i ) {
+    check( string_view { records[i].bytes } == wire( frames[i] ), name + "frame bytes" );
+    check( records[i].original_length == records[i].bytes.size(), name + "not truncated" );
+    const auto frame = records[i].frame();
+    check( frame.has_value() and frame->header.dst == LOCAL_ETH, name + "frame parses" );
+  }
+  check( records[2].bytes.size() == 1000 and records[2].original_length == wire( frames[2] ).size()
+           and string_view { records[2].bytes } == wire( frames[2] ).substr( 0, 1000 ),
+         name + "snaplen truncates" );
+  if ( format == PcapWriter::Format::PcapNg ) {
+    check( records[0].direction == CaptureDirection::Inbound and records[1].direction == CaptureDirection::Outbound
+             and records[2].direction == CaptureDirection::Unknown,
+           name + "directions" );
+  }
+
+  // 从头再读一遍
+  check( reader.next().has_value(), name + "first record" );
+  reader.rewind();
+  auto const again = reader.next();
+  check( again.has_value() and string_view { again->bytes } == wire( frames[0] ), name + "rewind" );
+}
+
+// 别的程序写的文件：大端序、微秒时间戳的 pcap
+void foreign_pcap_test()
+{
+  const auto big16 = []( string& out, uint16_t v ) {
+    out.push_back( static_cast<char>( v >> 8 ) );
+    out.push_back( static_cast<char>( v ) );
+  };
+  const auto big32 = [&]( string& out, uint32_t v ) {
+    big16( out, static_cast<uint16_t>( v >> 16 ) );
+    big16( out, static_cast<uint16_t>( v ) );
+  };
+  const string frame = wire( datagram_frame( LOCAL_ETH, 10 ) );
+  string file;
+  big32( file, 0xa1b2c3d4 );
+  big16( file, 2 );
+  big16( file, 4 );
+  big32( file, 0 );
+  big32( file, 0 );
+  big32( file, 65535 );
+  big32( file, 1 );
+  big32( file, 100 );
+  big32( file, 250 );
+  big32( file, frame.size() );
+  big32( file, frame.size() );
+  file += frame;
+
+  FileDescriptor fd = memfd();
+  fd.write( file );
+  const auto records = read_all( fd );
+  check( records.size() == 1 and string_view { records[0].bytes } == frame, "big-endian pcap" );
+  check( records[0].timestamp_ns == 100'000'250'000, "microsecond timestamps" );
+
+  FileDescriptor truncated = memfd();
+  truncated.write( file.substr( 0, file.size() - 1 ) );
+  bool threw = false;
+  try {
+    read_all( truncated );
+  } catch ( const runtime_error& ) {
+    threw = true;
+  }
+  check( threw, "truncated record" );
+}
+
+// 长度字段坏掉的 pcapng：节头长度为 0（以前会原地打转）、简单包块短到放不下包长和尾部长度
+void malformed_pcapng_test()
+{
+  const auto put32 = []( string& out, uint32_t v ) { out.append( reinterpret_cast<const char*>( &v ), 4 ); };
+  const auto section_header = [&]( string& out, uint32_t length ) {
+    put32( out, 0x0a0d0d0a );
+    put32( out, length );
+    put32( out, 0x1a2b3c4d );
+    put32( out, 1 ); // 版本 1.0
+    put32( out, UINT32_MAX );
+    put32( out, UINT32_MAX ); // 节长度未知
+    put32( out, length );
+  };
+  const auto interface = [&]( string& out ) {
+    put32( out, 1 );
+    put32( out, 20 );
+    put32( out, 1 ); // 以太网
+    put32( out, 65535 );
+    put32( out, 20 );
+  };
+  const auto throws = [&]( const string& file ) {
+    FileDescriptor fd = memfd();
+    fd.write( file );
+    try {
+      read_all( fd );
+    } catch ( const runtime_error& ) {
+      return true;
+    }
+    return false;
+  };
+
+  string good;
+  section_header( good, 28 );
+  interface( good );
+  check( not throws( good ), "well-formed pcapng" );
+
+  string empty_first;
+  section_header( empty_first, 0 );
+  check( throws( empty_first ), "zero-length first section header" );
+
+  string empty_second = good;
+  section_header( empty_second, 0 );
+  check( throws( empty_second ), "zero-length second section header" );
+
+  string unaligned = good;
+  section_header( unaligned, 30 );
+  unaligned += "xx";
+  check( throws( unaligned ), "unaligned section header" );
+
+  string short_simple = good;
+  put32( short_simple, 3 );
+  put32( short_simple, 12 );
+  put32( short_simple, 12 );
+  check( throws( short_simple ), "simple packet block too short for its length field" );
+}
+
+// NetworkInterface 的捕获：收到的（包括不是给它的）和发出的帧都记下来，按发生的顺序
+void interface_capture_test()
+{
+  const FileDescriptor file = memfd();
+  auto writer = make_shared<PcapWriter>( file.duplicate() );
+  NetworkInterface iface { LOCAL_ETH, LOCAL_IP };
+  iface.capture( writer );
+
+  const auto to_us = datagram_frame( LOCAL_ETH, 20 );
+  const auto to_other = datagram_frame( { 0x02, 0, 0, 0, 0, 9 }, 20 );
+  check( iface.recv_frame( to_us ).has_value(), "datagram received" );
+  check( not iface.recv_frame( to_other ).has_value(), "someone else's frame ignored" );
+
+  InternetDatagram dgram;
+  dgram.header.src = LOCAL_IP.ipv4_numeric();
+  dgram.header.dst = REMOTE_IP.ipv4_numeric();
+  dgram.header.len = IPv4Header::LENGTH;
+  dgram.header.compute_checksum();
+  iface.send_datagram( dgram, REMOTE_IP ); // 先发 ARP 请求
+  const auto request = iface.maybe_send();
+  check( request.has_value() and request->header.type == EthernetHeader::TYPE_ARP, "ARP request" );
+
+  vector<InternetDatagram> datagrams;
+  check( iface.recv_frames( vector<EthernetFrame> { to_us, to_us }, datagrams ) == 2, "batch received" );
+  iface.capture( nullptr );
+  iface.recv_frame( to_us );
+  writer->flush();
+
+  const auto records = read_all( file );
+  check( records.size() == 5, "five frames captured, got " + to_string( records.size() ) );
+  check( string_view { records[0].bytes } == wire( to_us ) and records[0].direction == CaptureDirection::Inbound,
+         "received frame" );
+  check( string_view { records[1].bytes } == wire( to_other ), "frame for someone else" );
+  check( string_view { records[2].bytes } == wire( *request ) and records[2].direction == CaptureDirection::Outbound,
+         "sent frame" );
+  check( records[3].direction == CaptureDirection::Inbound and records[4].direction == CaptureDirection::Inbound,
+         "batch received" );
+  check( records[0].timestamp_ns <= records[4].timestamp_ns, "timestamps in order" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    round_trip_test( PcapWriter::Format::Pcap );
+    round_trip_test( PcapWriter::Format::PcapNg );
+    foreign_pcap_test();
+    malformed_pcapng_test();
+    interface_capture_test();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
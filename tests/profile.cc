@@ -0,0 +1,67 @@
+#include "common.hh"
+#include "profile.hh"
+
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+int main()
+{
+  try {
+    // 桶边界：小值精确，大值误差不超过 1/16
+    for ( uint64_t v : { 0UL, 1UL, 31UL, 32UL, 33UL, 1000UL, 123456789UL, UINT64_MAX } ) {
+      const size_t b = LatencyHistogram::bucket( v );
+      check( b < LatencyHistogram::NUM_BUCKETS, "bucket out of range for " + to_string( v ) );
+      check( LatencyHistogram::bucket_max( b ) >= v, "bucket_max below value " + to_string( v ) );
+      check( LatencyHistogram::bucket_max( b ) - v <= v / LatencyHistogram::SUB_BUCKETS,
+             "bucket too wide for " + to_string( v ) );
+      if ( b > 0 ) {
+        check( LatencyHistogram::bucket_max( b - 1 ) < v, "previous bucket holds " + to_string( v ) );
+      }
+    }
+
+    LatencyHistogram h;
+    for ( uint64_t v = 1; v <= 1000; ++v ) {
+      h.record( v );
+    }
+    check( h.count() == 1000 && h.min() == 1 && h.max() == 1000, "count/min/max" );
+    check( h.mean() == 500.5, "mean" );
+    check( h.percentile( 0.5 ) >= 500 && h.percentile( 0.5 ) <= 500 + 500 / 16, "p50" );
+    check( h.percentile( 1.0 ) == 1000, "p100" );
+
+    LatencyHistogram copy = h;
+    copy.merge( h );
+    check( copy.count() == 2000 && copy.max() == 1000, "merge" );
+    copy.clear();
+    check( copy.count() == 0 && copy.min() == 0 && copy.percentile( 0.5 ) == 0, "clear" );
+
+    // 已退出线程的数据也要算进 snapshot()
+    Profile::reset();
+    Profile::record( Profile::PARSE, 10 );
+    thread { [] {
+      Profile::record( Profile::PARSE, 20 );
+      Profile::record( Profile::ROUTER_ROUTE, 5 );
+    } }.join();
+    const auto snapshot = Profile::snapshot();
+    check( snapshot[Profile::PARSE].count() == 2 && snapshot[Profile::PARSE].max() == 20, "per-thread merge" );
+    check( snapshot[Profile::ROUTER_ROUTE].count() == 1, "exited thread lost" );
+
+    ostringstream dumped;
+    Profile::dump( dumped );
+    check( dumped.str().find( "parse" ) != string::npos && dumped.str().find( "Router::route_batch" ) != string::npos,
+           "dump: " + dumped.str() );
+    check( dumped.str().find( "serialize" ) == string::npos, "dump lists an empty point" );
+
+    Profile::reset();
+    check( Profile::snapshot()[Profile::PARSE].count() == 0, "reset" );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,138 @@
+#include "random.hh"
+#include "reassembler_test_harness.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto const bitmap = Reassembler::Engine::Bitmap;
+
+    {
+      ReassemblerTestHarness test { "bitmap: holes", 65000, bitmap };
+
+      test.execute( Insert { "b", 1 } );
+      test.execute( BytesPushed( 0 ) );
+      test.execute( BytesPending( 1 ) );
+      test.execute( Insert { "d", 3 } );
+      test.execute( BytesPending( 2 ) );
+      test.execute( Insert { "abc", 0 } );
+      test.execute( BytesPushed( 4 ) );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( "abcd" ) );
+      test.execute( Insert { "e", 4 }.is_last() );
+      test.execute( ReadAll( "e" ) );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      ReassemblerTestHarness test { "bitmap: overlapping stored bytes", 1000, bitmap };
+
+      test.execute( Insert { "cd", 2 } );
+      test.execute( Insert { "def", 3 } );
+      test.execute( BytesPending( 4 ) );
+      test.execute( Insert { "bcdefgh", 1 } );
+      test.execute( BytesPending( 7 ) );
+      test.execute( Insert { "a", 0 } );
+      test.execute( BytesPending( 0 ) );
+      test.execute( ReadAll( "abcdefgh" ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "bitmap: in-order data replaces stored bytes", 1000, bitmap };
+
+      test.execute( Insert { "cd", 2 } );
+      test.execute( Insert { "xyz", 10 } );
+      test.execute( BytesPending( 5 ) );
+      test.execute( Insert { "abcdef", 0 } );
+      test.execute( BytesPending( 3 ) );
+      test.execute( ReadAll( "abcdef" ) );
+    }
+
+    {
+      ReassemblerTestHarness test { "bitmap: capacity and wrap around", 8, bitmap };
+
+      test.execute( Insert { "abcdef", 0 } );
+      test.execute( ReadAll( "abcdef" ) );
+      // 窗口是 [6, 14)，ring 中的位置是 6, 7, 0, 1, ...
+      test.execute( Insert { "jklmnopq", 9 } );
+      test.execute( BytesPending( 5 ) );
+      test.execute( Insert { "ghi", 6 } );
+      test.execute( BytesPending( 0 ) );
+      test.execute( BytesPushed( 14 ) );
+      test.execute( ReadAll( "ghijklmn" ) );
+      test.execute( Insert { "opq", 14 }.is_last() );
+      test.execute( ReadAll( "opq" ) );
+      test.execute( IsFinished { true } );
+    }
+
+    {
+      ReassemblerTestHarness test { "bitmap: truncated last substring", 4, bitmap };
+
+      test.execute( Insert { "cdef", 2 }.is_last() );
+      test.execute( BytesPending( 2 ) );
+      test.execute( Insert { "ab", 0 } );
+      test.execute( ReadAll( "abcd" ) );
+      test.execute( IsFinished { false } );
+      test.execute( Insert { "ef", 4 }.is_last() );
+      test.execute( ReadAll( "ef" ) );
+      test.execute( IsFinished { true } );
+    }
+
+    // 随机乱序、重叠、小容量（经常绕回和截断），两个 engine 的结果必须一致
+    auto rd = get_random_engine();
+    for ( unsigned rep_no = 0; rep_no < 64; ++rep_no ) {
+      const uint64_t capacity = 1 + rd() % 300;
+      const size_t total = 1 + rd() % 4000;
+      string d( total, 0 );
+      generate( d.begin(), d.end(), [&] { return rd(); } );
+
+      ByteStream intervals_stream { capacity }, bitmap_stream { capacity };
+      Reassembler intervals, bitmap_engine { bitmap };
+      string intervals_out, bitmap_out;
+
+      while ( intervals_out.size() < d.size() ) {
+        const size_t next = intervals_out.size();
+        const size_t first = next - min<size_t>( next, rd() % 50 ) + rd() % ( 2 * capacity );
+        if ( first >= d.size() ) {
+          continue;
+        }
+        const size_t len = 1 + rd() % ( capacity + 20 );
+        const auto segment = d.substr( first, len );
+        const bool last = first + segment.size() == d.size();
+        intervals.insert( first, segment, last, intervals_stream.writer() );
+        bitmap_engine.insert( first, segment, last, bitmap_stream.writer() );
+
+        if ( intervals.bytes_pending() != bitmap_engine.bytes_pending()
+             or intervals_stream.reader().bytes_buffered() != bitmap_stream.reader().bytes_buffered()
+             or intervals_stream.writer().is_closed() != bitmap_stream.writer().is_closed() ) {
+          throw runtime_error( "bitmap engine diverged from intervals engine (rep " + to_string( rep_no ) + ")" );
+        }
+
+        // 随机读走一部分，让窗口前进
+        const auto to_read = rd() % ( intervals_stream.reader().bytes_buffered() + 1 );
+        string chunk;
+        read( intervals_stream.reader(), to_read, chunk );
+        intervals_out += chunk;
+        read( bitmap_stream.reader(), to_read, chunk );
+        bitmap_out += chunk;
+      }
+
+      if ( bitmap_out != d or intervals_out != d or not bitmap_stream.reader().is_finished() ) {
+        throw runtime_error( "bitmap engine produced the wrong stream (rep " + to_string( rep_no ) + ")" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
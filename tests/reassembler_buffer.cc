@@ -0,0 +1,113 @@
+#include "random.hh"
+#include "reassembler_test_harness.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+int main()
+{
+  try {
+    for ( auto engine : { Reassembler::Engine::Intervals, Reassembler::Engine::Bitmap } ) {
+      {
+        ReassemblerTestHarness test { "buffer: in-order insert is not copied", 65000, engine };
+        const Buffer segment { "abcdefgh" };
+
+        test.execute( InsertBuffer { segment, 0 } );
+        test.execute( BytesPending( 0 ) );
+        test.execute( BytesPushed( 8 ) );
+        test.execute( ReadBuffers { 8, { "abcdefgh" } }.sharing( segment ) );
+      }
+
+      {
+        ReassemblerTestHarness test { "buffer: duplicate prefix and capacity are sliced off", 6, engine };
+        const Buffer first { "abc" };
+        const Buffer second { "bcdefghij" };
+
+        test.execute( InsertBuffer { first, 0 } );
+        test.execute( ReadBuffers { 3, { "abc" } }.sharing( first ) );
+        test.execute( InsertBuffer { second, 1 }.is_last() );
+        test.execute( BytesPushed( 9 ) );
+        test.execute( IsClosed { false } );
+        test.execute( ReadBuffers { 6, { "defghi" } }.sharing( second.substr( 2 ) ) );
+      }
+
+      {
+        ReassemblerTestHarness test { "buffer: slice inserted", 65000, engine };
+        const Buffer payload { "xxhello worldyy" };
+        const Buffer hello = payload.substr( 2, 5 );
+        const Buffer world = payload.substr( 7, 6 );
+
+        test.execute( InsertBuffer { world, 5 }.is_last() );
+        test.execute( BytesPending( 6 ) );
+        test.execute( InsertBuffer { hello, 0 } );
+        test.execute( BytesPending( 0 ) );
+        test.execute( IsClosed { true } );
+        test.execute( ReadBuffers { 11, { "hello", " world" } }.sharing( hello ) );
+        test.execute( IsFinished { true } );
+      }
+
+      {
+        ReassemblerTestHarness test { "buffer: in-order insert stops at stored bytes", 65000, engine };
+        const Buffer tail { "efg" };
+        const Buffer head { "abcdef" };
+
+        test.execute( InsertBuffer { tail, 4 }.is_last() );
+        test.execute( InsertBuffer { head, 0 } );
+        test.execute( BytesPending( 0 ) );
+        test.execute( IsClosed { true } );
+        test.execute( ReadAll( "abcdefg" ) );
+      }
+
+      {
+        ReassemblerTestHarness test { "buffer: empty last substring", 65000, engine };
+
+        test.execute( InsertBuffer { Buffer { "cd" }, 2 } );
+        test.execute( InsertBuffer { Buffer {}, 4 }.is_last() );
+        test.execute( IsClosed { false } );
+        test.execute( InsertBuffer { Buffer { "ab" }, 0 } );
+        test.execute( IsClosed { true } );
+        test.execute( ReadAll( "abcd" ) );
+      }
+
+      // 随机乱序、重叠的 Buffer 切片
+      auto rd = get_random_engine();
+      for ( unsigned rep_no = 0; rep_no < 32; ++rep_no ) {
+        const uint64_t capacity = 1 + rd() % 3000;
+        const size_t total = 1 + rd() % 20000;
+        string d( total, 0 );
+        generate( d.begin(), d.end(), [&] { return rd(); } );
+        const Buffer whole { d };
+
+        ByteStream stream { capacity };
+        Reassembler reassembler { engine };
+        string out;
+        while ( out.size() < d.size() ) {
+          const size_t first = out.size() - min<size_t>( out.size(), rd() % 100 ) + rd() % ( 2 * capacity );
+          if ( first >= d.size() ) {
+            continue;
+          }
+          const auto segment = whole.substr( first, 1 + rd() % 1500 );
+          reassembler.insert( first, segment, first + segment.size() == d.size(), stream.writer() );
+
+          string chunk;
+          read( stream.reader(), rd() % ( stream.reader().bytes_buffered() + 1 ), chunk );
+          out += chunk;
+        }
+        if ( out != d or not stream.reader().is_finished() ) {
+          throw runtime_error( "Reassembler produced the wrong stream from Buffer slices (rep "
+                               + to_string( rep_no ) + ")" );
+        }
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
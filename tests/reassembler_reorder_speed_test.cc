@@ -0,0 +1,112 @@
+#include "reassembler.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Heavy reordering: every window of `window_segments` segments arrives in a random order, so the
+// Reassembler holds up to that many separate intervals at once. Segments also overlap their
+// neighbours by a random amount, which exercises merging.
+void reorder_speed_test( const size_t num_segments,    // NOLINT(bugprone-easily-swappable-parameters)
+                         const size_t segment_size,    // NOLINT(bugprone-easily-swappable-parameters)
+                         const size_t window_segments, // NOLINT(bugprone-easily-swappable-parameters)
+                         const size_t random_seed,     // NOLINT(bugprone-easily-swappable-parameters)
+                         const Reassembler::Engine engine )
+{
+  default_random_engine rd { random_seed };
+
+  // Generate the data to be written
+  const string data = [&] {
+    uniform_int_distribution<char> ud;
+    string ret;
+    for ( size_t i = 0; i < num_segments * segment_size; ++i ) {
+      ret += ud( rd );
+    }
+    return ret;
+  }();
+
+  // Split the data into overlapping segments, then shuffle each window
+  vector<tuple<uint64_t, string, bool>> split_data;
+  uniform_int_distribution<size_t> overlap { 0, segment_size / 4 };
+  for ( size_t i = 0; i < data.size(); i += segment_size ) {
+    const size_t len = segment_size + overlap( rd );
+    split_data.emplace_back( i, data.substr( i, len ), i + len >= data.size() );
+  }
+  for ( size_t i = 0; i < split_data.size(); i += window_segments ) {
+    shuffle( split_data.begin() + i, split_data.begin() + min( i + window_segments, split_data.size() ), rd );
+  }
+
+  ByteStream stream { ( window_segments + 1 ) * segment_size * 2 };
+  Reassembler reassembler { engine };
+
+  string output_data;
+  output_data.reserve( data.size() );
+
+  const auto start_time = steady_clock::now();
+  for ( auto& [index, segment, last] : split_data ) {
+    reassembler.insert( index, move( segment ), last, stream.writer() );
+
+    while ( stream.reader().bytes_buffered() ) {
+      output_data += stream.reader().peek();
+      stream.reader().pop( output_data.size() - stream.reader().bytes_popped() );
+    }
+  }
+
+  const auto stop_time = steady_clock::now();
+
+  if ( not stream.reader().is_finished() ) {
+    throw runtime_error( "Reassembler did not close ByteStream when finished" );
+  }
+
+  if ( data != output_data ) {
+    throw runtime_error( "Mismatch between data written and read" );
+  }
+
+  auto test_duration = duration_cast<duration<double>>( stop_time - start_time );
+  auto bytes_per_second = static_cast<double>( data.size() ) / test_duration.count();
+  auto bits_per_second = 8 * bytes_per_second;
+  auto gigabits_per_second = bits_per_second / 1e9;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  const auto engine_name = engine == Reassembler::Engine::Bitmap ? "bitmap" : "intervals";
+  cout << "Reassembler (" << engine_name << ") with " << window_segments
+       << "-segment shuffled windows, segment_size=" << segment_size << " reached " << fixed << setprecision( 2 ) << gigabits_per_second << " Gbit/s.\n";
+
+  debug_output << "   Reassembler (" << engine_name << ") reordered throughput: " << fixed << setprecision( 2 )
+               << gigabits_per_second << " Gbit/s\n";
+
+  if ( gigabits_per_second < 0.1 ) {
+    throw runtime_error( "Reassembler did not meet minimum speed of 0.1 Gbit/s." );
+  }
+}
+
+void program_body()
+{
+  for ( auto engine : { Reassembler::Engine::Intervals, Reassembler::Engine::Bitmap } ) {
+    reorder_speed_test( 20000, 1000, 64, 4321, engine );
+    reorder_speed_test( 20000, 1000, 2048, 8765, engine );
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+#include "reassembler_test_harness.hh"
+
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+using S = Reassembler::Stats;
+
+int main()
+{
+  try {
+    {
+      ReassemblerTestHarness test { "stats: intervals and merges", 65000 };
+
+      test.execute( Insert { "b", 1 } );
+      test.execute( Insert { "d", 3 } );
+      test.execute( Insert { "f", 5 } );
+      test.execute( Stat { &S::intervals, "intervals", 3 } );
+      test.execute( Stat { &S::merges, "merges", 0 } );
+      test.execute( Insert { "bcdef", 1 } );
+      test.execute( Stat { &S::intervals, "intervals", 1 } );
+      test.execute( Stat { &S::intervals_peak, "intervals_peak", 3 } );
+      test.execute( Stat { &S::merges, "merges", 3 } );
+      test.execute( Stat { &S::bytes_duplicate, "bytes_duplicate", 3 } );
+      test.execute( Insert { "a", 0 } );
+      test.execute( Stat { &S::intervals, "intervals", 0 } );
+      test.execute( Stat { &S::intervals_peak, "intervals_peak", 3 } );
+      test.execute( ReadAll( "abcdef" ) );
+    }
+
+    for ( auto engine : { Reassembler::Engine::Intervals, Reassembler::Engine::Bitmap } ) {
+      {
+        ReassemblerTestHarness test { "stats: dropped beyond capacity", 4, engine };
+
+        test.execute( Insert { "abcdef", 0 } );
+        test.execute( Stat { &S::bytes_dropped, "bytes_dropped", 2 } );
+        test.execute( Insert { "xyz", 10 } );
+        test.execute( Stat { &S::bytes_dropped, "bytes_dropped", 5 } );
+        test.execute( ReadAll( "abcd" ) );
+        test.execute( Insert { "fgh", 5 } );
+        test.execute( Stat { &S::bytes_dropped, "bytes_dropped", 5 } );
+        test.execute( Stat { &S::bytes_duplicate, "bytes_duplicate", 0 } );
+      }
+
+      {
+        ReassemblerTestHarness test { "stats: duplicates", 65000, engine };
+
+        test.execute( Insert { "abcd", 0 } );
+        test.execute( Insert { "abcd", 0 } );
+        test.execute( Stat { &S::bytes_duplicate, "bytes_duplicate", 4 } );
+        test.execute( Insert { "ghij", 6 } );
+        test.execute( Insert { "ijkl", 8 } );
+        test.execute( Stat { &S::bytes_duplicate, "bytes_duplicate", 6 } );
+        test.execute( Insert { "cdefgh", 2 } );
+        test.execute( Stat { &S::bytes_duplicate, "bytes_duplicate", 10 } );
+        test.execute( BytesPending( 0 ) );
+        test.execute( ReadAll( "abcdefghijkl" ) );
+      }
+
+      {
+        ReassemblerTestHarness test { "stats: out-of-order distance", 65000, engine };
+
+        test.execute( Insert { "b", 1 } );
+        test.execute( Insert { "d", 3 } );
+        test.execute( Insert { "x", 1000 } );
+        test.execute( Insert { "a", 0 } );
+        test.execute( OutOfOrderDistance( 0, 1 ) );
+        test.execute( OutOfOrderDistance( 1, 1 ) );
+        test.execute( OutOfOrderDistance( 9, 1 ) );
+        test.execute( OutOfOrderDistance( 2, 0 ) );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
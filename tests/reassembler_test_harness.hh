@@ -28,10 +28,13 @@ struct ReassemblerByteStreamTestStep : public TestStep<StreamAndReassembler>
 class ReassemblerTestHarness : public TestHarness<StreamAndReassembler>
 {
 public:
-  ReassemblerTestHarness( std::string test_name, uint64_t capacity )
+  ReassemblerTestHarness( std::string test_name,
+                          uint64_t capacity,
+                          Reassembler::Engine engine = Reassembler::Engine::Intervals )
     : TestHarness( move( test_name ),
-                   "capacity=" + std::to_string( capacity ),
-                   { ByteStream { capacity }, Reassembler {} } )
+                   "capacity=" + std::to_string( capacity )
+                     + ( engine == Reassembler::Engine::Bitmap ? ", engine=bitmap" : "" ),
+                   { ByteStream { capacity }, Reassembler { engine } } )
   {}
 
   template<std::derived_from<TestStep<ByteStream>> T>
@@ -50,6 +53,34 @@ struct BytesPending : public ExpectNumber<StreamAndReassembler, uint64_t>
   uint64_t value( StreamAndReassembler& sr ) const override { return sr.second.bytes_pending(); }
 };
 
+// e.g. Stat { &Reassembler::Stats::merges, "merges", 2 }
+struct Stat : public ExpectNumber<StreamAndReassembler, uint64_t>
+{
+  uint64_t Reassembler::Stats::*field_;
+  std::string name_;
+
+  Stat( uint64_t Reassembler::Stats::*field, std::string name, uint64_t num )
+    : ExpectNumber( num ), field_( field ), name_( std::move( name ) )
+  {}
+  std::string name() const override { return "stats()." + name_; }
+  uint64_t value( StreamAndReassembler& sr ) const override { return sr.second.stats().*field_; }
+};
+
+struct OutOfOrderDistance : public ExpectNumber<StreamAndReassembler, uint64_t>
+{
+  size_t bucket_;
+
+  OutOfOrderDistance( size_t bucket, uint64_t num ) : ExpectNumber( num ), bucket_( bucket ) {}
+  std::string name() const override
+  {
+    return "stats().out_of_order_distance[" + std::to_string( bucket_ ) + "]";
+  }
+  uint64_t value( StreamAndReassembler& sr ) const override
+  {
+    return sr.second.stats().out_of_order_distance.at( bucket_ );
+  }
+};
+
 struct Insert : public Action<StreamAndReassembler>
 {
   std::string data_;
@@ -79,3 +110,33 @@ struct Insert : public Action<StreamAndReassembler>
     sr.second.insert( first_index_, data_, is_last_substring_, sr.first.writer() );
   }
 };
+
+struct InsertBuffer : public Action<StreamAndReassembler>
+{
+  Buffer data_;
+  uint64_t first_index_;
+  bool is_last_substring_ {};
+
+  InsertBuffer( Buffer data, uint64_t first_index ) : data_( std::move( data ) ), first_index_( first_index ) {}
+
+  InsertBuffer& is_last( bool status = true )
+  {
+    is_last_substring_ = status;
+    return *this;
+  }
+
+  std::string description() const override
+  {
+    std::ostringstream ss;
+    ss << "insert Buffer \"" << Printer::prettify( data_ ) << "\" @ index " << first_index_;
+    if ( is_last_substring_ ) {
+      ss << " [last substring]";
+    }
+    return ss.str();
+  }
+
+  void execute( StreamAndReassembler& sr ) const override
+  {
+    sr.second.insert( first_index_, data_, is_last_substring_, sr.first.writer() );
+  }
+};
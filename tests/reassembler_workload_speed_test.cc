@@ -0,0 +1,129 @@
+#include "benchmark.hh"
+#include "network_workload.hh"
+#include "reassembler.hh"
+
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Reassembler::insert on the substrings a receiver sees over links with loss, reordering,
+// duplication and overlapping retransmissions (see network_workload.hh), for each engine, with
+// the substrings as strings (copied in) and as slices of one shared Buffer (as TCPReceiver does).
+// Results are JSON lines; `reassembler_workload_speed_test FILE` also saves them to FILE.
+
+namespace {
+BenchmarkResults results;
+
+void workload_speed_test( const LinkProfile& profile,
+                          const Buffer& data,
+                          size_t segment_size,
+                          Reassembler::Engine engine,
+                          bool as_buffers )
+{
+  const NetworkWorkload workload { profile, data.size(), segment_size, 1234 };
+  const string_view bytes { data };
+
+  vector<string> strings;
+  if ( not as_buffers ) {
+    strings.reserve( workload.arrivals().size() );
+    for ( const auto& a : workload.arrivals() ) {
+      strings.emplace_back( bytes.substr( a.first_index, a.length ) );
+    }
+  }
+
+  ByteStream stream { workload.window() };
+  Reassembler reassembler { engine };
+  string output;
+  output.reserve( data.size() );
+
+  const double seconds = time_seconds( [&] {
+    for ( size_t i = 0; i < workload.arrivals().size(); ++i ) {
+      const auto& a = workload.arrivals()[i];
+      if ( as_buffers ) {
+        reassembler.insert( a.first_index, data.substr( a.first_index, a.length ), a.last, stream.writer() );
+      } else {
+        reassembler.insert( a.first_index, std::move( strings[i] ), a.last, stream.writer() );
+      }
+      while ( stream.reader().bytes_buffered() ) {
+        const auto peeked = stream.reader().peek();
+        output += peeked;
+        stream.reader().pop( peeked.size() );
+      }
+    }
+  } );
+
+  if ( not stream.reader().is_finished() or output != bytes ) {
+    throw runtime_error( "Reassembler did not reassemble the " + profile.name + " workload" );
+  }
+  if ( reassembler.stats().bytes_dropped > 0 ) {
+    throw runtime_error( "the " + profile.name + " workload did not fit in its window" );
+  }
+
+  const string engine_name = engine == Reassembler::Engine::Bitmap ? "bitmap" : "intervals";
+  results.add( "reassembler_workload",
+               { { "profile", profile.name },
+                 { "engine", engine_name },
+                 { "input", string { as_buffers ? "buffer" : "string" } },
+                 { "segment_size", segment_size },
+                 { "substrings", workload.arrivals().size() },
+                 { "lost", workload.lost() },
+                 { "duplicated", workload.duplicated() },
+                 { "bytes_duplicate", reassembler.stats().bytes_duplicate },
+                 { "intervals_peak", reassembler.stats().intervals_peak } },
+               "bytes",
+               data.size(),
+               seconds );
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+  debug_output << "   Reassembler (" << engine_name << ", " << ( as_buffers ? "buffer" : "string" ) << ") on "
+               << profile.name << ": " << fixed << setprecision( 2 )
+               << static_cast<double>( data.size() ) * 8 / seconds / 1e9 << " Gbit/s\n";
+
+  if ( static_cast<double>( data.size() ) * 8 / seconds < 0.1e9 ) {
+    throw runtime_error( "Reassembler did not meet minimum speed of 0.1 Gbit/s on " + profile.name );
+  }
+}
+} // namespace
+
+int main( int argc, char* argv[] )
+{
+  try {
+    const Buffer data = [] {
+      default_random_engine rd { 5678 };
+      uniform_int_distribution<char> ud;
+      string ret( 64'000'000, 0 );
+      for ( auto& c : ret ) {
+        c = ud( rd );
+      }
+      return Buffer { std::move( ret ) };
+    }();
+
+    for ( const auto& profile : standard_link_profiles() ) {
+      for ( const auto engine : { Reassembler::Engine::Intervals, Reassembler::Engine::Bitmap } ) {
+        for ( const bool as_buffers : { false, true } ) {
+          workload_speed_test( profile, data, 1460, engine, as_buffers );
+        }
+      }
+    }
+
+    const auto args = span( argv, argc );
+    if ( args.size() > 1 ) {
+      results.write( args[1] );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -8,6 +8,7 @@
 #include <optional>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 using ReceiverSet = std::pair<StreamAndReassembler, TCPReceiver>;
 
@@ -28,10 +29,20 @@ struct ReceiverSetTestStep : public TestStep<ReceiverSet>
 class TCPReceiverTestHarness : public TestHarness<ReceiverSet>
 {
 public:
-  TCPReceiverTestHarness( std::string test_name, uint64_t capacity )
+  TCPReceiverTestHarness( std::string test_name,
+                          uint64_t capacity,
+                          Reassembler::Engine engine = Reassembler::Engine::Intervals )
     : TestHarness( move( test_name ),
-                   "capacity=" + std::to_string( capacity ),
-                   { { ByteStream { capacity }, Reassembler {} }, TCPReceiver {} } )
+                   "capacity=" + std::to_string( capacity )
+                     + ( engine == Reassembler::Engine::Bitmap ? ", engine=bitmap" : "" ),
+                   { { ByteStream { capacity }, Reassembler { engine } }, TCPReceiver {} } )
+  {}
+
+  TCPReceiverTestHarness( std::string test_name, const TCPConfig& config )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( config.recv_capacity )
+                     + ( config.window_scaling ? ", window_scaling" : "" ),
+                   { { ByteStream { config.recv_capacity }, Reassembler {} }, TCPReceiver { config } } )
   {}
 
   template<std::derived_from<TestStep<StreamAndReassembler>> T>
@@ -94,6 +105,36 @@ struct ExpectAcknoBetween : public Expectation<ReceiverSet>
   }
 };
 
+// The SACK blocks reported by send( reassembler, writer )
+struct ExpectSack : public Expectation<ReceiverSet>
+{
+  std::vector<std::pair<Wrap32, Wrap32>> blocks_;
+
+  explicit ExpectSack( std::vector<std::pair<Wrap32, Wrap32>> blocks ) : blocks_( std::move( blocks ) ) {}
+
+  static std::string str( const std::vector<std::pair<Wrap32, Wrap32>>& blocks )
+  {
+    std::ostringstream ss;
+    ss << "{";
+    for ( const auto& [left, right] : blocks ) {
+      ss << " [" << left << ", " << right << ")";
+    }
+    ss << " }";
+    return ss.str();
+  }
+
+  std::string description() const override { return "SACK blocks = " + str( blocks_ ); }
+
+  void execute( ReceiverSet& rs ) const override
+  {
+    const auto msg = rs.second.send( rs.first.second, rs.first.first.writer() );
+    if ( msg.sack != blocks_ ) {
+      throw ExpectationViolation( "The TCPReceiver should have reported SACK blocks " + str( blocks_ )
+                                  + ", but instead it reported " + str( msg.sack ) );
+    }
+  }
+};
+
 struct HasAckno : public ExpectBool<ReceiverSet>
 {
   using ExpectBool::ExpectBool;
@@ -104,6 +145,27 @@ struct HasAckno : public ExpectBool<ReceiverSet>
   }
 };
 
+struct ExpectAckDue : public ExpectBool<ReceiverSet>
+{
+  using ExpectBool::ExpectBool;
+  std::string name() const override { return "ack_due"; }
+  bool value( ReceiverSet& rs ) const override { return rs.second.ack_due(); }
+};
+
+struct AckSent : public Action<ReceiverSet>
+{
+  std::string description() const override { return "ACK sent"; }
+  void execute( ReceiverSet& rs ) const override { rs.second.ack_sent(); }
+};
+
+struct ReceiverTick : public Action<ReceiverSet>
+{
+  uint64_t ms_;
+  explicit ReceiverTick( uint64_t ms ) : ms_( ms ) {}
+  std::string description() const override { return std::to_string( ms_ ) + " ms pass"; }
+  void execute( ReceiverSet& rs ) const override { rs.second.tick( ms_, rs.first.first.writer() ); }
+};
+
 struct SegmentArrives : public Action<ReceiverSet>
 {
   TCPSenderMessage msg_ {};
@@ -135,6 +197,19 @@ struct SegmentArrives : public Action<ReceiverSet>
     return *this;
   }
 
+  // Shares `data`'s storage (e.g. a slice of a larger Buffer)
+  SegmentArrives& with_data( Buffer data )
+  {
+    msg_.payload = std::move( data );
+    return *this;
+  }
+
+  SegmentArrives& with_window_scale( uint8_t shift )
+  {
+    msg_.window_scale = shift;
+    return *this;
+  }
+
   SegmentArrives& without_ackno()
   {
     ackno_expected_ = HasAckno { false };
@@ -155,6 +230,9 @@ struct SegmentArrives : public Action<ReceiverSet>
     if ( msg_.SYN ) {
       ss << " +SYN";
     }
+    if ( msg_.window_scale.has_value() ) {
+      ss << " wscale=" << static_cast<int>( *msg_.window_scale );
+    }
     if ( not msg_.payload.empty() ) {
       ss << " payload=\"" << Printer::prettify( msg_.payload ) << "\"";
     }
@@ -171,3 +249,30 @@ struct SegmentArrives : public Action<ReceiverSet>
     return ss.str();
   }
 };
+
+// Several segments handed to TCPReceiver::receive_batch() together
+struct SegmentsArrive : public Action<ReceiverSet>
+{
+  std::vector<SegmentArrives> segments_;
+
+  explicit SegmentsArrive( std::vector<SegmentArrives> segments ) : segments_( std::move( segments ) ) {}
+
+  void execute( ReceiverSet& rs ) const override
+  {
+    std::vector<TCPSenderMessage> msgs;
+    msgs.reserve( segments_.size() );
+    for ( const auto& segment : segments_ ) {
+      msgs.push_back( segment.msg_ );
+    }
+    rs.second.receive_batch( msgs, rs.first.second, rs.first.first.writer() );
+  }
+
+  std::string description() const override
+  {
+    std::string desc = "receive batch: [";
+    for ( size_t i = 0; i < segments_.size(); ++i ) {
+      desc += ( i ? "; " : "" ) + segments_[i].description();
+    }
+    return desc + "]";
+  }
+};
@@ -0,0 +1,87 @@
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPConfig cfg;
+      cfg.recv_capacity = 1000;
+      TCPReceiverTestHarness test { "without auto-tuning the window never grows", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      uint32_t seqno = isn + 1;
+      for ( int round = 0; round < 5; ++round ) {
+        test.execute( ReceiverTick { 10 } );
+        test.execute( SegmentArrives {}.with_seqno( seqno ).with_data( string( 1000, 'x' ) ) );
+        test.execute( ReadAll { string( 1000, 'x' ) } );
+        seqno += 1000;
+      }
+      test.execute( ExpectWindow { 1000 } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPConfig cfg;
+      cfg.recv_capacity = 1000;
+      cfg.recv_autotune = true;
+      cfg.recv_capacity_max = 8000;
+      cfg.recv_autotune_idle_ms = 500;
+      TCPReceiverTestHarness test { "window grows to twice what the reader drains per RTT", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectWindow { 1000 } );
+
+      // 每 10 ms（一个 RTT）到达并读走 1000 字节：缓冲扩到 2000 就够了
+      uint32_t seqno = isn + 1;
+      for ( int round = 0; round < 5; ++round ) {
+        test.execute( ReceiverTick { 10 } );
+        test.execute( SegmentArrives {}.with_seqno( seqno ).with_data( string( 1000, 'x' ) ) );
+        test.execute( ReadAll { string( 1000, 'x' ) } );
+        seqno += 1000;
+      }
+      test.execute( ExpectWindow { 2000 } );
+
+      // 空闲后缩回 recv_capacity
+      test.execute( ReceiverTick { 499 } );
+      test.execute( ExpectWindow { 2000 } );
+      test.execute( ReceiverTick { 1 } );
+      test.execute( ExpectWindow { 1000 } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPConfig cfg;
+      cfg.recv_capacity = 1000;
+      cfg.recv_autotune = true;
+      cfg.recv_capacity_max = 8000;
+      TCPReceiverTestHarness test { "a sender that fills every window grows it up to the limit", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+
+      // 每个 RTT 发满整个窗口；读走的字节在下一段到达时才算进去，所以每两个 RTT 翻一倍
+      uint32_t seqno = isn + 1;
+      for ( const size_t window : { 1000, 1000, 2000, 2000, 4000, 4000, 8000, 8000 } ) {
+        test.execute( ExpectWindow { static_cast<uint16_t>( window ) } );
+        test.execute( ReceiverTick { 10 } );
+        test.execute( SegmentArrives {}.with_seqno( seqno ).with_data( string( window, 'x' ) ) );
+        test.execute( ReadAll { string( window, 'x' ) } );
+        seqno += window;
+      }
+      test.execute( ExpectWindow { 8000 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
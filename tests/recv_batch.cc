@@ -0,0 +1,102 @@
+#include "byte_stream_test_harness.hh"
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "in-order batch becomes one chunk", 4000 };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentsArrive { { SegmentArrives {}.with_seqno( isn + 1 ).with_data( "ab" ),
+                                       SegmentArrives {}.with_seqno( isn + 3 ).with_data( "cd" ),
+                                       SegmentArrives {}.with_seqno( isn + 5 ).with_data( "ef" ) } } );
+      test.execute( ExpectAckno { Wrap32 { isn + 7 } } );
+      test.execute( PeekOnce { "abcdef" } );
+      test.execute( ReadAll { "abcdef" } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "slices of one Buffer are joined without copying", 4000 };
+      const Buffer super_segment { string { "abcdefghij" } };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute(
+        SegmentsArrive { { SegmentArrives {}.with_seqno( isn + 1 ).with_data( super_segment.substr( 0, 4 ) ),
+                           SegmentArrives {}.with_seqno( isn + 5 ).with_data( super_segment.substr( 4, 4 ) ),
+                           SegmentArrives {}.with_seqno( isn + 9 ).with_data( super_segment.substr( 8 ) ) } } );
+      test.execute( ExpectAckno { Wrap32 { isn + 11 } } );
+      test.execute( ReadBuffers { 10, { "abcdefghij" } }.sharing( super_segment ) );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "SYN, out-of-order and overlapping segments in a batch", 4000 };
+      test.execute( SegmentsArrive { { SegmentArrives {}.with_syn().with_seqno( isn ),
+                                       SegmentArrives {}.with_seqno( isn + 1 ).with_data( "ab" ),
+                                       SegmentArrives {}.with_seqno( isn + 7 ).with_data( "gh" ),
+                                       SegmentArrives {}.with_seqno( isn + 9 ).with_data( "ij" ),
+                                       SegmentArrives {}.with_seqno( isn + 2 ).with_data( "bcd" ),
+                                       SegmentArrives {}.with_seqno( isn + 5 ).with_data( "ef" ) } } );
+      test.execute( ExpectAckno { Wrap32 { isn + 11 } } );
+      test.execute( BytesPending { 0 } );
+      test.execute( ReadAll { "abcdefghij" } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "FIN ends a run", 4000 };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentsArrive { { SegmentArrives {}.with_seqno( isn + 1 ).with_data( "ab" ),
+                                       SegmentArrives {}.with_seqno( isn + 3 ).with_data( "cd" ).with_fin(),
+                                       SegmentArrives {}.with_seqno( isn + 6 ).with_data( "ef" ) } } );
+      test.execute( ExpectAckno { Wrap32 { isn + 6 } } );
+      test.execute( IsClosed { true } );
+      test.execute( ReadAll { "abcd" } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPReceiverTestHarness test { "a batch is cut to the window", 5 };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentsArrive { { SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abc" ),
+                                       SegmentArrives {}.with_seqno( isn + 4 ).with_data( "def" ).with_fin() } } );
+      test.execute( ExpectAckno { Wrap32 { isn + 6 } } );
+      test.execute( ExpectWindow { 0 } );
+      test.execute( IsClosed { false } );
+      test.execute( ReadAll { "abcde" } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPConfig cfg;
+      cfg.delayed_ack = true;
+      TCPReceiverTestHarness test { "a merged run counts each segment for delayed ACKs", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( AckSent {} );
+      test.execute( SegmentsArrive { { SegmentArrives {}.with_seqno( isn + 1 ).with_data( "ab" ) } } );
+      test.execute( ExpectAckDue { false } );
+      test.execute( AckSent {} );
+      test.execute( SegmentsArrive { { SegmentArrives {}.with_seqno( isn + 3 ).with_data( "cd" ),
+                                       SegmentArrives {}.with_seqno( isn + 5 ).with_data( "ef" ) } } );
+      test.execute( ExpectAckDue { true } );
+      test.execute( ReadAll { "abcdef" } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
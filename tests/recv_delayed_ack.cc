@@ -0,0 +1,95 @@
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPConfig cfg;
+      TCPReceiverTestHarness test { "every segment is ACKed without delayed ACKs", cfg };
+      test.execute( ExpectAckDue { false } );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectAckDue { true } );
+      test.execute( AckSent {} );
+      test.execute( ExpectAckDue { false } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( ExpectAckDue { true } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPConfig cfg;
+      cfg.delayed_ack = true;
+      TCPReceiverTestHarness test { "delayed ACK after two segments or the timeout", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectAckDue { true } );
+      test.execute( AckSent {} );
+
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( ExpectAckDue { false } );
+      test.execute( ReceiverTick { TCPConfig::DELAYED_ACK_DFLT - 1 } );
+      test.execute( ExpectAckDue { false } );
+      test.execute( ReceiverTick { 1 } );
+      test.execute( ExpectAckDue { true } );
+      test.execute( AckSent {} );
+
+      // 计时只从第一个未 ACK 的段开始
+      test.execute( ReceiverTick { 1000 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ) );
+      test.execute( ExpectAckDue { false } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 9 ).with_data( "ijkl" ) );
+      test.execute( ExpectAckDue { true } );
+      test.execute( AckSent {} );
+      test.execute( ReadAll { "abcdefghijkl" } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPConfig cfg;
+      cfg.delayed_ack = true;
+      TCPReceiverTestHarness test { "out-of-order, hole-filling and FIN segments are ACKed at once", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( AckSent {} );
+
+      test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ) );
+      test.execute( ExpectAckDue { true } );
+      test.execute( AckSent {} );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( ExpectAckDue { true } );
+      test.execute( AckSent {} );
+      test.execute( SegmentArrives {}.with_seqno( isn + 9 ).with_data( "ijkl" ) );
+      test.execute( ExpectAckDue { false } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 13 ).with_fin() );
+      test.execute( ExpectAckDue { true } );
+      test.execute( ExpectAckno { Wrap32 { isn + 14 } } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPConfig cfg;
+      cfg.delayed_ack = true;
+      TCPReceiverTestHarness test { "duplicate segments are ACKed at once", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( AckSent {} );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+      test.execute( ExpectAckDue { true } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,54 @@
+#include "byte_stream.hh"
+#include "common.hh"
+#include "reassembler.hh"
+#include "tcp_receiver.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// A flow long enough for the sequence numbers to wrap more than once. Every segment shares one
+// 64 KiB Buffer, so no bytes are copied and the test stays quick.
+int main()
+{
+  try {
+    constexpr uint64_t segment_size = 1 << 16;
+    constexpr uint64_t total = ( uint64_t { 1 } << 33 ) + 3 * segment_size; // 两圈多一点
+    const Wrap32 isn { UINT32_MAX - 5 };
+    const Buffer payload { string( segment_size, 'x' ) };
+
+    TCPReceiver receiver;
+    Reassembler reassembler;
+    ByteStream inbound { 4 * segment_size };
+
+    receiver.receive( { isn, true, {}, false, {} }, reassembler, inbound.writer() );
+    for ( uint64_t sent = 0; sent < total; sent += segment_size ) {
+      const TCPSenderMessage seg { Wrap32::wrap( sent + 1, isn ), false, payload, false, {} };
+      // 先到一个重复的旧段，再到新段
+      if ( sent >= segment_size ) {
+        receiver.receive( { Wrap32::wrap( sent + 1 - segment_size, isn ), false, payload, false, {} },
+                          reassembler,
+                          inbound.writer() );
+      }
+      receiver.receive( seg, reassembler, inbound.writer() );
+      check( inbound.reader().bytes_buffered() == segment_size,
+             "segment at stream index " + to_string( sent ) + " was not assembled" );
+      inbound.reader().pop( segment_size );
+    }
+    receiver.receive( { Wrap32::wrap( total + 1, isn ), false, {}, true, {} }, reassembler, inbound.writer() );
+
+    check( inbound.writer().bytes_pushed() == total, "bytes_pushed = " + to_string( inbound.writer().bytes_pushed() ) );
+    check( inbound.reader().is_finished(), "FIN was not assembled" );
+    const auto ackno = receiver.send( inbound.writer() ).ackno;
+    check( ackno.has_value() && ackno.value() == Wrap32::wrap( total + 2, isn ), "wrong ackno after the flow" );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    for ( const auto engine : { Reassembler::Engine::Intervals, Reassembler::Engine::Bitmap } ) {
+      {
+        const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+        TCPReceiverTestHarness test { "no SACK blocks before SYN or without holes", 4000, engine };
+        test.execute( ExpectSack { {} } );
+        test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+        test.execute( ExpectSack { {} } );
+        test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+        test.execute( ExpectAckno { Wrap32 { isn + 5 } } );
+        test.execute( ExpectSack { {} } );
+      }
+
+      {
+        const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+        TCPReceiverTestHarness test { "out-of-order segments are reported, lowest first", 4000, engine };
+        test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+        test.execute( SegmentArrives {}.with_seqno( isn + 13 ).with_data( "mn" ) );
+        test.execute( ExpectSack { { { Wrap32 { isn + 13 }, Wrap32 { isn + 15 } } } } );
+        test.execute( SegmentArrives {}.with_seqno( isn + 5 ).with_data( "efgh" ) );
+        test.execute( ExpectAckno { Wrap32 { isn + 1 } } );
+        test.execute( ExpectSack {
+          { { Wrap32 { isn + 5 }, Wrap32 { isn + 9 } }, { Wrap32 { isn + 13 }, Wrap32 { isn + 15 } } } } );
+
+        // 相邻的区间合并成一个块
+        test.execute( SegmentArrives {}.with_seqno( isn + 9 ).with_data( "ij" ) );
+        test.execute( ExpectSack {
+          { { Wrap32 { isn + 5 }, Wrap32 { isn + 11 } }, { Wrap32 { isn + 13 }, Wrap32 { isn + 15 } } } } );
+        test.execute( SegmentArrives {}.with_seqno( isn + 11 ).with_data( "kl" ) );
+        test.execute( ExpectSack { { { Wrap32 { isn + 5 }, Wrap32 { isn + 15 } } } } );
+
+        // 补上开头的洞后就没有块了
+        test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( "abcd" ) );
+        test.execute( ExpectAckno { Wrap32 { isn + 15 } } );
+        test.execute( ExpectSack { {} } );
+        test.execute( ReadAll { "abcdefghijklmn" } );
+      }
+
+      {
+        const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+        TCPReceiverTestHarness test { "at most MAX_SACK_BLOCKS blocks", 4000, engine };
+        test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+        for ( uint32_t i = 0; i < 6; ++i ) {
+          test.execute( SegmentArrives {}.with_seqno( isn + 11 + 10 * i ).with_data( "xy" ) );
+        }
+        test.execute( ExpectSack { { { Wrap32 { isn + 11 }, Wrap32 { isn + 13 } },
+                                     { Wrap32 { isn + 21 }, Wrap32 { isn + 23 } },
+                                     { Wrap32 { isn + 31 }, Wrap32 { isn + 33 } },
+                                     { Wrap32 { isn + 41 }, Wrap32 { isn + 43 } } } } );
+        test.execute( BytesPending { 12 } );
+      }
+
+      {
+        TCPReceiverTestHarness test { "SACK blocks across the sequence-number wrap", 4000, engine };
+        test.execute( SegmentArrives {}.with_syn().with_seqno( UINT32_MAX - 2 ) );
+        test.execute( SegmentArrives {}.with_seqno( 3 ).with_data( "fgh" ) );
+        test.execute( ExpectSack { { { Wrap32 { 3 }, Wrap32 { 6 } } } } );
+        test.execute( SegmentArrives {}.with_seqno( UINT32_MAX - 1 ).with_data( "abcde" ) );
+        test.execute( ExpectAckno { Wrap32 { 6 } } );
+        test.execute( ExpectSack { {} } );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,68 @@
+#include "random.hh"
+#include "receiver_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPConfig cfg;
+      cfg.recv_capacity = 4'000'000;
+      TCPReceiverTestHarness test { "window clamped without window scaling", cfg };
+      test.execute( ExpectWindow { UINT16_MAX } );
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ).with_window_scale( 3 ) );
+      test.execute( ExpectWindow { UINT16_MAX } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPConfig cfg;
+      cfg.recv_capacity = 4'000'000;
+      cfg.window_scaling = true;
+      TCPReceiverTestHarness test { "no scaling when the peer doesn't offer it", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ) );
+      test.execute( ExpectWindow { UINT16_MAX } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPConfig cfg;
+      cfg.recv_capacity = 4'000'000;
+      cfg.window_scaling = true;
+      TCPReceiverTestHarness test { "scaled window once both sides offer it", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ).with_window_scale( 2 ) );
+      // 4'000'000 >> 6 = 62500
+      test.execute( ExpectWindow { 62500 } );
+      test.execute( SegmentArrives {}.with_seqno( isn + 1 ).with_data( string( 1000, 'x' ) ) );
+      test.execute( ExpectAckno { Wrap32 { isn + 1001 } } );
+      test.execute( ExpectWindow { 3'999'000 >> 6 } );
+      test.execute( ReadAll { string( 1000, 'x' ) } );
+      test.execute( ExpectWindow { 62500 } );
+    }
+
+    {
+      const uint32_t isn = uniform_int_distribution<uint32_t> { 0, UINT32_MAX }( rd );
+      TCPConfig cfg;
+      cfg.recv_capacity = 40000;
+      cfg.window_scaling = true;
+      TCPReceiverTestHarness test { "small capacity needs no shift", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( isn ).with_window_scale( 9 ) );
+      test.execute( ExpectWindow { 40000 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+#include "address.hh"
+#include "common.hh"
+#include "event_loop.hh"
+#include "resolver.hh"
+
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+// Run `loop` until `done` is set (or give up after a while)
+void run_until( EventLoop& loop, const bool& done )
+{
+  for ( int i = 0; i < 500 and not done; ++i ) {
+    loop.wait_next_event( 10 );
+  }
+  check( done, "lookup never finished" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    EventLoop loop;
+
+    // 第一次在后台查，回调在循环里跑；第二次直接从缓存答
+    {
+      Resolver resolver { loop };
+      optional<Address> got;
+      bool done = false;
+      resolver.resolve( "localhost", "http", [&]( const optional<Address>& address, string_view ) {
+        got = address;
+        done = true;
+      } );
+      check( not done, "not answered before the lookup ran" );
+      run_until( loop, done );
+      check( got.has_value() and got->port() == 80, "resolved localhost:http" );
+
+      bool hit = false;
+      resolver.resolve( "localhost", "http", [&]( const optional<Address>& address, string_view ) {
+        hit = address.has_value() and *address == *got;
+      } );
+      check( hit, "answered from the cache before resolve() returned" );
+      check( resolver.stats().hits == 1 and resolver.stats().lookups == 1, "one lookup, one hit" );
+      check( resolver.cached( "localhost", "http" ) == got, "cached()" );
+      check( not resolver.cached( "localhost", "https" ), "other service not cached" );
+    }
+
+    // 同一个名字同时查好几次：只查一次，大家都拿到答案
+    {
+      Resolver resolver { loop };
+      size_t answered = 0;
+      for ( int i = 0; i < 5; ++i ) {
+        resolver.resolve( "127.0.0.1", "8080", [&]( const optional<Address>& address, string_view ) {
+          answered += address.has_value() and address->port() == 8080 ? 1 : 0;
+        } );
+      }
+      for ( int i = 0; i < 500 and answered < 5; ++i ) {
+        loop.wait_next_event( 10 );
+      }
+      check( answered == 5, "every waiter answered" );
+      check( resolver.stats().lookups == 1 and resolver.stats().coalesced == 4, "coalesced into one lookup" );
+    }
+
+    // 失败也缓存（时间短一些），过期了就重新查
+    {
+      Resolver::Config config;
+      config.negative_ttl = chrono::milliseconds { 30 };
+      Resolver resolver { loop, config };
+      bool done = false;
+      string error;
+      resolver.resolve( "no-such-host.invalid", "http", [&]( const optional<Address>& address, string_view why ) {
+        check( not address, "no address" );
+        error = why;
+        done = true;
+      } );
+      run_until( loop, done );
+      check( not error.empty(), "failure has a reason" );
+
+      resolver.resolve( "no-such-host.invalid", "http", []( const optional<Address>&, string_view ) {} );
+      check( resolver.stats().hits == 1, "failure cached" );
+      EventLoop::Id timer {};
+      timer = loop.add_timer( 40, [&]( uint64_t ) {
+        loop.cancel_timer( timer );
+        loop.stop();
+      } );
+      loop.run();
+      done = false;
+      resolver.resolve( "no-such-host.invalid", "http", [&]( const optional<Address>&, string_view ) {
+        done = true;
+      } );
+      check( not done and resolver.stats().lookups == 2, "expired failure looked up again" );
+      run_until( loop, done );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+#include "common.hh"
+#include "random.hh"
+#include "route_table.hh"
+#include "router.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+bool parse_fails( const string& text )
+{
+  istringstream input { text };
+  try {
+    RouteTable::parse( input );
+  } catch ( const runtime_error& ) {
+    return true;
+  }
+  return false;
+}
+} // namespace
+
+int main()
+{
+  try {
+    {
+      istringstream input { "# prefix next_hop interface\n"
+                            "\n"
+                            "0.0.0.0/0 171.67.76.1 0\n"
+                            "10.0.0.0/8 - 1\n"
+                            "143.195.0.0/17 143.195.0.1 4 143.195.0.9 5\n" };
+      const auto routes = RouteTable::parse( input );
+      check( routes.size() == 3, "route count" );
+      check( routes[0].route_prefix == 0 && routes[0].prefix_length == 0, "default route" );
+      check( routes[0].paths.size() == 1 && routes[0].paths[0].next_hop->ip() == "171.67.76.1"
+               && routes[0].paths[0].interface_num == 0,
+             "default route path" );
+      check( routes[1].route_prefix == 0x0a000000 && routes[1].prefix_length == 8, "direct route" );
+      check( not routes[1].paths[0].next_hop.has_value() && routes[1].paths[0].interface_num == 1, "direct path" );
+      check( routes[2].paths.size() == 2 && routes[2].paths[1].next_hop->ip() == "143.195.0.9"
+               && routes[2].paths[1].interface_num == 5,
+             "multipath route" );
+    }
+
+    check( parse_fails( "10.0.0.0 - 1\n" ), "missing length accepted" );
+    check( parse_fails( "10.0.0.0/33 - 1\n" ), "length over 32 accepted" );
+    check( parse_fails( "10.0.0.0/x - 1\n" ), "bad length accepted" );
+    check( parse_fails( "10.0.0/8 - 1\n" ), "bad prefix accepted" );
+    check( parse_fails( "10.0.0.0/8\n" ), "route without a path accepted" );
+    check( parse_fails( "10.0.0.0/8 10.0.0.1\n" ), "next hop without an interface accepted" );
+
+    // 一次建表和逐条加入的结果一样（包括同一前缀先到先得）。短前缀要填满整段 tbl24，只放几条手挑的，
+    // 随机的都在 /16 以上；大表的随机对比在 route_table_speed_test 里
+    auto rd = get_random_engine();
+    uniform_int_distribution<uint32_t> u32_dist;
+    uniform_int_distribution<int> length_dist { 16, 32 };
+    vector<RouteTable::Route> routes { { 0, 0, { { {}, 0 } } }, { 0x0a000000, 8, { { {}, 1 } } } };
+    RouteTable one_by_one;
+    one_by_one.add( 0, 0, {}, 0 );
+    one_by_one.add( 0x0a000000, 8, {}, 1 );
+    for ( uint32_t i = 2; i < 300; ++i ) {
+      const uint32_t prefix = i % 5 == 0 ? routes[i / 2].route_prefix : ( u32_dist( rd ) & 0xff0fffff );
+      const auto length = static_cast<uint8_t>( i % 5 == 0 ? routes[i / 2].prefix_length : length_dist( rd ) );
+      routes.push_back( { prefix, length, { { {}, i } } } );
+      one_by_one.add( prefix, length, {}, i );
+    }
+    const RouteTable bulk { routes };
+    for ( int i = 0; i < 20000; ++i ) {
+      const uint32_t address = u32_dist( rd ) & 0xff0fffff;
+      check( bulk.lookup( address ) == one_by_one.lookup( address ), "bulk build disagrees with add()" );
+    }
+
+    // Router::load_routes 替换整张表，缓存也要作废
+    Router router;
+    router.add_route( 0, 0, {}, 9999 );
+    check( router.lookup( 0x0a000000 ) != nullptr, "route before load_routes()" );
+    router.load_routes( routes );
+    for ( int i = 0; i < 10000; ++i ) {
+      const uint32_t address = i % 2 ? 0x0a000000 : u32_dist( rd ) & 0xff0fffff;
+      const auto* route = router.lookup( address );
+      const auto expected = bulk.lookup( address );
+      check( expected == LPMTable::NONE ? route == nullptr
+                                        : route != nullptr && route->paths.front().interface_num == expected,
+             "Router::load_routes" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+#include "route_table.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+// Build a RouteTable from random routes of every prefix length (with repeated prefixes, where the
+// first route wins) in one pass and one add() at a time, and check that both agree on random lookups
+void route_table_speed_test( const size_t num_routes, // NOLINT(bugprone-easily-swappable-parameters)
+                             const size_t num_lookups )
+{
+  default_random_engine rd { 31415 };
+  uniform_int_distribution<uint32_t> u32_dist;
+  uniform_int_distribution<int> length_dist { 0, 32 };
+  vector<RouteTable::Route> routes;
+  routes.reserve( num_routes );
+  for ( uint32_t i = 0; i < num_routes; ++i ) {
+    const uint32_t prefix = i % 5 == 0 && i > 0 ? routes[i / 2].route_prefix : ( u32_dist( rd ) & 0xff0fffff );
+    const auto length = static_cast<uint8_t>( i % 5 == 0 && i > 0 ? routes[i / 2].prefix_length : length_dist( rd ) );
+    routes.push_back( { prefix, length, { { {}, i } } } );
+  }
+
+  const auto bulk_start = steady_clock::now();
+  const RouteTable bulk { routes };
+  const auto bulk_stop = steady_clock::now();
+
+  RouteTable one_by_one;
+  const auto add_start = steady_clock::now();
+  for ( const auto& route : routes ) {
+    one_by_one.add( route.route_prefix, route.prefix_length, route.paths );
+  }
+  const auto add_stop = steady_clock::now();
+
+  for ( size_t i = 0; i < num_lookups; ++i ) {
+    const uint32_t address = u32_dist( rd ) & 0xff0fffff;
+    if ( bulk.lookup( address ) != one_by_one.lookup( address ) ) {
+      throw runtime_error( "RouteTable built in one pass disagrees with add()" );
+    }
+  }
+
+  const auto bulk_ms = duration_cast<duration<double, milli>>( bulk_stop - bulk_start ).count();
+  const auto add_ms = duration_cast<duration<double, milli>>( add_stop - add_start ).count();
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "RouteTable with " << routes.size() << " routes: built in " << fixed << setprecision( 1 ) << bulk_ms
+       << " ms in one pass, " << add_ms << " ms with add(); " << num_lookups << " lookups agree.\n";
+
+  debug_output << "   RouteTable (" << routes.size() << " routes): one pass " << fixed << setprecision( 1 )
+               << bulk_ms << " ms, add() " << add_ms << " ms\n";
+}
+} // namespace
+
+void program_body()
+{
+  route_table_speed_test( 2000, 1000000 );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
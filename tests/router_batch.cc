@@ -0,0 +1,119 @@
+#include "arp_message.hh"
+#include "common.hh"
+#include "router.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+EthernetAddress ethernet_address( uint8_t last )
+{
+  return { 0x02, 0, 0, 0, 0, last };
+}
+
+constexpr size_t IN0 = 0, IN1 = 1, OUT = 2;
+
+// Queue a datagram from `src` (tagged with `id`) on an ingress interface
+void arrive( Router& router, size_t interface, const string& src, uint16_t id )
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address { src }.ipv4_numeric();
+  dgram.header.dst = Address { "10.2.0.2" }.ipv4_numeric();
+  dgram.header.len = IPv4Header::LENGTH;
+  dgram.header.id = id;
+  dgram.header.ttl = 64;
+  dgram.header.compute_checksum();
+  router.interface( interface ).recv_frame(
+    { { ethernet_address( interface ), ethernet_address( 9 ), EthernetHeader::TYPE_IPv4 }, serialize( dgram ) } );
+}
+
+// The ids of the datagrams sent on OUT since the last call, in order
+vector<uint16_t> sent( Router& router )
+{
+  vector<uint16_t> ids;
+  while ( auto frame = router.interface( OUT ).maybe_send() ) {
+    InternetDatagram dgram;
+    check( parse( dgram, frame->payload ), "router sent an unparseable datagram" );
+    check( dgram.header.ttl == 63, "TTL not decremented" );
+    ids.push_back( dgram.header.id );
+  }
+  return ids;
+}
+} // namespace
+
+int main()
+{
+  try {
+    Router router;
+    router.add_interface( { ethernet_address( IN0 ), Address { "10.0.0.1" } } );
+    router.add_interface( { ethernet_address( IN1 ), Address { "10.1.0.1" } } );
+    router.add_interface( { ethernet_address( OUT ), Address { "10.2.0.1" } } );
+    router.add_route( Address { "10.2.0.0" }.ipv4_numeric(), 16, {}, OUT );
+
+    // 先让出口知道 10.2.0.2 的以太网地址
+    ARPMessage reply;
+    reply.opcode = ARPMessage::OPCODE_REPLY;
+    reply.sender_ethernet_address = ethernet_address( 3 );
+    reply.sender_ip_address = Address { "10.2.0.2" }.ipv4_numeric();
+    reply.target_ethernet_address = ethernet_address( OUT );
+    reply.target_ip_address = Address { "10.2.0.1" }.ipv4_numeric();
+    router.interface( OUT ).recv_frame(
+      { { ethernet_address( OUT ), ethernet_address( 3 ), EthernetHeader::TYPE_ARP }, serialize( reply ) } );
+
+    for ( uint16_t i = 0; i < 5; ++i ) {
+      arrive( router, IN0, "10.0.0.2", i );
+    }
+    arrive( router, IN1, "10.1.0.2", 100 );
+    arrive( router, IN1, "10.1.0.2", 101 );
+
+    // 两个接口轮流，每个最多 2 个
+    check( router.route_batch( 2 ) == 4, "first batch" );
+    check( sent( router ) == vector<uint16_t> { 0, 100, 1, 101 }, "first batch not round-robin" );
+
+    // IN1 已经空了；IN0 还有 3 个，但预算只有 2
+    check( router.route_batch( 2 ) == 2, "second batch" );
+    check( sent( router ) == vector<uint16_t> { 2, 3 }, "second batch" );
+
+    // route() 一直做到所有接口都空
+    arrive( router, IN1, "10.1.0.2", 102 );
+    router.route();
+    check( sent( router ) == vector<uint16_t> { 4, 102 }, "route() did not drain every interface" );
+    check( router.route_batch() == 0, "router not idle after route()" );
+
+    // 积压很多时 route() 一次全部转发
+    for ( uint16_t i = 0; i < 1000; ++i ) {
+      arrive( router, i % 2 ? IN1 : IN0, "10.0.0.2", i );
+    }
+    router.route();
+    check( sent( router ).size() == 1000, "route() left datagrams behind" );
+
+    // 数据报交给接口之后，payload 的 Buffer 直接进以太网帧，不复制
+    {
+      InternetDatagram dgram;
+      dgram.header.dst = Address { "10.2.0.2" }.ipv4_numeric();
+      dgram.payload.emplace_back( string( 1000, 'x' ) );
+      dgram.header.len = IPv4Header::LENGTH + dgram.payload.back().size();
+      dgram.header.compute_checksum();
+      const char* const payload_bytes = string_view { dgram.payload.back() }.data();
+
+      router.interface( OUT ).send_datagram( std::move( dgram ), Address { "10.2.0.2" } );
+      auto frame = router.interface( OUT ).maybe_send();
+      check( frame.has_value(), "no frame sent" );
+      check( any_of( frame->payload.begin(),
+                     frame->payload.end(),
+                     [&]( const Buffer& b ) { return string_view { b }.data() == payload_bytes; } ),
+             "payload was copied on its way into the frame" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
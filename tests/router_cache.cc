@@ -0,0 +1,77 @@
+#include "common.hh"
+#include "router.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+InternetDatagram datagram_to( const string& dst )
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address { "192.168.0.2" }.ipv4_numeric();
+  dgram.header.dst = Address { dst }.ipv4_numeric();
+  dgram.header.len = IPv4Header::LENGTH;
+  dgram.header.ttl = 64;
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+// Hand a datagram to interface 0 and route it; returns the interface it went out on (or -1)
+int forward( Router& router, const string& dst, size_t num_interfaces )
+{
+  EthernetFrame frame { { {}, {}, EthernetHeader::TYPE_IPv4 }, serialize( datagram_to( dst ) ) };
+  frame.header.dst = ETHERNET_BROADCAST;
+  router.interface( 0 ).recv_frame( frame );
+  router.route();
+
+  int sent_on = -1;
+  for ( size_t i = 0; i < num_interfaces; ++i ) {
+    // 下一跳的以太网地址未知，所以出口会发 ARP 请求；过 5 秒让下一次还会再发
+    while ( router.interface( i ).maybe_send() ) {
+      sent_on = static_cast<int>( i );
+    }
+    router.interface( i ).tick( 5000 );
+  }
+  return sent_on;
+}
+} // namespace
+
+int main()
+{
+  try {
+    for ( size_t cache_size : { size_t { 0 }, size_t { 1 }, size_t { 3 }, Router::DEFAULT_ROUTE_CACHE_SIZE } ) {
+      Router router { cache_size };
+      for ( uint8_t i = 0; i < 3; ++i ) {
+        router.add_interface( { EthernetAddress { 2, 0, 0, 0, 0, i }, Address { "10.0.0." + to_string( i + 1 ) } } );
+      }
+      router.add_route( Address { "192.168.0.0" }.ipv4_numeric(), 16, {}, 0 );
+      router.add_route( Address { "172.16.0.0" }.ipv4_numeric(), 12, {}, 1 );
+
+      check( forward( router, "172.16.5.5", 3 ) == 1, "first lookup" );
+      check( forward( router, "172.16.5.5", 3 ) == 1, "cached lookup" );
+      check( forward( router, "8.8.8.8", 3 ) == -1, "no route" );
+      if ( cache_size == 0 ) {
+        check( router.route_cache_hits() == 0 && router.route_cache_misses() == 0, "disabled cache counted" );
+      } else {
+        check( router.route_cache_misses() == 2, "misses: " + to_string( router.route_cache_misses() ) );
+        check( router.route_cache_hits() == 1, "hits: " + to_string( router.route_cache_hits() ) );
+      }
+
+      // 新加的更长前缀必须马上生效，不能用缓存里的旧结果
+      router.add_route( Address { "172.16.5.0" }.ipv4_numeric(), 24, {}, 2 );
+      check( forward( router, "172.16.5.5", 3 ) == 2, "cache not invalidated by add_route" );
+      router.add_route( Address { "0.0.0.0" }.ipv4_numeric(), 0, Address { "10.0.0.9" }, 1 );
+      check( forward( router, "8.8.8.8", 3 ) == 1, "cached miss not invalidated by add_route" );
+      check( forward( router, "172.16.5.5", 3 ) == 2, "lookup after invalidation" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
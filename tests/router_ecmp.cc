@@ -0,0 +1,115 @@
+#include "arp_message.hh"
+#include "common.hh"
+#include "router.hh"
+
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+EthernetAddress ethernet_address( uint8_t last )
+{
+  return { 0x02, 0, 0, 0, 0, last };
+}
+
+constexpr size_t IN = 0;
+constexpr size_t UPLINKS = 4;
+
+// A TCP datagram from 192.168.0.2:src_port to dst:80
+InternetDatagram tcp_datagram( const string& dst, uint16_t src_port, bool fragment = false )
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address { "192.168.0.2" }.ipv4_numeric();
+  dgram.header.dst = Address { dst }.ipv4_numeric();
+  dgram.header.ttl = 64;
+  dgram.header.mf = fragment;
+  const string ports { static_cast<char>( src_port >> 8 ), static_cast<char>( src_port ), 0, 80 };
+  dgram.payload.emplace_back( ports + string( 16, 0 ) );
+  dgram.header.len = IPv4Header::LENGTH + dgram.payload.back().size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+// Route one datagram and return the uplink (1..UPLINKS) it left on
+size_t forward( Router& router, InternetDatagram dgram )
+{
+  router.interface( IN ).recv_frame(
+    { { ethernet_address( IN ), ethernet_address( 99 ), EthernetHeader::TYPE_IPv4 }, serialize( dgram ) } );
+  router.route();
+  size_t sent_on = 0;
+  for ( size_t i = 1; i <= UPLINKS; ++i ) {
+    while ( router.interface( i ).maybe_send() ) {
+      check( sent_on == 0, "datagram sent twice" );
+      sent_on = i;
+    }
+  }
+  check( sent_on != 0, "datagram not forwarded" );
+  return sent_on;
+}
+} // namespace
+
+int main()
+{
+  try {
+    Router router;
+    router.add_interface( { ethernet_address( IN ), Address { "192.168.0.1" } } );
+    vector<RouteTable::Path> paths;
+    for ( uint8_t i = 1; i <= UPLINKS; ++i ) {
+      const string my_ip = "172.16." + to_string( i ) + ".1";
+      const string peer_ip = "172.16." + to_string( i ) + ".2";
+      router.add_interface( { ethernet_address( i ), Address { my_ip } } );
+      paths.push_back( { Address { peer_ip }, i } );
+
+      // 每条上行链路都已经知道对端的以太网地址
+      ARPMessage reply;
+      reply.opcode = ARPMessage::OPCODE_REPLY;
+      reply.sender_ethernet_address = ethernet_address( 100 + i );
+      reply.sender_ip_address = Address { peer_ip }.ipv4_numeric();
+      reply.target_ethernet_address = ethernet_address( i );
+      reply.target_ip_address = Address { my_ip }.ipv4_numeric();
+      router.interface( i ).recv_frame(
+        { { ethernet_address( i ), ethernet_address( 100 + i ), EthernetHeader::TYPE_ARP }, serialize( reply ) } );
+    }
+    router.add_route( 0, 0, paths );
+    router.add_route( Address { "8.8.8.0" }.ipv4_numeric(), 24, Address { "172.16.3.2" }, 3 );
+
+    // 不同的流分散到所有链路上，而且大致均匀
+    array<size_t, UPLINKS + 1> per_uplink {};
+    for ( uint16_t port = 1000; port < 5000; ++port ) {
+      ++per_uplink.at( forward( router, tcp_datagram( "93.184.216.34", port ) ) );
+    }
+    for ( size_t i = 1; i <= UPLINKS; ++i ) {
+      check( per_uplink.at( i ) > 800 && per_uplink.at( i ) < 1200,
+             "uplink " + to_string( i ) + " carried " + to_string( per_uplink.at( i ) ) + " of 4000 flows" );
+    }
+
+    // 同一个流总走同一条路
+    for ( uint16_t port = 1000; port < 1100; ++port ) {
+      const auto first = forward( router, tcp_datagram( "93.184.216.34", port ) );
+      for ( int i = 0; i < 3; ++i ) {
+        check( forward( router, tcp_datagram( "93.184.216.34", port ) ) == first, "flow changed path" );
+      }
+    }
+
+    // 分片没有端口，只按地址散列：同一对地址的分片走同一条路
+    const auto fragment_path = forward( router, tcp_datagram( "93.184.216.34", 1, true ) );
+    for ( uint16_t port = 2; port < 50; ++port ) {
+      check( forward( router, tcp_datagram( "93.184.216.34", port, true ) ) == fragment_path,
+             "fragments of one address pair took different paths" );
+    }
+
+    // 单路径的路由不受影响
+    for ( uint16_t port = 1000; port < 1100; ++port ) {
+      check( forward( router, tcp_datagram( "8.8.8.8", port ) ) == 3, "single-path route" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
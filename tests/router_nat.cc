@@ -0,0 +1,262 @@
+#include "arp_message.hh"
+#include "checksum.hh"
+#include "common.hh"
+#include "router.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+EthernetAddress ethernet_address( uint8_t last )
+{
+  return { 0x02, 0, 0, 0, 0, last };
+}
+
+uint32_t ip( const string& address )
+{
+  return Address { address }.ipv4_numeric();
+}
+
+constexpr size_t INSIDE = 0, OUTSIDE = 1;
+constexpr uint8_t UDP = NatTable::PROTO_UDP;
+const string HOST = "192.168.0.2";
+const string HOST2 = "192.168.0.3";
+const string EXTERNAL = "203.0.113.1";
+const string GATEWAY = "203.0.113.254";
+const string SERVER = "198.51.100.7";
+
+uint16_t read16( string_view bytes, size_t at )
+{
+  return static_cast<uint16_t>( static_cast<uint8_t>( bytes[at] ) << 8 | static_cast<uint8_t>( bytes[at + 1] ) );
+}
+
+void write16( string& bytes, size_t at, uint16_t value )
+{
+  bytes[at] = static_cast<char>( value >> 8 );
+  bytes[at + 1] = static_cast<char>( value & 0xff );
+}
+
+// A TCP or UDP datagram with correct checksums. A UDP datagram may go without a checksum.
+InternetDatagram datagram( const string& src,
+                           uint16_t src_port,
+                           const string& dst,
+                           uint16_t dst_port,
+                           uint8_t protocol = IPv4Header::PROTO_TCP,
+                           bool udp_checksum = true )
+{
+  const string data = "some application data";
+  string l4( protocol == UDP ? 8 : 20, 0 );
+  write16( l4, 0, src_port );
+  write16( l4, 2, dst_port );
+  if ( protocol == UDP ) {
+    write16( l4, 4, static_cast<uint16_t>( l4.size() + data.size() ) );
+  } else {
+    l4[12] = 5 << 4; // data offset
+    l4[13] = 0x10;   // ACK
+  }
+  l4 += data;
+
+  InternetDatagram dgram;
+  dgram.header.src = ip( src );
+  dgram.header.dst = ip( dst );
+  dgram.header.proto = protocol;
+  dgram.header.ttl = 64;
+  dgram.header.len = IPv4Header::LENGTH + l4.size();
+  dgram.header.compute_checksum();
+  if ( protocol != UDP || udp_checksum ) {
+    InternetChecksum sum { dgram.header.pseudo_checksum() };
+    sum.add( l4 );
+    write16( l4, protocol == UDP ? 6 : 16, sum.value() );
+  }
+  dgram.payload.emplace_back( l4 );
+  return dgram;
+}
+
+struct Seen
+{
+  InternetDatagram dgram;
+  uint16_t src_port;
+  uint16_t dst_port;
+};
+
+// What the router sent on `interface` since the last call, checking every checksum
+vector<Seen> sent( Router& router, size_t interface )
+{
+  vector<Seen> out;
+  while ( auto frame = router.interface( interface ).maybe_send() ) {
+    InternetDatagram dgram;
+    check( parse( dgram, frame->payload ), "IPv4 header checksum" );
+    string l4;
+    for ( const auto& buffer : dgram.payload ) {
+      l4 += string_view { buffer };
+    }
+    if ( dgram.header.proto != UDP || read16( l4, 6 ) != 0 ) {
+      InternetChecksum sum { dgram.header.pseudo_checksum() };
+      sum.add( l4 );
+      check( sum.value() == 0, "TCP/UDP checksum" );
+    }
+    check( l4.substr( l4.size() - 21 ) == "some application data", "payload intact" );
+    out.push_back( { std::move( dgram ), read16( l4, 0 ), read16( l4, 2 ) } );
+  }
+  return out;
+}
+
+void arrive( Router& router, size_t interface, InternetDatagram dgram )
+{
+  router.interface( interface )
+    .recv_frame(
+      { { ethernet_address( interface ), ethernet_address( 9 ), EthernetHeader::TYPE_IPv4 }, serialize( dgram ) } );
+  router.route();
+}
+
+void learn( Router& router, size_t interface, const string& neighbour, const string& own )
+{
+  ARPMessage reply;
+  reply.opcode = ARPMessage::OPCODE_REPLY;
+  reply.sender_ethernet_address = ethernet_address( 9 );
+  reply.sender_ip_address = ip( neighbour );
+  reply.target_ethernet_address = ethernet_address( interface );
+  reply.target_ip_address = ip( own );
+  router.interface( interface )
+    .recv_frame( { { ethernet_address( interface ), ethernet_address( 9 ), EthernetHeader::TYPE_ARP },
+                   serialize( reply ) } );
+}
+
+Router gateway( const NatTable::Config& config )
+{
+  Router router;
+  router.add_interface( { ethernet_address( INSIDE ), Address { "192.168.0.1" } } );
+  router.add_interface( { ethernet_address( OUTSIDE ), Address { EXTERNAL } } );
+  router.add_route( ip( "192.168.0.0" ), 16, {}, INSIDE );
+  router.add_route( 0, 0, Address { GATEWAY }, OUTSIDE );
+  learn( router, INSIDE, HOST, "192.168.0.1" );
+  learn( router, INSIDE, HOST2, "192.168.0.1" );
+  learn( router, OUTSIDE, GATEWAY, EXTERNAL );
+  router.enable_nat( OUTSIDE, config );
+  return router;
+}
+} // namespace
+
+int main()
+{
+  try {
+    NatTable::Config config;
+    config.external_ip = ip( EXTERNAL );
+    config.first_port = 5000;
+    config.last_port = 5001;
+    config.udp_timeout_ms = 1000;
+
+    // TCP 出去换源地址和端口，回复换回来；校验和都对
+    {
+      auto router = gateway( config );
+      arrive( router, INSIDE, datagram( HOST, 40000, SERVER, 80 ) );
+      auto out = sent( router, OUTSIDE );
+      check( out.size() == 1, "forwarded" );
+      check( out[0].dgram.header.src == ip( EXTERNAL ) and out[0].src_port == 5000, "source translated" );
+      check( out[0].dgram.header.dst == ip( SERVER ) and out[0].dst_port == 80, "destination untouched" );
+      check( router.nat()->size() == 1, "one mapping" );
+
+      // 同一个流继续用同一个端口
+      arrive( router, INSIDE, datagram( HOST, 40000, SERVER, 80 ) );
+      out = sent( router, OUTSIDE );
+      check( out.size() == 1 and out[0].src_port == 5000 and router.nat()->size() == 1, "mapping reused" );
+
+      arrive( router, OUTSIDE, datagram( SERVER, 80, EXTERNAL, 5000 ) );
+      auto in = sent( router, INSIDE );
+      check( in.size() == 1, "reply forwarded" );
+      check( in[0].dgram.header.dst == ip( HOST ) and in[0].dst_port == 40000, "reply translated back" );
+      check( in[0].dgram.header.src == ip( SERVER ) and in[0].src_port == 80, "reply source untouched" );
+
+      // 另一个主机的流拿到下一个端口；端口用完就丢
+      arrive( router, INSIDE, datagram( HOST2, 40000, SERVER, 80 ) );
+      out = sent( router, OUTSIDE );
+      check( out.size() == 1 and out[0].src_port == 5001, "second flow, second port" );
+      arrive( router, INSIDE, datagram( HOST2, 40001, SERVER, 80 ) );
+      check( sent( router, OUTSIDE ).empty() and router.stats( INSIDE ).nat_dropped == 1, "out of ports" );
+
+      // 没有映射的、端口或对端不对的回复都丢掉
+      arrive( router, OUTSIDE, datagram( SERVER, 80, EXTERNAL, 5002 ) );
+      arrive( router, OUTSIDE, datagram( SERVER, 81, EXTERNAL, 5000 ) );
+      arrive( router, OUTSIDE, datagram( "198.51.100.8", 80, EXTERNAL, 5000 ) );
+      check( sent( router, INSIDE ).empty() and router.stats( OUTSIDE ).nat_dropped == 3, "unsolicited dropped" );
+
+      // UDP 的端口和 TCP 分开，同一个端口号可以再用
+      arrive( router, INSIDE, datagram( HOST, 53000, SERVER, 53, UDP ) );
+      out = sent( router, OUTSIDE );
+      check( out.size() == 1 and out[0].src_port == 5000, "UDP has its own ports" );
+      arrive( router, OUTSIDE, datagram( SERVER, 53, EXTERNAL, 5000, UDP ) );
+      in = sent( router, INSIDE );
+      check( in.size() == 1 and in[0].dgram.header.dst == ip( HOST ) and in[0].dst_port == 53000, "UDP reply" );
+    }
+
+    // 没有校验和的 UDP 保持没有校验和
+    {
+      auto router = gateway( config );
+      arrive( router, INSIDE, datagram( HOST, 53000, SERVER, 53, UDP, false ) );
+      auto out = sent( router, OUTSIDE );
+      check( out.size() == 1 and out[0].src_port == 5000, "translated" );
+      string l4;
+      for ( const auto& buffer : out[0].dgram.payload ) {
+        l4 += string_view { buffer };
+      }
+      check( read16( l4, 6 ) == 0, "still no checksum" );
+    }
+
+    // 其他协议和分片不翻译
+    {
+      auto router = gateway( config );
+      auto icmp = datagram( HOST, 0, SERVER, 0 );
+      icmp.header.proto = 1;
+      icmp.header.compute_checksum();
+      arrive( router, INSIDE, icmp );
+      auto fragment = datagram( HOST, 40000, SERVER, 80 );
+      fragment.header.mf = true;
+      fragment.header.df = false;
+      fragment.header.compute_checksum();
+      arrive( router, INSIDE, fragment );
+      check( sent( router, OUTSIDE ).empty() and router.stats( INSIDE ).nat_dropped == 2, "not translated" );
+
+      // 不经过 NAT 接口的不受影响
+      arrive( router, INSIDE, datagram( HOST, 40000, HOST2, 80 ) );
+      auto in = sent( router, INSIDE );
+      check( in.size() == 1 and in[0].dgram.header.src == ip( HOST ) and in[0].src_port == 40000, "inside traffic" );
+    }
+
+    // 空闲的映射过期，端口收回；一直在用的不过期
+    {
+      auto router = gateway( config );
+      arrive( router, INSIDE, datagram( HOST, 1, SERVER, 53, UDP ) );
+      arrive( router, INSIDE, datagram( HOST, 2, SERVER, 53, UDP ) );
+      sent( router, OUTSIDE );
+      check( router.nat()->size() == 2, "two mappings" );
+      for ( int i = 0; i < 5; ++i ) {
+        router.tick( 400 );
+        arrive( router, OUTSIDE, datagram( SERVER, 53, EXTERNAL, 5000, UDP ) ); // 只有第一个流有回复
+      }
+      check( sent( router, INSIDE ).size() == 5, "replies kept flowing" );
+      check( router.nat()->size() == 1 and router.nat()->expired() == 1, "the idle flow expired" );
+      arrive( router, OUTSIDE, datagram( SERVER, 53, EXTERNAL, 5001, UDP ) );
+      check( sent( router, INSIDE ).empty(), "expired mapping no longer translates" );
+
+      arrive( router, INSIDE, datagram( HOST, 3, SERVER, 53, UDP ) );
+      auto out = sent( router, OUTSIDE );
+      check( out.size() == 1 and out[0].src_port == 5001, "port reused after expiry" );
+
+      router.tick( 999 );
+      check( router.nat()->size() == 2, "both flows used within the timeout" );
+      router.tick( 1 );
+      check( router.nat()->size() == 0 and router.nat()->expired() == 3, "all expired" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
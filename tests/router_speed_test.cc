@@ -0,0 +1,266 @@
+#include "allocation_counter.hh"
+#include "arp_message.hh"
+#include "router.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+EthernetAddress ethernet_address( uint8_t last )
+{
+  return { 0x02, 0, 0, 0, 0, last };
+}
+
+// 20-byte header + 64-byte payload, as a host on the ingress network would send it
+InternetDatagram make_datagram( uint32_t dst )
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address { "192.168.0.2" }.ipv4_numeric();
+  dgram.header.dst = dst;
+  dgram.header.ttl = 64;
+  dgram.payload.emplace_back( string( 64, 'x' ) );
+  dgram.header.len = IPv4Header::LENGTH + dgram.payload.back().size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+void report( const string& what, const size_t packets, const duration<double> elapsed, const double min_mpps )
+{
+  auto const mpps = static_cast<double>( packets ) / elapsed.count() / 1e6;
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << what << " reached " << fixed << setprecision( 2 ) << mpps << " Mpkt/s.\n";
+  debug_output << "   " << what << ": " << fixed << setprecision( 2 ) << mpps << " Mpkt/s\n";
+
+  if ( mpps < min_mpps ) {
+    throw runtime_error( what + " did not meet minimum speed of " + to_string( min_mpps ) + " Mpkt/s." );
+  }
+}
+
+// The per-hop header update alone: the full recomputation route() used to do, against RFC 1624
+void header_update_speed_test( const size_t num_packets, const bool incremental )
+{
+  IPv4Header header = make_datagram( Address { "10.0.0.2" }.ipv4_numeric() ).header;
+
+  uint64_t result = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < num_packets; ++i ) {
+    header.ttl = 64; // 每次都从同一个 TTL 开始（增量方式下校验和会漂移，但不影响计时）
+    if ( incremental ) {
+      header.decrement_ttl();
+    } else {
+      --header.ttl;
+      header.compute_checksum();
+    }
+    result += header.cksum;
+  }
+  const auto stop_time = steady_clock::now();
+
+  cout << "(checksum sum " << result << ")\n";
+  report( string { "IPv4 TTL update (" } + ( incremental ? "incremental" : "recompute" ) + ")",
+          num_packets,
+          stop_time - start_time,
+          0.1 );
+}
+
+// End to end: parse frames on the ingress interface, route them, serialize them on the egress interface.
+// `burst` frames arrive between calls to route().
+void forwarding_speed_test( const size_t num_packets, const size_t burst )
+{
+  Router router;
+  const auto ingress = router.add_interface( { ethernet_address( 1 ), Address { "192.168.0.1" } } );
+  const auto egress = router.add_interface( { ethernet_address( 2 ), Address { "10.0.0.1" } } );
+  router.add_route( Address { "192.168.0.0" }.ipv4_numeric(), 24, {}, ingress );
+  router.add_route( Address { "10.0.0.0" }.ipv4_numeric(), 8, {}, egress );
+
+  // 先让出口学会下一跳的以太网地址
+  const Address next_hop { "10.0.0.2" };
+  ARPMessage reply;
+  reply.opcode = ARPMessage::OPCODE_REPLY;
+  reply.sender_ethernet_address = ethernet_address( 3 );
+  reply.sender_ip_address = next_hop.ipv4_numeric();
+  reply.target_ethernet_address = ethernet_address( 2 );
+  reply.target_ip_address = Address { "10.0.0.1" }.ipv4_numeric();
+  router.interface( egress ).recv_frame(
+    { { ethernet_address( 2 ), ethernet_address( 3 ), EthernetHeader::TYPE_ARP }, serialize( reply ) } );
+
+  const EthernetFrame frame { { ethernet_address( 1 ), ethernet_address( 4 ), EthernetHeader::TYPE_IPv4 },
+                              serialize( make_datagram( next_hop.ipv4_numeric() ) ) };
+
+  size_t forwarded = 0;
+  vector<EthernetFrame> sent;
+  const AllocationCounter allocations;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < num_packets; i += burst ) {
+    for ( size_t j = 0; j < burst; ++j ) {
+      router.interface( ingress ).recv_frame( frame );
+    }
+    router.route();
+    router.interface( egress ).maybe_send_all( sent );
+    forwarded += sent.size();
+    sent.clear();
+  }
+  const auto stop_time = steady_clock::now();
+
+  if ( forwarded != num_packets ) {
+    throw runtime_error( "Router forwarded " + to_string( forwarded ) + " of " + to_string( num_packets )
+                         + " datagrams" );
+  }
+
+  cout << "Router forwarding (bursts of " << burst << "): " << allocations.per( num_packets )
+       << " allocations per packet.\n";
+  report( "Router forwarding (bursts of " + to_string( burst ) + ")",
+          num_packets,
+          stop_time - start_time,
+          0.01 );
+}
+// The same with a full-size table and no route cache: every datagram goes to a different random
+// destination, so most lookups miss the CPU cache (what burst lookups in route_batch() hide)
+void full_table_forwarding_speed_test( const size_t num_packets, const size_t burst )
+{
+  Router router { 0 };
+  const auto ingress = router.add_interface( { ethernet_address( 1 ), Address { "192.168.0.1" } } );
+  const auto egress = router.add_interface( { ethernet_address( 2 ), Address { "10.0.0.1" } } );
+  const Address next_hop { "10.0.0.2" };
+  default_random_engine rd { 27182 };
+  uniform_int_distribution<uint32_t> u32_dist;
+  uniform_int_distribution<int> length { 16, 24 };
+  vector<RouteTable::Route> routes { { 0, 0, { { next_hop, egress } } } };
+  for ( size_t i = 0; i < 500000; ++i ) {
+    routes.push_back( { u32_dist( rd ), static_cast<uint8_t>( length( rd ) ), { { next_hop, egress } } } );
+  }
+  router.load_routes( routes );
+
+  ARPMessage reply;
+  reply.opcode = ARPMessage::OPCODE_REPLY;
+  reply.sender_ethernet_address = ethernet_address( 3 );
+  reply.sender_ip_address = next_hop.ipv4_numeric();
+  reply.target_ethernet_address = ethernet_address( 2 );
+  reply.target_ip_address = Address { "10.0.0.1" }.ipv4_numeric();
+  router.interface( egress ).recv_frame(
+    { { ethernet_address( 2 ), ethernet_address( 3 ), EthernetHeader::TYPE_ARP }, serialize( reply ) } );
+
+  vector<EthernetFrame> frames;
+  for ( size_t i = 0; i < 1 << 16; ++i ) {
+    frames.push_back( { { ethernet_address( 1 ), ethernet_address( 4 ), EthernetHeader::TYPE_IPv4 },
+                        serialize( make_datagram( u32_dist( rd ) ) ) } );
+  }
+
+  size_t forwarded = 0;
+  vector<EthernetFrame> sent;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < num_packets; i += burst ) {
+    for ( size_t j = 0; j < burst; ++j ) {
+      router.interface( ingress ).recv_frame( frames[( i + j ) % frames.size()] );
+    }
+    router.route();
+    router.interface( egress ).maybe_send_all( sent );
+    forwarded += sent.size();
+    sent.clear();
+  }
+  const auto stop_time = steady_clock::now();
+
+  if ( forwarded != num_packets ) {
+    throw runtime_error( "Router forwarded " + to_string( forwarded ) + " of " + to_string( num_packets )
+                         + " datagrams" );
+  }
+
+  report( "Router forwarding, full table, random destinations (bursts of " + to_string( burst ) + ")",
+          num_packets,
+          stop_time - start_time,
+          0.01 );
+}
+
+// Loading a full table: one add_route() per prefix, against parsing a text dump and load_routes()
+void route_load_speed_test( const size_t num_routes )
+{
+  default_random_engine rd { 31415 };
+  uniform_int_distribution<uint32_t> u32_dist;
+  uniform_int_distribution<int> percentile { 0, 99 };
+  uniform_int_distribution<int> mid_length { 16, 23 };
+  uniform_int_distribution<int> long_length { 25, 32 };
+  ostringstream dump;
+  vector<RouteTable::Route> routes;
+  for ( size_t i = 0; i < num_routes; ++i ) {
+    // 大致是 BGP 全表的分布：大部分 /24，其次 /16-/23，少量更长的
+    const int p = percentile( rd );
+    const auto length = static_cast<uint8_t>( p < 60 ? 24 : p < 97 ? mid_length( rd ) : long_length( rd ) );
+    const uint32_t prefix = u32_dist( rd );
+    const size_t interface_num = i % 8;
+    routes.push_back( { prefix, length, { { {}, interface_num } } } );
+    dump << Address::from_ipv4_numeric( prefix ).ip() << "/" << +length << " - " << interface_num << "\n";
+  }
+
+  Router incremental;
+  const auto incremental_start = steady_clock::now();
+  for ( const auto& route : routes ) {
+    incremental.add_route( route.route_prefix, route.prefix_length, {}, route.paths.front().interface_num );
+  }
+  const auto incremental_stop = steady_clock::now();
+
+  Router bulk;
+  const auto bulk_start = steady_clock::now();
+  istringstream input { dump.str() };
+  const auto parsed = RouteTable::parse( input );
+  const auto parse_stop = steady_clock::now();
+  bulk.load_routes( parsed );
+  const auto bulk_stop = steady_clock::now();
+
+  for ( size_t i = 0; i < 10000; ++i ) {
+    const auto address = u32_dist( rd );
+    const auto* a = incremental.lookup( address );
+    const auto* b = bulk.lookup( address );
+    if ( ( a == nullptr ) != ( b == nullptr ) || ( a && a->paths.front().interface_num != b->paths.front().interface_num ) ) {
+      throw runtime_error( "load_routes() built a different table than add_route()" );
+    }
+  }
+
+  const auto ms = []( auto elapsed ) { return duration_cast<duration<double, milli>>( elapsed ).count(); };
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << "Loading " << num_routes << " routes: add_route() " << fixed << setprecision( 1 )
+       << ms( incremental_stop - incremental_start ) << " ms; parse " << ms( parse_stop - bulk_start )
+       << " ms + load_routes() " << ms( bulk_stop - parse_stop ) << " ms.\n";
+  debug_output << "   Route load (" << num_routes << " routes): add_route() " << fixed << setprecision( 1 )
+               << ms( incremental_stop - incremental_start ) << " ms, load_routes() " << ms( bulk_stop - parse_stop )
+               << " ms\n";
+}
+} // namespace
+
+void program_body()
+{
+  header_update_speed_test( 2000000, false );
+  header_update_speed_test( 2000000, true );
+  forwarding_speed_test( 512000, 1 );
+  forwarding_speed_test( 512000, 64 );
+  full_table_forwarding_speed_test( 512000, 1 );
+  full_table_forwarding_speed_test( 512000, 64 );
+  route_load_speed_test( 500000 );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,93 @@
+#include "arp_message.hh"
+#include "common.hh"
+#include "router.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+EthernetAddress ethernet_address( uint8_t last )
+{
+  return { 0x02, 0, 0, 0, 0, last };
+}
+
+constexpr size_t IN = 0, OUT = 1;
+constexpr uint64_t FRAME_SIZE = EthernetHeader::LENGTH + IPv4Header::LENGTH + 10;
+
+EthernetFrame datagram_frame( const string& dst, uint8_t ttl = 64 )
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address { "10.0.0.2" }.ipv4_numeric();
+  dgram.header.dst = Address { dst }.ipv4_numeric();
+  dgram.payload.emplace_back( string( 10, 'x' ) );
+  dgram.header.len = IPv4Header::LENGTH + 10;
+  dgram.header.ttl = ttl;
+  dgram.header.compute_checksum();
+  return { { ethernet_address( IN ), ethernet_address( 9 ), EthernetHeader::TYPE_IPv4 }, serialize( dgram ) };
+}
+} // namespace
+
+int main()
+{
+  try {
+    Router router;
+    router.add_interface( { ethernet_address( IN ), Address { "10.0.0.1" } } );
+    router.add_interface( { ethernet_address( OUT ), Address { "10.1.0.1" } } );
+    router.add_route( Address { "10.1.0.0" }.ipv4_numeric(), 16, {}, OUT );
+
+    router.interface( IN ).recv_frame( datagram_frame( "10.1.0.2" ) ); // 等 ARP
+    router.interface( IN ).recv_frame( datagram_frame( "10.1.0.2" ) ); // 同一个下一跳，也等 ARP
+    router.interface( IN ).recv_frame( datagram_frame( "10.1.0.2", 1 ) ); // TTL 到期
+    router.interface( IN ).recv_frame( datagram_frame( "8.8.8.8" ) );     // 没有路由
+    auto corrupt = datagram_frame( "10.1.0.2" );
+    string& bytes = corrupt.payload.front();
+    bytes[8] ^= 1; // 改 TTL 不改校验和
+    router.interface( IN ).recv_frame( corrupt );
+    // 发给别人的帧不算
+    router.interface( IN ).recv_frame(
+      { { ethernet_address( 50 ), ethernet_address( 9 ), EthernetHeader::TYPE_IPv4 }, {} } );
+    router.route();
+
+    auto in = router.stats( IN );
+    check( in.frames_in == 5, "frames_in " + to_string( in.frames_in ) );
+    check( in.bytes_in == 5 * FRAME_SIZE, "bytes_in " + to_string( in.bytes_in ) );
+    check( in.ttl_expired == 1, "ttl_expired" );
+    check( in.no_route == 1, "no_route" );
+    check( in.checksum_failures == 1, "checksum_failures" );
+    check( in.malformed == 0, "malformed" );
+    check( in.frames_out == 0 && in.bytes_out == 0, "nothing sent on IN" );
+
+    auto out = router.stats( OUT );
+    check( out.arp_pending == 2, "arp_pending " + to_string( out.arp_pending ) );
+    check( out.frames_out == 0, "frames_out counted before maybe_send()" );
+    check( router.interface( OUT ).maybe_send().has_value(), "no ARP request" );
+    out = router.stats( OUT );
+    check( out.frames_out == 1 && out.bytes_out == EthernetHeader::LENGTH + ARPMessage::LENGTH, "ARP request counted" );
+
+    // ARP 回复到了，排队的数据报发出去
+    ARPMessage reply;
+    reply.opcode = ARPMessage::OPCODE_REPLY;
+    reply.sender_ethernet_address = ethernet_address( 3 );
+    reply.sender_ip_address = Address { "10.1.0.2" }.ipv4_numeric();
+    reply.target_ethernet_address = ethernet_address( OUT );
+    reply.target_ip_address = Address { "10.1.0.1" }.ipv4_numeric();
+    router.interface( OUT ).recv_frame(
+      { { ethernet_address( OUT ), ethernet_address( 3 ), EthernetHeader::TYPE_ARP }, serialize( reply ) } );
+    while ( router.interface( OUT ).maybe_send() ) {}
+
+    out = router.stats( OUT );
+    check( out.arp_pending == 0, "arp_pending after reply" );
+    check( out.frames_in == 1, "ARP reply counted" );
+    check( out.frames_out == 3, "frames_out " + to_string( out.frames_out ) );
+    check( out.bytes_out == EthernetHeader::LENGTH + ARPMessage::LENGTH + 2 * FRAME_SIZE, "bytes_out" );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
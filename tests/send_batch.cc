@@ -0,0 +1,91 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "Batch: nothing to send", cfg };
+      test.execute( ExpectMessages { 0 } );
+      test.execute( Push {} );
+      test.execute( ExpectMessages { 1 } );
+      test.execute( ExpectMessages { 0 } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "Batch: wide window opens", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 0 ) );
+
+      string data( 4500, 0 );
+      generate( data.begin(), data.end(), [&] { return rd(); } );
+      const Buffer pushed { data };
+      test.execute( PushBuffer { pushed } );
+      test.execute( ExpectMessage {}.with_payload_size( 1 ) );
+      test.execute( AckReceived { Wrap32 { isn + 2 } }.with_win( 10000 ) );
+      test.execute( ExpectMessages { 5 }.with_data( data.substr( 1 ) ).sharing( pushed ) );
+      test.execute( ExpectSeqnosInFlight { 4499 } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "Batch: retransmission shares the payload", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 5000 ) );
+      const Buffer pushed { string( 2000, 'x' ) };
+      test.execute( PushBuffer { pushed } );
+      test.execute( ExpectMessages { 2 }.sharing( pushed ) );
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectMessages { 1 }.with_data( string( 1000, 'x' ) ).sharing( pushed ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "Batch: payload that spans pushes is still sent", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { Wrap32 { isn + 1 } }.with_win( 0 ).without_push() );
+      test.execute( Push { "abc" } );
+      test.execute( Push { "defg" }.with_close() );
+      test.execute( ExpectMessages { 1 }.with_data( "a" ) );
+      test.execute( AckReceived { Wrap32 { isn + 2 } }.with_win( 1000 ) );
+      test.execute( ExpectMessages { 1 }.with_data( "bcdefg" ) );
+      test.execute( ExpectSeqnosInFlight { 7 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,186 @@
+#include "congestion_control.hh"
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "No congestion window by default", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 20000 ) );
+      test.execute( Push { string( 20000, 'x' ) } );
+      test.execute( ExpectSeqnosInFlight { 20000 } );
+      test.execute( ExpectCwnd { UINT64_MAX } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::Reno;
+
+      TCPSenderTestHarness test { "Reno slow start and timeout", cfg };
+      test.execute( ExpectCwnd { 4000 } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ).without_push() );
+      test.execute( ExpectCwnd { 4001 } );
+      test.execute( Push { string( 50000, 'x' ) } );
+      test.execute( ExpectSeqnosInFlight { 4001 } );
+      test.execute( ExpectMessages { 5 } );
+
+      // 每个 ACK 最多增长 2 * MSS
+      test.execute( AckReceived { isn + 1001 }.with_win( 60000 ) );
+      test.execute( ExpectCwnd { 5001 } );
+      test.execute( ExpectMessages { 2 } );
+      test.execute( AckReceived { isn + 4002 }.with_win( 60000 ) );
+      test.execute( ExpectCwnd { 7001 } );
+      test.execute( ExpectSeqnosInFlight { 7001 } );
+      test.execute( ExpectMessages { 6 } );
+
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectCwnd { 1000 } );
+      test.execute( ExpectMessages { 1 } );
+
+      // ssthresh = 7001 / 2，慢启动到 ssthresh 之后按拥塞避免增长
+      test.execute( AckReceived { isn + 5002 }.with_win( 60000 ).without_push() );
+      test.execute( ExpectCwnd { 2000 } );
+      test.execute( AckReceived { isn + 7002 }.with_win( 60000 ).without_push() );
+      test.execute( ExpectCwnd { 4000 } );
+      test.execute( AckReceived { isn + 10002 }.with_win( 60000 ).without_push() );
+      test.execute( ExpectCwnd { 4000 } );
+      test.execute( AckReceived { isn + 11002 }.with_win( 60000 ).without_push() );
+      test.execute( ExpectCwnd { 5000 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::Reno;
+
+      TCPSenderTestHarness test { "Stale ACK does not grow the window twice", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ).without_push() );
+      test.execute( Push { string( 50000, 'x' ) } );
+      test.execute( ExpectMessages { 5 } );
+      test.execute( AckReceived { isn + 1001 }.with_win( 60000 ).without_push() );
+      test.execute( ExpectCwnd { 5001 } );
+      test.execute( ExpectSeqnosInFlight { 3001 } );
+
+      // 晚到的旧 ACK：确认点不退，cwnd 不变
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ).without_push() );
+      test.execute( ExpectCwnd { 5001 } );
+      test.execute( ExpectSeqnosInFlight { 3001 } );
+      test.execute( ExpectDuplicateAcks { 0 } );
+
+      // 下一个 ACK 只确认新的 1000 字节
+      test.execute( AckReceived { isn + 2001 }.with_win( 60000 ).without_push() );
+      test.execute( ExpectCwnd { 6001 } );
+      test.execute( ExpectSeqnosInFlight { 2001 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.fast_retransmit = true;
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::Reno;
+
+      TCPSenderTestHarness test { "Reno halves on fast retransmit", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( Push { string( 50000, 'x' ) } );
+      test.execute( AckReceived { isn + 3001 }.with_win( 60000 ) );
+      test.execute( AckReceived { isn + 6001 }.with_win( 60000 ) );
+      test.execute( ExpectCwnd { 8001 } );
+      test.execute( ExpectSeqnosInFlight { 8001 } );
+      test.execute( ExpectMessages { 15 } );
+      for ( int i = 0; i < 3; ++i ) {
+        test.execute( AckReceived { isn + 6001 }.with_win( 60000 ) );
+      }
+      test.execute( ExpectCwnd { 4000 } );
+      // 未确认的最早一段是 [5002, 6002)
+      test.execute( ExpectMessage {}.with_seqno( isn + 5002 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      CubicCongestionControl cubic { 1000 };
+      uint64_t now = 0;
+      // 慢启动到 100 个 MSS
+      while ( cubic.cwnd() < 100'000 ) {
+        cubic.on_ack( 1000, now, 100 );
+      }
+      const auto w_max = cubic.cwnd();
+      cubic.on_fast_retransmit( w_max, now );
+      if ( cubic.cwnd() != static_cast<uint64_t>( w_max * CubicCongestionControl::BETA ) ) {
+        throw runtime_error( "CUBIC did not reduce the window by BETA on loss" );
+      }
+
+      // RTT 100 ms，每个 RTT 确认一整个窗口：先是凹增长，接近 W_max（K 约 4.2 s）时变平，之后再凸增长
+      uint64_t first_second = 0;
+      uint64_t near_k = 0;
+      for ( ; now <= 12000; now += 100 ) {
+        cubic.on_ack( cubic.cwnd(), now, 100 );
+        if ( now == 1000 ) {
+          first_second = cubic.cwnd();
+        }
+        if ( now == 4000 ) {
+          near_k = cubic.cwnd();
+        }
+      }
+      if ( not( first_second > w_max * 7 / 10 and near_k < w_max * 11 / 10 and near_k > w_max * 9 / 10
+                and cubic.cwnd() > 2 * w_max ) ) {
+        throw runtime_error( "CUBIC window did not follow the cubic curve: " + to_string( first_second ) + " "
+                             + to_string( near_k ) + " " + to_string( cubic.cwnd() ) );
+      }
+
+      cubic.on_timeout( cubic.cwnd(), now );
+      if ( cubic.cwnd() != 1000 ) {
+        throw runtime_error( "CUBIC did not collapse to one MSS on timeout" );
+      }
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::Cubic;
+
+      TCPSenderTestHarness test { "CUBIC in TCPSender", cfg };
+      test.execute( ExpectCwnd { 4000 } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( Push { string( 50000, 'x' ) } );
+      test.execute( ExpectMessages { 5 } );
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectCwnd { 1000 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
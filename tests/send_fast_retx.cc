@@ -0,0 +1,84 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    for ( const bool fast_retransmit : { true, false } ) {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.fast_retransmit = fast_retransmit;
+
+      TCPSenderTestHarness test { fast_retransmit ? "Fast retransmit after three duplicate ACKs"
+                                                  : "No fast retransmit unless enabled",
+                                  cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 8000 ) );
+      test.execute( Push { string( 4000, 'x' ) } );
+      test.execute( ExpectMessages { 4 } );
+
+      test.execute( AckReceived { isn + 1001 }.with_win( 8000 ) );
+      test.execute( AckReceived { isn + 1001 }.with_win( 8000 ) );
+      test.execute( AckReceived { isn + 1001 }.with_win( 8000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 1001 }.with_win( 8000 ) );
+      if ( fast_retransmit ) {
+        test.execute( ExpectMessage {}.with_seqno( isn + 1001 ).with_payload_size( 1000 ) );
+      }
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 3000 } );
+      test.execute( ExpectDuplicateAcks { 3 } );
+
+      // 只在第三个重复 ACK 时重传一次
+      test.execute( AckReceived { isn + 1001 }.with_win( 8000 ) );
+      test.execute( ExpectNoSegment {} );
+
+      // ackno 前进后重新计数
+      test.execute( AckReceived { isn + 3001 }.with_win( 8000 ) );
+      test.execute( AckReceived { isn + 3001 }.with_win( 8000 ) );
+      test.execute( AckReceived { isn + 3001 }.with_win( 8000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 3001 }.with_win( 8000 ) );
+      if ( fast_retransmit ) {
+        test.execute( ExpectMessage {}.with_seqno( isn + 3001 ) );
+      }
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.fast_retransmit = true;
+
+      TCPSenderTestHarness test { "Window updates are not duplicate ACKs", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 3000 ) );
+      test.execute( Push { string( 2000, 'x' ) } );
+      test.execute( ExpectMessages { 2 } );
+      test.execute( AckReceived { isn + 1 }.with_win( 3001 ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 3002 ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 3003 ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 3004 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
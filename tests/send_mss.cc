@@ -0,0 +1,100 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static_assert( TCPConfig::mss_for_mtu( 1500 ) == 1460 );
+static_assert( TCPConfig::mss_for_mtu( 9000 ) == 8960 );
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.mss = TCPConfig::mss_for_mtu( 9000 );
+
+      TCPSenderTestHarness test { "Jumbo-frame MSS", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( Push { string( 20000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 ).with_payload_size( 8960 ) );
+      test.execute( ExpectMessage {}.with_seqno( isn + 8961 ).with_payload_size( 8960 ) );
+      test.execute( ExpectMessage {}.with_seqno( isn + 17921 ).with_payload_size( 2080 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.mss = TCPConfig::mss_for_mtu( 9000 );
+      cfg.congestion_control = TCPConfig::CongestionAlgorithm::Reno;
+
+      TCPSenderTestHarness test { "Congestion window counts in the configured MSS", cfg };
+      test.execute( ExpectCwnd { 2 * 8960 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.tso_segments = 8;
+
+      TCPSenderTestHarness test { "Super-segments carry up to tso_segments * mss", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( Push { string( 20000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 ).with_payload_size( 8000 ) );
+      test.execute( ExpectMessage {}.with_seqno( isn + 8001 ).with_payload_size( 8000 ) );
+      test.execute( ExpectMessage {}.with_seqno( isn + 16001 ).with_payload_size( 4000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 20000 } );
+      test.execute( AckReceived { isn + 20001 }.with_win( 60000 ) );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      TCPSenderMessage msg { isn, true, string( 2500, 'x' ), true };
+      msg.window_scale = 3;
+      vector<TCPSenderMessage> pieces;
+      TCPSender::split_segment( msg, 1000, pieces );
+
+      check( pieces.size() == 3, "expected 3 pieces" );
+      check( pieces[0].SYN and not pieces[1].SYN and not pieces[2].SYN, "SYN only on the first piece" );
+      check( pieces[0].window_scale == 3 and not pieces[1].window_scale.has_value(), "window scale follows SYN" );
+      check( not pieces[0].FIN and not pieces[1].FIN and pieces[2].FIN, "FIN only on the last piece" );
+      check( pieces[0].seqno == isn and pieces[1].seqno == isn + 1001 and pieces[2].seqno == isn + 2001,
+             "seqnos are contiguous" );
+      check( pieces[0].payload.size() == 1000 and pieces[2].payload.size() == 500, "payload sizes" );
+      const string_view whole { msg.payload };
+      for ( const auto& piece : pieces ) {
+        const string_view payload { piece.payload };
+        check( payload.data() >= whole.data() and payload.data() + payload.size() <= whole.data() + whole.size(),
+               "pieces share the payload's storage" );
+      }
+
+      pieces.clear();
+      TCPSender::split_segment( TCPSenderMessage { isn, false, {}, true }, 1000, pieces );
+      check( pieces.size() == 1 and pieces[0].FIN and pieces[0].payload.empty(), "bare FIN is kept" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
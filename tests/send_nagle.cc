@@ -0,0 +1,103 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "Small writes go out at once without Nagle", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 8000 ) );
+      test.execute( Push { "a" } );
+      test.execute( ExpectMessage {}.with_data( "a" ) );
+      test.execute( Push { "b" } );
+      test.execute( ExpectMessage {}.with_data( "b" ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.nagle = true;
+
+      TCPSenderTestHarness test { "Nagle holds partial segments while data is unacknowledged", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 8000 ) );
+      test.execute( Push { "a" } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 ).with_data( "a" ) );
+      test.execute( Push { "b" } );
+      test.execute( Push { "c" } );
+      test.execute( ExpectNoSegment {} );
+
+      // ACK 回来后把攒下的小段一起发出去
+      test.execute( AckReceived { isn + 2 }.with_win( 8000 ) );
+      test.execute( ExpectMessage {}.with_seqno( isn + 2 ).with_data( "bc" ) );
+
+      // 满 MSS 的段照常发，只留下最后不满的部分
+      test.execute( Push { string( 2500, 'x' ) } );
+      test.execute( ExpectMessages { 2 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 2002 } );
+
+      // 关闭后剩下的字节和 FIN 一起发
+      test.execute( Close {} );
+      test.execute( ExpectMessage {}.with_payload_size( 500 ).with_fin( true ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.cork = true;
+
+      TCPSenderTestHarness test { "Corked sender sends only full segments", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 8000 ) );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Push { string( 1000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 ).with_payload_size( 1000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( SetCork { false } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1001 ).with_data( "xxx" ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.cork = true;
+
+      TCPSenderTestHarness test { "Zero-window probes are not corked", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 0 ) );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 ).with_data( "a" ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "Without pacing a window goes out in one burst", cfg };
+      test.execute( ExpectPacingRate { UINT64_MAX } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 8000 ) );
+      test.execute( Push { string( 5000, 'x' ) } );
+      test.execute( ExpectMessages { 5 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.pacing = true;
+      cfg.pacing_rate = 1'000'000; // 1000 bytes per ms
+
+      TCPSenderTestHarness test { "Fixed pacing rate releases one MSS per ms after a burst", cfg };
+      test.execute( ExpectPacingRate { 1'000'000 } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 8000 ) );
+      test.execute( Push { string( 5000, 'x' ) } );
+      // 桶里还有 2 * MSS - 1（SYN）个令牌：发两段后透支
+      test.execute( ExpectMessages { 2 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 5000 } );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 2001 ).with_payload_size( 1000 ) );
+      test.execute( ExpectNoSegment {} );
+      // 空闲再久也只攒一个 burst
+      test.execute( Tick { 50 } );
+      test.execute( ExpectMessages { 2 } );
+      test.execute( Push { string( 3000, 'y' ) } );
+      test.execute( Tick { 50 } );
+      test.execute( ExpectMessages { 2 } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.pacing = true;
+      cfg.pacing_burst = 500;
+      cfg.tso_segments = 4;
+
+      TCPSenderTestHarness test { "A segment bigger than the burst still goes out", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 8000 ) );
+      test.execute( Push { string( 4000, 'x' ) } );
+      test.execute( ExpectMessage {}.with_payload_size( 4000 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.pacing = true;
+      cfg.adaptive_rto = true;
+
+      TCPSenderTestHarness test { "Pacing rate derived from window and SRTT", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      // 还没有 SRTT：不限速
+      test.execute( ExpectPacingRate { UINT64_MAX } );
+      test.execute( Tick { 100 } );
+      test.execute( AckReceived { isn + 1 }.with_win( 8000 ) );
+      test.execute( ExpectSRTT { 100 } );
+      // 8000 字节 / 100 ms * 125%
+      test.execute( ExpectPacingRate { 100'000 } );
+      test.execute( Push { string( 5000, 'x' ) } );
+      test.execute( ExpectMessages { 2 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 10 } );
+      test.execute( ExpectMessage {}.with_seqno( isn + 2001 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "RTO stays fixed unless adaptive_rto is set", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( Tick { 10 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectSRTT { 0 } );
+      test.execute( ExpectRTO { cfg.rt_timeout } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.adaptive_rto = true;
+      cfg.rto_min = 10;
+
+      TCPSenderTestHarness test { "RTO follows measured RTT", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( ExpectRTO { cfg.rt_timeout } );
+      test.execute( Tick { 40 } );
+      // 第一个样本：SRTT = 40，RTTVAR = 20，RTO = 40 + 4 * 20
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectSRTT { 40 } );
+      test.execute( ExpectRTO { 120 } );
+
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_data( "abc" ) );
+      test.execute( Tick { 24 } );
+      // RTTVAR = 3/4 * 20 + 1/4 * 16 = 19，SRTT = 7/8 * 40 + 1/8 * 24 = 38
+      test.execute( AckReceived { isn + 4 } );
+      test.execute( ExpectSRTT { 38 } );
+      test.execute( ExpectRTO { 114 } );
+
+      // 按新的 RTO 超时重传
+      test.execute( Push { "def" } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( Tick { 113 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 1 } );
+      test.execute( ExpectMessage {}.with_data( "def" ) );
+      test.execute( ExpectRTO { 228 } );
+
+      // Karn：重传过的段不采样
+      test.execute( Tick { 200 } );
+      test.execute( AckReceived { isn + 7 } );
+      test.execute( ExpectSRTT { 38 } );
+      test.execute( ExpectRTO { 114 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.adaptive_rto = true;
+      cfg.rto_min = 200;
+      cfg.rto_max = 1000;
+
+      TCPSenderTestHarness test { "RTO is clamped to [rto_min, rto_max]", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( Tick { 1 } );
+      test.execute( AckReceived { isn + 1 } );
+      test.execute( ExpectSRTT { 1 } );
+      test.execute( ExpectRTO { 200 } );
+
+      test.execute( Push { "x" } );
+      test.execute( ExpectMessage {}.with_data( "x" ) );
+      for ( uint64_t rto : { 200, 400, 800, 1000, 1000 } ) {
+        test.execute( Tick { rto - 1 } );
+        test.execute( ExpectNoSegment {} );
+        test.execute( Tick { 1 } );
+        test.execute( ExpectMessage {}.with_data( "x" ) );
+      }
+      test.execute( ExpectRTO { 1000 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
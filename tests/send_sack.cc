@@ -0,0 +1,98 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.fast_retransmit = true;
+
+      TCPSenderTestHarness test { "Fast retransmit fills every SACKed hole", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 8000 ) );
+      test.execute( Push { string( 5000, 'x' ) } );
+      test.execute( ExpectMessages { 5 } );
+
+      // 第 2、4 段丢失，第 3、5 段被 SACK
+      test.execute( AckReceived { isn + 1001 }.with_win( 8000 ) );
+      test.execute( AckReceived { isn + 1001 }.with_win( 8000 ).with_sack( isn + 2001, isn + 3001 ) );
+      test.execute( AckReceived { isn + 1001 }
+                      .with_win( 8000 )
+                      .with_sack( isn + 2001, isn + 3001 )
+                      .with_sack( isn + 4001, isn + 5001 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 1001 }
+                      .with_win( 8000 )
+                      .with_sack( isn + 2001, isn + 3001 )
+                      .with_sack( isn + 4001, isn + 5001 ) );
+      test.execute( ExpectMessage {}.with_seqno( isn + 1001 ).with_payload_size( 1000 ) );
+      test.execute( ExpectMessage {}.with_seqno( isn + 3001 ).with_payload_size( 1000 ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( ExpectSeqnosInFlight { 4000 } );
+
+      test.execute( AckReceived { isn + 5001 }.with_win( 8000 ) );
+      test.execute( ExpectSeqnosInFlight { 0 } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.fast_retransmit = true;
+
+      TCPSenderTestHarness test { "Segments past the highest SACK are not retransmitted", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 8000 ) );
+      test.execute( Push { string( 4000, 'x' ) } );
+      test.execute( ExpectMessages { 4 } );
+
+      // 只有第 2 段被 SACK，第 3、4 段可能还在路上
+      for ( int i = 0; i < 3; ++i ) {
+        test.execute( AckReceived { isn + 1 }.with_win( 8000 ).with_sack( isn + 1001, isn + 2001 ) );
+      }
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 ).with_payload_size( 1000 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.fast_retransmit = true;
+
+      TCPSenderTestHarness test { "SACK blocks beyond what was sent are ignored", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 8000 ) );
+      test.execute( Push { string( 3000, 'x' ) } );
+      test.execute( ExpectMessages { 3 } );
+
+      for ( int i = 0; i < 3; ++i ) {
+        test.execute( AckReceived { isn + 1 }.with_win( 8000 ).with_sack( isn + 2001, isn + 9001 ) );
+      }
+      test.execute( ExpectMessage {}.with_seqno( isn + 1 ).with_payload_size( 1000 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,89 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "No window scale offered unless enabled", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_window_scale( {} ) );
+      test.execute( PeerWindowScale { 7 } );
+      test.execute( AckReceived { isn + 1 }.with_win( 1000 ) );
+      test.execute( ExpectWindowSize { 1000 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.window_scaling = true;
+      cfg.recv_capacity = 4'000'000;
+
+      TCPSenderTestHarness test { "SYN offers the shift that fits recv_capacity", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_seqno( isn ).with_window_scale( 6 ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 1000 ) );
+      test.execute( ExpectWindowSize { 1000 } );
+      test.execute( Push { "abc" } );
+      test.execute( ExpectMessage {}.with_syn( false ).with_window_scale( {} ).with_data( "abc" ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.window_scaling = true;
+      cfg.send_capacity = 1'000'000;
+
+      TCPSenderTestHarness test { "Scaled window lets more than 64 KiB be in flight", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ) );
+      test.execute( PeerWindowScale { 4 } );
+      test.execute( AckReceived { isn + 1 }.with_win( 10000 ) );
+      test.execute( ExpectWindowSize { 160000 } );
+      test.execute( Push { string( 200000, 'x' ) } );
+      test.execute( ExpectMessages { 160 } );
+      test.execute( ExpectSeqnosInFlight { 160000 } );
+      test.execute( ExpectNoSegment {} );
+
+      test.execute( AckReceived { isn + 100001 }.with_win( 10000 ) );
+      test.execute( ExpectMessages { 40 } );
+      test.execute( ExpectSeqnosInFlight { 100000 } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.window_scaling = true;
+
+      TCPSenderTestHarness test { "Peer shift is limited to MAX_WINDOW_SCALE", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_window_scale( 0 ) );
+      test.execute( PeerWindowScale { 20 } );
+      test.execute( AckReceived { isn + 1 }.with_win( UINT16_MAX ) );
+      test.execute( ExpectWindowSize { uint64_t { UINT16_MAX } << TCPConfig::MAX_WINDOW_SCALE } );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -9,6 +9,7 @@
 #include <optional>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 const unsigned int DEFAULT_TEST_WINDOW = 137;
 
@@ -54,6 +55,49 @@ struct ExpectSeqnosInFlight : public ExpectNumber<StreamAndSender, uint64_t>
   uint64_t value( StreamAndSender& ss ) const override { return ss.second.sequence_numbers_in_flight(); }
 };
 
+struct ExpectRTO : public ExpectNumber<StreamAndSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "current_RTO_ms"; }
+  uint64_t value( StreamAndSender& ss ) const override { return ss.second.current_RTO_ms(); }
+};
+
+struct ExpectDuplicateAcks : public ExpectNumber<StreamAndSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "duplicate_acks"; }
+  uint64_t value( StreamAndSender& ss ) const override { return ss.second.duplicate_acks(); }
+};
+
+struct ExpectCwnd : public ExpectNumber<StreamAndSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "congestion_window"; }
+  uint64_t value( StreamAndSender& ss ) const override { return ss.second.congestion_window(); }
+};
+
+struct ExpectWindowSize : public ExpectNumber<StreamAndSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "window_size"; }
+  uint64_t value( StreamAndSender& ss ) const override { return ss.second.window_size(); }
+};
+
+// 0 means no RTT has been measured yet
+struct ExpectSRTT : public ExpectNumber<StreamAndSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "smoothed_rtt_ms"; }
+  uint64_t value( StreamAndSender& ss ) const override { return ss.second.smoothed_rtt_ms().value_or( 0 ); }
+};
+
+struct ExpectPacingRate : public ExpectNumber<StreamAndSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "pacing_rate"; }
+  uint64_t value( StreamAndSender& ss ) const override { return ss.second.pacing_rate(); }
+};
+
 struct ExpectNoSegment : public Expectation<StreamAndSender>
 {
   std::string description() const override { return "nothing to send"; }
@@ -145,6 +189,28 @@ struct Tick : public Action<StreamAndSender>
   }
 };
 
+struct SetCork : public Action<StreamAndSender>
+{
+  bool corked_;
+
+  explicit SetCork( bool corked ) : corked_( corked ) {}
+
+  std::string description() const override { return corked_ ? "cork" : "uncork"; }
+
+  void execute( StreamAndSender& ss ) const override { ss.second.set_cork( corked_ ); }
+};
+
+struct PeerWindowScale : public Action<StreamAndSender>
+{
+  uint8_t shift_;
+
+  explicit PeerWindowScale( uint8_t shift ) : shift_( shift ) {}
+
+  std::string description() const override { return "peer offered window scale " + std::to_string( shift_ ); }
+
+  void execute( StreamAndSender& ss ) const override { ss.second.set_peer_window_scale( shift_ ); }
+};
+
 struct Receive : public Action<StreamAndSender>
 {
   TCPReceiverMessage msg_;
@@ -154,7 +220,11 @@ struct Receive : public Action<StreamAndSender>
   std::string description() const override
   {
     std::ostringstream desc;
-    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size << ")";
+    desc << "receive(ack=" << to_string( msg_.ackno ) << ", win=" << msg_.window_size;
+    for ( const auto& [left, right] : msg_.sack ) {
+      desc << ", sack=[" << left << ", " << right << ")";
+    }
+    desc << ")";
     if ( push_ ) {
       desc << ", then push stream to TCPSender";
     }
@@ -175,6 +245,12 @@ struct Receive : public Action<StreamAndSender>
     }
   }
 
+  Receive& with_sack( Wrap32 left, Wrap32 right )
+  {
+    msg_.sack.emplace_back( left, right );
+    return *this;
+  }
+
   Receive& without_push()
   {
     push_ = false;
@@ -199,6 +275,7 @@ struct ExpectMessage : public Expectation<StreamAndSender>
   std::optional<Wrap32> seqno {};
   std::optional<std::string> data {};
   std::optional<size_t> payload_size {};
+  std::optional<std::optional<uint8_t>> window_scale {};
 
   ExpectMessage& with_syn( bool syn_ )
   {
@@ -233,6 +310,12 @@ struct ExpectMessage : public Expectation<StreamAndSender>
     return *this;
   }
 
+  ExpectMessage& with_window_scale( std::optional<uint8_t> window_scale_ )
+  {
+    window_scale = window_scale_;
+    return *this;
+  }
+
   ExpectMessage& with_data( std::string data_ )
   {
     data = std::move( data_ );
@@ -261,6 +344,13 @@ struct ExpectMessage : public Expectation<StreamAndSender>
     if ( fin.has_value() ) {
       o << ( fin.value() ? " +FIN" : " (no FIN)" );
     }
+    if ( window_scale.has_value() ) {
+      if ( window_scale->has_value() ) {
+        o << " wscale=" << static_cast<int>( **window_scale );
+      } else {
+        o << " (no wscale)";
+      }
+    }
     return o.str();
   }
 
@@ -287,10 +377,13 @@ struct ExpectMessage : public Expectation<StreamAndSender>
     if ( seqno.has_value() and seg.seqno != seqno.value() ) {
       throw ExpectationViolation( "sequence number", seqno.value(), seg.seqno );
     }
+    if ( window_scale.has_value() and seg.window_scale != window_scale.value() ) {
+      throw ExpectationViolation( "window scale", window_scale.value(), seg.window_scale );
+    }
     if ( payload_size.has_value() and seg.payload.size() != payload_size.value() ) {
       throw ExpectationViolation( "payload_size", payload_size.value(), seg.payload.size() );
     }
-    if ( seg.payload.size() > TCPConfig::MAX_PAYLOAD_SIZE ) {
+    if ( seg.payload.size() > ss.second.max_payload_size() ) {
       throw ExpectationViolation( "payload has length (" + std::to_string( seg.payload.size() )
                                   + ") greater than the maximum" );
     }
@@ -301,12 +394,86 @@ struct ExpectMessage : public Expectation<StreamAndSender>
   }
 };
 
+// Push a Buffer to the stream (so payloads can share its storage), then push to TCPSender
+struct PushBuffer : public Action<StreamAndSender>
+{
+  Buffer data_;
+
+  explicit PushBuffer( Buffer data ) : data_( std::move( data ) ) {}
+  std::string description() const override
+  {
+    return "push Buffer of " + std::to_string( data_.size() ) + " bytes to stream, then push to TCPSender";
+  }
+  void execute( StreamAndSender& ss ) const override
+  {
+    ss.first.writer().push( data_ );
+    ss.second.push( ss.first.reader() );
+  }
+};
+
+// Every queued message, taken at once with maybe_send_all()
+struct ExpectMessages : public Expectation<StreamAndSender>
+{
+  size_t count_;
+  std::optional<std::string> data_ {};
+  std::optional<Buffer> shared_with_ {};
+
+  explicit ExpectMessages( size_t count ) : count_( count ) {}
+
+  ExpectMessages& with_data( std::string data )
+  {
+    data_ = std::move( data );
+    return *this;
+  }
+
+  // Every payload must point into `buffer` (i.e. no bytes were copied)
+  ExpectMessages& sharing( Buffer buffer )
+  {
+    shared_with_ = std::move( buffer );
+    return *this;
+  }
+
+  std::string description() const override
+  {
+    return std::to_string( count_ ) + " messages sent at once"
+           + ( data_.has_value() ? " with payload=\"" + Printer::prettify( data_.value() ) + "\"" : "" )
+           + ( shared_with_.has_value() ? " without copying" : "" );
+  }
+
+  void execute( StreamAndSender& ss ) const override
+  {
+    std::vector<TCPSenderMessage> segs;
+    ss.second.maybe_send_all( segs );
+    if ( segs.size() != count_ ) {
+      throw ExpectationViolation( "number of messages", count_, segs.size() );
+    }
+    std::string data;
+    for ( const auto& seg : segs ) {
+      data += std::string_view { seg.payload };
+      if ( seg.payload.size() > ss.second.max_payload_size() ) {
+        throw ExpectationViolation( "payload has length (" + std::to_string( seg.payload.size() )
+                                    + ") greater than the maximum" );
+      }
+      if ( shared_with_.has_value() and not seg.payload.empty() ) {
+        const std::string_view whole { shared_with_.value() }, payload { seg.payload };
+        if ( payload.data() < whole.data() or payload.data() + payload.size() > whole.data() + whole.size() ) {
+          throw ExpectationViolation( "Expected every payload to share storage with the pushed Buffer" );
+        }
+      }
+    }
+    if ( data_.has_value() and data_.value() != data ) {
+      throw ExpectationViolation( "Expecting payloads of \"" + Printer::prettify( data_.value() )
+                                  + "\", but instead they were \"" + Printer::prettify( data ) + "\"" );
+    }
+  }
+};
+
 class TCPSenderTestHarness : public TestHarness<StreamAndSender>
 {
 public:
   TCPSenderTestHarness( std::string name, TCPConfig config )
     : TestHarness( move( name ),
                    "initial_RTO_ms=" + to_string( config.rt_timeout ),
-                   { ByteStream { config.send_capacity }, TCPSender { config.rt_timeout, config.fixed_isn } } )
+                   { ByteStream { config.send_capacity }, TCPSender { config } } )
   {}
 };
@@ -0,0 +1,56 @@
+#include "address.hh"
+#include "common.hh"
+#include "socket.hh"
+
+#include <exception>
+#include <iostream>
+#include <netinet/tcp.h>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+int main()
+{
+  try {
+    // 缓冲区大小：内核给的是请求的两倍
+    {
+      TCPSocket socket;
+      socket.set_send_buffer_size( 64 * 1024 );
+      socket.set_receive_buffer_size( 32 * 1024 );
+      check( socket.send_buffer_size() == 128 * 1024, "SO_SNDBUF doubled" );
+      check( socket.receive_buffer_size() == 64 * 1024, "SO_RCVBUF doubled" );
+      socket.set_busy_poll( 0 );
+    }
+
+    // SO_REUSEPORT：两个套接字绑同一个端口
+    {
+      TCPSocket first;
+      first.set_reuseport();
+      first.bind( Address { "127.0.0.1" } );
+      first.listen();
+      TCPSocket second;
+      second.set_reuseport();
+      second.bind( first.local_address() );
+      second.listen();
+      check( second.local_address().port() == first.local_address().port(), "same port twice" );
+
+      // 建好的连接上的 TCP 选项和 TCP_INFO
+      TCPSocket client;
+      client.set_nodelay();
+      client.connect( first.local_address() );
+      client.set_cork( true );
+      client.write( "corked" );
+      client.set_cork( false );
+      client.set_quickack();
+      const tcp_info info = client.info();
+      check( info.tcpi_state == TCP_ESTABLISHED, "TCP_INFO: established" );
+      check( info.tcpi_snd_mss > 0, "TCP_INFO: MSS" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,155 @@
+#include "address.hh"
+#include "buffer.hh"
+#include "common.hh"
+#include "exception.hh"
+#include "file_descriptor.hh"
+#include "socket.hh"
+
+#include <array>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+// A connected pair of TCP sockets over loopback
+pair<TCPSocket, TCPSocket> tcp_pair()
+{
+  TCPSocket listener;
+  listener.set_reuseaddr();
+  listener.bind( Address { "127.0.0.1" } );
+  listener.listen();
+  TCPSocket client;
+  client.connect( listener.local_address() );
+  return { std::move( client ), listener.accept() };
+}
+
+// Read from `fd` until `size` bytes have arrived
+string read_exactly( FileDescriptor& fd, size_t size )
+{
+  string all;
+  string buffer;
+  while ( all.size() < size ) {
+    fd.read( buffer );
+    check( not buffer.empty(), "unexpected EOF" );
+    all += buffer;
+  }
+  return all;
+}
+
+string pattern( size_t size )
+{
+  string out;
+  for ( size_t i = 0; i < size; ++i ) {
+    out.push_back( static_cast<char>( 'a' + i % 26 ) );
+  }
+  return out;
+}
+} // namespace
+
+int main()
+{
+  try {
+    // MSG_ZEROCOPY：Buffer 要一直留到内核的完成通知到了为止
+    {
+      auto [sender, receiver] = tcp_pair();
+      sender.set_zerocopy();
+      const string data = pattern( 200000 );
+      vector<Buffer> buffers;
+      for ( size_t i = 0; i < data.size(); i += 50000 ) {
+        buffers.emplace_back( data.substr( i, 50000 ) );
+      }
+
+      size_t sent = 0;
+      string got;
+      string chunk;
+      receiver.set_blocking( false );
+      while ( sent < data.size() ) {
+        vector<Buffer> rest;
+        size_t skip = sent;
+        for ( const auto& buffer : buffers ) {
+          if ( skip >= buffer.size() ) {
+            skip -= buffer.size();
+          } else {
+            rest.push_back( buffer.substr( skip ) );
+            skip = 0;
+          }
+        }
+        sent += sender.send( rest );
+        do {
+          receiver.read( chunk );
+          got += chunk;
+        } while ( not chunk.empty() );
+      }
+      receiver.set_blocking( true );
+      got += read_exactly( receiver, data.size() - got.size() );
+      check( got == data, "zero-copy send delivered the bytes" );
+
+      for ( int tries = 0; tries < 1000 and sender.zerocopy_pending() > 0; ++tries ) {
+        sender.reap_zerocopy();
+        usleep( 1000 );
+      }
+      check( sender.zerocopy_pending() == 0, "every send completed" );
+      check( sender.zerocopy_copied() > 0, "loopback copies the data after all" );
+    }
+
+    // 没开零拷贝：send( vector<Buffer> ) 就是普通的 sendmsg，什么都不留
+    {
+      auto [sender, receiver] = tcp_pair();
+      check( sender.send( { Buffer { string { "plain" } } } ) == 5, "plain send" );
+      check( sender.zerocopy_pending() == 0, "nothing held" );
+      check( read_exactly( receiver, 5 ) == "plain", "plain send delivered" );
+    }
+
+    // sendfile：文件内容不经过用户态就到了套接字
+    {
+      auto [sender, receiver] = tcp_pair();
+      FileDescriptor file { CheckSystemCall( "memfd_create", ::memfd_create( "zerocopy_test", 0 ) ) };
+      const string data = pattern( 100000 );
+      file.write( data );
+      off_t offset = 10;
+      size_t sent = 0;
+      while ( sent < data.size() - 10 ) {
+        sent += sender.sendfile_from( file, offset, data.size() );
+      }
+      check( offset == static_cast<off_t>( data.size() ), "offset advanced" );
+      check( sender.sendfile_from( file, offset, data.size() ) == 0, "end of file" );
+      check( read_exactly( receiver, data.size() - 10 ) == data.substr( 10 ), "sendfile delivered" );
+    }
+
+    // splice：套接字到套接字，经过一个管道
+    {
+      auto [client, upstream] = tcp_pair();
+      auto [proxy, server] = tcp_pair();
+      array<int, 2> fds {};
+      CheckSystemCall( "pipe", ::pipe( fds.data() ) );
+      FileDescriptor pipe_out { fds[0] };
+      FileDescriptor pipe_in { fds[1] };
+
+      const string data = pattern( 30000 );
+      client.write( data );
+      size_t moved = 0;
+      while ( moved < data.size() ) {
+        const size_t in_pipe = pipe_in.splice_from( upstream, data.size() - moved );
+        for ( size_t out = 0; out < in_pipe; ) {
+          out += proxy.splice_from( pipe_out, in_pipe - out );
+        }
+        moved += in_pipe;
+      }
+      check( read_exactly( server, data.size() ) == data, "spliced from socket to socket" );
+
+      client.close();
+      check( pipe_in.splice_from( upstream, 100 ) == 0, "splice sees EOF" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
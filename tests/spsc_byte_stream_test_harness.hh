@@ -0,0 +1,114 @@
+#pragma once
+
+#include "common.hh"
+#include "spsc_byte_stream.hh"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// SPSCByteStream 里有原子变量，不能移动；TestHarness 要按值持有对象，所以包一层 unique_ptr
+struct SPSCStream
+{
+  std::unique_ptr<SPSCByteStream> stream;
+
+  SPSCReader& reader() { return stream->reader(); }
+  SPSCWriter& writer() { return stream->writer(); }
+};
+
+class SPSCByteStreamTestHarness : public TestHarness<SPSCStream>
+{
+public:
+  SPSCByteStreamTestHarness( std::string test_name, uint64_t capacity )
+    : TestHarness( move( test_name ),
+                   "capacity=" + std::to_string( capacity ),
+                   SPSCStream { std::make_unique<SPSCByteStream>( capacity ) } )
+  {}
+};
+
+/* actions */
+
+struct SPSCPush : public Action<SPSCStream>
+{
+  std::string data_;
+
+  explicit SPSCPush( std::string data ) : data_( move( data ) ) {}
+  std::string description() const override { return "push \"" + Printer::prettify( data_ ) + "\" to the stream"; }
+  void execute( SPSCStream& bs ) const override { bs.writer().push( data_ ); }
+};
+
+struct SPSCClose : public Action<SPSCStream>
+{
+  std::string description() const override { return "close"; }
+  void execute( SPSCStream& bs ) const override { bs.writer().close(); }
+};
+
+struct SPSCPop : public Action<SPSCStream>
+{
+  size_t len_;
+
+  explicit SPSCPop( size_t len ) : len_( len ) {}
+  std::string description() const override { return "pop( " + std::to_string( len_ ) + " )"; }
+  void execute( SPSCStream& bs ) const override { bs.reader().pop( len_ ); }
+};
+
+/* expectations */
+
+// peek() 只给到 ring 末尾为止的连续一段
+struct SPSCPeekOnce : public Expectation<SPSCStream>
+{
+  std::string output_;
+
+  explicit SPSCPeekOnce( std::string output ) : output_( move( output ) ) {}
+
+  std::string description() const override
+  {
+    return "peek() gives exactly \"" + Printer::prettify( output_ ) + "\"";
+  }
+
+  void execute( SPSCStream& bs ) const override
+  {
+    auto peeked = bs.reader().peek();
+    if ( peeked != output_ ) {
+      throw ExpectationViolation { "Expected exactly \"" + Printer::prettify( output_ ) + "\" at front of stream, "
+                                   + "but found \"" + Printer::prettify( peeked ) + "\"" };
+    }
+  }
+};
+
+struct SPSCIsFinished : public ExpectBool<SPSCStream>
+{
+  using ExpectBool::ExpectBool;
+  std::string name() const override { return "is_finished"; }
+  bool value( SPSCStream& bs ) const override { return bs.reader().is_finished(); }
+};
+
+struct SPSCBytesBuffered : public ExpectNumber<SPSCStream, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "bytes_buffered"; }
+  size_t value( SPSCStream& bs ) const override { return bs.reader().bytes_buffered(); }
+};
+
+struct SPSCAvailableCapacity : public ExpectNumber<SPSCStream, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "available_capacity"; }
+  size_t value( SPSCStream& bs ) const override { return bs.writer().available_capacity(); }
+};
+
+struct SPSCBytesPushed : public ExpectNumber<SPSCStream, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "bytes_pushed"; }
+  size_t value( SPSCStream& bs ) const override { return bs.writer().bytes_pushed(); }
+};
+
+struct SPSCBytesPopped : public ExpectNumber<SPSCStream, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "bytes_popped"; }
+  size_t value( SPSCStream& bs ) const override { return bs.reader().bytes_popped(); }
+};
@@ -0,0 +1,206 @@
+#include "allocation_counter.hh"
+#include "arp_message.hh"
+#include "byte_stream_test_harness.hh"
+#include "reassembler.hh"
+#include "router.hh"
+
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Once a hot path is warm (pools filled, vectors grown), each operation should allocate nothing.
+// Every case warms up first and then counts the allocations over many operations. Where a path
+// still allocates, the limit is what it takes today, so a regression fails the test.
+
+namespace {
+constexpr size_t WARMUP = 1000;
+constexpr size_t ROUNDS = 10000;
+
+// `what` is a C string so that building the message doesn't count
+void check_per_op( const AllocationCounter& allocations, size_t ops, double max, const char* what )
+{
+  const double per_op = allocations.per( ops );
+  if ( per_op > max ) {
+    throw runtime_error( string { what } + ": " + to_string( per_op ) + " allocations per operation (at most "
+                         + to_string( max ) + " expected)" );
+  }
+}
+
+EthernetAddress ethernet_address( uint8_t last )
+{
+  return { 0x02, 0, 0, 0, 0, last };
+}
+
+void byte_stream_tests()
+{
+  const string chunk( 1000, 'x' );
+
+  for ( const auto backend : { ByteStream::Backend::Queue, ByteStream::Backend::Ring } ) {
+    ByteStream stream { 64 * 1024, backend };
+    const auto round = [&] {
+      stream.writer().push( string_view { chunk } );
+      stream.reader().pop( stream.reader().bytes_buffered() );
+    };
+    for ( size_t i = 0; i < WARMUP; ++i ) {
+      round();
+    }
+    const AllocationCounter allocations;
+    for ( size_t i = 0; i < ROUNDS; ++i ) {
+      round();
+    }
+    check_per_op( allocations, ROUNDS, 0, "ByteStream push(string_view)/pop" );
+  }
+
+  // 共享一个 Buffer：入队只加引用计数
+  {
+    ByteStream stream { 64 * 1024 };
+    const Buffer shared { chunk };
+    const auto round = [&] {
+      stream.writer().push( shared );
+      stream.reader().pop( stream.reader().bytes_buffered() );
+    };
+    for ( size_t i = 0; i < WARMUP; ++i ) {
+      round();
+    }
+    const AllocationCounter allocations;
+    for ( size_t i = 0; i < ROUNDS; ++i ) {
+      round();
+    }
+    check_per_op( allocations, ROUNDS, 0, "ByteStream push(Buffer)/pop" );
+  }
+
+  // 同样的检查，写成测试步骤
+  {
+    ByteStreamTestHarness test { "steady-state push and pop", 4096 };
+    for ( size_t i = 0; i < 100; ++i ) {
+      test.execute( PushView { "warm" } );
+      test.execute( Pop { 4 } );
+    }
+    test.execute( ExpectAllocations { PushView { "abcd" }, 0 } );
+    test.execute( ExpectAllocations { Pop { 4 }, 0 } );
+  }
+}
+
+void reassembler_tests()
+{
+  const string payload( 1460, 'r' );
+
+  for ( const auto engine : { Reassembler::Engine::Intervals, Reassembler::Engine::Bitmap } ) {
+    // 按序到达
+    {
+      Reassembler reassembler { engine };
+      ByteStream stream { 1 << 20 };
+      uint64_t next = 0;
+      const Buffer segment { payload };
+      const auto round = [&] {
+        reassembler.insert( next, segment, false, stream.writer() );
+        next += payload.size();
+        stream.reader().pop( stream.reader().bytes_buffered() );
+      };
+      for ( size_t i = 0; i < WARMUP; ++i ) {
+        round();
+      }
+      const AllocationCounter allocations;
+      for ( size_t i = 0; i < ROUNDS; ++i ) {
+        round();
+      }
+      check_per_op( allocations, ROUNDS, 0, "Reassembler::insert in order" );
+    }
+
+    // 每两个交换一次顺序：一半要先存起来
+    {
+      Reassembler reassembler { engine };
+      ByteStream stream { 1 << 20 };
+      uint64_t next = 0;
+      const Buffer segment { payload };
+      const auto round = [&] {
+        reassembler.insert( next + payload.size(), segment, false, stream.writer() );
+        reassembler.insert( next, segment, false, stream.writer() );
+        next += 2 * payload.size();
+        stream.reader().pop( stream.reader().bytes_buffered() );
+      };
+      for ( size_t i = 0; i < WARMUP; ++i ) {
+        round();
+      }
+      const AllocationCounter allocations;
+      for ( size_t i = 0; i < ROUNDS; ++i ) {
+        round();
+      }
+      // 池里大一档的空闲列表还可能偶尔长一下
+      check_per_op( allocations, 2 * ROUNDS, 0.001, "Reassembler::insert, pairs swapped" );
+    }
+  }
+}
+
+void router_tests()
+{
+  Router router;
+  const auto ingress = router.add_interface( { ethernet_address( 1 ), Address { "192.168.0.1" } } );
+  const auto egress = router.add_interface( { ethernet_address( 2 ), Address { "10.0.0.1" } } );
+  router.add_route( Address { "192.168.0.0" }.ipv4_numeric(), 24, {}, ingress );
+  router.add_route( Address { "10.0.0.0" }.ipv4_numeric(), 8, {}, egress );
+
+  const Address next_hop { "10.0.0.2" };
+  ARPMessage reply;
+  reply.opcode = ARPMessage::OPCODE_REPLY;
+  reply.sender_ethernet_address = ethernet_address( 3 );
+  reply.sender_ip_address = next_hop.ipv4_numeric();
+  reply.target_ethernet_address = ethernet_address( 2 );
+  reply.target_ip_address = Address { "10.0.0.1" }.ipv4_numeric();
+  router.interface( egress ).recv_frame(
+    { { ethernet_address( 2 ), ethernet_address( 3 ), EthernetHeader::TYPE_ARP }, serialize( reply ) } );
+
+  InternetDatagram dgram;
+  dgram.header.src = Address { "192.168.0.2" }.ipv4_numeric();
+  dgram.header.dst = next_hop.ipv4_numeric();
+  dgram.payload.emplace_back( string( 64, 'x' ) );
+  dgram.header.len = IPv4Header::LENGTH + dgram.payload.back().size();
+  dgram.header.compute_checksum();
+  const EthernetFrame frame { { ethernet_address( 1 ), ethernet_address( 4 ), EthernetHeader::TYPE_IPv4 },
+                              serialize( dgram ) };
+
+  constexpr size_t BURST = 32;
+  vector<EthernetFrame> sent;
+  size_t forwarded = 0;
+  const auto round = [&] {
+    for ( size_t j = 0; j < BURST; ++j ) {
+      router.interface( ingress ).recv_frame( frame );
+    }
+    router.route();
+    router.interface( egress ).maybe_send_all( sent );
+    forwarded += sent.size();
+    sent.clear();
+  };
+  for ( size_t i = 0; i < WARMUP / BURST; ++i ) {
+    round();
+  }
+  const AllocationCounter allocations;
+  for ( size_t i = 0; i < ROUNDS / BURST; ++i ) {
+    round();
+  }
+  if ( forwarded != ( WARMUP / BURST + ROUNDS / BURST ) * BURST ) {
+    throw runtime_error( "router dropped datagrams" );
+  }
+  // 还没到 0：解析时 payload 的 vector<Buffer>、序列化时输出的 vector<Buffer> 每个数据报都要分配。
+  // 这里先钉住现在的数目，只许变少。
+  check_per_op( allocations, ROUNDS / BURST * BURST, 5, "Router forwarding" );
+}
+} // namespace
+
+int main()
+{
+  try {
+    byte_stream_tests();
+    reassembler_tests();
+    router_tests();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
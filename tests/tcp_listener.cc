@@ -0,0 +1,79 @@
+#include "address.hh"
+#include "common.hh"
+#include "event_loop.hh"
+#include "socket.hh"
+#include "tcp_listener.hh"
+
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+// Read from `socket` until `size` bytes have arrived
+string read_exactly( TCPSocket& socket, size_t size )
+{
+  string all;
+  string buffer;
+  while ( all.size() < size ) {
+    socket.read( buffer );
+    check( not buffer.empty(), "unexpected EOF" );
+    all += buffer;
+  }
+  return all;
+}
+} // namespace
+
+int main()
+{
+  try {
+    // 四个接受线程共用一个端口；每个连接在接受它的线程的循环里回显
+    constexpr size_t THREADS = 4;
+    constexpr size_t CLIENTS = 200;
+    TCPListener listener {
+      Address { "127.0.0.1" },
+      []( TCPSocket&& connection, EventLoop& loop ) {
+        check( connection.fd_num() >= 0, "accepted" );
+        auto socket = make_shared<TCPSocket>( std::move( connection ) );
+        loop.add_reader( *socket, [socket]( string_view data ) { socket->write( data ); } );
+      },
+      THREADS };
+    check( listener.threads() == THREADS, "one listening socket per thread" );
+    listener.start();
+
+    vector<TCPSocket> clients( CLIENTS );
+    for ( size_t i = 0; i < CLIENTS; ++i ) {
+      clients[i].connect( listener.address() );
+      clients[i].write( "ping " + to_string( i ) );
+    }
+    for ( size_t i = 0; i < CLIENTS; ++i ) {
+      const string expected = "ping " + to_string( i );
+      check( read_exactly( clients[i], expected.size() ) == expected, "echoed by its worker" );
+    }
+
+    check( listener.accepted() == CLIENTS, "every connection accepted once" );
+    size_t busy = 0;
+    for ( size_t i = 0; i < THREADS; ++i ) {
+      busy += listener.accepted( i ) > 0 ? 1 : 0;
+    }
+    check( busy > 1, "the kernel spread connections across the listening sockets" );
+
+    // 停下以后还能再启动
+    listener.stop();
+    listener.start();
+    TCPSocket late;
+    late.connect( listener.address() );
+    late.write( "late" );
+    check( read_exactly( late, 4 ) == "late", "restarted" );
+    listener.stop();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
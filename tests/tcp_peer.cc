@@ -0,0 +1,242 @@
+#include "random.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+struct Endpoint
+{
+  TCPPeer peer;
+  string to_send;
+  size_t written {};
+  string received {};
+  bool close_when_done { true };
+
+  // 把能写的数据写进 outbound 流，读出 inbound 流里的数据
+  void pump()
+  {
+    auto& writer = peer.outbound_writer();
+    if ( written < to_send.size() && !writer.is_closed() ) {
+      const auto len = min<uint64_t>( writer.available_capacity(), to_send.size() - written );
+      writer.push( to_send.substr( written, len ) );
+      written += len;
+    }
+    if ( written == to_send.size() && close_when_done && !writer.is_closed() ) {
+      writer.close();
+    }
+    peer.push();
+
+    auto& reader = peer.inbound_reader();
+    while ( reader.bytes_buffered() ) {
+      received += reader.peek();
+      reader.pop( reader.peek().size() );
+    }
+  }
+};
+
+// 把 from 要发的段交给 to，drop 返回 true 的段丢掉；返回发出的段数。batched：剩下的段一次交给 receive_batch()
+size_t deliver( Endpoint& from, Endpoint& to, const function<bool()>& drop, bool batched = false )
+{
+  vector<TCPMessage> msgs;
+  from.peer.maybe_send_all( msgs );
+  auto const sent = msgs.size();
+  erase_if( msgs, [&]( const TCPMessage& ) { return drop(); } );
+  if ( batched ) {
+    to.peer.receive_batch( msgs );
+  } else {
+    for ( auto& msg : msgs ) {
+      to.peer.receive( std::move( msg ) );
+    }
+  }
+  return sent;
+}
+
+string random_string( default_random_engine& rd, size_t len )
+{
+  string ret( len, 0 );
+  for ( auto& ch : ret ) {
+    ch = static_cast<char>( rd() );
+  }
+  return ret;
+}
+
+void transfer( const string& name,
+               const TCPConfig& config,
+               double loss,
+               default_random_engine& rd,
+               bool batched = false )
+{
+  Endpoint a { TCPPeer { config }, random_string( rd, 200000 ) };
+  Endpoint b { TCPPeer { config }, random_string( rd, 50000 ) };
+  bernoulli_distribution lose { loss };
+  auto const drop = [&] { return lose( rd ); };
+
+  a.peer.connect();
+  uint64_t ms = 0;
+  while ( a.peer.active() || b.peer.active() ) {
+    if ( ms > 600000 ) {
+      throw runtime_error( name + ": connection did not finish" );
+    }
+    a.pump();
+    b.pump();
+    deliver( a, b, drop, batched );
+    deliver( b, a, drop, batched );
+    a.pump();
+    b.pump();
+    a.peer.tick( 10 );
+    b.peer.tick( 10 );
+    ms += 10;
+  }
+
+  if ( a.peer.inbound_reader().has_error() || b.peer.inbound_reader().has_error() ) {
+    throw runtime_error( name + ": connection failed" );
+  }
+  if ( b.received != a.to_send || a.received != b.to_send ) {
+    throw runtime_error( name + ": data mismatch" );
+  }
+}
+} // namespace
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig config;
+      Endpoint a { TCPPeer { config }, "" };
+      Endpoint b { TCPPeer { config }, "" };
+      b.close_when_done = false;
+      auto const never = [] { return false; };
+
+      // 三次握手：SYN，SYN+ACK，然后是纯 ACK
+      a.peer.connect();
+      if ( deliver( a, b, never ) != 1 || deliver( b, a, never ) != 1 || deliver( a, b, never ) != 1 ) {
+        throw runtime_error( "handshake should take three segments" );
+      }
+      if ( deliver( b, a, never ) != 0 ) {
+        throw runtime_error( "an ACK should not be ACKed" );
+      }
+
+      // b 的回应带上了对 a 数据的 ACK，不需要单独的 ACK 段
+      a.peer.outbound_writer().push( "request" );
+      a.peer.push();
+      deliver( a, b, never );
+      b.pump();
+      b.peer.outbound_writer().push( "response" );
+      b.peer.push();
+      vector<TCPMessage> msgs;
+      b.peer.maybe_send_all( msgs );
+      if ( msgs.size() != 1 || static_cast<string>( msgs[0].sender.payload ) != "response"
+           || msgs[0].receiver.ackno != a.peer.sender().send_empty_message().seqno ) {
+        throw runtime_error( "ACK should be piggybacked on the response" );
+      }
+      if ( b.received != "request" ) {
+        throw runtime_error( "request not received" );
+      }
+    }
+
+    {
+      TCPConfig config;
+      Endpoint a { TCPPeer { config }, "hello" };
+      Endpoint b { TCPPeer { config }, "world" };
+      b.close_when_done = false;
+      auto const never = [] { return false; };
+
+      a.peer.connect();
+      for ( int i = 0; i < 10; ++i ) {
+        a.pump();
+        b.pump();
+        deliver( a, b, never );
+        deliver( b, a, never );
+      }
+      // b 先收到 FIN，之后才关闭：被动关闭的一方不需要 linger
+      b.peer.outbound_writer().close();
+      for ( int i = 0; i < 10; ++i ) {
+        a.pump();
+        b.pump();
+        deliver( a, b, never );
+        deliver( b, a, never );
+      }
+      if ( b.peer.active() ) {
+        throw runtime_error( "passive closer should be done" );
+      }
+      if ( !a.peer.active() ) {
+        throw runtime_error( "active closer should linger" );
+      }
+      a.peer.tick( 10 * config.rt_timeout - 1 );
+      if ( !a.peer.active() ) {
+        throw runtime_error( "active closer stopped lingering early" );
+      }
+      a.peer.tick( 1 );
+      if ( a.peer.active() ) {
+        throw runtime_error( "active closer should be done after lingering" );
+      }
+      if ( a.received != "world" || b.received != "hello" ) {
+        throw runtime_error( "data mismatch" );
+      }
+    }
+
+    {
+      TCPConfig config;
+      transfer( "lossless", config, 0, rd );
+      transfer( "10% loss", config, 0.1, rd );
+
+      config.fast_retransmit = true;
+      config.adaptive_rto = true;
+      config.congestion_control = TCPConfig::CongestionAlgorithm::Reno;
+      config.delayed_ack = true;
+      config.nagle = true;
+      config.window_scaling = true;
+      config.recv_capacity = 1'000'000;
+      transfer( "all options, 5% loss", config, 0.05, rd );
+    }
+
+    {
+      // 空闲 10 ms 就释放缓冲：丢包时的重传间隙里也会释放，之后要能照常重新分配
+      TCPConfig config;
+      config.release_when_idle = true;
+      config.idle_release_ms = 10;
+      transfer( "release when idle, 10% loss", config, 0.1, rd );
+    }
+
+    {
+      TCPConfig config;
+      transfer( "batched receive", config, 0, rd, true );
+      transfer( "batched receive, 10% loss", config, 0.1, rd, true );
+      config.tso_segments = 16;
+      config.delayed_ack = true;
+      transfer( "batched receive of split super-segments", config, 0.05, rd, true );
+    }
+
+    {
+      TCPConfig config;
+      Endpoint a { TCPPeer { config }, "" };
+      a.peer.connect();
+      // 对端一直不回应，重传次数用完后连接出错
+      for ( int i = 0; i < 100000 && a.peer.active(); ++i ) {
+        vector<TCPMessage> msgs;
+        a.peer.maybe_send_all( msgs );
+        a.peer.tick( 1000 );
+      }
+      if ( a.peer.active() || !a.peer.inbound_reader().has_error() ) {
+        throw runtime_error( "connection should fail after too many retransmissions" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
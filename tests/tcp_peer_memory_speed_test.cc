@@ -0,0 +1,106 @@
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+size_t heap_in_use()
+{
+  return mallinfo2().uordblks;
+}
+
+void exchange( TCPPeer& from, TCPPeer& to, vector<TCPMessage>& msgs )
+{
+  from.maybe_send_all( msgs );
+  for ( auto& msg : msgs ) {
+    to.receive( std::move( msg ) );
+  }
+  msgs.clear();
+}
+
+// `num_connections` connections (as pairs of TCPPeers talking to each other), each of which has
+// exchanged a request and a response and then gone quiet for idle_release_ms. Returns the heap
+// bytes per connection, on top of sizeof( TCPPeer ).
+double heap_per_idle_connection( const size_t num_connections, const bool release_when_idle )
+{
+  TCPConfig config;
+  config.release_when_idle = release_when_idle;
+  const string request( 100, 'q' );
+  const string response( 400, 'r' );
+
+  vector<TCPMessage> msgs;
+  vector<TCPPeer> peers;
+  peers.reserve( num_connections );
+  const auto heap_before = heap_in_use();
+
+  for ( size_t i = 0; i + 1 < num_connections; i += 2 ) {
+    auto& client = peers.emplace_back( config );
+    auto& server = peers.emplace_back( config );
+    client.connect();
+    exchange( client, server, msgs );
+    exchange( server, client, msgs );
+    client.outbound_writer().push( request );
+    client.push();
+    exchange( client, server, msgs );
+    server.inbound_reader().pop( server.inbound_reader().bytes_buffered() );
+    server.outbound_writer().push( response );
+    server.push();
+    exchange( server, client, msgs );
+    client.inbound_reader().pop( client.inbound_reader().bytes_buffered() );
+    exchange( client, server, msgs );
+    if ( client.sender().sequence_numbers_in_flight() != 0 || server.sender().sequence_numbers_in_flight() != 0 ) {
+      throw runtime_error( "exchange did not complete" );
+    }
+    client.tick( config.idle_release_ms );
+    server.tick( config.idle_release_ms );
+  }
+
+  return static_cast<double>( heap_in_use() - heap_before ) / static_cast<double>( peers.size() );
+}
+
+void memory_test( const size_t num_connections )
+{
+  const double kept = heap_per_idle_connection( num_connections, false );
+  const double released = heap_per_idle_connection( num_connections, true );
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  cout << num_connections << " idle connections: sizeof( TCPPeer ) = " << sizeof( TCPPeer )
+       << " bytes, plus heap per connection of " << fixed << setprecision( 1 ) << kept << " bytes ("
+       << released << " bytes with release_when_idle).\n";
+
+  debug_output << "   idle TCPPeer (" << num_connections << "): " << sizeof( TCPPeer ) << " + " << fixed
+               << setprecision( 1 ) << kept << " bytes, " << released << " bytes with release_when_idle\n";
+
+  if ( released > kept ) {
+    throw runtime_error( "release_when_idle did not reduce the memory of idle connections." );
+  }
+}
+} // namespace
+
+void program_body()
+{
+  memory_test( 1'000'000 );
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,157 @@
+#include "checksum.hh"
+#include "common.hh"
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "tcp_segment.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+string flatten( const vector<Buffer>& buffers )
+{
+  string ret;
+  for ( const auto& b : buffers ) {
+    ret += string_view { b };
+  }
+  return ret;
+}
+
+IPv4Header header_for( const TCPSegment& seg )
+{
+  IPv4Header header;
+  header.src = 0x0a000001;
+  header.dst = 0x0a000002;
+  header.len = IPv4Header::LENGTH + seg.header_length() + seg.message.sender.payload.size();
+  return header;
+}
+} // namespace
+
+int main()
+{
+  try {
+    {
+      // 手工编码的段：逐字节比较
+      TCPSegment seg;
+      seg.src_port = 0x1234;
+      seg.dst_port = 80;
+      seg.message.sender.seqno = Wrap32 { 0x01020304 };
+      seg.message.sender.SYN = true;
+      seg.message.sender.window_scale = 7;
+      seg.message.receiver.ackno = Wrap32 { 0xa0b0c0d0 };
+      seg.message.receiver.window_size = 0xfff0;
+      check( seg.header_length() == 24, "header length with window scale" );
+
+      const string expected { "\x12\x34\x00\x50"
+                              "\x01\x02\x03\x04"
+                              "\xa0\xb0\xc0\xd0"
+                              "\x60\x12\xff\xf0"
+                              "\x00\x00\x00\x00"
+                              "\x01\x03\x03\x07",
+                              24 };
+      check( flatten( serialize( seg ) ) == expected, "wire format" );
+    }
+
+    {
+      TCPSegment seg;
+      seg.src_port = 5000;
+      seg.dst_port = 6000;
+      seg.message.sender.seqno = Wrap32 { 0xfffffff0 };
+      seg.message.sender.payload = string( "hello, world" );
+      seg.message.sender.FIN = true;
+      seg.message.receiver.ackno = Wrap32 { 17 };
+      seg.message.receiver.window_size = 1000;
+      seg.message.receiver.sack = { { Wrap32 { 100 }, Wrap32 { 200 } }, { Wrap32 { 300 }, Wrap32 { 400 } } };
+
+      auto ip = header_for( seg );
+      seg.compute_checksum( ip.pseudo_checksum() );
+
+      // 整个段（含校验和）加上伪首部求和应为 0
+      InternetChecksum sum { ip.pseudo_checksum() };
+      sum.add( serialize( seg ) );
+      check( sum.value() == 0, "checksum" );
+
+      // payload 没有被拷贝进序列化结果
+      const auto out = serialize( seg );
+      check( any_of( out.begin(),
+                     out.end(),
+                     [&]( const Buffer& b ) {
+                       return string_view { b }.data() == string_view { seg.message.sender.payload }.data();
+                     } ),
+             "payload shared, not copied" );
+
+      // 放进 IPv4 数据报再解析回来；payload 分成几块也一样
+      IPv4Datagram dgram;
+      dgram.header = ip;
+      dgram.header.compute_checksum();
+      dgram.payload = serialize( seg );
+      const string wire = flatten( serialize( dgram ) );
+      vector<Buffer> pieces { wire.substr( 0, 7 ), wire.substr( 7, 30 ), wire.substr( 37 ) };
+
+      IPv4Datagram parsed_dgram;
+      check( parse( parsed_dgram, pieces ), "IPv4 parse" );
+      TCPSegment parsed;
+      Parser p { parsed_dgram.payload };
+      parsed.parse( p, parsed_dgram.header.pseudo_checksum() );
+      check( !p.has_error(), "TCP parse" );
+      check( parsed.src_port == 5000 && parsed.dst_port == 6000, "ports" );
+      check( parsed.message.sender.seqno == Wrap32 { 0xfffffff0 }, "seqno" );
+      check( !parsed.message.sender.SYN && parsed.message.sender.FIN && !parsed.RST, "flags" );
+      check( string_view { parsed.message.sender.payload } == "hello, world", "payload" );
+      check( parsed.message.receiver.ackno == Wrap32 { 17 }, "ackno" );
+      check( parsed.message.receiver.window_size == 1000, "window" );
+      check( parsed.message.receiver.sack == seg.message.receiver.sack, "SACK blocks" );
+      check( !parsed.message.sender.window_scale.has_value(), "no window scale" );
+
+      // 改一个字节，校验和就对不上
+      string corrupt = flatten( dgram.payload );
+      corrupt.back() ^= 1;
+      TCPSegment bad;
+      Parser bad_parser { vector<Buffer> { corrupt } };
+      bad.parse( bad_parser, ip.pseudo_checksum() );
+      check( bad_parser.has_error(), "corrupt segment should fail to parse" );
+    }
+
+    {
+      // 没有 ACK 标志时 ackno 为空；不认识的选项被跳过
+      string wire { "\x00\x01\x00\x02"
+                    "\x00\x00\x00\x09"
+                    "\x77\x77\x77\x77"
+                    "\x80\x02\x10\x00"
+                    "\x00\x00\x00\x00"
+                    "\x02\x04\x05\xb4"
+                    "\x04\x02\x03\x03"
+                    "\x02\x00\x00\x00",
+                    32 };
+      InternetChecksum sum;
+      sum.add( wire );
+      const uint16_t cksum = sum.value();
+      wire[16] = static_cast<char>( cksum >> 8 );
+      wire[17] = static_cast<char>( cksum & 0xff );
+
+      TCPSegment seg;
+      Parser p { vector<Buffer> { wire } };
+      seg.parse( p, 0 );
+      check( !p.has_error(), "parse with MSS and SACK-permitted options" );
+      check( seg.message.sender.SYN && !seg.message.receiver.ackno.has_value(), "SYN without ACK" );
+      check( seg.message.sender.window_scale == 2, "window scale after unknown options" );
+      check( seg.message.sender.payload.empty(), "empty payload" );
+
+      wire[12] = 0x40;
+      Parser short_parser { vector<Buffer> { wire } };
+      seg.parse( short_parser, 0 );
+      check( short_parser.has_error(), "data offset below 5 should fail" );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
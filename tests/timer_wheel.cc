@@ -0,0 +1,135 @@
+#include "random.hh"
+#include "tcp_config.hh"
+#include "tcp_sender.hh"
+#include "timer_wheel.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static void expect_fired( TimerWheel& wheel, uint64_t ms, vector<TimerWheel::Token> expected, const string& what )
+{
+  vector<TimerWheel::Token> fired;
+  wheel.advance( ms, fired );
+  sort( fired.begin(), fired.end() );
+  sort( expected.begin(), expected.end() );
+  if ( fired != expected ) {
+    throw runtime_error( what + ": expected " + to_string( expected.size() ) + " timers to fire at "
+                         + to_string( wheel.now() ) + " ms, but " + to_string( fired.size() ) + " did" );
+  }
+}
+
+int main()
+{
+  try {
+    {
+      TimerWheel wheel;
+      wheel.schedule( 5, 1 );
+      wheel.schedule( 300, 2 );
+      wheel.schedule( 70000, 3 );
+      auto handle = wheel.schedule( 6, 4 );
+      wheel.schedule( 0, 5 );
+
+      expect_fired( wheel, 1, { 5 }, "past deadline" );
+      expect_fired( wheel, 3, {}, "before deadline" );
+      wheel.cancel( handle );
+      wheel.cancel( handle );
+      expect_fired( wheel, 1, { 1 }, "level 0" );
+      expect_fired( wheel, 294, {}, "before cascade" );
+      expect_fired( wheel, 1, { 2 }, "level 1" );
+      expect_fired( wheel, 69699, {}, "before second cascade" );
+      expect_fired( wheel, 1, { 3 }, "level 2" );
+      if ( wheel.size() != 0 ) {
+        throw runtime_error( "timers left after all fired" );
+      }
+      expect_fired( wheel, 1'000'000, {}, "empty wheel" );
+      if ( wheel.now() != 1'070'000 ) {
+        throw runtime_error( "empty wheel did not keep time" );
+      }
+    }
+
+    {
+      TimerWheel wheel;
+      wheel.schedule( ( uint64_t { 1 } << 33 ) + 5, 1 );
+      expect_fired( wheel, 100'000, {}, "beyond the top level" );
+    }
+
+    // 与逐个比较到期时间的做法对照
+    auto rd = get_random_engine();
+    for ( unsigned rep = 0; rep < 8; ++rep ) {
+      TimerWheel wheel;
+      map<TimerWheel::Token, pair<uint64_t, TimerWheel::Handle>> live;
+      TimerWheel::Token next_token = 0;
+      for ( unsigned step = 0; step < 2000; ++step ) {
+        for ( unsigned n = rd() % 8; n > 0; --n ) {
+          const uint64_t delay = rd() % 4 ? rd() % 1000 : rd() % 200'000;
+          const auto handle = wheel.schedule( wheel.now() + delay, next_token );
+          live[next_token++] = { max( wheel.now() + delay, wheel.now() + 1 ), handle };
+        }
+        if ( not live.empty() and rd() % 4 == 0 ) {
+          auto it = live.begin();
+          advance( it, rd() % live.size() );
+          wheel.cancel( it->second.second );
+          live.erase( it );
+        }
+
+        const uint64_t ms = rd() % 300;
+        vector<TimerWheel::Token> expected;
+        for ( auto it = live.begin(); it != live.end(); ) {
+          if ( it->second.first <= wheel.now() + ms ) {
+            expected.push_back( it->first );
+            it = live.erase( it );
+          } else {
+            ++it;
+          }
+        }
+        expect_fired( wheel, ms, expected, "random rep " + to_string( rep ) );
+        if ( wheel.size() != live.size() ) {
+          throw runtime_error( "wheel size does not match scheduled timers" );
+        }
+      }
+    }
+
+    // TCPSender: 超时由 wheel 触发，收到 token 后调用 tick( 0 )
+    {
+      TimerWheel wheel;
+      TCPConfig cfg;
+      ByteStream stream { cfg.send_capacity };
+      TCPSender sender { cfg.rt_timeout, Wrap32 { 0 } };
+      sender.attach_timer_wheel( wheel, 7 );
+
+      sender.push( stream.reader() );
+      if ( not sender.maybe_send().has_value() ) {
+        throw runtime_error( "sender did not send SYN" );
+      }
+      expect_fired( wheel, cfg.rt_timeout - 1, {}, "sender before RTO" );
+      sender.tick( 1000 );
+      if ( sender.maybe_send().has_value() ) {
+        throw runtime_error( "tick() should not advance a sender that is attached to a wheel" );
+      }
+      expect_fired( wheel, 1, { 7 }, "sender at RTO" );
+      sender.tick( 0 );
+      if ( not sender.maybe_send().has_value() or sender.consecutive_retransmissions() != 1 ) {
+        throw runtime_error( "sender did not retransmit when its wheel timer fired" );
+      }
+      expect_fired( wheel, 2 * cfg.rt_timeout - 1, {}, "sender before doubled RTO" );
+      sender.receive( { Wrap32 { 1 }, 1000 } );
+      expect_fired( wheel, 10 * cfg.rt_timeout, {}, "sender after ack" );
+      if ( wheel.size() != 0 ) {
+        throw runtime_error( "acked sender left its timer on the wheel" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
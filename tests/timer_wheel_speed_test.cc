@@ -0,0 +1,91 @@
+#include "tcp_config.hh"
+#include "tcp_sender.hh"
+#include "timer_wheel.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// `num_senders` connections with a SYN in flight and nothing else going on. Every millisecond
+// either each sender is tick()ed, or one shared TimerWheel is advanced; the time per millisecond
+// should grow with the number of senders only in the first case.
+double idle_tick_ns( const size_t num_senders, const size_t ms, const bool use_wheel )
+{
+  ByteStream stream { 0 };
+  TimerWheel wheel;
+  vector<TCPSender> senders;
+  senders.reserve( num_senders );
+  for ( size_t i = 0; i < num_senders; ++i ) {
+    senders.emplace_back( TCPConfig::TIMEOUT_DFLT * 100, Wrap32 { 0 } );
+    if ( use_wheel ) {
+      senders.back().attach_timer_wheel( wheel, i );
+    }
+    senders.back().push( stream.reader() );
+    if ( not senders.back().maybe_send().has_value() ) {
+      throw runtime_error( "TCPSender did not send SYN" );
+    }
+  }
+
+  vector<TimerWheel::Token> fired;
+  const auto start_time = steady_clock::now();
+  for ( size_t t = 0; t < ms; ++t ) {
+    if ( use_wheel ) {
+      wheel.advance( 1, fired );
+      for ( auto token : fired ) {
+        senders[token].tick( 0 );
+      }
+      fired.clear();
+    } else {
+      for ( auto& sender : senders ) {
+        sender.tick( 1 );
+      }
+    }
+  }
+  const auto stop_time = steady_clock::now();
+
+  for ( auto& sender : senders ) {
+    if ( sender.maybe_send().has_value() ) {
+      throw runtime_error( "idle TCPSender retransmitted" );
+    }
+  }
+
+  return duration_cast<duration<double, nano>>( stop_time - start_time ).count() / static_cast<double>( ms );
+}
+
+void program_body()
+{
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+
+  for ( size_t n : { 1000, 10000, 100000 } ) {
+    const auto per_sender = idle_tick_ns( n, 200, false );
+    const auto wheel = idle_tick_ns( n, 200, true );
+
+    cout << n << " idle senders: tick() each " << fixed << setprecision( 0 ) << per_sender
+         << " ns/ms, shared TimerWheel " << wheel << " ns/ms.\n";
+    debug_output << "   " << n << " idle senders: tick() each " << fixed << setprecision( 0 ) << per_sender
+                 << " ns/ms, TimerWheel " << wheel << " ns/ms\n";
+
+    if ( n >= 10000 and wheel > per_sender ) {
+      throw runtime_error( "TimerWheel was slower than ticking every TCPSender." );
+    }
+  }
+}
+
+int main()
+{
+  try {
+    program_body();
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+#include "address.hh"
+#include "buffer.hh"
+#include "common.hh"
+#include "socket.hh"
+
+#include <exception>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+UDPSocket bound_socket()
+{
+  UDPSocket socket;
+  socket.bind( Address { "127.0.0.1" } );
+  return socket;
+}
+
+// Receive until `count` datagrams have arrived
+vector<DatagramSocket::Received> receive( UDPSocket& socket, size_t count )
+{
+  vector<DatagramSocket::Received> all;
+  vector<DatagramSocket::Received> batch;
+  while ( all.size() < count ) {
+    socket.recv_many( batch );
+    check( not batch.empty(), "datagrams went missing" );
+    all.insert( all.end(), batch.begin(), batch.end() );
+  }
+  return all;
+}
+} // namespace
+
+int main()
+{
+  try {
+    // 一次 sendmmsg 发出去，一次（或几次）recvmmsg 收回来
+    {
+      UDPSocket sender = bound_socket();
+      UDPSocket receiver = bound_socket();
+      vector<Buffer> payloads;
+      for ( size_t i = 0; i < 10; ++i ) {
+        payloads.emplace_back( "datagram " + to_string( i ) );
+      }
+      check( sender.send_many( receiver.local_address(), payloads ) == 10, "all sent" );
+      const auto got = receive( receiver, 10 );
+      for ( size_t i = 0; i < 10; ++i ) {
+        check( string_view { got[i].payload } == "datagram " + to_string( i ), "payload in order" );
+        check( got[i].source == sender.local_address(), "source address" );
+      }
+
+      receiver.set_blocking( false );
+      vector<DatagramSocket::Received> none;
+      receiver.recv_many( none );
+      check( none.empty(), "nothing waiting" );
+    }
+
+    // GSO：一样大的一串 payload 交给内核一次，收的这边照样是一个个的数据报
+    {
+      UDPSocket sender = bound_socket();
+      UDPSocket receiver = bound_socket();
+      sender.set_gso_segment_size( 1000 );
+      vector<Buffer> payloads;
+      for ( size_t i = 0; i < 10; ++i ) {
+        payloads.emplace_back( string( 1000, static_cast<char>( 'a' + i ) ) );
+      }
+      payloads.emplace_back( string( 500, 'z' ) );
+      payloads.emplace_back( string( 1200, 'y' ) ); // 比段大：自己一条消息
+      check( sender.send_many( receiver.local_address(), payloads ) == payloads.size(), "all sent" );
+      const auto got = receive( receiver, payloads.size() );
+      check( got.size() == payloads.size(), "one datagram per payload" );
+      for ( size_t i = 0; i < payloads.size(); ++i ) {
+        check( string_view { got[i].payload } == string_view { payloads[i] }, "segmented in order" );
+      }
+
+      // GRO：内核把它们合并着交上来，recv_many() 再切开
+      receiver.set_gro();
+      check( sender.send_many( receiver.local_address(), payloads ) == payloads.size(), "all sent again" );
+      const auto coalesced = receive( receiver, payloads.size() );
+      check( coalesced.size() == payloads.size(), "split back into datagrams" );
+      for ( size_t i = 0; i < payloads.size(); ++i ) {
+        check( string_view { coalesced[i].payload } == string_view { payloads[i] }, "GRO payload in order" );
+        check( coalesced[i].source == sender.local_address(), "GRO source address" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,81 @@
+#include "wrapping_integers.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Unwrap `count` seqnos the way TCPSender::receive does for its outstanding segments: each one a
+// little ahead of a checkpoint that advances as the connection does.
+void unwrap_speed_test( const size_t count, const size_t repetitions )
+{
+  default_random_engine rd { 1234 };
+  const Wrap32 isn { uniform_int_distribution<uint32_t> {}( rd ) };
+  uniform_int_distribution<uint64_t> step { 0, 1500 };
+
+  vector<Wrap32> seqnos;
+  vector<uint64_t> expected;
+  seqnos.reserve( count );
+  expected.reserve( count );
+  uint64_t absolute = uint64_t { 3 } << 32; // well past the first wrap
+  for ( size_t i = 0; i < count; ++i ) {
+    absolute += step( rd );
+    seqnos.push_back( Wrap32::wrap( absolute, isn ) );
+    expected.push_back( absolute );
+  }
+
+  uint64_t checksum = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t r = 0; r < repetitions; ++r ) {
+    uint64_t checkpoint = expected.front();
+    for ( const auto seqno : seqnos ) {
+      checkpoint = seqno.unwrap( isn, checkpoint );
+      checksum += checkpoint;
+    }
+  }
+  const auto stop_time = steady_clock::now();
+
+  uint64_t reference = 0;
+  for ( const auto value : expected ) {
+    reference += value;
+  }
+  if ( checksum != reference * repetitions ) {
+    throw runtime_error( "unwrap() returned the wrong absolute seqno" );
+  }
+
+  const auto total = static_cast<double>( count * repetitions );
+  const auto seconds = duration_cast<duration<double>>( stop_time - start_time ).count();
+  const auto ns_per_unwrap = seconds * 1e9 / total;
+  const auto millions_per_second = total / seconds / 1e6;
+
+  cout << fixed << setprecision( 2 ) << "Wrap32::unwrap: " << ns_per_unwrap << " ns each, " << millions_per_second
+       << " million/s.\n";
+
+  fstream debug_output;
+  debug_output.open( "/dev/tty" );
+  if ( not debug_output.good() ) {
+    return;
+  }
+  debug_output << fixed << setprecision( 2 ) << "   Wrap32::unwrap: " << ns_per_unwrap << " ns each, "
+               << millions_per_second << " million/s\n";
+}
+
+int main()
+{
+  try {
+    unwrap_speed_test( 1 << 16, 1000 );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+#include "async_socket.hh"
+
+#include "task.hh"
+
+#include <utility>
+
+using namespace std;
+
+AsyncSocket::AsyncSocket( EventLoop& loop, FileDescriptor&& fd ) : loop_( loop ), fd_( std::move( fd ) )
+{
+  fd_.set_blocking( false );
+  // 边沿触发：没有协程在等的时候来的事件直接忽略，反正 co_await 总是先试一次
+  id_ = loop_.add(
+    fd_,
+    [this] {
+      if ( reading_ and reading_->attempt() ) {
+        Task::wake( exchange( reading_, nullptr )->waiting_ );
+      }
+    },
+    [this] {
+      if ( writing_ and writing_->attempt() ) {
+        Task::wake( exchange( writing_, nullptr )->waiting_ );
+      }
+    } );
+}
+
+AsyncSocket::~AsyncSocket()
+{
+  loop_.remove( id_ );
+}
+
+bool AsyncSocket::Read::attempt()
+{
+  try {
+    socket_.fd_.read( buffer_ );
+  } catch ( ... ) {
+    error_ = current_exception();
+    return true;
+  }
+  return not buffer_.empty() or socket_.fd_.eof();
+}
+
+bool AsyncSocket::Read::await_ready()
+{
+  return attempt();
+}
+
+void AsyncSocket::Read::await_suspend( coroutine_handle<> coroutine ) noexcept
+{
+  waiting_ = coroutine;
+  socket_.reading_ = this;
+}
+
+void AsyncSocket::Read::await_resume() const
+{
+  if ( error_ ) {
+    rethrow_exception( error_ );
+  }
+}
+
+// 协程在等待中被销毁：回调不能再碰这个对象
+AsyncSocket::Read::~Read()
+{
+  if ( socket_.reading_ == this ) {
+    socket_.reading_ = nullptr;
+  }
+}
+
+bool AsyncSocket::Write::attempt()
+{
+  try {
+    while ( written_ < data_.size() ) {
+      auto const n = socket_.fd_.write( data_.substr( written_ ) );
+      if ( n == 0 ) {
+        return false;
+      }
+      written_ += n;
+    }
+  } catch ( ... ) {
+    error_ = current_exception();
+  }
+  return true;
+}
+
+bool AsyncSocket::Write::await_ready()
+{
+  return attempt();
+}
+
+void AsyncSocket::Write::await_suspend( coroutine_handle<> coroutine ) noexcept
+{
+  waiting_ = coroutine;
+  socket_.writing_ = this;
+}
+
+size_t AsyncSocket::Write::await_resume() const
+{
+  if ( error_ ) {
+    rethrow_exception( error_ );
+  }
+  return written_;
+}
+
+AsyncSocket::Write::~Write()
+{
+  if ( socket_.writing_ == this ) {
+    socket_.writing_ = nullptr;
+  }
+}
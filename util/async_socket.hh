@@ -0,0 +1,88 @@
+#pragma once
+
+#include "event_loop.hh"
+#include "file_descriptor.hh"
+
+#include <coroutine>
+#include <exception>
+#include <string>
+#include <string_view>
+
+//! \brief A non-blocking FileDescriptor (usually a socket) read and written by coroutines
+//! \details `co_await socket.read( buffer )` in a Task reads what there is, or waits (without
+//! blocking the thread) until there is something; `co_await socket.write( data )` writes all of
+//! `data`, waiting whenever the descriptor is full. The descriptor is registered with the
+//! EventLoop once, edge-triggered; its callbacks retry the read or write a coroutine is waiting
+//! on and wake it (Task::wake()) when that is done, so waiting costs no system call of its own.
+//!
+//! One coroutine at a time may read, and one may write. An error from the system call is thrown
+//! by the co_await.
+class AsyncSocket
+{
+public:
+  AsyncSocket( EventLoop& loop, FileDescriptor&& fd );
+  ~AsyncSocket();
+
+  AsyncSocket( const AsyncSocket& other ) = delete;
+  AsyncSocket& operator=( const AsyncSocket& other ) = delete;
+  AsyncSocket( AsyncSocket&& other ) = delete;
+  AsyncSocket& operator=( AsyncSocket&& other ) = delete;
+
+  //! What read() returns: co_await it for the next bytes in `buffer` (empty at EOF)
+  class Read
+  {
+  public:
+    Read( AsyncSocket& socket, std::string& buffer ) : socket_( socket ), buffer_( buffer ) {}
+    ~Read();
+    Read( const Read& other ) = delete;
+    Read& operator=( const Read& other ) = delete;
+
+    bool await_ready();
+    void await_suspend( std::coroutine_handle<> coroutine ) noexcept;
+    void await_resume() const;
+
+  private:
+    friend class AsyncSocket;
+    bool attempt(); // 读一次；读到了（或者 EOF、出错）就是 true
+    AsyncSocket& socket_;
+    std::string& buffer_;
+    std::coroutine_handle<> waiting_ {};
+    std::exception_ptr error_ {};
+  };
+
+  //! What write() returns: co_await it to write all of `data`; the result is its size
+  class Write
+  {
+  public:
+    Write( AsyncSocket& socket, std::string_view data ) : socket_( socket ), data_( data ) {}
+    ~Write();
+    Write( const Write& other ) = delete;
+    Write& operator=( const Write& other ) = delete;
+
+    bool await_ready();
+    void await_suspend( std::coroutine_handle<> coroutine ) noexcept;
+    size_t await_resume() const;
+
+  private:
+    friend class AsyncSocket;
+    bool attempt(); // 能写多少写多少；写完（或者出错）就是 true
+    AsyncSocket& socket_;
+    std::string_view data_;
+    size_t written_ {};
+    std::coroutine_handle<> waiting_ {};
+    std::exception_ptr error_ {};
+  };
+
+  Read read( std::string& buffer ) { return { *this, buffer }; }
+  Write write( std::string_view data ) { return { *this, data }; }
+
+  FileDescriptor& fd() { return fd_; }
+  const FileDescriptor& fd() const { return fd_; }
+
+private:
+  EventLoop& loop_;
+  FileDescriptor fd_;
+  EventLoop::Id id_ {};
+  Read* reading_ {}; // 正在等的读和写，由可读/可写的回调接着做
+  Write* writing_ {};
+};
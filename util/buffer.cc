@@ -0,0 +1,140 @@
+#include "buffer.hh"
+#include "packet_arena.hh"
+
+#include <array>
+#include <vector>
+
+using namespace std;
+
+// 每个线程自己的空闲列表，取和还都不加锁。别的线程释放的 Buffer 进的是释放它的那个线程的列表。
+class Buffer::Pool
+{
+public:
+  static constexpr size_t SLAB_COUNT = 3;
+  static constexpr array<size_t, SLAB_COUNT> SLAB_SIZE { SMALL_SLAB, FRAME_SLAB, JUMBO_SLAB };
+  static constexpr array<size_t, SLAB_COUNT> MAX_FREE { 4096, 1024, 256 }; // 每个线程每一档最多留这么多
+  static constexpr size_t MAX_FREE_STORAGE = 4096;
+
+  // 线程退出、thread_local 的池析构以后还可能有 Buffer 被释放，那时直接交还给堆
+  static thread_local bool alive;
+
+  static Pool& instance()
+  {
+    thread_local Pool pool;
+    return pool;
+  }
+
+  Pool() = default;
+  Pool( const Pool& ) = delete;
+  Pool& operator=( const Pool& ) = delete;
+
+  ~Pool()
+  {
+    alive = false;
+    for ( auto* storage : storage_ ) {
+      delete storage; // NOLINT(*-owning-memory)
+    }
+  }
+
+  Storage* take_storage()
+  {
+    if ( storage_.empty() ) {
+      return new Storage; // NOLINT(*-owning-memory)
+    }
+    auto* out = storage_.back();
+    storage_.pop_back();
+    return out;
+  }
+
+  void give_storage( Storage* storage )
+  {
+    storage->owner.reset();
+    storage->external = {};
+    give_string( std::move( storage->str ) );
+    if ( storage_.size() >= MAX_FREE_STORAGE ) {
+      delete storage; // NOLINT(*-owning-memory)
+      return;
+    }
+    storage->str = string {};
+    storage_.push_back( storage );
+  }
+
+  string take_string( size_t capacity )
+  {
+    for ( size_t i = 0; i < SLAB_COUNT; ++i ) {
+      if ( capacity <= SLAB_SIZE.at( i ) ) {
+        auto& free = strings_.at( i );
+        if ( free.empty() ) {
+          return reserved( SLAB_SIZE.at( i ) );
+        }
+        auto out = std::move( free.back() );
+        free.pop_back();
+        return out;
+      }
+    }
+    return reserved( capacity );
+  }
+
+  // 按容量归到能装下的最大那一档；太小或大得多的不留
+  void give_string( string&& str )
+  {
+    for ( size_t i = SLAB_COUNT; i-- > 0; ) {
+      if ( str.capacity() >= SLAB_SIZE.at( i ) ) {
+        if ( str.capacity() <= 2 * SLAB_SIZE.at( i ) and strings_.at( i ).size() < MAX_FREE.at( i ) ) {
+          str.clear();
+          strings_.at( i ).push_back( std::move( str ) );
+        }
+        return;
+      }
+    }
+  }
+
+  static string reserved( size_t capacity )
+  {
+    string out;
+    out.reserve( capacity );
+    return out;
+  }
+
+private:
+  vector<Storage*> storage_ {};
+  array<vector<string>, SLAB_COUNT> strings_ {};
+};
+
+thread_local bool Buffer::Pool::alive = true;
+
+string Buffer::pooled_string( size_t capacity )
+{
+  return Pool::alive ? Pool::instance().take_string( capacity ) : Pool::reserved( capacity );
+}
+
+Buffer::Storage* Buffer::acquire( string&& str )
+{
+  Storage* storage = Pool::alive ? Pool::instance().take_storage() : new Storage; // NOLINT(*-owning-memory)
+  storage->refs.store( 1, memory_order_relaxed );
+  storage->str = std::move( str );
+  return storage;
+}
+
+Buffer Buffer::external( string_view bytes, shared_ptr<const void> owner )
+{
+  Buffer out;
+  out.storage_ = acquire( {} );
+  out.storage_->external = bytes;
+  out.storage_->owner = std::move( owner );
+  return out;
+}
+
+void Buffer::release_storage( Storage* storage )
+{
+  if ( storage->arena ) {
+    storage->arena->give( const_cast<char*>( storage->external.data() ) ); // NOLINT(*-const-cast)
+    storage->arena = nullptr;
+    storage->external = {};
+  }
+  if ( Pool::alive ) {
+    Pool::instance().give_storage( storage );
+  } else {
+    delete storage; // NOLINT(*-owning-memory)
+  }
+}
@@ -1,23 +1,172 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
+
+// Reference-counted, immutable-by-convention bytes. Copies share the same string.
+//
+// The strings and their reference counts come from a per-thread pool: when the last Buffer
+// holding a string goes away, the string (with its capacity) is kept for reuse, sorted by
+// size into small (header-sized), frame-sized and jumbo-frame-sized slabs. Code that builds
+// a Buffer from Buffer::pooled_string() therefore does no heap allocation once the pool is warm.
+//
+// A Buffer can also share bytes it does not own, such as a file mapped into memory (external()),
+// or a slab from a PacketArena, which goes back to its arena with the last Buffer.
+class PacketArena;
 
 class Buffer
 {
-  std::shared_ptr<std::string> buffer_;
+public:
+  static constexpr size_t SMALL_SLAB = 64;   // room for any protocol header
+  static constexpr size_t FRAME_SLAB = 2048; // room for a 1500-byte frame
+  static constexpr size_t JUMBO_SLAB = 9216; // room for a jumbo frame
+
+  // An empty string with room for at least `capacity` bytes, from the pool if one that size is
+  // free. Give it back to a Buffer (or let it go) when it's filled; its storage returns to the pool.
+  static std::string pooled_string( size_t capacity );
+
+  // A Buffer over `bytes`, which `owner` keeps alive (e.g. a file mapping) for as long as any Buffer
+  // shares them. Nothing is copied; asking for the string (to modify it) copies.
+  static Buffer external( std::string_view bytes, std::shared_ptr<const void> owner );
+
+private:
+  // The shared string and its count of Buffers, in a single (pooled) allocation
+  struct Storage
+  {
+    std::atomic<size_t> refs { 1 };
+    std::string str {};
+    std::string_view external {};        // if set: the bytes, in place of `str`
+    std::shared_ptr<const void> owner {}; // keeps `external` alive...
+    PacketArena* arena {};                // ...or takes it back once released
+
+    std::string_view bytes() const { return external.data() ? external : std::string_view { str }; }
+  };
+
+  class Pool; // the per-thread free lists (buffer.cc)
+  friend class PacketArena;
+
+  static Storage* acquire( std::string&& str );
+  static void release_storage( Storage* storage );
+
+  Storage* storage_ {};                  // nullptr: an empty Buffer that never had a string
+  size_t offset_ {};                     // a Buffer may be a slice of the shared string...
+  size_t length_ { std::string::npos };  // ...of this many bytes (npos: to the end of the string)
+
+  void reset()
+  {
+    if ( storage_ and storage_->refs.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ) {
+      release_storage( storage_ );
+    }
+    storage_ = nullptr;
+  }
+
+  // Give a slice (or an empty Buffer) its own string, so it can be modified or released without
+  // touching the other holders
+  void materialize()
+  {
+    if ( not storage_ ) {
+      storage_ = acquire( {} );
+    } else if ( offset_ != 0 || length_ != std::string::npos || storage_->external.data() ) {
+      const std::string_view view { *this };
+      Storage* own = acquire( pooled_string( view.size() ) );
+      own->str.assign( view );
+      reset();
+      storage_ = own;
+    }
+    offset_ = 0;
+    length_ = std::string::npos;
+  }
 
 public:
   // NOLINTBEGIN(*-explicit-*)
 
-  Buffer( std::string str = {} ) : buffer_( make_shared<std::string>( std::move( str ) ) ) {}
-  operator std::string_view() const { return *buffer_; }
-  operator std::string&() { return *buffer_; }
+  Buffer() = default;
+  Buffer( std::string str ) : storage_( acquire( std::move( str ) ) ) {}
+  operator std::string_view() const
+  {
+    return storage_ ? storage_->bytes().substr( offset_, length_ ) : std::string_view {};
+  }
+  operator std::string&()
+  {
+    materialize();
+    return storage_->str;
+  }
 
   // NOLINTEND(*-explicit-*)
 
-  std::string&& release() { return std::move( *buffer_ ); }
-  size_t size() const { return buffer_->size(); }
-  size_t length() const { return buffer_->length(); }
-  bool empty() const { return buffer_->empty(); }
+  Buffer( const Buffer& other ) : storage_( other.storage_ ), offset_( other.offset_ ), length_( other.length_ )
+  {
+    if ( storage_ ) {
+      storage_->refs.fetch_add( 1, std::memory_order_relaxed );
+    }
+  }
+
+  Buffer( Buffer&& other ) noexcept
+    : storage_( std::exchange( other.storage_, nullptr ) ), offset_( other.offset_ ), length_( other.length_ )
+  {}
+
+  Buffer& operator=( const Buffer& other )
+  {
+    if ( this != &other ) {
+      Buffer copy { other };
+      swap( copy );
+    }
+    return *this;
+  }
+
+  Buffer& operator=( Buffer&& other ) noexcept
+  {
+    if ( this != &other ) {
+      reset();
+      storage_ = std::exchange( other.storage_, nullptr );
+      offset_ = other.offset_;
+      length_ = other.length_;
+    }
+    return *this;
+  }
+
+  ~Buffer() { reset(); }
+
+  void swap( Buffer& other ) noexcept
+  {
+    std::swap( storage_, other.storage_ );
+    std::swap( offset_, other.offset_ );
+    std::swap( length_, other.length_ );
+  }
+
+  // A Buffer holding bytes [pos, pos + len) of this one. Shares storage; nothing is copied.
+  Buffer substr( size_t pos, size_t len = std::string::npos ) const
+  {
+    const auto view = std::string_view { *this };
+    pos = std::min( pos, view.size() );
+    Buffer ret { *this };
+    ret.offset_ += pos;
+    ret.length_ = std::min( len, view.size() - pos );
+    return ret;
+  }
+
+  // If `next` is the slice that directly follows this one in the same shared string (e.g. two
+  // pieces of one split segment), grow this slice to cover it too and return true. Nothing is copied.
+  bool extend( const Buffer& next )
+  {
+    if ( not storage_ or storage_ != next.storage_ or offset_ + size() != next.offset_ ) {
+      return false;
+    }
+    length_ = size() + next.size();
+    return true;
+  }
+
+  std::string&& release()
+  {
+    materialize();
+    return std::move( storage_->str );
+  }
+  size_t size() const { return std::string_view { *this }.size(); }
+  size_t length() const { return size(); }
+  bool empty() const { return size() == 0; }
 };
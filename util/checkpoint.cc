@@ -0,0 +1,130 @@
+#include "checkpoint.hh"
+
+#include "exception.hh"
+#include "file_descriptor.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string_view>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+constexpr uint32_t CHECKPOINT_MAGIC = 0x4d4e434b; // "MNCK"
+constexpr uint16_t CHECKPOINT_VERSION = 1;
+constexpr size_t CHECKPOINT_HEADER = 16; // magic、版本、保留的两字节、记录数
+constexpr size_t RECORD_HEADER = 8;      // 记录长度
+
+// 写完（或者中途出错）时解除映射
+struct WritableMapping
+{
+  char* base;
+  size_t length;
+
+  WritableMapping( const FileDescriptor& fd, size_t l ) : base( nullptr ), length( l )
+  {
+    void* const p = ::mmap( nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd.fd_num(), 0 );
+    if ( p == MAP_FAILED ) {
+      throw unix_error( "mmap" );
+    }
+    base = static_cast<char*>( p );
+  }
+  WritableMapping( const WritableMapping& ) = delete;
+  WritableMapping& operator=( const WritableMapping& ) = delete;
+  ~WritableMapping() { ::munmap( base, length ); }
+};
+} // namespace
+
+void CheckpointWriter::add( Serializer& record )
+{
+  uint64_t length = 0;
+  for ( auto& buffer : record.output() ) {
+    length += buffer.size();
+    if ( not buffer.empty() ) {
+      buffers_.push_back( std::move( buffer ) );
+    }
+  }
+  lengths_.push_back( length );
+}
+
+// 先写到旁边的临时文件，写完再 rename 过去：读的一方要么看到旧的快照，要么看到完整的新快照。
+// 进程重启不需要 fsync（数据在页缓存里），机器重启之后连接本来也都不在了
+size_t CheckpointWriter::commit()
+{
+  size_t size = CHECKPOINT_HEADER + RECORD_HEADER * lengths_.size();
+  for ( auto const length : lengths_ ) {
+    size += length;
+  }
+
+  const string temporary = path_ + ".tmp";
+  const FileDescriptor fd {
+    CheckSystemCall( "open", ::open( temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 ) ) }; // NOLINT
+  CheckSystemCall( "ftruncate", ::ftruncate( fd.fd_num(), static_cast<off_t>( size ) ) );
+  {
+    const WritableMapping mapping { fd, size };
+    char* out = mapping.base;
+    store_big_endian( out, CHECKPOINT_MAGIC );
+    store_big_endian( out + 4, CHECKPOINT_VERSION );
+    store_big_endian( out + 6, uint16_t {} );
+    store_big_endian( out + 8, static_cast<uint64_t>( lengths_.size() ) );
+    out += CHECKPOINT_HEADER;
+
+    auto buffer = buffers_.begin();
+    for ( auto const length : lengths_ ) {
+      store_big_endian( out, length );
+      out += RECORD_HEADER;
+      for ( uint64_t copied = 0; copied < length; ++buffer ) {
+        const string_view bytes { *buffer };
+        memcpy( out, bytes.data(), bytes.size() );
+        out += bytes.size();
+        copied += bytes.size();
+      }
+    }
+  }
+  CheckSystemCall( "rename", ::rename( temporary.c_str(), path_.c_str() ) );
+
+  buffers_.clear();
+  lengths_.clear();
+  return size;
+}
+
+CheckpointReader::CheckpointReader( MappedFile file ) : file_( std::move( file ) )
+{
+  const string_view bytes { file_.buffer() };
+  if ( bytes.size() < CHECKPOINT_HEADER or load_big_endian<uint32_t>( bytes.data() ) != CHECKPOINT_MAGIC ) {
+    throw runtime_error( "CheckpointReader: not a checkpoint file" );
+  }
+  if ( load_big_endian<uint16_t>( bytes.data() + 4 ) != CHECKPOINT_VERSION ) {
+    throw runtime_error( "CheckpointReader: unsupported checkpoint version" );
+  }
+  count_ = load_big_endian<uint64_t>( bytes.data() + 8 );
+  pos_ = CHECKPOINT_HEADER;
+}
+
+CheckpointReader CheckpointReader::open( const string& path )
+{
+  return CheckpointReader { MappedFile::open( path ) };
+}
+
+optional<Buffer> CheckpointReader::next()
+{
+  if ( read_ == count_ ) {
+    return {};
+  }
+  const string_view bytes { file_.buffer() };
+  if ( pos_ + RECORD_HEADER > bytes.size() ) {
+    throw runtime_error( "CheckpointReader: truncated file" );
+  }
+  const uint64_t length = load_big_endian<uint64_t>( bytes.data() + pos_ );
+  if ( length > bytes.size() - pos_ - RECORD_HEADER ) {
+    throw runtime_error( "CheckpointReader: truncated record" );
+  }
+  auto record = file_.substr( pos_ + RECORD_HEADER, length );
+  pos_ += RECORD_HEADER + length;
+  ++read_;
+  return record;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "buffer.hh"
+#include "mapped_file.hh"
+#include "parser.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Snapshot files of connection state (see TCPPeer::checkpoint()), for handing every open connection
+// from one process to the next across a restart or upgrade instead of resetting them all.
+//
+// A snapshot is a header (magic, format version, record count) followed by length-prefixed records,
+// each holding whatever one Serializer produced; what goes in a record (a connection's 4-tuple, then
+// its TCPPeer, say) is up to the caller. Integers are big-endian.
+
+//! Collects records and writes them out as one snapshot. The file is laid out through a shared
+//! writable mapping, one memcpy per Buffer, under a temporary name that is renamed over the
+//! snapshot's path only once it is complete, so a reader never sees half a snapshot.
+class CheckpointWriter
+{
+public:
+  explicit CheckpointWriter( std::string path ) : path_( std::move( path ) ) {}
+
+  // Add a record: everything `record` has serialized so far (leaving it empty). Buffers are kept
+  // as they are, so payloads are not copied until commit().
+  void add( Serializer& record );
+
+  size_t records() const { return lengths_.size(); }
+
+  // Write the snapshot, replacing any file at the path, and start over with no records. Returns
+  // the snapshot's size in bytes.
+  size_t commit();
+
+private:
+  std::string path_;
+  std::vector<Buffer> buffers_ {};  // 所有记录的 Buffer，首尾相接
+  std::vector<uint64_t> lengths_ {}; // 每条记录的字节数
+};
+
+//! Reads a snapshot through a read-only mapping. Each record is a Buffer sharing the mapping, so
+//! a Parser over it restores payloads and buffered bytes without copying them (they keep the
+//! mapping alive until they are gone).
+class CheckpointReader
+{
+public:
+  // Throws if the file is not a snapshot, or one in another format version
+  explicit CheckpointReader( MappedFile file );
+  static CheckpointReader open( const std::string& path );
+
+  size_t records() const { return count_; }
+
+  // The next record, or nothing after the last one. Throws if the file is truncated.
+  std::optional<Buffer> next();
+
+private:
+  MappedFile file_;
+  uint64_t count_ {};
+  uint64_t read_ {};
+  size_t pos_ {};
+};
@@ -0,0 +1,234 @@
+#include "checksum.hh"
+
+#include <bit>
+#include <cstring>
+
+#if defined( __x86_64__ )
+#include <immintrin.h>
+#elif defined( __aarch64__ )
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+/**
+ * 反码和与字节序无关（RFC 1071 2(B)）：按本机字节序把 16 位字加起来，折叠后再交换两个字节，
+ * 结果和按网络字节序相加一样。各个 kernel 只负责把偶数个字节按本机字节序加进 64 位累加器，
+ * 不折叠；2^16 ≡ 1 (mod 0xffff)，所以一次加 32 位也可以。
+ */
+namespace {
+// Copy 为 true 时顺便把读到的字节写到 dest（已经在寄存器里了，写出去几乎不花额外的时间）；
+// Copy 为 false 时 dest 是 nullptr，不能碰它，连指针运算也不行
+template<bool Copy>
+uint64_t sum_words( char* dest, const char* data, size_t len )
+{
+  uint64_t acc = 0;
+  for ( ; len >= 8; data += 8, len -= 8 ) {
+    uint64_t word {};
+    memcpy( &word, data, 8 );
+    if constexpr ( Copy ) {
+      memcpy( dest, &word, 8 );
+      dest += 8;
+    }
+    acc += ( word & 0xffffffff ) + ( word >> 32 );
+  }
+  for ( ; len >= 2; data += 2, len -= 2 ) {
+    uint16_t word {};
+    memcpy( &word, data, 2 );
+    if constexpr ( Copy ) {
+      memcpy( dest, &word, 2 );
+      dest += 2;
+    }
+    acc += word;
+  }
+  return acc;
+}
+
+#if defined( __x86_64__ )
+// 32 位通道每轮最多加 2 * 0xffff，BLOCK 轮之后再展宽到 64 位，不会溢出
+constexpr size_t BLOCK = 0x4000;
+
+template<bool Copy>
+uint64_t sum_sse2( char* dest, const char* data, size_t len )
+{
+  const __m128i zero = _mm_setzero_si128();
+  uint64_t total = 0;
+  while ( len >= 16 ) {
+    __m128i lo = zero;
+    __m128i hi = zero;
+    for ( size_t i = 0; i < BLOCK && len >= 16; ++i, data += 16, len -= 16 ) {
+      const __m128i v = _mm_loadu_si128( reinterpret_cast<const __m128i*>( data ) );
+      if constexpr ( Copy ) {
+        _mm_storeu_si128( reinterpret_cast<__m128i*>( dest ), v );
+        dest += 16;
+      }
+      lo = _mm_add_epi32( lo, _mm_unpacklo_epi16( v, zero ) );
+      hi = _mm_add_epi32( hi, _mm_unpackhi_epi16( v, zero ) );
+    }
+    const __m128i s32 = _mm_add_epi32( lo, hi );
+    const __m128i s64 = _mm_add_epi64( _mm_unpacklo_epi32( s32, zero ), _mm_unpackhi_epi32( s32, zero ) );
+    uint64_t lanes[2];
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( lanes ), s64 );
+    total += lanes[0] + lanes[1];
+  }
+  return total + sum_words<Copy>( dest, data, len );
+}
+
+template<bool Copy>
+__attribute__( ( target( "avx2" ) ) ) uint64_t sum_avx2( char* dest, const char* data, size_t len )
+{
+  const __m256i zero = _mm256_setzero_si256();
+  uint64_t total = 0;
+  while ( len >= 32 ) {
+    __m256i lo = zero;
+    __m256i hi = zero;
+    for ( size_t i = 0; i < BLOCK && len >= 32; ++i, data += 32, len -= 32 ) {
+      const __m256i v = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( data ) );
+      if constexpr ( Copy ) {
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( dest ), v );
+        dest += 32;
+      }
+      lo = _mm256_add_epi32( lo, _mm256_unpacklo_epi16( v, zero ) );
+      hi = _mm256_add_epi32( hi, _mm256_unpackhi_epi16( v, zero ) );
+    }
+    const __m256i s32 = _mm256_add_epi32( lo, hi );
+    const __m256i s64
+      = _mm256_add_epi64( _mm256_unpacklo_epi32( s32, zero ), _mm256_unpackhi_epi32( s32, zero ) );
+    uint64_t lanes[4];
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>( lanes ), s64 );
+    total += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+  return total + sum_words<Copy>( dest, data, len );
+}
+#elif defined( __aarch64__ )
+template<bool Copy>
+uint64_t sum_neon( char* dest, const char* data, size_t len )
+{
+  uint64x2_t acc = vdupq_n_u64( 0 );
+  for ( ; len >= 16; data += 16, len -= 16 ) {
+    const uint8x16_t bytes = vld1q_u8( reinterpret_cast<const uint8_t*>( data ) );
+    if constexpr ( Copy ) {
+      vst1q_u8( reinterpret_cast<uint8_t*>( dest ), bytes );
+      dest += 16;
+    }
+    acc = vpadalq_u32( acc, vpaddlq_u16( vreinterpretq_u16_u8( bytes ) ) );
+  }
+  return vgetq_lane_u64( acc, 0 ) + vgetq_lane_u64( acc, 1 ) + sum_words<Copy>( dest, data, len );
+}
+#endif
+
+template<bool Copy>
+uint64_t sum_native( InternetChecksum::Kernel kernel, char* dest, const char* data, size_t len )
+{
+  switch ( kernel ) {
+#if defined( __x86_64__ )
+    case InternetChecksum::Kernel::SSE2:
+      return sum_sse2<Copy>( dest, data, len );
+    case InternetChecksum::Kernel::AVX2:
+      return sum_avx2<Copy>( dest, data, len );
+#elif defined( __aarch64__ )
+    case InternetChecksum::Kernel::NEON:
+      return sum_neon<Copy>( dest, data, len );
+#endif
+    default:
+      return sum_words<Copy>( dest, data, len );
+  }
+}
+} // namespace
+
+bool InternetChecksum::supported( Kernel kernel )
+{
+  switch ( kernel ) {
+    case Kernel::Bytes:
+    case Kernel::Words:
+      return true;
+#if defined( __x86_64__ )
+    case Kernel::SSE2:
+      return true;
+    case Kernel::AVX2:
+      return __builtin_cpu_supports( "avx2" );
+#elif defined( __aarch64__ )
+    case Kernel::NEON:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+InternetChecksum::Kernel InternetChecksum::best_kernel()
+{
+  static const Kernel best = [] {
+    for ( auto kernel : { Kernel::AVX2, Kernel::SSE2, Kernel::NEON } ) {
+      if ( supported( kernel ) ) {
+        return kernel;
+      }
+    }
+    return Kernel::Words;
+  }();
+  return best;
+}
+
+void InternetChecksum::add_bytes( string_view data )
+{
+  for ( const uint8_t i : data ) {
+    uint16_t val = i;
+    if ( not parity_ ) {
+      val <<= 8;
+    }
+    sum_ += val;
+    parity_ = !parity_;
+  }
+}
+
+void InternetChecksum::add_native( uint64_t sum )
+{
+  while ( sum > 0xffff ) {
+    sum = ( sum >> 16 ) + static_cast<uint16_t>( sum );
+  }
+  if constexpr ( endian::native == endian::little ) {
+    sum = ( ( sum & 0xff ) << 8 ) | ( sum >> 8 );
+  }
+  sum_ += sum;
+}
+
+void InternetChecksum::add( string_view data, Kernel kernel )
+{
+  if ( kernel == Kernel::Bytes || data.size() < 16 ) {
+    add_bytes( data );
+    return;
+  }
+
+  // 先补齐上一次留下的半个字，再成对地加
+  if ( parity_ ) {
+    add_bytes( data.substr( 0, 1 ) );
+    data.remove_prefix( 1 );
+  }
+  const size_t even = data.size() & ~size_t { 1 };
+  add_native( sum_native<false>( kernel, nullptr, data.data(), even ) );
+  add_bytes( data.substr( even ) );
+}
+
+void InternetChecksum::copy_and_add( char* dest, string_view data, Kernel kernel )
+{
+  if ( data.empty() ) {
+    return;
+  }
+  if ( kernel == Kernel::Bytes || data.size() < 16 ) {
+    memcpy( dest, data.data(), data.size() );
+    add_bytes( data );
+    return;
+  }
+
+  if ( parity_ ) {
+    *dest++ = data.front();
+    add_bytes( data.substr( 0, 1 ) );
+    data.remove_prefix( 1 );
+  }
+  const size_t even = data.size() & ~size_t { 1 };
+  add_native( sum_native<true>( kernel, dest, data.data(), even ) );
+  if ( even < data.size() ) {
+    dest[even] = data.back();
+    add_bytes( data.substr( even ) );
+  }
+}
@@ -4,32 +4,48 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 //! The internet checksum algorithm
 class InternetChecksum
 {
+public:
+  //! Ways to add up the bytes. All give bit-identical results; add() uses the fastest one the CPU has.
+  enum class Kernel
+  {
+    Bytes, //!< One byte at a time (the reference)
+    Words, //!< Eight bytes at a time in a 64-bit accumulator
+    SSE2,  //!< 16 bytes at a time (x86-64)
+    AVX2,  //!< 32 bytes at a time (x86-64 with AVX2)
+    NEON,  //!< 16 bytes at a time (AArch64)
+  };
+
+  static bool supported( Kernel kernel ); //!< Can this CPU run `kernel`?
+  static Kernel best_kernel();            //!< The kernel add() uses
+
 private:
-  uint32_t sum_;
-  bool parity_ {};
+  uint64_t sum_;
+  bool parity_ {}; // 已经加了奇数个字节：下一个字节是 16 位字的低字节
+
+  void add_bytes( std::string_view data );
+  void add_native( uint64_t sum ); // 折叠 kernel 的 64 位和，换成网络字节序再加上
 
 public:
   explicit InternetChecksum( const uint32_t sum = 0 ) : sum_( sum ) {}
-  void add( std::string_view data )
-  {
-    for ( const uint8_t i : data ) {
-      uint16_t val = i;
-      if ( not parity_ ) {
-        val <<= 8;
-      }
-      sum_ += val;
-      parity_ = !parity_;
-    }
-  }
+
+  void add( std::string_view data ) { add( data, best_kernel() ); }
+  void add( std::string_view data, Kernel kernel );
+
+  //! Copy `data` to `dest` (which has room for it and does not overlap it) and add it, in one pass
+  //! over the bytes: for a payload that has to be copied anyway, the checksum costs about as much
+  //! as a memcpy() instead of a second read of the data
+  void copy_and_add( char* dest, std::string_view data ) { copy_and_add( dest, data, best_kernel() ); }
+  void copy_and_add( char* dest, std::string_view data, Kernel kernel );
 
   uint16_t value() const
   {
-    uint32_t ret = sum_;
+    uint64_t ret = sum_;
 
     while ( ret > 0xffff ) {
       ret = ( ret >> 16 ) + static_cast<uint16_t>( ret );
@@ -44,4 +60,23 @@ public:
       add( x );
     }
   }
+
+  //! Patch `checksum` for one 16-bit word of the summed data changing from `old_word` to
+  //! `new_word` (RFC 1624, eqn. 3), without summing the data again
+  static uint16_t update( uint16_t checksum, uint16_t old_word, uint16_t new_word )
+  {
+    uint32_t sum = static_cast<uint16_t>( ~checksum );
+    sum += static_cast<uint16_t>( ~old_word );
+    sum += new_word;
+    sum = ( sum & 0xffff ) + ( sum >> 16 );
+    sum = ( sum & 0xffff ) + ( sum >> 16 );
+    return static_cast<uint16_t>( ~sum );
+  }
+
+  //! The same for a 32-bit field (e.g. an IPv4 address), as two 16-bit words
+  static uint16_t update32( uint16_t checksum, uint32_t old_value, uint32_t new_value )
+  {
+    checksum = update( checksum, static_cast<uint16_t>( old_value >> 16 ), static_cast<uint16_t>( new_value >> 16 ) );
+    return update( checksum, static_cast<uint16_t>( old_value ), static_cast<uint16_t>( new_value ) );
+  }
 };
@@ -4,6 +4,7 @@
 #include "ethernet_header.hh"
 #include "parser.hh"
 
+#include <optional>
 #include <vector>
 
 struct EthernetFrame
@@ -11,15 +12,35 @@ struct EthernetFrame
   EthernetHeader header {};
   std::vector<Buffer> payload {};
 
+  // `header` already in wire format, if whoever built the frame had it to hand (a NetworkInterface
+  // keeps one per neighbour). It must match `header`; serialize() then shares it instead of
+  // writing the header again.
+  std::optional<Buffer> serialized_header {};
+
+  // Set by a driver whose NIC already verified the payload's checksums (receive checksum offload);
+  // NetworkInterface then skips checking the IPv4 header checksum
+  bool checksum_verified {};
+
+  // The one's-complement sum (folded, not complemented) of every byte after the Ethernet header,
+  // from a driver that summed the frame while copying it in; lets TCP check its checksum without
+  // reading the payload again
+  std::optional<uint16_t> payload_sum {};
+
   void parse( Parser& parser )
   {
     header.parse( parser );
+    serialized_header.reset();
+    payload_sum.reset();
     parser.all_remaining( payload );
   }
 
   void serialize( Serializer& serializer ) const
   {
-    header.serialize( serializer );
+    if ( serialized_header.has_value() ) {
+      serializer.buffer( *serialized_header );
+    } else {
+      header.serialize( serializer );
+    }
     serializer.buffer( payload );
   }
 };
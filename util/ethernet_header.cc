@@ -1,4 +1,5 @@
 #include "ethernet_header.hh"
+#include "header_codec.hh"
 
 #include <iomanip>
 #include <sstream>
@@ -41,34 +42,20 @@ string EthernetHeader::to_string() const
   return ss.str();
 }
 
+namespace {
+using Layout = FixedLayout<EthernetHeader,
+                           Field<&EthernetHeader::dst>,   // destination address
+                           Field<&EthernetHeader::src>,   // source address
+                           Field<&EthernetHeader::type>>; // frame type (e.g. IPv4, ARP, or something else)
+static_assert( Layout::LENGTH == EthernetHeader::LENGTH );
+} // namespace
+
 void EthernetHeader::parse( Parser& parser )
 {
-  // read destination address
-  for ( auto& b : dst ) {
-    parser.integer( b );
-  }
-
-  // read source address
-  for ( auto& b : src ) {
-    parser.integer( b );
-  }
-
-  // read frame type (e.g. IPv4, ARP, or something else)
-  parser.integer( type );
+  Layout::parse( *this, parser );
 }
 
 void EthernetHeader::serialize( Serializer& serializer ) const
 {
-  // write destination address
-  for ( const auto& b : dst ) {
-    serializer.integer( b );
-  }
-
-  // write source address
-  for ( const auto& b : src ) {
-    serializer.integer( b );
-  }
-
-  // write frame type (e.g. IPv4, ARP, or something else)
-  serializer.integer( type );
+  Layout::serialize( *this, serializer );
 }
@@ -22,6 +22,8 @@ struct EthernetHeader
   static constexpr uint16_t TYPE_IPv4 = 0x800; //!< Type number for [IPv4](\ref rfc::rfc791)
   static constexpr uint16_t TYPE_ARP = 0x806;  //!< Type number for [ARP](\ref rfc::rfc826)
 
+  static constexpr uint64_t serialized_length() { return LENGTH; }
+
   EthernetAddress dst;
   EthernetAddress src;
   uint16_t type;
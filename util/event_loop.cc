@@ -0,0 +1,437 @@
+#include "event_loop.hh"
+
+#include "exception.hh"
+#include "io_uring.hh"
+#include "log.hh"
+#include "task.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <sys/stat.h>
+#include <utility>
+
+using namespace std;
+
+namespace {
+// io_uring 的 user_data：登记的 id、提交时的代数、操作的种类
+enum Kind : uint8_t
+{
+  POLL,
+  RECV,
+};
+constexpr uint64_t INTERNAL = UINT64_MAX; // 提供缓冲区、取消操作：不对应哪个登记
+
+uint64_t user_data( EventLoop::Id id, uint8_t generation, Kind kind )
+{
+  return id << 16 | static_cast<uint64_t>( generation ) << 8 | kind;
+}
+
+uint32_t poll_events( bool readable, bool writable )
+{
+  return ( readable ? EPOLLIN | EPOLLRDHUP : 0U ) | ( writable ? EPOLLOUT : 0U );
+}
+} // namespace
+
+bool EventLoop::supported( Backend backend )
+{
+  return backend == Backend::Epoll or IoUring::supported();
+}
+
+EventLoop::EventLoop( Backend backend )
+  : epoll_( CheckSystemCall( "epoll_create1", ::epoll_create1( EPOLL_CLOEXEC ) ) )
+  , ring_( backend == Backend::IoUring ? make_unique<IoUring>() : nullptr )
+{}
+
+EventLoop::~EventLoop()
+{
+  if ( not ring_ ) {
+    return;
+  }
+  // 内核可能还在往缓冲区里读：全部取消，等它们都完成了才能释放
+  try {
+    for ( auto& [id, rule] : rules_ ) {
+      cancel_( id, rule );
+    }
+    for ( int tries = 0; in_flight_ > 0 and tries < 100; ++tries ) {
+      ring_->submit_and_wait( 10 );
+      io_uring_cqe cqe {};
+      while ( ring_->pop_completion( cqe ) ) {
+        if ( cqe.user_data != INTERNAL and not( cqe.flags & IORING_CQE_F_MORE ) ) {
+          --in_flight_;
+        }
+      }
+    }
+  } catch ( const exception& e ) {
+    // don't throw an exception from the destructor
+    log<LogLevel::Error>( [&]( ostream& out ) { out << "Exception destructing EventLoop: " << e.what(); } );
+  }
+}
+
+uint64_t EventLoop::now_ms() const
+{
+  return chrono::duration_cast<chrono::milliseconds>( chrono::steady_clock::now() - start_ ).count();
+}
+
+void EventLoop::epoll_update_( Id id, const Rule& rule, int op )
+{
+  epoll_event event {};
+  event.data.u64 = id;
+  event.events = poll_events( rule.readable, rule.writable ) | ( rule.edge_triggered ? EPOLLET : 0U );
+  CheckSystemCall( "epoll_ctl", ::epoll_ctl( epoll_.fd_num(), op, rule.fd.fd_num(), &event ) );
+}
+
+EventLoop::Id EventLoop::add_rule_( Rule&& rule )
+{
+  const Id id = next_id_++;
+  auto& added = rules_.emplace( id, std::move( rule ) ).first->second;
+  try {
+    if ( ring_ ) {
+      added.slot = ring_->register_file( added.fd.fd_num() );
+      arm_( id, added );
+    } else {
+      epoll_update_( id, added, EPOLL_CTL_ADD );
+    }
+  } catch ( ... ) {
+    rules_.erase( id );
+    throw;
+  }
+  return id;
+}
+
+EventLoop::Id EventLoop::add( const FileDescriptor& fd,
+                              Callback on_readable,
+                              Callback on_writable,
+                              bool edge_triggered )
+{
+  const bool readable = static_cast<bool>( on_readable );
+  const bool writable = static_cast<bool>( on_writable );
+  return add_rule_(
+    { fd.duplicate(), std::move( on_readable ), std::move( on_writable ), {}, edge_triggered, readable, writable } );
+}
+
+EventLoop::Id EventLoop::add_reader( const FileDescriptor& fd, DataCallback on_data )
+{
+  auto reader = fd.duplicate();
+  reader.set_blocking( false );
+  struct stat st {};
+  CheckSystemCall( "fstat", ::fstat( reader.fd_num(), &st ) );
+  Rule rule { std::move( reader ), {}, {}, std::move( on_data ), true, true, false };
+  rule.is_socket = S_ISSOCK( st.st_mode );
+  return add_rule_( std::move( rule ) );
+}
+
+void EventLoop::set_interest( Id id, bool readable, bool writable )
+{
+  auto it = rules_.find( id );
+  if ( it == rules_.end() or it->second.removed ) {
+    return;
+  }
+  auto& rule = it->second;
+  rule.readable = readable and ( rule.on_readable or rule.on_data );
+  rule.writable = writable and rule.on_writable;
+  if ( ring_ ) {
+    cancel_( id, rule );
+    arm_( id, rule );
+  } else {
+    epoll_update_( id, rule, EPOLL_CTL_MOD );
+  }
+}
+
+void EventLoop::remove( Id id )
+{
+  auto it = rules_.find( id );
+  if ( it == rules_.end() or it->second.removed ) {
+    return;
+  }
+  auto& rule = it->second;
+  if ( ring_ ) {
+    cancel_( id, rule );
+    if ( rule.slot >= 0 ) {
+      ring_->unregister_file( rule.slot );
+    }
+  } else if ( not rule.fd.closed() ) {
+    // 已经关掉的描述符内核会自己从 epoll 里拿掉
+    ::epoll_ctl( epoll_.fd_num(), EPOLL_CTL_DEL, rule.fd.fd_num(), nullptr );
+  }
+
+  // 回调正在跑的时候不能释放（可能就是这个回调自己），先做标记
+  if ( dispatching_ ) {
+    rule.removed = true;
+    removed_.push_back( id );
+  } else {
+    rules_.erase( it );
+  }
+}
+
+EventLoop::Id EventLoop::add_timer( uint64_t interval_ms, TimerCallback callback )
+{
+  const Id id = next_id_++;
+  interval_ms = max<uint64_t>( interval_ms, 1 );
+  const uint64_t now = now_ms();
+  timers_.emplace( id, Timer { interval_ms, std::move( callback ), now, now + interval_ms } );
+  due_.emplace( now + interval_ms, id );
+  return id;
+}
+
+void EventLoop::cancel_timer( Id id )
+{
+  timers_.erase( id );
+}
+
+bool EventLoop::run_timers_()
+{
+  bool ran = false;
+  const uint64_t now = now_ms();
+  while ( not due_.empty() and due_.top().first <= now ) {
+    const auto [due, id] = due_.top();
+    due_.pop();
+    auto it = timers_.find( id );
+    if ( it == timers_.end() or it->second.due_ms != due ) {
+      continue;
+    }
+
+    // 回调可能取消自己（或者再加定时器），所以先拿出来，跑完再放回去
+    auto& timer = it->second;
+    const uint64_t elapsed = now - timer.last_run_ms;
+    timer.last_run_ms = now;
+    timer.due_ms = now + timer.interval_ms;
+    due_.emplace( timer.due_ms, id );
+    auto callback = std::move( timer.callback );
+    callback( elapsed );
+    ran = true;
+    if ( it = timers_.find( id ); it != timers_.end() ) {
+      it->second.callback = std::move( callback );
+    }
+  }
+  return ran;
+}
+
+int EventLoop::timeout_for_( int timeout_ms )
+{
+  // 不要睡过下一个定时器
+  while ( not due_.empty() ) {
+    const auto it = timers_.find( due_.top().second );
+    if ( it != timers_.end() and it->second.due_ms == due_.top().first ) {
+      break;
+    }
+    due_.pop();
+  }
+  if ( not due_.empty() ) {
+    const uint64_t now = now_ms();
+    const uint64_t wait = due_.top().first > now ? due_.top().first - now : 0;
+    if ( timeout_ms < 0 or wait < static_cast<uint64_t>( timeout_ms ) ) {
+      timeout_ms = static_cast<int>( wait );
+    }
+  }
+  return timeout_ms;
+}
+
+bool EventLoop::dispatch_( Id id, Rule& rule, uint32_t events )
+{
+  bool ran = false;
+  if ( not rule.removed and rule.readable and ( events & ( EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR ) ) ) {
+    if ( rule.on_data ) {
+      read_ready_( id, rule );
+    } else {
+      rule.on_readable();
+    }
+    ran = true;
+  }
+  if ( not rule.removed and rule.writable and ( events & ( EPOLLOUT | EPOLLERR ) ) ) {
+    rule.on_writable();
+    ran = true;
+  }
+  return ran;
+}
+
+void EventLoop::read_ready_( Id id, Rule& rule )
+{
+  // 边沿触发：一直读到读不出来
+  while ( not rule.removed ) {
+    rule.fd.read( read_buffer_ );
+    if ( rule.fd.eof() ) {
+      rule.on_data( {} );
+      remove( id );
+      return;
+    }
+    if ( read_buffer_.empty() ) {
+      return;
+    }
+    rule.on_data( read_buffer_ );
+  }
+}
+
+void EventLoop::finish_removals_()
+{
+  dispatching_ = false;
+  for ( const Id id : removed_ ) {
+    rules_.erase( id );
+  }
+  removed_.clear();
+}
+
+bool EventLoop::epoll_wait_( int timeout_ms )
+{
+  const int count = ::epoll_wait( epoll_.fd_num(), events_.data(), static_cast<int>( events_.size() ), timeout_ms );
+  if ( count < 0 ) {
+    if ( errno == EINTR ) {
+      return false;
+    }
+    throw unix_error( "epoll_wait" );
+  }
+
+  bool ran = false;
+  for ( int i = 0; i < count; ++i ) {
+    const auto& event = events_.at( i );
+    // 节点式的 unordered_map：回调里 add() 不会让这个引用失效
+    auto it = rules_.find( event.data.u64 );
+    if ( it != rules_.end() ) {
+      ran = dispatch_( it->first, it->second, event.events ) or ran;
+    }
+  }
+  return ran;
+}
+
+void EventLoop::arm_( Id id, Rule& rule )
+{
+  if ( rule.removed or rule.in_flight or not( rule.readable or rule.writable ) ) {
+    return;
+  }
+  auto& sqe = ring_->next_sqe();
+  if ( rule.slot >= 0 ) {
+    sqe.fd = rule.slot;
+    sqe.flags = IOSQE_FIXED_FILE;
+  } else {
+    sqe.fd = rule.fd.fd_num();
+  }
+
+  if ( rule.on_data and rule.is_socket ) {
+    // 不带缓冲区的 recv：数据到了内核才从共享的缓冲区组里挑一块（READ 等数据的时候会一直占着
+    // 一块，所以别的描述符还是先 poll，可读了再 read()）
+    sqe.opcode = IORING_OP_RECV;
+    sqe.flags |= IOSQE_BUFFER_SELECT;
+    sqe.buf_group = IoUring::BUFFER_GROUP;
+    sqe.len = IoUring::BUFFER_SIZE;
+    sqe.user_data = user_data( id, rule.generation, RECV );
+  } else {
+    // 边沿触发用多次触发的 poll，水平触发用单次的，每次回调后重新提交
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.poll32_events = poll_events( rule.readable, rule.writable );
+    sqe.len = rule.edge_triggered ? IORING_POLL_ADD_MULTI : 0;
+    sqe.user_data = user_data( id, rule.generation, POLL );
+  }
+  rule.in_flight = true;
+  ++in_flight_;
+}
+
+void EventLoop::cancel_( Id id, Rule& rule )
+{
+  if ( not rule.in_flight ) {
+    return;
+  }
+  // 取消时按提交时的 user_data 找；代数加一之后，它的完成事件（-ECANCELED）就被忽略了
+  auto& sqe = ring_->next_sqe();
+  sqe.opcode = IORING_OP_ASYNC_CANCEL;
+  sqe.addr = user_data( id, rule.generation, rule.on_data and rule.is_socket ? RECV : POLL );
+  sqe.user_data = INTERNAL;
+  sqe.flags = IOSQE_CQE_SKIP_SUCCESS;
+  ++rule.generation;
+  rule.in_flight = false;
+}
+
+bool EventLoop::complete_( uint64_t data, int32_t res, uint32_t flags )
+{
+  if ( data == INTERNAL ) {
+    return false;
+  }
+  if ( not( flags & IORING_CQE_F_MORE ) ) {
+    --in_flight_;
+  }
+
+  const Id id = data >> 16;
+  const auto generation = static_cast<uint8_t>( data >> 8 );
+  const bool has_buffer = flags & IORING_CQE_F_BUFFER;
+  const auto buffer_id = static_cast<uint16_t>( flags >> IORING_CQE_BUFFER_SHIFT );
+  auto it = rules_.find( id );
+  if ( it == rules_.end() or it->second.removed or it->second.generation != generation ) {
+    // 已经取消（或删掉）的操作；它要是拿了缓冲区，还回去
+    if ( has_buffer ) {
+      ring_->provide_buffer( buffer_id );
+    }
+    return false;
+  }
+  auto& rule = it->second;
+  if ( not( flags & IORING_CQE_F_MORE ) ) {
+    rule.in_flight = false;
+  }
+
+  if ( ( data & 0xff ) == POLL ) {
+    const bool ran = dispatch_( id, rule, res < 0 ? EPOLLERR : static_cast<uint32_t>( res ) );
+    arm_( id, rule ); // 单次的 poll（或被内核结束的多次 poll）重新提交
+    return ran;
+  }
+
+  if ( res == -ENOBUFS ) {
+    starved_.push_back( id );
+    return false;
+  }
+  if ( res < 0 ) {
+    throw unix_error( "io_uring recv", -res );
+  }
+  if ( res == 0 ) {
+    rule.on_data( {} );
+    remove( id );
+    return true;
+  }
+  rule.on_data( { ring_->buffer( buffer_id ), static_cast<size_t>( res ) } );
+  ring_->provide_buffer( buffer_id );
+  arm_( id, rule );
+  return true;
+}
+
+EventLoop::Result EventLoop::wait_next_event( int timeout_ms )
+{
+  if ( stopped_ ) {
+    stopped_ = false;
+    return Result::Exit;
+  }
+  if ( size() == 0 and timers_.empty() and not Task::ready() ) {
+    return Result::Exit;
+  }
+
+  // 有协程等着接着跑就不睡
+  timeout_ms = Task::ready() ? 0 : timeout_for_( timeout_ms );
+  bool ran = false;
+  dispatching_ = true;
+  try {
+    if ( ring_ ) {
+      ring_->submit_and_wait( timeout_ms );
+      io_uring_cqe cqe {};
+      while ( ring_->pop_completion( cqe ) ) {
+        ran = complete_( cqe.user_data, cqe.res, cqe.flags ) or ran;
+      }
+      // 缓冲区都还回去了，之前没拿到缓冲区的读重新提交
+      for ( const Id id : exchange( starved_, {} ) ) {
+        if ( auto it = rules_.find( id ); it != rules_.end() ) {
+          arm_( id, it->second );
+        }
+      }
+    } else {
+      ran = epoll_wait_( timeout_ms );
+    }
+  } catch ( ... ) {
+    finish_removals_();
+    throw;
+  }
+  finish_removals_();
+
+  ran = run_timers_() or ran;
+  // 回调和定时器唤醒的协程在这里接着跑
+  ran = Task::run_ready() > 0 or ran;
+  return ran ? Result::Success : Result::Timeout;
+}
+
+void EventLoop::run()
+{
+  while ( wait_next_event( -1 ) != Result::Exit ) {}
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/epoll.h>
+
+class IoUring;
+
+//! \brief Waits for any of many FileDescriptors to become ready, and for timers, on one thread
+//! \details Each registered FileDescriptor gets a callback for "readable" (data, EOF or an error
+//! to pick up) and one for "writable". They are edge-triggered by default: a callback runs once
+//! each time the descriptor *becomes* ready, so it must read (or write) until the call would
+//! block, which needs the descriptor to be non-blocking. Level-triggered registrations run their
+//! callbacks for as long as the descriptor stays ready.
+//!
+//! A reader (add_reader()) is handed the data itself. With the epoll backend the loop reads it
+//! when the descriptor is readable; with io_uring, a socket's data is received by the kernel into
+//! a buffer it picks from a shared pool, so a readable socket costs no system call of its own.
+//!
+//! Timers repeat every `interval_ms` and are told how long it really was since they last ran,
+//! which is what TCPPeer::tick() wants. Callbacks may add or remove registrations and timers,
+//! including their own.
+//!
+//! After the callbacks, the loop resumes the coroutines woken meanwhile (Task::run_ready()), and
+//! it does not sleep while any are waiting to run: AsyncSocket builds on this.
+class EventLoop
+{
+public:
+  using Id = uint64_t;
+  using Callback = std::function<void()>;
+  using DataCallback = std::function<void( std::string_view data )>;
+  using TimerCallback = std::function<void( uint64_t ms_since_last_run )>;
+
+  //! How the loop waits
+  enum class Backend : uint8_t
+  {
+    Epoll,   //!< epoll_wait(), plus a read() for each readable reader
+    IoUring, //!< polls and socket reads are queued, and submitted with the wait in one io_uring_enter()
+  };
+
+  //! Can this kernel run `backend`?
+  static bool supported( Backend backend );
+
+  enum class Result : uint8_t
+  {
+    Success, //!< At least one callback (or woken coroutine) ran
+    Timeout, //!< Nothing became ready in time
+    Exit,    //!< Nothing is registered or waiting to run, or stop() was called
+  };
+
+  explicit EventLoop( Backend backend = Backend::Epoll );
+  ~EventLoop();
+
+  EventLoop( const EventLoop& other ) = delete;
+  EventLoop& operator=( const EventLoop& other ) = delete;
+  EventLoop( EventLoop&& other ) = delete;
+  EventLoop& operator=( EventLoop&& other ) = delete;
+
+  Backend backend() const { return ring_ ? Backend::IoUring : Backend::Epoll; }
+
+  //! Watch `fd` (the loop keeps a duplicate). An empty callback means that direction is not watched.
+  Id add( const FileDescriptor& fd, Callback on_readable, Callback on_writable = {}, bool edge_triggered = true );
+
+  //! Hand everything read from `fd` (made non-blocking) to `on_data`, in order, until EOF: then
+  //! `on_data` gets an empty view and the registration is removed. The data is only good during the call.
+  Id add_reader( const FileDescriptor& fd, DataCallback on_data );
+
+  //! Watch (or stop watching) each direction of a registration, e.g. to ask for "writable" only
+  //! while there is something queued to write
+  void set_interest( Id id, bool readable, bool writable );
+
+  //! Stop watching. Safe to call from any callback, for any registration.
+  void remove( Id id );
+
+  //! Run `callback` every `interval_ms` (at least 1 ms), starting `interval_ms` from now
+  Id add_timer( uint64_t interval_ms, TimerCallback callback );
+  void cancel_timer( Id id );
+
+  //! Wait up to `timeout_ms` (-1: until something happens) for readiness or a timer, and run
+  //! the callbacks for everything that is ready
+  Result wait_next_event( int timeout_ms );
+
+  //! Run until nothing is registered or stop() is called
+  void run();
+
+  //! Make run() (and the next wait_next_event()) return
+  void stop() { stopped_ = true; }
+
+  size_t size() const { return rules_.size() - removed_.size(); } //!< Number of FileDescriptors watched
+  size_t timers() const { return timers_.size(); }                 //!< Number of timers running
+
+private:
+  static constexpr size_t MAX_EVENTS = 256; //!< Events taken from epoll_wait() at once
+
+  struct Rule
+  {
+    FileDescriptor fd;
+    Callback on_readable;
+    Callback on_writable;
+    DataCallback on_data;
+    bool edge_triggered;
+    bool readable;
+    bool writable;
+    bool removed {};
+    bool is_socket {};     // add_reader() 的套接字：io_uring 直接 recv
+    int slot { -1 };       // io_uring 的固定文件槽（-1：没有）
+    uint8_t generation {}; // io_uring：每重新提交一次加一，旧操作的完成事件就对不上了
+    bool in_flight {};     // io_uring：poll（或读）还在内核里
+  };
+
+  struct Timer
+  {
+    uint64_t interval_ms;
+    TimerCallback callback;
+    uint64_t last_run_ms;
+    uint64_t due_ms;
+  };
+
+  uint64_t now_ms() const; // milliseconds since construction
+  Id add_rule_( Rule&& rule );
+  bool dispatch_( Id id, Rule& rule, uint32_t events ); // run the callbacks for epoll-style `events`
+  void read_ready_( Id id, Rule& rule );
+  bool run_timers_(); // run the timers that are due; did any run?
+  int timeout_for_( int timeout_ms );
+  void finish_removals_();
+
+  // epoll 后端
+  void epoll_update_( Id id, const Rule& rule, int op );
+  bool epoll_wait_( int timeout_ms );
+
+  // io_uring 后端
+  void arm_( Id id, Rule& rule );
+  void cancel_( Id id, Rule& rule );
+  bool complete_( uint64_t user_data, int32_t res, uint32_t flags );
+
+  FileDescriptor epoll_;
+  std::unique_ptr<IoUring> ring_;
+  std::chrono::steady_clock::time_point start_ { std::chrono::steady_clock::now() };
+  Id next_id_ {};
+  bool stopped_ {};
+  bool dispatching_ {}; // 正在跑可读/可写的回调
+
+  std::unordered_map<Id, Rule> rules_ {};
+  std::vector<Id> removed_ {}; // 回调里删掉的登记，等这一轮回调都跑完再释放
+  std::vector<Id> starved_ {}; // io_uring：读的时候缓冲区正好用完了，这一轮结束后再读
+  size_t in_flight_ {};        // io_uring：还没完成的操作数
+  std::string read_buffer_ {}; // epoll：add_reader() 读数据用
+
+  std::unordered_map<Id, Timer> timers_ {};
+  // 按到期时间排的最小堆；已经取消（或者改了到期时间）的项对不上 timers_，弹出时跳过
+  std::priority_queue<std::pair<uint64_t, Id>, std::vector<std::pair<uint64_t, Id>>, std::greater<>> due_ {};
+
+  std::array<epoll_event, MAX_EVENTS> events_ {};
+};
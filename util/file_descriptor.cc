@@ -1,11 +1,13 @@
 #include "file_descriptor.hh"
 
 #include "exception.hh"
+#include "log.hh"
 
 #include <algorithm>
 #include <fcntl.h>
 #include <iostream>
 #include <stdexcept>
+#include <sys/sendfile.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/uio.h>
@@ -62,7 +64,7 @@ FileDescriptor::FDWrapper::~FDWrapper()
     close();
   } catch ( const exception& e ) {
     // don't throw an exception from the destructor
-    cerr << "Exception destructing FDWrapper: " << e.what() << endl;
+    log<LogLevel::Error>( [&]( ostream& out ) { out << "Exception destructing FDWrapper: " << e.what(); } );
   }
 }
 
@@ -79,16 +81,15 @@ FileDescriptor FileDescriptor::duplicate() const
   return FileDescriptor { internal_fd_ };
 }
 
-// buffer is the string to be read into
-void FileDescriptor::read( string& buffer )
+string_view FileDescriptor::read_to_scratch()
 {
-  buffer.clear();
-  buffer.resize( kReadBufferSize );
+  // 每个线程一块，不清零；读到多少字节调用方才拷多少
+  thread_local const unique_ptr<char[]> scratch = make_unique_for_overwrite<char[]>( kReadBufferSize );
 
-  const ssize_t bytes_read = ::read( fd_num(), buffer.data(), buffer.size() );
+  const ssize_t bytes_read = ::read( fd_num(), scratch.get(), kReadBufferSize );
   if ( bytes_read < 0 ) {
     if ( internal_fd_->non_blocking_ and ( errno == EAGAIN or errno == EINPROGRESS ) ) {
-      return;
+      return {}; // 没有数据可读：空的，不是 EOF
     }
     throw unix_error { "read" };
   }
@@ -99,11 +100,31 @@ void FileDescriptor::read( string& buffer )
     internal_fd_->eof_ = true;
   }
 
-  if ( bytes_read > static_cast<ssize_t>( buffer.size() ) ) {
+  if ( bytes_read > static_cast<ssize_t>( kReadBufferSize ) ) {
     throw runtime_error( "read() read more than requested" );
   }
 
-  buffer.resize( bytes_read );
+  return { scratch.get(), static_cast<size_t>( bytes_read ) };
+}
+
+// buffer is the string to be read into
+void FileDescriptor::read( string& buffer )
+{
+  // 只有读到的字节才写进 buffer，buffer 原来的容量够就不用分配
+  buffer.assign( read_to_scratch() );
+}
+
+void FileDescriptor::read( vector<Buffer>& buffers )
+{
+  buffers.clear();
+  string_view data = read_to_scratch();
+  while ( not data.empty() ) {
+    const string_view chunk = data.substr( 0, Buffer::JUMBO_SLAB );
+    string str = Buffer::pooled_string( chunk.size() );
+    str.assign( chunk );
+    buffers.emplace_back( std::move( str ) );
+    data.remove_prefix( chunk.size() );
+  }
 }
 
 void FileDescriptor::read( vector<unique_ptr<string>>& buffers )
@@ -169,7 +190,8 @@ size_t FileDescriptor::write( const vector<string_view>& buffers )
     = CheckSystemCall( "writev", ::writev( fd_num(), iovecs.data(), static_cast<int>( iovecs.size() ) ) );
   register_write();
 
-  if ( bytes_written == 0 and total_size != 0 ) {
+  // 非阻塞的描述符写不进去时返回 0（CheckSystemCall 把 EAGAIN 变成 0）
+  if ( bytes_written == 0 and total_size != 0 and not internal_fd_->non_blocking_ ) {
     throw runtime_error( "write returned 0 given non-empty input buffer" );
   }
 
@@ -180,6 +202,29 @@ size_t FileDescriptor::write( const vector<string_view>& buffers )
   return bytes_written;
 }
 
+size_t FileDescriptor::sendfile_from( const FileDescriptor& in, off_t& offset, size_t count )
+{
+  const ssize_t bytes_sent = CheckSystemCall( "sendfile", ::sendfile( fd_num(), in.fd_num(), &offset, count ) );
+  register_write();
+  return bytes_sent;
+}
+
+size_t FileDescriptor::splice_from( const FileDescriptor& in, size_t count )
+{
+  // 两端有一个是非阻塞的，管道那一端也不等
+  const bool non_blocking = internal_fd_->non_blocking_ or in.internal_fd_->non_blocking_;
+  const unsigned flags = SPLICE_F_MOVE | ( non_blocking ? SPLICE_F_NONBLOCK : 0U );
+  const ssize_t bytes_moved = ::splice( in.fd_num(), nullptr, fd_num(), nullptr, count, flags );
+  if ( bytes_moved < 0 ) {
+    if ( non_blocking and errno == EAGAIN ) {
+      return 0;
+    }
+    throw unix_error { "splice" };
+  }
+  register_write();
+  return bytes_moved;
+}
+
 void FileDescriptor::set_blocking( bool blocking )
 {
   int flags = CheckSystemCall( "fcntl", fcntl( fd_num(), F_GETFL ) ); // NOLINT(*-vararg)
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "buffer.hh"
+
 #include <cstddef>
 #include <limits>
 #include <memory>
+#include <string_view>
 #include <vector>
 
 // A reference-counted handle to a file descriptor
@@ -47,6 +50,11 @@ protected:
   // size of buffer to allocate for read()
   static constexpr size_t kReadBufferSize = 16384;
 
+  // One read() of up to kReadBufferSize bytes into a per-thread scratch area, which is never
+  // initialized: callers copy out only the bytes that were read. Empty (without setting eof())
+  // if a non-blocking read would block. Good until this thread's next read.
+  std::string_view read_to_scratch();
+
   void set_eof() { internal_fd_->eof_ = true; }
   void register_read() { ++internal_fd_->read_count_; }   // increment read count
   void register_write() { ++internal_fd_->write_count_; } // increment write count
@@ -61,15 +69,31 @@ public:
   // Free the std::shared_ptr; the FDWrapper destructor calls close() when the refcount goes to zero.
   ~FileDescriptor() = default;
 
-  // Read into `buffer`
+  // Read into `buffer` (left empty, without setting eof(), if a non-blocking read would block)
   void read( std::string& buffer );
   void read( std::vector<std::unique_ptr<std::string>>& buffers );
 
+  // Read into pooled Buffers of at most Buffer::JUMBO_SLAB bytes each, sized to what was read, ready
+  // to push() into a ByteStream. `buffers` is cleared first (left empty if a non-blocking read would
+  // block); reusing it, once the pool is warm, makes steady-state reads allocation-free.
+  void read( std::vector<Buffer>& buffers );
+
   // Attempt to write a buffer
-  // returns number of bytes written
+  // returns number of bytes written (0 if a non-blocking write would block)
   size_t write( std::string_view buffer );
   size_t write( const std::vector<std::string_view>& buffers );
 
+  // Copy up to `count` bytes of `in`, starting at `offset` (advanced past what was sent), to this
+  // descriptor inside the kernel with [sendfile(2)](\ref man2::sendfile): e.g. a file to a socket.
+  // Returns the number of bytes sent (0 at the end of `in`, or if a non-blocking write would block).
+  size_t sendfile_from( const FileDescriptor& in, off_t& offset, size_t count );
+
+  // Move up to `count` bytes from `in` to this descriptor with [splice(2)](\ref man2::splice), by
+  // reference to the kernel's pages rather than by a copy. One of the two must be a pipe (to go
+  // socket to socket, splice into a pipe and then out of it). Returns the number of bytes moved
+  // (0 at the end of `in`, or if either end is non-blocking and the call would block).
+  size_t splice_from( const FileDescriptor& in, size_t count );
+
   // Close the underlying file descriptor
   void close() { internal_fd_->close(); }
 
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "parser.hh"
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Compile-time description of a fixed-layout header, from which its encoder and decoder are
+// generated. A layout lists the header's fields in wire order:
+//
+//   using Layout = FixedLayout<EthernetHeader,
+//                              Field<&EthernetHeader::dst>,
+//                              Field<&EthernetHeader::src>,
+//                              Field<&EthernetHeader::type>>;
+//
+// Field<&T::member> stores an unsigned integer big-endian, or a byte array as is. Fields that
+// don't map to one member (e.g. IPv4's version and header length sharing a byte) are a
+// Packed<T, Wire, get, set> with a pair of plain functions. Everything is inlined, so parse()
+// and serialize() come out as one bounds check and a handful of loads or stores.
+
+template<auto Member>
+struct Field;
+
+template<class T, std::unsigned_integral U, U T::*Member>
+struct Field<Member>
+{
+  static constexpr size_t SIZE = sizeof( U );
+  static void load( T& obj, const char* bytes ) { obj.*Member = load_big_endian<U>( bytes ); }
+  static void store( const T& obj, char* bytes ) { store_big_endian( bytes, obj.*Member ); }
+};
+
+template<class T, size_t N, std::array<uint8_t, N> T::*Member>
+struct Field<Member>
+{
+  static constexpr size_t SIZE = N;
+  static void load( T& obj, const char* bytes ) { std::memcpy( ( obj.*Member ).data(), bytes, N ); }
+  static void store( const T& obj, char* bytes ) { std::memcpy( bytes, ( obj.*Member ).data(), N ); }
+};
+
+template<class T, std::unsigned_integral Wire, Wire ( *Get )( const T& ), void ( *Set )( T&, Wire )>
+struct Packed
+{
+  static constexpr size_t SIZE = sizeof( Wire );
+  static void load( T& obj, const char* bytes ) { Set( obj, load_big_endian<Wire>( bytes ) ); }
+  static void store( const T& obj, char* bytes ) { store_big_endian( bytes, Get( obj ) ); }
+};
+
+template<class T, class... Fields>
+struct FixedLayout
+{
+  static constexpr size_t LENGTH = ( Fields::SIZE + ... );
+
+  static void decode( T& obj, const char* bytes )
+  {
+    size_t at = 0;
+    ( ( Fields::load( obj, bytes + at ), at += Fields::SIZE ), ... );
+  }
+
+  static void encode( const T& obj, char* bytes )
+  {
+    size_t at = 0;
+    ( ( Fields::store( obj, bytes + at ), at += Fields::SIZE ), ... );
+  }
+
+  // Read the header from the parser; a header that straddles Buffers is copied out first
+  static void parse( T& obj, Parser& parser )
+  {
+    std::array<char, LENGTH> copy {};
+    parse( obj, parser, copy );
+  }
+
+  // Same, and return the wire bytes that were read: in the parser's input, or in `copy` if they
+  // had to be copied out (nullptr on error). Good until the input Buffers or `copy` go away.
+  static const char* parse( T& obj, Parser& parser, std::array<char, LENGTH>& copy )
+  {
+    if ( const char* bytes = parser.contiguous( LENGTH ) ) {
+      decode( obj, bytes );
+      parser.remove_prefix( LENGTH );
+      return bytes;
+    }
+    parser.string( copy );
+    if ( parser.has_error() ) {
+      return nullptr;
+    }
+    decode( obj, copy.data() );
+    return copy.data();
+  }
+
+  static void serialize( const T& obj, Serializer& serializer ) { encode( obj, serializer.extend( LENGTH ) ); }
+};
@@ -0,0 +1,215 @@
+#include "io_uring.hh"
+
+#include "exception.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+int io_uring_setup( unsigned entries, io_uring_params& params )
+{
+  return static_cast<int>( ::syscall( __NR_io_uring_setup, entries, &params ) );
+}
+
+int io_uring_enter( int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg, size_t size )
+{
+  return static_cast<int>( ::syscall( __NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, size ) );
+}
+
+int io_uring_register( int fd, unsigned opcode, void* arg, unsigned nr_args )
+{
+  return static_cast<int>( ::syscall( __NR_io_uring_register, fd, opcode, arg, nr_args ) );
+}
+
+// 需要的功能：一次映射两个环、带超时的 enter、多次触发的 poll（5.13 起，和 RSRC_TAGS 同时出现）、
+// 成功时不产生 CQE 的 SQE（5.17）
+constexpr uint32_t REQUIRED_FEATURES
+  = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS | IORING_FEAT_CQE_SKIP;
+} // namespace
+
+void IoUring::Unmap::operator()( char* base ) const
+{
+  ::munmap( base, length );
+}
+
+bool IoUring::supported()
+{
+  io_uring_params params {};
+  const int fd = io_uring_setup( 1, params );
+  if ( fd < 0 ) {
+    return false;
+  }
+  ::close( fd );
+  return ( params.features & REQUIRED_FEATURES ) == REQUIRED_FEATURES;
+}
+
+IoUring::IoUring( unsigned entries, unsigned fixed_files, size_t buffers )
+  : fd_( CheckSystemCall( "io_uring_setup", io_uring_setup( entries, params_ ) ) )
+  , rings_( nullptr, Unmap { 0 } )
+  , sqes_( nullptr, Unmap { 0 } )
+{
+  if ( ( params_.features & REQUIRED_FEATURES ) != REQUIRED_FEATURES ) {
+    throw runtime_error( "io_uring: kernel too old" );
+  }
+
+  const size_t sq_size = params_.sq_off.array + params_.sq_entries * sizeof( uint32_t );
+  const size_t cq_size = params_.cq_off.cqes + params_.cq_entries * sizeof( io_uring_cqe );
+  const size_t rings_size = max( sq_size, cq_size );
+  void* rings = ::mmap(
+    nullptr, rings_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_.fd_num(), IORING_OFF_SQ_RING );
+  if ( rings == MAP_FAILED ) { // NOLINT(*-cstyle-cast)
+    throw unix_error( "mmap io_uring rings" );
+  }
+  rings_ = { static_cast<char*>( rings ), Unmap { rings_size } };
+
+  const size_t sqes_size = params_.sq_entries * sizeof( io_uring_sqe );
+  void* sqes
+    = ::mmap( nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_.fd_num(), IORING_OFF_SQES );
+  if ( sqes == MAP_FAILED ) { // NOLINT(*-cstyle-cast)
+    throw unix_error( "mmap io_uring SQEs" );
+  }
+  sqes_ = { static_cast<char*>( sqes ), Unmap { sqes_size } };
+
+  // SQ 的索引数组固定成恒等映射：第 i 个槽就是第 i 个 SQE
+  auto* array = ring_field<uint32_t>( params_.sq_off.array );
+  for ( uint32_t i = 0; i < params_.sq_entries; ++i ) {
+    array[i] = i; // NOLINT(*-pointer-arithmetic)
+  }
+  sq_tail_ = *ring_field<uint32_t>( params_.sq_off.tail );
+
+  // 稀疏的固定文件表（-1 是空槽）；大小受 RLIMIT_NOFILE 限制
+  rlimit limit {};
+  CheckSystemCall( "getrlimit", ::getrlimit( RLIMIT_NOFILE, &limit ) );
+  fixed_files = static_cast<unsigned>( min<rlim_t>( fixed_files, limit.rlim_cur ) );
+  if ( fixed_files > 0 ) {
+    vector<int> table( fixed_files, -1 );
+    CheckSystemCall( "io_uring_register files",
+                     io_uring_register( fd_.fd_num(), IORING_REGISTER_FILES, table.data(), fixed_files ) );
+    for ( unsigned slot = fixed_files; slot > 0; --slot ) {
+      free_slots_.push_back( static_cast<int>( slot - 1 ) );
+    }
+  }
+
+  // 提供给内核的缓冲区：读操作不带缓冲区，数据到了内核才挑一块
+  buffers = min<size_t>( buffers, UINT16_MAX );
+  buffers_.resize( buffers * BUFFER_SIZE );
+  if ( buffers > 0 ) {
+    auto& sqe = next_sqe();
+    sqe.opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe.fd = static_cast<int>( buffers );
+    sqe.addr = reinterpret_cast<uint64_t>( buffers_.data() ); // NOLINT(*-reinterpret-cast)
+    sqe.len = BUFFER_SIZE;
+    sqe.buf_group = BUFFER_GROUP;
+    sqe.user_data = UINT64_MAX;
+    sqe.flags = IOSQE_CQE_SKIP_SUCCESS;
+    submit_and_wait( 0 );
+  }
+}
+
+io_uring_sqe& IoUring::next_sqe()
+{
+  const atomic_ref<uint32_t> head { *ring_field<uint32_t>( params_.sq_off.head ) };
+  if ( sq_tail_ - head.load( memory_order_acquire ) >= params_.sq_entries ) {
+    submit_and_wait( 0 );
+  }
+  const uint32_t mask = *ring_field<uint32_t>( params_.sq_off.ring_mask );
+  auto* sqe = reinterpret_cast<io_uring_sqe*>( sqes_.get() ) + ( sq_tail_ & mask ); // NOLINT(*-reinterpret-cast)
+  *sqe = {};
+  ++sq_tail_;
+  return *sqe;
+}
+
+void IoUring::submit_and_wait( int timeout_ms )
+{
+  // 先把尾指针发布出去，内核才看得到新的 SQE
+  atomic_ref<uint32_t> { *ring_field<uint32_t>( params_.sq_off.tail ) }.store( sq_tail_, memory_order_release );
+  const atomic_ref<uint32_t> head { *ring_field<uint32_t>( params_.sq_off.head ) };
+  const unsigned to_submit = sq_tail_ - head.load( memory_order_acquire );
+  if ( to_submit == 0 and timeout_ms == 0 ) {
+    return;
+  }
+
+  unsigned flags = 0;
+  unsigned min_complete = 0;
+  __kernel_timespec ts {};
+  io_uring_getevents_arg arg {};
+  arg.sigmask_sz = _NSIG / 8;
+  if ( timeout_ms != 0 ) {
+    flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    min_complete = 1;
+    if ( timeout_ms > 0 ) {
+      ts.tv_sec = timeout_ms / 1000;
+      ts.tv_nsec = static_cast<long long>( timeout_ms % 1000 ) * 1000000;
+      arg.ts = reinterpret_cast<uint64_t>( &ts ); // NOLINT(*-reinterpret-cast)
+    }
+  }
+
+  // 超时或被信号打断不算错误；没交出去的 SQE 还在环里，下次再交
+  if ( io_uring_enter( fd_.fd_num(), to_submit, min_complete, flags, &arg, sizeof( arg ) ) < 0 and errno != ETIME
+       and errno != EINTR ) {
+    throw unix_error( "io_uring_enter" );
+  }
+}
+
+bool IoUring::pop_completion( io_uring_cqe& out )
+{
+  atomic_ref<uint32_t> head { *ring_field<uint32_t>( params_.cq_off.head ) };
+  const atomic_ref<uint32_t> tail { *ring_field<uint32_t>( params_.cq_off.tail ) };
+  const uint32_t at = head.load( memory_order_relaxed );
+  if ( at == tail.load( memory_order_acquire ) ) {
+    return false;
+  }
+  const uint32_t mask = *ring_field<uint32_t>( params_.cq_off.ring_mask );
+  out = ring_field<io_uring_cqe>( params_.cq_off.cqes )[at & mask]; // NOLINT(*-pointer-arithmetic)
+  head.store( at + 1, memory_order_release );
+  return true;
+}
+
+int IoUring::register_file( int fd )
+{
+  if ( free_slots_.empty() ) {
+    return -1;
+  }
+  const int slot = free_slots_.back();
+  io_uring_files_update update {};
+  update.offset = static_cast<uint32_t>( slot );
+  update.fds = reinterpret_cast<uint64_t>( &fd ); // NOLINT(*-reinterpret-cast)
+  CheckSystemCall( "io_uring_register files_update",
+                   io_uring_register( fd_.fd_num(), IORING_REGISTER_FILES_UPDATE, &update, 1 ) );
+  free_slots_.pop_back();
+  return slot;
+}
+
+void IoUring::unregister_file( int slot )
+{
+  // 还在进行中的操作自己拿着文件的引用，槽马上就能再用
+  int empty = -1;
+  io_uring_files_update update {};
+  update.offset = static_cast<uint32_t>( slot );
+  update.fds = reinterpret_cast<uint64_t>( &empty ); // NOLINT(*-reinterpret-cast)
+  CheckSystemCall( "io_uring_register files_update",
+                   io_uring_register( fd_.fd_num(), IORING_REGISTER_FILES_UPDATE, &update, 1 ) );
+  free_slots_.push_back( slot );
+}
+
+void IoUring::provide_buffer( uint16_t id )
+{
+  auto& sqe = next_sqe();
+  sqe.opcode = IORING_OP_PROVIDE_BUFFERS;
+  sqe.fd = 1;
+  sqe.addr = reinterpret_cast<uint64_t>( buffer( id ) ); // NOLINT(*-reinterpret-cast)
+  sqe.len = BUFFER_SIZE;
+  sqe.off = id;
+  sqe.buf_group = BUFFER_GROUP;
+  sqe.user_data = UINT64_MAX;
+  sqe.flags = IOSQE_CQE_SKIP_SUCCESS;
+}
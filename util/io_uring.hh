@@ -0,0 +1,71 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <linux/io_uring.h>
+
+//! \brief A minimal [io_uring](\ref man7::io_uring) instance (no liburing): the submission and
+//! completion rings, a table of fixed files, and a group of buffers the kernel picks from for reads
+//! \details SQEs queue up in the submission ring until submit_and_wait(), which hands them all to
+//! the kernel and waits for completions with a single io_uring_enter(). The completion ring is
+//! read straight from shared memory.
+class IoUring
+{
+public:
+  static constexpr uint16_t BUFFER_GROUP = 0;    //!< Group id of the provided buffers
+  static constexpr size_t BUFFER_SIZE = 16384;   //!< Size of each provided buffer
+  static constexpr size_t DEFAULT_BUFFERS = 256; //!< Provided buffers (4 MiB)
+
+  //! Does this kernel have everything used here (and is io_uring allowed)?
+  static bool supported();
+
+  //! `entries` SQEs, up to `fixed_files` registered descriptors, `buffers` provided buffers
+  explicit IoUring( unsigned entries = 256, unsigned fixed_files = 4096, size_t buffers = DEFAULT_BUFFERS );
+
+  //! The next free SQE, zeroed. If the submission ring is full, what is queued is submitted first.
+  io_uring_sqe& next_sqe();
+
+  //! Submit everything queued and wait up to `timeout_ms` (-1: forever, 0: not at all) for at
+  //! least one completion
+  void submit_and_wait( int timeout_ms );
+
+  //! Take the next completion, if there is one
+  bool pop_completion( io_uring_cqe& out );
+
+  //! Put `fd` in the fixed-file table. Returns its slot, or -1 if the table is full.
+  int register_file( int fd );
+  void unregister_file( int slot );
+
+  //! The contents of provided buffer `id`, and a (queued) request to give it back to the kernel.
+  //! Completions of reads with IOSQE_BUFFER_SELECT say which buffer they filled.
+  char* buffer( uint16_t id ) { return buffers_.data() + id * BUFFER_SIZE; }
+  void provide_buffer( uint16_t id );
+
+private:
+  struct Unmap
+  {
+    size_t length;
+    void operator()( char* base ) const;
+  };
+  using Mapping = std::unique_ptr<char, Unmap>;
+
+  io_uring_params params_ {}; // io_uring_setup() 填的，所以要在 fd_ 之前
+  FileDescriptor fd_;
+  Mapping rings_;       // SQ 和 CQ 两个环（IORING_FEAT_SINGLE_MMAP：一次映射）
+  Mapping sqes_;        // SQE 数组
+  unsigned sq_tail_ {}; // 本地的 SQ 尾，submit 时才写回共享内存
+  std::vector<int> free_slots_ {};
+  std::vector<char> buffers_ {};
+
+  template<class T>
+  T* ring_field( uint32_t offset ) const
+  {
+    return reinterpret_cast<T*>( rings_.get() + offset ); // NOLINT(*-reinterpret-cast)
+  }
+};
@@ -13,19 +13,34 @@ struct IPv4Datagram
   IPv4Header header {};
   std::vector<Buffer> payload {};
 
+  // The payload's TCP checksum is already known to be right (checked by the NIC, or from the sum
+  // the driver took while copying the frame in); TCPSegment::parse() then skips summing it
+  bool payload_checksum_verified {};
+
   void parse( Parser& parser )
   {
     header.parse( parser );
+    payload_checksum_verified = false;
     parser.all_remaining( payload );
   }
 
-  void serialize( Serializer& serializer ) const
+  void serialize( Serializer& serializer ) const&
   {
     header.serialize( serializer );
     for ( const auto& x : payload ) {
       serializer.buffer( x );
     }
   }
+
+  // Hands the payload Buffers to the serializer instead of sharing them
+  void serialize( Serializer& serializer ) &&
+  {
+    header.serialize( serializer );
+    for ( auto& x : payload ) {
+      serializer.buffer( std::move( x ) );
+    }
+    payload.clear();
+  }
 };
 
 using InternetDatagram = IPv4Datagram;
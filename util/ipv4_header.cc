@@ -1,35 +1,61 @@
 #include "ipv4_header.hh"
 #include "checksum.hh"
+#include "header_codec.hh"
 
 #include <arpa/inet.h>
 #include <array>
 #include <cstddef>
+#include <span>
 #include <sstream>
 
 using namespace std;
 
+namespace {
+uint8_t version_and_length( const IPv4Header& header )
+{
+  return static_cast<uint8_t>( ( static_cast<uint32_t>( header.ver ) << 4 ) | ( header.hlen & 0xfU ) );
+}
+
+void set_version_and_length( IPv4Header& header, uint8_t first_byte )
+{
+  header.ver = first_byte >> 4;    // version
+  header.hlen = first_byte & 0x0f; // header length
+}
+
+uint16_t flags_and_offset( const IPv4Header& header )
+{
+  return ( header.df ? 0x4000U : 0 ) | ( header.mf ? 0x2000U : 0 ) | ( header.offset & 0x1fffU );
+}
+
+void set_flags_and_offset( IPv4Header& header, uint16_t fo_val )
+{
+  header.df = static_cast<bool>( fo_val & 0x4000 ); // don't fragment
+  header.mf = static_cast<bool>( fo_val & 0x2000 ); // more fragments
+  header.offset = fo_val & 0x1fff;                  // offset
+}
+
+using Layout = FixedLayout<IPv4Header,
+                           Packed<IPv4Header, uint8_t, version_and_length, set_version_and_length>,
+                           Field<&IPv4Header::tos>,
+                           Field<&IPv4Header::len>,
+                           Field<&IPv4Header::id>,
+                           Packed<IPv4Header, uint16_t, flags_and_offset, set_flags_and_offset>,
+                           Field<&IPv4Header::ttl>,
+                           Field<&IPv4Header::proto>,
+                           Field<&IPv4Header::cksum>,
+                           Field<&IPv4Header::src>,
+                           Field<&IPv4Header::dst>>;
+static_assert( Layout::LENGTH == IPv4Header::LENGTH );
+} // namespace
+
 // Parse from string.
 void IPv4Header::parse( Parser& parser )
 {
-  uint8_t first_byte {};
-  parser.integer( first_byte );
-  ver = first_byte >> 4;    // version
-  hlen = first_byte & 0x0f; // header length
-  parser.integer( tos );    // type of service
-  parser.integer( len );
-  parser.integer( id );
-
-  uint16_t fo_val {};
-  parser.integer( fo_val );
-  df = static_cast<bool>( fo_val & 0x4000 ); // don't fragment
-  mf = static_cast<bool>( fo_val & 0x2000 ); // more fragments
-  offset = fo_val & 0x1fff;                  // offset
-
-  parser.integer( ttl );
-  parser.integer( proto );
-  parser.integer( cksum );
-  parser.integer( src );
-  parser.integer( dst );
+  array<char, LENGTH> copy {};
+  const char* wire = Layout::parse( *this, parser, copy );
+  if ( parser.has_error() ) {
+    return;
+  }
 
   if ( ver != 4 ) {
     parser.set_error();
@@ -37,15 +63,26 @@ void IPv4Header::parse( Parser& parser )
 
   if ( hlen < 5 ) {
     parser.set_error();
+    return;
   }
 
-  parser.remove_prefix( static_cast<uint64_t>( hlen ) * 4 - IPv4Header::LENGTH );
+  const uint64_t options_length = static_cast<uint64_t>( hlen ) * 4 - IPv4Header::LENGTH;
+  if ( parser.checksum_verified() ) {
+    parser.remove_prefix( options_length );
+    return;
+  }
 
   // Verify checksum
-  const uint16_t given_cksum = cksum;
-  compute_checksum();
-  if ( cksum != given_cksum ) {
-    parser.set_error();
+  // 直接对收到的字节（连同选项和校验和字段）求和，结果应为 0，不用再把头部编码一遍
+  InternetChecksum check;
+  check.add( string_view { wire, LENGTH } );
+  if ( options_length > 0 ) {
+    array<char, 40> options {};
+    parser.string( span { options.data(), options_length } );
+    check.add( string_view { options.data(), options_length } );
+  }
+  if ( check.value() != 0 ) {
+    parser.set_checksum_error();
   }
 }
 
@@ -57,22 +94,7 @@ void IPv4Header::serialize( Serializer& serializer ) const
     throw runtime_error( "wrong IP version" );
   }
 
-  const uint8_t first_byte = ( static_cast<uint32_t>( ver ) << 4 ) | ( hlen & 0xfU );
-  serializer.integer( first_byte ); // version and header length
-  serializer.integer( tos );
-  serializer.integer( len );
-  serializer.integer( id );
-
-  const uint16_t fo_val = ( df ? 0x4000U : 0 ) | ( mf ? 0x2000U : 0 ) | ( offset & 0x1fffU );
-  serializer.integer( fo_val );
-
-  serializer.integer( ttl );
-  serializer.integer( proto );
-
-  serializer.integer( cksum );
-
-  serializer.integer( src );
-  serializer.integer( dst );
+  Layout::serialize( *this, serializer );
 }
 
 uint16_t IPv4Header::payload_length() const
@@ -103,15 +125,37 @@ uint32_t IPv4Header::pseudo_checksum() const
 void IPv4Header::compute_checksum()
 {
   cksum = 0;
-  Serializer s;
-  serialize( s );
+  array<char, LENGTH> bytes {};
+  Layout::encode( *this, bytes.data() );
 
   // calculate checksum -- taken over header only
   InternetChecksum check;
-  check.add( s.output() );
+  check.add( string_view { bytes.data(), bytes.size() } );
   cksum = check.value();
 }
 
+//! \details RFC 1624 eqn. 3: HC' = ~(~HC + ~m + m'), where m is the 16-bit word holding TTL and protocol.
+//! Neither side of the header sum can be zero, so the result matches the full recomputation bit for bit.
+void IPv4Header::decrement_ttl()
+{
+  const uint16_t old_word = static_cast<uint16_t>( ttl << 8 | proto );
+  --ttl;
+  const uint16_t new_word = static_cast<uint16_t>( ttl << 8 | proto );
+  cksum = InternetChecksum::update( cksum, old_word, new_word );
+}
+
+void IPv4Header::set_src( uint32_t address )
+{
+  cksum = InternetChecksum::update32( cksum, src, address );
+  src = address;
+}
+
+void IPv4Header::set_dst( uint32_t address )
+{
+  cksum = InternetChecksum::update32( cksum, dst, address );
+  dst = address;
+}
+
 std::string IPv4Header::to_string() const
 {
   stringstream ss {};
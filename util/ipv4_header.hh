@@ -57,9 +57,19 @@ struct IPv4Header
   // Set checksum to correct value
   void compute_checksum();
 
+  // Decrement the TTL and patch the checksum to match (RFC 1624), without re-summing the header.
+  // Gives the same checksum compute_checksum() would.
+  void decrement_ttl();
+
+  // Rewrite the source or destination address (e.g. for NAT), patching the checksum the same way
+  void set_src( uint32_t address );
+  void set_dst( uint32_t address );
+
   // Return a string containing a header in human-readable format
   std::string to_string() const;
 
+  // Checks the checksum over the received bytes (options included), unless the parser says the
+  // input was already verified
   void parse( Parser& parser );
   void serialize( Serializer& serializer ) const;
 };
@@ -0,0 +1,59 @@
+#include "log.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+LogLevel initial_level()
+{
+  const char* name = getenv( "MINNOW_LOG_LEVEL" ); // NOLINT(*-mt-unsafe)
+  if ( name == nullptr ) {
+    return LogLevel::Warning;
+  }
+  const string_view level { name };
+  if ( level == "debug" ) {
+    return LogLevel::Debug;
+  }
+  if ( level == "info" ) {
+    return LogLevel::Info;
+  }
+  if ( level == "error" ) {
+    return LogLevel::Error;
+  }
+  if ( level == "none" ) {
+    return LogLevel::None;
+  }
+  return LogLevel::Warning;
+}
+
+string_view prefix( LogLevel level )
+{
+  switch ( level ) {
+    case LogLevel::Debug:
+      return "DEBUG: ";
+    case LogLevel::Info:
+      return "INFO: ";
+    case LogLevel::Warning:
+      return "WARNING: ";
+    case LogLevel::Error:
+      return "ERROR: ";
+    case LogLevel::None:
+      break;
+  }
+  return "";
+}
+} // namespace
+
+atomic<LogLevel> Log::level_ { initial_level() };
+
+void Log::write( LogLevel level, string_view message )
+{
+  // 拼成一次写入，多个线程同时写也不会交错
+  string line { prefix( level ) };
+  line += message;
+  line += '\n';
+  cerr << line << flush;
+}
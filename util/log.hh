@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <sstream>
+#include <string_view>
+
+// Leveled logging to stderr.
+//
+// log<LogLevel::Debug>( [&]( std::ostream& out ) { out << "route added: " << ...; } )
+//
+// The lambda builds the message, so a message whose level is disabled costs one relaxed load and a
+// compare; nothing is formatted. Levels below MINNOW_LOG_MIN_LEVEL (set at build time, see
+// etc/cflags.cmake) are compiled out entirely. The runtime level starts at Warning, or at the
+// level named by the MINNOW_LOG_LEVEL environment variable (debug, info, warning, error or none).
+enum class LogLevel : uint8_t
+{
+  Debug,
+  Info,
+  Warning,
+  Error,
+  None
+};
+
+#ifndef MINNOW_LOG_MIN_LEVEL
+#define MINNOW_LOG_MIN_LEVEL 0
+#endif
+
+class Log
+{
+public:
+  static constexpr LogLevel COMPILED_MIN_LEVEL = static_cast<LogLevel>( MINNOW_LOG_MIN_LEVEL );
+
+  static LogLevel level() { return level_.load( std::memory_order_relaxed ); }
+  static void set_level( LogLevel level ) { level_.store( level, std::memory_order_relaxed ); }
+
+  static bool enabled( LogLevel level ) { return level >= COMPILED_MIN_LEVEL && level >= Log::level(); }
+
+  // Write one line (the prefix for `level`, then `message`) to stderr
+  static void write( LogLevel level, std::string_view message );
+
+private:
+  static std::atomic<LogLevel> level_;
+};
+
+template<LogLevel level, class Format>
+void log( Format&& format )
+{
+  if constexpr ( level >= Log::COMPILED_MIN_LEVEL ) {
+    if ( level >= Log::level() ) {
+      std::ostringstream message;
+      format( message );
+      Log::write( level, message.view() );
+    }
+  }
+}
@@ -0,0 +1,49 @@
+#include "mapped_file.hh"
+
+#include "exception.hh"
+
+#include <fcntl.h>
+#include <memory>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+// 最后一个共享映射的 Buffer 释放时解除映射
+struct Mapping
+{
+  void* base;
+  size_t length;
+
+  Mapping( void* b, size_t l ) : base( b ), length( l ) {}
+  Mapping( const Mapping& ) = delete;
+  Mapping& operator=( const Mapping& ) = delete;
+  ~Mapping() { ::munmap( base, length ); }
+};
+} // namespace
+
+MappedFile::MappedFile( const FileDescriptor& fd )
+{
+  struct stat st {};
+  CheckSystemCall( "fstat", ::fstat( fd.fd_num(), &st ) );
+  const auto length = static_cast<size_t>( st.st_size );
+  if ( length == 0 ) {
+    return; // 长度为 0 的映射 mmap 不接受
+  }
+  void* base = ::mmap( nullptr, length, PROT_READ, MAP_PRIVATE, fd.fd_num(), 0 );
+  if ( base == MAP_FAILED ) {
+    throw unix_error( "mmap" );
+  }
+  auto mapping = make_shared<const Mapping>( base, length );
+  // 一般是从头读到尾：让内核多预读
+  ::madvise( base, length, MADV_SEQUENTIAL );
+  bytes_ = Buffer::external( { static_cast<const char*>( base ), length }, std::move( mapping ) );
+}
+
+MappedFile MappedFile::open( const string& path )
+{
+  const FileDescriptor fd { CheckSystemCall( "open", ::open( path.c_str(), O_RDONLY | O_CLOEXEC ) ) }; // NOLINT(*-vararg)
+  return MappedFile { fd };
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "buffer.hh"
+#include "file_descriptor.hh"
+
+#include <cstddef>
+#include <string>
+
+// A file mapped read-only into memory, handed out as Buffers that share the mapping. Pushed into
+// a ByteStream (Queue backend) and read by a TCPSender, its bytes reach the segments' payloads
+// without being copied, and Reader::peek() returns views straight into the mapping. The mapping
+// stays until the MappedFile and every Buffer sharing it are gone.
+//
+// The file is mapped at its size when constructed; it should not shrink while mapped (reading a
+// page past the new end raises SIGBUS).
+class MappedFile
+{
+public:
+  explicit MappedFile( const FileDescriptor& fd );
+
+  // Open `path` read-only and map it
+  static MappedFile open( const std::string& path );
+
+  size_t size() const { return bytes_.size(); }
+  bool empty() const { return bytes_.empty(); }
+
+  // The whole file, or bytes [pos, pos + len) of it. Nothing is copied.
+  Buffer buffer() const { return bytes_; }
+  Buffer substr( size_t pos, size_t len = std::string::npos ) const { return bytes_.substr( pos, len ); }
+
+private:
+  Buffer bytes_ {};
+};
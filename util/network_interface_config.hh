@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+//! Config for NetworkInterface: ARP timing, the datagrams held while waiting for ARP, the size of
+//! the neighbour cache, IP fragmentation and reassembly, and the egress queues. The defaults are the
+//! classic behaviour (30 s mappings, one ARP request per 5 s, no automatic retries, no fragmenting
+//! or reassembly, one unlimited FIFO for outgoing frames).
+class NetworkInterfaceConfig
+{
+public:
+  static constexpr uint64_t MAPPING_TTL_DFLT = 30000;          //!< A learned mapping expires after 30 s
+  static constexpr uint64_t REQUEST_RETRY_DFLT = 5000;         //!< Wait 5 s for an ARP reply before retrying
+  static constexpr size_t PENDING_NEIGHBOUR_DFLT = 64 * 1024;  //!< Bytes queued for one next hop
+  static constexpr size_t PENDING_TOTAL_DFLT = 1024 * 1024;    //!< Bytes queued for all next hops together
+  static constexpr uint64_t REASSEMBLY_TIMEOUT_DFLT = 30000;   //!< A datagram's fragments are kept for 30 s
+  static constexpr size_t REASSEMBLY_TOTAL_DFLT = 1024 * 1024; //!< Bytes of fragments held for all datagrams
+  static constexpr size_t EGRESS_QUEUES_DFLT = 4;              //!< Traffic classes (by IP precedence)
+  static constexpr size_t EGRESS_QUANTUM_DFLT = 1514;          //!< DRR bytes per turn: one full frame
+  static constexpr uint64_t CODEL_TARGET_DFLT = 5;             //!< RFC 8289's suggested target
+  static constexpr uint64_t CODEL_INTERVAL_DFLT = 100;         //!< RFC 8289's suggested interval
+
+  //! How frames waiting to be sent are ordered (see EgressScheduler)
+  enum class EgressDiscipline : uint8_t
+  {
+    Fifo,              //!< One queue, in the order the frames were made
+    Priority,          //!< One queue per class by TOS; a class goes only when all higher ones are empty
+    DeficitRoundRobin, //!< One queue per class by TOS; busy classes share the link equally
+  };
+
+  uint64_t mapping_ttl_ms = MAPPING_TTL_DFLT;     //!< How long a learned Ethernet address is used
+  uint64_t request_retry_ms = REQUEST_RETRY_DFLT; //!< How long an ARP request is given before the next one
+
+  //! ARP requests re-sent automatically (while datagrams are waiting) before giving up on a next hop.
+  //! With none, queued datagrams are dropped when the first request goes unanswered, and the next
+  //! datagram starts over with a new request.
+  unsigned request_retries = 0;
+  unsigned request_backoff = 2; //!< Each retry waits this many times longer than the one before
+
+  //! Re-check a mapping that is in use with a unicast ARP request request_retry_ms before it expires,
+  //! so it is renewed without ever becoming unusable (see NetworkInterface)
+  bool proactive_refresh = false;
+
+  //! A datagram that would take a neighbour's queue, or all queues together, past its limit is
+  //! dropped; the datagrams already queued keep their place.
+  size_t pending_bytes_per_neighbour = PENDING_NEIGHBOUR_DFLT;
+  size_t pending_bytes_total = PENDING_TOTAL_DFLT;
+
+  //! Most next hops the neighbour cache tracks at once (mappings, requests and queues). When it is
+  //! full, datagrams for a new next hop are dropped and unsolicited ARP from new hosts is not learned.
+  size_t neighbour_capacity = SIZE_MAX;
+
+  //! Largest datagram sent in one frame (e.g. 1500, or 9000 with jumbo frames). Larger datagrams are
+  //! split into fragments, or dropped if they have DF set. The default never fragments.
+  size_t mtu = SIZE_MAX;
+
+  //! Put received fragments back together before returning the datagram (for an interface that is
+  //! the datagrams' destination; a router forwards fragments as they are). Each datagram gets
+  //! reassembly_timeout_ms from its first fragment to arrive, and fragments that would take it, or
+  //! all datagrams together, past the byte limits are dropped.
+  bool reassemble_fragments = false;
+  uint64_t reassembly_timeout_ms = REASSEMBLY_TIMEOUT_DFLT;
+  size_t reassembly_bytes_per_datagram = UINT16_MAX;
+  size_t reassembly_bytes_total = REASSEMBLY_TOTAL_DFLT;
+
+  //! The egress scheduler, and how many classes it sorts IPv4 frames into (Priority and
+  //! DeficitRoundRobin) by the precedence bits of the TOS byte; ARP goes in the highest class.
+  EgressDiscipline egress = EgressDiscipline::Fifo;
+  size_t egress_queues = EGRESS_QUEUES_DFLT;
+  size_t egress_quantum = EGRESS_QUANTUM_DFLT;
+
+  //! Bytes each queue holds; a frame that would take its queue past this is dropped
+  size_t egress_queue_bytes = SIZE_MAX;
+
+  //! CoDel on every queue: once frames have waited longer than codel_target_ms for a whole
+  //! codel_interval_ms, frames are dropped at the head until the delay is back under the target.
+  //! 0 turns it off. Time is the interface's clock, so it moves only with tick().
+  uint64_t codel_target_ms = 0;
+  uint64_t codel_interval_ms = CODEL_INTERVAL_DFLT;
+};
@@ -0,0 +1,234 @@
+#include "packet_arena.hh"
+
+#include "exception.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+constexpr size_t PAGE = 4096;
+constexpr size_t PAGE_2M = size_t { 1 } << 21;
+constexpr size_t PAGE_1G = size_t { 1 } << 30;
+
+size_t round_up( size_t n, size_t unit )
+{
+  return ( n + unit - 1 ) / unit * unit;
+}
+
+size_t page_size( PacketArena::Pages pages )
+{
+  switch ( pages ) {
+    case PacketArena::Pages::Huge1G:
+      return PAGE_1G;
+    case PacketArena::Pages::Huge2M:
+    case PacketArena::Pages::Transparent:
+      return PAGE_2M;
+    default:
+      return PAGE;
+  }
+}
+
+// "0-1,4" 这样的节点列表（/sys/devices/system/node/online 的格式）
+vector<unsigned> parse_node_list( const string& list )
+{
+  vector<unsigned> nodes;
+  size_t pos = 0;
+  while ( pos < list.size() ) {
+    size_t end = list.find( ',', pos );
+    if ( end == string::npos ) {
+      end = list.size();
+    }
+    const string range = list.substr( pos, end - pos );
+    const size_t dash = range.find( '-' );
+    const unsigned first = stoul( range.substr( 0, dash ) );
+    const unsigned last = dash == string::npos ? first : stoul( range.substr( dash + 1 ) );
+    for ( unsigned node = first; node <= last; ++node ) {
+      nodes.push_back( node );
+    }
+    pos = end + 1;
+  }
+  return nodes;
+}
+
+vector<unsigned> online_nodes()
+{
+  ifstream file { "/sys/devices/system/node/online" };
+  string list;
+  if ( file >> list ) {
+    try {
+      return parse_node_list( list );
+    } catch ( const exception& ) { // NOLINT(*-empty-catch)
+      // 看不懂就当只有一个节点
+    }
+  }
+  return { 0 };
+}
+
+// 匿名映射，起始地址按 `align` 对齐（透明大页要求 2 MiB 对齐）。失败返回 nullptr。
+char* map_aligned( size_t length, size_t align, int flags )
+{
+  const size_t extra = align > PAGE and not( flags & MAP_HUGETLB ) ? align : 0;
+  void* base = ::mmap( nullptr, length + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0 );
+  if ( base == MAP_FAILED ) { // NOLINT(*-cstyle-cast)
+    return nullptr;
+  }
+  auto* start = static_cast<char*>( base );
+  if ( extra > 0 ) {
+    auto* aligned = reinterpret_cast<char*>( round_up( reinterpret_cast<uintptr_t>( start ), align ) ); // NOLINT
+    if ( aligned > start ) {
+      ::munmap( start, aligned - start );
+    }
+    ::munmap( aligned + length, start + extra - aligned );
+    start = aligned;
+  }
+  return start;
+}
+} // namespace
+
+PacketArena::PacketArena( const Config& config )
+  : slab_size_( round_up( max<size_t>( config.slab_size, 1 ), 64 ) )
+  , nodes_( config.nodes.empty() ? online_nodes() : config.nodes )
+  , chunks_( nodes_.size() )
+{
+  if ( config.slabs_per_node == 0 ) {
+    throw runtime_error( "PacketArena: no slabs" );
+  }
+
+  // 从要求的页大小往下试：hugetlbfs 没预留页时 MAP_HUGETLB 直接失败
+  for ( auto pages = config.pages;; pages = static_cast<Pages>( static_cast<int>( pages ) - 1 ) ) {
+    chunk_length_ = round_up( slab_size_ * config.slabs_per_node, page_size( pages ) );
+    length_ = chunk_length_ * nodes_.size();
+    int flags = 0;
+    if ( pages == Pages::Huge1G ) {
+      flags = MAP_HUGETLB | ( 30 << MAP_HUGE_SHIFT );
+    } else if ( pages == Pages::Huge2M ) {
+      flags = MAP_HUGETLB | ( 21 << MAP_HUGE_SHIFT );
+    }
+    base_ = map_aligned( length_, page_size( pages ), flags );
+    if ( base_ and pages == Pages::Transparent and ::madvise( base_, length_, MADV_HUGEPAGE ) != 0 ) {
+      ::munmap( base_, length_ );
+      base_ = nullptr;
+    }
+    if ( base_ ) {
+      pages_ = pages;
+      break;
+    }
+    if ( pages == Pages::Normal ) {
+      throw unix_error( "mmap PacketArena" );
+    }
+  }
+
+  for ( size_t i = 0; i < chunks_.size(); ++i ) {
+    Chunk& chunk = chunks_[i];
+    chunk.node = nodes_[i];
+    char* start = base_ + i * chunk_length_;
+
+    // 先绑定节点再碰页面：页在第一次写的时候才分配，分配在哪个节点由绑定决定。
+    // 只有一个节点时不必绑定；内核不支持 NUMA 时 mbind 失败，也就不绑定。
+    if ( nodes_.size() > 1 ) {
+      vector<unsigned long> mask( chunk.node / ( 8 * sizeof( unsigned long ) ) + 1 );
+      mask.back() |= 1UL << ( chunk.node % ( 8 * sizeof( unsigned long ) ) );
+      ::syscall( SYS_mbind, start, chunk_length_, MPOL_PREFERRED, mask.data(),
+                 mask.size() * 8 * sizeof( unsigned long ) + 1,
+                 0 );
+    }
+    // 收包路径上不要缺页
+    for ( size_t offset = 0; offset < chunk_length_; offset += PAGE ) {
+      start[offset] = 0;
+    }
+
+    const size_t slabs = chunk_length_ / slab_size_;
+    chunk.free.reserve( slabs );
+    for ( size_t j = slabs; j-- > 0; ) {
+      chunk.free.push_back( start + j * slab_size_ );
+    }
+  }
+}
+
+PacketArena::~PacketArena()
+{
+  ::munmap( base_, length_ );
+}
+
+PacketArena::Slab PacketArena::take()
+{
+  return take( current_node() );
+}
+
+PacketArena::Slab PacketArena::take( unsigned node )
+{
+  const auto home = find( nodes_.begin(), nodes_.end(), node );
+  const size_t first = home == nodes_.end() ? 0 : home - nodes_.begin();
+  for ( size_t k = 0; k < chunks_.size(); ++k ) {
+    Chunk& chunk = chunks_[( first + k ) % chunks_.size()];
+    const lock_guard lock { chunk.mutex };
+    if ( not chunk.free.empty() ) {
+      if ( k > 0 ) {
+        remote_takes_.fetch_add( 1, memory_order_relaxed );
+      }
+      char* slab = chunk.free.back();
+      chunk.free.pop_back();
+      return Slab { slab, Give { this } };
+    }
+  }
+  return Slab { nullptr, Give { this } };
+}
+
+Buffer PacketArena::wrap( Slab&& slab, size_t size )
+{
+  if ( not slab ) {
+    throw runtime_error( "PacketArena::wrap: no slab" );
+  }
+  Buffer out;
+  out.storage_ = Buffer::acquire( {} );
+  out.storage_->external = { slab.release(), min( size, slab_size_ ) };
+  out.storage_->arena = this;
+  return out;
+}
+
+void PacketArena::give( char* slab )
+{
+  Chunk& chunk = chunks_.at( chunk_of( slab ) );
+  const lock_guard lock { chunk.mutex };
+  chunk.free.push_back( slab );
+}
+
+size_t PacketArena::available( unsigned node ) const
+{
+  size_t total = 0;
+  for ( const auto& chunk : chunks_ ) {
+    if ( chunk.node == node ) {
+      const lock_guard lock { chunk.mutex };
+      total += chunk.free.size();
+    }
+  }
+  return total;
+}
+
+unsigned PacketArena::current_node()
+{
+  unsigned cpu = 0;
+  unsigned node = 0;
+  if ( ::syscall( SYS_getcpu, &cpu, &node, nullptr ) != 0 ) {
+    return 0;
+  }
+  return node;
+}
+
+optional<unsigned> PacketArena::node_of_interface( const string& ifname )
+{
+  ifstream file { "/sys/class/net/" + ifname + "/device/numa_node" };
+  int node = -1;
+  if ( not( file >> node ) or node < 0 ) {
+    return {};
+  }
+  return static_cast<unsigned>( node );
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "buffer.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Fixed-size packet slabs carved out of one large mapping, for receive paths that fill a buffer
+// in place (recvmmsg(), a PACKET_MMAP ring copy) and then hand it on as a Buffer.
+//
+// The mapping is backed by huge pages when the system has them (1 GiB or 2 MiB pages reserved
+// through hugetlbfs, otherwise transparent huge pages), so a burst of packets touches a handful
+// of TLB entries instead of one per 4 KiB page. It is split into one chunk per NUMA node, each
+// bound to its node before first touch, and each chunk keeps its own free list: take() hands out
+// a slab from the caller's node (or the node of the network interface the caller names), and a
+// slab always returns to the node it came from, whichever thread releases it.
+//
+// Slabs come out as a Slab (an owning pointer that gives the slab back when dropped) and turn into
+// a Buffer with wrap(); the slab returns to the arena when the last Buffer sharing it is gone.
+// The arena must outlive every Slab and Buffer it has handed out.
+class PacketArena
+{
+public:
+  enum class Pages
+  {
+    Normal,      // 4 KiB pages
+    Transparent, // normal mapping, with madvise(MADV_HUGEPAGE)
+    Huge2M,      // MAP_HUGETLB, 2 MiB pages
+    Huge1G,      // MAP_HUGETLB, 1 GiB pages
+  };
+
+  struct Config
+  {
+    size_t slab_size = Buffer::FRAME_SLAB;
+    size_t slabs_per_node = 4096;
+    Pages pages = Pages::Huge2M;   // the largest page size to try; smaller ones are the fallback
+    std::vector<unsigned> nodes {}; // empty: every online node
+  };
+
+  // Gives a slab back to its arena
+  struct Give
+  {
+    PacketArena* arena;
+    void operator()( char* slab ) const { arena->give( slab ); }
+  };
+  using Slab = std::unique_ptr<char, Give>;
+
+  PacketArena() : PacketArena( Config {} ) {}
+  explicit PacketArena( const Config& config );
+  ~PacketArena();
+
+  // Buffers and Slabs point at the arena
+  PacketArena( const PacketArena& ) = delete;
+  PacketArena& operator=( const PacketArena& ) = delete;
+
+  // A free slab from `node` (default: the calling thread's node), or from another node if that one
+  // has none left (counted in remote_takes()). An empty Slab if the whole arena is in use.
+  Slab take();
+  Slab take( unsigned node );
+
+  // A Buffer over the first `size` bytes of `slab`. Nothing is copied.
+  Buffer wrap( Slab&& slab, size_t size );
+
+  size_t slab_size() const { return slab_size_; }
+  Pages pages() const { return pages_; } // the pages the mapping actually got
+  const std::vector<unsigned>& nodes() const { return nodes_; }
+  size_t available( unsigned node ) const;
+  size_t remote_takes() const { return remote_takes_.load( std::memory_order_relaxed ); }
+
+  // Whether `p` points into the arena, and the node of the slab it points into
+  bool contains( const char* p ) const { return p >= base_ and p < base_ + length_; }
+  unsigned node_of( const char* p ) const { return chunks_.at( chunk_of( p ) ).node; }
+
+  // The NUMA node of the calling thread's CPU, and of network interface `ifname` (none if the
+  // kernel doesn't say, as for virtual interfaces)
+  static unsigned current_node();
+  static std::optional<unsigned> node_of_interface( const std::string& ifname );
+
+private:
+  struct Chunk
+  {
+    unsigned node {};
+    mutable std::mutex mutex {};
+    std::vector<char*> free {};
+  };
+
+  friend class Buffer; // 最后一个 Buffer 释放时还槽
+  void give( char* slab );
+  size_t chunk_of( const char* p ) const { return static_cast<size_t>( p - base_ ) / chunk_length_; }
+
+  size_t slab_size_;
+  Pages pages_ { Pages::Normal };
+  std::vector<unsigned> nodes_;
+  char* base_ {};
+  size_t length_ {};
+  size_t chunk_length_ {};
+  std::vector<Chunk> chunks_;
+  std::atomic<size_t> remote_takes_ {};
+};
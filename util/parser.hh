@@ -1,33 +1,73 @@
 #pragma once
 
 #include "buffer.hh"
+#include "profile.hh"
 
 #include <algorithm>
+#include <bit>
 #include <concepts>
 #include <cstdint>
 #include <cstring>
-#include <deque>
 #include <numeric>
 #include <span>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <type_traits>
 #include <vector>
 
 class Serializer;
 
+// Load a big-endian integer from `sizeof( T )` bytes that need not be aligned
+template<std::unsigned_integral T>
+T load_big_endian( const char* bytes )
+{
+  T out {};
+  std::memcpy( &out, bytes, sizeof( T ) );
+  if constexpr ( sizeof( T ) == 1 or std::endian::native == std::endian::big ) {
+    return out;
+  } else if constexpr ( sizeof( T ) == 2 ) {
+    return __builtin_bswap16( out );
+  } else if constexpr ( sizeof( T ) == 4 ) {
+    return __builtin_bswap32( out );
+  } else {
+    static_assert( sizeof( T ) == 8 );
+    return __builtin_bswap64( out );
+  }
+}
+
+// Store `val` big-endian into `sizeof( T )` bytes that need not be aligned
+template<std::unsigned_integral T>
+void store_big_endian( char* bytes, T val )
+{
+  if constexpr ( sizeof( T ) > 1 and std::endian::native == std::endian::little ) {
+    val = load_big_endian<T>( reinterpret_cast<const char*>( &val ) ); // NOLINT(*-reinterpret-cast)
+  }
+  std::memcpy( bytes, &val, sizeof( T ) );
+}
+
 class Parser
 {
   class BufferList
   {
     uint64_t size_ {};
-    std::deque<Buffer> buffer_ {};
-    uint64_t skip_ {};
+    std::vector<Buffer> buffer_ {}; // buffers [head_, end) are still unread
+    size_t head_ {};
+    uint64_t skip_ {};              // bytes already read from buffer_[head_]
+    std::string_view front_ {};     // the unread part of buffer_[head_]
+
+    void pop_front()
+    {
+      ++head_;
+      skip_ = 0;
+      front_ = head_ < buffer_.size() ? std::string_view { buffer_[head_] } : std::string_view {};
+    }
 
   public:
     // NOLINTNEXTLINE(*-explicit-*)
     BufferList( const std::vector<Buffer>& buffers )
     {
+      buffer_.reserve( buffers.size() );
       for ( const auto& x : buffers ) {
         append( x );
       }
@@ -39,22 +79,37 @@ class Parser
 
     std::string_view peek() const
     {
-      if ( buffer_.empty() ) {
+      if ( head_ == buffer_.size() ) {
         throw std::runtime_error( "peek on empty BufferList" );
       }
-      return std::string_view { buffer_.front() }.substr( skip_ );
+      return front_;
+    }
+
+    // Fill `out` with views that together cover every remaining byte, in order
+    void peek_all( std::vector<std::string_view>& out ) const
+    {
+      for ( size_t i = head_; i < buffer_.size(); ++i ) {
+        out.push_back( i == head_ ? front_ : std::string_view { buffer_[i] } );
+      }
     }
 
     void remove_prefix( uint64_t len )
     {
-      while ( len and not buffer_.empty() ) {
-        const uint64_t to_pop_now = std::min( len, peek().size() );
+      // 常见情况：还在当前这块里
+      if ( len < front_.size() ) {
+        front_.remove_prefix( len );
+        skip_ += len;
+        size_ -= len;
+        return;
+      }
+      while ( len and head_ < buffer_.size() ) {
+        const uint64_t to_pop_now = std::min<uint64_t>( len, front_.size() );
+        front_.remove_prefix( to_pop_now );
         skip_ += to_pop_now;
         len -= to_pop_now;
         size_ -= to_pop_now;
-        if ( skip_ == buffer_.front().size() ) {
-          buffer_.pop_front();
-          skip_ = 0;
+        if ( front_.empty() ) {
+          pop_front();
         }
       }
     }
@@ -65,41 +120,83 @@ class Parser
       if ( empty() ) {
         return;
       }
-      std::string first_str = std::move( buffer_.front() );
-      if ( skip_ ) {
-        first_str = first_str.substr( skip_ );
-      }
-      out.emplace_back( std::move( first_str ) );
-      buffer_.pop_front();
-      for ( auto&& x : buffer_ ) {
-        out.emplace_back( std::move( x ) );
+      out.reserve( buffer_.size() - head_ );
+      // 读过一部分的那块切片交出去，和原来的 Buffer 共享存储
+      out.emplace_back( skip_ ? buffer_[head_].substr( skip_ ) : std::move( buffer_[head_] ) );
+      for ( size_t i = head_ + 1; i < buffer_.size(); ++i ) {
+        out.emplace_back( std::move( buffer_[i] ) );
       }
+      clear();
     }
 
+    // Everything remaining as one Buffer: a slice if it is all in one buffer already, otherwise
+    // a single copy into a string of the right size
     void dump_all( Buffer& out )
     {
-      std::vector<Buffer> concat;
-      dump_all( concat );
-      if ( concat.size() == 1 ) {
-        out = concat.front();
-        return;
+      if ( empty() ) {
+        out = Buffer {};
+      } else if ( head_ + 1 == buffer_.size() ) {
+        out = skip_ ? buffer_[head_].substr( skip_ ) : std::move( buffer_[head_] );
+      } else {
+        std::string flat = Buffer::pooled_string( size_ );
+        flat.append( front_ );
+        for ( size_t i = head_ + 1; i < buffer_.size(); ++i ) {
+          flat.append( std::string_view { buffer_[i] } );
+        }
+        out = Buffer { std::move( flat ) };
       }
+      clear();
+    }
 
-      out.release().clear();
-      for ( const auto& s : concat ) {
-        out.release().append( s );
+    // The next `len` bytes (at most size()) as one Buffer, consumed: a slice if they are all in the
+    // current buffer, otherwise a copy
+    Buffer take( uint64_t len )
+    {
+      Buffer out;
+      if ( len == 0 ) {
+        return out;
+      }
+      if ( len <= front_.size() ) {
+        out = buffer_[head_].substr( skip_, len );
+      } else {
+        std::string flat = Buffer::pooled_string( len );
+        for ( size_t i = head_; flat.size() < len; ++i ) {
+          const std::string_view view = i == head_ ? front_ : std::string_view { buffer_[i] };
+          flat.append( view.substr( 0, len - flat.size() ) );
+        }
+        out = Buffer { std::move( flat ) };
       }
+      remove_prefix( len );
+      return out;
+    }
+
+    void clear()
+    {
+      buffer_.clear();
+      head_ = 0;
+      skip_ = 0;
+      size_ = 0;
+      front_ = {};
     }
 
     void append( Buffer str )
     {
+      // 空的 Buffer 不会被读到，不放进来，front_ 就总是非空的（除非全部读完）
+      if ( str.empty() ) {
+        return;
+      }
       size_ += str.size();
       buffer_.push_back( std::move( str ) );
+      if ( buffer_.size() == head_ + 1 ) {
+        front_ = buffer_.back();
+      }
     }
   };
 
   BufferList input_;
   bool error_ {};
+  bool checksum_error_ {};
+  bool checksum_verified_ {};
 
   void check_size( const size_t size )
   {
@@ -115,28 +212,60 @@ public:
 
   bool has_error() const { return error_; }
   void set_error() { error_ = true; }
+
+  // The first error was a failed checksum, not input that was truncated or malformed
+  bool checksum_error() const { return checksum_error_; }
+  void set_checksum_error()
+  {
+    checksum_error_ = not error_;
+    error_ = true;
+  }
   void remove_prefix( size_t n ) { input_.remove_prefix( n ); }
 
+  // The input's checksums were already verified (e.g. by a NIC with receive checksum offload),
+  // so headers that carry one need not check it again
+  bool checksum_verified() const { return checksum_verified_; }
+  void set_checksum_verified( bool verified = true ) { checksum_verified_ = verified; }
+
+  // The next `len` bytes, if there has been no error and they are all in the current Buffer
+  // (nothing is consumed); nullptr otherwise
+  const char* contiguous( size_t len ) const
+  {
+    if ( has_error() or input_.empty() ) {
+      return nullptr;
+    }
+    const auto view = input_.peek();
+    return view.size() >= len ? view.data() : nullptr;
+  }
+
   template<std::unsigned_integral T>
   void integer( T& out )
   {
-    check_size( sizeof( T ) );
     if ( has_error() ) {
       return;
     }
 
-    if constexpr ( sizeof( T ) == 1 ) {
-      out = static_cast<uint8_t>( input_.peek().front() );
-      input_.remove_prefix( 1 );
-      return;
-    } else {
-      out = static_cast<T>( 0 );
-      for ( size_t i = 0; i < sizeof( T ); i++ ) {
-        out <<= 8;
-        out |= static_cast<uint8_t>( input_.peek().front() );
-        input_.remove_prefix( 1 );
+    // 快速路径：整个字段都在当前这块里，检查一次边界，一次非对齐加载
+    if ( not input_.empty() ) {
+      const auto view = input_.peek();
+      if ( view.size() >= sizeof( T ) ) {
+        out = load_big_endian<T>( view.data() );
+        input_.remove_prefix( sizeof( T ) );
+        return;
       }
     }
+
+    // 字段跨过了 Buffer 的边界（或者输入不够长）
+    check_size( sizeof( T ) );
+    if ( has_error() ) {
+      return;
+    }
+    out = static_cast<T>( 0 );
+    for ( size_t i = 0; i < sizeof( T ); i++ ) {
+      out <<= 8;
+      out |= static_cast<uint8_t>( input_.peek().front() );
+      input_.remove_prefix( 1 );
+    }
   }
 
   void string( std::span<char> out )
@@ -154,6 +283,16 @@ public:
     }
   }
 
+  // The next `len` bytes as a Buffer sharing the input's storage (copied only if they span two buffers)
+  void buffer( uint64_t len, Buffer& out )
+  {
+    check_size( len );
+    if ( has_error() ) {
+      return;
+    }
+    out = input_.take( len );
+  }
+
   void all_remaining( std::vector<Buffer>& out ) { input_.dump_all( out ); }
   void all_remaining( Buffer& out ) { input_.dump_all( out ); }
 };
@@ -165,17 +304,38 @@ class Serializer
 
 public:
   Serializer() = default;
-  explicit Serializer( std::string&& buffer ) : buffer_( std::move( buffer ) ) {}
+
+  // Write into a caller-supplied string (e.g. one kept from an earlier Serializer, see reclaim()),
+  // reusing its capacity. Its current contents are discarded.
+  explicit Serializer( std::string&& buffer ) : buffer_( std::move( buffer ) ) { buffer_.clear(); }
+
+  // Make room for `len` more bytes of integers, so writing them does not reallocate. A fresh
+  // buffer comes from the Buffer pool.
+  void reserve( size_t len )
+  {
+    if ( buffer_.capacity() >= buffer_.size() + len ) {
+      return;
+    }
+    if ( buffer_.empty() ) {
+      buffer_ = Buffer::pooled_string( len );
+    } else {
+      buffer_.reserve( std::max( buffer_.size() + len, 2 * buffer_.capacity() ) );
+    }
+  }
 
   template<std::unsigned_integral T>
   void integer( const T& val )
   {
-    constexpr uint64_t len = sizeof( T );
+    store_big_endian( extend( sizeof( T ) ), val );
+  }
 
-    for ( uint64_t i = 0; i < len; ++i ) {
-      const uint8_t byte_val = val >> ( ( len - i - 1 ) * 8 );
-      buffer_.push_back( byte_val );
-    }
+  // Append `len` bytes for the caller to fill in; the pointer is good until the next write
+  char* extend( size_t len )
+  {
+    reserve( len );
+    const size_t at = buffer_.size();
+    buffer_.resize( at + len );
+    return buffer_.data() + at;
   }
 
   void buffer( const Buffer& buf )
@@ -184,6 +344,12 @@ public:
     output_.push_back( buf );
   }
 
+  void buffer( Buffer&& buf )
+  {
+    flush();
+    output_.push_back( std::move( buf ) );
+  }
+
   void buffer( const std::vector<Buffer>& bufs )
   {
     for ( const auto& b : bufs ) {
@@ -193,14 +359,32 @@ public:
 
   void flush()
   {
-    output_.emplace_back( std::move( buffer_ ) );
-    buffer_.clear();
+    // 没有待写的字节时不产生空 Buffer
+    if ( !buffer_.empty() ) {
+      output_.emplace_back( std::move( buffer_ ) );
+      buffer_.clear();
+    }
   }
 
+  // Everything serialized so far; leaves the Serializer empty
   std::vector<Buffer> output()
   {
     flush();
-    return output_;
+    auto out = std::move( output_ );
+    output_.clear();
+    return out;
+  }
+
+  // The bytes written since the last buffer() and not yet flushed, e.g. to checksum them in place
+  std::string_view pending() const { return buffer_; }
+
+  // Give the byte buffer back (emptied, capacity kept) so the caller can hand it to the next Serializer
+  std::string reclaim()
+  {
+    auto out = std::move( buffer_ );
+    out.clear();
+    buffer_.clear();
+    return out;
   }
 };
 
@@ -208,15 +392,28 @@ public:
 template<class T>
 std::vector<Buffer> serialize( const T& obj )
 {
+  const ProfileScope<Profile::SERIALIZE> profile;
   Serializer s;
   obj.serialize( s );
   return s.output();
 }
 
+// Same, for an object that is no longer needed: lets it move its Buffers out (see IPv4Datagram)
+template<class T>
+  requires( not std::is_lvalue_reference_v<T> )
+std::vector<Buffer> serialize( T&& obj )
+{
+  const ProfileScope<Profile::SERIALIZE> profile;
+  Serializer s;
+  std::move( obj ).serialize( s );
+  return s.output();
+}
+
 // Helper to parse any object (without constructing a Parser of the caller's own). Returns true if successful.
 template<class T>
 bool parse( T& obj, const std::vector<Buffer>& buffers )
 {
+  const ProfileScope<Profile::PARSE> profile;
   Parser p { buffers };
   obj.parse( p );
   return not p.has_error();
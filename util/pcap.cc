@@ -0,0 +1,426 @@
+#include "pcap.hh"
+
+#include "exception.hh"
+
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+constexpr uint32_t PCAP_MAGIC_NS = 0xa1b23c4d;
+constexpr uint32_t PCAP_MAGIC_US = 0xa1b2c3d4;
+constexpr size_t PCAP_FILE_HEADER = 24;
+constexpr size_t PCAP_RECORD_HEADER = 16;
+
+constexpr uint32_t NG_SECTION_HEADER = 0x0a0d0d0a;
+constexpr uint32_t NG_INTERFACE = 1;
+constexpr uint32_t NG_SIMPLE_PACKET = 3;
+constexpr uint32_t NG_ENHANCED_PACKET = 6;
+constexpr uint32_t NG_BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+constexpr uint16_t NG_OPT_END = 0;
+constexpr uint16_t NG_OPT_EPB_FLAGS = 2;
+constexpr uint16_t NG_OPT_IF_TSRESOL = 9;
+
+constexpr uint16_t LINKTYPE_ETHERNET = 1;
+
+// 记录按本机字节序写：pcap 的 magic 和 pcapng 的 byte-order magic 告诉读的一方是哪种
+template<class T>
+void put( string& out, T value )
+{
+  out.append( reinterpret_cast<const char*>( &value ), sizeof( T ) ); // NOLINT(*-reinterpret-cast)
+}
+
+void pad4( string& out )
+{
+  out.append( ( 4 - out.size() % 4 ) % 4, '\0' );
+}
+
+size_t round4( size_t n )
+{
+  return ( n + 3 ) & ~size_t { 3 };
+}
+
+uint64_t now_ns()
+{
+  return chrono::duration_cast<chrono::nanoseconds>( chrono::system_clock::now().time_since_epoch() ).count();
+}
+
+// 帧在线上的字节，最多 `snaplen` 个：以太网头加上 payload
+void append_frame( string& out, const EthernetFrame& frame, size_t snaplen )
+{
+  const size_t start = out.size();
+  if ( frame.serialized_header.has_value() ) {
+    out += string_view { *frame.serialized_header };
+  } else {
+    out.append( reinterpret_cast<const char*>( frame.header.dst.data() ), frame.header.dst.size() ); // NOLINT
+    out.append( reinterpret_cast<const char*>( frame.header.src.data() ), frame.header.src.size() ); // NOLINT
+    out.push_back( static_cast<char>( frame.header.type >> 8 ) );
+    out.push_back( static_cast<char>( frame.header.type ) );
+  }
+  out.resize( min( out.size(), start + snaplen ) );
+  for ( const auto& buffer : frame.payload ) {
+    const size_t room = start + snaplen - out.size();
+    if ( room == 0 ) {
+      break;
+    }
+    out += string_view { buffer }.substr( 0, room );
+  }
+}
+
+size_t frame_length( const EthernetFrame& frame )
+{
+  size_t len = EthernetHeader::LENGTH;
+  for ( const auto& buffer : frame.payload ) {
+    len += buffer.size();
+  }
+  return len;
+}
+} // namespace
+
+PcapWriter::PcapWriter( FileDescriptor&& fd, const Config& config ) : fd_( std::move( fd ) ), config_( config )
+{
+  // 一条记录最多 snaplen 字节再加上块头和选项：放得下就不会在写的时候重新分配
+  buffer_.reserve( config_.buffer_size + config_.snaplen + 64 );
+  if ( config_.format == Format::Pcap ) {
+    put<uint32_t>( buffer_, PCAP_MAGIC_NS );
+    put<uint16_t>( buffer_, 2 ); // version 2.4
+    put<uint16_t>( buffer_, 4 );
+    put<uint32_t>( buffer_, 0 ); // reserved (thiszone)
+    put<uint32_t>( buffer_, 0 ); // reserved (sigfigs)
+    put<uint32_t>( buffer_, config_.snaplen );
+    put<uint32_t>( buffer_, LINKTYPE_ETHERNET );
+  } else {
+    // Section Header Block
+    put<uint32_t>( buffer_, NG_SECTION_HEADER );
+    put<uint32_t>( buffer_, 28 );
+    put<uint32_t>( buffer_, NG_BYTE_ORDER_MAGIC );
+    put<uint16_t>( buffer_, 1 ); // version 1.0
+    put<uint16_t>( buffer_, 0 );
+    put<int64_t>( buffer_, -1 ); // section length not given
+    put<uint32_t>( buffer_, 28 );
+
+    // Interface Description Block, with nanosecond timestamps (if_tsresol = 9)
+    put<uint32_t>( buffer_, NG_INTERFACE );
+    put<uint32_t>( buffer_, 32 );
+    put<uint16_t>( buffer_, LINKTYPE_ETHERNET );
+    put<uint16_t>( buffer_, 0 );
+    put<uint32_t>( buffer_, config_.snaplen );
+    put<uint16_t>( buffer_, NG_OPT_IF_TSRESOL );
+    put<uint16_t>( buffer_, 1 );
+    put<uint8_t>( buffer_, 9 );
+    pad4( buffer_ );
+    put<uint16_t>( buffer_, NG_OPT_END );
+    put<uint16_t>( buffer_, 0 );
+    put<uint32_t>( buffer_, 32 );
+  }
+}
+
+PcapWriter::PcapWriter( const string& path, const Config& config )
+  : PcapWriter(
+    FileDescriptor {
+      CheckSystemCall( "open", ::open( path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644 ) ) }, // NOLINT
+    config )
+{}
+
+PcapWriter::~PcapWriter()
+{
+  try {
+    flush();
+  } catch ( const exception& ) { // NOLINT(*-empty-catch)
+    // 析构时写不出去也没有别的办法了
+  }
+}
+
+void PcapWriter::write( const EthernetFrame& frame, CaptureDirection direction )
+{
+  write( frame, direction, now_ns() );
+}
+
+void PcapWriter::write( const EthernetFrame& frame, CaptureDirection direction, uint64_t timestamp_ns )
+{
+  const lock_guard lock { mutex_ };
+  const size_t original = frame_length( frame );
+  const size_t start = buffer_.size();
+
+  if ( config_.format == Format::Pcap ) {
+    put<uint32_t>( buffer_, static_cast<uint32_t>( timestamp_ns / 1'000'000'000 ) );
+    put<uint32_t>( buffer_, static_cast<uint32_t>( timestamp_ns % 1'000'000'000 ) );
+    put<uint32_t>( buffer_, 0 ); // captured length, filled in below
+    put<uint32_t>( buffer_, static_cast<uint32_t>( original ) );
+    append_frame( buffer_, frame, config_.snaplen );
+    const auto captured = static_cast<uint32_t>( buffer_.size() - start - PCAP_RECORD_HEADER );
+    memcpy( buffer_.data() + start + 8, &captured, 4 );
+  } else {
+    // Enhanced Packet Block
+    put<uint32_t>( buffer_, NG_ENHANCED_PACKET );
+    put<uint32_t>( buffer_, 0 ); // block length, filled in below
+    put<uint32_t>( buffer_, 0 ); // interface 0
+    put<uint32_t>( buffer_, static_cast<uint32_t>( timestamp_ns >> 32 ) );
+    put<uint32_t>( buffer_, static_cast<uint32_t>( timestamp_ns ) );
+    put<uint32_t>( buffer_, 0 ); // captured length, filled in below
+    put<uint32_t>( buffer_, static_cast<uint32_t>( original ) );
+    const size_t data = buffer_.size();
+    append_frame( buffer_, frame, config_.snaplen );
+    const auto captured = static_cast<uint32_t>( buffer_.size() - data );
+    pad4( buffer_ );
+    if ( direction != CaptureDirection::Unknown ) {
+      put<uint16_t>( buffer_, NG_OPT_EPB_FLAGS );
+      put<uint16_t>( buffer_, 4 );
+      put<uint32_t>( buffer_, direction == CaptureDirection::Inbound ? 1 : 2 );
+      put<uint16_t>( buffer_, NG_OPT_END );
+      put<uint16_t>( buffer_, 0 );
+    }
+    const auto length = static_cast<uint32_t>( buffer_.size() + 4 - start );
+    put<uint32_t>( buffer_, length );
+    memcpy( buffer_.data() + start + 4, &length, 4 );
+    memcpy( buffer_.data() + start + 20, &captured, 4 );
+  }
+
+  ++frames_;
+  if ( buffer_.size() >= config_.buffer_size ) {
+    flush_locked();
+  }
+}
+
+void PcapWriter::flush()
+{
+  const lock_guard lock { mutex_ };
+  flush_locked();
+}
+
+void PcapWriter::flush_locked()
+{
+  string_view pending { buffer_ };
+  while ( not pending.empty() ) {
+    const size_t written = fd_.write( pending );
+    if ( written == 0 ) {
+      throw runtime_error( "PcapWriter: capture file would block" );
+    }
+    pending.remove_prefix( written );
+  }
+  buffer_.clear();
+}
+
+uint64_t PcapWriter::frames() const
+{
+  const lock_guard lock { mutex_ };
+  return frames_;
+}
+
+optional<EthernetFrame> PcapReader::Record::frame() const
+{
+  EthernetFrame out;
+  if ( not parse( out, vector<Buffer> { bytes } ) ) {
+    return {};
+  }
+  return out;
+}
+
+PcapReader::PcapReader( MappedFile file ) : file_( std::move( file ) )
+{
+  if ( file_.size() < 4 ) {
+    throw runtime_error( "PcapReader: not a capture file" );
+  }
+  uint32_t magic {};
+  memcpy( &magic, string_view { file_.buffer() }.data(), 4 );
+  if ( magic == NG_SECTION_HEADER ) {
+    format_ = PcapWriter::Format::PcapNg;
+    read_section_header( 0 );
+    return;
+  }
+
+  if ( magic == __builtin_bswap32( PCAP_MAGIC_NS ) or magic == __builtin_bswap32( PCAP_MAGIC_US ) ) {
+    swapped_ = true;
+    magic = __builtin_bswap32( magic );
+  }
+  if ( magic != PCAP_MAGIC_NS and magic != PCAP_MAGIC_US ) {
+    throw runtime_error( "PcapReader: not a capture file" );
+  }
+  pcap_tick_ns_ = magic == PCAP_MAGIC_NS ? 1 : 1000;
+  if ( ( u32( 20 ) & 0xffff ) != LINKTYPE_ETHERNET ) {
+    throw runtime_error( "PcapReader: not an Ethernet capture" );
+  }
+  first_ = pos_ = PCAP_FILE_HEADER;
+}
+
+PcapReader PcapReader::open( const string& path )
+{
+  return PcapReader { MappedFile::open( path ) };
+}
+
+uint16_t PcapReader::u16( size_t offset ) const
+{
+  if ( offset + 2 > file_.size() ) {
+    throw runtime_error( "PcapReader: truncated file" );
+  }
+  uint16_t value {};
+  memcpy( &value, string_view { file_.buffer() }.data() + offset, 2 );
+  return swapped_ ? __builtin_bswap16( value ) : value;
+}
+
+uint32_t PcapReader::u32( size_t offset ) const
+{
+  if ( offset + 4 > file_.size() ) {
+    throw runtime_error( "PcapReader: truncated file" );
+  }
+  uint32_t value {};
+  memcpy( &value, string_view { file_.buffer() }.data() + offset, 4 );
+  return swapped_ ? __builtin_bswap32( value ) : value;
+}
+
+optional<PcapReader::Record> PcapReader::next()
+{
+  return format_ == PcapWriter::Format::Pcap ? next_pcap() : next_pcapng();
+}
+
+void PcapReader::rewind()
+{
+  pos_ = first_;
+  if ( format_ == PcapWriter::Format::PcapNg ) {
+    read_section_header( 0 );
+  }
+}
+
+optional<PcapReader::Record> PcapReader::next_pcap()
+{
+  if ( pos_ >= file_.size() ) {
+    return {};
+  }
+  const uint32_t captured = u32( pos_ + 8 );
+  if ( pos_ + PCAP_RECORD_HEADER + captured > file_.size() ) {
+    throw runtime_error( "PcapReader: truncated record" );
+  }
+  Record record { .timestamp_ns = u32( pos_ ) * uint64_t { 1'000'000'000 } + u32( pos_ + 4 ) * pcap_tick_ns_,
+                  .original_length = u32( pos_ + 12 ),
+                  .direction = CaptureDirection::Unknown,
+                  .bytes = file_.substr( pos_ + PCAP_RECORD_HEADER, captured ) };
+  pos_ += PCAP_RECORD_HEADER + captured;
+  return record;
+}
+
+void PcapReader::read_section_header( size_t offset )
+{
+  // 每一节可以有自己的字节序，接口编号也从 0 重新开始
+  swapped_ = false;
+  const uint32_t magic = u32( offset + 8 );
+  if ( magic == __builtin_bswap32( NG_BYTE_ORDER_MAGIC ) ) {
+    swapped_ = true;
+  } else if ( magic != NG_BYTE_ORDER_MAGIC ) {
+    throw runtime_error( "PcapReader: bad pcapng section header" );
+  }
+  // 长度不对的话 pos_ 不前进（长度 0）或者落到块中间，和其他块一样先检查
+  const uint32_t length = u32( offset + 4 );
+  if ( length < 28 or length % 4 != 0 or offset + length > file_.size() ) {
+    throw runtime_error( "PcapReader: bad pcapng section header" );
+  }
+  interface_tick_ns_.clear();
+  pos_ = offset + length;
+  if ( offset == 0 ) {
+    first_ = pos_;
+  }
+}
+
+void PcapReader::read_interface( size_t offset, size_t length )
+{
+  const uint16_t linktype = u16( offset + 8 );
+  uint64_t tick_ns = 1000; // 默认微秒
+  for ( size_t opt = offset + 16; opt + 4 <= offset + length - 4; ) {
+    const uint16_t code = u16( opt );
+    const uint16_t len = u16( opt + 2 );
+    if ( code == NG_OPT_END ) {
+      break;
+    }
+    if ( code == NG_OPT_IF_TSRESOL and len >= 1 ) {
+      const auto resolution = static_cast<uint8_t>( string_view { file_.buffer() }.at( opt + 4 ) );
+      // 高位为 0：10 的负 n 次方秒；为 1：2 的负 n 次方秒。比纳秒还细的单位不支持
+      if ( resolution & 0x80 or resolution > 9 ) {
+        throw runtime_error( "PcapReader: unsupported timestamp resolution" );
+      }
+      tick_ns = 1;
+      for ( int i = resolution; i < 9; ++i ) {
+        tick_ns *= 10;
+      }
+    }
+    opt += 4 + round4( len );
+  }
+  // 不是以太网的接口记下来，读到它的包时再报错
+  interface_tick_ns_.push_back( linktype == LINKTYPE_ETHERNET ? tick_ns : 0 );
+}
+
+optional<PcapReader::Record> PcapReader::next_pcapng()
+{
+  while ( pos_ + 12 <= file_.size() ) {
+    const size_t block = pos_;
+    const uint32_t type = u32( block );
+    if ( type == NG_SECTION_HEADER ) {
+      read_section_header( block );
+      continue;
+    }
+    const uint32_t length = u32( block + 4 );
+    if ( length < 12 or length % 4 != 0 or block + length > file_.size() ) {
+      throw runtime_error( "PcapReader: bad pcapng block" );
+    }
+    pos_ = block + length;
+
+    if ( type == NG_INTERFACE ) {
+      read_interface( block, length );
+      continue;
+    }
+
+    uint32_t interface = 0;
+    uint64_t ticks = 0;
+    size_t data = 0;
+    uint32_t captured = 0;
+    uint32_t original = 0;
+    size_t options = 0;
+    if ( type == NG_ENHANCED_PACKET ) {
+      interface = u32( block + 8 );
+      ticks = ( uint64_t { u32( block + 12 ) } << 32 ) | u32( block + 16 );
+      captured = u32( block + 20 );
+      original = u32( block + 24 );
+      data = block + 28;
+      options = data + round4( captured );
+    } else if ( type == NG_SIMPLE_PACKET ) {
+      if ( length < 16 ) {
+        throw runtime_error( "PcapReader: truncated packet block" );
+      }
+      original = u32( block + 8 );
+      data = block + 12;
+      captured = static_cast<uint32_t>( min<size_t>( original, length - 16 ) );
+      options = block + length - 4;
+    } else {
+      continue; // 统计、名字解析之类的块跳过
+    }
+    if ( options > block + length - 4 ) {
+      throw runtime_error( "PcapReader: truncated packet block" );
+    }
+    if ( interface >= interface_tick_ns_.size() or interface_tick_ns_[interface] == 0 ) {
+      throw runtime_error( "PcapReader: packet from a missing or non-Ethernet interface" );
+    }
+
+    Record record { .timestamp_ns = ticks * interface_tick_ns_[interface],
+                    .original_length = original,
+                    .direction = CaptureDirection::Unknown,
+                    .bytes = file_.substr( data, captured ) };
+    for ( size_t opt = options; opt + 4 <= block + length - 4; ) {
+      const uint16_t code = u16( opt );
+      const uint16_t len = u16( opt + 2 );
+      if ( code == NG_OPT_END ) {
+        break;
+      }
+      if ( code == NG_OPT_EPB_FLAGS and len == 4 ) {
+        const uint32_t flags = u32( opt + 4 ) & 3;
+        record.direction = flags == 1   ? CaptureDirection::Inbound
+                           : flags == 2 ? CaptureDirection::Outbound
+                                        : CaptureDirection::Unknown;
+      }
+      opt += 4 + round4( len );
+    }
+    return record;
+  }
+  return {};
+}
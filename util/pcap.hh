@@ -0,0 +1,125 @@
+#pragma once
+
+#include "buffer.hh"
+#include "ethernet_frame.hh"
+#include "file_descriptor.hh"
+#include "mapped_file.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Packet captures in the formats tcpdump and Wireshark read: classic pcap (with nanosecond
+// timestamps) and pcapng. Only Ethernet captures (link type 1) are written or read.
+
+//! Which way a captured frame went, as seen by the interface that captured it
+enum class CaptureDirection : uint8_t
+{
+  Unknown,
+  Inbound,
+  Outbound,
+};
+
+//! Writes frames to a capture file. Records are collected in a buffer and written out when it is
+//! full, on flush(), and when the writer is destroyed, so capturing costs one copy of each frame
+//! and no system call per frame. Safe to share between threads (e.g. the interfaces of a router),
+//! which take turns under a mutex.
+class PcapWriter
+{
+public:
+  enum class Format : uint8_t
+  {
+    Pcap,   //!< Classic libpcap format (nanosecond variant); no direction
+    PcapNg, //!< pcapng, with each frame's direction
+  };
+
+  struct Config
+  {
+    Format format = Format::PcapNg;
+    uint32_t snaplen = 65535;      //!< Longer frames are truncated to this many bytes
+    size_t buffer_size = 1 << 20; //!< Bytes collected before they are written out
+  };
+
+  explicit PcapWriter( FileDescriptor&& fd ) : PcapWriter( std::move( fd ), Config {} ) {}
+  PcapWriter( FileDescriptor&& fd, const Config& config );
+
+  // Create (or truncate) the file at `path`
+  explicit PcapWriter( const std::string& path ) : PcapWriter( path, Config {} ) {}
+  PcapWriter( const std::string& path, const Config& config );
+
+  // Writes out whatever is still buffered (errors are ignored here; call flush() to see them)
+  ~PcapWriter();
+
+  // Shared by pointer (see NetworkInterface::capture()), and holds a mutex
+  PcapWriter( const PcapWriter& ) = delete;
+  PcapWriter& operator=( const PcapWriter& ) = delete;
+
+  // Record `frame`, stamped with the current time or with `timestamp_ns` (since the Unix epoch)
+  void write( const EthernetFrame& frame, CaptureDirection direction = CaptureDirection::Unknown );
+  void write( const EthernetFrame& frame, CaptureDirection direction, uint64_t timestamp_ns );
+
+  // Write out the buffered records
+  void flush();
+
+  uint64_t frames() const;
+
+private:
+  FileDescriptor fd_;
+  Config config_;
+  std::string buffer_ {};
+  uint64_t frames_ {};
+  mutable std::mutex mutex_ {};
+
+  void flush_locked();
+};
+
+//! Reads a pcap or pcapng capture through a read-only mapping. A record's bytes are a Buffer
+//! sharing the mapping, so a frame parsed from them (see PcapReader::Record::frame()) points into
+//! the file and nothing is copied.
+class PcapReader
+{
+public:
+  struct Record
+  {
+    uint64_t timestamp_ns {};    // since the Unix epoch
+    uint32_t original_length {}; // the frame's length on the wire (bytes.size() if not truncated)
+    CaptureDirection direction {};
+    Buffer bytes {};
+
+    // The frame, or nothing if the bytes are not a whole Ethernet frame
+    std::optional<EthernetFrame> frame() const;
+  };
+
+  explicit PcapReader( MappedFile file );
+  static PcapReader open( const std::string& path );
+
+  PcapWriter::Format format() const { return format_; }
+
+  // The next record, or nothing at the end of the file. Throws if the file is malformed, or has a
+  // record from a link type other than Ethernet.
+  std::optional<Record> next();
+
+  // Start again from the first record
+  void rewind();
+
+private:
+  MappedFile file_;
+  PcapWriter::Format format_ { PcapWriter::Format::Pcap };
+  size_t first_ {};
+  size_t pos_ {};
+  bool swapped_ {};         // the file's byte order is not ours
+  uint64_t pcap_tick_ns_ {}; // classic pcap: 1000 for microsecond timestamps, 1 for nanoseconds
+
+  // pcapng: the time unit of each interface of the current section
+  std::vector<uint64_t> interface_tick_ns_ {};
+
+  uint16_t u16( size_t offset ) const;
+  uint32_t u32( size_t offset ) const;
+  std::optional<Record> next_pcap();
+  std::optional<Record> next_pcapng();
+  void read_section_header( size_t offset );
+  void read_interface( size_t offset, size_t length );
+};
@@ -0,0 +1,191 @@
+#include "profile.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+LatencyHistogram& LatencyHistogram::operator=( const LatencyHistogram& other ) noexcept
+{
+  if ( this != &other ) {
+    clear();
+    merge( other );
+  }
+  return *this;
+}
+
+void LatencyHistogram::merge( const LatencyHistogram& other ) noexcept
+{
+  if ( other.count() == 0 ) {
+    return;
+  }
+  for ( size_t i = 0; i < NUM_BUCKETS; ++i ) {
+    bump_( counts_[i], other.counts_[i].load( memory_order_relaxed ) );
+  }
+  bump_( count_, other.count() );
+  bump_( sum_, other.sum_.load( memory_order_relaxed ) );
+  max_.store( std::max( max(), other.max() ), memory_order_relaxed );
+  min_.store( std::min( min_.load( memory_order_relaxed ), other.min() ), memory_order_relaxed );
+}
+
+void LatencyHistogram::clear() noexcept
+{
+  for ( auto& c : counts_ ) {
+    c.store( 0, memory_order_relaxed );
+  }
+  count_.store( 0, memory_order_relaxed );
+  sum_.store( 0, memory_order_relaxed );
+  min_.store( UINT64_MAX, memory_order_relaxed );
+  max_.store( 0, memory_order_relaxed );
+}
+
+double LatencyHistogram::mean() const
+{
+  const uint64_t n = count();
+  return n ? static_cast<double>( sum_.load( memory_order_relaxed ) ) / static_cast<double>( n ) : 0;
+}
+
+uint64_t LatencyHistogram::bucket_max( size_t index )
+{
+  if ( index < 2 * SUB_BUCKETS ) {
+    return index;
+  }
+  const unsigned shift = ( index >> SUB_BITS ) - 1;
+  const uint64_t mantissa = ( index & ( SUB_BUCKETS - 1 ) ) | SUB_BUCKETS;
+  return ( ( mantissa + 1 ) << shift ) - 1; // 最后一个桶左移溢出成 0，减一正好是 UINT64_MAX
+}
+
+uint64_t LatencyHistogram::percentile( double p ) const
+{
+  const uint64_t n = count();
+  if ( n == 0 ) {
+    return 0;
+  }
+  const auto target = static_cast<uint64_t>( std::clamp( p, 0.0, 1.0 ) * static_cast<double>( n ) );
+  const uint64_t rank = std::max<uint64_t>( 1, target );
+  uint64_t seen = 0;
+  for ( size_t i = 0; i < NUM_BUCKETS; ++i ) {
+    seen += counts_[i].load( memory_order_relaxed );
+    if ( seen >= rank ) {
+      return std::min( bucket_max( i ), max() );
+    }
+  }
+  return max();
+}
+
+namespace {
+// 每个线程一份直方图；线程退出时把数据并进 retired，这样 snapshot() 不会漏掉已经结束的线程
+struct Registry
+{
+  mutex lock {};
+  vector<Profile::Histograms*> live {};
+  Profile::Histograms retired {};
+};
+
+Registry& registry()
+{
+  static Registry r;
+  return r;
+}
+
+struct ThreadHistograms
+{
+  Profile::Histograms histograms {};
+
+  ThreadHistograms()
+  {
+    const lock_guard guard { registry().lock };
+    registry().live.push_back( &histograms );
+  }
+
+  ~ThreadHistograms()
+  {
+    Registry& r = registry();
+    const lock_guard guard { r.lock };
+    for ( size_t i = 0; i < Profile::NUM_POINTS; ++i ) {
+      r.retired[i].merge( histograms[i] );
+    }
+    erase( r.live, &histograms );
+  }
+
+  ThreadHistograms( const ThreadHistograms& ) = delete;
+  ThreadHistograms& operator=( const ThreadHistograms& ) = delete;
+};
+
+Profile::Histograms& thread_histograms()
+{
+  thread_local ThreadHistograms h;
+  return h.histograms;
+}
+} // namespace
+
+string_view Profile::name( Point point )
+{
+  switch ( point ) {
+    case REASSEMBLER_INSERT:
+      return "Reassembler::insert";
+    case TCP_SENDER_PUSH:
+      return "TCPSender::push";
+    case INTERFACE_RECV_FRAME:
+      return "NetworkInterface::recv_frame";
+    case ROUTER_ROUTE:
+      return "Router::route_batch";
+    case PARSE:
+      return "parse";
+    case SERIALIZE:
+      return "serialize";
+    case NUM_POINTS:
+      break;
+  }
+  return "";
+}
+
+void Profile::record( Point point, uint64_t ticks ) noexcept
+{
+  thread_histograms()[point].record( ticks );
+}
+
+Profile::Histograms Profile::snapshot()
+{
+  Registry& r = registry();
+  const lock_guard guard { r.lock };
+  Histograms out = r.retired;
+  for ( const auto* histograms : r.live ) {
+    for ( size_t i = 0; i < NUM_POINTS; ++i ) {
+      out[i].merge( ( *histograms )[i] );
+    }
+  }
+  return out;
+}
+
+void Profile::reset()
+{
+  Registry& r = registry();
+  const lock_guard guard { r.lock };
+  for ( auto& h : r.retired ) {
+    h.clear();
+  }
+  for ( auto* histograms : r.live ) {
+    // 别的线程可能正在写；清零和它的写入之间谁先谁后都可以接受
+    for ( auto& h : *histograms ) {
+      h.clear();
+    }
+  }
+}
+
+void Profile::dump( ostream& out )
+{
+  const Histograms histograms = snapshot();
+  for ( size_t i = 0; i < NUM_POINTS; ++i ) {
+    const LatencyHistogram& h = histograms[i];
+    if ( h.count() == 0 ) {
+      continue;
+    }
+    out << left << setw( 30 ) << name( static_cast<Point>( i ) ) << right << " count=" << h.count()
+        << " mean=" << fixed << setprecision( 1 ) << h.mean() << " p50=" << h.percentile( 0.50 )
+        << " p90=" << h.percentile( 0.90 ) << " p99=" << h.percentile( 0.99 ) << " p999=" << h.percentile( 0.999 )
+        << " max=" << h.max() << " " << UNIT << "\n";
+  }
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>
+#endif
+
+// Latency histograms for the hot paths, compiled out unless MINNOW_PROFILE is set at build time
+// (cmake -DMINNOW_PROFILE=ON, see etc/cflags.cmake).
+//
+// ProfileScope<Profile::REASSEMBLER_INSERT> profile;
+//
+// times the rest of the enclosing scope and records it in the calling thread's histogram for
+// that point, in Profile::UNIT (TSC cycles on x86, steady_clock nanoseconds elsewhere). Each
+// thread has its own histograms, so recording takes no lock and shares no cache line; snapshot()
+// and dump() merge the histograms of every thread, including threads that have exited. When
+// profiling is compiled out, a ProfileScope does nothing and the compiler removes it.
+
+#ifndef MINNOW_PROFILE
+#define MINNOW_PROFILE 0
+#endif
+
+// A log-linear (HDR-style) histogram of non-negative values: exact below 2^SUB_BITS, and above
+// that each power of two is split into 2^SUB_BITS buckets, so every value is kept to within
+// 1/2^SUB_BITS (about 6%) of itself. Fixed size; record() never allocates.
+//
+// record() has a single writer (the owning thread): each update is a relaxed load and store,
+// so another thread may copy or merge the histogram at any time.
+class LatencyHistogram
+{
+public:
+  static constexpr unsigned SUB_BITS = 4;
+  static constexpr size_t SUB_BUCKETS = size_t { 1 } << SUB_BITS;
+  static constexpr size_t NUM_BUCKETS = ( 64 - SUB_BITS + 1 ) * SUB_BUCKETS;
+
+  LatencyHistogram() = default;
+  LatencyHistogram( const LatencyHistogram& other ) noexcept { *this = other; }
+  LatencyHistogram& operator=( const LatencyHistogram& other ) noexcept;
+  ~LatencyHistogram() = default;
+
+  // Only the owning thread may call record()
+  void record( uint64_t value ) noexcept
+  {
+    bump_( counts_[bucket( value )], 1 );
+    bump_( count_, 1 );
+    bump_( sum_, value );
+    if ( value > max_.load( std::memory_order_relaxed ) ) {
+      max_.store( value, std::memory_order_relaxed );
+    }
+    if ( value < min_.load( std::memory_order_relaxed ) ) {
+      min_.store( value, std::memory_order_relaxed );
+    }
+  }
+
+  // Add every value recorded in `other`
+  void merge( const LatencyHistogram& other ) noexcept;
+  void clear() noexcept;
+
+  uint64_t count() const { return count_.load( std::memory_order_relaxed ); }
+  uint64_t min() const { return count() ? min_.load( std::memory_order_relaxed ) : 0; }
+  uint64_t max() const { return max_.load( std::memory_order_relaxed ); }
+  double mean() const;
+
+  // The smallest value that at least a fraction `p` (0 to 1) of the values are no greater than,
+  // rounded up to the top of its bucket (but never above max())
+  uint64_t percentile( double p ) const;
+
+  // The bucket that holds `value`, and the largest value that bucket holds
+  static size_t bucket( uint64_t value )
+  {
+    if ( value < 2 * SUB_BUCKETS ) {
+      return value;
+    }
+    const unsigned shift = std::bit_width( value ) - 1 - SUB_BITS;
+    return ( ( shift + 1 ) << SUB_BITS ) | ( ( value >> shift ) & ( SUB_BUCKETS - 1 ) );
+  }
+  static uint64_t bucket_max( size_t index );
+
+private:
+  static void bump_( std::atomic<uint64_t>& value, uint64_t n )
+  {
+    value.store( value.load( std::memory_order_relaxed ) + n, std::memory_order_relaxed );
+  }
+
+  std::array<std::atomic<uint64_t>, NUM_BUCKETS> counts_ {};
+  std::atomic<uint64_t> count_ {};
+  std::atomic<uint64_t> sum_ {};
+  std::atomic<uint64_t> min_ { UINT64_MAX };
+  std::atomic<uint64_t> max_ {};
+};
+
+class Profile
+{
+public:
+  enum Point : uint8_t
+  {
+    REASSEMBLER_INSERT,
+    TCP_SENDER_PUSH,
+    INTERFACE_RECV_FRAME,
+    ROUTER_ROUTE,
+    PARSE,
+    SERIALIZE,
+    NUM_POINTS
+  };
+
+  using Histograms = std::array<LatencyHistogram, NUM_POINTS>;
+
+  static constexpr bool ENABLED = MINNOW_PROFILE != 0;
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+  static constexpr std::string_view UNIT = "cycles";
+  static uint64_t now() { return __rdtsc(); }
+#else
+  static constexpr std::string_view UNIT = "ns";
+  static uint64_t now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch() )
+      .count();
+  }
+#endif
+
+  static std::string_view name( Point point );
+
+  // Record `ticks` at `point` in the calling thread's histogram
+  static void record( Point point, uint64_t ticks ) noexcept;
+
+  // Every thread's histograms, merged
+  static Histograms snapshot();
+
+  // Forget everything recorded so far (values being recorded by other threads meanwhile may survive)
+  static void reset();
+
+  // One line per point that has recorded anything: count, mean, percentiles and max, in UNIT
+  static void dump( std::ostream& out );
+};
+
+template<Profile::Point point>
+class ProfileScope
+{
+public:
+  ProfileScope() noexcept
+  {
+    if constexpr ( Profile::ENABLED ) {
+      start_ = Profile::now();
+    }
+  }
+
+  ~ProfileScope()
+  {
+    if constexpr ( Profile::ENABLED ) {
+      Profile::record( point, Profile::now() - start_ );
+    }
+  }
+
+  ProfileScope( const ProfileScope& ) = delete;
+  ProfileScope& operator=( const ProfileScope& ) = delete;
+
+private:
+  uint64_t start_ {};
+};
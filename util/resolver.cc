@@ -0,0 +1,165 @@
+#include "resolver.hh"
+
+#include "exception.hh"
+#include "log.hh"
+
+#include <exception>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+Resolver::Resolver( EventLoop& loop, const Config& config )
+  : loop_( loop )
+  , config_( config )
+  , wakeup_( CheckSystemCall( "eventfd", ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) )
+{
+  wakeup_id_ = loop_.add( wakeup_, [this] { deliver_answers_(); } );
+  for ( size_t i = 0; i < max<size_t>( config_.threads, 1 ); ++i ) {
+    threads_.emplace_back( [this] { work_(); } );
+  }
+}
+
+Resolver::~Resolver()
+{
+  try {
+    {
+      const lock_guard lock { mutex_ };
+      stopping_ = true;
+    }
+    work_ready_.notify_all();
+    for ( auto& thread : threads_ ) {
+      thread.join();
+    }
+    loop_.remove( wakeup_id_ );
+  } catch ( const exception& e ) {
+    // don't throw an exception from the destructor
+    log<LogLevel::Error>( [&]( ostream& out ) { out << "Exception destructing Resolver: " << e.what(); } );
+  }
+}
+
+string Resolver::key_( string_view host, string_view service )
+{
+  string key;
+  key.reserve( host.size() + 1 + service.size() );
+  key.append( host ).push_back( '\0' );
+  key.append( service );
+  return key;
+}
+
+const Resolver::Entry* Resolver::fresh_( const string& key )
+{
+  const auto it = cache_.find( key );
+  if ( it == cache_.end() ) {
+    return nullptr;
+  }
+  if ( it->second.expires <= chrono::steady_clock::now() ) {
+    cache_.erase( it );
+    return nullptr;
+  }
+  return &it->second;
+}
+
+void Resolver::resolve( const string& host, const string& service, Callback callback )
+{
+  string key = key_( host, service );
+  if ( const Entry* entry = fresh_( key ) ) {
+    ++stats_.hits;
+    callback( entry->address, entry->error );
+    return;
+  }
+
+  auto [it, first] = waiting_.try_emplace( key );
+  it->second.push_back( std::move( callback ) );
+  if ( not first ) {
+    ++stats_.coalesced;
+    return;
+  }
+
+  ++stats_.lookups;
+  {
+    const lock_guard lock { mutex_ };
+    requests_.push_back( std::move( key ) );
+  }
+  work_ready_.notify_one();
+}
+
+optional<Address> Resolver::cached( const string& host, const string& service )
+{
+  const Entry* entry = fresh_( key_( host, service ) );
+  return entry ? entry->address : nullopt;
+}
+
+void Resolver::work_()
+{
+  while ( true ) {
+    string key;
+    {
+      unique_lock lock { mutex_ };
+      work_ready_.wait( lock, [this] { return stopping_ or not requests_.empty(); } );
+      if ( stopping_ ) {
+        return;
+      }
+      key = std::move( requests_.front() );
+      requests_.pop_front();
+    }
+
+    // 阻塞的 getaddrinfo() 在这个线程里跑
+    Answer answer { key, {}, {} };
+    const size_t split = key.find( '\0' );
+    try {
+      answer.address.emplace( key.substr( 0, split ), key.substr( split + 1 ) );
+    } catch ( const exception& e ) {
+      answer.error = e.what();
+    }
+
+    {
+      const lock_guard lock { mutex_ };
+      answers_.push_back( std::move( answer ) );
+    }
+    const uint64_t one = 1;
+    if ( ::write( wakeup_.fd_num(), &one, sizeof( one ) ) < 0 ) {
+      log<LogLevel::Error>( []( ostream& out ) { out << "Resolver: can't wake the event loop"; } );
+    }
+  }
+}
+
+void Resolver::deliver_answers_()
+{
+  uint64_t count {};
+  while ( ::read( wakeup_.fd_num(), &count, sizeof( count ) ) > 0 ) {}
+
+  vector<Answer> answers;
+  {
+    const lock_guard lock { mutex_ };
+    answers.swap( answers_ );
+  }
+
+  for ( auto& answer : answers ) {
+    store_( answer.key, answer );
+    const auto it = waiting_.find( answer.key );
+    if ( it == waiting_.end() ) {
+      continue;
+    }
+    // 先摘下来再回调：回调里可能又 resolve 同一个名字
+    const vector<Callback> callbacks = std::move( it->second );
+    waiting_.erase( it );
+    for ( const auto& callback : callbacks ) {
+      callback( answer.address, answer.error );
+    }
+  }
+}
+
+void Resolver::store_( const string& key, const Answer& answer )
+{
+  const auto now = chrono::steady_clock::now();
+  if ( cache_.size() >= config_.max_entries ) {
+    erase_if( cache_, [&]( const auto& entry ) { return entry.second.expires <= now; } );
+    if ( cache_.size() >= config_.max_entries ) {
+      return; // 都还新鲜：这个就不缓存了
+    }
+  }
+  const auto ttl = answer.address ? config_.ttl : config_.negative_ttl;
+  cache_.insert_or_assign( key, Entry { answer.address, answer.error, now + ttl } );
+}
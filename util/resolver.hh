@@ -0,0 +1,108 @@
+#pragma once
+
+#include "address.hh"
+#include "event_loop.hh"
+#include "file_descriptor.hh"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//! \brief Resolves host and service names without blocking an EventLoop, and caches the answers
+//! \details Lookups run [getaddrinfo(3)](\ref man3::getaddrinfo) (so /etc/hosts, DNS and the rest
+//! of nsswitch.conf apply as usual) on background threads, and their callbacks run on the loop's
+//! thread. A name that is already being looked up is not looked up twice: later requests wait for
+//! the same answer. Answers stay in the cache for `ttl` (failures for `negative_ttl`), so while
+//! one is fresh, resolve() is a hash lookup and calls back before it returns. getaddrinfo() does
+//! not say how long the DNS answer was good for, so the lifetimes are set here instead.
+class Resolver
+{
+public:
+  //! The address, or empty and a reason
+  using Callback = std::function<void( const std::optional<Address>& address, std::string_view error )>;
+
+  struct Config
+  {
+    std::chrono::milliseconds ttl { std::chrono::seconds { 60 } };         //!< How long an answer is kept
+    std::chrono::milliseconds negative_ttl { std::chrono::seconds { 5 } }; //!< How long a failure is kept
+    size_t max_entries = 4096;                                             //!< Cache size
+    size_t threads = 2;                                                    //!< Lookups that can run at once
+  };
+
+  //! Deliver answers on `loop`, which must outlive the Resolver. (The Resolver stays registered
+  //! with the loop, so EventLoop::run() keeps going until stop() is called.)
+  explicit Resolver( EventLoop& loop ) : Resolver( loop, Config {} ) {}
+  Resolver( EventLoop& loop, const Config& config );
+
+  //! Waits for the lookups already running (getaddrinfo() can't be interrupted); their callbacks don't run
+  ~Resolver();
+
+  Resolver( const Resolver& ) = delete;
+  Resolver& operator=( const Resolver& ) = delete;
+
+  //! Resolve `host` and `service` as Address( host, service ) would, then call `callback` on the
+  //! loop's thread: right away if the answer is cached, else once the lookup finishes
+  void resolve( const std::string& host, const std::string& service, Callback callback );
+
+  //! The cached answer, if there is a fresh one
+  std::optional<Address> cached( const std::string& host, const std::string& service );
+
+  struct Stats
+  {
+    uint64_t hits;      //!< Answered from the cache
+    uint64_t lookups;   //!< getaddrinfo() calls
+    uint64_t coalesced; //!< Waited for a lookup that was already running
+  };
+  Stats stats() const { return stats_; }
+  size_t size() const { return cache_.size(); } //!< Cached answers (some may have expired)
+
+private:
+  struct Entry
+  {
+    std::optional<Address> address;
+    std::string error;
+    std::chrono::steady_clock::time_point expires;
+  };
+
+  struct Answer // 查询线程交回循环的结果
+  {
+    std::string key;
+    std::optional<Address> address;
+    std::string error;
+  };
+
+  static std::string key_( std::string_view host, std::string_view service );
+  const Entry* fresh_( const std::string& key );
+  void work_();            // 查询线程
+  void deliver_answers_(); // 循环线程：收结果、写缓存、回调
+  void store_( const std::string& key, const Answer& answer );
+
+  EventLoop& loop_;
+  Config config_;
+  FileDescriptor wakeup_; // eventfd：查询线程写，循环读
+  EventLoop::Id wakeup_id_ {};
+
+  // 只在循环线程里碰
+  std::unordered_map<std::string, Entry> cache_ {};
+  std::unordered_map<std::string, std::vector<Callback>> waiting_ {}; // 正在查的名字，和等着它的回调
+  Stats stats_ {};
+
+  // 两边共享，mutex_ 保护
+  std::mutex mutex_ {};
+  std::condition_variable work_ready_ {};
+  std::deque<std::string> requests_ {};
+  std::vector<Answer> answers_ {};
+  bool stopping_ {};
+
+  std::vector<std::thread> threads_ {};
+};
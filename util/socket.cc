@@ -2,9 +2,14 @@
 
 #include "exception.hh"
 
+#include <array>
 #include <cstddef>
+#include <cstring>
+#include <linux/errqueue.h>
 #include <linux/if_packet.h>
 #include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
 #include <stdexcept>
 #include <sys/ioctl.h>
 #include <unistd.h>
@@ -151,6 +156,138 @@ void DatagramSocket::send( const string_view payload )
   register_write();
 }
 
+void DatagramSocket::recv_many( vector<Received>& datagrams, size_t max_datagrams )
+{
+  datagrams.clear();
+  max_datagrams = max<size_t>( max_datagrams, 1 );
+
+  // 每个线程一套收包用的临时区：内核写进去，再按收到的长度拷进池里的 Buffer
+  using Control = array<char, CMSG_SPACE( sizeof( int ) )>;
+  thread_local vector<char> scratch;
+  thread_local vector<mmsghdr> messages;
+  thread_local vector<iovec> iovecs;
+  thread_local vector<Address::Raw> sources;
+  thread_local vector<Control> controls;
+
+  const size_t slot = gro_ ? MAX_COALESCED_SIZE : kReadBufferSize;
+  if ( scratch.size() < max_datagrams * slot ) {
+    scratch.resize( max_datagrams * slot );
+  }
+  messages.assign( max_datagrams, {} );
+  iovecs.resize( max_datagrams );
+  sources.resize( max_datagrams );
+  controls.resize( max_datagrams );
+  for ( size_t i = 0; i < max_datagrams; ++i ) {
+    iovecs[i] = { scratch.data() + i * slot, slot }; // NOLINT(*-pointer-arithmetic)
+    auto& header = messages[i].msg_hdr;
+    header.msg_name = static_cast<sockaddr*>( sources[i] );
+    header.msg_namelen = sizeof( sources[i].storage );
+    header.msg_iov = &iovecs[i];
+    header.msg_iovlen = 1;
+    if ( gro_ ) {
+      header.msg_control = controls[i].data();
+      header.msg_controllen = controls[i].size();
+    }
+  }
+
+  const int received = CheckSystemCall(
+    "recvmmsg",
+    ::recvmmsg( fd_num(), messages.data(), static_cast<unsigned>( max_datagrams ), MSG_WAITFORONE, nullptr ) );
+  register_read();
+
+  for ( size_t i = 0; i < static_cast<size_t>( received ); ++i ) {
+    auto& header = messages[i].msg_hdr;
+    if ( header.msg_flags & MSG_TRUNC ) { // NOLINT(*-signed-bitwise)
+      throw runtime_error( "recvmmsg (oversized datagram)" );
+    }
+
+    // GRO 合并过的话，控制消息里有每个原始数据报的大小（最后一个可以小一些）
+    size_t segment = messages[i].msg_len;
+    for ( cmsghdr* cmsg = CMSG_FIRSTHDR( &header ); cmsg != nullptr; cmsg = CMSG_NXTHDR( &header, cmsg ) ) {
+      if ( cmsg->cmsg_level == SOL_UDP and cmsg->cmsg_type == UDP_GRO ) {
+        int gso_size {};
+        memcpy( &gso_size, CMSG_DATA( cmsg ), sizeof( gso_size ) );
+        segment = gso_size > 0 ? static_cast<size_t>( gso_size ) : segment;
+      }
+    }
+
+    const Address source { sources[i], header.msg_namelen };
+    string_view payload { static_cast<const char*>( iovecs[i].iov_base ), messages[i].msg_len };
+    do {
+      const string_view one = payload.substr( 0, segment );
+      string bytes = Buffer::pooled_string( one.size() );
+      bytes.assign( one );
+      datagrams.push_back( { source, Buffer { std::move( bytes ) } } );
+      payload.remove_prefix( one.size() );
+    } while ( not payload.empty() );
+  }
+}
+
+size_t DatagramSocket::send_many( const Address& destination, const vector<Buffer>& payloads )
+{
+  // 一条消息是 payloads 里连续的一段。开了 GSO 时，一段里除了最后一个都正好是 gso_segment_size_ 字节，
+  // 最后一个不大于它；内核按这个大小再切开
+  struct Run
+  {
+    size_t first;
+    size_t count;
+    size_t bytes;
+    bool open; // 还能往后接
+  };
+  vector<iovec> iovecs;
+  vector<Run> runs;
+  iovecs.reserve( payloads.size() );
+  for ( size_t i = 0; i < payloads.size(); ++i ) {
+    const string_view view { payloads[i] };
+    iovecs.push_back( { const_cast<char*>( view.data() ), view.size() } ); // NOLINT(*-const-cast)
+    const size_t segment = gso_segment_size_;
+    if ( not runs.empty() and runs.back().open and view.size() <= segment and runs.back().count < MAX_GSO_SEGMENTS
+         and runs.back().bytes + view.size() <= MAX_UDP_PAYLOAD ) {
+      ++runs.back().count;
+      runs.back().bytes += view.size();
+      runs.back().open = view.size() == segment;
+    } else {
+      runs.push_back( { i, 1, view.size(), segment != 0 and view.size() == segment } );
+    }
+  }
+
+  using Control = array<char, CMSG_SPACE( sizeof( uint16_t ) )>;
+  vector<mmsghdr> messages( runs.size() );
+  vector<Control> controls( runs.size() );
+  for ( size_t i = 0; i < runs.size(); ++i ) {
+    auto& header = messages[i].msg_hdr;
+    header.msg_name = const_cast<sockaddr*>( static_cast<const sockaddr*>( destination ) ); // NOLINT(*-const-cast)
+    header.msg_namelen = destination.size();
+    header.msg_iov = &iovecs[runs[i].first];
+    header.msg_iovlen = runs[i].count;
+    if ( runs[i].count > 1 ) {
+      header.msg_control = controls[i].data();
+      header.msg_controllen = controls[i].size();
+      cmsghdr* cmsg = CMSG_FIRSTHDR( &header );
+      cmsg->cmsg_level = SOL_UDP;
+      cmsg->cmsg_type = UDP_SEGMENT;
+      cmsg->cmsg_len = CMSG_LEN( sizeof( uint16_t ) );
+      memcpy( CMSG_DATA( cmsg ), &gso_segment_size_, sizeof( uint16_t ) );
+    }
+  }
+
+  const int sent = CheckSystemCall(
+    "sendmmsg", ::sendmmsg( fd_num(), messages.data(), static_cast<unsigned>( messages.size() ), 0 ) );
+  register_write();
+
+  size_t datagrams = 0;
+  for ( size_t i = 0; i < static_cast<size_t>( sent ); ++i ) {
+    datagrams += runs[i].count;
+  }
+  return datagrams;
+}
+
+void DatagramSocket::set_gro( bool gro )
+{
+  setsockopt( SOL_UDP, UDP_GRO, int { gro } );
+  gro_ = gro;
+}
+
 // mark the socket as listening for incoming connections
 //! \param[in] backlog is the number of waiting connections to queue (see [listen(2)](\ref man2::listen))
 void TCPSocket::listen( const int backlog )
@@ -167,6 +304,97 @@ TCPSocket TCPSocket::accept()
   return TCPSocket( FileDescriptor( CheckSystemCall( "accept", ::accept( fd_num(), nullptr, nullptr ) ) ) );
 }
 
+void TCPSocket::set_zerocopy()
+{
+  setsockopt( SOL_SOCKET, SO_ZEROCOPY, int { true } );
+  zerocopy_ = true;
+}
+
+size_t TCPSocket::send( const vector<Buffer>& buffers )
+{
+  vector<iovec> iovecs;
+  iovecs.reserve( buffers.size() );
+  for ( const auto& buffer : buffers ) {
+    const string_view view { buffer };
+    iovecs.push_back( { const_cast<char*>( view.data() ), view.size() } ); // NOLINT(*-const-cast)
+  }
+  msghdr message {};
+  message.msg_iov = iovecs.data();
+  message.msg_iovlen = iovecs.size();
+
+  ssize_t bytes_sent = ::sendmsg( fd_num(), &message, zerocopy_ ? MSG_ZEROCOPY : 0 );
+  const bool copied = zerocopy_ and bytes_sent < 0 and errno == ENOBUFS; // 锁不住页面了：这一次拷贝着发
+  if ( copied ) {
+    bytes_sent = ::sendmsg( fd_num(), &message, 0 );
+  }
+  bytes_sent = CheckSystemCall( "sendmsg", bytes_sent );
+  register_write();
+
+  // 只有真发出去了的零拷贝 send 才占一个编号；Buffer 要留到内核说用完为止
+  if ( zerocopy_ and not copied and bytes_sent > 0 ) {
+    zerocopy_pending_.push_back( { buffers, false } );
+    ++zerocopy_next_id_;
+  }
+  return bytes_sent;
+}
+
+size_t TCPSocket::reap_zerocopy()
+{
+  while ( true ) {
+    array<char, CMSG_SPACE( sizeof( sock_extended_err ) + sizeof( sockaddr_in6 ) )> control {};
+    msghdr message {};
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+    if ( ::recvmsg( fd_num(), &message, MSG_ERRQUEUE | MSG_DONTWAIT ) < 0 ) {
+      if ( errno == EAGAIN ) {
+        break;
+      }
+      throw unix_error { "recvmsg(MSG_ERRQUEUE)" };
+    }
+
+    for ( cmsghdr* cmsg = CMSG_FIRSTHDR( &message ); cmsg != nullptr; cmsg = CMSG_NXTHDR( &message, cmsg ) ) {
+      if ( not( cmsg->cmsg_level == SOL_IP and cmsg->cmsg_type == IP_RECVERR )
+           and not( cmsg->cmsg_level == SOL_IPV6 and cmsg->cmsg_type == IPV6_RECVERR ) ) {
+        continue;
+      }
+      sock_extended_err error {};
+      memcpy( &error, CMSG_DATA( cmsg ), sizeof( error ) );
+      if ( error.ee_origin != SO_EE_ORIGIN_ZEROCOPY or error.ee_errno != 0 ) {
+        continue;
+      }
+
+      // 一条通知是编号 [ee_info, ee_data] 这一段（会回绕）
+      const uint32_t front_id = zerocopy_next_id_ - static_cast<uint32_t>( zerocopy_pending_.size() );
+      for ( uint32_t id = error.ee_info; id != error.ee_data + 1; ++id ) {
+        const uint32_t index = id - front_id;
+        if ( index < zerocopy_pending_.size() ) {
+          zerocopy_pending_[index].done = true;
+          if ( error.ee_code & SO_EE_CODE_ZEROCOPY_COPIED ) { // NOLINT(*-signed-bitwise)
+            ++zerocopy_copied_;
+          }
+        }
+      }
+    }
+  }
+
+  size_t finished = 0;
+  while ( not zerocopy_pending_.empty() and zerocopy_pending_.front().done ) {
+    zerocopy_pending_.pop_front();
+    ++finished;
+  }
+  return finished;
+}
+
+optional<TCPSocket> TCPSocket::accept_nonblocking()
+{
+  register_read();
+  const int fd = ::accept4( fd_num(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC );
+  if ( fd < 0 and ( errno == EAGAIN or errno == EWOULDBLOCK or errno == ECONNABORTED ) ) {
+    return {};
+  }
+  return TCPSocket( FileDescriptor( ::CheckSystemCall( "accept4", fd ) ) );
+}
+
 // get socket option
 template<typename option_type>
 socklen_t Socket::getsockopt( const int level, const int option, option_type& option_value ) const
@@ -200,6 +428,63 @@ void Socket::set_reuseaddr()
   setsockopt( SOL_SOCKET, SO_REUSEADDR, int { true } );
 }
 
+void Socket::set_reuseport()
+{
+  setsockopt( SOL_SOCKET, SO_REUSEPORT, int { true } );
+}
+
+void Socket::set_send_buffer_size( int bytes )
+{
+  setsockopt( SOL_SOCKET, SO_SNDBUF, bytes );
+}
+
+void Socket::set_receive_buffer_size( int bytes )
+{
+  setsockopt( SOL_SOCKET, SO_RCVBUF, bytes );
+}
+
+int Socket::send_buffer_size() const
+{
+  int bytes {};
+  getsockopt( SOL_SOCKET, SO_SNDBUF, bytes );
+  return bytes;
+}
+
+int Socket::receive_buffer_size() const
+{
+  int bytes {};
+  getsockopt( SOL_SOCKET, SO_RCVBUF, bytes );
+  return bytes;
+}
+
+void Socket::set_busy_poll( int microseconds )
+{
+  setsockopt( SOL_SOCKET, SO_BUSY_POLL, microseconds );
+}
+
+void TCPSocket::set_nodelay( bool nodelay )
+{
+  setsockopt( IPPROTO_TCP, TCP_NODELAY, int { nodelay } );
+}
+
+void TCPSocket::set_cork( bool cork )
+{
+  setsockopt( IPPROTO_TCP, TCP_CORK, int { cork } );
+}
+
+void TCPSocket::set_quickack( bool quickack )
+{
+  setsockopt( IPPROTO_TCP, TCP_QUICKACK, int { quickack } );
+}
+
+tcp_info TCPSocket::info() const
+{
+  // 老内核的 tcp_info 短一些，没填的字段保持 0
+  tcp_info info {};
+  getsockopt( IPPROTO_TCP, TCP_INFO, info );
+  return info;
+}
+
 void Socket::throw_if_error() const
 {
   int socket_error = 0;
@@ -4,8 +4,12 @@
 #include "file_descriptor.hh"
 
 #include <cstdint>
+#include <deque>
 #include <functional>
+#include <netinet/tcp.h>
+#include <optional>
 #include <sys/socket.h>
+#include <vector>
 
 //! \brief Base class for network sockets (TCP, UDP, etc.)
 //! \details Socket is generally used via a subclass. See TCPSocket and UDPSocket for usage examples.
@@ -54,6 +58,21 @@ public:
   //! Allow local address to be reused sooner via [SO_REUSEADDR](\ref man7::socket)
   void set_reuseaddr();
 
+  //! Let several sockets bind the same address and port via [SO_REUSEPORT](\ref man7::socket);
+  //! the kernel spreads incoming connections (or datagrams) across them
+  void set_reuseport();
+
+  //! Ask for a send or receive buffer of `bytes` ([SO_SNDBUF, SO_RCVBUF](\ref man7::socket)). The
+  //! kernel doubles the request for its bookkeeping, and caps it at net.core.wmem_max / rmem_max.
+  void set_send_buffer_size( int bytes );
+  void set_receive_buffer_size( int bytes );
+  int send_buffer_size() const;    //!< The send buffer the kernel actually gave the socket
+  int receive_buffer_size() const; //!< The receive buffer the kernel actually gave the socket
+
+  //! Busy-poll the device for up to `microseconds` on a blocking receive with no data
+  //! ([SO_BUSY_POLL](\ref man7::socket)), trading CPU for latency. 0 turns it off.
+  void set_busy_poll( int microseconds );
+
   //! Check for errors (will be seen on non-blocking sockets)
   void throw_if_error() const;
 };
@@ -63,6 +82,41 @@ class DatagramSocket : public Socket
   using Socket::Socket;
 
 public:
+  static constexpr size_t BATCH = 32;                 //!< Datagrams per recv_many() by default
+  static constexpr size_t MAX_GSO_SEGMENTS = 64;      //!< Datagrams the kernel will cut one send into
+  static constexpr size_t MAX_UDP_PAYLOAD = 65507;    //!< Largest UDP payload over IPv4
+  static constexpr size_t MAX_COALESCED_SIZE = 65535; //!< Largest payload that GRO hands up at once
+
+  //! A datagram from recv_many()
+  struct Received
+  {
+    Address source;
+    Buffer payload;
+  };
+
+  //! \brief Receive up to `max_datagrams` datagrams with one [recvmmsg(2)](\ref man2::recvmmsg)
+  //! \details `datagrams` is cleared first, and left empty if a non-blocking socket has nothing
+  //! waiting (a blocking one waits for the first). Each payload is a pooled Buffer sized to its
+  //! datagram; with set_gro(), a run of datagrams the kernel coalesced is split back into one
+  //! Buffer per datagram. Throws std::runtime_error if a datagram is larger than kReadBufferSize
+  //! (MAX_COALESCED_SIZE with GRO).
+  void recv_many( std::vector<Received>& datagrams, size_t max_datagrams = BATCH );
+
+  //! \brief Send each of `payloads` as a datagram to `destination`, with one
+  //! [sendmmsg(2)](\ref man2::sendmmsg)
+  //! \details With set_gso_segment_size(), a run of payloads that are each exactly that size (and
+  //! may end with a shorter one) goes to the kernel as a single message, which it cuts back into
+  //! datagrams as late as it can (UDP GSO).
+  //! \returns how many of `payloads`, from the front, were sent (0 if a non-blocking send would block)
+  size_t send_many( const Address& destination, const std::vector<Buffer>& payloads );
+
+  //! Let send_many() hand runs of `segment_size`-byte payloads to the kernel as one message (0: off)
+  void set_gso_segment_size( uint16_t segment_size ) { gso_segment_size_ = segment_size; }
+
+  //! Let the kernel coalesce a run of same-sized datagrams from one sender ([UDP_GRO](\ref man7::udp)),
+  //! for recv_many() to split apart again
+  void set_gro( bool gro = true );
+
   //! Receive a datagram and the Address of its sender
   void recv( Address& source_address, std::string& payload );
 
@@ -71,13 +125,17 @@ public:
 
   //! Send datagram to the socket's connected address (must call connect() first)
   void send( std::string_view payload );
+
+private:
+  uint16_t gso_segment_size_ {};
+  bool gro_ {};
 };
 
 //! A wrapper around [UDP sockets](\ref man7::udp)
 class UDPSocket : public DatagramSocket
 {
   //! \param[in] fd is the FileDescriptor from which to construct
-  explicit UDPSocket( FileDescriptor&& fd ) : DatagramSocket( std::move( fd ), AF_INET, SOCK_DGRAM ) {}
+  explicit UDPSocket( FileDescriptor&& fd ) : DatagramSocket( std::move( fd ), AF_INET, SOCK_DGRAM, IPPROTO_UDP ) {}
 
 public:
   //! Default: construct an unbound, unconnected UDP socket
@@ -90,7 +148,7 @@ class TCPSocket : public Socket
 private:
   //! \brief Construct from FileDescriptor (used by accept())
   //! \param[in] fd is the FileDescriptor from which to construct
-  explicit TCPSocket( FileDescriptor&& fd ) : Socket( std::move( fd ), AF_INET, SOCK_STREAM ) {}
+  explicit TCPSocket( FileDescriptor&& fd ) : Socket( std::move( fd ), AF_INET, SOCK_STREAM, IPPROTO_TCP ) {}
 
 public:
   //! Default: construct an unbound, unconnected TCP socket
@@ -101,6 +159,57 @@ public:
 
   //! Accept a new incoming connection
   TCPSocket accept();
+
+  //! Accept a new incoming connection with [accept4(2)](\ref man2::accept4), already non-blocking
+  //! and close-on-exec. Empty if none is waiting on a non-blocking listening socket (or the one
+  //! waiting was reset before it could be accepted).
+  std::optional<TCPSocket> accept_nonblocking();
+
+  //! Send small segments right away instead of waiting to coalesce them (Nagle's algorithm off),
+  //! via [TCP_NODELAY](\ref man7::tcp)
+  void set_nodelay( bool nodelay = true );
+
+  //! While corked, only send full segments ([TCP_CORK](\ref man7::tcp)); uncorking sends what is left.
+  //! For writing a response in several pieces without sending a partial segment after each one.
+  void set_cork( bool cork );
+
+  //! Send ACKs right away rather than delaying them ([TCP_QUICKACK](\ref man7::tcp)). The kernel
+  //! clears this again by itself, so set it after each read where it matters.
+  void set_quickack( bool quickack = true );
+
+  //! The kernel's view of the connection: RTT, congestion window, retransmissions, ...
+  //! ([TCP_INFO](\ref man7::tcp))
+  tcp_info info() const;
+
+  //! Let send() transmit straight from the Buffers' memory with [MSG_ZEROCOPY](\ref man7::socket)
+  void set_zerocopy();
+
+  //! \brief Send as much of `buffers` as the socket takes, in one [sendmsg(2)](\ref man2::sendmsg)
+  //! \details With set_zerocopy(), the kernel reads the bytes from the Buffers' storage while it
+  //! transmits, so the socket keeps a reference to them until reap_zerocopy() sees the kernel is
+  //! done. (If the kernel is out of memory to pin pages, that one send is copied instead.)
+  //! \returns the number of bytes sent (0 if a non-blocking send would block)
+  size_t send( const std::vector<Buffer>& buffers );
+
+  //! \brief Pick up the kernel's zero-copy completions (from the socket's error queue, which makes
+  //! the socket readable with an error pending) and drop the Buffers it no longer needs
+  //! \returns the number of sends the kernel finished with
+  size_t reap_zerocopy();
+
+  size_t zerocopy_pending() const { return zerocopy_pending_.size(); } //!< Sends the kernel still uses
+  uint64_t zerocopy_copied() const { return zerocopy_copied_; }        //!< Sends copied anyway (e.g. loopback)
+
+private:
+  struct ZeroCopySend
+  {
+    std::vector<Buffer> buffers;
+    bool done;
+  };
+
+  bool zerocopy_ {};
+  uint32_t zerocopy_next_id_ {};                 // 内核给每次成功的零拷贝 send 依次编号，从 0 开始
+  std::deque<ZeroCopySend> zerocopy_pending_ {}; // 队头的编号是 zerocopy_next_id_ - size()
+  uint64_t zerocopy_copied_ {};
 };
 
 //! A wrapper around [packet sockets](\ref man7:packet)
@@ -0,0 +1,174 @@
+#include "task.hh"
+
+#include <array>
+#include <new>
+#include <vector>
+
+using namespace std;
+
+namespace {
+// 每个线程自己的空闲帧，按 64 字节分档；和 Buffer 的池一样，别的线程释放的帧进的是释放它的那个线程的列表
+class FramePool
+{
+public:
+  static constexpr size_t GRANULE = 64;
+  static constexpr size_t CLASSES = 16; // 最大 1 KiB，更大的帧直接用堆
+  static constexpr size_t MAX_FREE = 256;
+
+  // 线程退出、池析构以后还可能有帧被释放，那时直接交还给堆
+  static thread_local bool alive;
+
+  static FramePool& instance()
+  {
+    thread_local FramePool pool;
+    return pool;
+  }
+
+  FramePool() = default;
+  FramePool( const FramePool& ) = delete;
+  FramePool& operator=( const FramePool& ) = delete;
+
+  ~FramePool()
+  {
+    alive = false;
+    for ( size_t i = 0; i < CLASSES; ++i ) {
+      for ( void* frame : free_.at( i ) ) {
+        ::operator delete( frame, ( i + 1 ) * GRANULE );
+      }
+    }
+  }
+
+  static size_t class_of( size_t size ) { return ( size - 1 ) / GRANULE; }
+
+  void* take( size_t size )
+  {
+    auto& free = free_.at( class_of( size ) );
+    if ( free.empty() ) {
+      ++heap_frames;
+      return ::operator new( ( class_of( size ) + 1 ) * GRANULE );
+    }
+    void* frame = free.back();
+    free.pop_back();
+    return frame;
+  }
+
+  void give( void* frame, size_t size )
+  {
+    auto& free = free_.at( class_of( size ) );
+    if ( free.size() >= MAX_FREE ) {
+      ::operator delete( frame, ( class_of( size ) + 1 ) * GRANULE );
+      return;
+    }
+    free.push_back( frame );
+  }
+
+  size_t heap_frames {};
+
+private:
+  array<vector<void*>, CLASSES> free_ {};
+};
+
+thread_local bool FramePool::alive = true;
+
+bool pooled( size_t size )
+{
+  return size > 0 and size <= FramePool::GRANULE * FramePool::CLASSES;
+}
+
+// 这一轮要跑的和这一轮里新唤醒的分开放，两个 vector 交替用，不会每轮分配
+struct ReadyQueue
+{
+  vector<coroutine_handle<>> queued {};
+  vector<coroutine_handle<>> running {};
+};
+
+ReadyQueue& ready_queue()
+{
+  thread_local ReadyQueue queue;
+  return queue;
+}
+} // namespace
+
+void* Task::allocate_frame( size_t size )
+{
+  if ( pooled( size ) and FramePool::alive ) {
+    return FramePool::instance().take( size );
+  }
+  if ( FramePool::alive ) {
+    ++FramePool::instance().heap_frames;
+  }
+  return ::operator new( size );
+}
+
+void Task::free_frame( void* frame, size_t size ) noexcept
+{
+  if ( not pooled( size ) ) {
+    ::operator delete( frame, size );
+  } else if ( FramePool::alive ) {
+    FramePool::instance().give( frame, size );
+  } else {
+    ::operator delete( frame, ( FramePool::class_of( size ) + 1 ) * FramePool::GRANULE );
+  }
+}
+
+size_t Task::heap_frames()
+{
+  return FramePool::alive ? FramePool::instance().heap_frames : 0;
+}
+
+Task::~Task()
+{
+  if ( coroutine_ ) {
+    coroutine_.destroy();
+  }
+}
+
+Task& Task::operator=( Task&& other ) noexcept
+{
+  if ( this != &other ) {
+    if ( coroutine_ ) {
+      coroutine_.destroy();
+    }
+    coroutine_ = std::exchange( other.coroutine_, {} );
+  }
+  return *this;
+}
+
+void Task::start()
+{
+  if ( not done() ) {
+    coroutine_.resume();
+  }
+}
+
+void Task::result() const
+{
+  if ( coroutine_ and coroutine_.promise().exception_ ) {
+    rethrow_exception( coroutine_.promise().exception_ );
+  }
+}
+
+void Task::wake( coroutine_handle<> coroutine )
+{
+  ready_queue().queued.push_back( coroutine );
+}
+
+size_t Task::run_ready()
+{
+  auto& queue = ready_queue();
+  if ( queue.queued.empty() ) {
+    return 0;
+  }
+  swap( queue.queued, queue.running );
+  for ( auto const coroutine : queue.running ) {
+    coroutine.resume();
+  }
+  auto const ran = queue.running.size();
+  queue.running.clear();
+  return ran;
+}
+
+bool Task::ready()
+{
+  return not ready_queue().queued.empty();
+}
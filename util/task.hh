@@ -0,0 +1,122 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <utility>
+
+//! \brief A coroutine that runs on one thread, for writing event-driven code as sequential code
+//! \details A Task starts suspended: start() runs it until it first waits, and `co_await task`
+//! (from another Task) runs it to the end before the awaiting coroutine carries on. A coroutine
+//! that waits for something (Reader::readable(), Writer::writable(), AsyncSocket::read(), ...) is
+//! resumed through this thread's ready queue: whatever made it ready calls wake(), and the next
+//! run_ready() resumes it. EventLoop::wait_next_event() runs the ready queue after its callbacks.
+//!
+//! Coroutine frames come from per-thread free lists in 64-byte size classes, so once they are
+//! warm, starting a Task allocates nothing; neither does waking one.
+//!
+//! Destroying a Task destroys its coroutine, wherever it is suspended. That must not happen
+//! between its wake() and the run_ready() that would resume it.
+//!
+//! GCC 12 miscompiles a co_await inside the condition of a loop or an if: bind the result to a
+//! variable first (`const bool more = co_await reader.readable();`).
+class Task
+{
+public:
+  class promise_type;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  Task() = default;
+  ~Task();
+
+  Task( const Task& other ) = delete;
+  Task& operator=( const Task& other ) = delete;
+  Task( Task&& other ) noexcept : coroutine_( std::exchange( other.coroutine_, {} ) ) {}
+  Task& operator=( Task&& other ) noexcept;
+
+  //! Run the coroutine until it first waits (or finishes)
+  void start();
+
+  bool done() const { return not coroutine_ or coroutine_.done(); }
+
+  //! Rethrow the exception the coroutine finished with, if any
+  void result() const;
+
+  //! Run the task to the end, then resume the awaiting coroutine (rethrowing what the task threw)
+  auto operator co_await() && noexcept;
+
+  //! Queue `coroutine` to be resumed by this thread's next run_ready()
+  static void wake( std::coroutine_handle<> coroutine );
+
+  //! Resume the coroutines queued so far (ones they wake wait for the next call). How many ran?
+  static size_t run_ready();
+
+  //! Is any coroutine waiting in this thread's ready queue?
+  static bool ready();
+
+  //! Coroutine frames this thread has had to take from the heap (the rest were reused)
+  static size_t heap_frames();
+
+  static void* allocate_frame( size_t size );
+  static void free_frame( void* frame, size_t size ) noexcept;
+
+private:
+  explicit Task( Handle coroutine ) : coroutine_( coroutine ) {}
+
+  Handle coroutine_ {};
+};
+
+class Task::promise_type
+{
+public:
+  Task get_return_object() noexcept { return Task { Handle::from_promise( *this ) }; }
+  std::suspend_always initial_suspend() noexcept { return {}; }
+
+  // 结束时直接转到等它的协程（对称转移），没有就停在这里等 Task 析构
+  auto final_suspend() noexcept
+  {
+    struct Final
+    {
+      bool await_ready() noexcept { return false; }
+      std::coroutine_handle<> await_suspend( Handle self ) noexcept
+      {
+        auto const next = self.promise().continuation_;
+        return next ? next : std::noop_coroutine();
+      }
+      void await_resume() noexcept {}
+    };
+    return Final {};
+  }
+
+  void return_void() noexcept {}
+  void unhandled_exception() noexcept { exception_ = std::current_exception(); }
+
+  static void* operator new( size_t size ) { return allocate_frame( size ); }
+  static void operator delete( void* frame, size_t size ) noexcept { free_frame( frame, size ); }
+
+private:
+  friend class Task;
+  std::coroutine_handle<> continuation_ {};
+  std::exception_ptr exception_ {};
+};
+
+inline auto Task::operator co_await() && noexcept
+{
+  struct Awaiter
+  {
+    Handle coroutine;
+    bool await_ready() const noexcept { return not coroutine or coroutine.done(); }
+    std::coroutine_handle<> await_suspend( std::coroutine_handle<> awaiting ) noexcept
+    {
+      coroutine.promise().continuation_ = awaiting;
+      return coroutine;
+    }
+    void await_resume() const
+    {
+      if ( coroutine and coroutine.promise().exception_ ) {
+        std::rethrow_exception( coroutine.promise().exception_ );
+      }
+    }
+  };
+  return Awaiter { coroutine_ };
+}
@@ -19,4 +19,79 @@ public:
   size_t recv_capacity = DEFAULT_CAPACITY; //!< Receive capacity, in bytes
   size_t send_capacity = DEFAULT_CAPACITY; //!< Sender capacity, in bytes
   std::optional<Wrap32> fixed_isn {};
+
+  static constexpr size_t IPV4_TCP_HEADER_SIZE = 40; //!< Minimal IPv4 + TCP headers, without options
+
+  //! Largest TCP payload that fits in one IPv4 datagram of `mtu` bytes
+  static constexpr size_t mss_for_mtu( size_t mtu )
+  {
+    return mtu > IPV4_TCP_HEADER_SIZE ? mtu - IPV4_TCP_HEADER_SIZE : 1;
+  }
+
+  size_t mss = MAX_PAYLOAD_SIZE; //!< Largest payload of a segment on the wire (see mss_for_mtu)
+  size_t tso_segments = 1;       //!< Super-segments: push() emits payloads of up to tso_segments * mss,
+                                 //!< and TCPSender::split_segment() cuts them to mss before they go out
+
+  // RFC 6298 RTT estimation. When off, the RTO stays at rt_timeout (doubling on timeouts).
+  static constexpr uint64_t RTO_MIN_DFLT = 1000;  //!< RFC 6298 lower bound on the RTO (1 second)
+  static constexpr uint64_t RTO_MAX_DFLT = 60000; //!< RFC 6298 upper bound on the RTO (60 seconds)
+
+  bool adaptive_rto = false;        //!< Learn the RTO from measured round-trip times
+  uint64_t rto_min = RTO_MIN_DFLT;  //!< Smallest RTO the estimator may choose, in milliseconds
+  uint64_t rto_max = RTO_MAX_DFLT;  //!< Largest RTO the estimator (or backoff) may reach, in milliseconds
+
+  static constexpr unsigned DUP_ACK_THRESHOLD = 3; //!< Duplicate ACKs that trigger a fast retransmit (RFC 5681)
+
+  bool fast_retransmit = false; //!< Retransmit the oldest outstanding segment after DUP_ACK_THRESHOLD duplicate ACKs
+
+  enum class CongestionAlgorithm
+  {
+    None,  //!< Limited only by the peer's window
+    Reno,  //!< RFC 5681
+    Cubic, //!< RFC 9438
+  };
+  CongestionAlgorithm congestion_control = CongestionAlgorithm::None; //!< Congestion window for the sender
+
+  bool nagle = false; //!< RFC 896: hold back a partial segment while earlier data is unacknowledged
+  bool cork = false;  //!< Start corked: send only full segments until TCPSender::set_cork( false )
+
+  static constexpr uint64_t PACING_GAIN_PERCENT = 125; //!< A derived pacing rate is this % of window / SRTT
+
+  bool pacing = false;      //!< Release queued segments at a steady rate (refilled by tick()) instead of in bursts
+  uint64_t pacing_rate = 0; //!< Pacing rate in bytes per second; 0 derives it from the window and SRTT
+  size_t pacing_burst = 0;  //!< Most sequence numbers sent back to back when paced; 0 means 2 * mss
+
+  static constexpr uint64_t DELAYED_ACK_DFLT = 40;    //!< Default delayed-ACK timeout (RFC 1122: < 500 ms)
+  static constexpr uint64_t DELAYED_ACK_SEGMENTS = 2; //!< RFC 5681: ACK at least every second segment
+
+  bool delayed_ack = false;                   //!< Let TCPReceiver hold back ACKs (see TCPReceiver::ack_due)
+  uint64_t delayed_ack_ms = DELAYED_ACK_DFLT; //!< Longest an ACK may be held back, in milliseconds
+
+  static constexpr size_t RECV_CAPACITY_MAX_DFLT = 6 << 20; //!< Default limit for an auto-tuned receive buffer
+  static constexpr uint64_t RECV_AUTOTUNE_IDLE_DFLT = 1000;  //!< Default idle time (ms) before it shrinks back
+
+  bool recv_autotune = false;                               //!< Grow the receive buffer as the reader drains it
+  size_t recv_capacity_max = RECV_CAPACITY_MAX_DFLT;        //!< Largest the auto-tuned receive buffer may grow
+  uint64_t recv_autotune_idle_ms = RECV_AUTOTUNE_IDLE_DFLT; //!< Shrink back to recv_capacity after this long idle
+
+  static constexpr uint64_t IDLE_RELEASE_DFLT = 1000; //!< Default idle time (ms) before TCPPeer releases buffers
+
+  bool release_when_idle = false;               //!< TCPPeer gives back empty buffers when the connection goes idle
+  uint64_t idle_release_ms = IDLE_RELEASE_DFLT; //!< ...after this long without a push() or incoming segment
+
+  static constexpr uint8_t MAX_WINDOW_SCALE = 14; //!< Largest window-scale shift RFC 7323 allows
+
+  bool window_scaling = false; //!< Offer RFC 7323 window scaling in the SYN
+
+  //! Smallest shift that lets all of recv_capacity (or recv_capacity_max, when auto-tuned) be
+  //! advertised in the 16-bit window field
+  uint8_t window_scale() const
+  {
+    const size_t capacity = recv_autotune && recv_capacity_max > recv_capacity ? recv_capacity_max : recv_capacity;
+    uint8_t shift = 0;
+    while ( shift < MAX_WINDOW_SCALE && ( capacity >> shift ) > UINT16_MAX ) {
+      ++shift;
+    }
+    return shift;
+  }
 };
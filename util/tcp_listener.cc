@@ -0,0 +1,154 @@
+#include "tcp_listener.hh"
+
+#include "exception.hh"
+#include "log.hh"
+
+#include <cstdint>
+#include <exception>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+// 这个进程可以跑在哪些 CPU 上
+vector<int> allowed_cpus()
+{
+  vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  if ( ::sched_getaffinity( 0, sizeof( set ), &set ) == 0 ) {
+    for ( int cpu = 0; cpu < CPU_SETSIZE; ++cpu ) {
+      if ( CPU_ISSET( cpu, &set ) ) { // NOLINT(*-bitwise, *-pointer-arithmetic)
+        cpus.push_back( cpu );
+      }
+    }
+  }
+  return cpus;
+}
+} // namespace
+
+TCPListener::Worker::Worker( TCPSocket&& listening_socket )
+  : socket( std::move( listening_socket ) )
+  , wakeup( CheckSystemCall( "eventfd", ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) )
+{}
+
+TCPListener::TCPListener( const Address& address,
+                          ConnectionCallback on_connection,
+                          size_t threads,
+                          EventLoop::Backend backend,
+                          int backlog )
+  : on_connection_( std::move( on_connection ) ), backend_( backend )
+{
+  const vector<int> cpus = allowed_cpus();
+  if ( threads == 0 ) {
+    threads = max<size_t>( cpus.size(), 1 );
+  }
+
+  Address bind_to = address;
+  for ( size_t i = 0; i < threads; ++i ) {
+    TCPSocket socket;
+    socket.set_reuseaddr();
+    socket.set_reuseport();
+    socket.bind( bind_to );
+    socket.listen( backlog );
+    socket.set_blocking( false );
+    if ( i == 0 ) {
+      bind_to = socket.local_address(); // 端口 0 的话，后面的都绑到第一个选出来的端口上
+    }
+    workers_.push_back( make_unique<Worker>( std::move( socket ) ) );
+    // 工作线程比 CPU 多时不绑，让调度器去分
+    if ( threads <= cpus.size() ) {
+      workers_.back()->cpu = cpus.at( i );
+    }
+  }
+}
+
+TCPListener::~TCPListener()
+{
+  try {
+    stop();
+  } catch ( const exception& e ) {
+    // don't throw an exception from the destructor
+    log<LogLevel::Error>( [&]( ostream& out ) { out << "Exception destructing TCPListener: " << e.what(); } );
+  }
+}
+
+void TCPListener::start()
+{
+  for ( auto& worker : workers_ ) {
+    if ( worker->thread.joinable() ) {
+      throw runtime_error( "TCPListener already started" );
+    }
+  }
+  for ( auto& worker : workers_ ) {
+    worker->thread = thread( [this, &w = *worker] { run_( w ); } );
+  }
+}
+
+void TCPListener::stop()
+{
+  for ( auto& worker : workers_ ) {
+    if ( worker->thread.joinable() ) {
+      const uint64_t one = 1;
+      CheckSystemCall( "write eventfd", ::write( worker->wakeup.fd_num(), &one, sizeof( one ) ) );
+    }
+  }
+  for ( auto& worker : workers_ ) {
+    if ( worker->thread.joinable() ) {
+      worker->thread.join();
+    }
+  }
+}
+
+uint64_t TCPListener::accepted() const
+{
+  uint64_t total = 0;
+  for ( const auto& worker : workers_ ) {
+    total += worker->accepted.load();
+  }
+  return total;
+}
+
+void TCPListener::run_( Worker& worker )
+{
+  try {
+    if ( worker.cpu >= 0 ) {
+      cpu_set_t set;
+      CPU_ZERO( &set );
+      CPU_SET( worker.cpu, &set ); // NOLINT(*-bitwise, *-pointer-arithmetic)
+      ::pthread_setaffinity_np( ::pthread_self(), sizeof( set ), &set ); // 绑不上也照样跑
+    }
+
+    // 循环在工作线程里建，回调和连接都只在这个线程里碰
+    EventLoop loop { backend_ };
+    loop.add( worker.wakeup, [&] {
+      uint64_t count {};
+      ::read( worker.wakeup.fd_num(), &count, sizeof( count ) ); // 清零，下次 start() 还能用
+      loop.stop();
+    } );
+
+    // 水平触发：一轮只接受一批，剩下的下一轮接着来
+    loop.add(
+      worker.socket,
+      [&] {
+        for ( size_t i = 0; i < ACCEPT_BATCH; ++i ) {
+          auto connection = worker.socket.accept_nonblocking();
+          if ( not connection ) {
+            return;
+          }
+          worker.accepted.fetch_add( 1, memory_order_relaxed );
+          on_connection_( std::move( *connection ), loop );
+        }
+      },
+      {},
+      false );
+
+    loop.run();
+  } catch ( const exception& e ) {
+    log<LogLevel::Error>( [&]( ostream& out ) { out << "TCPListener worker stopped: " << e.what(); } );
+  }
+}
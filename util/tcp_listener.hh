@@ -0,0 +1,75 @@
+#pragma once
+
+#include "address.hh"
+#include "event_loop.hh"
+#include "file_descriptor.hh"
+#include "socket.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//! \brief A TCP server front end with one acceptor, and one EventLoop, per thread
+//! \details Every worker thread has its own listening socket, all bound to the same address with
+//! [SO_REUSEPORT](\ref man7::socket), so the kernel spreads incoming connections across them
+//! with no accept queue or lock shared between threads. Each worker runs its own EventLoop,
+//! which watches its listening socket; a new connection is accepted already non-blocking and
+//! close-on-exec, and handed to the callback on that worker's thread together with the loop,
+//! where the callback registers it. A connection stays on the thread that accepted it.
+class TCPListener
+{
+public:
+  using ConnectionCallback = std::function<void( TCPSocket&& connection, EventLoop& loop )>;
+
+  static constexpr int DEFAULT_BACKLOG = 1024;
+
+  //! Bind `threads` listening sockets (0: one per CPU this process may run on) to `address`.
+  //! With port 0, the first socket picks a free port and the others bind to the same one.
+  TCPListener( const Address& address,
+               ConnectionCallback on_connection,
+               size_t threads = 0,
+               EventLoop::Backend backend = EventLoop::Backend::Epoll,
+               int backlog = DEFAULT_BACKLOG );
+  ~TCPListener();
+
+  TCPListener( const TCPListener& ) = delete;
+  TCPListener& operator=( const TCPListener& ) = delete;
+
+  //! Start the worker threads, each pinned to its own CPU where possible
+  void start();
+
+  //! Wake every worker and wait for it to finish. Its loop, and every connection still
+  //! registered with it, goes away with the thread.
+  void stop();
+
+  Address address() const { return workers_.front()->socket.local_address(); } //!< Where it listens
+  size_t threads() const { return workers_.size(); }                            //!< Number of workers
+
+  //! Connections accepted by worker `index`, or by all of them
+  uint64_t accepted( size_t index ) const { return workers_.at( index )->accepted.load(); }
+  uint64_t accepted() const;
+
+private:
+  static constexpr size_t ACCEPT_BATCH = 64; // 每一轮最多接受这么多，别让新连接饿着已有的连接
+
+  struct Worker
+  {
+    explicit Worker( TCPSocket&& listening_socket );
+
+    TCPSocket socket;
+    FileDescriptor wakeup; // eventfd：stop() 写它，把工作线程从等待里叫醒
+    int cpu { -1 };        // 绑到哪个 CPU（-1：不绑）
+    std::atomic<uint64_t> accepted {};
+    std::thread thread {};
+  };
+
+  void run_( Worker& worker );
+
+  ConnectionCallback on_connection_;
+  EventLoop::Backend backend_;
+  std::vector<std::unique_ptr<Worker>> workers_ {};
+};
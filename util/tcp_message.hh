@@ -0,0 +1,17 @@
+#pragma once
+
+#include "tcp_receiver_message.hh"
+#include "tcp_sender_message.hh"
+
+/*
+ * The TCPMessage structure is one TCP segment as exchanged between two TCPPeers.
+ *
+ * It carries both halves of the segment: the sender's (seqno, SYN, payload, FIN) for the
+ * other side's TCPReceiver, and the receiver's (ackno, window) for the other side's TCPSender.
+ */
+
+struct TCPMessage
+{
+  TCPSenderMessage sender {};
+  TCPReceiverMessage receiver {};
+};
@@ -3,22 +3,31 @@
 #include "wrapping_integers.hh"
 
 #include <optional>
+#include <utility>
+#include <vector>
 
 /*
  * The TCPReceiverMessage structure contains the information sent from a TCP receiver to its sender.
  *
- * It contains two fields:
+ * It contains three fields:
  *
  * 1) The acknowledgment number (ackno): the *next* sequence number needed by the TCP Receiver.
  *    This is an optional field that is empty if the TCPReceiver hasn't yet received the Initial Sequence Number.
  *
  * 2) The window size. This is the number of sequence numbers that the TCP receiver is interested
  *    to receive, starting from the ackno if present. The maximum value is 65,535 (UINT16_MAX from
- *    the <cstdint> header).
+ *    the <cstdint> header). Once window scaling has been negotiated (see TCPSenderMessage), the
+ *    window is this value shifted left by the receiver's window scale.
+ *
+ * 3) Selective acknowledgments (RFC 2018): up to MAX_SACK_BLOCKS ranges [left, right) of sequence
+ *    numbers beyond the ackno that the receiver already holds. Empty if the receiver doesn't report them.
  */
 
 struct TCPReceiverMessage
 {
   std::optional<Wrap32> ackno {};
   uint16_t window_size {};
+  std::vector<std::pair<Wrap32, Wrap32>> sack {};
+
+  static constexpr size_t MAX_SACK_BLOCKS = 4;
 };
@@ -0,0 +1,234 @@
+#include "tcp_segment.hh"
+#include "checksum.hh"
+
+#include <algorithm>
+#include <sstream>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace {
+constexpr uint8_t FLAG_FIN = 0x01;
+constexpr uint8_t FLAG_SYN = 0x02;
+constexpr uint8_t FLAG_RST = 0x04;
+constexpr uint8_t FLAG_ACK = 0x10;
+
+constexpr uint8_t OPTION_EOL = 0;
+constexpr uint8_t OPTION_NOP = 1;
+constexpr uint8_t OPTION_WINDOW_SCALE = 3; // RFC 7323
+constexpr uint8_t OPTION_SACK = 5;         // RFC 2018
+
+constexpr size_t WINDOW_SCALE_OPTION_LENGTH = 4; // NOP + kind + length + shift
+constexpr size_t SACK_BLOCK_LENGTH = 8;
+
+// 线上格式要的是 32 位原始值（Wrap32 的实现在 minnow 库里，这里不依赖它）
+class RawWrap32 : public Wrap32
+{
+public:
+  uint32_t raw_value() const { return raw_value_; }
+};
+
+uint32_t raw( Wrap32 n )
+{
+  return RawWrap32 { n }.raw_value();
+}
+
+bool has_window_scale( const TCPSegment& seg )
+{
+  return seg.message.sender.SYN && seg.message.sender.window_scale.has_value();
+}
+
+size_t sack_blocks( const TCPSegment& seg )
+{
+  return min( seg.message.receiver.sack.size(), TCPReceiverMessage::MAX_SACK_BLOCKS );
+}
+
+uint32_t read_be32( string_view bytes )
+{
+  uint32_t ret = 0;
+  for ( size_t i = 0; i < 4; ++i ) {
+    ret = ( ret << 8 ) | static_cast<uint8_t>( bytes[i] );
+  }
+  return ret;
+}
+
+// 头部（含选项），不含 payload
+void serialize_header( const TCPSegment& seg, Serializer& serializer )
+{
+  const auto& sender = seg.message.sender;
+  const auto& receiver = seg.message.receiver;
+
+  serializer.reserve( seg.header_length() );
+  serializer.integer( seg.src_port );
+  serializer.integer( seg.dst_port );
+  serializer.integer( raw( sender.seqno ) );
+  serializer.integer( receiver.ackno.has_value() ? raw( receiver.ackno.value() ) : uint32_t {} );
+
+  const auto data_offset = static_cast<uint8_t>( seg.header_length() / 4 << 4 );
+  const auto flags = static_cast<uint8_t>( ( receiver.ackno.has_value() ? FLAG_ACK : 0 ) | ( seg.RST ? FLAG_RST : 0 )
+                                           | ( sender.SYN ? FLAG_SYN : 0 ) | ( sender.FIN ? FLAG_FIN : 0 ) );
+  serializer.integer( data_offset );
+  serializer.integer( flags );
+  serializer.integer( receiver.window_size );
+  serializer.integer( seg.cksum );
+  serializer.integer( uint16_t {} ); // urgent pointer
+
+  // 选项前面用 NOP 补齐，让每个选项都 4 字节对齐
+  if ( has_window_scale( seg ) ) {
+    serializer.integer( OPTION_NOP );
+    serializer.integer( OPTION_WINDOW_SCALE );
+    serializer.integer( uint8_t { 3 } );
+    serializer.integer( sender.window_scale.value() );
+  }
+  if ( const auto blocks = sack_blocks( seg ) ) {
+    serializer.integer( OPTION_NOP );
+    serializer.integer( OPTION_NOP );
+    serializer.integer( OPTION_SACK );
+    serializer.integer( static_cast<uint8_t>( 2 + blocks * SACK_BLOCK_LENGTH ) );
+    for ( size_t i = 0; i < blocks; ++i ) {
+      serializer.integer( raw( receiver.sack[i].first ) );
+      serializer.integer( raw( receiver.sack[i].second ) );
+    }
+  }
+}
+} // namespace
+
+size_t TCPSegment::header_length() const
+{
+  size_t len = LENGTH;
+  if ( has_window_scale( *this ) ) {
+    len += WINDOW_SCALE_OPTION_LENGTH;
+  }
+  if ( const auto blocks = sack_blocks( *this ) ) {
+    len += 4 + blocks * SACK_BLOCK_LENGTH;
+  }
+  return len;
+}
+
+void TCPSegment::compute_checksum( uint32_t pseudo_checksum )
+{
+  cksum = 0;
+  thread_local string scratch; // 同 IPv4Header::compute_checksum()
+  Serializer s { std::move( scratch ) };
+  serialize_header( *this, s );
+
+  // payload 直接在原来的 Buffer 上求和，不拼接
+  InternetChecksum check { pseudo_checksum };
+  check.add( s.pending() );
+  check.add( string_view { message.sender.payload } );
+  cksum = check.value();
+  scratch = s.reclaim();
+}
+
+void TCPSegment::parse( Parser& parser, uint32_t pseudo_checksum )
+{
+  // 连同校验和字段一起求和，结果应为 0（下层已经验过就不再读一遍）
+  if ( not parser.checksum_verified() ) {
+    InternetChecksum check { pseudo_checksum };
+    vector<string_view> views;
+    parser.input().peek_all( views );
+    for ( const auto view : views ) {
+      check.add( view );
+    }
+    if ( check.value() != 0 ) {
+      parser.set_checksum_error();
+    }
+  }
+
+  uint32_t seqno {};
+  uint32_t ackno {};
+  uint8_t data_offset {};
+  uint8_t flags {};
+  uint16_t urgent {};
+  parser.integer( src_port );
+  parser.integer( dst_port );
+  parser.integer( seqno );
+  parser.integer( ackno );
+  parser.integer( data_offset );
+  parser.integer( flags );
+  parser.integer( message.receiver.window_size );
+  parser.integer( cksum );
+  parser.integer( urgent );
+
+  const size_t hlen = static_cast<size_t>( data_offset >> 4 ) * 4;
+  if ( hlen < LENGTH ) {
+    parser.set_error();
+  }
+  if ( parser.has_error() ) {
+    return;
+  }
+
+  auto& sender = message.sender;
+  auto& receiver = message.receiver;
+  sender.seqno = Wrap32 { seqno };
+  sender.SYN = flags & FLAG_SYN;
+  sender.FIN = flags & FLAG_FIN;
+  sender.window_scale.reset();
+  RST = flags & FLAG_RST;
+  receiver.ackno.reset();
+  if ( flags & FLAG_ACK ) {
+    receiver.ackno = Wrap32 { ackno };
+  }
+  receiver.sack.clear();
+
+  string options( hlen - LENGTH, 0 );
+  parser.string( options );
+  for ( size_t i = 0; i < options.size() && !parser.has_error(); ) {
+    const uint8_t kind = options[i];
+    if ( kind == OPTION_EOL ) {
+      break;
+    }
+    if ( kind == OPTION_NOP ) {
+      ++i;
+      continue;
+    }
+    const size_t len = i + 1 < options.size() ? static_cast<uint8_t>( options[i + 1] ) : 0;
+    if ( len < 2 || i + len > options.size() ) {
+      parser.set_error();
+      break;
+    }
+    const string_view body = string_view { options }.substr( i + 2, len - 2 );
+    if ( kind == OPTION_WINDOW_SCALE && body.size() == 1 && sender.SYN ) {
+      sender.window_scale = static_cast<uint8_t>( body[0] );
+    } else if ( kind == OPTION_SACK && body.size() % SACK_BLOCK_LENGTH == 0 ) {
+      for ( size_t j = 0; j < body.size(); j += SACK_BLOCK_LENGTH ) {
+        receiver.sack.emplace_back( Wrap32 { read_be32( body.substr( j ) ) },
+                                    Wrap32 { read_be32( body.substr( j + 4 ) ) } );
+      }
+    }
+    i += len;
+  }
+
+  parser.all_remaining( sender.payload );
+}
+
+void TCPSegment::serialize( Serializer& serializer ) const
+{
+  serialize_header( *this, serializer );
+  serializer.buffer( message.sender.payload );
+}
+
+string TCPSegment::to_string() const
+{
+  const auto& sender = message.sender;
+  const auto& receiver = message.receiver;
+
+  stringstream ss {};
+  ss << "TCP " << src_port << "->" << dst_port << ", seqno=" << raw( sender.seqno );
+  if ( receiver.ackno.has_value() ) {
+    ss << ", ackno=" << raw( receiver.ackno.value() );
+  }
+  ss << ", win=" << receiver.window_size;
+  if ( sender.SYN ) {
+    ss << ", SYN";
+  }
+  if ( sender.FIN ) {
+    ss << ", FIN";
+  }
+  if ( RST ) {
+    ss << ", RST";
+  }
+  ss << ", payload_len=" << sender.payload.size();
+  return ss.str();
+}
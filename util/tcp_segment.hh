@@ -0,0 +1,62 @@
+#pragma once
+
+#include "parser.hh"
+#include "tcp_message.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// TCP segment (RFC 9293): a TCPMessage plus the fields that only exist on the wire
+struct TCPSegment
+{
+  static constexpr size_t LENGTH = 20; // TCP header length, not including options
+
+  /*
+   *   0                   1                   2                   3
+   *   0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+   *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   *  |          Source Port          |       Destination Port        |
+   *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   *  |                        Sequence Number                        |
+   *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   *  |                    Acknowledgment Number                      |
+   *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   *  |  Data |       |C|E|U|A|P|R|S|F|                               |
+   *  | Offset| Rsrvd |W|C|R|C|S|S|Y|I|            Window             |
+   *  |       |       |R|E|G|K|H|T|N|N|                               |
+   *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   *  |           Checksum            |         Urgent Pointer        |
+   *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   *  |                           [Options]                           |
+   *  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+   *
+   * The ACK flag is set when message.receiver.ackno has a value. The window-scale option
+   * (RFC 7323) goes with SYN, and SACK blocks (RFC 2018) go in a SACK option. Other options
+   * are skipped when parsing.
+   */
+
+  uint16_t src_port {};
+  uint16_t dst_port {};
+  TCPMessage message {};
+  bool RST { false };
+  uint16_t cksum {};
+
+  // Header length, including options, in bytes (a multiple of 4)
+  size_t header_length() const;
+
+  // Set cksum to the correct value. `pseudo_checksum` is the IP layer's contribution (e.g.
+  // IPv4Header::pseudo_checksum(), with the datagram's length already set). The payload Buffer
+  // is summed in place.
+  void compute_checksum( uint32_t pseudo_checksum );
+
+  // Return a string containing the segment in human-readable format
+  std::string to_string() const;
+
+  // Parse a segment, and set the parser's error if the checksum (seeded with `pseudo_checksum`) is wrong.
+  // The checksum is not summed again if the parser says it was already verified.
+  void parse( Parser& parser, uint32_t pseudo_checksum );
+
+  // Serialize the segment (does not recompute the checksum). The payload is not copied.
+  void serialize( Serializer& serializer ) const;
+};